@@ -8,31 +8,44 @@
  *   - Editable input area with cursor support
  *   - Streaming response display
  *
+ * Messages are laid out once and kept in a chat_view_t (see chat_view.h).
+ * Frames repaint only the bubble rows that changed, and streamed deltas
+ * are coalesced into at most CHAT_TUI_FPS frames per second.
+ *
  * Usage:
  *   1. Create .env file with OPENAI_API_KEY=sk-xxx
  *   2. Run ./chat_tui
+ *
+ * Environment variables:
+ *   OPENAI_API_KEY   - Required: OpenAI API key
+ *   OPENAI_BASE_URL  - Optional: API base URL
+ *   OPENAI_MODEL     - Optional: Model name (default: gpt-3.5-turbo)
+ *   CHAT_TUI_FPS     - Optional: Maximum frames per second while streaming (default: 30)
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <signal.h>
 #include <locale.h>
 #include <notcurses/notcurses.h>
 #include "arc.h"
 #include <arc/env.h>
+#include "chat_view.h"
 
 /*============================================================================
  * Constants
  *============================================================================*/
 
-#define MAX_MESSAGES 100
 #define MAX_MESSAGE_LEN 8192
 #define INPUT_HEIGHT 3
 #define HEADER_HEIGHT 2
 #define BUBBLE_PADDING 2
 #define MAX_BUBBLE_WIDTH_RATIO 0.7  /* Max 70% of screen width for bubbles */
 
+#define SYSTEM_PROMPT "You are a helpful assistant. Be concise and clear."
+
 /*============================================================================
  * Color Definitions
  *============================================================================*/
@@ -49,22 +62,6 @@
 #define COLOR_USER_NAME    0x00d4ff
 #define COLOR_AI_NAME      0x7fdbda
 
-/*============================================================================
- * Message Structure
- *============================================================================*/
-
-typedef enum {
-    MSG_USER,
-    MSG_ASSISTANT,
-    MSG_SYSTEM
-} msg_type_t;
-
-typedef struct {
-    msg_type_t type;
-    char *content;
-    int content_len;
-} chat_message_t;
-
 /*============================================================================
  * Application State
  *============================================================================*/
@@ -83,10 +80,13 @@ typedef struct {
     unsigned int msg_area_rows;
 
     /* Messages */
-    chat_message_t messages[MAX_MESSAGES];
-    int message_count;
+    chat_view_t view;
     int scroll_offset;
 
+    /* What the messages plane currently shows */
+    int painted_start_y;
+    int painted_streaming;
+
     /* Input buffer (manual implementation for better control) */
     char input_buffer[MAX_MESSAGE_LEN];
     int input_len;
@@ -94,13 +94,14 @@ typedef struct {
 
     /* Streaming state */
     int is_streaming;
-    char *streaming_buffer;
-    int streaming_len;
-    int streaming_cap;
-
-    /* LLM */
-    ac_llm_t *llm;
-    ac_message_t *history;
+    int reply_started;          /* First delta replaced the placeholder */
+    char stream_error[256];
+
+    /* Agent */
+    ac_session_t *session;
+    ac_agent_t *agent;
+    const char *api_key;
+    const char *base_url;
     const char *model_name;
 
     /* Running state */
@@ -120,22 +121,14 @@ static void app_cleanup(void) {
     }
 
     /* Free messages */
-    for (int i = 0; i < g_app.message_count; i++) {
-        free(g_app.messages[i].content);
-    }
+    chat_view_free(&g_app.view);
 
-    /* Free streaming buffer */
-    free(g_app.streaming_buffer);
-
-    /* Free LLM resources */
-    if (g_app.history) {
-        ac_message_free(g_app.history);
-    }
-    if (g_app.llm) {
-        ac_llm_destroy(g_app.llm);
+    /* Session owns the agent */
+    if (g_app.session) {
+        ac_session_close(g_app.session);
+        g_app.session = NULL;
+        g_app.agent = NULL;
     }
-
-    ac_cleanup();
 }
 
 static void signal_handler(int sig) {
@@ -143,50 +136,6 @@ static void signal_handler(int sig) {
     g_app.running = 0;
 }
 
-/* Calculate display width of a UTF-8 string */
-static int utf8_display_width(const char *str, int len) {
-    int width = 0;
-    const char *end = str + len;
-    while (str < end && *str) {
-        unsigned char c = (unsigned char)*str;
-        if (c < 0x80) {
-            width++;
-            str++;
-        } else if ((c & 0xE0) == 0xC0) {
-            width++;  /* Assume 1 cell width */
-            str += 2;
-        } else if ((c & 0xF0) == 0xE0) {
-            width += 2;  /* CJK characters are 2 cells */
-            str += 3;
-        } else if ((c & 0xF8) == 0xF0) {
-            width += 2;  /* Emoji etc */
-            str += 4;
-        } else {
-            str++;
-        }
-    }
-    return width;
-}
-
-/*============================================================================
- * Message Management
- *============================================================================*/
-
-static void add_message(msg_type_t type, const char *content) {
-    if (g_app.message_count >= MAX_MESSAGES) {
-        /* Remove oldest message */
-        free(g_app.messages[0].content);
-        memmove(&g_app.messages[0], &g_app.messages[1],
-                sizeof(chat_message_t) * (MAX_MESSAGES - 1));
-        g_app.message_count--;
-    }
-
-    g_app.messages[g_app.message_count].type = type;
-    g_app.messages[g_app.message_count].content = strdup(content);
-    g_app.messages[g_app.message_count].content_len = strlen(content);
-    g_app.message_count++;
-}
-
 /*============================================================================
  * Rendering Functions
  *============================================================================*/
@@ -221,122 +170,41 @@ static void render_header(void) {
     }
 }
 
-/* Word wrap a string, returns number of lines */
-static int wrap_text(const char *text, int max_width, char ***lines_out, int **line_lens) {
-    if (!text || max_width <= 0) return 0;
-
-    int capacity = 16;
-    char **lines = malloc(capacity * sizeof(char*));
-    int *lens = malloc(capacity * sizeof(int));
-    int count = 0;
-
-    const char *p = text;
-
-    while (*p) {
-        /* Find line break or wrap point */
-        const char *line_start = p;
-        int line_width = 0;
-        const char *wrap_point = NULL;
-        const char *line_end = p;
-
-        while (*p && *p != '\n') {
-            unsigned char c = (unsigned char)*p;
-            int char_width = 1;
-            int char_len = 1;
-
-            if (c < 0x80) {
-                char_len = 1;
-                char_width = 1;
-            } else if ((c & 0xE0) == 0xC0) {
-                char_len = 2;
-                char_width = 1;
-            } else if ((c & 0xF0) == 0xE0) {
-                char_len = 3;
-                char_width = 2;
-            } else if ((c & 0xF8) == 0xF0) {
-                char_len = 4;
-                char_width = 2;
-            }
-
-            if (line_width + char_width > max_width) {
-                /* Need to wrap */
-                if (wrap_point && wrap_point > line_start) {
-                    line_end = wrap_point;
-                } else {
-                    line_end = p;
-                }
-                break;
-            }
-
-            line_width += char_width;
-            line_end = p + char_len;
-
-            /* Track word boundaries */
-            if (*p == ' ') {
-                wrap_point = p + 1;
-            }
-
-            p += char_len;
-        }
-
-        /* Store line */
-        if (count >= capacity) {
-            capacity *= 2;
-            lines = realloc(lines, capacity * sizeof(char*));
-            lens = realloc(lens, capacity * sizeof(int));
-        }
-
-        int len = line_end - line_start;
-        lines[count] = malloc(len + 1);
-        memcpy(lines[count], line_start, len);
-        lines[count][len] = '\0';
-        lens[count] = len;
-        count++;
-
-        /* Skip newline */
-        if (*p == '\n') p++;
-        else if (line_end > line_start) p = line_end;
-
-        /* Skip leading space on wrapped lines */
-        while (*p == ' ') p++;
-    }
+static int bubble_max_width(void) {
+    int bubble_max = (int)(g_app.term_cols * MAX_BUBBLE_WIDTH_RATIO);
+    if (bubble_max < 20) bubble_max = 20;
+    return bubble_max;
+}
 
-    *lines_out = lines;
-    *line_lens = lens;
-    return count;
+static int row_visible(int y) {
+    return y >= 0 && y < (int)g_app.msg_area_rows;
 }
 
-static void free_wrapped_lines(char **lines, int *lens, int count) {
-    for (int i = 0; i < count; i++) {
-        free(lines[i]);
+/* Blank `count` rows of the messages plane starting at y */
+static void clear_rows(struct ncplane *n, int y, int count) {
+    ncplane_set_fg_rgb(n, COLOR_TEXT);
+    ncplane_set_bg_rgb(n, COLOR_BG);
+    ncplane_set_styles(n, NCSTYLE_NONE);
+    for (int row = y; row < y + count; row++) {
+        if (!row_visible(row)) continue;
+        ncplane_putchar_yx(n, row, 0, ' ');
+        for (unsigned int i = 1; i < g_app.term_cols; i++) {
+            ncplane_putchar(n, ' ');
+        }
     }
-    free(lines);
-    free(lens);
 }
 
-/* Render a single message bubble, returns height used */
-static int render_message_bubble(struct ncplane *n, int y, chat_message_t *msg,
-                                  int max_width, int is_streaming) {
-    int bubble_max = (int)(g_app.term_cols * MAX_BUBBLE_WIDTH_RATIO);
-    if (bubble_max < 20) bubble_max = 20;
-    int content_max = bubble_max - BUBBLE_PADDING * 2 - 2;
-
-    char **lines;
-    int *line_lens;
-    int line_count = wrap_text(msg->content, content_max, &lines, &line_lens);
-    if (line_count == 0) return 0;
-
-    /* Calculate bubble width */
-    int max_line_width = 0;
-    for (int i = 0; i < line_count; i++) {
-        int w = utf8_display_width(lines[i], line_lens[i]);
-        if (w > max_line_width) max_line_width = w;
-    }
-    int bubble_width = max_line_width + BUBBLE_PADDING * 2 + 2;
+/*
+ * Paint a message bubble whose name label is at row y, from content line
+ * `first` down to the bottom border. first = -1 paints the whole bubble.
+ * Rows outside the messages area are skipped.
+ */
+static void paint_bubble(struct ncplane *n, int y, const chat_message_t *msg,
+                         int first, int is_streaming) {
+    int bubble_max = bubble_max_width();
+    int bubble_width = msg->max_width + BUBBLE_PADDING * 2 + 2;
     if (bubble_width > bubble_max) bubble_width = bubble_max;
 
-    int bubble_height = line_count + 2;  /* +2 for top/bottom borders */
-
     /* Calculate x position */
     int x;
     uint32_t bubble_color, name_color;
@@ -354,21 +222,23 @@ static int render_message_bubble(struct ncplane *n, int y, chat_message_t *msg,
         name_label = "AI";
     }
 
-    if (y < 0) {
-        free_wrapped_lines(lines, line_lens, line_count);
-        return bubble_height + 2;  /* +2 for name label and spacing */
-    }
+    int top = y + 1;
+    int bottom = top + msg->line_count + 1;
 
-    /* Render name label */
-    ncplane_set_fg_rgb(n, name_color);
-    ncplane_set_bg_rgb(n, COLOR_BG);
-    ncplane_set_styles(n, NCSTYLE_BOLD);
-    if (msg->type == MSG_USER) {
-        ncplane_printf_yx(n, y, x + bubble_width - strlen(name_label), "%s", name_label);
-    } else {
-        ncplane_printf_yx(n, y, x, "%s", name_label);
+    if (first < 0) {
+        /* Render name label */
+        if (row_visible(y)) {
+            ncplane_set_fg_rgb(n, name_color);
+            ncplane_set_bg_rgb(n, COLOR_BG);
+            ncplane_set_styles(n, NCSTYLE_BOLD);
+            if (msg->type == MSG_USER) {
+                ncplane_printf_yx(n, y, x + bubble_width - strlen(name_label), "%s", name_label);
+            } else {
+                ncplane_printf_yx(n, y, x, "%s", name_label);
+            }
+        }
+        first = 0;
     }
-    y++;
 
     /* Set bubble colors */
     ncplane_set_fg_rgb(n, COLOR_TEXT);
@@ -376,27 +246,31 @@ static int render_message_bubble(struct ncplane *n, int y, chat_message_t *msg,
     ncplane_set_styles(n, NCSTYLE_NONE);
 
     /* Top border */
-    ncplane_putstr_yx(n, y, x, "╭");
-    for (int i = 1; i < bubble_width - 1; i++) {
-        ncplane_putstr(n, "─");
+    if (first == 0 && row_visible(top)) {
+        ncplane_putstr_yx(n, top, x, "╭");
+        for (int i = 1; i < bubble_width - 1; i++) {
+            ncplane_putstr(n, "─");
+        }
+        ncplane_putstr(n, "╮");
     }
-    ncplane_putstr(n, "╮");
-    y++;
 
     /* Content lines */
-    for (int i = 0; i < line_count; i++) {
-        ncplane_printf_yx(n, y, x, "│");
-        ncplane_set_bg_rgb(n, bubble_color);
+    for (int i = first; i < msg->line_count; i++) {
+        int row = top + 1 + i;
+        if (row < 0) continue;
+        if (row >= (int)g_app.msg_area_rows) break;
+
+        const chat_line_t *line = &msg->lines[i];
+        ncplane_putstr_yx(n, row, x, "│");
 
         /* Padding and content */
         for (int p = 0; p < BUBBLE_PADDING; p++) {
             ncplane_putstr(n, " ");
         }
-        ncplane_putstr(n, lines[i]);
+        ncplane_putnstr(n, line->len, msg->content + line->offset);
 
         /* Fill remaining space */
-        int line_w = utf8_display_width(lines[i], line_lens[i]);
-        int remaining = bubble_width - 2 - BUBBLE_PADDING * 2 - line_w;
+        int remaining = bubble_width - 2 - BUBBLE_PADDING * 2 - line->width;
         for (int p = 0; p < remaining; p++) {
             ncplane_putstr(n, " ");
         }
@@ -405,75 +279,110 @@ static int render_message_bubble(struct ncplane *n, int y, chat_message_t *msg,
         }
 
         ncplane_putstr(n, "│");
-        y++;
     }
 
-    /* Bottom border with optional streaming indicator */
-    ncplane_printf_yx(n, y, x, "╰");
+    if (!row_visible(bottom)) return;
+
+    /* Bottom border */
+    ncplane_putstr_yx(n, bottom, x, "╰");
     for (int i = 1; i < bubble_width - 1; i++) {
         ncplane_putstr(n, "─");
     }
     ncplane_putstr(n, "╯");
-    y++;
 
     /* Streaming indicator */
-    if (is_streaming) {
-        ncplane_set_fg_rgb(n, COLOR_ACCENT);
-        ncplane_set_bg_rgb(n, COLOR_BG);
-        ncplane_putstr_yx(n, y - 1, x + bubble_width + 1, "▌");
+    ncplane_set_fg_rgb(n, COLOR_ACCENT);
+    ncplane_set_bg_rgb(n, COLOR_BG);
+    ncplane_putstr_yx(n, bottom, x + bubble_width + 1, is_streaming ? "▌" : " ");
+}
+
+static void paint_all_messages(struct ncplane *n, int start_y) {
+    chat_view_t *view = &g_app.view;
+
+    ncplane_set_fg_rgb(n, COLOR_TEXT);
+    ncplane_set_bg_rgb(n, COLOR_BG);
+    ncplane_erase(n);
+
+    int y = start_y;
+    for (int i = 0; i < view->message_count && y < (int)g_app.msg_area_rows; i++) {
+        const chat_message_t *msg = &view->messages[i];
+        int h = chat_message_height(msg);
+        int is_streaming = (i == view->message_count - 1) && g_app.is_streaming;
+
+        if (y + h > 0) {
+            paint_bubble(n, y, msg, -1, is_streaming);
+        }
+        y += h;
+    }
+}
+
+/* Repaint the changed part of each dirty message; returns 0 if a full repaint is needed */
+static int paint_damage(struct ncplane *n, int start_y) {
+    chat_view_t *view = &g_app.view;
+
+    /* A message that changed height moves everything below it */
+    for (int i = 0; i < view->message_count - 1; i++) {
+        const chat_message_t *msg = &view->messages[i];
+        if (msg->dirty_line >= 0 && msg->prev_height != chat_message_height(msg)) {
+            return 0;
+        }
     }
 
-    free_wrapped_lines(lines, line_lens, line_count);
-    return bubble_height + 2;  /* +2 for name label and spacing */
+    int y = start_y;
+    for (int i = 0; i < view->message_count && y < (int)g_app.msg_area_rows; i++) {
+        const chat_message_t *msg = &view->messages[i];
+        int h = chat_message_height(msg);
+        int is_streaming = (i == view->message_count - 1) && g_app.is_streaming;
+
+        if (msg->dirty_line >= 0) {
+            if (msg->prev_height != h || msg->prev_max_width != msg->max_width) {
+                /* Bubble resized: clear its old and new rows */
+                clear_rows(n, y, h > msg->prev_height ? h : msg->prev_height);
+                paint_bubble(n, y, msg, -1, is_streaming);
+            } else {
+                paint_bubble(n, y, msg, msg->dirty_line, is_streaming);
+            }
+        }
+        y += h;
+    }
+    return 1;
 }
 
 static void render_messages(void) {
     struct ncplane *n = g_app.messages_plane;
+    chat_view_t *view = &g_app.view;
 
-    /* Clear messages area */
-    ncplane_set_fg_rgb(n, COLOR_TEXT);
-    ncplane_set_bg_rgb(n, COLOR_BG);
-    ncplane_erase(n);
+    /* Re-wraps only when the width changed */
+    chat_view_set_width(view, bubble_max_width() - BUBBLE_PADDING * 2 - 2);
 
-    if (g_app.message_count == 0) {
+    if (view->message_count == 0) {
         /* Welcome message */
+        ncplane_set_fg_rgb(n, COLOR_TEXT);
+        ncplane_set_bg_rgb(n, COLOR_BG);
+        ncplane_erase(n);
         ncplane_set_fg_rgb(n, COLOR_TEXT_DIM);
         int y = g_app.msg_area_rows / 2 - 1;
         int x = (g_app.term_cols - 30) / 2;
         ncplane_printf_yx(n, y, x, "Welcome to ArC Chat!");
         ncplane_printf_yx(n, y + 1, x - 5, "Type a message and press Enter to start");
+        g_app.painted_start_y = INT_MIN;
         return;
     }
 
-    /* Calculate total height needed */
-    int total_height = 0;
-    int *msg_heights = malloc(g_app.message_count * sizeof(int));
-
-    for (int i = 0; i < g_app.message_count; i++) {
-        int h = render_message_bubble(n, -1, &g_app.messages[i], g_app.term_cols, 0);
-        msg_heights[i] = h;
-        total_height += h;
-    }
-
     /* Auto-scroll to bottom */
-    int visible_height = g_app.msg_area_rows;
-    int start_y = visible_height - total_height;
+    int start_y = (int)g_app.msg_area_rows - view->total_height;
     if (start_y > 0) start_y = 0;
     start_y += g_app.scroll_offset;
 
-    /* Render messages */
-    int y = start_y;
-    for (int i = 0; i < g_app.message_count; i++) {
-        int is_last = (i == g_app.message_count - 1);
-        int is_streaming = is_last && g_app.is_streaming;
-
-        if (y + msg_heights[i] > 0 && y < (int)g_app.msg_area_rows) {
-            render_message_bubble(n, y, &g_app.messages[i], g_app.term_cols, is_streaming);
-        }
-        y += msg_heights[i];
+    /* Anything that moves bubbles invalidates the whole area */
+    if (view->full_redraw || start_y != g_app.painted_start_y ||
+        g_app.is_streaming != g_app.painted_streaming ||
+        !paint_damage(n, start_y)) {
+        paint_all_messages(n, start_y);
     }
 
-    free(msg_heights);
+    g_app.painted_start_y = start_y;
+    g_app.painted_streaming = g_app.is_streaming;
 }
 
 static void render_input(void) {
@@ -530,7 +439,7 @@ static void render_input(void) {
 
     /* Position cursor */
     if (g_app.input_len > 0) {
-        int cursor_x = 2 + utf8_display_width(g_app.input_buffer, g_app.cursor_pos);
+        int cursor_x = 2 + chat_view_text_width(g_app.input_buffer, g_app.cursor_pos);
         ncplane_cursor_move_yx(input, 0, cursor_x);
     }
 }
@@ -540,6 +449,7 @@ static void render_all(void) {
     render_messages();
     render_input();
     notcurses_render(g_app.nc);
+    chat_view_frame_done(&g_app.view, chat_view_now_ms());
 }
 
 /*============================================================================
@@ -605,23 +515,76 @@ static void setup_planes(void) {
         .cols = g_app.term_cols - 4,
     };
     g_app.input_plane = ncplane_create(g_app.stdplane, &input_opts);
+
+    /* New planes start blank */
+    g_app.view.full_redraw = 1;
 }
 
 /*============================================================================
  * LLM Interaction
  *============================================================================*/
 
-/* Note: Streaming support removed - using blocking API for now */
+/* Streamed deltas go into the last message; frames are drawn at most at the view's rate */
+static int stream_callback(const ac_stream_event_t *event, void *user_data) {
+    (void)user_data;
+    chat_view_t *view = &g_app.view;
+    chat_message_t *reply = &view->messages[view->message_count - 1];
+
+    if (event->type == AC_STREAM_DELTA && event->delta_type == AC_DELTA_TEXT &&
+        event->delta && event->delta_len > 0) {
+        if (!g_app.reply_started) {
+            chat_view_set_text(view, reply, NULL);
+            g_app.reply_started = 1;
+        }
+        chat_view_append(view, reply, event->delta, (int)event->delta_len);
+    } else if (event->type == AC_STREAM_ERROR) {
+        snprintf(g_app.stream_error, sizeof(g_app.stream_error), "%s",
+                 event->error_msg ? event->error_msg : "Unknown");
+    }
+
+    if (chat_view_frame_due(view, chat_view_now_ms())) {
+        render_all();
+    }
+
+    return g_app.running ? 0 : -1;
+}
+
+static int create_agent(void) {
+    g_app.session = ac_session_open();
+    if (!g_app.session) return -1;
+
+    g_app.agent = ac_agent_create(g_app.session, &(ac_agent_params_t){
+        .name = "ChatTUI",
+        .instructions = SYSTEM_PROMPT,
+        .llm = {
+            .provider = "openai",
+            .model = g_app.model_name,
+            .api_key = g_app.api_key,
+            .api_base = g_app.base_url,
+            .timeout_ms = 120000,
+            .stream = 1,
+        },
+        .callbacks = {
+            .on_stream = stream_callback,
+            .user_data = NULL
+        }
+    });
+    if (!g_app.agent) {
+        ac_session_close(g_app.session);
+        g_app.session = NULL;
+        return -1;
+    }
+    return 0;
+}
 
 static void send_message(void) {
     if (g_app.input_len == 0 || g_app.is_streaming) return;
 
     /* Add user message to display */
-    add_message(MSG_USER, g_app.input_buffer);
+    chat_view_add(&g_app.view, MSG_USER, g_app.input_buffer);
 
-    /* Add to conversation history */
-    ac_message_append(&g_app.history,
-        ac_message_create(AC_ROLE_USER, g_app.input_buffer));
+    char message[MAX_MESSAGE_LEN];
+    memcpy(message, g_app.input_buffer, g_app.input_len + 1);
 
     /* Clear input */
     memset(g_app.input_buffer, 0, sizeof(g_app.input_buffer));
@@ -629,43 +592,28 @@ static void send_message(void) {
     g_app.cursor_pos = 0;
 
     /* Add placeholder for AI response */
-    add_message(MSG_ASSISTANT, "...");
+    chat_message_t *reply = chat_view_add(&g_app.view, MSG_ASSISTANT, "...");
 
-    /* Start processing (blocking mode for now) */
     g_app.is_streaming = 1;
+    g_app.reply_started = 0;
+    g_app.stream_error[0] = '\0';
     render_all();
 
-    /* Perform chat completion */
-    ac_chat_response_t resp = {0};
-    arc_err_t err = ac_llm_chat(g_app.llm, g_app.history, NULL, &resp);
+    /* Run agent - deltas arrive via stream_callback */
+    ac_agent_result_t *result = ac_agent_run(g_app.agent, message);
 
     g_app.is_streaming = 0;
 
-    if (err == ARC_OK && resp.content) {
-        /* Update last message with response */
-        if (g_app.message_count > 0) {
-            chat_message_t *last = &g_app.messages[g_app.message_count - 1];
-            free(last->content);
-            last->content = strdup(resp.content);
-            last->content_len = strlen(resp.content);
-        }
-
-        /* Add to conversation history */
-        ac_message_append(&g_app.history,
-            ac_message_create(AC_ROLE_ASSISTANT, resp.content));
-    } else {
-        /* Update last message with error */
-        if (g_app.message_count > 0) {
-            chat_message_t *last = &g_app.messages[g_app.message_count - 1];
-            free(last->content);
-            char error_msg[256];
-            snprintf(error_msg, sizeof(error_msg), "Error: %s", ac_strerror(err));
-            last->content = strdup(error_msg);
-            last->content_len = strlen(error_msg);
-        }
+    if (g_app.stream_error[0] || !result) {
+        char error_msg[300];
+        snprintf(error_msg, sizeof(error_msg), "Error: %s",
+                 g_app.stream_error[0] ? g_app.stream_error : "Agent run failed");
+        chat_view_set_text(&g_app.view, reply, error_msg);
+    } else if (!g_app.reply_started && result->content) {
+        /* Nothing was streamed */
+        chat_view_set_text(&g_app.view, reply, result->content);
     }
 
-    ac_chat_response_free(&resp);
     render_all();
 }
 
@@ -817,17 +765,16 @@ static void handle_input(ncinput *ni) {
 
     /* Ctrl+L to clear history */
     if (ni->ctrl && (ni->id == 'l' || ni->id == 'L')) {
-        for (int i = 0; i < g_app.message_count; i++) {
-            free(g_app.messages[i].content);
-        }
-        g_app.message_count = 0;
+        chat_view_clear(&g_app.view);
         g_app.scroll_offset = 0;
 
-        ac_message_free(g_app.history);
-        g_app.history = NULL;
-        ac_message_append(&g_app.history,
-            ac_message_create(AC_ROLE_SYSTEM,
-                "You are a helpful assistant. Be concise and clear."));
+        /* A new session starts the agent with an empty history */
+        ac_session_close(g_app.session);
+        g_app.session = NULL;
+        g_app.agent = NULL;
+        if (create_agent() != 0) {
+            g_app.running = 0;
+        }
         return;
     }
 
@@ -875,49 +822,27 @@ int main(int argc, char *argv[]) {
     ac_env_load_verbose(NULL);
 
     /* Get API key */
-    const char *api_key = ac_env_require("OPENAI_API_KEY");
-    if (!api_key) {
+    g_app.api_key = ac_env_require("OPENAI_API_KEY");
+    if (!g_app.api_key) {
         ac_env_print_help("chat_tui");
         return 1;
     }
 
-    const char *base_url = ac_env_get("OPENAI_BASE_URL", NULL);
+    g_app.base_url = ac_env_get("OPENAI_BASE_URL", NULL);
     g_app.model_name = ac_env_get("OPENAI_MODEL", "gpt-3.5-turbo");
 
+    int fps = atoi(ac_env_get("CHAT_TUI_FPS", "30"));
+    chat_view_init(&g_app.view, fps > 0 ? fps : CHAT_VIEW_DEFAULT_FPS);
+
     /* Setup signal handler */
     signal(SIGINT, signal_handler);
 
-    /* Initialize ArC */
-    arc_err_t err = ac_init();
-    if (err != ARC_OK) {
-        AC_LOG_ERROR( "Failed to initialize ArC: %s\n", ac_strerror(err));
+    /* Create session and agent */
+    if (create_agent() != 0) {
+        fprintf(stderr, "Failed to create agent\n");
         return 1;
     }
 
-    /* Create LLM client */
-    ac_llm_params_t params = {
-        .api_key = api_key,
-        .api_base = base_url,
-        .model = g_app.model_name,
-        .timeout_ms = 120000,
-    };
-
-    g_app.llm = ac_llm_create(&params);
-    if (!g_app.llm) {
-        AC_LOG_ERROR( "Failed to create LLM client\n");
-        ac_cleanup();
-        return 1;
-    }
-
-    /* Add system message to history */
-    ac_message_append(&g_app.history,
-        ac_message_create(AC_ROLE_SYSTEM,
-            "You are a helpful assistant. Be concise and clear."));
-
-    /* Allocate streaming buffer */
-    g_app.streaming_cap = 4096;
-    g_app.streaming_buffer = malloc(g_app.streaming_cap);
-
     /* Initialize Notcurses */
     struct notcurses_options opts = {
         .flags = NCOPTION_SUPPRESS_BANNERS | NCOPTION_NO_ALTERNATE_SCREEN,
@@ -925,7 +850,7 @@ int main(int argc, char *argv[]) {
 
     g_app.nc = notcurses_init(&opts, NULL);
     if (!g_app.nc) {
-        AC_LOG_ERROR( "Failed to initialize Notcurses\n");
+        fprintf(stderr, "Failed to initialize Notcurses\n");
         app_cleanup();
         return 1;
     }
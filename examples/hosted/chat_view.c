@@ -0,0 +1,282 @@
+/**
+ * @file chat_view.c
+ * @brief Retained message layout for the chat TUI
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chat_view.h"
+
+/*============================================================================
+ * UTF-8 Helpers
+ *============================================================================*/
+
+/* Byte length and cell width of the character at p (CJK/emoji = 2 cells) */
+static int utf8_char(const char *p, int *width) {
+    unsigned char c = (unsigned char)*p;
+    if (c < 0x80) {
+        *width = 1;
+        return 1;
+    } else if ((c & 0xE0) == 0xC0) {
+        *width = 1;
+        return 2;
+    } else if ((c & 0xF0) == 0xE0) {
+        *width = 2;
+        return 3;
+    } else if ((c & 0xF8) == 0xF0) {
+        *width = 2;
+        return 4;
+    }
+    *width = 1;
+    return 1;
+}
+
+int chat_view_text_width(const char *str, int len) {
+    int width = 0;
+    const char *end = str + len;
+    while (str < end && *str) {
+        int w;
+        str += utf8_char(str, &w);
+        width += w;
+    }
+    return width;
+}
+
+uint64_t chat_view_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+/*============================================================================
+ * Wrapping
+ *============================================================================*/
+
+static int push_line(chat_message_t *msg, int offset, int len, int width) {
+    if (msg->line_count == msg->line_cap) {
+        int cap = msg->line_cap ? msg->line_cap * 2 : 16;
+        chat_line_t *lines = realloc(msg->lines, cap * sizeof(chat_line_t));
+        if (!lines) return -1;
+        msg->lines = lines;
+        msg->line_cap = cap;
+    }
+    msg->lines[msg->line_count].offset = offset;
+    msg->lines[msg->line_count].len = len;
+    msg->lines[msg->line_count].width = width;
+    msg->line_count++;
+    return 0;
+}
+
+/* Wrap text from p to the end of the content, appending lines */
+static void wrap_lines(chat_message_t *msg, const char *p, int width_limit) {
+    const char *text = msg->content;
+    const char *end = text + msg->content_len;
+
+    while (p < end) {
+        const char *line_start = p;
+        const char *line_end = p;
+        const char *wrap_point = NULL;
+        int line_width = 0;
+        int wrap_width = 0;
+        int incomplete = 0;
+
+        while (p < end && *p != '\n') {
+            int char_width;
+            int char_len = utf8_char(p, &char_width);
+            if (p + char_len > end) {
+                incomplete = 1;     /* Wait for the rest of the character */
+                break;
+            }
+
+            if (line_width + char_width > width_limit && p > line_start) {
+                /* Break after the last space, or before this character */
+                if (wrap_point && wrap_point > line_start) {
+                    line_end = wrap_point;
+                    line_width = wrap_width;
+                }
+                break;
+            }
+
+            line_width += char_width;
+            line_end = p + char_len;
+
+            /* Track word boundaries */
+            if (*p == ' ') {
+                wrap_point = p + 1;
+                wrap_width = line_width;
+            }
+
+            p += char_len;
+        }
+
+        if (push_line(msg, (int)(line_start - text), (int)(line_end - line_start), line_width) != 0) {
+            return;
+        }
+        if (incomplete) return;
+
+        /* Skip newline */
+        if (p < end && *p == '\n') p++;
+        else if (line_end > line_start) p = line_end;
+
+        /* Skip leading space on wrapped lines */
+        while (p < end && *p == ' ') p++;
+    }
+}
+
+/*
+ * Word-wrap the content from line `first` onwards, where first is 0 or
+ * the last line. Lines before it are final: each ended at a newline or
+ * at a character that did not fit, and appending text cannot change
+ * either.
+ */
+static void wrap_from(chat_message_t *msg, int first, int width_limit) {
+    const char *p = msg->content + (first < msg->line_count ? msg->lines[first].offset : 0);
+
+    msg->line_count = first;
+    if (first == 0) msg->settled_width = 0;
+
+    if (width_limit > 0) wrap_lines(msg, p, width_limit);
+
+    /* Only the last line can still change width */
+    for (int i = first; i < msg->line_count - 1; i++) {
+        if (msg->lines[i].width > msg->settled_width) msg->settled_width = msg->lines[i].width;
+    }
+    msg->max_width = msg->settled_width;
+    if (msg->line_count > 0 && msg->lines[msg->line_count - 1].width > msg->max_width) {
+        msg->max_width = msg->lines[msg->line_count - 1].width;
+    }
+}
+
+/*============================================================================
+ * Damage
+ *============================================================================*/
+
+static void mark_dirty(chat_view_t *view, chat_message_t *msg, int line, int old_height) {
+    if (msg->dirty_line < 0 || line < msg->dirty_line) msg->dirty_line = line;
+    view->total_height += chat_message_height(msg) - old_height;
+    view->pending = 1;
+}
+
+static void free_message(chat_message_t *msg) {
+    free(msg->content);
+    free(msg->lines);
+    memset(msg, 0, sizeof(*msg));
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+void chat_view_init(chat_view_t *view, int fps) {
+    memset(view, 0, sizeof(*view));
+    view->frame_interval_ms = fps > 0 ? 1000 / fps : 0;
+    view->full_redraw = 1;
+}
+
+void chat_view_free(chat_view_t *view) {
+    for (int i = 0; i < view->message_count; i++) {
+        free_message(&view->messages[i]);
+    }
+    view->message_count = 0;
+    view->total_height = 0;
+}
+
+void chat_view_clear(chat_view_t *view) {
+    chat_view_free(view);
+    view->full_redraw = 1;
+    view->pending = 1;
+}
+
+void chat_view_set_width(chat_view_t *view, int wrap_width) {
+    if (wrap_width == view->wrap_width) return;
+
+    view->wrap_width = wrap_width;
+    view->total_height = 0;
+    for (int i = 0; i < view->message_count; i++) {
+        chat_message_t *msg = &view->messages[i];
+        wrap_from(msg, 0, wrap_width);
+        msg->dirty_line = 0;
+        view->total_height += chat_message_height(msg);
+    }
+    view->full_redraw = 1;
+    view->pending = 1;
+}
+
+chat_message_t *chat_view_add(chat_view_t *view, msg_type_t type, const char *content) {
+    if (view->message_count >= CHAT_VIEW_MAX_MESSAGES) {
+        /* Remove oldest message */
+        view->total_height -= chat_message_height(&view->messages[0]);
+        free_message(&view->messages[0]);
+        memmove(&view->messages[0], &view->messages[1],
+                sizeof(chat_message_t) * (CHAT_VIEW_MAX_MESSAGES - 1));
+        view->message_count--;
+        memset(&view->messages[view->message_count], 0, sizeof(chat_message_t));
+        view->full_redraw = 1;
+    }
+
+    chat_message_t *msg = &view->messages[view->message_count];
+    memset(msg, 0, sizeof(*msg));
+    msg->type = type;
+    msg->dirty_line = -1;
+    msg->prev_height = -1;
+    view->message_count++;
+
+    chat_view_set_text(view, msg, content);
+    return msg;
+}
+
+void chat_view_append(chat_view_t *view, chat_message_t *msg, const char *text, int len) {
+    if (!text || len <= 0) return;
+
+    if (msg->content_len + len + 1 > msg->content_cap) {
+        int cap = msg->content_cap ? msg->content_cap : 256;
+        while (msg->content_len + len + 1 > cap) cap *= 2;
+        char *content = realloc(msg->content, cap);
+        if (!content) return;
+        msg->content = content;
+        msg->content_cap = cap;
+    }
+    memcpy(msg->content + msg->content_len, text, len);
+    msg->content_len += len;
+    msg->content[msg->content_len] = '\0';
+
+    /* Re-wrap from the last line: earlier lines cannot change */
+    int old_height = chat_message_height(msg);
+    int first = msg->line_count > 0 ? msg->line_count - 1 : 0;
+    wrap_from(msg, first, view->wrap_width);
+    mark_dirty(view, msg, first, old_height);
+}
+
+void chat_view_set_text(chat_view_t *view, chat_message_t *msg, const char *content) {
+    view->total_height -= chat_message_height(msg);
+    msg->content_len = 0;
+    msg->line_count = 0;
+    msg->max_width = 0;
+    if (msg->content) msg->content[0] = '\0';
+
+    /* Appending to an empty message wraps it from the start */
+    if (content && *content) {
+        chat_view_append(view, msg, content, (int)strlen(content));
+    }
+    msg->dirty_line = 0;
+    view->pending = 1;
+}
+
+int chat_view_frame_due(const chat_view_t *view, uint64_t now_ms) {
+    if (!view->pending) return 0;
+    return now_ms - view->last_frame_ms >= (uint64_t)view->frame_interval_ms;
+}
+
+void chat_view_frame_done(chat_view_t *view, uint64_t now_ms) {
+    for (int i = 0; i < view->message_count; i++) {
+        chat_message_t *msg = &view->messages[i];
+        msg->dirty_line = -1;
+        msg->prev_height = chat_message_height(msg);
+        msg->prev_max_width = msg->max_width;
+    }
+    view->full_redraw = 0;
+    view->pending = 0;
+    view->last_frame_ms = now_ms;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file chat_view.h
+ * @brief Retained message layout for the chat TUI
+ *
+ * Keeps every message word-wrapped for the current bubble width, so a
+ * frame never re-wraps the transcript. Streamed text only re-wraps the
+ * last line of the message it extends. Each message records the first
+ * line changed since the last frame (its dirty region), and the view
+ * limits how often frames are drawn so deltas arriving in between are
+ * coalesced into one repaint.
+ *
+ * Independent of notcurses: the TUI paints from the cached lines.
+ */
+
+#ifndef CHAT_VIEW_H
+#define CHAT_VIEW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+#define CHAT_VIEW_MAX_MESSAGES  100
+#define CHAT_VIEW_DEFAULT_FPS   30
+
+/* Rows around the wrapped text: name label, top/bottom border, spacing */
+#define CHAT_VIEW_CHROME_ROWS   4
+
+/*============================================================================
+ * Messages
+ *============================================================================*/
+
+typedef enum {
+    MSG_USER,
+    MSG_ASSISTANT,
+    MSG_SYSTEM
+} msg_type_t;
+
+typedef struct {
+    int offset;                 /* Byte offset into content */
+    int len;                    /* Length in bytes */
+    int width;                  /* Display width in cells */
+} chat_line_t;
+
+typedef struct {
+    msg_type_t type;
+    char *content;
+    int content_len;
+    int content_cap;
+
+    /* Layout, valid for the view's wrap width */
+    chat_line_t *lines;
+    int line_count;
+    int line_cap;
+    int max_width;              /* Widest line */
+    int settled_width;          /* Widest line before the last one */
+
+    /* Damage since the last frame */
+    int dirty_line;             /* First changed line, -1 = clean */
+    int prev_height;            /* Height when last drawn, -1 = never drawn */
+    int prev_max_width;         /* Widest line when last drawn */
+} chat_message_t;
+
+/*============================================================================
+ * View
+ *============================================================================*/
+
+typedef struct {
+    chat_message_t messages[CHAT_VIEW_MAX_MESSAGES];
+    int message_count;
+
+    int wrap_width;             /* Text columns inside a bubble */
+    int total_height;           /* Rows of all messages */
+    int full_redraw;            /* Positions changed: repaint everything visible */
+
+    /* Frame limiting */
+    int frame_interval_ms;
+    uint64_t last_frame_ms;
+    int pending;                /* Changes not drawn yet */
+} chat_view_t;
+
+/**
+ * @brief Initialize an empty view
+ * @param view View
+ * @param fps  Maximum frames per second (0 = unlimited)
+ */
+void chat_view_init(chat_view_t *view, int fps);
+
+/**
+ * @brief Free all messages
+ */
+void chat_view_free(chat_view_t *view);
+
+/**
+ * @brief Remove all messages
+ */
+void chat_view_clear(chat_view_t *view);
+
+/**
+ * @brief Set the wrap width; re-wraps every message if it changed
+ */
+void chat_view_set_width(chat_view_t *view, int wrap_width);
+
+/**
+ * @brief Add a message, dropping the oldest when full
+ * @return The new message
+ */
+chat_message_t *chat_view_add(chat_view_t *view, msg_type_t type, const char *content);
+
+/**
+ * @brief Append streamed text to a message
+ *
+ * Only the message's last line and the new text are wrapped.
+ */
+void chat_view_append(chat_view_t *view, chat_message_t *msg, const char *text, int len);
+
+/**
+ * @brief Replace a message's text and re-wrap it
+ */
+void chat_view_set_text(chat_view_t *view, chat_message_t *msg, const char *content);
+
+/**
+ * @brief Rows a message occupies, including its chrome
+ */
+static inline int chat_message_height(const chat_message_t *msg) {
+    return msg->line_count > 0 ? msg->line_count + CHAT_VIEW_CHROME_ROWS : 0;
+}
+
+/**
+ * @brief Whether a frame should be drawn now
+ *
+ * True when there are undrawn changes and the frame interval has passed.
+ */
+int chat_view_frame_due(const chat_view_t *view, uint64_t now_ms);
+
+/**
+ * @brief Record that a frame was drawn: clears all damage
+ */
+void chat_view_frame_done(chat_view_t *view, uint64_t now_ms);
+
+/**
+ * @brief Monotonic clock in milliseconds
+ */
+uint64_t chat_view_now_ms(void);
+
+/**
+ * @brief Display width of a UTF-8 string prefix
+ */
+int chat_view_text_width(const char *str, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CHAT_VIEW_H */
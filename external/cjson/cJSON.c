@@ -58,6 +58,10 @@
 
 #include "cJSON.h"
 
+#ifdef CJSON_EXTERNAL_ESCAPE
+#include "arc/json_escape.h"
+#endif
+
 /* define our own boolean type */
 #ifdef true
 #undef true
@@ -945,6 +949,74 @@ fail:
     return false;
 }
 
+#ifdef CJSON_EXTERNAL_ESCAPE
+/* Single-pass escape via ac_json_escape (vectorized, repairs invalid UTF-8).
+ * Output is produced in chunks sized to the unescaped length; the buffer only
+ * grows again when escapes expand the string. */
+static cJSON_bool print_string_external(const unsigned char * const input, printbuffer * const output_buffer)
+{
+    const char *input_pointer = (const char*)input;
+    size_t remaining = strlen((const char*)input);
+    size_t start = output_buffer->offset;
+    unsigned char *output = NULL;
+
+    output = ensure(output_buffer, remaining + sizeof("\"\""));
+    if (output == NULL)
+    {
+        return false;
+    }
+    output[0] = '\"';
+    output_buffer->offset++;
+
+    while (remaining > 0)
+    {
+        size_t consumed = 0;
+        size_t written = 0;
+        size_t room = 0;
+
+        if (output_buffer->noalloc)
+        {
+            output = output_buffer->buffer + output_buffer->offset;
+        }
+        else
+        {
+            output = ensure(output_buffer, remaining + AC_JSON_ESCAPE_MIN_OUT);
+        }
+        if ((output == NULL) || (output_buffer->offset + 1 >= output_buffer->length))
+        {
+            output_buffer->offset = start;
+            return false;
+        }
+        /* keep one byte for the terminator reserved by ensure() */
+        room = output_buffer->length - output_buffer->offset - 1;
+
+        written = ac_json_escape((char*)output, room, input_pointer, remaining, &consumed, NULL);
+        if (consumed == 0)
+        {
+            output_buffer->offset = start;
+            return false;
+        }
+        input_pointer += consumed;
+        remaining -= consumed;
+        output_buffer->offset += written;
+    }
+
+    output = ensure(output_buffer, 1);
+    if (output == NULL)
+    {
+        output_buffer->offset = start;
+        return false;
+    }
+    output[0] = '\"';
+    output[1] = '\0';
+
+    /* callers advance past the string with update_offset() */
+    output_buffer->offset = start;
+
+    return true;
+}
+#endif
+
 /* Render the cstring provided to an escaped version that can be printed. */
 static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffer * const output_buffer)
 {
@@ -973,6 +1045,10 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
         return true;
     }
 
+#ifdef CJSON_EXTERNAL_ESCAPE
+    return print_string_external(input, output_buffer);
+#endif
+
     /* set "flag" to 1 if something needs to be escaped */
     for (input_pointer = input; *input_pointer; input_pointer++)
     {
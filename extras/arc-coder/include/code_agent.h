@@ -47,6 +47,8 @@ typedef struct {
     int safe_mode;              /* Confirm dangerous operations */
     int enable_sandbox;         /* Enable sandbox protection */
     int sandbox_allow_network;  /* Allow network in sandbox */
+    int persistent_shell;       /* Keep one sandboxed shell for bash commands */
+    int search_index;           /* Use the trigram index for workspace greps */
 
     /* System Prompt Selection */
     const char *system_prompt;  /* System prompt name (e.g., "anthropic") */
@@ -86,6 +86,32 @@ AC_TOOL_META const char* edit_file(
     bool replaceAll
 );
 
+/*============================================================================
+ * MultiEdit Tool - Batched String Replacements
+ *============================================================================*/
+
+/**
+ * @description: Apply several exact string replacements in one atomic operation, in order, each on the result of the previous one. Edits may target different files. If any edit fails, no file is changed.
+ * @param: filePath  Absolute path of the file to edit (default for edits without their own filePath)
+ * @param: edits     JSON array of edit objects, each with oldString, newString, optional replaceAll and optional filePath
+ */
+AC_TOOL_META const char* multiedit(
+    const char* filePath,
+    const char* edits
+);
+
+/*============================================================================
+ * Patch Tool - Unified Diffs
+ *============================================================================*/
+
+/**
+ * @description: Apply a unified diff (git diff or diff -u format) to one or more files atomically. Hunks may be slightly off in line numbers or whitespace. /dev/null as source creates a file, as target deletes it. If any hunk fails, no file is changed.
+ * @param: patchText  The full diff text, including --- and +++ file headers
+ */
+AC_TOOL_META const char* patch(
+    const char* patchText
+);
+
 /*============================================================================
  * LS Tool - Directory Listing
  *============================================================================*/
@@ -105,15 +131,17 @@ AC_TOOL_META const char* ls(
  *============================================================================*/
 
 /**
- * @description: Search file contents using regular expressions. Returns matching lines with file paths and line numbers.
- * @param: pattern   Regular expression pattern to search for
- * @param: path      File or directory to search in (defaults to workspace)
- * @param: include   Glob pattern to filter files (optional, e.g. "*.c" or "*.{ts,tsx}")
+ * @description: Search file contents using regular expressions (PCRE syntax). Case-insensitive unless the pattern contains uppercase letters. Returns matching lines with file paths and line numbers; binary files are skipped.
+ * @param: pattern    Regular expression pattern to search for
+ * @param: path       File or directory to search in (defaults to workspace)
+ * @param: include    Glob pattern to filter files (optional, e.g. "*.c" or "*.{ts,tsx}")
+ * @param: multiline  Let matches span lines (optional, defaults to false)
  */
 AC_TOOL_META const char* grep(
     const char* pattern,
     const char* path,
-    const char* include
+    const char* include,
+    bool multiline
 );
 
 /*============================================================================
@@ -121,7 +149,7 @@ AC_TOOL_META const char* grep(
  *============================================================================*/
 
 /**
- * @description: Find files matching a glob pattern. Returns matching file paths sorted by modification time.
+ * @description: Find files matching a glob pattern (supports star-star directories and {a,b} alternatives). Returns matching file paths, most recently modified first.
  * @param: pattern    Glob pattern to match (e.g. star-star-slash-star.ts)
  * @param: path       Directory to search in (optional, defaults to workspace)
  */
@@ -130,6 +158,56 @@ AC_TOOL_META const char* glob_files(
     const char* path
 );
 
+/*============================================================================
+ * Codesearch Tool - Symbol Lookup
+ *============================================================================*/
+
+/**
+ * @description: Find where a function, type, variable or macro is defined and used, from a symbol index of the workspace (C and C++ parsed, Python, JavaScript, TypeScript, Go and Rust scanned). Faster and more precise than grep for identifiers. Returns each occurrence with its kind, enclosing scope and source line.
+ * @param: symbol  Exact identifier to look up (optional when file is given)
+ * @param: kind    definitions, references or all (optional, defaults to all)
+ * @param: file    Only occurrences in this file or directory; without symbol, outline the definitions of this file (optional)
+ */
+AC_TOOL_META const char* codesearch(
+    const char* symbol,
+    const char* kind,
+    const char* file
+);
+
+/*============================================================================
+ * LSP Tool - Language Server Queries
+ *============================================================================*/
+
+/**
+ * @description: Ask the language server of a file (clangd, pyright, typescript-language-server, gopls or rust-analyzer) about the code: goToDefinition, findReferences, hover (type and documentation) or diagnostics (compiler errors and warnings for the file). Servers stay running between calls, so only the first call for a language is slow.
+ * @param: operation  goToDefinition, findReferences, hover or diagnostics
+ * @param: filePath   Absolute path to the file
+ * @param: line       Line number (1-based; not needed for diagnostics)
+ * @param: character  Column on that line (1-based; not needed for diagnostics)
+ */
+AC_TOOL_META const char* lsp(
+    const char* operation,
+    const char* filePath,
+    int line,
+    int character
+);
+
+/*============================================================================
+ * Webfetch Tool - Web Pages
+ *============================================================================*/
+
+/**
+ * @description: Fetch a web page or other text resource and return its content as markdown (default), plain text or the raw html. Scripts, styles and navigation are removed from pages. HTTP URLs are upgraded to HTTPS. Responses are cached on disk and revalidated, so fetching the same URL again is cheap. Content over 100 KB is truncated.
+ * @param: url      Fully-formed http or https URL
+ * @param: format   markdown, text or html (optional, defaults to markdown)
+ * @param: timeout  Timeout in seconds (optional, defaults to 30, at most 120)
+ */
+AC_TOOL_META const char* webfetch(
+    const char* url,
+    const char* format,
+    int timeout
+);
+
 /*============================================================================
  * Configuration (Internal Use - NOT Tool)
  *============================================================================*/
@@ -167,6 +245,66 @@ void code_tools_set_sandbox(struct ac_sandbox *sandbox);
  */
 struct ac_sandbox *code_tools_get_sandbox(void);
 
+/**
+ * @brief Run sandboxed bash commands in one long-lived shell
+ *
+ * Working directory, variables and functions then persist between
+ * commands. Only used while a sandbox is set.
+ *
+ * @param enabled  1 to enable, 0 to run each command in a new shell
+ */
+void code_tools_set_persistent_shell(int enabled);
+
+/**
+ * @brief Narrow workspace greps with a persistent trigram index
+ *
+ * The index is kept under ~/.cache/arc/index and follows edits with
+ * inotify. Searches fall back to a full walk when it cannot help.
+ *
+ * @param enabled  1 to enable, 0 to always walk the tree
+ */
+void code_tools_set_search_index(int enabled);
+
+/**
+ * @brief Save and close the codesearch symbol index
+ *
+ * The index is opened on first use, kept under ~/.cache/arc/index and
+ * follows edits with inotify.
+ */
+void code_tools_close_symbol_index(void);
+
+/**
+ * @brief Shut down the language servers started by the lsp tool
+ */
+void code_tools_close_lsp(void);
+
+/**
+ * @brief Tell the running language servers a file was written
+ *
+ * Called by the edit and write tools; sends the changed range of files
+ * open on a server.
+ */
+void code_tools_lsp_file_changed(const char *path);
+
+/**
+ * @brief Close the HTTP cache opened by the webfetch tool
+ */
+void code_tools_close_webfetch(void);
+
+/* Forward declaration */
+struct ac_textfile_cache;
+
+/**
+ * @brief File contents shared by the read, edit, write and grep tools
+ *
+ * One arc/textfile.h cache per workspace, created on first use. Files
+ * are dropped from it when a tool writes them or inotify reports a
+ * change.
+ *
+ * @return Cache, or NULL if it could not be created
+ */
+struct ac_textfile_cache *code_tools_get_file_cache(void);
+
 #ifdef __cplusplus
 }
 #endif
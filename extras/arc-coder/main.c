@@ -122,6 +122,10 @@ static void print_usage(const char *prog) {
     printf("  --no-sandbox            Disable sandbox protection\n");
     printf("  --no-safe-mode          Disable dangerous command blocking\n");
     printf("  --sandbox-network       Allow network access in sandbox\n");
+    printf("  --persistent-shell      Keep one sandboxed shell across bash commands\n");
+    printf("\n");
+    printf("Search Options:\n");
+    printf("  --search-index          Narrow workspace greps with a trigram index\n");
     printf("\n");
     printf("Output Options:\n");
     printf("  --verbose               Enable verbose output\n");
@@ -230,6 +234,16 @@ static int parse_args(int argc, char **argv,
         config->sandbox_allow_network = 1;
     }
 
+    const char *persistent_str = ac_env_get("PERSISTENT_SHELL", "false");
+    if (persistent_str && (strcmp(persistent_str, "true") == 0 || strcmp(persistent_str, "1") == 0)) {
+        config->persistent_shell = 1;
+    }
+
+    const char *index_str = ac_env_get("SEARCH_INDEX", "false");
+    if (index_str && (strcmp(index_str, "true") == 0 || strcmp(index_str, "1") == 0)) {
+        config->search_index = 1;
+    }
+
     *interactive = 1;  /* Default to interactive mode */
     *task = NULL;
 
@@ -303,6 +317,10 @@ static int parse_args(int argc, char **argv,
             config->safe_mode = 0;
         } else if (strcmp(argv[i], "--sandbox-network") == 0) {
             config->sandbox_allow_network = 1;
+        } else if (strcmp(argv[i], "--persistent-shell") == 0) {
+            config->persistent_shell = 1;
+        } else if (strcmp(argv[i], "--search-index") == 0) {
+            config->search_index = 1;
         } else if (strcmp(argv[i], "--verbose") == 0) {
             config->verbose = 1;
         } else if (strcmp(argv[i], "--quiet") == 0) {
@@ -389,6 +407,7 @@ int main(int argc, char **argv) {
         if (sandbox) {
             ac_sandbox_set_confirm_callback(sandbox, sandbox_confirm_callback, NULL);
             code_tools_set_sandbox(sandbox);
+            code_tools_set_persistent_shell(config.persistent_shell);
 
             if (!config.quiet) {
                 printf("Sandbox: %s (workspace: %s)\n",
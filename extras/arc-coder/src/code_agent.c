@@ -45,6 +45,8 @@ code_agent_config_t code_agent_default_config(void) {
         .safe_mode = 1,
         .enable_sandbox = 1,
         .sandbox_allow_network = 1,  /* Must allow network for LLM API calls */
+        .persistent_shell = 0,
+        .search_index = 0,
         .system_prompt = "anthropic",  /* Default system prompt */
         .verbose = 0,
         .quiet = 0,
@@ -112,6 +114,7 @@ code_agent_t *code_agent_create(const code_agent_config_t *config) {
     /* Configure tools */
     code_tools_set_workspace(agent->config.workspace);
     code_tools_set_safe_mode(agent->config.safe_mode);
+    code_tools_set_search_index(agent->config.search_index);
 
     /* Initialize prompt context for placeholder substitution */
     prompt_context_init(&agent->prompt_ctx, agent->config.workspace);
@@ -156,6 +159,10 @@ void code_agent_destroy(code_agent_t *agent) {
         free(agent->rendered_system_prompt);
     }
 
+    code_tools_set_search_index(0);
+    code_tools_close_symbol_index();
+    code_tools_close_lsp();
+    code_tools_close_webfetch();
     free(agent);
 }
 
@@ -333,9 +340,14 @@ int code_agent_run_interactive(code_agent_t *agent) {
             printf("  read_file      Read file contents\n");
             printf("  write_file     Write/create files\n");
             printf("  edit_file      Edit files (string replacement)\n");
+            printf("  multiedit      Several replacements, applied atomically\n");
+            printf("  patch          Apply a unified diff atomically\n");
             printf("  ls             List directory contents\n");
             printf("  grep           Search file contents\n");
             printf("  glob_files     Find files by pattern\n");
+            printf("  codesearch     Find definitions and uses of a symbol\n");
+            printf("  lsp            Definition, references, hover and diagnostics from a language server\n");
+            printf("  webfetch       Fetch a web page as markdown or text\n");
             printf("\n");
             continue;
         }
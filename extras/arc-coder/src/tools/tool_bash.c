@@ -5,6 +5,7 @@
 
 #include "code_tools.h"
 #include <arc/sandbox.h>
+#include <arc/command_policy.h>
 #include <cJSON.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -19,6 +20,8 @@
 static char g_workspace[4096] = ".";
 static int g_safe_mode = 0;
 static ac_sandbox_t *g_sandbox = NULL;
+static int g_persistent_shell = 0;
+static ac_sandbox_shell_t *g_shell = NULL;     /* Opened on first use */
 
 /*============================================================================
  * Configuration Functions
@@ -40,6 +43,10 @@ void code_tools_set_safe_mode(int enabled) {
 }
 
 void code_tools_set_sandbox(struct ac_sandbox *sandbox) {
+    if (sandbox != g_sandbox) {
+        ac_sandbox_shell_close(g_shell);
+        g_shell = NULL;
+    }
     g_sandbox = sandbox;
 }
 
@@ -47,6 +54,14 @@ struct ac_sandbox *code_tools_get_sandbox(void) {
     return g_sandbox;
 }
 
+void code_tools_set_persistent_shell(int enabled) {
+    g_persistent_shell = enabled;
+    if (!enabled) {
+        ac_sandbox_shell_close(g_shell);
+        g_shell = NULL;
+    }
+}
+
 /*============================================================================
  * Helper Functions
  *============================================================================*/
@@ -84,25 +99,49 @@ static const char *json_error(const char *msg) {
     return json_result(json);
 }
 
-/* Check if command is dangerous */
-static int is_dangerous_command(const char *cmd) {
-    const char *dangerous[] = {
-        "rm -rf /", "rm -fr /", "rm -rf /*", "rm -fr /*",
-        "sudo rm -rf", "sudo rm -fr",
-        "chmod 777 /", "chmod -R 777 /",
-        "> /dev/sda", "> /dev/hda",
-        "mkfs.", "dd if=/dev/zero",
-        ":(){ :|:& };:",  /* Fork bomb */
-        "mv /* ", "mv / ",
-        "chmod 000 /",
-        NULL
-    };
-
-    for (int i = 0; dangerous[i] != NULL; i++) {
-        if (strstr(cmd, dangerous[i]) != NULL) {
-            return 1;
+/* Build "cd -- '<dir>' && <command>" (caller frees) */
+static char *with_workdir(const char *dir, const char *command) {
+    size_t len = strlen("cd -- '' && ") + strlen(command) + 1;
+    for (const char *p = dir; *p; p++) len += *p == '\'' ? 4 : 1;
+
+    char *out = malloc(len);
+    if (!out) return NULL;
+
+    char *q = out;
+    q += sprintf(q, "cd -- '");
+    for (const char *p = dir; *p; p++) {
+        if (*p == '\'') {
+            memcpy(q, "'\\''", 4);
+            q += 4;
+        } else {
+            *q++ = *p;
         }
     }
+    sprintf(q, "' && %s", command);
+    return out;
+}
+
+/*
+ * Check if command is dangerous. Uses the sandbox's command policy, so
+ * quoting, wrappers and nested shells are seen through. With a sandbox,
+ * only commands the policy denies outright are blocked here; the sandbox
+ * asks before running the ones that need confirmation. Without one
+ * (plain popen) nobody would ask, so those are blocked too.
+ */
+static int is_dangerous_command(const char *cmd, const char **reason) {
+    ac_cmd_verdict_t verdict;
+    const ac_cmd_policy_t *policy = ac_cmd_policy_default();
+
+    *reason = NULL;
+    if (!policy || ac_cmd_policy_eval(policy, cmd, &verdict) != ARC_OK) {
+        *reason = "command policy unavailable";
+        return 1;
+    }
+    ac_cmd_action_t blocked = g_sandbox ? AC_CMD_DENY : AC_CMD_CONFIRM;
+    if (verdict.action >= blocked) {
+        *reason = verdict.reason;
+        return 1;
+    }
     return 0;
 }
 
@@ -125,12 +164,17 @@ const char *bash(
     int timeout_ms = timeout > 0 ? timeout : 120000;
 
     /* Safety check */
-    if (g_safe_mode && is_dangerous_command(command)) {
+    const char *reason = NULL;
+    if (g_safe_mode && is_dangerous_command(command, &reason)) {
         cJSON *json = cJSON_CreateObject();
         cJSON_AddStringToObject(json, "error", "Dangerous command blocked in safe mode");
         cJSON_AddStringToObject(json, "command", command);
+        if (reason) {
+            cJSON_AddStringToObject(json, "reason", reason);
+        }
         cJSON_AddStringToObject(json, "hint",
-            "This command was blocked because it matches a dangerous pattern. "
+            "This command was blocked because the command policy denies it, "
+            "or asks for confirmation and no sandbox is active to ask. "
             "Disable safe mode if you need to run this command.");
         return json_result(json);
     }
@@ -147,7 +191,28 @@ const char *bash(
         }
         result[0] = '\0';
 
-        arc_err_t err = ac_sandbox_exec(g_sandbox, command, result, result_cap, &exit_code);
+        /* An explicit workdir is entered with cd; a persistent shell stays there */
+        char *framed = NULL;
+        if (workdir && strlen(workdir) > 0) {
+            framed = with_workdir(workdir, command);
+            if (!framed) {
+                free(result);
+                return json_error("Memory allocation failed");
+            }
+        }
+        const char *run = framed ? framed : command;
+
+        arc_err_t err;
+        if (g_persistent_shell && !g_shell) {
+            g_shell = ac_sandbox_shell_open(g_sandbox, g_workspace);
+        }
+        if (g_persistent_shell && g_shell) {
+            ac_sandbox_exec_options_t options = { .timeout_ms = timeout_ms };
+            err = ac_sandbox_shell_exec(g_shell, run, result, result_cap, &exit_code, &options);
+        } else {
+            err = ac_sandbox_exec_timeout(g_sandbox, run, result, result_cap, &exit_code, timeout_ms);
+        }
+        free(framed);
 
         if (err == ARC_ERR_INVALID_ARG) {
             cJSON *json = cJSON_CreateObject();
@@ -161,6 +226,11 @@ const char *bash(
             cJSON_AddStringToObject(json, "error", "Command timed out");
             cJSON_AddStringToObject(json, "command", command);
             cJSON_AddNumberToObject(json, "timeout_ms", timeout_ms);
+            cJSON_AddStringToObject(json, "output", result);
+            if (g_persistent_shell && g_shell) {
+                cJSON_AddStringToObject(json, "note",
+                    "The shell was restarted; variables and functions were reset");
+            }
             free(result);
             return json_result(json);
         } else if (err != ARC_OK) {
@@ -223,6 +293,9 @@ const char *bash(
     cJSON_AddStringToObject(json, "command", command);
     cJSON_AddNumberToObject(json, "exit_code", exit_code);
     cJSON_AddStringToObject(json, "output", result);
+    if (g_sandbox && g_shell) {
+        cJSON_AddStringToObject(json, "cwd", ac_sandbox_shell_cwd(g_shell));
+    }
     if (description && strlen(description) > 0) {
         cJSON_AddStringToObject(json, "description", description);
     }
@@ -0,0 +1,340 @@
+/**
+ * @file tool_codesearch.c
+ * @brief Codesearch Tool Implementation
+ *
+ * Symbol lookup over the workspace with arc/symbol_index.h: where a name
+ * is defined, declared and used, or the outline of one file. The index
+ * is opened on first use and follows edits with inotify. Source lines
+ * come from the shared file cache when the read tool holds the file.
+ */
+
+#include "code_tools.h"
+#include <arc/sandbox.h>
+#include <arc/symbol_index.h>
+#include <arc/textfile.h>
+#include <cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * External State
+ *============================================================================*/
+
+extern const char *code_tools_get_workspace(void);
+extern struct ac_sandbox *code_tools_get_sandbox(void);
+
+static ac_symbol_index_t *g_symbols = NULL;    /* Opened on first use */
+static char g_symbols_workspace[4096];          /* Workspace g_symbols was opened for */
+static int g_symbols_failed = 0;                /* Don't retry a failed open */
+
+/* Skipped as by the grep tool */
+static const char *const g_skip_dirs[] = { "node_modules/", "__pycache__/" };
+
+#define MAX_SYMBOLS 100
+
+/*============================================================================
+ * Helper Functions
+ *============================================================================*/
+
+static char *g_codesearch_result = NULL;
+
+static const char *json_result_codesearch(cJSON *json) {
+    if (!json) {
+        return "{\"error\": \"Failed to create response\"}";
+    }
+
+    char *str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+
+    if (!str) {
+        return "{\"error\": \"Failed to serialize response\"}";
+    }
+
+    free(g_codesearch_result);
+    g_codesearch_result = str;
+    return g_codesearch_result;
+}
+
+static const char *json_error_codesearch(const char *msg) {
+    cJSON *json = cJSON_CreateObject();
+    if (json) {
+        cJSON_AddStringToObject(json, "error", msg);
+    }
+    return json_result_codesearch(json);
+}
+
+/*============================================================================
+ * Symbol Index
+ *============================================================================*/
+
+void code_tools_close_symbol_index(void) {
+    ac_symbol_index_close(g_symbols);
+    g_symbols = NULL;
+    g_symbols_failed = 0;
+}
+
+/* Index of the current workspace, or NULL */
+static ac_symbol_index_t *workspace_symbols(void) {
+    const char *workspace = code_tools_get_workspace();
+    if (g_symbols && strcmp(g_symbols_workspace, workspace) != 0) {
+        code_tools_close_symbol_index();
+    }
+    if (g_symbols || g_symbols_failed) return g_symbols;
+
+    ac_symbol_index_options_t options = {
+        .watch = 1,
+        .ignore_globs = g_skip_dirs,
+        .ignore_globs_count = sizeof(g_skip_dirs) / sizeof(g_skip_dirs[0]),
+    };
+    if (ac_symbol_index_open(workspace, &options, &g_symbols) != ARC_OK) {
+        g_symbols = NULL;
+        g_symbols_failed = 1;
+        return NULL;
+    }
+    snprintf(g_symbols_workspace, sizeof(g_symbols_workspace), "%s", workspace);
+    return g_symbols;
+}
+
+/*
+ * The file parameter relative to the index root: absolute paths inside
+ * the workspace lose their prefix, "./" and trailing slashes are dropped.
+ * Returns 0 for a path outside the workspace.
+ */
+static int relative_path(const ac_symbol_index_t *index, const char *file, char *out, size_t size) {
+    const char *workspace = code_tools_get_workspace();
+    const char *roots[] = { ac_symbol_index_root(index), workspace };
+
+    if (file[0] == '/') {
+        const char *rest = NULL;
+        for (size_t i = 0; i < 2 && !rest; i++) {
+            size_t len = strlen(roots[i]);
+            while (len > 1 && roots[i][len - 1] == '/') len--;
+            if (strncmp(file, roots[i], len) == 0 && (file[len] == '/' || file[len] == '\0')) {
+                rest = file + len;
+            }
+        }
+        if (!rest) return 0;
+        file = rest;
+    }
+    while (file[0] == '/' || (file[0] == '.' && file[1] == '/')) file += file[0] == '/' ? 1 : 2;
+    if (strcmp(file, ".") == 0) file = "";
+
+    size_t len = strlen(file);
+    while (len > 0 && file[len - 1] == '/') len--;
+    if (len >= size) return 0;
+    memcpy(out, file, len);
+    out[len] = '\0';
+    return 1;
+}
+
+/* path is prefix itself or lies under it ("" matches everything) */
+static int under_prefix(const char *path, const char *prefix) {
+    size_t len = strlen(prefix);
+    if (len == 0) return 1;
+    return strncmp(path, prefix, len) == 0 && (path[len] == '\0' || path[len] == '/');
+}
+
+/* Source line of one symbol; keeps the last file open across calls */
+typedef struct {
+    char path[4096];
+    ac_textfile_t *file;
+} line_reader_t;
+
+static void add_line_text(line_reader_t *r, const char *full_path, unsigned line, cJSON *item) {
+    if (!r->file || strcmp(r->path, full_path) != 0) {
+        ac_textfile_release(r->file);
+        r->file = NULL;
+        snprintf(r->path, sizeof(r->path), "%s", full_path);
+        /* Cached if the read tool has it; otherwise mapped without filling the cache */
+        if (ac_textfile_peek(code_tools_get_file_cache(), full_path, &r->file) != ARC_OK &&
+            ac_textfile_open(NULL, full_path, &r->file) != ARC_OK) {
+            r->file = NULL;
+            return;
+        }
+    }
+
+    size_t len;
+    const char *text = ac_textfile_line(r->file, line - 1, &len);
+    if (!text) return;
+    while (len > 0 && (*text == ' ' || *text == '\t')) {
+        text++;
+        len--;
+    }
+
+    char buf[256];
+    if (len > 200) {
+        snprintf(buf, sizeof(buf), "%.200s...", text);
+    } else {
+        memcpy(buf, text, len);
+        buf[len] = '\0';
+    }
+    cJSON_AddStringToObject(item, "text", buf);
+}
+
+static const char *role_name(int role) {
+    switch (role) {
+        case AC_SYMBOL_DEFINITION:  return "definition";
+        case AC_SYMBOL_DECLARATION: return "declaration";
+        default:                    return "reference";
+    }
+}
+
+/* Appends up to MAX_SYMBOLS symbols under prefix; returns how many matched */
+static size_t add_symbols(
+    cJSON *array,
+    const ac_symbol_index_t *index,
+    const ac_symbol_result_t *result,
+    const char *prefix,
+    int with_name
+) {
+    line_reader_t reader = { .file = NULL };
+    size_t matched = 0;
+
+    for (size_t i = 0; i < result->count; i++) {
+        const ac_symbol_t *s = &result->symbols[i];
+        if (!under_prefix(s->path, prefix)) continue;
+        if (matched++ >= MAX_SYMBOLS) continue;
+
+        char full_path[4096];
+        snprintf(full_path, sizeof(full_path), "%s/%s", ac_symbol_index_root(index), s->path);
+
+        cJSON *item = cJSON_CreateObject();
+        if (with_name) cJSON_AddStringToObject(item, "name", s->name);
+        cJSON_AddStringToObject(item, "file", full_path);
+        cJSON_AddNumberToObject(item, "line", s->line);
+        cJSON_AddNumberToObject(item, "column", s->column);
+        cJSON_AddStringToObject(item, "kind", ac_symbol_kind_name(s->kind));
+        cJSON_AddStringToObject(item, "role", role_name(s->role));
+        if (s->scope[0]) cJSON_AddStringToObject(item, "scope", s->scope);
+        add_line_text(&reader, full_path, s->line, item);
+        cJSON_AddItemToArray(array, item);
+    }
+    ac_textfile_release(reader.file);
+    return matched;
+}
+
+/*============================================================================
+ * Codesearch Tool Implementation
+ *============================================================================*/
+
+static const char *outline_file(ac_symbol_index_t *index, const char *file, const char *rel) {
+    ac_symbol_result_t result;
+    arc_err_t err = ac_symbol_index_file_symbols(index, rel, &result);
+    if (err == ARC_ERR_NOT_FOUND) {
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "error", "File is not indexed");
+        cJSON_AddStringToObject(json, "file", file);
+        cJSON_AddStringToObject(json, "hint",
+            "Only C, C++, Python, JavaScript, TypeScript, Go and Rust files are indexed; use read or grep");
+        return json_result_codesearch(json);
+    }
+    if (err != ARC_OK) {
+        return json_error_codesearch("Symbol lookup failed");
+    }
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "file", file);
+    cJSON *symbols = cJSON_AddArrayToObject(json, "symbols");
+    size_t count = add_symbols(symbols, index, &result, "", 1);
+    cJSON_AddNumberToObject(json, "count", (double)count);
+    if (count > MAX_SYMBOLS) {
+        cJSON_AddBoolToObject(json, "truncated", 1);
+    }
+    ac_symbol_result_free(&result);
+    return json_result_codesearch(json);
+}
+
+const char *codesearch(
+    const char *symbol,
+    const char *kind,
+    const char *file
+) {
+    int has_symbol = symbol && strlen(symbol) > 0;
+    int has_file = file && strlen(file) > 0;
+    if (!has_symbol && !has_file) {
+        return json_error_codesearch("symbol or file parameter is required");
+    }
+
+    int roles = AC_SYMBOL_ALL;
+    if (kind && strlen(kind) > 0) {
+        if (strcmp(kind, "definitions") == 0 || strcmp(kind, "definition") == 0) {
+            roles = AC_SYMBOL_DEFINITION | AC_SYMBOL_DECLARATION;
+        } else if (strcmp(kind, "references") == 0 || strcmp(kind, "reference") == 0) {
+            roles = AC_SYMBOL_REFERENCE;
+        } else if (strcmp(kind, "all") != 0) {
+            return json_error_codesearch("kind must be definitions, references or all");
+        }
+    }
+
+    /* Sandbox check: the index reads the whole workspace */
+    const char *workspace = code_tools_get_workspace();
+    ac_sandbox_t *sandbox = code_tools_get_sandbox();
+    if (sandbox) {
+        const char *checked = has_file ? file : workspace;
+        if (!ac_sandbox_check_path(sandbox, checked, AC_SANDBOX_PERM_FS_READ)) {
+            cJSON *json = cJSON_CreateObject();
+            cJSON_AddStringToObject(json, "error", "Search path blocked by sandbox");
+            cJSON_AddStringToObject(json, "path", checked);
+            cJSON_AddStringToObject(json, "reason", ac_sandbox_denial_reason());
+            return json_result_codesearch(json);
+        }
+    }
+
+    ac_symbol_index_t *index = workspace_symbols();
+    if (!index) {
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "error", "Symbol index unavailable");
+        cJSON_AddStringToObject(json, "hint", "Use grep to search for the name instead");
+        return json_result_codesearch(json);
+    }
+
+    char rel[4096] = "";
+    if (has_file && !relative_path(index, file, rel, sizeof(rel))) {
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "error", "File is outside the workspace");
+        cJSON_AddStringToObject(json, "file", file);
+        cJSON_AddStringToObject(json, "workspace", workspace);
+        return json_result_codesearch(json);
+    }
+
+    if (!has_symbol) {
+        return outline_file(index, file, rel);
+    }
+
+    /* With a file filter the limit applies after filtering */
+    size_t limit = rel[0] ? 0 : MAX_SYMBOLS;
+    ac_symbol_result_t result;
+    int ignore_case = 0;
+    if (ac_symbol_index_find(index, symbol, roles, limit, &result) != ARC_OK) {
+        return json_error_codesearch("Symbol lookup failed");
+    }
+    if (result.total == 0) {
+        /* Nothing under this spelling: try other cases before giving up */
+        ac_symbol_result_free(&result);
+        ignore_case = 1;
+        if (ac_symbol_index_find(index, symbol, roles | AC_SYMBOL_IGNORE_CASE, limit, &result) != ARC_OK) {
+            return json_error_codesearch("Symbol lookup failed");
+        }
+    }
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "symbol", symbol);
+    if (has_file) cJSON_AddStringToObject(json, "file", file);
+    if (ignore_case && result.total > 0) cJSON_AddBoolToObject(json, "ignore_case", 1);
+    cJSON *matches = cJSON_AddArrayToObject(json, "matches");
+    size_t total = add_symbols(matches, index, &result, rel, ignore_case);
+    if (!rel[0]) total = result.total;
+    cJSON_AddNumberToObject(json, "match_count", (double)total);
+    if (total > MAX_SYMBOLS) {
+        cJSON_AddBoolToObject(json, "truncated", 1);
+        cJSON_AddStringToObject(json, "note",
+            "Results truncated at 100 matches; narrow with kind or file");
+    }
+    if (total == 0) {
+        cJSON_AddStringToObject(json, "hint",
+            "The name does not occur in indexed C, C++, Python, JavaScript, TypeScript, Go or Rust files; try grep");
+    }
+    ac_symbol_result_free(&result);
+    return json_result_codesearch(json);
+}
@@ -1,11 +1,14 @@
 /**
  * @file tool_edit.c
- * @brief Edit Tool Implementation
+ * @brief Edit, MultiEdit and Patch Tool Implementation
  *
- * Implements string replacement editing following opencode's approach.
+ * String replacements follow opencode's approach. All three tools stage
+ * their changes with arc/patch.h and commit them at once: files are
+ * replaced by rename, and a call that fails anywhere writes nothing.
  */
 
 #include "code_tools.h"
+#include <arc/patch.h>
 #include <arc/sandbox.h>
 #include <cJSON.h>
 #include <stdio.h>
@@ -23,7 +26,7 @@ extern struct ac_sandbox *code_tools_get_sandbox(void);
  * Helper Functions
  *============================================================================*/
 
-static char g_edit_result_buffer[8192];
+static char *g_edit_result = NULL;
 
 static const char *json_result_edit(cJSON *json) {
     if (!json) {
@@ -37,15 +40,9 @@ static const char *json_result_edit(cJSON *json) {
         return "{\"error\": \"Failed to serialize response\"}";
     }
 
-    size_t len = strlen(str);
-    if (len >= sizeof(g_edit_result_buffer)) {
-        len = sizeof(g_edit_result_buffer) - 1;
-    }
-    memcpy(g_edit_result_buffer, str, len);
-    g_edit_result_buffer[len] = '\0';
-
-    free(str);
-    return g_edit_result_buffer;
+    free(g_edit_result);
+    g_edit_result = str;
+    return g_edit_result;
 }
 
 static const char *json_error_edit(const char *msg) {
@@ -56,76 +53,121 @@ static const char *json_error_edit(const char *msg) {
     return json_result_edit(json);
 }
 
-/* Count occurrences of a substring */
-static int count_occurrences(const char *haystack, const char *needle) {
-    int count = 0;
-    size_t needle_len = strlen(needle);
+/* Sandbox write check made as each file is staged, before it is read */
+typedef struct {
+    ac_sandbox_t *sandbox;
+    char *blocked;                      /* First path refused */
+} sandbox_gate_t;
+
+static int gate_path(const char *path, void *user_data) {
+    sandbox_gate_t *gate = (sandbox_gate_t *)user_data;
+    if (ac_sandbox_check_path(gate->sandbox, path, AC_SANDBOX_PERM_FS_WRITE)) return 1;
+    if (!gate->blocked) gate->blocked = strdup(path);
+    return 0;
+}
 
-    if (needle_len == 0) return 0;
+/* Response for a path the gate refused */
+static const char *gate_blocked(sandbox_gate_t *gate) {
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "error", "File edit blocked by sandbox");
+    cJSON_AddStringToObject(json, "path", gate->blocked);
+    cJSON_AddStringToObject(json, "reason", ac_sandbox_denial_reason());
+    free(gate->blocked);
+    gate->blocked = NULL;
+    return json_result_edit(json);
+}
 
-    const char *p = haystack;
-    while ((p = strstr(p, needle)) != NULL) {
-        count++;
-        p += needle_len;
+/* Reads through the shared file cache, which drops what the commit writes */
+static ac_patch_t *patch_for_workspace(sandbox_gate_t *gate) {
+    const char *workspace = code_tools_get_workspace();
+    ac_patch_t *patch = ac_patch_create(workspace && workspace[0] ? workspace : NULL);
+    if (!patch) return NULL;
+    ac_patch_set_file_cache(patch, code_tools_get_file_cache());
+    if (gate) {
+        gate->sandbox = code_tools_get_sandbox();
+        gate->blocked = NULL;
+        if (gate->sandbox) ac_patch_set_path_check(patch, gate_path, gate);
     }
-
-    return count;
+    return patch;
 }
 
-/* Replace first occurrence */
-static char *replace_first(const char *content, const char *old_str, const char *new_str) {
-    const char *pos = strstr(content, old_str);
-    if (!pos) return NULL;
-
-    size_t content_len = strlen(content);
-    size_t old_len = strlen(old_str);
-    size_t new_len = strlen(new_str);
-    size_t result_len = content_len - old_len + new_len;
-
-    char *result = malloc(result_len + 1);
-    if (!result) return NULL;
-
-    /* Copy prefix */
-    size_t prefix_len = pos - content;
-    memcpy(result, content, prefix_len);
+/* Sandbox check for every staged file; returns an error response or NULL */
+static const char *check_sandbox(ac_patch_t *patch) {
+    ac_sandbox_t *sandbox = code_tools_get_sandbox();
+    if (!sandbox) return NULL;
+
+    for (size_t i = 0; i < ac_patch_file_count(patch); i++) {
+        ac_patch_file_info_t info;
+        ac_patch_file_info(patch, i, &info);
+        int perm = info.created ? AC_SANDBOX_PERM_FS_CREATE
+                 : info.deleted ? AC_SANDBOX_PERM_FS_DELETE
+                 : AC_SANDBOX_PERM_FS_WRITE;
+        if (!ac_sandbox_check_path(sandbox, info.path, perm)) {
+            cJSON *json = cJSON_CreateObject();
+            cJSON_AddStringToObject(json, "error", "File edit blocked by sandbox");
+            cJSON_AddStringToObject(json, "path", info.path);
+            cJSON_AddStringToObject(json, "reason", ac_sandbox_denial_reason());
+            return json_result_edit(json);
+        }
+    }
+    return NULL;
+}
 
-    /* Copy replacement */
-    memcpy(result + prefix_len, new_str, new_len);
+/* Commit and describe every file; frees the patch */
+static const char *commit_patch(ac_patch_t *patch, int with_hunks) {
+    const char *blocked = check_sandbox(patch);
+    if (blocked) {
+        ac_patch_free(patch);
+        return blocked;
+    }
 
-    /* Copy suffix */
-    memcpy(result + prefix_len + new_len, pos + old_len, content_len - prefix_len - old_len + 1);
+    arc_err_t err = ac_patch_commit(patch);
+    if (err != ARC_OK) {
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "error", ac_patch_error(patch));
+        if (err == ARC_ERR_INVALID_STATE) {
+            cJSON_AddStringToObject(json, "hint", "Read the file again and redo the edit");
+        }
+        ac_patch_free(patch);
+        return json_result_edit(json);
+    }
 
-    return result;
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(json, "success", 1);
+    cJSON *files = cJSON_AddArrayToObject(json, "files");
+    for (size_t i = 0; i < ac_patch_file_count(patch); i++) {
+        ac_patch_file_info_t info;
+        ac_patch_file_info(patch, i, &info);
+        cJSON *f = cJSON_CreateObject();
+        cJSON_AddStringToObject(f, "path", info.path);
+        code_tools_lsp_file_changed(info.path);
+        if (info.created) cJSON_AddBoolToObject(f, "created", 1);
+        if (info.deleted) cJSON_AddBoolToObject(f, "deleted", 1);
+        cJSON_AddNumberToObject(f, with_hunks ? "hunks" : "edits", (double)info.changes);
+        if (info.fuzzy) cJSON_AddNumberToObject(f, "fuzzy", (double)info.fuzzy);
+        cJSON_AddNumberToObject(f, "lines_removed", (double)info.lines_removed);
+        cJSON_AddNumberToObject(f, "lines_added", (double)info.lines_added);
+        cJSON_AddItemToArray(files, f);
+    }
+    ac_patch_free(patch);
+    return json_result_edit(json);
 }
 
-/* Replace all occurrences */
-static char *replace_all(const char *content, const char *old_str, const char *new_str) {
-    int count = count_occurrences(content, old_str);
-    if (count == 0) return NULL;
-
-    size_t content_len = strlen(content);
-    size_t old_len = strlen(old_str);
-    size_t new_len = strlen(new_str);
-    size_t result_len = content_len + count * ((int)new_len - (int)old_len);
-
-    char *result = malloc(result_len + 1);
-    if (!result) return NULL;
-
-    char *dst = result;
-    const char *src = content;
-
-    while (*src) {
-        if (strncmp(src, old_str, old_len) == 0) {
-            memcpy(dst, new_str, new_len);
-            dst += new_len;
-            src += old_len;
-        } else {
-            *dst++ = *src++;
-        }
+static const char *replace_error(ac_patch_t *patch, arc_err_t err, const char *path, int index) {
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "error", ac_patch_error(patch));
+    cJSON_AddStringToObject(json, "path", path);
+    if (index >= 0) cJSON_AddNumberToObject(json, "edit", index);
+    if (err == ARC_ERR_NOT_FOUND && strstr(ac_patch_error(patch), "oldString")) {
+        cJSON_AddStringToObject(json, "hint",
+            "Make sure the oldString exactly matches the content including whitespace and indentation");
+    } else if (err == ARC_ERR_INVALID_ARG && strstr(ac_patch_error(patch), "times")) {
+        cJSON_AddStringToObject(json, "hint",
+            "Include more surrounding lines in oldString to uniquely identify the match, "
+            "or set replaceAll=true to replace all occurrences");
     }
-    *dst = '\0';
-
-    return result;
+    ac_patch_free(patch);
+    return json_result_edit(json);
 }
 
 /*============================================================================
@@ -154,7 +196,7 @@ const char *edit_file(
         return json_error_edit("oldString and newString must be different");
     }
 
-    /* Sandbox check */
+    /* Sandbox check before the file is read */
     ac_sandbox_t *sandbox = code_tools_get_sandbox();
     if (sandbox) {
         if (!ac_sandbox_check_path(sandbox, filePath, AC_SANDBOX_PERM_FS_WRITE)) {
@@ -166,103 +208,140 @@ const char *edit_file(
         }
     }
 
-    /* Read file */
-    FILE *fp = fopen(filePath, "r");
-    if (!fp) {
-        cJSON *json = cJSON_CreateObject();
-        cJSON_AddStringToObject(json, "error", "File not found");
-        cJSON_AddStringToObject(json, "path", filePath);
-        return json_result_edit(json);
+    ac_patch_t *patch = patch_for_workspace(NULL);
+    if (!patch) {
+        return json_error_edit("Memory allocation failed");
     }
 
-    fseek(fp, 0, SEEK_END);
-    long file_size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
-
-    char *content = malloc(file_size + 1);
-    if (!content) {
-        fclose(fp);
-        return json_error_edit("Memory allocation failed");
+    size_t replacements = 0;
+    arc_err_t err = ac_patch_replace(patch, filePath, oldString, newString, replaceAll, &replacements);
+    if (err != ARC_OK) {
+        return replace_error(patch, err, filePath, -1);
     }
 
-    size_t read_size = fread(content, 1, file_size, fp);
-    content[read_size] = '\0';
-    fclose(fp);
+    const char *blocked = check_sandbox(patch);
+    if (blocked) {
+        ac_patch_free(patch);
+        return blocked;
+    }
 
-    /* Count occurrences */
-    int occurrences = count_occurrences(content, oldString);
+    ac_patch_file_info_t info;
+    ac_patch_file_info(patch, 0, &info);
+    size_t removed = info.lines_removed, added = info.lines_added;
 
-    if (occurrences == 0) {
-        free(content);
-        cJSON *json = cJSON_CreateObject();
-        cJSON_AddStringToObject(json, "error", "oldString not found in file");
-        cJSON_AddStringToObject(json, "path", filePath);
-        cJSON_AddStringToObject(json, "hint",
-            "Make sure the oldString exactly matches the content including whitespace and indentation");
-        return json_result_edit(json);
+    if (ac_patch_commit(patch) != ARC_OK) {
+        const char *result = json_error_edit(ac_patch_error(patch));
+        ac_patch_free(patch);
+        return result;
     }
+    code_tools_lsp_file_changed(info.path);
+    ac_patch_free(patch);
 
-    /* Check for multiple occurrences without replaceAll */
-    if (occurrences > 1 && !replaceAll) {
-        free(content);
-        cJSON *json = cJSON_CreateObject();
-        cJSON_AddStringToObject(json, "error",
-            "oldString found multiple times - provide more context or use replaceAll");
-        cJSON_AddStringToObject(json, "path", filePath);
-        cJSON_AddNumberToObject(json, "occurrences", occurrences);
-        cJSON_AddStringToObject(json, "hint",
-            "Include more surrounding lines in oldString to uniquely identify the match, "
-            "or set replaceAll=true to replace all occurrences");
-        return json_result_edit(json);
-    }
+    /* Build response */
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(json, "success", 1);
+    cJSON_AddStringToObject(json, "path", filePath);
+    cJSON_AddNumberToObject(json, "replacements", (double)replacements);
+    cJSON_AddNumberToObject(json, "lines_removed", (double)removed);
+    cJSON_AddNumberToObject(json, "lines_added", (double)added);
 
-    /* Perform replacement */
-    char *new_content;
-    int replacements;
+    return json_result_edit(json);
+}
 
-    if (replaceAll) {
-        new_content = replace_all(content, oldString, newString);
-        replacements = occurrences;
-    } else {
-        new_content = replace_first(content, oldString, newString);
-        replacements = 1;
-    }
+/*============================================================================
+ * MultiEdit Tool Implementation
+ *============================================================================*/
 
-    free(content);
+const char *multiedit(
+    const char *filePath,
+    const char *edits
+) {
+    if (!edits || strlen(edits) == 0) {
+        return json_error_edit("edits parameter is required");
+    }
 
-    if (!new_content) {
-        return json_error_edit("Failed to perform replacement");
+    cJSON *list = cJSON_Parse(edits);
+    if (!cJSON_IsArray(list) || cJSON_GetArraySize(list) == 0) {
+        cJSON_Delete(list);
+        return json_error_edit("edits must be a non-empty JSON array of {oldString, newString} objects");
     }
 
-    /* Write back */
-    fp = fopen(filePath, "w");
-    if (!fp) {
-        free(new_content);
-        return json_error_edit("Failed to open file for writing");
+    /* Sandbox check for each file as it is staged, before it is read */
+    sandbox_gate_t gate;
+    ac_patch_t *patch = patch_for_workspace(&gate);
+    if (!patch) {
+        cJSON_Delete(list);
+        return json_error_edit("Memory allocation failed");
     }
 
-    size_t new_len = strlen(new_content);
-    size_t written = fwrite(new_content, 1, new_len, fp);
-    fclose(fp);
-    free(new_content);
+    /* Each edit applies to the result of the previous ones */
+    int index = 0;
+    cJSON *edit;
+    cJSON_ArrayForEach(edit, list) {
+        const char *path = cJSON_GetStringValue(cJSON_GetObjectItem(edit, "filePath"));
+        const char *old_str = cJSON_GetStringValue(cJSON_GetObjectItem(edit, "oldString"));
+        const char *new_str = cJSON_GetStringValue(cJSON_GetObjectItem(edit, "newString"));
+        int all = cJSON_IsTrue(cJSON_GetObjectItem(edit, "replaceAll"));
+        if (!path || !path[0]) path = filePath;
+
+        if (!path || !path[0] || !old_str || !new_str) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "edit %d needs filePath, oldString and newString", index);
+            cJSON_Delete(list);
+            ac_patch_free(patch);
+            return json_error_edit(msg);
+        }
 
-    if (written != new_len) {
-        return json_error_edit("Failed to write complete content");
+        arc_err_t err = ac_patch_replace(patch, path, old_str, new_str, all, NULL);
+        if (err != ARC_OK) {
+            const char *result;
+            if (gate.blocked) {
+                ac_patch_free(patch);
+                result = gate_blocked(&gate);
+            } else {
+                result = replace_error(patch, err, path, index);
+            }
+            cJSON_Delete(list);
+            return result;
+        }
+        index++;
     }
+    cJSON_Delete(list);
 
-    /* Build response */
-    cJSON *json = cJSON_CreateObject();
-    cJSON_AddBoolToObject(json, "success", 1);
-    cJSON_AddStringToObject(json, "path", filePath);
-    cJSON_AddNumberToObject(json, "replacements", replacements);
+    return commit_patch(patch, 0);
+}
 
-    /* Show brief diff info */
-    int old_lines = 1, new_lines = 1;
-    for (const char *p = oldString; *p; p++) if (*p == '\n') old_lines++;
-    for (const char *p = newString; *p; p++) if (*p == '\n') new_lines++;
+/*============================================================================
+ * Patch Tool Implementation
+ *============================================================================*/
 
-    cJSON_AddNumberToObject(json, "lines_removed", old_lines);
-    cJSON_AddNumberToObject(json, "lines_added", new_lines);
+const char *patch(const char *patchText) {
+    if (!patchText || strlen(patchText) == 0) {
+        return json_error_edit("patchText parameter is required");
+    }
 
-    return json_result_edit(json);
+    /* Covers the ---/+++ paths of every file, before any is read */
+    sandbox_gate_t gate;
+    ac_patch_t *p = patch_for_workspace(&gate);
+    if (!p) {
+        return json_error_edit("Memory allocation failed");
+    }
+
+    arc_err_t err = ac_patch_apply_diff(p, patchText);
+    if (err != ARC_OK && gate.blocked) {
+        ac_patch_free(p);
+        return gate_blocked(&gate);
+    }
+    if (err != ARC_OK) {
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "error", ac_patch_error(p));
+        if (err == ARC_ERR_NOT_FOUND) {
+            cJSON_AddStringToObject(json, "hint",
+                "Read the file again; context and removed lines must match its current contents");
+        }
+        ac_patch_free(p);
+        return json_result_edit(json);
+    }
+
+    return commit_patch(p, 1);
 }
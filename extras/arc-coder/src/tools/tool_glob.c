@@ -0,0 +1,149 @@
+/**
+ * @file tool_glob.c
+ * @brief Glob Tool Implementation
+ *
+ * File pattern matching with compiled globs ("**", braces, classes);
+ * see arc/glob.h. Directories the pattern cannot match are not read,
+ * and results come back newest first.
+ */
+
+#include "code_tools.h"
+#include <arc/glob.h>
+#include <arc/sandbox.h>
+#include <cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * External State
+ *============================================================================*/
+
+extern const char *code_tools_get_workspace(void);
+extern struct ac_sandbox *code_tools_get_sandbox(void);
+
+/*============================================================================
+ * Helper Functions
+ *============================================================================*/
+
+static char g_glob_result_buffer[131072];  /* 128KB */
+
+static const char *json_result_glob(cJSON *json) {
+    if (!json) {
+        return "{\"error\": \"Failed to create response\"}";
+    }
+
+    char *str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+
+    if (!str) {
+        return "{\"error\": \"Failed to serialize response\"}";
+    }
+
+    size_t len = strlen(str);
+    if (len >= sizeof(g_glob_result_buffer)) {
+        len = sizeof(g_glob_result_buffer) - 1;
+    }
+    memcpy(g_glob_result_buffer, str, len);
+    g_glob_result_buffer[len] = '\0';
+
+    free(str);
+    return g_glob_result_buffer;
+}
+
+static const char *json_error_glob(const char *msg) {
+    cJSON *json = cJSON_CreateObject();
+    if (json) {
+        cJSON_AddStringToObject(json, "error", msg);
+    }
+    return json_result_glob(json);
+}
+
+/* Patterns are relative to the search path; accept absolute ones below it */
+static const char *relative_pattern(const char *pattern, const char *search_path) {
+    size_t len = strlen(search_path);
+    while (len > 1 && search_path[len - 1] == '/') len--;
+    if (pattern[0] == '/' && strncmp(pattern, search_path, len) == 0 && pattern[len] == '/') {
+        return pattern + len + 1;
+    }
+    return pattern;
+}
+
+/* Skipped even outside a git repository (on top of .gitignore / .ignore) */
+static const char *const g_skip_dirs[] = { "node_modules/", "__pycache__/" };
+
+/*============================================================================
+ * Glob Tool Implementation
+ *============================================================================*/
+
+const char *glob_files(
+    const char *pattern,
+    const char *path
+) {
+    if (!pattern || strlen(pattern) == 0) {
+        return json_error_glob("pattern parameter is required");
+    }
+
+    const char *search_path = (path && strlen(path) > 0) ? path : code_tools_get_workspace();
+
+    /* Sandbox check */
+    ac_sandbox_t *sandbox = code_tools_get_sandbox();
+    if (sandbox) {
+        if (!ac_sandbox_check_path(sandbox, search_path, AC_SANDBOX_PERM_FS_READ)) {
+            cJSON *json = cJSON_CreateObject();
+            cJSON_AddStringToObject(json, "error", "Search path blocked by sandbox");
+            cJSON_AddStringToObject(json, "path", search_path);
+            return json_result_glob(json);
+        }
+    }
+
+    char error_buf[256];
+    ac_glob_pattern_t *compiled = ac_glob_pattern_compile(
+        relative_pattern(pattern, search_path), error_buf, sizeof(error_buf));
+    if (!compiled) {
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "error", "Invalid glob pattern");
+        cJSON_AddStringToObject(json, "pattern", pattern);
+        cJSON_AddStringToObject(json, "reason", error_buf);
+        return json_result_glob(json);
+    }
+
+    const size_t MAX_FILES = 1000;
+    ac_glob_find_options_t options = {
+        .max_results = MAX_FILES,
+        .ignore_globs = g_skip_dirs,
+        .ignore_globs_count = sizeof(g_skip_dirs) / sizeof(g_skip_dirs[0]),
+    };
+    ac_glob_result_t result;
+    arc_err_t err = ac_glob_find(search_path, compiled, &options, &result);
+    ac_glob_pattern_free(compiled);
+
+    if (err != ARC_OK) {
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "error", "Path not found");
+        cJSON_AddStringToObject(json, "path", search_path);
+        return json_result_glob(json);
+    }
+
+    cJSON *files = cJSON_CreateArray();
+    for (size_t i = 0; i < result.count; i++) {
+        cJSON_AddItemToArray(files, cJSON_CreateString(result.files[i].path));
+    }
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "pattern", pattern);
+    cJSON_AddStringToObject(json, "path", search_path);
+    cJSON_AddNumberToObject(json, "count", (double)result.count);
+    cJSON_AddItemToObject(json, "files", files);
+
+    if (result.total > result.count) {
+        char note[96];
+        snprintf(note, sizeof(note), "Showing the %zu most recently modified of %zu files",
+                 result.count, result.total);
+        cJSON_AddBoolToObject(json, "truncated", 1);
+        cJSON_AddStringToObject(json, "note", note);
+    }
+
+    ac_glob_result_free(&result);
+    return json_result_glob(json);
+}
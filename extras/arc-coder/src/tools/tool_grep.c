@@ -2,19 +2,27 @@
  * @file tool_grep.c
  * @brief Grep Tool Implementation
  *
- * Content search using regex patterns.
+ * Content search using regex patterns (see arc/grep.h for the engine).
+ * Directories are walked with arc/walk.h, so .gitignore, .ignore and
+ * hidden files are handled as ripgrep does. With the search index
+ * enabled, workspace-wide searches first narrow the files to those
+ * holding the pattern's required literal (arc/search_index.h). Files
+ * the read tool already holds in the shared file cache are searched in
+ * memory.
  */
 
 #include "code_tools.h"
+#include <arc/glob.h>
+#include <arc/grep.h>
 #include <arc/sandbox.h>
+#include <arc/search_index.h>
+#include <arc/textfile.h>
+#include <arc/walk.h>
 #include <cJSON.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <dirent.h>
 #include <sys/stat.h>
-#include <fnmatch.h>
-#include <regex.h>
 
 /*============================================================================
  * External State
@@ -23,6 +31,11 @@
 extern const char *code_tools_get_workspace(void);
 extern struct ac_sandbox *code_tools_get_sandbox(void);
 
+static int g_search_index = 0;
+static ac_search_index_t *g_index = NULL;      /* Opened on first use */
+static char g_index_workspace[4096];            /* Workspace g_index was opened for */
+static int g_index_failed = 0;                  /* Don't retry a failed open */
+
 /*============================================================================
  * Helper Functions
  *============================================================================*/
@@ -60,116 +73,156 @@ static const char *json_error_grep(const char *msg) {
     return json_result_grep(json);
 }
 
-/* Check if file matches include pattern */
-static int matches_include(const char *filename, const char *include) {
-    if (!include || strlen(include) == 0) return 1;  /* No filter = match all */
+/* Skipped even outside a git repository (on top of .gitignore / .ignore) */
+static const char *const g_skip_dirs[] = { "node_modules/", "__pycache__/" };
+
+/* Collects matches of one grep call into the response array */
+typedef struct {
+    cJSON *matches;
+    int count;
+    int max;
+    const char *path;                   /* File being searched from the cache */
+} grep_collect_t;
+
+static int collect_match(const ac_grep_match_t *m, void *user_data) {
+    grep_collect_t *c = (grep_collect_t *)user_data;
+
+    char line[256];
+    size_t len = m->line_len;
+    if (len > 200) {
+        /* Truncate long lines */
+        snprintf(line, sizeof(line), "%.200s...", m->line);
+    } else {
+        memcpy(line, m->line, len);
+        line[len] = '\0';
+    }
+
+    cJSON *match = cJSON_CreateObject();
+    cJSON_AddStringToObject(match, "file", m->path ? m->path : c->path);
+    cJSON_AddNumberToObject(match, "line", (double)m->line_number);
+    cJSON_AddStringToObject(match, "content", line);
+    cJSON_AddItemToArray(c->matches, match);
 
-    return fnmatch(include, filename, FNM_NOESCAPE) == 0;
+    return ++c->count >= c->max;
 }
 
 /* Search a single file */
-static void search_file(
-    const char *filepath,
-    regex_t *regex,
-    cJSON *matches,
-    int *match_count,
-    int max_matches
-) {
-    if (*match_count >= max_matches) return;
-
-    FILE *fp = fopen(filepath, "r");
-    if (!fp) return;
-
-    char line[4096];
-    int line_num = 0;
-    int file_matches = 0;
-
-    while (fgets(line, sizeof(line), fp) && *match_count < max_matches) {
-        line_num++;
-
-        /* Remove trailing newline */
-        size_t len = strlen(line);
-        if (len > 0 && line[len - 1] == '\n') {
-            line[len - 1] = '\0';
-            len--;
+static void search_file(const char *filepath, const ac_grep_t *grep, grep_collect_t *collect) {
+    if (collect->count >= collect->max) return;
+
+    /* Only files already cached; a tree-wide search must not fill the cache */
+    ac_textfile_t *cached = NULL;
+    if (ac_textfile_peek(code_tools_get_file_cache(), filepath, &cached) == ARC_OK) {
+        if (!ac_textfile_is_binary(cached)) {
+            collect->path = filepath;
+            ac_grep_buffer(grep, ac_textfile_data(cached), ac_textfile_size(cached), collect_match, collect);
+            collect->path = NULL;
         }
+        ac_textfile_release(cached);
+        return;
+    }
+    ac_grep_file(grep, filepath, collect_match, collect);
+}
 
-        /* Check for match */
-        if (regexec(regex, line, 0, NULL, 0) == 0) {
-            cJSON *match = cJSON_CreateObject();
-            cJSON_AddStringToObject(match, "file", filepath);
-            cJSON_AddNumberToObject(match, "line", line_num);
+/* Search every non-ignored file under a directory */
+typedef struct {
+    const ac_grep_t *grep;
+    const ac_glob_pattern_t *include;   /* NULL = every file */
+    grep_collect_t *collect;
+} search_walk_t;
 
-            /* Truncate long lines */
-            if (len > 200) {
-                line[200] = '\0';
-                strcat(line, "...");
-            }
-            cJSON_AddStringToObject(match, "content", line);
+static int search_entry(const ac_walk_entry_t *entry, void *user_data) {
+    search_walk_t *s = (search_walk_t *)user_data;
 
-            cJSON_AddItemToArray(matches, match);
-            (*match_count)++;
-            file_matches++;
-        }
+    if (entry->type == AC_WALK_FILE &&
+        (!s->include || ac_glob_pattern_match(s->include, entry->rel_path))) {
+        search_file(entry->path, s->grep, s->collect);
     }
-
-    fclose(fp);
+    return s->collect->count >= s->collect->max ? AC_WALK_STOP : AC_WALK_CONTINUE;
 }
 
-/* Recursively search directory */
 static void search_directory(
     const char *dir_path,
-    regex_t *regex,
-    const char *include,
-    cJSON *matches,
-    int *match_count,
-    int max_matches,
-    int depth
+    const ac_grep_t *grep,
+    const ac_glob_pattern_t *include,
+    grep_collect_t *collect
 ) {
-    if (*match_count >= max_matches || depth > 20) return;
+    ac_walk_options_t options = {
+        .ignore_globs = g_skip_dirs,
+        .ignore_globs_count = sizeof(g_skip_dirs) / sizeof(g_skip_dirs[0]),
+    };
+    search_walk_t s = { grep, include, collect };
+    ac_walk(dir_path, &options, search_entry, &s);
+}
 
-    DIR *dir = opendir(dir_path);
-    if (!dir) return;
+/*============================================================================
+ * Search Index
+ *============================================================================*/
 
-    struct dirent *entry;
-    while ((entry = readdir(dir)) && *match_count < max_matches) {
-        /* Skip . and .. */
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
+void code_tools_set_search_index(int enabled) {
+    g_search_index = enabled;
+    if (!enabled) {
+        ac_search_index_close(g_index);
+        g_index = NULL;
+        g_index_failed = 0;
+    }
+}
 
-        /* Skip hidden files/dirs */
-        if (entry->d_name[0] == '.') {
-            continue;
-        }
+/* Index of the current workspace, or NULL */
+static ac_search_index_t *workspace_index(void) {
+    const char *workspace = code_tools_get_workspace();
+    if (g_index && strcmp(g_index_workspace, workspace) != 0) {
+        ac_search_index_close(g_index);
+        g_index = NULL;
+        g_index_failed = 0;
+    }
+    if (g_index || g_index_failed) return g_index;
+
+    ac_search_index_options_t options = {
+        .watch = 1,
+        .ignore_globs = g_skip_dirs,
+        .ignore_globs_count = sizeof(g_skip_dirs) / sizeof(g_skip_dirs[0]),
+    };
+    if (ac_search_index_open(workspace, &options, &g_index) != ARC_OK) {
+        g_index = NULL;
+        g_index_failed = 1;
+        return NULL;
+    }
+    snprintf(g_index_workspace, sizeof(g_index_workspace), "%s", workspace);
+    return g_index;
+}
 
-        /* Skip common non-code directories */
-        if (strcmp(entry->d_name, "node_modules") == 0 ||
-            strcmp(entry->d_name, "__pycache__") == 0 ||
-            strcmp(entry->d_name, ".git") == 0 ||
-            strcmp(entry->d_name, "build") == 0 ||
-            strcmp(entry->d_name, "dist") == 0 ||
-            strcmp(entry->d_name, "vendor") == 0) {
-            continue;
-        }
+/*
+ * Search only the index's candidates for the pattern's literal.
+ * Returns 0 when the whole tree has to be walked instead: the index is
+ * disabled or stale, the path is not the workspace root (subdirectories
+ * may be hidden or ignored, i.e. not indexed), or there is no literal.
+ */
+static int search_indexed(
+    const char *dir_path,
+    const ac_grep_t *grep,
+    const ac_glob_pattern_t *include,
+    grep_collect_t *collect
+) {
+    if (!g_search_index) return 0;
+    ac_search_index_t *index = workspace_index();
+    if (!index) return 0;
 
-        char full_path[4096];
-        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
+    char real[4096];
+    if (!realpath(dir_path, real) || strcmp(real, ac_search_index_root(index)) != 0) return 0;
 
-        struct stat st;
-        if (stat(full_path, &st) != 0) continue;
+    const char *literal = ac_grep_literal(grep);
+    ac_search_index_result_t candidates;
+    if (!ac_search_index_query(index, literal, strlen(literal), &candidates)) return 0;
 
-        if (S_ISDIR(st.st_mode)) {
-            search_directory(full_path, regex, include, matches, match_count, max_matches, depth + 1);
-        } else if (S_ISREG(st.st_mode)) {
-            /* Check include pattern */
-            if (matches_include(entry->d_name, include)) {
-                search_file(full_path, regex, matches, match_count, max_matches);
-            }
-        }
+    for (size_t i = 0; i < candidates.count && collect->count < collect->max; i++) {
+        if (include && !ac_glob_pattern_match(include, candidates.paths[i])) continue;
+        char full_path[4096];
+        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, candidates.paths[i]);
+        search_file(full_path, grep, collect);
     }
-
-    closedir(dir);
+    ac_search_index_result_free(&candidates);
+    return 1;
 }
 
 /*============================================================================
@@ -179,7 +232,8 @@ static void search_directory(
 const char *grep(
     const char *pattern,
     const char *path,
-    const char *include
+    const char *include,
+    bool multiline
 ) {
     if (!pattern || strlen(pattern) == 0) {
         return json_error_grep("pattern parameter is required");
@@ -200,13 +254,14 @@ const char *grep(
         }
     }
 
-    /* Compile regex */
-    regex_t regex;
-    int ret = regcomp(&regex, pattern, REG_EXTENDED | REG_ICASE | REG_NEWLINE);
-    if (ret != 0) {
-        char error_buf[256];
-        regerror(ret, &regex, error_buf, sizeof(error_buf));
-
+    /* Compile pattern: ripgrep --smart-case */
+    ac_grep_options_t options = {
+        .case_mode = AC_GREP_CASE_SMART,
+        .multiline = multiline,
+    };
+    char error_buf[256];
+    ac_grep_t *compiled = ac_grep_compile(pattern, &options, error_buf, sizeof(error_buf));
+    if (!compiled) {
         cJSON *json = cJSON_CreateObject();
         cJSON_AddStringToObject(json, "error", "Invalid regex pattern");
         cJSON_AddStringToObject(json, "pattern", pattern);
@@ -215,13 +270,13 @@ const char *grep(
     }
 
     /* Search */
-    cJSON *matches = cJSON_CreateArray();
-    int match_count = 0;
     const int MAX_MATCHES = 500;
+    grep_collect_t collect = { cJSON_CreateArray(), 0, MAX_MATCHES, NULL };
 
     struct stat st;
     if (stat(search_path, &st) != 0) {
-        regfree(&regex);
+        ac_grep_free(compiled);
+        cJSON_Delete(collect.matches);
         cJSON *json = cJSON_CreateObject();
         cJSON_AddStringToObject(json, "error", "Path not found");
         cJSON_AddStringToObject(json, "path", search_path);
@@ -229,12 +284,29 @@ const char *grep(
     }
 
     if (S_ISDIR(st.st_mode)) {
-        search_directory(search_path, &regex, include, matches, &match_count, MAX_MATCHES, 0);
+        ac_glob_pattern_t *include_glob = NULL;
+        if (include && strlen(include) > 0) {
+            include_glob = ac_glob_pattern_compile(include, error_buf, sizeof(error_buf));
+            if (!include_glob) {
+                ac_grep_free(compiled);
+                cJSON_Delete(collect.matches);
+                cJSON *json = cJSON_CreateObject();
+                cJSON_AddStringToObject(json, "error", "Invalid include pattern");
+                cJSON_AddStringToObject(json, "include", include);
+                cJSON_AddStringToObject(json, "reason", error_buf);
+                return json_result_grep(json);
+            }
+        }
+        if (!search_indexed(search_path, compiled, include_glob, &collect)) {
+            search_directory(search_path, compiled, include_glob, &collect);
+        }
+        ac_glob_pattern_free(include_glob);
     } else {
-        search_file(search_path, &regex, matches, &match_count, MAX_MATCHES);
+        search_file(search_path, compiled, &collect);
     }
 
-    regfree(&regex);
+    ac_grep_free(compiled);
+    int match_count = collect.count;
 
     /* Build response */
     cJSON *json = cJSON_CreateObject();
@@ -244,7 +316,7 @@ const char *grep(
         cJSON_AddStringToObject(json, "include", include);
     }
     cJSON_AddNumberToObject(json, "match_count", match_count);
-    cJSON_AddItemToObject(json, "matches", matches);
+    cJSON_AddItemToObject(json, "matches", collect.matches);
 
     if (match_count >= MAX_MATCHES) {
         cJSON_AddBoolToObject(json, "truncated", 1);
@@ -253,97 +325,3 @@ const char *grep(
 
     return json_result_grep(json);
 }
-
-/*============================================================================
- * Glob Tool Implementation
- *============================================================================*/
-
-/* Helper to collect matching files */
-static void glob_directory(
-    const char *dir_path,
-    const char *pattern,
-    cJSON *files,
-    int *count,
-    int max_files,
-    int depth
-) {
-    if (*count >= max_files || depth > 20) return;
-
-    DIR *dir = opendir(dir_path);
-    if (!dir) return;
-
-    struct dirent *entry;
-    while ((entry = readdir(dir)) && *count < max_files) {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-
-        if (entry->d_name[0] == '.') continue;
-
-        /* Skip common non-code directories */
-        if (strcmp(entry->d_name, "node_modules") == 0 ||
-            strcmp(entry->d_name, "__pycache__") == 0 ||
-            strcmp(entry->d_name, ".git") == 0) {
-            continue;
-        }
-
-        char full_path[4096];
-        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
-
-        struct stat st;
-        if (stat(full_path, &st) != 0) continue;
-
-        if (S_ISDIR(st.st_mode)) {
-            glob_directory(full_path, pattern, files, count, max_files, depth + 1);
-        } else if (S_ISREG(st.st_mode)) {
-            /* Check pattern match */
-            if (fnmatch(pattern, entry->d_name, FNM_NOESCAPE) == 0 ||
-                fnmatch(pattern, full_path, FNM_NOESCAPE | FNM_PATHNAME) == 0) {
-                cJSON_AddItemToArray(files, cJSON_CreateString(full_path));
-                (*count)++;
-            }
-        }
-    }
-
-    closedir(dir);
-}
-
-const char *glob_files(
-    const char *pattern,
-    const char *path
-) {
-    if (!pattern || strlen(pattern) == 0) {
-        return json_error_grep("pattern parameter is required");
-    }
-
-    const char *search_path = (path && strlen(path) > 0) ? path : code_tools_get_workspace();
-
-    /* Sandbox check */
-    ac_sandbox_t *sandbox = code_tools_get_sandbox();
-    if (sandbox) {
-        if (!ac_sandbox_check_path(sandbox, search_path, AC_SANDBOX_PERM_FS_READ)) {
-            cJSON *json = cJSON_CreateObject();
-            cJSON_AddStringToObject(json, "error", "Search path blocked by sandbox");
-            cJSON_AddStringToObject(json, "path", search_path);
-            return json_result_grep(json);
-        }
-    }
-
-    cJSON *files = cJSON_CreateArray();
-    int count = 0;
-    const int MAX_FILES = 1000;
-
-    glob_directory(search_path, pattern, files, &count, MAX_FILES, 0);
-
-    cJSON *json = cJSON_CreateObject();
-    cJSON_AddStringToObject(json, "pattern", pattern);
-    cJSON_AddStringToObject(json, "path", search_path);
-    cJSON_AddNumberToObject(json, "count", count);
-    cJSON_AddItemToObject(json, "files", files);
-
-    if (count >= MAX_FILES) {
-        cJSON_AddBoolToObject(json, "truncated", 1);
-    }
-
-    return json_result_grep(json);
-}
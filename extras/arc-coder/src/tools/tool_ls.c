@@ -1,17 +1,19 @@
 /**
  * @file tool_ls.c
  * @brief LS Tool Implementation
+ *
+ * Lists one directory level through arc/walk.h: sorted by name, hidden
+ * and ignored (.gitignore / .ignore) entries left out.
  */
 
 #include "code_tools.h"
 #include <arc/sandbox.h>
+#include <arc/walk.h>
 #include <cJSON.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <dirent.h>
 #include <sys/stat.h>
-#include <fnmatch.h>
 
 /*============================================================================
  * External State
@@ -57,30 +59,18 @@ static const char *json_result_ls(cJSON *json) {
 //     return json_result_ls(json);
 // }
 
-/* Check if name matches any ignore pattern */
-static int should_ignore(const char *name, const char *ignore) {
-    if (!ignore || strlen(ignore) == 0) return 0;
-
-    /* Parse comma-separated patterns */
-    char *patterns = strdup(ignore);
-    if (!patterns) return 0;
-
-    char *pattern = strtok(patterns, ",");
-    while (pattern) {
+/* Split comma-separated ignore patterns into walker rules (in place) */
+static size_t split_patterns(char *list, const char **patterns, size_t max) {
+    size_t count = 0;
+    char *save = NULL;
+    for (char *p = strtok_r(list, ",", &save); p && count < max; p = strtok_r(NULL, ",", &save)) {
         /* Trim whitespace */
-        while (*pattern == ' ') pattern++;
-        char *end = pattern + strlen(pattern) - 1;
-        while (end > pattern && *end == ' ') *end-- = '\0';
-
-        if (fnmatch(pattern, name, FNM_NOESCAPE) == 0) {
-            free(patterns);
-            return 1;
-        }
-        pattern = strtok(NULL, ",");
+        while (*p == ' ') p++;
+        char *end = p + strlen(p);
+        while (end > p && end[-1] == ' ') *--end = '\0';
+        if (*p) patterns[count++] = p;
     }
-
-    free(patterns);
-    return 0;
+    return count;
 }
 
 /* Format file size for display */
@@ -96,6 +86,48 @@ static void format_size(off_t size, char *buf, size_t buf_len) {
     }
 }
 
+/* Collects one directory level into the response */
+typedef struct {
+    cJSON *dirs;
+    cJSON *files;
+    int dir_count;
+    int file_count;
+    int total;
+    int max;
+} ls_collect_t;
+
+static int ls_entry(const ac_walk_entry_t *entry, void *user_data) {
+    ls_collect_t *c = (ls_collect_t *)user_data;
+
+    if (entry->type == AC_WALK_DIR) {
+        cJSON *dir_obj = cJSON_CreateObject();
+        cJSON_AddStringToObject(dir_obj, "name", entry->name);
+        cJSON_AddStringToObject(dir_obj, "type", "directory");
+        cJSON_AddItemToArray(c->dirs, dir_obj);
+        c->dir_count++;
+    } else if (entry->type == AC_WALK_FILE) {
+        /* The walker avoids stat; only files need it, for the size */
+        struct stat st;
+        if (stat(entry->path, &st) != 0) return AC_WALK_CONTINUE;
+
+        cJSON *file_obj = cJSON_CreateObject();
+        cJSON_AddStringToObject(file_obj, "name", entry->name);
+        cJSON_AddStringToObject(file_obj, "type", "file");
+        cJSON_AddNumberToObject(file_obj, "size", (double)st.st_size);
+
+        char size_str[32];
+        format_size(st.st_size, size_str, sizeof(size_str));
+        cJSON_AddStringToObject(file_obj, "size_formatted", size_str);
+
+        cJSON_AddItemToArray(c->files, file_obj);
+        c->file_count++;
+    } else {
+        return AC_WALK_CONTINUE;
+    }
+
+    return ++c->total >= c->max ? AC_WALK_STOP : AC_WALK_CONTINUE;
+}
+
 /*============================================================================
  * LS Tool Implementation
  *============================================================================*/
@@ -119,9 +151,8 @@ const char *ls(
         }
     }
 
-    /* Open directory */
-    DIR *dir = opendir(dir_path);
-    if (!dir) {
+    struct stat st;
+    if (stat(dir_path, &st) != 0 || !S_ISDIR(st.st_mode)) {
         cJSON *json = cJSON_CreateObject();
         cJSON_AddStringToObject(json, "error", "Failed to open directory");
         cJSON_AddStringToObject(json, "path", dir_path);
@@ -132,72 +163,28 @@ const char *ls(
     cJSON *json = cJSON_CreateObject();
     cJSON_AddStringToObject(json, "path", dir_path);
 
-    cJSON *dirs = cJSON_CreateArray();
-    cJSON *files = cJSON_CreateArray();
-
-    int dir_count = 0;
-    int file_count = 0;
-    int total_count = 0;
     const int MAX_ENTRIES = 1000;
-
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL && total_count < MAX_ENTRIES) {
-        /* Skip . and .. */
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-
-        /* Skip hidden files (starting with .) */
-        if (entry->d_name[0] == '.') {
-            continue;
-        }
-
-        /* Check ignore patterns */
-        if (should_ignore(entry->d_name, ignore)) {
-            continue;
-        }
-
-        /* Get full path for stat */
-        char full_path[4096];
-        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
-
-        struct stat st;
-        if (stat(full_path, &st) != 0) {
-            continue;
-        }
-
-        if (S_ISDIR(st.st_mode)) {
-            cJSON *dir_obj = cJSON_CreateObject();
-            cJSON_AddStringToObject(dir_obj, "name", entry->d_name);
-            cJSON_AddStringToObject(dir_obj, "type", "directory");
-            cJSON_AddItemToArray(dirs, dir_obj);
-            dir_count++;
-        } else if (S_ISREG(st.st_mode)) {
-            cJSON *file_obj = cJSON_CreateObject();
-            cJSON_AddStringToObject(file_obj, "name", entry->d_name);
-            cJSON_AddStringToObject(file_obj, "type", "file");
-            cJSON_AddNumberToObject(file_obj, "size", (double)st.st_size);
-
-            char size_str[32];
-            format_size(st.st_size, size_str, sizeof(size_str));
-            cJSON_AddStringToObject(file_obj, "size_formatted", size_str);
-
-            cJSON_AddItemToArray(files, file_obj);
-            file_count++;
-        }
-
-        total_count++;
-    }
-
-    closedir(dir);
-
-    cJSON_AddItemToObject(json, "directories", dirs);
-    cJSON_AddItemToObject(json, "files", files);
-    cJSON_AddNumberToObject(json, "directory_count", dir_count);
-    cJSON_AddNumberToObject(json, "file_count", file_count);
-    cJSON_AddNumberToObject(json, "total", dir_count + file_count);
-
-    if (total_count >= MAX_ENTRIES) {
+    ls_collect_t collect = { cJSON_CreateArray(), cJSON_CreateArray(), 0, 0, 0, MAX_ENTRIES };
+
+    /* One level, honoring .gitignore / .ignore plus the caller's patterns */
+    char *ignore_list = (ignore && strlen(ignore) > 0) ? strdup(ignore) : NULL;
+    const char *patterns[64];
+    ac_walk_options_t options = {
+        .max_depth = 1,
+        .follow_links = 1,
+        .ignore_globs = patterns,
+        .ignore_globs_count = ignore_list ? split_patterns(ignore_list, patterns, 64) : 0,
+    };
+    ac_walk(dir_path, &options, ls_entry, &collect);
+    free(ignore_list);
+
+    cJSON_AddItemToObject(json, "directories", collect.dirs);
+    cJSON_AddItemToObject(json, "files", collect.files);
+    cJSON_AddNumberToObject(json, "directory_count", collect.dir_count);
+    cJSON_AddNumberToObject(json, "file_count", collect.file_count);
+    cJSON_AddNumberToObject(json, "total", collect.dir_count + collect.file_count);
+
+    if (collect.total >= MAX_ENTRIES) {
         cJSON_AddBoolToObject(json, "truncated", 1);
         cJSON_AddStringToObject(json, "note", "Result truncated at 1000 entries");
     }
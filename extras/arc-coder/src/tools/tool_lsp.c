@@ -0,0 +1,334 @@
+/**
+ * @file tool_lsp.c
+ * @brief LSP Tool Implementation
+ *
+ * Compiler-accurate navigation through the language servers of
+ * arc/lsp.h: definition, references, hover and diagnostics. One pool per
+ * workspace keeps each server running between calls, and the edit and
+ * write tools report the files they change so open documents stay in
+ * sync without being sent again.
+ */
+
+#include "code_tools.h"
+#include <arc/lsp.h>
+#include <arc/sandbox.h>
+#include <arc/textfile.h>
+#include <cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * External State
+ *============================================================================*/
+
+extern const char *code_tools_get_workspace(void);
+extern struct ac_sandbox *code_tools_get_sandbox(void);
+
+static ac_lsp_pool_t *g_lsp = NULL;         /* Created on first use */
+static char g_lsp_workspace[4096];          /* Workspace g_lsp was created for */
+
+#define MAX_LOCATIONS 100
+#define MAX_DIAGNOSTICS 100
+#define DIAGNOSTICS_WAIT_MS 5000
+
+/*============================================================================
+ * Helper Functions
+ *============================================================================*/
+
+static char *g_lsp_result = NULL;
+
+static const char *json_result_lsp(cJSON *json) {
+    if (!json) {
+        return "{\"error\": \"Failed to create response\"}";
+    }
+
+    char *str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+
+    if (!str) {
+        return "{\"error\": \"Failed to serialize response\"}";
+    }
+
+    free(g_lsp_result);
+    g_lsp_result = str;
+    return g_lsp_result;
+}
+
+static const char *json_error_lsp(const char *msg) {
+    cJSON *json = cJSON_CreateObject();
+    if (json) {
+        cJSON_AddStringToObject(json, "error", msg);
+    }
+    return json_result_lsp(json);
+}
+
+/*============================================================================
+ * Server Pool
+ *============================================================================*/
+
+void code_tools_close_lsp(void) {
+    ac_lsp_pool_destroy(g_lsp);
+    g_lsp = NULL;
+}
+
+void code_tools_lsp_file_changed(const char *path) {
+    /* Nothing is open before the first lsp call */
+    if (g_lsp && path) {
+        ac_lsp_file_changed(g_lsp, path, NULL, 0);
+    }
+}
+
+/* Pool of the current workspace, or NULL */
+static ac_lsp_pool_t *workspace_pool(void) {
+    const char *workspace = code_tools_get_workspace();
+    if (g_lsp && strcmp(g_lsp_workspace, workspace) != 0) {
+        code_tools_close_lsp();
+    }
+    if (g_lsp) return g_lsp;
+
+    ac_lsp_options_t options = { .root = workspace };
+    if (ac_lsp_pool_create(&options, &g_lsp) != ARC_OK) {
+        g_lsp = NULL;
+        return NULL;
+    }
+    snprintf(g_lsp_workspace, sizeof(g_lsp_workspace), "%s", workspace);
+    return g_lsp;
+}
+
+/* The server's command line as one string, for the sandbox command check */
+static void server_command(const ac_lsp_server_config_t *server, char *out, size_t size) {
+    size_t used = 0;
+    out[0] = '\0';
+    for (size_t i = 0; server->argv[i] && used < size; i++) {
+        int n = snprintf(out + used, size - used, "%s%s", i ? " " : "", server->argv[i]);
+        if (n < 0) break;
+        used += (size_t)n;
+    }
+}
+
+/*============================================================================
+ * Results
+ *============================================================================*/
+
+/* Source line of one location; keeps the last file open across calls */
+typedef struct {
+    char path[4096];
+    ac_textfile_t *file;
+} line_reader_t;
+
+static void add_line_text(line_reader_t *r, const char *path, unsigned line, cJSON *item) {
+    if (!r->file || strcmp(r->path, path) != 0) {
+        ac_textfile_release(r->file);
+        r->file = NULL;
+        snprintf(r->path, sizeof(r->path), "%s", path);
+        if (ac_textfile_peek(code_tools_get_file_cache(), path, &r->file) != ARC_OK &&
+            ac_textfile_open(NULL, path, &r->file) != ARC_OK) {
+            r->file = NULL;
+            return;
+        }
+    }
+
+    size_t len;
+    const char *text = ac_textfile_line(r->file, line - 1, &len);
+    if (!text) return;
+    while (len > 0 && (*text == ' ' || *text == '\t')) {
+        text++;
+        len--;
+    }
+
+    char buf[256];
+    if (len > 200) {
+        snprintf(buf, sizeof(buf), "%.200s...", text);
+    } else {
+        memcpy(buf, text, len);
+        buf[len] = '\0';
+    }
+    cJSON_AddStringToObject(item, "text", buf);
+}
+
+static const char *locations_result(const char *operation, const char *file, const ac_lsp_locations_t *locs) {
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "operation", operation);
+    cJSON_AddStringToObject(json, "file", file);
+    cJSON *array = cJSON_AddArrayToObject(json, "locations");
+
+    line_reader_t reader = { .file = NULL };
+    for (size_t i = 0; i < locs->count && i < MAX_LOCATIONS; i++) {
+        const ac_lsp_location_t *l = &locs->locations[i];
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "file", l->path);
+        cJSON_AddNumberToObject(item, "line", l->line);
+        cJSON_AddNumberToObject(item, "column", l->column);
+        add_line_text(&reader, l->path, l->line, item);
+        cJSON_AddItemToArray(array, item);
+    }
+    ac_textfile_release(reader.file);
+
+    cJSON_AddNumberToObject(json, "count", (double)locs->count);
+    if (locs->count > MAX_LOCATIONS) {
+        cJSON_AddBoolToObject(json, "truncated", 1);
+    }
+    if (locs->count == 0) {
+        cJSON_AddStringToObject(json, "hint",
+            "No symbol at this position; line and character must point into an identifier");
+    }
+    return json_result_lsp(json);
+}
+
+static const char *severity_name(ac_lsp_severity_t severity) {
+    switch (severity) {
+        case AC_LSP_ERROR:   return "error";
+        case AC_LSP_WARNING: return "warning";
+        case AC_LSP_HINT:    return "hint";
+        default:             return "info";
+    }
+}
+
+static const char *diagnostics_result(const char *file, const ac_lsp_diagnostics_t *diags) {
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "operation", "diagnostics");
+    cJSON_AddStringToObject(json, "file", file);
+    cJSON *array = cJSON_AddArrayToObject(json, "diagnostics");
+
+    for (size_t i = 0; i < diags->count && i < MAX_DIAGNOSTICS; i++) {
+        const ac_lsp_diagnostic_t *d = &diags->items[i];
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddNumberToObject(item, "line", d->line);
+        cJSON_AddNumberToObject(item, "column", d->column);
+        cJSON_AddStringToObject(item, "severity", severity_name(d->severity));
+        cJSON_AddStringToObject(item, "message", d->message);
+        if (d->source[0]) cJSON_AddStringToObject(item, "source", d->source);
+        if (d->code[0]) cJSON_AddStringToObject(item, "code", d->code);
+        cJSON_AddItemToArray(array, item);
+    }
+
+    cJSON_AddNumberToObject(json, "count", (double)diags->count);
+    if (diags->count > MAX_DIAGNOSTICS) {
+        cJSON_AddBoolToObject(json, "truncated", 1);
+    }
+    if (diags->stale) {
+        cJSON_AddStringToObject(json, "note",
+            "The server has not finished checking the current contents; these may be out of date");
+    }
+    return json_result_lsp(json);
+}
+
+static const char *lsp_failure(arc_err_t err, const char *file, const ac_lsp_server_config_t *server) {
+    cJSON *json = cJSON_CreateObject();
+    switch (err) {
+        case ARC_ERR_TIMEOUT:
+            cJSON_AddStringToObject(json, "error", "Language server did not answer in time");
+            cJSON_AddStringToObject(json, "hint", "It may still be indexing the workspace; retry shortly");
+            break;
+        case ARC_ERR_IO:
+            cJSON_AddStringToObject(json, "error", "Language server unavailable");
+            cJSON_AddStringToObject(json, "reason", ac_lsp_error());
+            cJSON_AddStringToObject(json, "hint", "Use codesearch or grep instead");
+            break;
+        case ARC_ERR_NOT_IMPLEMENTED:
+            cJSON_AddStringToObject(json, "error", "The language server does not support this operation");
+            break;
+        default:
+            cJSON_AddStringToObject(json, "error", ac_lsp_error());
+            break;
+    }
+    cJSON_AddStringToObject(json, "file", file);
+    if (server) cJSON_AddStringToObject(json, "server", server->argv[0]);
+    return json_result_lsp(json);
+}
+
+/*============================================================================
+ * LSP Tool Implementation
+ *============================================================================*/
+
+const char *lsp(
+    const char *operation,
+    const char *filePath,
+    int line,
+    int character
+) {
+    if (!operation || strlen(operation) == 0) {
+        return json_error_lsp("operation parameter is required");
+    }
+    if (!filePath || strlen(filePath) == 0) {
+        return json_error_lsp("filePath parameter is required");
+    }
+
+    int is_diagnostics = strcmp(operation, "diagnostics") == 0;
+    if (!is_diagnostics && strcmp(operation, "goToDefinition") != 0 &&
+        strcmp(operation, "findReferences") != 0 && strcmp(operation, "hover") != 0) {
+        return json_error_lsp("operation must be goToDefinition, findReferences, hover or diagnostics");
+    }
+    if (!is_diagnostics && (line < 1 || character < 1)) {
+        return json_error_lsp("line and character are required (1-based)");
+    }
+
+    ac_lsp_pool_t *pool = workspace_pool();
+    if (!pool) {
+        return json_error_lsp("Language servers unavailable");
+    }
+
+    const ac_lsp_server_config_t *server = ac_lsp_server_for_file(pool, filePath);
+    if (!server) {
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "error", "No language server for this file type");
+        cJSON_AddStringToObject(json, "file", filePath);
+        cJSON_AddStringToObject(json, "hint",
+            "Servers are configured for C, C++, Python, JavaScript, TypeScript, Go and Rust; use codesearch or grep");
+        return json_result_lsp(json);
+    }
+
+    /* Sandbox check: the file is read, and the server is a command we run */
+    ac_sandbox_t *sandbox = code_tools_get_sandbox();
+    if (sandbox) {
+        char command[1024];
+        server_command(server, command, sizeof(command));
+        const char *blocked = NULL;
+        if (!ac_sandbox_check_path(sandbox, filePath, AC_SANDBOX_PERM_FS_READ)) {
+            blocked = "File read blocked by sandbox";
+        } else if (!ac_sandbox_check_command(sandbox, command)) {
+            blocked = "Language server blocked by sandbox";
+        }
+        if (blocked) {
+            cJSON *json = cJSON_CreateObject();
+            cJSON_AddStringToObject(json, "error", blocked);
+            cJSON_AddStringToObject(json, "path", filePath);
+            cJSON_AddStringToObject(json, "reason", ac_sandbox_denial_reason());
+            return json_result_lsp(json);
+        }
+    }
+
+    arc_err_t err;
+    if (is_diagnostics) {
+        ac_lsp_diagnostics_t diags;
+        err = ac_lsp_diagnostics(pool, filePath, DIAGNOSTICS_WAIT_MS, &diags);
+        if (err != ARC_OK) return lsp_failure(err, filePath, server);
+        const char *result = diagnostics_result(filePath, &diags);
+        ac_lsp_diagnostics_free(&diags);
+        return result;
+    }
+
+    if (strcmp(operation, "hover") == 0) {
+        char *text = NULL;
+        err = ac_lsp_hover(pool, filePath, (unsigned)line, (unsigned)character, &text);
+        if (err != ARC_OK) return lsp_failure(err, filePath, server);
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "operation", operation);
+        cJSON_AddStringToObject(json, "file", filePath);
+        cJSON_AddStringToObject(json, "hover", text);
+        free(text);
+        return json_result_lsp(json);
+    }
+
+    ac_lsp_locations_t locs;
+    if (strcmp(operation, "goToDefinition") == 0) {
+        err = ac_lsp_definition(pool, filePath, (unsigned)line, (unsigned)character, &locs);
+    } else {
+        err = ac_lsp_references(pool, filePath, (unsigned)line, (unsigned)character, &locs);
+    }
+    if (err != ARC_OK) return lsp_failure(err, filePath, server);
+    const char *result = locations_result(operation, filePath, &locs);
+    ac_lsp_locations_free(&locs);
+    return result;
+}
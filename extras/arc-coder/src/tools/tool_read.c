@@ -1,10 +1,17 @@
 /**
  * @file tool_read.c
  * @brief Read Tool Implementation
+ *
+ * Files are opened through an arc/textfile.h cache: the first read of a
+ * file maps it and indexes its lines, and reads of any later page (or
+ * of the same file again, while unchanged) go straight to their lines.
+ * The cache is shared with the edit and grep tools and follows changes
+ * with inotify.
  */
 
 #include "code_tools.h"
 #include <arc/sandbox.h>
+#include <arc/textfile.h>
 #include <cJSON.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -22,7 +29,11 @@ extern struct ac_sandbox *code_tools_get_sandbox(void);
  * Helper Functions
  *============================================================================*/
 
-static char g_read_result_buffer[131072];  /* 128KB */
+/* Last response; content is bounded by MAX_CONTENT_BYTES instead */
+static char *g_read_result = NULL;
+
+static ac_textfile_cache_t *g_file_cache = NULL;   /* Created on first use */
+static char g_file_cache_workspace[4096];          /* Workspace g_file_cache belongs to */
 
 static const char *json_result_read(cJSON *json) {
     if (!json) {
@@ -36,15 +47,9 @@ static const char *json_result_read(cJSON *json) {
         return "{\"error\": \"Failed to serialize response\"}";
     }
 
-    size_t len = strlen(str);
-    if (len >= sizeof(g_read_result_buffer)) {
-        len = sizeof(g_read_result_buffer) - 1;
-    }
-    memcpy(g_read_result_buffer, str, len);
-    g_read_result_buffer[len] = '\0';
-
-    free(str);
-    return g_read_result_buffer;
+    free(g_read_result);
+    g_read_result = str;
+    return g_read_result;
 }
 
 static const char *json_error_read(const char *msg) {
@@ -55,6 +60,27 @@ static const char *json_error_read(const char *msg) {
     return json_result_read(json);
 }
 
+/*============================================================================
+ * Shared File Cache
+ *============================================================================*/
+
+struct ac_textfile_cache *code_tools_get_file_cache(void) {
+    const char *workspace = code_tools_get_workspace();
+    if (g_file_cache && strcmp(g_file_cache_workspace, workspace) != 0) {
+        ac_textfile_cache_destroy(g_file_cache);
+        g_file_cache = NULL;
+    }
+    if (!g_file_cache) {
+        ac_textfile_cache_options_t options = {
+            .max_files = 256,
+            .watch = 1,
+        };
+        g_file_cache = ac_textfile_cache_create(&options);
+        snprintf(g_file_cache_workspace, sizeof(g_file_cache_workspace), "%s", workspace);
+    }
+    return g_file_cache;
+}
+
 /* Check if file is binary */
 static int is_binary_file(const char *path) {
     const char *ext = strrchr(path, '.');
@@ -77,6 +103,36 @@ static int is_binary_file(const char *path) {
     return 0;
 }
 
+/* Growable output buffer */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} read_buf_t;
+
+static int buf_append(read_buf_t *b, const char *s, size_t len) {
+    if (b->len + len + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap : 65536;
+        while (b->len + len + 1 > cap) cap *= 2;
+        char *data = realloc(b->data, cap);
+        if (!data) return -1;
+        b->data = data;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, s, len);
+    b->len += len;
+    b->data[b->len] = '\0';
+    return 0;
+}
+
+/* Cut at most max bytes without splitting a UTF-8 sequence */
+static size_t utf8_prefix(const char *s, size_t len, size_t max) {
+    if (len <= max) return len;
+    size_t n = max;
+    while (n > 0 && ((unsigned char)s[n] & 0xC0) == 0x80) n--;
+    return n;
+}
+
 /*============================================================================
  * Read Tool Implementation
  *============================================================================*/
@@ -91,9 +147,10 @@ const char *read_file(
     }
 
     /* Default values */
-    int line_offset = offset > 0 ? offset : 0;
-    int line_limit = limit > 0 ? limit : 2000;
-    const int MAX_LINE_LENGTH = 2000;
+    size_t line_offset = offset > 0 ? (size_t)offset : 0;
+    size_t line_limit = limit > 0 ? (size_t)limit : 2000;
+    const size_t MAX_LINE_LENGTH = 2000;
+    const size_t MAX_CONTENT_BYTES = 262144;   /* 256KB per call */
 
     /* Sandbox check */
     ac_sandbox_t *sandbox = code_tools_get_sandbox();
@@ -116,22 +173,30 @@ const char *read_file(
     }
 
     /* Open file */
-    FILE *fp = fopen(filePath, "r");
-    if (!fp) {
+    ac_textfile_t *file = NULL;
+    arc_err_t err = ac_textfile_open(code_tools_get_file_cache(), filePath, &file);
+    if (err != ARC_OK) {
         cJSON *json = cJSON_CreateObject();
-        cJSON_AddStringToObject(json, "error", "File not found");
+        cJSON_AddStringToObject(json, "error",
+                                err == ARC_ERR_INVALID_ARG ? "Not a regular file" :
+                                err == ARC_ERR_NO_MEMORY ? "Memory allocation failed" :
+                                "File not found");
         cJSON_AddStringToObject(json, "path", filePath);
         return json_result_read(json);
     }
 
-    /* Get file size */
-    fseek(fp, 0, SEEK_END);
-    long file_size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
+    /* Extensions miss binaries; a NUL byte does not */
+    if (ac_textfile_is_binary(file)) {
+        ac_textfile_release(file);
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "error", "Cannot read binary file");
+        cJSON_AddStringToObject(json, "path", filePath);
+        return json_result_read(json);
+    }
 
     /* Check if empty */
-    if (file_size == 0) {
-        fclose(fp);
+    if (ac_textfile_size(file) == 0) {
+        ac_textfile_release(file);
         cJSON *json = cJSON_CreateObject();
         cJSON_AddStringToObject(json, "path", filePath);
         cJSON_AddStringToObject(json, "content", "<file is empty>");
@@ -139,106 +204,56 @@ const char *read_file(
         return json_result_read(json);
     }
 
-    /* Read lines */
-    char line_buf[4096];
-    int current_line = 0;
-    int lines_read = 0;
-    int total_lines = 0;
-
-    /* Build content with line numbers */
-    size_t content_cap = 65536;
-    size_t content_len = 0;
-    char *content = malloc(content_cap);
-    if (!content) {
-        fclose(fp);
+    size_t total_lines = ac_textfile_line_count(file);
+    if (total_lines == 0) {
+        ac_textfile_release(file);
         return json_error_read("Memory allocation failed");
     }
-    content[0] = '\0';
-
-    /* First pass: count total lines and read requested range */
-    while (fgets(line_buf, sizeof(line_buf), fp) != NULL) {
-        total_lines++;
-
-        /* Skip lines before offset */
-        if (current_line < line_offset) {
-            current_line++;
-            continue;
-        }
-
-        /* Stop if we've read enough */
-        if (lines_read >= line_limit) {
-            current_line++;
-            continue;
-        }
-
-        /* Format line with line number (1-based) */
-        char formatted_line[4200];
-        int line_len = strlen(line_buf);
-
-        /* Remove trailing newline for processing */
-        if (line_len > 0 && line_buf[line_len - 1] == '\n') {
-            line_buf[line_len - 1] = '\0';
-            line_len--;
-        }
 
-        /* Truncate if too long */
-        if (line_len > MAX_LINE_LENGTH) {
-            line_buf[MAX_LINE_LENGTH] = '\0';
-            snprintf(formatted_line, sizeof(formatted_line),
-                     "%05d| %s...\n", current_line + 1, line_buf);
-        } else {
-            snprintf(formatted_line, sizeof(formatted_line),
-                     "%05d| %s\n", current_line + 1, line_buf);
-        }
-
-        /* Append to content */
-        size_t formatted_len = strlen(formatted_line);
-        if (content_len + formatted_len + 1 > content_cap) {
-            content_cap *= 2;
-            char *new_content = realloc(content, content_cap);
-            if (!new_content) {
-                free(content);
-                fclose(fp);
-                return json_error_read("Memory allocation failed");
-            }
-            content = new_content;
-        }
-
-        strcpy(content + content_len, formatted_line);
-        content_len += formatted_len;
-
-        current_line++;
+    /* Build content with line numbers (1-based) */
+    read_buf_t content = {0};
+    int failed = buf_append(&content, "<file>\n", 7);
+    size_t lines_read = 0;
+    for (size_t i = line_offset; !failed && i < total_lines && lines_read < line_limit; i++) {
+        if (content.len >= MAX_CONTENT_BYTES) break;
+
+        size_t len;
+        const char *line = ac_textfile_line(file, i, &len);
+        size_t shown = utf8_prefix(line, len, MAX_LINE_LENGTH);
+
+        char number[32];
+        int n = snprintf(number, sizeof(number), "%05zu| ", i + 1);
+        failed = buf_append(&content, number, (size_t)n) ||
+                 buf_append(&content, line, shown) ||
+                 (shown < len && buf_append(&content, "...", 3)) ||
+                 buf_append(&content, "\n", 1);
         lines_read++;
     }
-
-    fclose(fp);
+    ac_textfile_release(file);
+    failed = failed || buf_append(&content, "</file>", 7);
+    if (failed) {
+        free(content.data);
+        return json_error_read("Memory allocation failed");
+    }
 
     /* Build response */
     cJSON *json = cJSON_CreateObject();
     cJSON_AddStringToObject(json, "path", filePath);
-    cJSON_AddNumberToObject(json, "total_lines", total_lines);
-    cJSON_AddNumberToObject(json, "offset", line_offset);
-    cJSON_AddNumberToObject(json, "lines_read", lines_read);
-
-    /* Add file content */
-    char *file_content = malloc(content_len + 50);
-    if (file_content) {
-        snprintf(file_content, content_len + 50, "<file>\n%s</file>", content);
-        cJSON_AddStringToObject(json, "content", file_content);
-        free(file_content);
-    } else {
-        cJSON_AddStringToObject(json, "content", content);
-    }
+    cJSON_AddNumberToObject(json, "total_lines", (double)total_lines);
+    cJSON_AddNumberToObject(json, "offset", (double)line_offset);
+    cJSON_AddNumberToObject(json, "lines_read", (double)lines_read);
+    cJSON_AddStringToObject(json, "content", content.data);
+    free(content.data);
 
     /* Add note if there are more lines */
-    if (line_offset + lines_read < total_lines) {
+    size_t next = line_offset + lines_read;
+    if (next < total_lines) {
         char note[256];
         snprintf(note, sizeof(note),
-                 "File has more lines. Use offset=%d to read beyond line %d",
-                 line_offset + lines_read, line_offset + lines_read);
+                 "File has more lines. Use offset=%zu to read beyond line %zu",
+                 next, next);
         cJSON_AddStringToObject(json, "note", note);
     }
 
-    free(content);
     return json_result_read(json);
 }
@@ -0,0 +1,328 @@
+/**
+ * @file tool_webfetch.c
+ * @brief Webfetch Tool Implementation
+ *
+ * Fetches a URL through the on-disk HTTP cache of arc/http_cache.h, so
+ * pages read again in a session (or a later one) cost a 304 at most, and
+ * converts HTML to Markdown or plain text as it is fed through. Text
+ * formats are passed through; binary content is refused.
+ */
+
+#include "code_tools.h"
+#include <arc/html_markdown.h>
+#include <arc/http_cache.h>
+#include <arc/sandbox.h>
+#include <cJSON.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/*============================================================================
+ * State
+ *============================================================================*/
+
+extern struct ac_sandbox *code_tools_get_sandbox(void);
+
+static ac_http_cache_t *g_web_cache = NULL;     /* Opened on first use */
+static int g_web_cache_timeout_ms = 0;          /* Timeout g_web_cache was opened with */
+
+#define MAX_CONTENT         (100 * 1024)
+#define FEED_CHUNK          (16 * 1024)
+#define DEFAULT_TIMEOUT_S   30
+#define MAX_TIMEOUT_S       120
+
+/*============================================================================
+ * Helper Functions
+ *============================================================================*/
+
+static char *g_webfetch_result = NULL;
+
+static const char *json_result_webfetch(cJSON *json) {
+    if (!json) {
+        return "{\"error\": \"Failed to create response\"}";
+    }
+
+    char *str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+
+    if (!str) {
+        return "{\"error\": \"Failed to serialize response\"}";
+    }
+
+    free(g_webfetch_result);
+    g_webfetch_result = str;
+    return g_webfetch_result;
+}
+
+static const char *json_error_webfetch(const char *msg) {
+    cJSON *json = cJSON_CreateObject();
+    if (json) {
+        cJSON_AddStringToObject(json, "error", msg);
+    }
+    return json_result_webfetch(json);
+}
+
+void code_tools_close_webfetch(void) {
+    ac_http_cache_close(g_web_cache);
+    g_web_cache = NULL;
+}
+
+static ac_http_cache_t *web_cache(int timeout_ms) {
+    if (g_web_cache && g_web_cache_timeout_ms != timeout_ms) {
+        code_tools_close_webfetch();
+    }
+    if (g_web_cache) return g_web_cache;
+
+    ac_http_cache_options_t options = { .timeout_ms = timeout_ms };
+    if (ac_http_cache_open(&options, &g_web_cache) != ARC_OK) {
+        g_web_cache = NULL;
+        return NULL;
+    }
+    g_web_cache_timeout_ms = timeout_ms;
+    return g_web_cache;
+}
+
+/*============================================================================
+ * URLs and Content Types
+ *============================================================================*/
+
+static int is_loopback(const char *host, size_t len) {
+    return (len == 9 && strncasecmp(host, "localhost", 9) == 0) ||
+           (len >= 4 && strncmp(host, "127.", 4) == 0) ||
+           (len == 5 && strncmp(host, "[::1]", 5) == 0);
+}
+
+/* The URL to fetch: http upgraded to https except on this machine; NULL if unusable */
+static char *normalize_url(const char *url, const char **reason) {
+    while (isspace((unsigned char)*url)) url++;
+    size_t len = strlen(url);
+    while (len > 0 && isspace((unsigned char)url[len - 1])) len--;
+
+    size_t scheme_len;
+    if (len > 8 && strncasecmp(url, "https://", 8) == 0) {
+        scheme_len = 8;
+    } else if (len > 7 && strncasecmp(url, "http://", 7) == 0) {
+        scheme_len = 7;
+    } else {
+        *reason = "URL must start with http:// or https://";
+        return NULL;
+    }
+
+    /* Host, without user info and port */
+    const char *rest = url + scheme_len;
+    size_t authority = strcspn(rest, "/?#");
+    if (authority > len - scheme_len) authority = len - scheme_len;
+    const char *host = rest;
+    for (const char *p = rest; p < rest + authority; p++) {
+        if (*p == '@') host = p + 1;
+    }
+    size_t host_len = (size_t)(rest + authority - host);
+    if (host[0] == '[') {
+        const char *bracket = memchr(host, ']', host_len);
+        if (bracket) host_len = (size_t)(bracket - host) + 1;
+    } else {
+        const char *colon = memchr(host, ':', host_len);
+        if (colon) host_len = (size_t)(colon - host);
+    }
+    if (host_len == 0) {
+        *reason = "URL has no host";
+        return NULL;
+    }
+
+    int https = scheme_len == 8 || !is_loopback(host, host_len);
+    size_t size = len - scheme_len + 9;
+    char *out = malloc(size);
+    if (!out) {
+        *reason = "Out of memory";
+        return NULL;
+    }
+    snprintf(out, size, "%s%.*s", https ? "https://" : "http://", (int)(len - scheme_len), rest);
+    return out;
+}
+
+typedef enum {
+    CONTENT_HTML,
+    CONTENT_TEXT,
+    CONTENT_BINARY,
+} content_kind_t;
+
+static content_kind_t content_kind(const char *content_type, const char *body, size_t size) {
+    size_t len = strcspn(content_type, ";");
+    while (len > 0 && isspace((unsigned char)content_type[len - 1])) len--;
+
+    if ((len == 9 && strncasecmp(content_type, "text/html", 9) == 0) ||
+        (len == 21 && strncasecmp(content_type, "application/xhtml+xml", 21) == 0)) {
+        return CONTENT_HTML;
+    }
+    int textual = len == 0 ||
+                  strncasecmp(content_type, "text/", 5) == 0 ||
+                  (len >= 5 && strncasecmp(content_type + len - 5, "+json", 5) == 0) ||
+                  (len >= 4 && strncasecmp(content_type + len - 4, "+xml", 4) == 0) ||
+                  (len == 16 && strncasecmp(content_type, "application/json", 16) == 0) ||
+                  (len == 15 && strncasecmp(content_type, "application/xml", 15) == 0) ||
+                  (len == 22 && strncasecmp(content_type, "application/javascript", 22) == 0);
+    /* Untyped or mistyped: sniff */
+    if (!textual || memchr(body, '\0', size)) return CONTENT_BINARY;
+    if (len == 0) {
+        const char *p = body;
+        while (p < body + size && isspace((unsigned char)*p)) p++;
+        if (strncasecmp(p, "<!doctype html", 14) == 0 || strncasecmp(p, "<html", 5) == 0) return CONTENT_HTML;
+    }
+    return CONTENT_TEXT;
+}
+
+/* Value of the charset parameter, copied into out ("" if none) */
+static void content_charset(const char *content_type, char *out, size_t size) {
+    out[0] = '\0';
+    const char *p = content_type;
+    while (*p && strncasecmp(p, "charset=", 8) != 0) p++;
+    if (!*p) return;
+    p += 8;
+    if (*p == '"') p++;
+    size_t len = strcspn(p, "\"; ");
+    if (len >= size) len = size - 1;
+    memcpy(out, p, len);
+    out[len] = '\0';
+}
+
+/* Length of at most max bytes of s that does not split a UTF-8 sequence */
+static size_t utf8_prefix(const char *s, size_t len, size_t max) {
+    if (len <= max) return len;
+    size_t n = max;
+    while (n > 0 && ((unsigned char)s[n] & 0xC0) == 0x80) n--;
+    return n;
+}
+
+static const char *source_name(ac_http_source_t source) {
+    switch (source) {
+        case AC_HTTP_FROM_CACHE:  return "cache";
+        case AC_HTTP_REVALIDATED: return "revalidated";
+        default:                  return "network";
+    }
+}
+
+/*============================================================================
+ * Tool
+ *============================================================================*/
+
+const char *webfetch(const char *url, const char *format, int timeout) {
+    if (!url || !url[0]) {
+        return json_error_webfetch("url is required");
+    }
+
+    int markdown = 1, raw = 0;
+    if (format && format[0]) {
+        if (strcmp(format, "text") == 0) {
+            markdown = 0;
+        } else if (strcmp(format, "html") == 0) {
+            raw = 1;
+        } else if (strcmp(format, "markdown") != 0) {
+            return json_error_webfetch("format must be markdown, text or html");
+        }
+    }
+    if (timeout <= 0) timeout = DEFAULT_TIMEOUT_S;
+    if (timeout > MAX_TIMEOUT_S) timeout = MAX_TIMEOUT_S;
+
+    const char *reason = NULL;
+    char *target = normalize_url(url, &reason);
+    if (!target) {
+        return json_error_webfetch(reason);
+    }
+
+    /* Sandbox check: the fetch runs in this process, not in a sandboxed command */
+    ac_sandbox_t *sandbox = code_tools_get_sandbox();
+    if (sandbox && !ac_sandbox_check_network(sandbox, target)) {
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "error", "Network access blocked by sandbox");
+        cJSON_AddStringToObject(json, "url", target);
+        cJSON_AddStringToObject(json, "reason", ac_sandbox_denial_reason());
+        free(target);
+        return json_result_webfetch(json);
+    }
+
+    ac_http_cache_t *cache = web_cache(timeout * 1000);
+    if (!cache) {
+        free(target);
+        return json_error_webfetch("Cannot open the web cache directory");
+    }
+
+    ac_http_fetch_t fetch;
+    arc_err_t err = ac_http_cache_fetch(cache, target, &fetch);
+    if (err != ARC_OK) {
+        char msg[640];
+        snprintf(msg, sizeof(msg), "Failed to fetch %s: %s", target, ac_http_cache_error(cache));
+        free(target);
+        return json_error_webfetch(msg);
+    }
+
+    content_kind_t kind = content_kind(fetch.content_type, fetch.body, fetch.size);
+    if (kind == CONTENT_BINARY) {
+        char msg[512];
+        snprintf(msg, sizeof(msg), "Cannot show binary content (%s)",
+                 fetch.content_type[0] ? fetch.content_type : "no content type");
+        ac_http_fetch_free(&fetch);
+        free(target);
+        return json_error_webfetch(msg);
+    }
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "url", target);
+    cJSON_AddStringToObject(json, "final_url", fetch.url);
+    cJSON_AddNumberToObject(json, "status", fetch.status);
+    cJSON_AddStringToObject(json, "content_type", fetch.content_type);
+    cJSON_AddStringToObject(json, "source", source_name(fetch.source));
+    if (fetch.stale) {
+        cJSON_AddBoolToObject(json, "stale", 1);
+    }
+
+    int truncated = 0;
+    if (kind == CONTENT_HTML && !raw) {
+        char charset[64];
+        content_charset(fetch.content_type, charset, sizeof(charset));
+        ac_html_md_options_t options = {
+            .format = markdown ? AC_HTML_MD_MARKDOWN : AC_HTML_MD_TEXT,
+            .base_url = fetch.url,
+            .charset = charset[0] ? charset : NULL,
+            .max_output = MAX_CONTENT,
+        };
+        ac_html_md_t *conv = NULL;
+        if (ac_html_md_create(&options, &conv) != ARC_OK) {
+            cJSON_Delete(json);
+            ac_http_fetch_free(&fetch);
+            free(target);
+            return json_error_webfetch("Out of memory");
+        }
+        for (size_t off = 0; off < fetch.size && !ac_html_md_truncated(conv); off += FEED_CHUNK) {
+            size_t n = fetch.size - off < FEED_CHUNK ? fetch.size - off : FEED_CHUNK;
+            ac_html_md_feed(conv, fetch.body + off, n);
+        }
+        const char *content = ac_html_md_finish(conv, NULL);
+        truncated = ac_html_md_truncated(conv);
+        if (ac_html_md_title(conv)[0]) {
+            cJSON_AddStringToObject(json, "title", ac_html_md_title(conv));
+        }
+        cJSON_AddStringToObject(json, "content", content);
+        ac_html_md_free(conv);
+    } else {
+        size_t len = utf8_prefix(fetch.body, fetch.size, MAX_CONTENT);
+        truncated = len < fetch.size;
+        char saved = fetch.body[len];
+        fetch.body[len] = '\0';
+        cJSON_AddStringToObject(json, "content", fetch.body);
+        fetch.body[len] = saved;
+    }
+    if (truncated) {
+        cJSON_AddBoolToObject(json, "truncated", 1);
+    }
+    if (fetch.status >= 400) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "HTTP %d", fetch.status);
+        cJSON_AddStringToObject(json, "error", msg);
+    }
+
+    ac_http_fetch_free(&fetch);
+    free(target);
+    return json_result_webfetch(json);
+}
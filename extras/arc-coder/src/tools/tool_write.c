@@ -5,6 +5,7 @@
 
 #include "code_tools.h"
 #include <arc/sandbox.h>
+#include <arc/textfile.h>
 #include <cJSON.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -129,6 +130,9 @@ const char *write_file(
         free(path_copy);
     }
 
+    /* Cached contents may be mapped: drop them before truncating the file */
+    ac_textfile_cache_invalidate(code_tools_get_file_cache(), filePath);
+
     /* Write file */
     FILE *fp = fopen(filePath, "w");
     if (!fp) {
@@ -151,6 +155,7 @@ const char *write_file(
         cJSON_AddNumberToObject(json, "written", (double)written);
         return json_result_write(json);
     }
+    code_tools_lsp_file_changed(filePath);
 
     /* Count lines */
     int line_count = 1;
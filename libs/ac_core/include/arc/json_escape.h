@@ -0,0 +1,79 @@
+/**
+ * @file json_escape.h
+ * @brief Single-pass JSON string escaping with UTF-8 validation
+ *
+ * Escapes a byte string for use inside a JSON string literal and repairs
+ * invalid UTF-8 in the same pass. Ill-formed sequences (overlongs,
+ * surrogates, truncated or stray bytes) are replaced with U+FFFD, so
+ * command output or binary-ish tool results never produce a request body
+ * that the provider rejects.
+ *
+ * Runs of bytes that need no escaping are processed 16/32 bytes at a time
+ * (SSE2/AVX2 on x86, NEON on ARM), with a portable scalar fallback.
+ *
+ * Used by cJSON's string printer (request bodies) and the trace exporters.
+ *
+ * @code
+ * char buf[4096];
+ * size_t pos = 0;
+ * while (pos < len) {
+ *     size_t used = 0;
+ *     size_t n = ac_json_escape(buf, sizeof(buf), str + pos, len - pos, &used, NULL);
+ *     fwrite(buf, 1, n, f);
+ *     pos += used;
+ * }
+ * @endcode
+ */
+
+#ifndef ARC_JSON_ESCAPE_H
+#define ARC_JSON_ESCAPE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Worst-case escaped size of `len` input bytes (without quotes)
+ *
+ * Every control byte expands to a 6-byte \u00XX escape.
+ */
+#define AC_JSON_ESCAPE_MAX(len) ((len) * 6)
+
+/**
+ * @brief Minimum output capacity that guarantees progress
+ */
+#define AC_JSON_ESCAPE_MIN_OUT 8
+
+/**
+ * @brief Escape a string for JSON output and repair invalid UTF-8
+ *
+ * Writes the escaped form of `in` (no surrounding quotes, no NUL) to `out`.
+ * Stops early when `out` is full; escapes and UTF-8 sequences are never
+ * split, so the caller can flush `out` and continue at `in + *consumed`.
+ *
+ * @param out       Output buffer
+ * @param out_cap   Output capacity (>= AC_JSON_ESCAPE_MIN_OUT)
+ * @param in        Input bytes (may contain NUL, escaped as \u0000)
+ * @param in_len    Input length
+ * @param consumed  Receives the number of input bytes processed
+ * @param replaced  Optional; incremented per U+FFFD substitution
+ * @return Number of bytes written to out
+ */
+size_t ac_json_escape(char *out, size_t out_cap,
+                      const char *in, size_t in_len,
+                      size_t *consumed, size_t *replaced);
+
+/**
+ * @brief Name of the implementation selected at runtime
+ *
+ * @return "avx2", "sse2", "neon" or "scalar"
+ */
+const char *ac_json_escape_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_JSON_ESCAPE_H */
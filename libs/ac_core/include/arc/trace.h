@@ -19,6 +19,16 @@
  * // Run agent - trace events will be emitted
  * ac_agent_run(agent, "Hello");
  *
+ * // Production: trace 10% of runs, keep only slow or failed ones,
+ * // and cap tool results at 4KB
+ * ac_trace_set_config(&(ac_trace_config_t){
+ *     .sample_rate = 0.1,
+ *     .tail_sampling = 1,
+ *     .tail_min_duration_ms = 30000,
+ *     .tail_keep_errors = 1,
+ *     .max_tool_bytes = 4096,
+ * });
+ *
  * // Disable tracing
  * ac_trace_disable();
  * @endcode
@@ -145,6 +155,60 @@ typedef void (*ac_trace_handler_t)(
     void *user_data
 );
 
+/*============================================================================
+ * Sampling and Payload Budgets
+ *============================================================================*/
+
+/**
+ * @brief Trace capture policy
+ *
+ * Controls which runs are traced and how much payload each event carries,
+ * so tracing can stay enabled in production at a bounded cost.
+ *
+ * - Head sampling decides at agent_start whether a run is traced at all,
+ *   from a hash of the random part of the run's trace ID, so the decision
+ *   is reproducible from the ID alone. Unsampled runs skip all capture
+ *   work, including message serialization.
+ * - Tail sampling buffers a sampled run in memory and only delivers it to
+ *   the handler at agent_end if it was slow or failed.
+ * - Byte budgets truncate large payloads at capture time. Truncated JSON
+ *   payloads are replaced by a JSON string so exporters stay valid.
+ *
+ * Zero-initialized fields select the default (trace everything in full).
+ */
+typedef struct {
+    double sample_rate;             /**< Fraction of runs traced; <= 0 or >= 1 traces all */
+    uint64_t sample_seed;           /**< Seed for trace IDs and so sampling (0 = from the clock) */
+    int tail_sampling;              /**< Buffer runs, deliver only retained ones (default: 0) */
+    uint64_t tail_min_duration_ms;  /**< Retain runs lasting at least this long (0 = off) */
+    int tail_keep_errors;           /**< Retain runs with failed tools or no final content */
+    size_t tail_max_buffer_bytes;   /**< Per-run buffer cap; later events are dropped (default: 8MB) */
+    size_t max_text_bytes;          /**< Budget for message/instructions/content (0 = unlimited) */
+    size_t max_messages_bytes;      /**< Budget for messages_json/tools_json (0 = unlimited) */
+    size_t max_tool_bytes;          /**< Budget for tool arguments/results/tool_calls_json (0 = unlimited) */
+} ac_trace_config_t;
+
+#define AC_TRACE_DEFAULT_TAIL_BUFFER (8 * 1024 * 1024)
+
+/**
+ * @brief Set the trace capture policy
+ *
+ * Can be called before or after ac_trace_enable(); takes effect at the
+ * next agent_start. The policy survives ac_trace_disable(). A nonzero
+ * sample_seed restarts the tracer's ID generator, so the same seed yields
+ * the same sequence of sampling decisions.
+ *
+ * @param config Policy, or NULL to restore defaults
+ */
+void ac_trace_set_config(const ac_trace_config_t *config);
+
+/**
+ * @brief Get the current trace capture policy
+ *
+ * @param config Receives the policy
+ */
+void ac_trace_get_config(ac_trace_config_t *config);
+
 /*============================================================================
  * Trace API
  *============================================================================*/
@@ -196,6 +260,8 @@ uint64_t ac_trace_timestamp_ms(void);
 /**
  * @brief Generate a unique trace ID
  *
+ * Uses the tracer's own generator (see sample_seed), never rand().
+ *
  * @param buffer Output buffer (at least 32 bytes)
  * @param size   Buffer size
  * @return Pointer to buffer, or NULL on error
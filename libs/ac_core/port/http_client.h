@@ -60,6 +60,7 @@ typedef struct {
     size_t body_len;                    /* Body length (0 = strlen if body is string) */
     uint32_t timeout_ms;                /* Request timeout in milliseconds */
     int verify_ssl;                     /* 1 = verify SSL cert, 0 = skip (dev only) */
+    int keep_headers;                   /* 1 = fill response->headers */
 } arc_http_request_t;
 
 /*============================================================================
@@ -68,7 +69,7 @@ typedef struct {
 
 typedef struct {
     int status_code;                    /* HTTP status code (200, 404, etc.) */
-    arc_http_header_t *headers;      /* Response headers */
+    arc_http_header_t *headers;      /* Response headers (if keep_headers) */
     char *body;                         /* Response body (caller must free) */
     size_t body_len;                    /* Body length */
     char *error_msg;                    /* Error message if failed (caller must free) */
@@ -93,6 +93,69 @@ static size_t stream_callback(void *contents, size_t size, size_t nmemb, void *u
     return realsize;
 }
 
+/* Headers of the last response: curl reports those of every hop */
+static size_t header_callback(char *line, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    arc_http_header_t **list = (arc_http_header_t **)userp;
+
+    if (realsize >= 5 && strncmp(line, "HTTP/", 5) == 0) {
+        arc_http_header_free(*list);
+        *list = NULL;
+        return realsize;
+    }
+
+    const char *colon = memchr(line, ':', realsize);
+    if (!colon || colon == line) {
+        return realsize;                /* Blank line ending the headers */
+    }
+
+    char name[128];
+    size_t name_len = (size_t)(colon - line);
+    if (name_len >= sizeof(name)) {
+        return realsize;
+    }
+    memcpy(name, line, name_len);
+    name[name_len] = '\0';
+
+    const char *value = colon + 1;
+    const char *end = line + realsize;
+    while (value < end && (*value == ' ' || *value == '\t')) value++;
+    while (end > value && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' ')) end--;
+
+    char *value_copy = ARC_MALLOC((size_t)(end - value) + 1);
+    if (!value_copy) {
+        return realsize;
+    }
+    memcpy(value_copy, value, (size_t)(end - value));
+    value_copy[end - value] = '\0';
+
+    arc_http_header_append(list, arc_http_header_create(name, value_copy));
+    ARC_FREE(value_copy);
+    return realsize;
+}
+
+static arc_err_t curl_error_code(CURLcode res) {
+    if (res == CURLE_OPERATION_TIMEDOUT) {
+        return ARC_ERR_TIMEOUT;
+    } else if (res == CURLE_COULDNT_RESOLVE_HOST) {
+        return ARC_ERR_DNS;
+    } else if (res == CURLE_SSL_CONNECT_ERROR || res == CURLE_SSL_CERTPROBLEM) {
+        return ARC_ERR_TLS;
+    }
+    return ARC_ERR_NETWORK;
+}
+
+/* Whatever a URL or a redirect names, speak nothing but HTTP */
+static void restrict_protocols(CURL *curl) {
+#if LIBCURL_VERSION_NUM >= 0x075500
+    curl_easy_setopt(curl, CURLOPT_PROTOCOLS_STR, "http,https");
+    curl_easy_setopt(curl, CURLOPT_REDIR_PROTOCOLS_STR, "http,https");
+#else
+    curl_easy_setopt(curl, CURLOPT_PROTOCOLS, (long)(CURLPROTO_HTTP | CURLPROTO_HTTPS));
+    curl_easy_setopt(curl, CURLOPT_REDIR_PROTOCOLS, (long)(CURLPROTO_HTTP | CURLPROTO_HTTPS));
+#endif
+}
+
 static int s_curl_refcount = 0;
 static pthread_mutex_t s_curl_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -218,6 +281,7 @@ arc_err_t arc_http_request(
 
     /* Set URL */
     curl_easy_setopt(curl, CURLOPT_URL, request->url);
+    restrict_protocols(curl);
 
     /* Set method and body */
     switch (request->method) {
@@ -290,6 +354,10 @@ arc_err_t arc_http_request(
     /* Set callbacks */
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
+    if (request->keep_headers) {
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response->headers);
+    }
 
     /* Perform request */
     AC_LOG_DEBUG("HTTP %s %s",
@@ -316,15 +384,7 @@ arc_err_t arc_http_request(
         }
 
         response->error_msg = ARC_STRDUP(err_msg);
-
-        if (res == CURLE_OPERATION_TIMEDOUT) {
-            return ARC_ERR_TIMEOUT;
-        } else if (res == CURLE_COULDNT_RESOLVE_HOST) {
-            return ARC_ERR_DNS;
-        } else if (res == CURLE_SSL_CONNECT_ERROR || res == CURLE_SSL_CERTPROBLEM) {
-            return ARC_ERR_TLS;
-        }
-        return ARC_ERR_NETWORK;
+        return curl_error_code(res);
     }
 
     /* Get response code */
@@ -368,6 +428,7 @@ arc_err_t arc_http_request_stream(
 
     /* Set URL */
     curl_easy_setopt(curl, CURLOPT_URL, request->base.url);
+    restrict_protocols(curl);
 
     /* Set method and body */
     if (request->base.method == ARC_HTTP_POST) {
@@ -405,6 +466,10 @@ arc_err_t arc_http_request_stream(
     /* Streaming callback */
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, stream_callback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ctx);
+    if (request->base.keep_headers) {
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response->headers);
+    }
 
     /* Perform request */
     AC_LOG_DEBUG("HTTP stream POST %s", request->base.url);
@@ -418,7 +483,7 @@ arc_err_t arc_http_request_stream(
     if (res != CURLE_OK && !ctx.aborted) {
         const char *err_msg = curl_easy_strerror(res);
         response->error_msg = ARC_STRDUP(err_msg);
-        return ARC_ERR_NETWORK;
+        return curl_error_code(res);
     }
 
     long http_code = 0;
@@ -0,0 +1,444 @@
+/**
+ * @file json_escape.c
+ * @brief Single-pass JSON escaping with UTF-8 validation
+ *
+ * The hot loop loads a vector of input, checks whether every byte is
+ * "plain" (printable ASCII other than '"' and '\\'), and if so stores it to
+ * the output unchanged. Once a vector contains a non-plain byte, the next
+ * vector width of input is handled by a table-driven scalar loop that emits
+ * escapes and validates multi-byte UTF-8 (RFC 3629: no overlongs,
+ * surrogates or code points above U+10FFFF), then the vector scan resumes.
+ */
+
+#include "arc/json_escape.h"
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define JSON_ESCAPE_X86 1
+#include <emmintrin.h>
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(ARC_NO_AVX2)
+#define JSON_ESCAPE_AVX2 1
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define JSON_ESCAPE_NEON 1
+#include <arm_neon.h>
+#endif
+
+/*============================================================================
+ * Scalar Units
+ *============================================================================*/
+
+static const char s_hex[] = "0123456789abcdef";
+
+static inline int is_plain(unsigned char c) {
+    return c >= 0x20 && c < 0x80 && c != '"' && c != '\\';
+}
+
+/**
+ * Length of a well-formed UTF-8 sequence at p, or 0 if ill-formed.
+ * On failure *bad is set to the length of the maximal invalid subpart,
+ * which is replaced by a single U+FFFD.
+ */
+static size_t utf8_sequence(const unsigned char *p, size_t avail, size_t *bad) {
+    unsigned char c = p[0];
+    size_t need;
+    unsigned char lo = 0x80, hi = 0xBF;
+
+    if (c >= 0xC2 && c <= 0xDF) {
+        need = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        need = 3;
+        if (c == 0xE0) lo = 0xA0;
+        if (c == 0xED) hi = 0x9F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        need = 4;
+        if (c == 0xF0) lo = 0x90;
+        if (c == 0xF4) hi = 0x8F;
+    } else {
+        *bad = 1;
+        return 0;
+    }
+
+    size_t i = 1;
+    for (; i < need && i < avail; i++) {
+        unsigned char b = p[i];
+        if (i == 1 ? (b < lo || b > hi) : (b & 0xC0) != 0x80) {
+            break;
+        }
+    }
+    if (i == need) {
+        return need;
+    }
+    *bad = i;
+    return 0;
+}
+
+/**
+ * Emit one non-plain unit at in[0]. Returns input bytes consumed, or 0 if
+ * the output has no room (caller stops).
+ */
+static inline size_t escape_unit(const unsigned char *in, size_t avail,
+                                 char *out, size_t room, size_t *written,
+                                 size_t *replaced) {
+    unsigned char c = in[0];
+
+    if (c < 0x80) {
+        char esc = 0;
+        switch (c) {
+            case '"':  esc = '"'; break;
+            case '\\': esc = '\\'; break;
+            case '\b': esc = 'b'; break;
+            case '\f': esc = 'f'; break;
+            case '\n': esc = 'n'; break;
+            case '\r': esc = 'r'; break;
+            case '\t': esc = 't'; break;
+            default: break;
+        }
+        if (esc) {
+            if (room < 2) return 0;
+            out[0] = '\\';
+            out[1] = esc;
+            *written = 2;
+        } else if (c < 0x20) {
+            if (room < 6) return 0;
+            memcpy(out, "\\u00", 4);
+            out[4] = s_hex[c >> 4];
+            out[5] = s_hex[c & 0xF];
+            *written = 6;
+        } else {
+            if (room < 1) return 0;
+            out[0] = (char)c;
+            *written = 1;
+        }
+        return 1;
+    }
+
+    size_t bad = 0;
+    size_t n = utf8_sequence(in, avail, &bad);
+    if (n) {
+        if (room < n) return 0;
+        memcpy(out, in, n);
+        *written = n;
+        return n;
+    }
+
+    /* U+FFFD REPLACEMENT CHARACTER */
+    if (room < 3) return 0;
+    out[0] = (char)0xEF;
+    out[1] = (char)0xBF;
+    out[2] = (char)0xBD;
+    *written = 3;
+    if (replaced) (*replaced)++;
+    return bad;
+}
+
+/*============================================================================
+ * Escape Loops
+ *
+ * One loop per instruction set so the vector constants stay in registers.
+ * The vector step stores a whole vector and then advances only past the
+ * plain prefix, so it only runs while a full vector of input and output
+ * room remain.
+ *============================================================================*/
+
+typedef size_t (*escape_fn)(char *out, size_t out_cap,
+                            const unsigned char *in, size_t in_len,
+                            size_t *consumed, size_t *replaced);
+
+static inline unsigned ctz32(uint32_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(v);
+#else
+    unsigned n = 0;
+    while (!(v & 1)) { v >>= 1; n++; }
+    return n;
+#endif
+}
+
+/*
+ * Per-byte class for the scalar loop: 0 = plain, a letter for the short
+ * escape \X, 'u' for \u00XX, 'x' for the start of a non-ASCII unit.
+ */
+static const unsigned char s_escape_class[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+#define X8 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x'
+    X8, X8, X8, X8, X8, X8, X8, X8, X8, X8, X8, X8, X8, X8, X8, X8
+#undef X8
+};
+
+/**
+ * Scalar escape of in[*pi .. end). Dense regions (nested JSON, CJK text)
+ * are cheaper here than restarting the vector scan at every unit.
+ * Returns 0 when the output is full.
+ */
+static inline int escape_span(char *out, size_t out_cap,
+                              const unsigned char *in, size_t in_len,
+                              size_t *pi, size_t *po, size_t end,
+                              size_t *replaced) {
+    size_t i = *pi, o = *po;
+    int ok = 1;
+
+    /* Worst case fits (a UTF-8 unit may run 3 bytes past end): no checks */
+    if (out_cap - o >= AC_JSON_ESCAPE_MAX(end - i) + 4) {
+        while (i < end) {
+            unsigned char c = in[i];
+            unsigned char cls = s_escape_class[c];
+            if (!cls) {
+                out[o++] = (char)c;
+                i++;
+            } else if (cls == 'u') {
+                memcpy(out + o, "\\u00", 4);
+                out[o + 4] = s_hex[c >> 4];
+                out[o + 5] = s_hex[c & 0xF];
+                o += 6;
+                i++;
+            } else if (cls != 'x') {
+                out[o] = '\\';
+                out[o + 1] = (char)cls;
+                o += 2;
+                i++;
+            } else if (c >= 0xE1 && c != 0xED && c <= 0xEF && in_len - i >= 3 &&
+                       (in[i + 1] & 0xC0) == 0x80 && (in[i + 2] & 0xC0) == 0x80) {
+                /* Common 3-byte case (CJK etc.); E0/ED need range checks */
+                out[o] = (char)c;
+                out[o + 1] = (char)in[i + 1];
+                out[o + 2] = (char)in[i + 2];
+                o += 3;
+                i += 3;
+            } else if (c >= 0xC2 && c <= 0xDF && in_len - i >= 2 &&
+                       (in[i + 1] & 0xC0) == 0x80) {
+                out[o] = (char)c;
+                out[o + 1] = (char)in[i + 1];
+                o += 2;
+                i += 2;
+            } else {
+                size_t written = 0;
+                i += escape_unit(in + i, in_len - i, out + o, 4, &written, replaced);
+                o += written;
+            }
+        }
+        *pi = i;
+        *po = o;
+        return 1;
+    }
+
+    while (i < end) {
+        unsigned char c = in[i];
+        if (is_plain(c)) {
+            if (o >= out_cap) { ok = 0; break; }
+            out[o++] = (char)c;
+            i++;
+            continue;
+        }
+        size_t written = 0;
+        size_t used = escape_unit(in + i, in_len - i, out + o, out_cap - o,
+                                  &written, replaced);
+        if (used == 0) { ok = 0; break; }
+        i += used;
+        o += written;
+    }
+    *pi = i;
+    *po = o;
+    return ok;
+}
+
+/* After a vector finds a non-plain byte, continue scalar for one vector width */
+#define ESCAPE_SPAN_OR_STOP(width)                                             \
+    do {                                                                       \
+        size_t end_ = in_len - i > (width) ? i + (width) : in_len;             \
+        if (!escape_span(out, out_cap, in, in_len, &i, &o, end_, replaced)) {  \
+            goto done;                                                         \
+        }                                                                      \
+    } while (0)
+
+static size_t escape_scalar(char *out, size_t out_cap,
+                            const unsigned char *in, size_t in_len,
+                            size_t *consumed, size_t *replaced) {
+    size_t i = 0, o = 0;
+
+    escape_span(out, out_cap, in, in_len, &i, &o, in_len, replaced);
+    *consumed = i;
+    return o;
+}
+
+#ifdef JSON_ESCAPE_X86
+static size_t escape_sse2(char *out, size_t out_cap,
+                          const unsigned char *in, size_t in_len,
+                          size_t *consumed, size_t *replaced) {
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    size_t i = 0, o = 0;
+
+    while (i < in_len) {
+        while (in_len - i >= 16 && out_cap - o >= 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+            /* Signed compare: bytes >= 0x80 are negative, so this catches
+             * both control characters and non-ASCII */
+            __m128i special = _mm_or_si128(
+                _mm_cmplt_epi8(v, space),
+                _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)));
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(special);
+
+            _mm_storeu_si128((__m128i *)(out + o), v);
+            if (mask) {
+                unsigned k = ctz32(mask);
+                i += k;
+                o += k;
+                break;
+            }
+            i += 16;
+            o += 16;
+        }
+        if (i >= in_len) break;
+        ESCAPE_SPAN_OR_STOP(16);
+    }
+done:
+    *consumed = i;
+    return o;
+}
+#endif
+
+#ifdef JSON_ESCAPE_AVX2
+__attribute__((target("avx2")))
+static size_t escape_avx2(char *out, size_t out_cap,
+                          const unsigned char *in, size_t in_len,
+                          size_t *consumed, size_t *replaced) {
+    const __m256i space = _mm256_set1_epi8(0x20);
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i bslash = _mm256_set1_epi8('\\');
+    size_t i = 0, o = 0;
+
+    while (i < in_len) {
+        while (in_len - i >= 32 && out_cap - o >= 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+            __m256i special = _mm256_or_si256(
+                _mm256_cmpgt_epi8(space, v),
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, bslash)));
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(special);
+
+            _mm256_storeu_si256((__m256i *)(out + o), v);
+            if (mask) {
+                unsigned k = ctz32(mask);
+                i += k;
+                o += k;
+                break;
+            }
+            i += 32;
+            o += 32;
+        }
+        if (i >= in_len) break;
+        ESCAPE_SPAN_OR_STOP(32);
+    }
+done:
+    *consumed = i;
+    return o;
+}
+#endif
+
+#ifdef JSON_ESCAPE_NEON
+static size_t escape_neon(char *out, size_t out_cap,
+                          const unsigned char *in, size_t in_len,
+                          size_t *consumed, size_t *replaced) {
+    const uint8x16_t space = vdupq_n_u8(0x20);
+    const uint8x16_t high = vdupq_n_u8(0x80);
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t bslash = vdupq_n_u8('\\');
+    size_t i = 0, o = 0;
+
+    while (i < in_len) {
+        while (in_len - i >= 16 && out_cap - o >= 16) {
+            uint8x16_t v = vld1q_u8(in + i);
+            uint8x16_t special = vorrq_u8(
+                vorrq_u8(vcltq_u8(v, space), vcgeq_u8(v, high)),
+                vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, bslash)));
+            /* Narrow to a 64-bit mask with 4 bits per byte */
+            uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+                vshrn_n_u16(vreinterpretq_u16_u8(special), 4)), 0);
+
+            vst1q_u8((uint8_t *)(out + o), v);
+            if (mask) {
+                unsigned k = (unsigned)__builtin_ctzll(mask) >> 2;
+                i += k;
+                o += k;
+                break;
+            }
+            i += 16;
+            o += 16;
+        }
+        if (i >= in_len) break;
+        ESCAPE_SPAN_OR_STOP(16);
+    }
+done:
+    *consumed = i;
+    return o;
+}
+#endif
+
+/*============================================================================
+ * Dispatch
+ *============================================================================*/
+
+static escape_fn s_escape = NULL;
+static const char *s_impl_name = "scalar";
+
+static void select_impl(void) {
+    escape_fn fn = escape_scalar;
+    const char *name = "scalar";
+
+#if defined(JSON_ESCAPE_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        fn = escape_avx2;
+        name = "avx2";
+    } else {
+        fn = escape_sse2;
+        name = "sse2";
+    }
+#elif defined(JSON_ESCAPE_X86)
+    fn = escape_sse2;
+    name = "sse2";
+#elif defined(JSON_ESCAPE_NEON)
+    fn = escape_neon;
+    name = "neon";
+#endif
+
+    /* Benign race: every thread selects the same implementation */
+    s_impl_name = name;
+    s_escape = fn;
+}
+
+const char *ac_json_escape_impl(void) {
+    if (!s_escape) {
+        select_impl();
+    }
+    return s_impl_name;
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+size_t ac_json_escape(char *out, size_t out_cap,
+                      const char *in, size_t in_len,
+                      size_t *consumed, size_t *replaced) {
+    size_t used = 0;
+    size_t n;
+
+    if (!s_escape) {
+        select_impl();
+    }
+
+    n = s_escape(out, out_cap, (const unsigned char *)in, in_len, &used, replaced);
+    if (consumed) *consumed = used;
+    return n;
+}
@@ -9,6 +9,7 @@
 #include "arc/trace.h"
 #include "arc/agent_hooks.h"
 #include "arc/platform.h"
+#include "arc/json_escape.h"
 #include "llm/message/message_json.h"
 #include <stdio.h>
 #include <string.h>
@@ -33,12 +34,40 @@ static const char *s_event_names[] = {
  * Trace Context
  *============================================================================*/
 
+/* Upper bound on string fields in one event (trace_id, agent_name + data) */
+#define TRACE_MAX_STR_FIELDS 8
+
+/**
+ * Event captured with its own copies of any strings that had to be
+ * truncated or must outlive the hook callback (tail sampling).
+ */
+typedef struct trace_captured {
+    struct trace_captured *next;
+    ac_trace_event_t event;
+    char *owned[TRACE_MAX_STR_FIELDS];
+    int owned_count;
+    size_t bytes;
+} trace_captured_t;
+
 typedef struct {
     ac_trace_handler_t handler;
     void *user_data;
     char trace_id[32];
     int sequence;
     int enabled;
+
+    /* Capture policy */
+    ac_trace_config_t config;
+    uint64_t rng;                   /* splitmix64 state for trace IDs (0 = unseeded) */
+
+    /* Current run */
+    int run_sampled;
+    int run_failed;
+
+    /* Tail sampling buffer */
+    trace_captured_t *tail_head;
+    trace_captured_t *tail_last;
+    size_t tail_bytes;
 } trace_ctx_t;
 
 static trace_ctx_t s_ctx = {0};
@@ -51,13 +80,43 @@ uint64_t ac_trace_timestamp_ms(void) {
     return ac_platform_timestamp_ms();
 }
 
+/* splitmix64 finalizer: spreads every input bit over the whole output */
+static uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* Next value of the tracer's generator; seeded from the clock on first use */
+static uint64_t trace_random(void) {
+    if (s_ctx.rng == 0) {
+        uintptr_t local = (uintptr_t)&local;
+        s_ctx.rng = mix64(ac_trace_timestamp_ms() ^ ((uint64_t)local << 16) ^ (uint64_t)(uintptr_t)&s_ctx);
+    }
+    s_ctx.rng += 0x9e3779b97f4a7c15ULL;
+    return mix64(s_ctx.rng);
+}
+
+/*
+ * Head sampling: a uniform value in [0, 1) derived from the random suffix
+ * of the trace ID, so the clock part does not move the decision.
+ */
+static double trace_id_fraction(const char *trace_id) {
+    const char *suffix = strrchr(trace_id, '_');
+    uint64_t h = 0xcbf29ce484222325ULL;             /* FNV-1a */
+    for (const char *p = suffix ? suffix + 1 : trace_id; *p; p++) {
+        h = (h ^ (unsigned char)*p) * 0x100000001b3ULL;
+    }
+    return (double)(mix64(h) >> 11) * (1.0 / 9007199254740992.0);
+}
+
 char *ac_trace_generate_id(char *buffer, size_t size) {
     if (!buffer || size < 32) {
         return NULL;
     }
 
     uint64_t ts = ac_trace_timestamp_ms();
-    unsigned int rand_val = (unsigned int)rand();
+    unsigned int rand_val = (unsigned int)(trace_random() >> 32);
 
     snprintf(buffer, size, "tr_%llx_%08x",
              (unsigned long long)ts, rand_val);
@@ -76,12 +135,244 @@ int ac_trace_is_enabled(void) {
     return s_ctx.enabled && s_ctx.handler != NULL;
 }
 
+/*============================================================================
+ * Internal: Payload Budgets
+ *============================================================================*/
+
+typedef enum {
+    FIELD_ID,          /* trace/agent/tool ids and names: never truncated */
+    FIELD_TEXT,        /* free text */
+    FIELD_MESSAGES,    /* messages/tools JSON */
+    FIELD_TOOL         /* tool arguments/results/tool_calls JSON */
+} trace_field_class_t;
+
+typedef struct {
+    const char **ptr;
+    trace_field_class_t cls;
+} trace_field_t;
+
+/**
+ * List the string fields of an event with their budget class.
+ */
+static int event_fields(ac_trace_event_t *ev, trace_field_t *out) {
+    int n = 0;
+
+#define FIELD(p, c) do { out[n].ptr = &(p); out[n].cls = (c); n++; } while (0)
+    FIELD(ev->agent_name, FIELD_ID);
+
+    switch (ev->type) {
+        case AC_TRACE_AGENT_START:
+            FIELD(ev->data.agent_start.message, FIELD_TEXT);
+            FIELD(ev->data.agent_start.instructions, FIELD_TEXT);
+            break;
+        case AC_TRACE_AGENT_END:
+            FIELD(ev->data.agent_end.content, FIELD_TEXT);
+            break;
+        case AC_TRACE_LLM_REQUEST:
+            FIELD(ev->data.llm_request.model, FIELD_ID);
+            FIELD(ev->data.llm_request.messages_json, FIELD_MESSAGES);
+            FIELD(ev->data.llm_request.tools_json, FIELD_MESSAGES);
+            break;
+        case AC_TRACE_LLM_RESPONSE:
+            FIELD(ev->data.llm_response.content, FIELD_TEXT);
+            FIELD(ev->data.llm_response.tool_calls_json, FIELD_TOOL);
+            FIELD(ev->data.llm_response.finish_reason, FIELD_ID);
+            break;
+        case AC_TRACE_TOOL_START:
+            FIELD(ev->data.tool_start.id, FIELD_ID);
+            FIELD(ev->data.tool_start.name, FIELD_ID);
+            FIELD(ev->data.tool_start.arguments, FIELD_TOOL);
+            break;
+        case AC_TRACE_TOOL_END:
+            FIELD(ev->data.tool_end.id, FIELD_ID);
+            FIELD(ev->data.tool_end.name, FIELD_ID);
+            FIELD(ev->data.tool_end.result, FIELD_TOOL);
+            break;
+        default:
+            break;
+    }
+#undef FIELD
+
+    return n;
+}
+
+static size_t field_budget(trace_field_class_t cls) {
+    switch (cls) {
+        case FIELD_TEXT:     return s_ctx.config.max_text_bytes;
+        case FIELD_MESSAGES: return s_ctx.config.max_messages_bytes;
+        case FIELD_TOOL:     return s_ctx.config.max_tool_bytes;
+        default:             return 0;
+    }
+}
+
+/* Back up to the start of a UTF-8 sequence so truncation never splits one */
+static size_t utf8_floor(const char *s, size_t n) {
+    while (n > 0 && ((unsigned char)s[n] & 0xC0) == 0x80) {
+        n--;
+    }
+    return n;
+}
+
+/**
+ * Build a truncated copy of a payload. JSON payloads become a JSON string
+ * holding the escaped prefix, since a cut JSON document would corrupt
+ * exporters that embed it verbatim.
+ */
+static char *truncate_payload(const char *s, size_t len, size_t budget, int json) {
+    char marker[64];
+    size_t keep = utf8_floor(s, budget);
+    int mlen = snprintf(marker, sizeof(marker), "...[truncated %zu bytes]", len - keep);
+
+    if (!json) {
+        char *out = ARC_MALLOC(keep + (size_t)mlen + 1);
+        if (!out) return NULL;
+        memcpy(out, s, keep);
+        memcpy(out + keep, marker, (size_t)mlen + 1);
+        return out;
+    }
+
+    char *out = ARC_MALLOC(AC_JSON_ESCAPE_MAX(keep) + (size_t)mlen + 3);
+    if (!out) return NULL;
+
+    char *w = out;
+    *w++ = '"';
+    w += ac_json_escape(w, AC_JSON_ESCAPE_MAX(keep), s, keep, NULL, NULL);
+    memcpy(w, marker, (size_t)mlen);
+    w += mlen;
+    *w++ = '"';
+    *w = '\0';
+    return out;
+}
+
+static int capture_own(trace_captured_t *ce, char *s) {
+    if (!s || ce->owned_count >= TRACE_MAX_STR_FIELDS) {
+        ARC_FREE(s);
+        return -1;
+    }
+    ce->owned[ce->owned_count++] = s;
+    return 0;
+}
+
+static void capture_release(trace_captured_t *ce) {
+    for (int i = 0; i < ce->owned_count; i++) {
+        ARC_FREE(ce->owned[i]);
+    }
+    ce->owned_count = 0;
+}
+
+/**
+ * Apply byte budgets to an event in place. With `persist`, every string is
+ * copied so the event outlives the hook callback.
+ */
+static void capture_event(trace_captured_t *ce, int persist) {
+    trace_field_t fields[TRACE_MAX_STR_FIELDS];
+    int n = event_fields(&ce->event, fields);
+
+    ce->bytes = sizeof(*ce);
+
+    for (int i = 0; i < n; i++) {
+        const char *s = *fields[i].ptr;
+        if (!s) continue;
+
+        size_t len = strlen(s);
+        size_t budget = field_budget(fields[i].cls);
+        char *copy = NULL;
+
+        if (budget > 0 && len > budget) {
+            int json = fields[i].cls == FIELD_MESSAGES || fields[i].cls == FIELD_TOOL;
+            copy = truncate_payload(s, len, budget, json);
+        } else if (persist) {
+            copy = ARC_STRNDUP(s, len);
+        } else {
+            continue;
+        }
+
+        /* On allocation failure the field is dropped rather than kept unbounded */
+        *fields[i].ptr = NULL;
+        if (copy) {
+            ce->bytes += strlen(copy) + 1;
+            if (capture_own(ce, copy) == 0) {
+                *fields[i].ptr = copy;
+            }
+        }
+    }
+}
+
+/*============================================================================
+ * Internal: Tail Sampling Buffer
+ *============================================================================*/
+
+static void tail_clear(void) {
+    trace_captured_t *ce = s_ctx.tail_head;
+    while (ce) {
+        trace_captured_t *next = ce->next;
+        capture_release(ce);
+        ARC_FREE(ce);
+        ce = next;
+    }
+    s_ctx.tail_head = NULL;
+    s_ctx.tail_last = NULL;
+    s_ctx.tail_bytes = 0;
+}
+
+static void tail_push(const trace_captured_t *src) {
+    size_t cap = s_ctx.config.tail_max_buffer_bytes
+                     ? s_ctx.config.tail_max_buffer_bytes
+                     : AC_TRACE_DEFAULT_TAIL_BUFFER;
+
+    trace_captured_t *ce = ARC_MALLOC(sizeof(*ce));
+    if (!ce) return;
+    memcpy(ce, src, sizeof(*ce));
+    ce->next = NULL;
+    ce->owned_count = 0;
+
+    /* Take ownership of truncated copies, duplicate everything else */
+    capture_event(ce, 1);
+
+    /* agent_end always fits so a retained run is never left open */
+    if (ce->event.type != AC_TRACE_AGENT_END && s_ctx.tail_bytes + ce->bytes > cap) {
+        capture_release(ce);
+        ARC_FREE(ce);
+        return;
+    }
+
+    s_ctx.tail_bytes += ce->bytes;
+    if (s_ctx.tail_last) {
+        s_ctx.tail_last->next = ce;
+    } else {
+        s_ctx.tail_head = ce;
+    }
+    s_ctx.tail_last = ce;
+}
+
+static int tail_should_keep(const ac_trace_agent_end_t *end) {
+    if (s_ctx.config.tail_min_duration_ms > 0 &&
+        end->duration_ms >= s_ctx.config.tail_min_duration_ms) {
+        return 1;
+    }
+    if (s_ctx.config.tail_keep_errors && (s_ctx.run_failed || !end->content)) {
+        return 1;
+    }
+    return 0;
+}
+
+static void tail_flush(void) {
+    for (trace_captured_t *ce = s_ctx.tail_head; ce; ce = ce->next) {
+        ce->event.trace_id = s_ctx.trace_id;
+        s_ctx.handler(&ce->event, s_ctx.user_data);
+    }
+}
+
 /*============================================================================
  * Internal: Emit trace event
  *============================================================================*/
 
+static int run_is_traced(void) {
+    return s_ctx.enabled && s_ctx.handler && s_ctx.run_sampled;
+}
+
 static void emit_event(ac_trace_event_type_t type, const char *agent_name, ac_trace_event_t *event) {
-    if (!s_ctx.enabled || !s_ctx.handler) {
+    if (!run_is_traced()) {
         return;
     }
 
@@ -91,7 +382,26 @@ static void emit_event(ac_trace_event_type_t type, const char *agent_name, ac_tr
     event->agent_name = agent_name;
     event->sequence = ++s_ctx.sequence;
 
-    s_ctx.handler(event, s_ctx.user_data);
+    trace_captured_t ce;
+    ce.event = *event;
+    ce.owned_count = 0;
+
+    if (s_ctx.config.tail_sampling) {
+        /* tail_push copies the payload after applying budgets */
+        tail_push(&ce);
+
+        if (type == AC_TRACE_AGENT_END) {
+            if (tail_should_keep(&event->data.agent_end)) {
+                tail_flush();
+            }
+            tail_clear();
+        }
+        return;
+    }
+
+    capture_event(&ce, 0);
+    s_ctx.handler(&ce.event, s_ctx.user_data);
+    capture_release(&ce);
 }
 
 /*============================================================================
@@ -104,6 +414,13 @@ static void on_run_start(void *ctx, const ac_hook_run_start_t *info) {
     /* Initialize new trace */
     ac_trace_generate_id(s_ctx.trace_id, sizeof(s_ctx.trace_id));
     s_ctx.sequence = 0;
+    s_ctx.run_failed = 0;
+    tail_clear();
+
+    /* Head sampling: decided once per run, from its ID */
+    double rate = s_ctx.config.sample_rate;
+    s_ctx.run_sampled = rate <= 0.0 || rate >= 1.0 ||
+                        trace_id_fraction(s_ctx.trace_id) < rate;
 
     ac_trace_event_t event = {0};
     event.data.agent_start.message = info->message;
@@ -150,6 +467,10 @@ static void on_iter_end(void *ctx, const ac_hook_iter_t *info) {
 static void on_llm_request(void *ctx, const ac_hook_llm_request_t *info) {
     (void)ctx;
 
+    if (!run_is_traced()) {
+        return;
+    }
+
     /* Serialize messages on demand - only when trace is active */
     char *messages_json = ac_messages_to_json_string(info->messages);
 
@@ -168,6 +489,10 @@ static void on_llm_request(void *ctx, const ac_hook_llm_request_t *info) {
 static void on_llm_response(void *ctx, const ac_hook_llm_response_t *info) {
     (void)ctx;
 
+    if (!run_is_traced()) {
+        return;
+    }
+
     /* Serialize tool calls on demand - only when trace is active */
     char *tool_calls_json = ac_tool_calls_to_json_string(info->tool_calls);
 
@@ -201,6 +526,10 @@ static void on_tool_start(void *ctx, const ac_hook_tool_start_t *info) {
 static void on_tool_end(void *ctx, const ac_hook_tool_end_t *info) {
     (void)ctx;
 
+    if (!info->success) {
+        s_ctx.run_failed = 1;
+    }
+
     ac_trace_event_t event = {0};
     event.data.tool_end.id = info->id;
     event.data.tool_end.name = info->name;
@@ -215,6 +544,23 @@ static void on_tool_end(void *ctx, const ac_hook_tool_end_t *info) {
  * Public API
  *============================================================================*/
 
+void ac_trace_set_config(const ac_trace_config_t *config) {
+    if (config) {
+        s_ctx.config = *config;
+        if (config->sample_seed) {
+            s_ctx.rng = mix64(config->sample_seed);
+        }
+    } else {
+        memset(&s_ctx.config, 0, sizeof(s_ctx.config));
+    }
+}
+
+void ac_trace_get_config(ac_trace_config_t *config) {
+    if (config) {
+        *config = s_ctx.config;
+    }
+}
+
 void ac_trace_enable(ac_trace_handler_t handler, void *user_data) {
     if (!handler) {
         return;
@@ -225,7 +571,9 @@ void ac_trace_enable(ac_trace_handler_t handler, void *user_data) {
     s_ctx.user_data = user_data;
     s_ctx.enabled = 1;
     s_ctx.sequence = 0;
+    s_ctx.run_sampled = 1;
     memset(s_ctx.trace_id, 0, sizeof(s_ctx.trace_id));
+    tail_clear();
 
     /* Register agent hooks */
     static ac_agent_hooks_t trace_hooks = {
@@ -244,6 +592,7 @@ void ac_trace_enable(ac_trace_handler_t handler, void *user_data) {
 }
 
 void ac_trace_disable(void) {
+    tail_clear();
     s_ctx.enabled = 0;
     s_ctx.handler = NULL;
     s_ctx.user_data = NULL;
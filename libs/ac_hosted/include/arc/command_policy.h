@@ -0,0 +1,244 @@
+/**
+ * @file command_policy.h
+ * @brief Shell command parsing and dangerous-command policy
+ *
+ * Commands are tokenized the way /bin/sh would split them before
+ * policy rules look at them, so quoting, spacing, paths and wrapper
+ * programs do not hide what runs:
+ *
+ *   r''m -fr "/"          -> rm  -fr  /
+ *   FOO=1 /bin/rm -r -f / -> rm  -r -f /   (assignment split off)
+ *   env nice sudo reboot  -> sudo reboot   (wrappers skipped)
+ *   echo $(rm -rf ~)      -> echo ..., rm -rf ~  (nested, depth 1)
+ *   bash -c 'dd if=x'     -> bash -c ..., dd if=x  (re-parsed)
+ *
+ * The parser flattens the script into simple commands: pipelines,
+ * and/or lists, subshells, brace groups, command substitutions and
+ * arguments of `sh -c` / `eval` / here-documents fed to a shell all
+ * contribute their commands, tagged with a nesting depth.
+ *
+ * Rules are compiled into an Aho-Corasick automaton over a normalized
+ * token stream (program names and redirection targets) plus a small
+ * automaton over the raw text, so a command is scanned once no matter
+ * how many rules there are. Rules hit by the scan are then checked
+ * against the command's tokens (flags, operands, exemptions).
+ *
+ * Used by the sandbox (ac_sandbox_check_command) and by tools that
+ * screen commands themselves.
+ */
+
+#ifndef ARC_HOSTED_COMMAND_POLICY_H
+#define ARC_HOSTED_COMMAND_POLICY_H
+
+#include <arc/error.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Parsed Commands
+ *============================================================================*/
+
+/**
+ * @brief How a simple command is connected to the next one
+ */
+typedef enum {
+    AC_CMD_LINK_END = 0,                /* Last command of its list */
+    AC_CMD_LINK_SEQ,                    /* ; or newline */
+    AC_CMD_LINK_PIPE,                   /* | or |& */
+    AC_CMD_LINK_AND,                    /* && */
+    AC_CMD_LINK_OR,                     /* || */
+    AC_CMD_LINK_BACKGROUND,             /* & */
+} ac_cmd_link_t;
+
+/**
+ * @brief Redirection operator
+ */
+typedef enum {
+    AC_CMD_REDIR_IN = 0,                /* < */
+    AC_CMD_REDIR_OUT,                   /* >, >|, &> */
+    AC_CMD_REDIR_APPEND,                /* >>, &>> */
+    AC_CMD_REDIR_INOUT,                 /* <> */
+    AC_CMD_REDIR_DUP,                   /* >&, <& */
+    AC_CMD_REDIR_HEREDOC,               /* <<, <<- (target = body) */
+    AC_CMD_REDIR_HERESTRING,            /* <<< */
+} ac_cmd_redir_op_t;
+
+typedef struct {
+    ac_cmd_redir_op_t op;
+    int fd;                             /* Explicit fd number, -1 = default */
+    const char *target;                 /* Unquoted word (or here-doc body) */
+} ac_cmd_redir_t;
+
+/**
+ * @brief One simple command with its words unquoted
+ */
+typedef struct {
+    const char **argv;                  /* Words after the assignments */
+    int argc;
+    const char **assigns;               /* Leading NAME=value words */
+    int assign_count;
+    ac_cmd_redir_t *redirs;
+    int redir_count;
+    int program;                        /* argv index of the program run after wrappers (-1 = none) */
+    int depth;                          /* Subshell / substitution / nested shell level */
+    int dynamic;                        /* Program word contains an expansion */
+    ac_cmd_link_t link;
+} ac_cmd_simple_t;
+
+/**
+ * @brief A parsed command line
+ */
+typedef struct {
+    ac_cmd_simple_t *commands;
+    int count;
+    int error;                          /* Unterminated quote/substitution or too deeply nested */
+    void *arena;                        /* Internal storage */
+} ac_cmd_script_t;
+
+/**
+ * @brief Split a command line into simple commands
+ *
+ * Never fails on malformed input: what could be parsed is returned and
+ * `error` is set. Call ac_cmd_script_free() in every case.
+ *
+ * @param source  Command line
+ * @param script  Result
+ * @return ARC_OK, or ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_cmd_parse(const char *source, ac_cmd_script_t *script);
+
+/**
+ * @brief Free a parsed command line
+ */
+void ac_cmd_script_free(ac_cmd_script_t *script);
+
+/**
+ * @brief Program name of a simple command without its directory
+ * @return Basename, or NULL if the command runs no program
+ */
+const char *ac_cmd_program_name(const ac_cmd_simple_t *command);
+
+/*============================================================================
+ * Policy Rules
+ *============================================================================*/
+
+/**
+ * @brief What a matching rule asks for
+ */
+typedef enum {
+    AC_CMD_ALLOW = 0,                   /* Classify only */
+    AC_CMD_CONFIRM,                     /* Ask a human first */
+    AC_CMD_DENY,                        /* Never run */
+} ac_cmd_action_t;
+
+/**
+ * @brief Rule categories (bit positions in ac_cmd_verdict_t.categories)
+ */
+typedef enum {
+    AC_CMD_CAT_DESTRUCTIVE = 0,         /* Deletes or overwrites data wholesale */
+    AC_CMD_CAT_PRIVILEGE,               /* Changes user (sudo, su, ...) */
+    AC_CMD_CAT_PERMISSION,              /* chmod / chown of system paths */
+    AC_CMD_CAT_SYSTEM,                  /* Services, init scripts */
+    AC_CMD_CAT_NETWORK,                 /* Talks to the network */
+    AC_CMD_CAT_DEVICE,                  /* Writes raw devices / filesystems */
+    AC_CMD_CAT_SYSTEM_PATH,             /* Writes under system directories */
+    AC_CMD_CAT_RESOURCE,                /* Fork bombs and the like */
+    AC_CMD_CAT_UNPARSED,                /* Command could not be fully parsed */
+} ac_cmd_category_t;
+
+#define AC_CMD_CATEGORY_BIT(cat) (1u << (cat))
+
+/**
+ * @brief One row of the decision table
+ *
+ * Exactly one of program / redirect / raw keys the rule. Other than
+ * raw, fields hold alternatives separated by '|'. A rule matches when
+ * its key matches and every condition given (non-NULL) holds.
+ *
+ * - program:  program basename; trailing '*' matches a prefix ("mkfs*").
+ *             An entry containing '/' is a prefix of the program's path
+ *             as written ("/etc/init.d/"). Every program in a wrapper
+ *             chain is matched: `sudo rm` hits rules for sudo and rm.
+ * - redirect: prefix of a write-redirection target ("/etc/")
+ * - raw:      one literal, found in the command text with whitespace
+ *             removed (":(){:|:&};:")
+ * - flags:    one of these options is present; single letters given as
+ *             "-r" also match inside combined flags ("-rf")
+ * - operands: a non-option argument equals one of these after path
+ *             normalization ("/usr/" == "/usr"); "prefix*" matches a prefix
+ * - unless:   exemption: none of these arguments is present ("--version")
+ */
+typedef struct {
+    const char *program;
+    const char *redirect;
+    const char *raw;
+    const char *flags;
+    const char *operands;
+    const char *unless;
+    ac_cmd_action_t action;
+    ac_cmd_category_t category;
+    const char *reason;
+} ac_cmd_rule_t;
+
+/**
+ * @brief Result of evaluating a command
+ */
+typedef struct {
+    ac_cmd_action_t action;             /* Strictest action of all matching rules */
+    unsigned categories;                /* AC_CMD_CATEGORY_BIT() of every match */
+    const char *reason;                 /* Reason of the strictest rule (static) */
+    int matches;                        /* Number of (rule, command) matches */
+} ac_cmd_verdict_t;
+
+typedef struct ac_cmd_policy ac_cmd_policy_t;
+
+/**
+ * @brief Compile a rule table
+ *
+ * The rules are referenced, not copied: they must outlive the policy.
+ *
+ * @return Policy, or NULL on invalid rules / out of memory
+ */
+ac_cmd_policy_t *ac_cmd_policy_compile(const ac_cmd_rule_t *rules, size_t count);
+
+/**
+ * @brief Built-in policy used by the sandbox (compiled once, on first use; thread-safe)
+ */
+const ac_cmd_policy_t *ac_cmd_policy_default(void);
+
+/**
+ * @brief Evaluate a command line
+ *
+ * Commands that cannot be fully parsed get AC_CMD_CAT_UNPARSED and at
+ * least AC_CMD_CONFIRM.
+ *
+ * @param policy   Compiled policy
+ * @param command  Command line
+ * @param verdict  Result
+ * @return ARC_OK, or ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_cmd_policy_eval(const ac_cmd_policy_t *policy, const char *command, ac_cmd_verdict_t *verdict);
+
+/**
+ * @brief Evaluate an already parsed command line
+ */
+arc_err_t ac_cmd_policy_eval_script(
+    const ac_cmd_policy_t *policy,
+    const char *command,
+    const ac_cmd_script_t *script,
+    ac_cmd_verdict_t *verdict
+);
+
+/**
+ * @brief Free a compiled policy
+ */
+void ac_cmd_policy_free(ac_cmd_policy_t *policy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HOSTED_COMMAND_POLICY_H */
@@ -0,0 +1,112 @@
+/**
+ * @file glob.h
+ * @brief Compiled path globs and file finding ordered by modification time
+ *
+ * Pattern syntax:
+ *   - '*' and '?' match within one path segment, "[...]" classes
+ *     support ranges and "!"/"^" negation, '\' escapes
+ *   - "**" as a whole segment matches any number of directories
+ *   - "{a,b}" alternatives, nestable ("{src,lib/{a,b}}/main.{c,h}")
+ *   - A pattern without '/' matches the file name at any depth, as if
+ *     prefixed by a "**" segment; otherwise it is anchored at the root
+ *
+ * A pattern compiles into one automaton over path segments, so a walk
+ * can tell from a directory's path alone whether anything below it can
+ * still match and skip it otherwise.
+ */
+
+#ifndef ARC_HOSTED_GLOB_H
+#define ARC_HOSTED_GLOB_H
+
+#include <arc/error.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Patterns
+ *============================================================================*/
+
+typedef struct ac_glob_pattern ac_glob_pattern_t;
+
+/**
+ * @brief Compile a glob pattern
+ *
+ * @param pattern  Pattern (a leading "./" or "/" is dropped)
+ * @param err      Receives a message on failure (may be NULL)
+ * @param errsize  Size of err
+ * @return Pattern, or NULL on error
+ */
+ac_glob_pattern_t *ac_glob_pattern_compile(const char *pattern, char *err, size_t errsize);
+
+/**
+ * @brief Whether a path matches
+ *
+ * @param rel_path  Path relative to the search root, '/' separated
+ * @return 1 on match, 0 otherwise
+ */
+int ac_glob_pattern_match(const ac_glob_pattern_t *pattern, const char *rel_path);
+
+/**
+ * @brief Whether paths below a directory can match
+ *
+ * @param rel_dir  Directory relative to the search root ("" = the root)
+ * @return 0 if nothing below rel_dir can match
+ */
+int ac_glob_pattern_can_descend(const ac_glob_pattern_t *pattern, const char *rel_dir);
+
+void ac_glob_pattern_free(ac_glob_pattern_t *pattern);
+
+/*============================================================================
+ * Finding Files
+ *============================================================================*/
+
+typedef struct {
+    size_t max_results;                 /* Newest files kept (0 = 1000) */
+    int hidden;                         /* Include dot names (implied when the pattern names one) */
+    int no_ignore;                      /* Do not honor .gitignore / .ignore */
+    const char *const *ignore_globs;    /* Extra ignore rules (see ac_walk_options_t) */
+    size_t ignore_globs_count;
+} ac_glob_find_options_t;
+
+typedef struct {
+    char *path;                         /* root + "/" + relative path */
+    int64_t mtime_ns;                   /* Modification time, ns since the epoch */
+} ac_glob_file_t;
+
+typedef struct {
+    ac_glob_file_t *files;              /* Newest first */
+    size_t count;
+    size_t total;                       /* Matching files seen, including dropped ones */
+} ac_glob_result_t;
+
+/**
+ * @brief Find the most recently modified files matching a pattern
+ *
+ * Walks root with arc/walk.h (ignore files honored), pruning
+ * directories the pattern cannot match below, and keeps the
+ * max_results newest matches in a heap.
+ *
+ * @param root     Directory to search
+ * @param pattern  Compiled pattern
+ * @param options  Options (NULL = defaults)
+ * @param result   Receives the files; release with ac_glob_result_free()
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_IO, ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_glob_find(
+    const char *root,
+    const ac_glob_pattern_t *pattern,
+    const ac_glob_find_options_t *options,
+    ac_glob_result_t *result
+);
+
+void ac_glob_result_free(ac_glob_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HOSTED_GLOB_H */
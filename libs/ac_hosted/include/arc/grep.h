@@ -0,0 +1,150 @@
+/**
+ * @file grep.h
+ * @brief Content search engine (PCRE2, literal prefilter, whole buffers)
+ *
+ * Patterns are compiled once with PCRE2 (JIT when the library has it)
+ * and searched against whole file buffers instead of line by line.
+ * Files are mmapped when large enough for that to pay off.
+ *
+ * Semantics follow ripgrep:
+ *   - A match never spans lines unless multiline is set; each matching
+ *     line is reported once.
+ *   - Case is sensitive by default; AC_GREP_CASE_SMART is insensitive
+ *     unless the pattern contains an uppercase letter (--smart-case).
+ *   - Files with a NUL byte in their first 8 KiB are binary and skipped.
+ *
+ * When the pattern has a literal that every match must contain (e.g.
+ * "malloc" in "malloc\s*\(" or "Error" in "log.*Error"), the buffer is
+ * scanned for that literal with memchr/memmem first and the regex only
+ * runs on the lines it occurs in. A pattern that is entirely literal
+ * never runs the regex at all.
+ *
+ * A compiled ac_grep_t is immutable: several threads may search with
+ * the same one at once.
+ */
+
+#ifndef ARC_HOSTED_GREP_H
+#define ARC_HOSTED_GREP_H
+
+#include <arc/error.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+typedef struct ac_grep ac_grep_t;
+
+/**
+ * @brief Case handling
+ */
+typedef enum {
+    AC_GREP_CASE_SENSITIVE = 0,
+    AC_GREP_CASE_INSENSITIVE,
+    AC_GREP_CASE_SMART,                 /* Insensitive unless the pattern has uppercase */
+} ac_grep_case_t;
+
+/**
+ * @brief Compile options (zero-initialized = ripgrep defaults)
+ */
+typedef struct {
+    ac_grep_case_t case_mode;
+    int fixed_strings;                  /* Pattern is a literal string (-F) */
+    int multiline;                      /* Matches may span lines (-U) */
+    size_t max_filesize;                /* Skip larger files (0 = no limit) */
+} ac_grep_options_t;
+
+/**
+ * @brief One matching line (or line range for multiline matches)
+ *
+ * Pointers are only valid during the callback.
+ */
+typedef struct {
+    const char *path;                   /* As passed to ac_grep_file() (NULL for buffers) */
+    size_t line_number;                 /* 1-based number of the first line */
+    const char *line;                   /* Matching line(s), without the final newline */
+    size_t line_len;
+    size_t match_start;                 /* First match, as offsets into line */
+    size_t match_end;
+} ac_grep_match_t;
+
+/**
+ * @brief Match callback
+ * @return 0 to continue, non-zero to stop searching this buffer/file
+ */
+typedef int (*ac_grep_match_fn)(const ac_grep_match_t *match, void *user_data);
+
+/* ac_grep_file() results besides a match count */
+#define AC_GREP_ERROR   (-1)            /* File could not be opened or read */
+#define AC_GREP_SKIPPED (-2)            /* Binary, or larger than max_filesize */
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+/**
+ * @brief Compile a pattern
+ *
+ * @param pattern     PCRE2 pattern (or literal with fixed_strings)
+ * @param options     Options (NULL = defaults)
+ * @param error       Receives the compile error message (can be NULL)
+ * @param error_size  Size of error
+ * @return Compiled pattern, or NULL on error
+ */
+ac_grep_t *ac_grep_compile(
+    const char *pattern,
+    const ac_grep_options_t *options,
+    char *error,
+    size_t error_size
+);
+
+/**
+ * @brief Search a buffer
+ *
+ * @return Number of matching lines reported (stops early if the callback
+ *         asks to), or AC_GREP_ERROR
+ */
+int ac_grep_buffer(
+    const ac_grep_t *grep,
+    const char *data,
+    size_t len,
+    ac_grep_match_fn on_match,
+    void *user_data
+);
+
+/**
+ * @brief Search a file
+ *
+ * @return Number of matching lines reported, AC_GREP_SKIPPED or AC_GREP_ERROR
+ */
+int ac_grep_file(
+    const ac_grep_t *grep,
+    const char *path,
+    ac_grep_match_fn on_match,
+    void *user_data
+);
+
+/**
+ * @brief Whether the buffer looks binary (NUL byte in the first 8 KiB)
+ */
+int ac_grep_is_binary(const char *data, size_t len);
+
+/**
+ * @brief Required literal used as prefilter ("" = none), e.g. for an index lookup
+ */
+const char *ac_grep_literal(const ac_grep_t *grep);
+
+/**
+ * @brief Free a compiled pattern
+ */
+void ac_grep_free(ac_grep_t *grep);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HOSTED_GREP_H */
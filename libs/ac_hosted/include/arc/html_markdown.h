@@ -0,0 +1,97 @@
+/**
+ * @file html_markdown.h
+ * @brief Streaming HTML to Markdown converter
+ *
+ * HTML is fed in chunks of any size, as it arrives; a tag, comment or
+ * entity split between chunks is held back until the rest comes, so
+ * memory stays bounded by the output, not the page.
+ *
+ * Only the content is kept. Scripts, styles, form controls, embedded
+ * objects and page furniture (nav, aside, footer, and elements marked
+ * hidden or with a navigation, banner or footer role) are dropped.
+ * Headings, paragraphs, lists, block quotes, code blocks, tables,
+ * emphasis, links and images become their Markdown forms; links and
+ * images are resolved against the page URL and <base href>.
+ *
+ * Text is decoded to UTF-8 while converting: character references, and
+ * ISO-8859-1 or windows-1252 input when the options or a <meta charset>
+ * say so. Whitespace is collapsed as a browser would, except in <pre>.
+ *
+ * The plain-text format keeps the same line structure without Markdown
+ * markup. A converter is not thread-safe.
+ */
+
+#ifndef ARC_HOSTED_HTML_MARKDOWN_H
+#define ARC_HOSTED_HTML_MARKDOWN_H
+
+#include <arc/error.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+typedef struct ac_html_md ac_html_md_t;
+
+typedef enum {
+    AC_HTML_MD_MARKDOWN = 0,
+    AC_HTML_MD_TEXT,                    /* Line structure only, no markup */
+} ac_html_md_format_t;
+
+typedef struct {
+    ac_html_md_format_t format;
+    const char *base_url;               /* Resolves relative links (NULL = keep them as written) */
+    const char *charset;                /* From Content-Type (NULL = UTF-8 unless <meta charset> says otherwise) */
+    size_t max_output;                  /* Output bytes kept (0 = unlimited); the rest is dropped */
+} ac_html_md_options_t;
+
+/*============================================================================
+ * Converter
+ *============================================================================*/
+
+/**
+ * @brief Create a converter
+ *
+ * @param options  NULL = Markdown, no base URL, UTF-8, unlimited
+ * @return ARC_OK, ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_html_md_create(const ac_html_md_options_t *options, ac_html_md_t **out);
+
+/**
+ * @brief Convert the next chunk of HTML
+ *
+ * Once max_output is reached the input is discarded and
+ * ac_html_md_truncated() is set, so the caller can stop reading.
+ *
+ * @return ARC_OK, ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_html_md_feed(ac_html_md_t *conv, const char *html, size_t len);
+
+/**
+ * @brief Finish the document and return the Markdown
+ *
+ * Flushes what was held back and trims trailing blank lines. The
+ * result stays valid until the converter is freed; further input is
+ * ignored.
+ *
+ * @param len  Receives the length (may be NULL)
+ */
+const char *ac_html_md_finish(ac_html_md_t *conv, size_t *len);
+
+/* Text of the first <title>, "" if none (so far) */
+const char *ac_html_md_title(const ac_html_md_t *conv);
+
+/* Output reached max_output */
+int ac_html_md_truncated(const ac_html_md_t *conv);
+
+void ac_html_md_free(ac_html_md_t *conv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HOSTED_HTML_MARKDOWN_H */
@@ -0,0 +1,115 @@
+/**
+ * @file http_cache.h
+ * @brief On-disk HTTP cache with conditional requests
+ *
+ * Fetches GET responses through the HTTP client of the port layer and
+ * keeps successful ones on disk, so a page read again costs no transfer
+ * at all while it is fresh, and only a 304 Not Modified afterwards:
+ *
+ * - Freshness comes from Cache-Control max-age (less Age), else Expires,
+ *   else a tenth of the time since Last-Modified, capped by max_age_s.
+ *   no-cache makes every use revalidate; no-store is never stored.
+ * - A stale entry is revalidated with If-None-Match / If-Modified-Since
+ *   from its ETag and Last-Modified. When the server cannot be reached,
+ *   the stale copy is served and marked as such.
+ * - Redirects are followed, to http and https URLs only; the entry is
+ *   keyed by the URL asked for and revalidated at the URL it ended at.
+ * - Responses larger than max_body are refused; the least recently used
+ *   entries are removed once the cache exceeds max_bytes.
+ *
+ * Entries are a body file and a JSON metadata file each, written by
+ * rename, so a cache directory may be shared between processes. A
+ * handle is not thread-safe.
+ */
+
+#ifndef ARC_HOSTED_HTTP_CACHE_H
+#define ARC_HOSTED_HTTP_CACHE_H
+
+#include <arc/error.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+typedef struct ac_http_cache ac_http_cache_t;
+
+typedef struct {
+    const char *dir;                    /* NULL = $XDG_CACHE_HOME/arc/web, ~/.cache/arc/web */
+    size_t max_bytes;                   /* Bodies kept (0 = 64 MiB) */
+    size_t max_body;                    /* Largest response accepted (0 = 5 MiB) */
+    int max_age_s;                      /* Longest an entry is used unchecked (0 = 1 day) */
+    int timeout_ms;                     /* Per request, redirects included (0 = 30000) */
+    int max_redirects;                  /* 0 = 5 */
+    const char *user_agent;             /* NULL = "arc-webfetch/1.0" */
+    const char *accept;                 /* NULL = HTML first, then Markdown and text */
+} ac_http_cache_options_t;
+
+typedef enum {
+    AC_HTTP_FROM_NETWORK,               /* Transferred in full */
+    AC_HTTP_FROM_CACHE,                 /* Fresh copy: no request made */
+    AC_HTTP_REVALIDATED,                /* 304 Not Modified: body from the cache */
+} ac_http_source_t;
+
+typedef struct {
+    int status;                         /* Of the final response */
+    char *url;                          /* Final URL, after redirects */
+    char *content_type;                 /* "" if not given */
+    char *body;                         /* NUL-terminated */
+    size_t size;
+    ac_http_source_t source;
+    int stale;                          /* Cached copy served because revalidation failed */
+} ac_http_fetch_t;
+
+typedef struct {
+    size_t requests;                    /* Sent to servers, redirects included */
+    size_t hits;                        /* Served fresh without a request */
+    size_t revalidated;                 /* 304 responses */
+    size_t stored;                      /* Entries written */
+    size_t evicted;                     /* Entries removed for space */
+} ac_http_cache_stats_t;
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+/**
+ * @brief Open a cache, creating its directory
+ *
+ * @return ARC_OK, ARC_ERR_IO (directory unusable), ARC_ERR_NO_MEMORY,
+ *         or the HTTP client's error
+ */
+arc_err_t ac_http_cache_open(const ac_http_cache_options_t *options, ac_http_cache_t **out);
+
+void ac_http_cache_close(ac_http_cache_t *cache);
+
+/**
+ * @brief GET a URL, from the cache where possible
+ *
+ * Any final status is returned as a result, with its body; only 200
+ * responses are stored. Free the result with ac_http_fetch_free().
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_ARG (not an http or https URL),
+ *         ARC_ERR_NETWORK, ARC_ERR_DNS, ARC_ERR_TLS, ARC_ERR_TIMEOUT,
+ *         ARC_ERR_RESPONSE_TOO_LARGE, ARC_ERR_PROTOCOL (too many
+ *         redirects, or one to another scheme), ARC_ERR_NO_MEMORY;
+ *         reason in ac_http_cache_error()
+ */
+arc_err_t ac_http_cache_fetch(ac_http_cache_t *cache, const char *url, ac_http_fetch_t *out);
+
+void ac_http_fetch_free(ac_http_fetch_t *fetch);
+
+/* Reason of the last failed fetch */
+const char *ac_http_cache_error(const ac_http_cache_t *cache);
+
+void ac_http_cache_stats(const ac_http_cache_t *cache, ac_http_cache_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HOSTED_HTTP_CACHE_H */
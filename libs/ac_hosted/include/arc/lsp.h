@@ -0,0 +1,223 @@
+/**
+ * @file lsp.h
+ * @brief Language Server Protocol client with a pool of warm servers
+ *
+ * A pool belongs to one workspace and runs at most one language server
+ * per configured language, started on the first request for one of its
+ * files and kept running until the pool is destroyed, so only the first
+ * query pays for the server's start-up and indexing. Servers talk
+ * JSON-RPC over their stdin/stdout; a reader thread per server matches
+ * responses to requests, so calls from several threads share a server
+ * and wait only for their own answer. A server that exits is started
+ * again by the next request.
+ *
+ * Documents are opened on the server when first queried and kept in
+ * sync afterwards: ac_lsp_file_changed() (or the next query, which
+ * compares the file with the copy sent last) sends only the changed
+ * range when the server accepts incremental changes.
+ *
+ * Positions are 1-based lines and 1-based byte columns, converted to
+ * and from the UTF-16 offsets of the protocol unless the server accepts
+ * UTF-8 positions.
+ *
+ * POSIX only. All functions are thread-safe.
+ */
+
+#ifndef ARC_HOSTED_LSP_H
+#define ARC_HOSTED_LSP_H
+
+#include <arc/error.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+typedef struct ac_lsp_pool ac_lsp_pool_t;
+
+typedef struct {
+    const char *language;               /* Name in errors and stats, e.g. "c" */
+    const char *extensions;             /* Space-separated, e.g. ".c .h .cpp" */
+    const char *const *argv;            /* Command line, NULL-terminated; argv[0] is looked up in PATH */
+} ac_lsp_server_config_t;
+
+typedef struct {
+    const char *root;                   /* Workspace directory (required) */
+    const ac_lsp_server_config_t *servers;  /* NULL = ac_lsp_default_servers() */
+    size_t servers_count;
+    int request_timeout_ms;             /* Per request (0 = 15000) */
+    int start_timeout_ms;               /* Start-up and initialize (0 = 60000) */
+    size_t max_documents;               /* Open per server; least recently used are closed (0 = 64) */
+} ac_lsp_options_t;
+
+typedef struct {
+    const char *path;                   /* Absolute */
+    unsigned line;                      /* 1-based */
+    unsigned column;                    /* 1-based, in bytes */
+    unsigned end_line;
+    unsigned end_column;                /* Exclusive */
+} ac_lsp_location_t;
+
+typedef struct {
+    ac_lsp_location_t *locations;
+    size_t count;
+    char *strings;                      /* Storage of the paths */
+} ac_lsp_locations_t;
+
+typedef enum {
+    AC_LSP_ERROR = 1,
+    AC_LSP_WARNING = 2,
+    AC_LSP_INFORMATION = 3,
+    AC_LSP_HINT = 4,
+} ac_lsp_severity_t;
+
+typedef struct {
+    unsigned line;                      /* 1-based */
+    unsigned column;                    /* 1-based, in bytes */
+    unsigned end_line;
+    unsigned end_column;
+    ac_lsp_severity_t severity;
+    const char *message;
+    const char *source;                 /* "" if not given */
+    const char *code;                   /* "" if not given */
+} ac_lsp_diagnostic_t;
+
+typedef struct {
+    ac_lsp_diagnostic_t *items;
+    size_t count;
+    int stale;                          /* Not yet updated for the file's current contents */
+    char *strings;
+} ac_lsp_diagnostics_t;
+
+typedef struct {
+    size_t servers;                     /* Running now */
+    size_t starts;                      /* Server processes started */
+    size_t requests;                    /* Requests answered */
+    size_t documents;                   /* Open on all servers */
+    size_t incremental_changes;         /* didChange with a range */
+    size_t full_changes;                /* didChange with the whole text */
+} ac_lsp_stats_t;
+
+/*============================================================================
+ * Pool
+ *============================================================================*/
+
+/**
+ * @brief Servers used when the options give none
+ *
+ * clangd (C, C++), pyright (Python), typescript-language-server
+ * (JavaScript, TypeScript), gopls (Go) and rust-analyzer (Rust).
+ */
+const ac_lsp_server_config_t *ac_lsp_default_servers(size_t *count);
+
+/**
+ * @brief Create a pool; no server is started yet
+ *
+ * The configuration is copied.
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_lsp_pool_create(const ac_lsp_options_t *options, ac_lsp_pool_t **out);
+
+/* Shuts every server down (killing those that don't exit promptly) */
+void ac_lsp_pool_destroy(ac_lsp_pool_t *pool);
+
+/* Server configured for a file's extension, or NULL */
+const ac_lsp_server_config_t *ac_lsp_server_for_file(const ac_lsp_pool_t *pool, const char *path);
+
+void ac_lsp_stats(ac_lsp_pool_t *pool, ac_lsp_stats_t *stats);
+
+/**
+ * @brief Reason of the last failure on this thread
+ *
+ * Such as "no language server for .txt files", "cannot run clangd: No
+ * such file or directory" or the server's error message.
+ */
+const char *ac_lsp_error(void);
+
+/*============================================================================
+ * Queries
+ *
+ * Each opens or updates the file on its server first. They return
+ * ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_NOT_FOUND (no server for the
+ * file type, or the file cannot be read), ARC_ERR_NOT_IMPLEMENTED (the
+ * server lacks the feature), ARC_ERR_IO (the server cannot be started
+ * or exited), ARC_ERR_TIMEOUT, ARC_ERR_PROTOCOL (error response) or
+ * ARC_ERR_NO_MEMORY.
+ *============================================================================*/
+
+/* Where the symbol at a position is defined */
+arc_err_t ac_lsp_definition(
+    ac_lsp_pool_t *pool,
+    const char *path,
+    unsigned line,
+    unsigned column,
+    ac_lsp_locations_t *out
+);
+
+/* Uses of the symbol at a position, with its declaration */
+arc_err_t ac_lsp_references(
+    ac_lsp_pool_t *pool,
+    const char *path,
+    unsigned line,
+    unsigned column,
+    ac_lsp_locations_t *out
+);
+
+/**
+ * @brief Hover text (type, documentation) at a position
+ *
+ * @param out  Receives Markdown or plain text ("" if the server has
+ *             nothing to say); free() it
+ */
+arc_err_t ac_lsp_hover(
+    ac_lsp_pool_t *pool,
+    const char *path,
+    unsigned line,
+    unsigned column,
+    char **out
+);
+
+/**
+ * @brief Diagnostics the server published for a file
+ *
+ * Waits up to `wait_ms` for the server to publish diagnostics for the
+ * file's current contents; after that, returns the last ones received
+ * with `stale` set.
+ */
+arc_err_t ac_lsp_diagnostics(
+    ac_lsp_pool_t *pool,
+    const char *path,
+    int wait_ms,
+    ac_lsp_diagnostics_t *out
+);
+
+void ac_lsp_locations_free(ac_lsp_locations_t *locations);
+
+void ac_lsp_diagnostics_free(ac_lsp_diagnostics_t *diagnostics);
+
+/*============================================================================
+ * Document Sync
+ *============================================================================*/
+
+/**
+ * @brief Tell the servers a file changed
+ *
+ * Only files open on a running server are sent (as the changed range
+ * where possible); others are read when first queried. A file that no
+ * longer exists is closed.
+ *
+ * @param text  New contents, or NULL to read the file
+ * @param len   Length of text
+ */
+arc_err_t ac_lsp_file_changed(ac_lsp_pool_t *pool, const char *path, const char *text, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HOSTED_LSP_H */
@@ -0,0 +1,141 @@
+/**
+ * @file patch.h
+ * @brief Atomic multi-file edits: string replacements and unified diffs
+ *
+ * A patch stages changes in memory and writes them all at once:
+ *
+ *   ac_patch_t *p = ac_patch_create(workspace);
+ *   ac_patch_replace(p, "src/a.c", "old", "new", 0, NULL);
+ *   ac_patch_apply_diff(p, diff_text);
+ *   if (ac_patch_commit(p) != ARC_OK) puts(ac_patch_error(p));
+ *   ac_patch_free(p);
+ *
+ * Each file is read once, on its first change; later changes apply to
+ * the staged result. A change that does not apply fails on its own and
+ * leaves the staged contents as they were, so nothing half-applied can
+ * be committed.
+ *
+ * Diff hunks are located line by line via line hashes: first at the
+ * stated position (shifted by the previous hunks), then at the nearest
+ * offset, then ignoring whitespace, then with up to two context lines
+ * dropped at either end (as patch --fuzz=2).
+ *
+ * Committing writes every file to a temporary file next to it and
+ * renames it into place. Nothing is written if a file changed on disk
+ * since it was read; if a write or rename fails, files already replaced
+ * get their previous contents back.
+ */
+
+#ifndef ARC_HOSTED_PATCH_H
+#define ARC_HOSTED_PATCH_H
+
+#include <arc/error.h>
+#include <arc/textfile.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+typedef struct ac_patch ac_patch_t;
+
+/* Whether a file may be staged (resolved path); 0 refuses it */
+typedef int (*ac_patch_path_check_t)(const char *path, void *user_data);
+
+typedef struct {
+    const char *path;                   /* Resolved path */
+    int created;                        /* Did not exist before */
+    int deleted;                        /* Removed by the patch */
+    size_t changes;                     /* Replacements and hunks applied */
+    size_t fuzzy;                       /* Hunks found off position or with fuzz */
+    size_t lines_added;
+    size_t lines_removed;
+} ac_patch_file_info_t;
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+/**
+ * @param base_dir  Directory relative paths resolve against (NULL = cwd)
+ * @return Patch, or NULL on allocation failure
+ */
+ac_patch_t *ac_patch_create(const char *base_dir);
+
+/**
+ * @brief Read files through a text file cache
+ *
+ * Files are then staged from memory when the cache holds them, and the
+ * files a commit writes are invalidated in it. Set before staging.
+ */
+void ac_patch_set_file_cache(ac_patch_t *patch, ac_textfile_cache_t *cache);
+
+/**
+ * @brief Check each file before it is read
+ *
+ * check runs once per file, before the file is read or looked up in the
+ * cache; a refusal fails the change with ARC_ERR_INVALID_ARG, "access to
+ * <path> refused". Set before staging.
+ */
+void ac_patch_set_path_check(ac_patch_t *patch, ac_patch_path_check_t check, void *user_data);
+
+/**
+ * @brief Stage a string replacement
+ *
+ * old_str must occur exactly once unless replace_all is set. An empty
+ * old_str creates the file with new_str as content; the file must not
+ * exist or be empty.
+ *
+ * @param replacements  Receives the number of replacements (can be NULL)
+ * @return ARC_OK, ARC_ERR_NOT_FOUND (no match, or missing file),
+ *         ARC_ERR_INVALID_ARG (several matches, identical strings),
+ *         ARC_ERR_IO, ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_patch_replace(
+    ac_patch_t *patch,
+    const char *path,
+    const char *old_str,
+    const char *new_str,
+    int replace_all,
+    size_t *replacements
+);
+
+/**
+ * @brief Stage a unified diff (git or diff -u format, several files)
+ *
+ * "a/" and "b/" prefixes are stripped from git diffs. A "/dev/null"
+ * source creates a file, a "/dev/null" target deletes it. Either every
+ * hunk of the diff applies or none does.
+ *
+ * @return ARC_OK, ARC_ERR_PARSE (malformed diff), ARC_ERR_NOT_FOUND
+ *         (a hunk does not match), ARC_ERR_IO, ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_patch_apply_diff(ac_patch_t *patch, const char *diff);
+
+/**
+ * @brief Write all staged files
+ *
+ * @return ARC_OK, ARC_ERR_INVALID_STATE (a file changed on disk since it
+ *         was staged; nothing written), ARC_ERR_IO (rolled back)
+ */
+arc_err_t ac_patch_commit(ac_patch_t *patch);
+
+/* Message describing the last failure ("" if none) */
+const char *ac_patch_error(const ac_patch_t *patch);
+
+size_t ac_patch_file_count(const ac_patch_t *patch);
+
+/* Staged file by index, in the order files were first changed */
+void ac_patch_file_info(const ac_patch_t *patch, size_t index, ac_patch_file_info_t *info);
+
+void ac_patch_free(ac_patch_t *patch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HOSTED_PATCH_H */
@@ -101,6 +101,38 @@ typedef struct {
  * Sandbox Configuration
  *============================================================================*/
 
+/**
+ * @brief Resource limits for sandboxed commands (0 = unlimited)
+ *
+ * The rlimits are set with setrlimit() in the command's shell before
+ * exec and are inherited by everything it starts. They never exceed the
+ * agent's own hard limits. Note that RLIMIT_NPROC counts every process
+ * of the user, not just the command's; prefer pids_max where a cgroup
+ * is available.
+ *
+ * When cgroup_parent names a writable, delegated cgroup v2 directory,
+ * each ac_sandbox_exec_ex() command runs in its own child cgroup with
+ * memory.max / pids.max / cpu.max set. The cgroup is removed when the
+ * command ends, so background jobs do not outlive it. If the cgroup
+ * cannot be set up the command runs with the rlimits only.
+ *
+ * Persistent shell sessions get the rlimits (set on the session shell)
+ * and the per-command output limit, but no cgroup.
+ */
+typedef struct {
+    unsigned int cpu_seconds;           /* RLIMIT_CPU per process */
+    size_t address_space_bytes;         /* RLIMIT_AS per process */
+    unsigned int open_files;            /* RLIMIT_NOFILE */
+    unsigned int processes;             /* RLIMIT_NPROC (per user) */
+    size_t output_bytes;                /* stdout + stderr read; the command is killed beyond */
+
+    /* cgroup v2 (per command, ac_sandbox_exec_ex() only) */
+    const char *cgroup_parent;          /* Delegated cgroup directory (NULL = no cgroups) */
+    size_t memory_max_bytes;            /* memory.max */
+    unsigned int pids_max;              /* pids.max */
+    unsigned int cpu_max_percent;       /* cpu.max, 100 = one CPU */
+} ac_sandbox_limits_t;
+
 /**
  * @brief Sandbox configuration
  */
@@ -124,6 +156,9 @@ typedef struct {
     /* Behavior flags */
     int strict_mode;                    /* Deny everything not explicitly allowed */
     int log_violations;                 /* Log access violations */
+
+    /* Resource limits for executed commands (zero = none) */
+    ac_sandbox_limits_t limits;
 } ac_sandbox_config_t;
 
 /*============================================================================
@@ -314,6 +349,20 @@ int ac_sandbox_check_path(
     unsigned int permissions
 );
 
+/**
+ * @brief Forget cached path resolutions
+ *
+ * ac_sandbox_check_path() caches the canonical form of directories it
+ * has seen and resolves relative paths against the working directory of
+ * the process when the sandbox was created. Cached directories are
+ * revalidated with lstat() on use, and the sandbox drops the cache after
+ * every command it runs. Call this after chdir(), or after another
+ * process rearranged directories above checked paths.
+ *
+ * @param sandbox  Sandbox handle
+ */
+void ac_sandbox_invalidate_path_cache(ac_sandbox_t *sandbox);
+
 /**
  * @brief Check if a command is allowed
  *
@@ -329,10 +378,27 @@ int ac_sandbox_check_command(
     const char *command
 );
 
+/**
+ * @brief Check if network access from the parent process is allowed
+ *
+ * For tools that reach the network themselves rather than through a
+ * command. Allowed when the config allows the network or the user
+ * allowed it for the session; otherwise the confirm callback is asked.
+ *
+ * @param sandbox   Sandbox handle
+ * @param resource  What is accessed (e.g. a URL), shown to the user
+ * @return 1 if allowed, 0 if denied
+ */
+int ac_sandbox_check_network(
+    ac_sandbox_t *sandbox,
+    const char *resource
+);
+
 /**
  * @brief Get the denial reason for the last check
  *
- * After ac_sandbox_check_path() or ac_sandbox_check_command() returns 0,
+ * After ac_sandbox_check_path(), ac_sandbox_check_command() or
+ * ac_sandbox_check_network() returns 0,
  * this function provides the reason.
  *
  * @return Denial reason (static string)
@@ -392,6 +458,169 @@ arc_err_t ac_sandbox_exec_timeout(
     int timeout_ms
 );
 
+/**
+ * @brief Output stream of a sandboxed command
+ */
+typedef enum {
+    AC_SANDBOX_STDOUT = 1,
+    AC_SANDBOX_STDERR = 2,
+} ac_sandbox_stream_t;
+
+/**
+ * @brief Output callback for streaming execution
+ *
+ * Called with each chunk of output as soon as it is read. Chunks are
+ * not line-aligned and data is not NUL-terminated.
+ *
+ * @param stream     Stream the chunk was read from
+ * @param data       Chunk data
+ * @param len        Chunk length
+ * @param user_data  User context
+ * @return 0 to continue, non-zero to kill the command
+ */
+typedef int (*ac_sandbox_output_fn)(
+    ac_sandbox_stream_t stream,
+    const char *data,
+    size_t len,
+    void *user_data
+);
+
+/**
+ * @brief Resource limit that ended a command
+ */
+typedef enum {
+    AC_SANDBOX_LIMIT_NONE = 0,
+    AC_SANDBOX_LIMIT_CPU,               /* cpu_seconds (SIGXCPU) */
+    AC_SANDBOX_LIMIT_MEMORY,            /* memory_max_bytes (OOM kill in the cgroup) */
+    AC_SANDBOX_LIMIT_PROCESSES,         /* pids_max (fork refused in the cgroup) */
+    AC_SANDBOX_LIMIT_OUTPUT,            /* output_bytes */
+} ac_sandbox_limit_t;
+
+/**
+ * @brief Resource usage of a finished command
+ *
+ * CPU time and peak RSS come from wait4() and cover the shell and the
+ * children it waited for. The cgroup_* fields are only set when the
+ * command ran in its own cgroup and cover every process in it. A
+ * persistent shell reports wall time, output bytes and the output limit
+ * only.
+ */
+typedef struct {
+    long long wall_ms;                  /* Start to end of the run */
+    long long user_cpu_ms;
+    long long system_cpu_ms;
+    size_t max_rss_bytes;
+    size_t output_bytes;                /* stdout + stderr bytes read */
+    ac_sandbox_limit_t limit_hit;       /* Limit that ended the command, if known */
+    int in_cgroup;                      /* Ran in its own cgroup */
+    size_t cgroup_memory_peak_bytes;    /* memory.peak (0 = not reported by the kernel) */
+    long long cgroup_cpu_ms;            /* cpu.stat usage_usec */
+    unsigned int cgroup_pids_peak;      /* pids.peak (0 = not reported by the kernel) */
+} ac_sandbox_exec_stats_t;
+
+/**
+ * @brief Options for ac_sandbox_exec_ex()
+ */
+typedef struct {
+    int timeout_ms;                     /* Deadline for the whole run (0 = none) */
+    ac_sandbox_output_fn on_output;     /* Streaming callback (NULL = none) */
+    void *user_data;                    /* Passed to on_output */
+    char *error_output;                 /* Separate stderr buffer (NULL = merge into output) */
+    size_t error_output_size;           /* Size of error_output */
+    ac_sandbox_exec_stats_t *stats;     /* Filled with resource usage (NULL = not needed) */
+} ac_sandbox_exec_options_t;
+
+/**
+ * @brief Execute a command in sandbox with streaming output
+ *
+ * Stdout and stderr are read from separate pipes as data arrives.
+ * The timeout is a deadline for the whole run: a command that keeps
+ * its output open still times out. On timeout, or when on_output asks
+ * to stop, the command's whole process group is killed. Output read
+ * before that stays in the buffers.
+ *
+ * @param sandbox      Sandbox configuration
+ * @param command      Command to execute
+ * @param output       Output buffer for stdout (and stderr if not separated)
+ * @param output_size  Size of output buffer
+ * @param exit_code    Pointer to receive exit code (can be NULL)
+ * @param options      Execution options (NULL = defaults)
+ * @return ARC_OK on success, ARC_ERR_TIMEOUT on timeout
+ */
+arc_err_t ac_sandbox_exec_ex(
+    ac_sandbox_t *sandbox,
+    const char *command,
+    char *output,
+    size_t output_size,
+    int *exit_code,
+    const ac_sandbox_exec_options_t *options
+);
+
+/*============================================================================
+ * Persistent Shell Session API
+ *============================================================================*/
+
+/**
+ * @brief Long-lived shell that keeps state between commands
+ *
+ * Commands run one at a time in the same /bin/sh process, so the working
+ * directory, exported variables and shell functions carry over. Each
+ * command is framed by a random sentinel the shell prints after it; the
+ * sentinel line also reports the exit code and the new working directory.
+ * Commands read stdin from /dev/null so they cannot consume the framing.
+ *
+ * A command that times out (or is stopped by on_output) takes down the
+ * shell's process group; the next command starts a fresh shell in the
+ * last known working directory. Exported variables and functions do not
+ * survive a restart. Not available on Windows.
+ */
+typedef struct ac_sandbox_shell ac_sandbox_shell_t;
+
+/**
+ * @brief Create a shell session
+ *
+ * The shell process is started by the first command.
+ *
+ * @param sandbox  Sandbox whose command checks apply (must outlive the session)
+ * @param cwd      Initial working directory (NULL = sandbox workspace)
+ * @return Session handle, or NULL on error
+ */
+ac_sandbox_shell_t *ac_sandbox_shell_open(ac_sandbox_t *sandbox, const char *cwd);
+
+/**
+ * @brief Run a command in the session's shell
+ *
+ * Same buffers, options and results as ac_sandbox_exec_ex(). When the
+ * command makes the shell exit (e.g. `exit 2`), its status is returned
+ * and the next command starts a new shell.
+ *
+ * @param shell        Session
+ * @param command      Command to execute
+ * @param output       Output buffer for stdout (and stderr if not separated)
+ * @param output_size  Size of output buffer
+ * @param exit_code    Pointer to receive exit code (can be NULL)
+ * @param options      Execution options (NULL = defaults)
+ * @return ARC_OK on success, ARC_ERR_TIMEOUT on timeout
+ */
+arc_err_t ac_sandbox_shell_exec(
+    ac_sandbox_shell_t *shell,
+    const char *command,
+    char *output,
+    size_t output_size,
+    int *exit_code,
+    const ac_sandbox_exec_options_t *options
+);
+
+/**
+ * @brief Working directory of the shell after the last command
+ */
+const char *ac_sandbox_shell_cwd(const ac_sandbox_shell_t *shell);
+
+/**
+ * @brief Stop the shell (and its background jobs) and free the session
+ */
+void ac_sandbox_shell_close(ac_sandbox_shell_t *shell);
+
 /*============================================================================
  * Human-in-the-Loop Confirmation API
  *============================================================================*/
@@ -0,0 +1,127 @@
+/**
+ * @file search_index.h
+ * @brief Persistent trigram index for workspace content search
+ *
+ * Maps every 3-byte sequence (ASCII case folded) of the workspace's
+ * text files to the files containing it. A grep with a required literal
+ * (see ac_grep_literal()) then only needs to open the files holding all
+ * of the literal's trigrams instead of every file in the tree.
+ *
+ * The index lives in one file under a cache directory and is mmapped.
+ * The file set matches ac_walk() with default options: ignore files are
+ * honored, hidden entries skipped.
+ *
+ * Keeping it current:
+ *   - With `watch` (Linux), inotify reports edits as they happen; edited
+ *     files are searched directly until enough accumulate, and files
+ *     created, moved or deleted trigger a re-check of the tree.
+ *   - Without it, every query re-checks sizes and mtimes (a walk plus
+ *     one stat per file, no reads).
+ *   - Rewriting the index reuses the postings of unchanged files, so
+ *     only changed files are read again.
+ * When the index cannot be trusted (a write failed, inotify overflowed
+ * and the re-check failed) queries report it and the caller scans.
+ *
+ * An index handle is not thread-safe.
+ */
+
+#ifndef ARC_HOSTED_SEARCH_INDEX_H
+#define ARC_HOSTED_SEARCH_INDEX_H
+
+#include <arc/error.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+typedef struct ac_search_index ac_search_index_t;
+
+typedef struct {
+    const char *cache_dir;              /* NULL = $XDG_CACHE_HOME/arc/index (~/.cache/arc/index) */
+    int watch;                          /* Follow changes with inotify where available */
+    size_t max_file_size;               /* Larger files are not indexed but always searched (0 = 4 MiB) */
+    const char *const *ignore_globs;    /* Extra ignore rules as in ac_walk_options_t; must outlive the index */
+    size_t ignore_globs_count;
+} ac_search_index_options_t;
+
+typedef struct {
+    size_t files;                       /* Files in the index file */
+    size_t trigrams;                    /* Distinct trigrams */
+    size_t index_bytes;                 /* Size of the index file */
+    size_t dirty;                       /* Files changed since the index was written */
+    size_t writes;                      /* Index files written by this handle */
+    size_t reused;                      /* Files carried over without reading at the last write */
+    int watching;                       /* inotify active */
+    int stale;                          /* Queries fall back to a full scan */
+} ac_search_index_stats_t;
+
+typedef struct {
+    char **paths;                       /* Relative to the root, in walk order */
+    size_t count;
+} ac_search_index_result_t;
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+/**
+ * @brief Open the index of a directory, building or updating it as needed
+ *
+ * @param root     Workspace directory
+ * @param options  Options (NULL = defaults, no watching)
+ * @param out      Receives the handle
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_IO, ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_search_index_open(
+    const char *root,
+    const ac_search_index_options_t *options,
+    ac_search_index_t **out
+);
+
+/**
+ * @brief Files that may contain a literal
+ *
+ * Brings the index up to date first (see ac_search_index_refresh()).
+ * Matching is ASCII case-insensitive, so candidates also cover a
+ * case-sensitive search.
+ *
+ * @param literal  Bytes every match contains
+ * @param len      Length of literal
+ * @param result   Receives the candidates when 1 is returned
+ * @return 1 if result lists every file that can contain the literal,
+ *         0 if the caller has to scan everything (literal shorter than
+ *         3 bytes, or the index is stale)
+ */
+int ac_search_index_query(
+    ac_search_index_t *index,
+    const char *literal,
+    size_t len,
+    ac_search_index_result_t *result
+);
+
+void ac_search_index_result_free(ac_search_index_result_t *result);
+
+/**
+ * @brief Apply pending changes (inotify events or an mtime re-check)
+ *
+ * Rewrites the index once too many files changed.
+ */
+arc_err_t ac_search_index_refresh(ac_search_index_t *index);
+
+void ac_search_index_stats(const ac_search_index_t *index, ac_search_index_stats_t *stats);
+
+/* Canonical root path */
+const char *ac_search_index_root(const ac_search_index_t *index);
+
+void ac_search_index_close(ac_search_index_t *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HOSTED_SEARCH_INDEX_H */
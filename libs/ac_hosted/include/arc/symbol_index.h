@@ -0,0 +1,178 @@
+/**
+ * @file symbol_index.h
+ * @brief Persistent symbol index: where names are defined and used
+ *
+ * Records every definition, declaration and reference of a name in the
+ * workspace's source files, with its kind and enclosing scope, so that
+ * "where is X defined / used" is a table lookup instead of a grep.
+ *
+ * Languages:
+ *   - C and C++ (.c .h .cc .cpp .cxx .hh .hpp .hxx) are parsed with
+ *     tree-sitter and the symbols extracted with a query. C++ goes
+ *     through the C grammar: functions, types, macros and references
+ *     are found, members of classes and namespaces partly.
+ *   - Python, JavaScript/TypeScript, Go and Rust are scanned lexically:
+ *     a name following a definition keyword ("def", "class", "function",
+ *     "func", "fn", "struct", ...) is a definition, other identifiers
+ *     outside strings and comments are references.
+ *
+ * The index lives in one file under a cache directory and is loaded
+ * into memory on open. The file set matches ac_walk() with default
+ * options. Changed files are parsed again on their own, as with
+ * arc/search_index.h either when inotify reports them (`watch`) or
+ * when a query finds their size or mtime changed.
+ *
+ * An index handle is not thread-safe.
+ */
+
+#ifndef ARC_HOSTED_SYMBOL_INDEX_H
+#define ARC_HOSTED_SYMBOL_INDEX_H
+
+#include <arc/error.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+typedef struct ac_symbol_index ac_symbol_index_t;
+
+typedef enum {
+    AC_SYMBOL_FUNCTION = 0,
+    AC_SYMBOL_VARIABLE,
+    AC_SYMBOL_PARAMETER,
+    AC_SYMBOL_FIELD,
+    AC_SYMBOL_STRUCT,
+    AC_SYMBOL_UNION,
+    AC_SYMBOL_ENUM,
+    AC_SYMBOL_ENUMERATOR,
+    AC_SYMBOL_TYPEDEF,                  /* typedef, type alias, interface, trait */
+    AC_SYMBOL_MACRO,
+    AC_SYMBOL_CLASS,
+    AC_SYMBOL_NAME,                     /* Reference of unknown kind */
+} ac_symbol_kind_t;
+
+/* Roles, also used as query masks */
+#define AC_SYMBOL_DEFINITION  1
+#define AC_SYMBOL_DECLARATION 2         /* Prototype or extern */
+#define AC_SYMBOL_REFERENCE   4
+#define AC_SYMBOL_ALL         7
+#define AC_SYMBOL_IGNORE_CASE 8         /* Query flag: ASCII case-insensitive names */
+
+typedef struct {
+    const char *cache_dir;              /* NULL = $XDG_CACHE_HOME/arc/index (~/.cache/arc/index) */
+    int watch;                          /* Follow changes with inotify where available */
+    size_t max_file_size;               /* Larger files are not indexed (0 = 1 MiB) */
+    const char *const *ignore_globs;    /* Extra ignore rules as in ac_walk_options_t; must outlive the index */
+    size_t ignore_globs_count;
+} ac_symbol_index_options_t;
+
+typedef struct {
+    const char *name;
+    const char *path;                   /* Relative to the root */
+    const char *scope;                  /* Enclosing function or type ("" at file scope) */
+    unsigned line;                      /* 1-based */
+    unsigned column;                    /* 1-based, in bytes */
+    ac_symbol_kind_t kind;
+    int role;                           /* One AC_SYMBOL_DEFINITION/DECLARATION/REFERENCE */
+} ac_symbol_t;
+
+typedef struct {
+    ac_symbol_t *symbols;               /* Definitions, declarations, references; then path, line */
+    size_t count;
+    size_t total;                       /* Matches before the limit */
+    char *strings;                      /* Storage of the strings above */
+} ac_symbol_result_t;
+
+typedef struct {
+    size_t files;                       /* Indexed source files */
+    size_t symbols;                     /* Definitions, declarations and references */
+    size_t names;                       /* Distinct names */
+    size_t index_bytes;                 /* Size of the index file at the last write */
+    size_t parsed;                      /* Files parsed by this handle */
+    size_t writes;                      /* Index files written by this handle */
+    int watching;                       /* inotify active */
+} ac_symbol_index_stats_t;
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+/**
+ * @brief Open the index of a directory, building or updating it as needed
+ *
+ * The first build parses every source file (on several threads); later
+ * opens only parse the files that changed since the index was written.
+ *
+ * @param root     Workspace directory
+ * @param options  Options (NULL = defaults, no watching)
+ * @param out      Receives the handle
+ * @return ARC_OK, ARC_ERR_INVALID_ARG, ARC_ERR_IO, ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_symbol_index_open(
+    const char *root,
+    const ac_symbol_index_options_t *options,
+    ac_symbol_index_t **out
+);
+
+/**
+ * @brief Occurrences of a name
+ *
+ * Brings the index up to date first (see ac_symbol_index_refresh()).
+ *
+ * @param name    Exact name ("ac_walk", not a pattern)
+ * @param flags   AC_SYMBOL_* roles to return, optionally | AC_SYMBOL_IGNORE_CASE
+ * @param limit   Maximum symbols returned (0 = all); total counts them all
+ * @param result  Receives the symbols; free with ac_symbol_result_free()
+ */
+arc_err_t ac_symbol_index_find(
+    ac_symbol_index_t *index,
+    const char *name,
+    int flags,
+    size_t limit,
+    ac_symbol_result_t *result
+);
+
+/**
+ * @brief Definitions and declarations of one file, in source order
+ *
+ * @param path  Path relative to the root
+ * @return ARC_OK, ARC_ERR_NOT_FOUND (not an indexed file), ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_symbol_index_file_symbols(
+    ac_symbol_index_t *index,
+    const char *path,
+    ac_symbol_result_t *result
+);
+
+void ac_symbol_result_free(ac_symbol_result_t *result);
+
+/**
+ * @brief Parse files changed since the last call (inotify events or an
+ * mtime re-check); rewrites the index file once enough changed
+ */
+arc_err_t ac_symbol_index_refresh(ac_symbol_index_t *index);
+
+/* Write the index file now if anything changed since the last write */
+arc_err_t ac_symbol_index_save(ac_symbol_index_t *index);
+
+void ac_symbol_index_stats(const ac_symbol_index_t *index, ac_symbol_index_stats_t *stats);
+
+/* "function", "struct", ... */
+const char *ac_symbol_kind_name(ac_symbol_kind_t kind);
+
+/* Canonical root path */
+const char *ac_symbol_index_root(const ac_symbol_index_t *index);
+
+/* Saves pending changes */
+void ac_symbol_index_close(ac_symbol_index_t *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HOSTED_SYMBOL_INDEX_H */
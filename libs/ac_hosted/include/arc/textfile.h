@@ -0,0 +1,146 @@
+/**
+ * @file textfile.h
+ * @brief Mapped text files with a line-offset index
+ *
+ * A text file is mapped (small files are read into memory) and, on the
+ * first line access, scanned once for newlines to record where every
+ * line starts. Any line range can then be read without scanning what
+ * precedes it.
+ *
+ * Files come from a cache keyed by path, device, inode, mtime and size:
+ * opening a file that has not changed returns the same mapping and
+ * index. A changed file gets a new entry; handles still holding the old
+ * one keep it until released.
+ *
+ * A watching cache (Linux) also follows the directories of its files
+ * with inotify. Any change to a file drops it, so an unchanged file is
+ * served without even a stat(). Only files opened by their canonical
+ * path are watched; a path through a symlink is checked with stat() as
+ * in a plain cache. Changes made through another hard link are not seen
+ * by a watch; tools that write files should invalidate them.
+ *
+ * Lines end at "\n"; a "\r" before it is not part of the line. A final
+ * line without newline counts as a line, so "a\nb" and "a\nb\n" both
+ * have two lines.
+ *
+ * Mapped files are read in place: truncating one while a handle is in
+ * use is undefined, as with any mmap. Caches and handles may be shared
+ * between threads.
+ */
+
+#ifndef ARC_HOSTED_TEXTFILE_H
+#define ARC_HOSTED_TEXTFILE_H
+
+#include <arc/error.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+typedef struct ac_textfile ac_textfile_t;
+typedef struct ac_textfile_cache ac_textfile_cache_t;
+
+typedef struct {
+    size_t max_files;                   /* Files kept after release (0 = 32) */
+    size_t max_bytes;                   /* Bytes kept after release (0 = 256 MiB) */
+    int watch;                          /* Drop changed files via inotify (Linux) */
+} ac_textfile_cache_options_t;
+
+typedef struct {
+    size_t files;                       /* Cached files */
+    size_t bytes;                       /* Their total size */
+    size_t hits;                        /* Opens served from the cache */
+    size_t misses;                      /* Opens that mapped the file */
+    size_t invalidations;               /* Files dropped by invalidate or watch events */
+} ac_textfile_cache_stats_t;
+
+/*============================================================================
+ * Cache
+ *============================================================================*/
+
+/**
+ * @param options  Limits (NULL = defaults)
+ * @return Cache, or NULL on allocation failure
+ */
+ac_textfile_cache_t *ac_textfile_cache_create(const ac_textfile_cache_options_t *options);
+
+void ac_textfile_cache_stats(ac_textfile_cache_t *cache, ac_textfile_cache_stats_t *stats);
+
+/**
+ * @brief Drop a file from the cache (e.g. after writing it)
+ *
+ * Handles still holding it keep the old contents.
+ *
+ * @param path  Path as passed to ac_textfile_open() (NULL = every file)
+ */
+void ac_textfile_cache_invalidate(ac_textfile_cache_t *cache, const char *path);
+
+/* Handles still open stay valid until released */
+void ac_textfile_cache_destroy(ac_textfile_cache_t *cache);
+
+/*============================================================================
+ * Files
+ *============================================================================*/
+
+/**
+ * @brief Open a regular file
+ *
+ * @param cache  Cache to use (NULL = map privately for this handle)
+ * @param path   File path
+ * @param out    Receives the handle
+ * @return ARC_OK, ARC_ERR_INVALID_ARG (NULL argument or not a regular
+ *         file), ARC_ERR_IO, ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_textfile_open(ac_textfile_cache_t *cache, const char *path, ac_textfile_t **out);
+
+/**
+ * @brief Open a file only if the cache holds it, unchanged
+ *
+ * For callers that would otherwise read the file themselves (such as a
+ * grep over a whole tree) and should not fill the cache with it.
+ *
+ * @return ARC_OK, ARC_ERR_NOT_FOUND (not cached or changed),
+ *         ARC_ERR_INVALID_ARG
+ */
+arc_err_t ac_textfile_peek(ac_textfile_cache_t *cache, const char *path, ac_textfile_t **out);
+
+void ac_textfile_release(ac_textfile_t *file);
+
+const char *ac_textfile_data(const ac_textfile_t *file);
+
+size_t ac_textfile_size(const ac_textfile_t *file);
+
+/* NUL byte in the first 8 KiB, as ac_grep_is_binary() */
+int ac_textfile_is_binary(const ac_textfile_t *file);
+
+/**
+ * @brief Number of lines (builds the line index on first use)
+ * @return Line count, or 0 for an empty file or if the index could not
+ *         be allocated
+ */
+size_t ac_textfile_line_count(ac_textfile_t *file);
+
+/**
+ * @brief One line, without its line ending
+ *
+ * @param index  0-based line number
+ * @param len    Receives the line length
+ * @return Start of the line (not NUL-terminated), or NULL past the end
+ */
+const char *ac_textfile_line(ac_textfile_t *file, size_t index, size_t *len);
+
+/**
+ * @brief Count newline bytes in a buffer (vectorized where available)
+ */
+size_t ac_textfile_count_newlines(const char *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HOSTED_TEXTFILE_H */
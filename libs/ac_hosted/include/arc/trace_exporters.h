@@ -116,6 +116,156 @@ void ac_trace_json_exporter_cleanup(void);
  */
 const char *ac_trace_json_exporter_get_path(void);
 
+/*============================================================================
+ * Binary File Exporter Configuration
+ *============================================================================*/
+
+/**
+ * @brief Block compression for the binary exporter
+ *
+ * LZ4 and zstd are only available when ac_hosted is built against the
+ * corresponding library; otherwise blocks are stored uncompressed.
+ */
+typedef enum {
+    AC_TRACE_COMPRESS_NONE = 0,  /**< Store blocks as-is */
+    AC_TRACE_COMPRESS_LZ4  = 1,  /**< LZ4 (fast, moderate ratio) */
+    AC_TRACE_COMPRESS_ZSTD = 2   /**< zstd level 3 (better ratio) */
+} ac_trace_compression_t;
+
+/**
+ * @brief Binary exporter configuration options
+ */
+typedef struct {
+    const char *output_dir;              /**< Output directory (default: "logs") */
+    const char *file_name;               /**< File in output_dir, appended if it exists
+                                              (default: trace_{YYYYMMDD_HHMMSS}.actrace) */
+    ac_trace_compression_t compression;  /**< Block compression (default: none) */
+    size_t block_size;                   /**< Bytes buffered per block (default: 64KB) */
+    int flush_after_event;               /**< Write a block after every event (default: 0) */
+} ac_trace_binary_config_t;
+
+#define AC_TRACE_BINARY_DEFAULT_BLOCK_SIZE  (64 * 1024)
+#define AC_TRACE_BINARY_EXT                 ".actrace"
+
+/*============================================================================
+ * Binary File Exporter API
+ *============================================================================*/
+
+/**
+ * @brief Initialize the binary file exporter
+ *
+ * Appends all runs to a single compact trace file. Records are
+ * length-prefixed, short strings are interned per run and the message
+ * history of successive LLM requests is delta-encoded, so long sessions
+ * stay small on disk.
+ *
+ * The file is append-only and written in CRC-checked blocks; after a crash
+ * at most the last unwritten block is lost. A sidecar index
+ * ({file}.idx) maps each run to its offset for random access.
+ *
+ * Use the reader API below or the arc_trace_convert tool to turn the file
+ * into JSON/JSONL.
+ *
+ * @param config Configuration options (NULL for defaults)
+ * @return 0 on success, -1 on error
+ */
+int ac_trace_binary_exporter_init(const ac_trace_binary_config_t *config);
+
+/**
+ * @brief Cleanup the binary file exporter
+ *
+ * Writes pending blocks and closes the trace and index files.
+ */
+void ac_trace_binary_exporter_cleanup(void);
+
+/**
+ * @brief Get the binary trace file path
+ *
+ * @return File path (static buffer), or NULL if not initialized
+ */
+const char *ac_trace_binary_exporter_get_path(void);
+
+/*============================================================================
+ * Binary Trace Reader API
+ *============================================================================*/
+
+/**
+ * @brief Opaque binary trace reader
+ */
+typedef struct ac_trace_reader ac_trace_reader_t;
+
+/**
+ * @brief Summary of one run (agent_start .. agent_end) in a trace file
+ */
+typedef struct {
+    char trace_id[32];
+    char agent_name[64];
+    uint64_t offset;             /**< File offset of the run's first block */
+    uint64_t start_ms;
+    uint64_t end_ms;             /**< 0 if the run did not complete */
+    uint32_t event_count;
+    int complete;                /**< 1 if agent_end was recorded */
+} ac_trace_run_info_t;
+
+/**
+ * @brief Open a binary trace file
+ *
+ * Uses the sidecar index when present and scans only the part of the file
+ * not covered by it.
+ *
+ * @param path Trace file path
+ * @return Reader, or NULL if the file is missing or not a trace file
+ */
+ac_trace_reader_t *ac_trace_reader_open(const char *path);
+
+/**
+ * @brief Close a reader
+ */
+void ac_trace_reader_close(ac_trace_reader_t *reader);
+
+/**
+ * @brief Number of runs in the file
+ */
+size_t ac_trace_reader_run_count(const ac_trace_reader_t *reader);
+
+/**
+ * @brief Get run summary by position
+ *
+ * @return Run info (owned by reader), or NULL if out of range
+ */
+const ac_trace_run_info_t *ac_trace_reader_run(const ac_trace_reader_t *reader, size_t index);
+
+/**
+ * @brief Find a run by trace ID
+ *
+ * @return Run index, or -1 if not found
+ */
+int ac_trace_reader_find_run(const ac_trace_reader_t *reader, const char *trace_id);
+
+/**
+ * @brief Decode a run and deliver its events to a trace handler
+ *
+ * Events are reconstructed exactly as they were emitted, so any
+ * ac_trace_handler_t (including the exporters' handlers) can consume them.
+ * Event pointers are valid only during the callback.
+ *
+ * @param reader    Reader
+ * @param index     Run index
+ * @param handler   Event handler
+ * @param user_data User data passed to handler
+ * @return Number of events delivered, or -1 on error
+ */
+int ac_trace_reader_replay(ac_trace_reader_t *reader, size_t index,
+                           ac_trace_handler_t handler, void *user_data);
+
+/**
+ * @brief Rebuild the sidecar index of a trace file by scanning it
+ *
+ * @param path Trace file path
+ * @return Number of runs indexed, or -1 on error
+ */
+int ac_trace_binary_rebuild_index(const char *path);
+
 /*============================================================================
  * Console Exporter API (for development/debugging)
  *============================================================================*/
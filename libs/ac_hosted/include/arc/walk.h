@@ -0,0 +1,107 @@
+/**
+ * @file walk.h
+ * @brief Parallel, gitignore-aware directory walker
+ *
+ * Walks a directory tree the way ripgrep does:
+ *   - .gitignore files (inside a git repository, including those of
+ *     parent directories up to the repository root), .git/info/exclude
+ *     and the global excludes file are honored; .ignore files are
+ *     honored everywhere and take precedence over .gitignore.
+ *   - Hidden entries (dot names) are skipped unless requested; the .git
+ *     directory is always skipped.
+ *   - Entry types come from d_type; stat() is only called when the
+ *     file system does not report one (or to follow a symlink).
+ *
+ * Directories are read by a pool of threads ahead of the caller, but
+ * entries are always delivered on the calling thread in the same
+ * order: depth first, names sorted bytewise within each directory.
+ */
+
+#ifndef ARC_HOSTED_WALK_H
+#define ARC_HOSTED_WALK_H
+
+#include <arc/error.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+typedef enum {
+    AC_WALK_FILE = 0,
+    AC_WALK_DIR,
+    AC_WALK_SYMLINK,                    /* Not followed (follow_links = 0) */
+    AC_WALK_OTHER,                      /* Sockets, devices, FIFOs */
+} ac_walk_type_t;
+
+/**
+ * @brief One entry of the walk
+ *
+ * Strings are only valid during the callback.
+ */
+typedef struct {
+    const char *path;                   /* root + "/" + rel_path */
+    const char *rel_path;               /* Relative to the root */
+    const char *name;                   /* Last component */
+    ac_walk_type_t type;
+    int depth;                          /* 1 = directly inside the root */
+} ac_walk_entry_t;
+
+/* Callback results */
+#define AC_WALK_CONTINUE 0
+#define AC_WALK_SKIP     1              /* Do not descend into this directory */
+#define AC_WALK_STOP     2              /* End the walk */
+
+typedef int (*ac_walk_fn)(const ac_walk_entry_t *entry, void *user_data);
+
+/**
+ * @brief Walk options (zero-initialized = ripgrep defaults)
+ */
+typedef struct {
+    int threads;                        /* Directory readers (0 = one per CPU, max 8) */
+    int max_depth;                      /* 0 = unlimited, 1 = the root's entries only */
+    int hidden;                         /* Include dot names */
+    int follow_links;                   /* Descend into symlinked directories */
+    int no_ignore;                      /* Ignore no files (.gitignore, .ignore, excludes) */
+    const char *const *ignore_globs;    /* Extra gitignore-style rules, highest priority */
+    size_t ignore_globs_count;
+
+    /* Return 0 to not descend into a directory (rel_path relative to the
+     * root). Called from reader threads, so it must be thread-safe; the
+     * directory itself is still passed to on_entry. NULL = descend all. */
+    int (*descend)(const char *rel_path, void *ctx);
+    void *descend_ctx;
+} ac_walk_options_t;
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+/**
+ * @brief Walk a directory tree
+ *
+ * If root is a file, the callback is called once for it.
+ *
+ * @param root       Directory (or file) to walk
+ * @param options    Options (NULL = defaults)
+ * @param on_entry   Called for every entry that is not ignored
+ * @param user_data  Passed to on_entry
+ * @return ARC_OK (also when stopped by the callback), ARC_ERR_INVALID_ARG,
+ *         ARC_ERR_IO if root cannot be read, ARC_ERR_NO_MEMORY
+ */
+arc_err_t ac_walk(
+    const char *root,
+    const ac_walk_options_t *options,
+    ac_walk_fn on_entry,
+    void *user_data
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_HOSTED_WALK_H */
@@ -0,0 +1,85 @@
+/**
+ * @file lsp_internal.h
+ * @brief Internal declarations shared by the LSP client components
+ */
+
+#ifndef ARC_HOSTED_LSP_INTERNAL_H
+#define ARC_HOSTED_LSP_INTERNAL_H
+
+#include <arc/error.h>
+#include <cJSON.h>
+#include <stddef.h>
+
+/*============================================================================
+ * JSON-RPC over a Child Process
+ *============================================================================*/
+
+typedef struct lsp_rpc lsp_rpc_t;
+
+/* Notification from the server; called on the reader thread */
+typedef void (*lsp_notify_fn)(void *user_data, const char *method, const cJSON *params);
+
+/*
+ * Request from the server; called on the reader thread. Returns the
+ * result (ownership passes to the caller, NULL = JSON null) or sets
+ * *error_code to answer with an error instead.
+ */
+typedef cJSON *(*lsp_request_fn)(void *user_data, const char *method, const cJSON *params, int *error_code);
+
+/**
+ * @brief Start a server process and its reader thread
+ *
+ * The process runs in `cwd` in its own process group, with stderr
+ * discarded. Fails at once if argv[0] cannot be executed.
+ *
+ * @return ARC_OK, ARC_ERR_IO (reason in ac_lsp_error()), ARC_ERR_NO_MEMORY
+ */
+arc_err_t lsp_rpc_start(
+    const char *const *argv,
+    const char *cwd,
+    lsp_notify_fn on_notify,
+    lsp_request_fn on_request,
+    void *user_data,
+    lsp_rpc_t **out
+);
+
+/**
+ * @brief Send a request and wait for its response
+ *
+ * Any number of threads may wait at once. A request that times out is
+ * cancelled with $/cancelRequest.
+ *
+ * @param params  Consumed (NULL = none)
+ * @param result  Receives the result (may be NULL for JSON null); cJSON_Delete() it
+ * @return ARC_OK, ARC_ERR_TIMEOUT, ARC_ERR_IO (server gone),
+ *         ARC_ERR_PROTOCOL (error response, message in ac_lsp_error())
+ */
+arc_err_t lsp_rpc_call(lsp_rpc_t *rpc, const char *method, cJSON *params, int timeout_ms, cJSON **result);
+
+/* Send a notification; params is consumed */
+arc_err_t lsp_rpc_notify(lsp_rpc_t *rpc, const char *method, cJSON *params);
+
+/* The process is running and its output open */
+int lsp_rpc_alive(lsp_rpc_t *rpc);
+
+/*
+ * Wait up to `wait_ms` for the process to exit, then kill its process
+ * group and join the reader. Later calls fail with ARC_ERR_IO.
+ */
+void lsp_rpc_stop(lsp_rpc_t *rpc, int wait_ms);
+
+/* Stops if needed; no other thread may still use the handle */
+void lsp_rpc_free(lsp_rpc_t *rpc);
+
+/*============================================================================
+ * Errors
+ *============================================================================*/
+
+/* Set the message ac_lsp_error() returns on this thread */
+void lsp_set_error(const char *fmt, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 1, 2)))
+#endif
+    ;
+
+#endif /* ARC_HOSTED_LSP_INTERNAL_H */
@@ -0,0 +1,1393 @@
+/**
+ * @file lsp_pool.c
+ * @brief Language server pool, document sync and queries
+ *
+ * Each configured server has two locks. `start_lock` serializes what
+ * changes the connection or a document's contents: starting and
+ * restarting the server, didOpen/didChange/didClose. It is released
+ * before waiting for a response, so queries run concurrently. `lock`
+ * guards the document list and the diagnostics the reader thread
+ * stores, and is never held across I/O. Document fields change with
+ * both held and may be read with either.
+ *
+ * Connections to servers that exited are stopped but only freed with
+ * the pool, as other threads may still be returning from calls on them.
+ */
+
+#if !defined(_WIN32)
+
+#include "lsp_internal.h"
+#include <arc/log.h>
+#include <arc/lsp.h>
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+#define LSP_REQUEST_TIMEOUT_MS  15000
+#define LSP_START_TIMEOUT_MS    60000
+#define LSP_MAX_DOCUMENTS       64
+#define LSP_RETRY_SECONDS       30          /* After a failed start */
+#define LSP_SHUTDOWN_MS         1000
+#define LSP_MAX_FILE_SIZE       (16u << 20)
+
+/* TextDocumentSyncKind */
+#define SYNC_NONE               0
+#define SYNC_FULL               1
+#define SYNC_INCREMENTAL        2
+
+/* Server features from its capabilities */
+#define CAP_DEFINITION          1
+#define CAP_REFERENCES          2
+#define CAP_HOVER               4
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+typedef struct {
+    char *path;                         /* Absolute, canonical */
+    char *uri;
+    char *text;                         /* As last sent; NUL-terminated */
+    size_t len;
+    int version;
+    uint64_t used;                      /* LRU clock */
+
+    /* Written by the reader thread */
+    cJSON *diagnostics;                 /* Last published array */
+    int diag_version;                   /* Version they were published for (-1 = not given) */
+    uint64_t diag_seq;                  /* Publishes received */
+    uint64_t synced_seq;                /* diag_seq when the contents were last sent */
+} lsp_document_t;
+
+typedef struct {
+    ac_lsp_pool_t *pool;
+    ac_lsp_server_config_t config;      /* Points to the copies below */
+    char *language;
+    char *extensions;
+    char **argv;
+
+    pthread_mutex_t start_lock;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;                /* Diagnostics arrived */
+
+    lsp_rpc_t *rpc;                     /* NULL = not started */
+    lsp_rpc_t **retired;
+    size_t retired_count;
+    int sync_kind;
+    int utf8;                           /* Positions in bytes instead of UTF-16 units */
+    int caps;
+    time_t retry_after;
+    char start_error[256];
+
+    lsp_document_t **docs;
+    size_t doc_count;
+    size_t doc_capacity;
+    uint64_t clock;
+
+    size_t starts;
+    size_t requests;
+    size_t incremental_changes;
+    size_t full_changes;
+} lsp_server_t;
+
+struct ac_lsp_pool {
+    char *root;
+    char *root_uri;
+    int request_timeout_ms;
+    int start_timeout_ms;
+    size_t max_documents;
+    lsp_server_t *servers;
+    size_t server_count;
+};
+
+/*============================================================================
+ * Default Servers
+ *============================================================================*/
+
+static const char *const CLANGD_ARGV[] = { "clangd", "--background-index", NULL };
+static const char *const PYRIGHT_ARGV[] = { "pyright-langserver", "--stdio", NULL };
+static const char *const TSSERVER_ARGV[] = { "typescript-language-server", "--stdio", NULL };
+static const char *const GOPLS_ARGV[] = { "gopls", NULL };
+static const char *const RUST_ANALYZER_ARGV[] = { "rust-analyzer", NULL };
+
+static const ac_lsp_server_config_t DEFAULT_SERVERS[] = {
+    { "c",          ".c .h .cc .cpp .cxx .hh .hpp .hxx",        CLANGD_ARGV },
+    { "python",     ".py .pyi",                                 PYRIGHT_ARGV },
+    { "typescript", ".ts .tsx .mts .cts .js .jsx .mjs .cjs",    TSSERVER_ARGV },
+    { "go",         ".go",                                      GOPLS_ARGV },
+    { "rust",       ".rs",                                      RUST_ANALYZER_ARGV },
+};
+
+/* languageId of the protocol by extension; others use the server's language */
+static const struct {
+    const char *ext;
+    const char *id;
+} LANGUAGE_IDS[] = {
+    { ".c", "c" }, { ".h", "c" },
+    { ".cc", "cpp" }, { ".cpp", "cpp" }, { ".cxx", "cpp" },
+    { ".hh", "cpp" }, { ".hpp", "cpp" }, { ".hxx", "cpp" },
+    { ".py", "python" }, { ".pyi", "python" },
+    { ".ts", "typescript" }, { ".mts", "typescript" }, { ".cts", "typescript" },
+    { ".tsx", "typescriptreact" },
+    { ".js", "javascript" }, { ".mjs", "javascript" }, { ".cjs", "javascript" },
+    { ".jsx", "javascriptreact" },
+    { ".go", "go" },
+    { ".rs", "rust" },
+};
+
+const ac_lsp_server_config_t *ac_lsp_default_servers(size_t *count) {
+    if (count) *count = sizeof(DEFAULT_SERVERS) / sizeof(DEFAULT_SERVERS[0]);
+    return DEFAULT_SERVERS;
+}
+
+/*============================================================================
+ * Errors
+ *============================================================================*/
+
+static __thread char g_lsp_error[512] = {0};
+
+void lsp_set_error(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(g_lsp_error, sizeof(g_lsp_error), fmt, args);
+    va_end(args);
+}
+
+const char *ac_lsp_error(void) {
+    return g_lsp_error;
+}
+
+/*============================================================================
+ * Paths and URIs
+ *============================================================================*/
+
+static const char *file_extension(const char *path) {
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    const char *dot = strrchr(base, '.');
+    return dot && dot != base ? dot : NULL;
+}
+
+/* ext is one of the space-separated words of list */
+static int extension_listed(const char *list, const char *ext) {
+    size_t len = strlen(ext);
+    for (const char *p = list; *p; ) {
+        while (*p == ' ') p++;
+        const char *end = p;
+        while (*end && *end != ' ') end++;
+        if ((size_t)(end - p) == len && strncmp(p, ext, len) == 0) return 1;
+        p = end;
+    }
+    return 0;
+}
+
+static const char *language_id(const lsp_server_t *server, const char *path) {
+    const char *ext = file_extension(path);
+    if (ext) {
+        for (size_t i = 0; i < sizeof(LANGUAGE_IDS) / sizeof(LANGUAGE_IDS[0]); i++) {
+            if (strcmp(LANGUAGE_IDS[i].ext, ext) == 0) return LANGUAGE_IDS[i].id;
+        }
+    }
+    return server->language;
+}
+
+/* Canonical absolute path; relative paths are taken from the root */
+static char *absolute_path(const ac_lsp_pool_t *pool, const char *path) {
+    char joined[PATH_MAX];
+    if (path[0] == '/') {
+        snprintf(joined, sizeof(joined), "%s", path);
+    } else {
+        snprintf(joined, sizeof(joined), "%s/%s", pool->root, path);
+    }
+    char real[PATH_MAX];
+    return strdup(realpath(joined, real) ? real : joined);
+}
+
+static char *uri_from_path(const char *path) {
+    static const char hex[] = "0123456789ABCDEF";
+    size_t len = strlen(path);
+    char *uri = malloc(7 + len * 3 + 1);
+    if (!uri) return NULL;
+
+    char *out = uri;
+    memcpy(out, "file://", 7);
+    out += 7;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+        if ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9') ||
+            strchr("/-._~", *p)) {
+            *out++ = (char)*p;
+        } else {
+            *out++ = '%';
+            *out++ = hex[*p >> 4];
+            *out++ = hex[*p & 15];
+        }
+    }
+    *out = '\0';
+    return uri;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* Path of a file:// URI, or NULL */
+static char *path_from_uri(const char *uri) {
+    if (!uri || strncmp(uri, "file://", 7) != 0) return NULL;
+    uri += 7;
+    if (*uri != '/') {
+        /* "file://localhost/..." */
+        uri = strchr(uri, '/');
+        if (!uri) return NULL;
+    }
+
+    char *path = malloc(strlen(uri) + 1);
+    if (!path) return NULL;
+    char *out = path;
+    for (const char *p = uri; *p; p++) {
+        int hi, lo;
+        if (*p == '%' && (hi = hex_value(p[1])) >= 0 && (lo = hex_value(p[2])) >= 0) {
+            *out++ = (char)(hi * 16 + lo);
+            p += 2;
+        } else {
+            *out++ = *p;
+        }
+    }
+    *out = '\0';
+    return path;
+}
+
+/* Whole file, NUL-terminated; NULL if it cannot be read */
+static char *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size > LSP_MAX_FILE_SIZE) {
+        fclose(f);
+        return NULL;
+    }
+    char *text = malloc((size_t)st.st_size + 1);
+    if (!text) {
+        fclose(f);
+        return NULL;
+    }
+    size_t n = fread(text, 1, (size_t)st.st_size, f);
+    fclose(f);
+    text[n] = '\0';
+    *len = n;
+    return text;
+}
+
+/*============================================================================
+ * Positions
+ *
+ * The protocol counts lines from 0 and columns in UTF-16 code units
+ * (or bytes, where the server agreed to UTF-8). Our columns are bytes.
+ *============================================================================*/
+
+/* Byte offset of a 0-based line, or len if the text is shorter */
+static size_t line_offset(const char *text, size_t len, unsigned line) {
+    size_t off = 0;
+    while (line > 0 && off < len) {
+        const char *nl = memchr(text + off, '\n', len - off);
+        if (!nl) return len;
+        off = (size_t)(nl - text) + 1;
+        line--;
+    }
+    return line > 0 ? len : off;
+}
+
+/* Lines as an editor shows them: a final newline does not start another */
+static unsigned count_lines(const char *text, size_t len) {
+    unsigned n = 0;
+    for (const char *p = text; (p = memchr(p, '\n', len - (size_t)(p - text))) != NULL; p++) n++;
+    return len == 0 || text[len - 1] != '\n' ? n + 1 : n;
+}
+
+static size_t line_length(const char *text, size_t len, size_t start) {
+    const char *nl = memchr(text + start, '\n', len - start);
+    return nl ? (size_t)(nl - (text + start)) : len - start;
+}
+
+/* UTF-16 code units of n bytes of UTF-8 */
+static unsigned utf16_units(const char *s, size_t n) {
+    unsigned units = 0;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if ((c & 0xC0) == 0x80) continue;
+        units += c >= 0xF0 ? 2 : 1;
+    }
+    return units;
+}
+
+/* Bytes of a line holding `units` UTF-16 code units */
+static size_t utf16_bytes(const char *s, size_t line_len, unsigned units) {
+    size_t i = 0;
+    while (i < line_len && units > 0) {
+        unsigned char c = (unsigned char)s[i];
+        unsigned w = c >= 0xF0 ? 2 : 1;
+        if (w > units) break;
+        units -= w;
+        i++;
+        while (i < line_len && ((unsigned char)s[i] & 0xC0) == 0x80) i++;
+    }
+    return i;
+}
+
+/* Protocol character of a byte column on a line */
+static unsigned to_character(const lsp_server_t *server, const char *line, size_t bytes) {
+    return server->utf8 ? (unsigned)bytes : utf16_units(line, bytes);
+}
+
+/* Protocol position of a byte offset */
+static void offset_position(const lsp_server_t *server, const char *text, size_t off,
+                            unsigned *line, unsigned *character) {
+    unsigned n = 0;
+    size_t start = 0;
+    for (size_t i = 0; i < off; i++) {
+        if (text[i] == '\n') {
+            n++;
+            start = i + 1;
+        }
+    }
+    *line = n;
+    *character = to_character(server, text + start, off - start);
+}
+
+static cJSON *position_json(unsigned line, unsigned character) {
+    cJSON *pos = cJSON_CreateObject();
+    if (pos) {
+        cJSON_AddNumberToObject(pos, "line", line);
+        cJSON_AddNumberToObject(pos, "character", character);
+    }
+    return pos;
+}
+
+/* 1-based line and byte column of a protocol position, given the file's text */
+static void from_protocol(const lsp_server_t *server, const char *text, size_t len,
+                          const cJSON *position, unsigned *line, unsigned *column) {
+    int l = cJSON_GetObjectItem(position, "line") ? cJSON_GetObjectItem(position, "line")->valueint : 0;
+    int c = cJSON_GetObjectItem(position, "character") ? cJSON_GetObjectItem(position, "character")->valueint : 0;
+    if (l < 0) l = 0;
+    if (c < 0) c = 0;
+    *line = (unsigned)l + 1;
+
+    size_t bytes = (size_t)c;
+    if (text && !server->utf8) {
+        size_t start = line_offset(text, len, (unsigned)l);
+        bytes = utf16_bytes(text + start, line_length(text, len, start), (unsigned)c);
+    }
+    *column = (unsigned)bytes + 1;
+}
+
+/*============================================================================
+ * Documents
+ *============================================================================*/
+
+/* Caller holds either lock */
+static lsp_document_t *find_document(const lsp_server_t *server, const char *path) {
+    for (size_t i = 0; i < server->doc_count; i++) {
+        if (strcmp(server->docs[i]->path, path) == 0) return server->docs[i];
+    }
+    return NULL;
+}
+
+static lsp_document_t *find_document_uri(const lsp_server_t *server, const char *uri) {
+    for (size_t i = 0; i < server->doc_count; i++) {
+        if (strcmp(server->docs[i]->uri, uri) == 0) return server->docs[i];
+    }
+    return NULL;
+}
+
+static void free_document(lsp_document_t *doc) {
+    free(doc->path);
+    free(doc->uri);
+    free(doc->text);
+    cJSON_Delete(doc->diagnostics);
+    free(doc);
+}
+
+/* Forget a document (start_lock held) */
+static void remove_document(lsp_server_t *server, lsp_document_t *doc) {
+    pthread_mutex_lock(&server->lock);
+    for (size_t i = 0; i < server->doc_count; i++) {
+        if (server->docs[i] == doc) {
+            server->docs[i] = server->docs[--server->doc_count];
+            break;
+        }
+    }
+    pthread_cond_broadcast(&server->cond);
+    pthread_mutex_unlock(&server->lock);
+    free_document(doc);
+}
+
+static void close_document(lsp_server_t *server, lsp_document_t *doc) {
+    cJSON *params = cJSON_CreateObject();
+    if (params) {
+        cJSON *td = cJSON_AddObjectToObject(params, "textDocument");
+        cJSON_AddStringToObject(td, "uri", doc->uri);
+    }
+    lsp_rpc_notify(server->rpc, "textDocument/didClose", params);
+    remove_document(server, doc);
+}
+
+/* Close the least recently used documents beyond the limit */
+static void evict_documents(lsp_server_t *server, size_t keep) {
+    while (server->doc_count >= keep && server->doc_count > 0) {
+        lsp_document_t *oldest = server->docs[0];
+        for (size_t i = 1; i < server->doc_count; i++) {
+            if (server->docs[i]->used < oldest->used) oldest = server->docs[i];
+        }
+        close_document(server, oldest);
+    }
+}
+
+static arc_err_t open_document(lsp_server_t *server, const char *path, char *text, size_t len,
+                               lsp_document_t **out) {
+    evict_documents(server, server->pool->max_documents);
+
+    lsp_document_t *doc = calloc(1, sizeof(*doc));
+    if (!doc) {
+        free(text);
+        return ARC_ERR_NO_MEMORY;
+    }
+    doc->path = strdup(path);
+    doc->uri = uri_from_path(path);
+    doc->text = text;
+    doc->len = len;
+    doc->version = 1;
+    doc->diag_version = -1;
+    if (!doc->path || !doc->uri) {
+        free_document(doc);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    pthread_mutex_lock(&server->lock);
+    if (server->doc_count == server->doc_capacity) {
+        size_t cap = server->doc_capacity ? server->doc_capacity * 2 : 16;
+        lsp_document_t **docs = realloc(server->docs, cap * sizeof(*docs));
+        if (!docs) {
+            pthread_mutex_unlock(&server->lock);
+            free_document(doc);
+            return ARC_ERR_NO_MEMORY;
+        }
+        server->docs = docs;
+        server->doc_capacity = cap;
+    }
+    server->docs[server->doc_count++] = doc;
+    pthread_mutex_unlock(&server->lock);
+
+    cJSON *params = cJSON_CreateObject();
+    if (params) {
+        cJSON *td = cJSON_AddObjectToObject(params, "textDocument");
+        cJSON_AddStringToObject(td, "uri", doc->uri);
+        cJSON_AddStringToObject(td, "languageId", language_id(server, path));
+        cJSON_AddNumberToObject(td, "version", doc->version);
+        cJSON_AddStringToObject(td, "text", doc->text);
+    }
+    arc_err_t err = lsp_rpc_notify(server->rpc, "textDocument/didOpen", params);
+    if (err != ARC_OK) {
+        remove_document(server, doc);
+        return err;
+    }
+    *out = doc;
+    return ARC_OK;
+}
+
+/*
+ * One content change: the smallest range of the old text that differs,
+ * on character (and CRLF) boundaries, or the whole text.
+ */
+static cJSON *content_change(lsp_server_t *server, const lsp_document_t *doc, const char *text, size_t len) {
+    cJSON *change = cJSON_CreateObject();
+    if (!change) return NULL;
+
+    if (server->sync_kind != SYNC_INCREMENTAL) {
+        cJSON_AddStringToObject(change, "text", text);
+        server->full_changes++;
+        return change;
+    }
+
+    const char *old = doc->text;
+    size_t old_len = doc->len;
+    size_t min = old_len < len ? old_len : len;
+
+    size_t prefix = 0;
+    while (prefix < min && old[prefix] == text[prefix]) prefix++;
+    while (prefix > 0 && (((unsigned char)old[prefix] & 0xC0) == 0x80 ||
+                          (old[prefix - 1] == '\r' && old[prefix] == '\n'))) {
+        prefix--;
+    }
+
+    size_t suffix = 0;
+    while (suffix < min - prefix && old[old_len - 1 - suffix] == text[len - 1 - suffix]) suffix++;
+    while (suffix > 0 && (((unsigned char)old[old_len - suffix] & 0xC0) == 0x80 ||
+                          (old[old_len - suffix] == '\n' && old[old_len - suffix - 1] == '\r'))) {
+        suffix--;
+    }
+
+    unsigned sl, sc, el, ec;
+    offset_position(server, old, prefix, &sl, &sc);
+    offset_position(server, old, old_len - suffix, &el, &ec);
+
+    cJSON *range = cJSON_AddObjectToObject(change, "range");
+    cJSON_AddItemToObject(range, "start", position_json(sl, sc));
+    cJSON_AddItemToObject(range, "end", position_json(el, ec));
+
+    size_t n = len - suffix - prefix;
+    char *inserted = malloc(n + 1);
+    if (!inserted) {
+        cJSON_Delete(change);
+        return NULL;
+    }
+    memcpy(inserted, text + prefix, n);
+    inserted[n] = '\0';
+    cJSON_AddStringToObject(change, "text", inserted);
+    free(inserted);
+
+    server->incremental_changes++;
+    return change;
+}
+
+/*
+ * Make the server's copy of a file match `text` (owned; NULL = read the
+ * file). Opens it if `open` is set, else only updates an open document.
+ * start_lock held, server running. *out may be NULL on success.
+ */
+static arc_err_t sync_document(lsp_server_t *server, const char *path, char *text, size_t len,
+                               int open, lsp_document_t **out) {
+    *out = NULL;
+    lsp_document_t *doc = find_document(server, path);
+
+    if (!text) {
+        text = read_file(path, &len);
+        if (!text) {
+            if (doc) close_document(server, doc);
+            lsp_set_error("cannot read %s", path);
+            return ARC_ERR_NOT_FOUND;
+        }
+    }
+
+    if (!doc) {
+        if (!open) {
+            free(text);
+            return ARC_OK;
+        }
+        arc_err_t err = open_document(server, path, text, len, &doc);
+        if (err != ARC_OK) return err;
+    } else if (len != doc->len || memcmp(text, doc->text, len) != 0) {
+        if (server->sync_kind != SYNC_NONE) {
+            cJSON *change = content_change(server, doc, text, len);
+            cJSON *params = cJSON_CreateObject();
+            if (!change || !params) {
+                cJSON_Delete(change);
+                cJSON_Delete(params);
+                free(text);
+                return ARC_ERR_NO_MEMORY;
+            }
+            cJSON *td = cJSON_AddObjectToObject(params, "textDocument");
+            cJSON_AddStringToObject(td, "uri", doc->uri);
+            cJSON_AddNumberToObject(td, "version", doc->version + 1);
+            cJSON_AddItemToArray(cJSON_AddArrayToObject(params, "contentChanges"), change);
+            arc_err_t err = lsp_rpc_notify(server->rpc, "textDocument/didChange", params);
+            if (err != ARC_OK) {
+                free(text);
+                return err;
+            }
+        }
+
+        pthread_mutex_lock(&server->lock);
+        free(doc->text);
+        doc->text = text;
+        doc->len = len;
+        doc->version++;
+        doc->synced_seq = doc->diag_seq;
+        pthread_mutex_unlock(&server->lock);
+    } else {
+        free(text);
+    }
+
+    doc->used = ++server->clock;
+    *out = doc;
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Server Messages (reader thread)
+ *============================================================================*/
+
+static void on_notify(void *user_data, const char *method, const cJSON *params) {
+    lsp_server_t *server = (lsp_server_t *)user_data;
+
+    if (strcmp(method, "textDocument/publishDiagnostics") == 0) {
+        const char *uri = cJSON_GetStringValue(cJSON_GetObjectItem(params, "uri"));
+        const cJSON *diagnostics = cJSON_GetObjectItem(params, "diagnostics");
+        const cJSON *version = cJSON_GetObjectItem(params, "version");
+        if (!uri || !cJSON_IsArray(diagnostics)) return;
+
+        pthread_mutex_lock(&server->lock);
+        lsp_document_t *doc = find_document_uri(server, uri);
+        if (doc) {
+            cJSON_Delete(doc->diagnostics);
+            doc->diagnostics = cJSON_Duplicate(diagnostics, 1);
+            doc->diag_version = cJSON_IsNumber(version) ? version->valueint : -1;
+            doc->diag_seq++;
+            pthread_cond_broadcast(&server->cond);
+        }
+        pthread_mutex_unlock(&server->lock);
+    } else if (strcmp(method, "window/logMessage") == 0 || strcmp(method, "window/showMessage") == 0) {
+        const char *message = cJSON_GetStringValue(cJSON_GetObjectItem(params, "message"));
+        if (message) AC_LOG_DEBUG("LSP %s: %s", server->language, message);
+    }
+}
+
+static cJSON *on_request(void *user_data, const char *method, const cJSON *params, int *error_code) {
+    lsp_server_t *server = (lsp_server_t *)user_data;
+
+    if (strcmp(method, "workspace/configuration") == 0) {
+        /* No settings: one null per item asked for */
+        cJSON *result = cJSON_CreateArray();
+        int count = cJSON_GetArraySize(cJSON_GetObjectItem(params, "items"));
+        for (int i = 0; i < count; i++) cJSON_AddItemToArray(result, cJSON_CreateNull());
+        return result;
+    }
+    if (strcmp(method, "workspace/workspaceFolders") == 0) {
+        cJSON *result = cJSON_CreateArray();
+        cJSON *folder = cJSON_CreateObject();
+        const char *name = strrchr(server->pool->root, '/');
+        cJSON_AddStringToObject(folder, "uri", server->pool->root_uri);
+        cJSON_AddStringToObject(folder, "name", name && name[1] ? name + 1 : server->pool->root);
+        cJSON_AddItemToArray(result, folder);
+        return result;
+    }
+    if (strcmp(method, "client/registerCapability") == 0 ||
+        strcmp(method, "client/unregisterCapability") == 0 ||
+        strcmp(method, "window/workDoneProgress/create") == 0 ||
+        strcmp(method, "window/showMessageRequest") == 0) {
+        return NULL;
+    }
+
+    *error_code = -32601;               /* MethodNotFound */
+    return NULL;
+}
+
+/*============================================================================
+ * Server Lifecycle
+ *============================================================================*/
+
+static cJSON *initialize_params(const lsp_server_t *server) {
+    const ac_lsp_pool_t *pool = server->pool;
+    cJSON *params = cJSON_CreateObject();
+    if (!params) return NULL;
+
+    cJSON_AddNumberToObject(params, "processId", (double)getpid());
+    cJSON *info = cJSON_AddObjectToObject(params, "clientInfo");
+    cJSON_AddStringToObject(info, "name", "ArC");
+    cJSON_AddStringToObject(params, "rootPath", pool->root);
+    cJSON_AddStringToObject(params, "rootUri", pool->root_uri);
+
+    cJSON *folders = cJSON_AddArrayToObject(params, "workspaceFolders");
+    cJSON *folder = cJSON_CreateObject();
+    const char *name = strrchr(pool->root, '/');
+    cJSON_AddStringToObject(folder, "uri", pool->root_uri);
+    cJSON_AddStringToObject(folder, "name", name && name[1] ? name + 1 : pool->root);
+    cJSON_AddItemToArray(folders, folder);
+
+    cJSON *caps = cJSON_AddObjectToObject(params, "capabilities");
+    cJSON *general = cJSON_AddObjectToObject(caps, "general");
+    cJSON *encodings = cJSON_AddArrayToObject(general, "positionEncodings");
+    cJSON_AddItemToArray(encodings, cJSON_CreateString("utf-8"));
+    cJSON_AddItemToArray(encodings, cJSON_CreateString("utf-16"));
+    /* clangd's pre-3.17 spelling */
+    cJSON *offset = cJSON_AddArrayToObject(caps, "offsetEncoding");
+    cJSON_AddItemToArray(offset, cJSON_CreateString("utf-8"));
+    cJSON_AddItemToArray(offset, cJSON_CreateString("utf-16"));
+
+    cJSON *td = cJSON_AddObjectToObject(caps, "textDocument");
+    cJSON *sync = cJSON_AddObjectToObject(td, "synchronization");
+    cJSON_AddBoolToObject(sync, "dynamicRegistration", 0);
+    cJSON_AddBoolToObject(sync, "didSave", 0);
+    cJSON_AddBoolToObject(cJSON_AddObjectToObject(td, "definition"), "linkSupport", 1);
+    cJSON_AddObjectToObject(td, "references");
+    cJSON *hover = cJSON_AddObjectToObject(td, "hover");
+    cJSON *formats = cJSON_AddArrayToObject(hover, "contentFormat");
+    cJSON_AddItemToArray(formats, cJSON_CreateString("markdown"));
+    cJSON_AddItemToArray(formats, cJSON_CreateString("plaintext"));
+    cJSON_AddBoolToObject(cJSON_AddObjectToObject(td, "publishDiagnostics"), "versionSupport", 1);
+
+    cJSON *workspace = cJSON_AddObjectToObject(caps, "workspace");
+    cJSON_AddBoolToObject(workspace, "configuration", 1);
+    cJSON_AddBoolToObject(workspace, "workspaceFolders", 1);
+    return params;
+}
+
+/* A provider capability is `true` or an options object */
+static int has_provider(const cJSON *caps, const char *name) {
+    const cJSON *p = cJSON_GetObjectItem(caps, name);
+    return cJSON_IsTrue(p) || cJSON_IsObject(p);
+}
+
+static void read_capabilities(lsp_server_t *server, const cJSON *result) {
+    const cJSON *caps = cJSON_GetObjectItem(result, "capabilities");
+
+    const cJSON *sync = cJSON_GetObjectItem(caps, "textDocumentSync");
+    if (cJSON_IsObject(sync)) sync = cJSON_GetObjectItem(sync, "change");
+    server->sync_kind = cJSON_IsNumber(sync) ? sync->valueint : SYNC_FULL;
+
+    const char *encoding = cJSON_GetStringValue(cJSON_GetObjectItem(caps, "positionEncoding"));
+    if (!encoding) encoding = cJSON_GetStringValue(cJSON_GetObjectItem(result, "offsetEncoding"));
+    server->utf8 = encoding && strcmp(encoding, "utf-8") == 0;
+
+    server->caps = 0;
+    if (has_provider(caps, "definitionProvider")) server->caps |= CAP_DEFINITION;
+    if (has_provider(caps, "referencesProvider")) server->caps |= CAP_REFERENCES;
+    if (has_provider(caps, "hoverProvider")) server->caps |= CAP_HOVER;
+}
+
+/* Stop a connection and keep it until the pool goes (start_lock held) */
+static void retire_connection(lsp_server_t *server) {
+    lsp_rpc_t **retired = realloc(server->retired, (server->retired_count + 1) * sizeof(*retired));
+    lsp_rpc_stop(server->rpc, 0);
+    if (retired) {
+        server->retired = retired;
+        server->retired[server->retired_count++] = server->rpc;
+    }
+    /* else leaked: it may still be in use */
+    server->rpc = NULL;
+
+    /* Its documents died with it */
+    while (server->doc_count > 0) remove_document(server, server->docs[server->doc_count - 1]);
+}
+
+static arc_err_t start_failed(lsp_server_t *server, arc_err_t err) {
+    snprintf(server->start_error, sizeof(server->start_error), "%s language server: %s",
+             server->language, ac_lsp_error());
+    server->retry_after = time(NULL) + LSP_RETRY_SECONDS;
+    lsp_set_error("%s", server->start_error);
+    AC_LOG_WARN("LSP: %s", server->start_error);
+    return err == ARC_ERR_TIMEOUT ? ARC_ERR_IO : err;
+}
+
+/* Start the server unless it is running (start_lock held) */
+static arc_err_t ensure_running(lsp_server_t *server) {
+    if (server->rpc && lsp_rpc_alive(server->rpc)) return ARC_OK;
+    if (server->rpc) {
+        AC_LOG_WARN("LSP: %s language server exited; restarting", server->language);
+        retire_connection(server);
+    }
+    if (time(NULL) < server->retry_after) {
+        lsp_set_error("%s", server->start_error);
+        return ARC_ERR_IO;
+    }
+
+    lsp_rpc_t *rpc;
+    arc_err_t err = lsp_rpc_start((const char *const *)server->argv, server->pool->root,
+                                  on_notify, on_request, server, &rpc);
+    if (err != ARC_OK) return start_failed(server, err);
+    server->rpc = rpc;
+
+    cJSON *result = NULL;
+    err = lsp_rpc_call(rpc, "initialize", initialize_params(server), server->pool->start_timeout_ms, &result);
+    if (err != ARC_OK) {
+        retire_connection(server);
+        return start_failed(server, err);
+    }
+    read_capabilities(server, result);
+    cJSON_Delete(result);
+
+    err = lsp_rpc_notify(rpc, "initialized", cJSON_CreateObject());
+    if (err != ARC_OK) {
+        retire_connection(server);
+        return start_failed(server, err);
+    }
+
+    server->starts++;
+    server->retry_after = 0;
+    return ARC_OK;
+}
+
+static lsp_server_t *server_for_path(const ac_lsp_pool_t *pool, const char *path) {
+    const char *ext = file_extension(path);
+    if (!ext) return NULL;
+    for (size_t i = 0; i < pool->server_count; i++) {
+        if (extension_listed(pool->servers[i].extensions, ext)) return &pool->servers[i];
+    }
+    return NULL;
+}
+
+const ac_lsp_server_config_t *ac_lsp_server_for_file(const ac_lsp_pool_t *pool, const char *path) {
+    if (!pool || !path) return NULL;
+    lsp_server_t *server = server_for_path(pool, path);
+    return server ? &server->config : NULL;
+}
+
+/*============================================================================
+ * Pool
+ *============================================================================*/
+
+static int copy_config(lsp_server_t *server, const ac_lsp_server_config_t *config) {
+    if (!config->language || !config->extensions || !config->argv || !config->argv[0]) return 0;
+
+    size_t argc = 0;
+    while (config->argv[argc]) argc++;
+    server->argv = calloc(argc + 1, sizeof(char *));
+    server->language = strdup(config->language);
+    server->extensions = strdup(config->extensions);
+    if (!server->argv || !server->language || !server->extensions) return 0;
+    for (size_t i = 0; i < argc; i++) {
+        if (!(server->argv[i] = strdup(config->argv[i]))) return 0;
+    }
+
+    server->config.language = server->language;
+    server->config.extensions = server->extensions;
+    server->config.argv = (const char *const *)server->argv;
+    return 1;
+}
+
+arc_err_t ac_lsp_pool_create(const ac_lsp_options_t *options, ac_lsp_pool_t **out) {
+    if (!options || !options->root || !out) return ARC_ERR_INVALID_ARG;
+    *out = NULL;
+
+    char real[PATH_MAX];
+    struct stat st;
+    if (!realpath(options->root, real) || stat(real, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        lsp_set_error("not a directory: %s", options->root);
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    const ac_lsp_server_config_t *configs = options->servers;
+    size_t count = options->servers_count;
+    if (!configs) configs = ac_lsp_default_servers(&count);
+
+    ac_lsp_pool_t *pool = calloc(1, sizeof(*pool));
+    if (!pool) return ARC_ERR_NO_MEMORY;
+    pool->root = strdup(real);
+    pool->root_uri = uri_from_path(real);
+    pool->request_timeout_ms = options->request_timeout_ms > 0 ? options->request_timeout_ms : LSP_REQUEST_TIMEOUT_MS;
+    pool->start_timeout_ms = options->start_timeout_ms > 0 ? options->start_timeout_ms : LSP_START_TIMEOUT_MS;
+    pool->max_documents = options->max_documents > 0 ? options->max_documents : LSP_MAX_DOCUMENTS;
+    pool->servers = calloc(count ? count : 1, sizeof(lsp_server_t));
+    if (!pool->root || !pool->root_uri || !pool->servers) {
+        ac_lsp_pool_destroy(pool);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        lsp_server_t *server = &pool->servers[i];
+        server->pool = pool;
+        pthread_mutex_init(&server->start_lock, NULL);
+        pthread_mutex_init(&server->lock, NULL);
+        pthread_cond_init(&server->cond, NULL);
+        pool->server_count++;
+        if (!copy_config(server, &configs[i])) {
+            ac_lsp_pool_destroy(pool);
+            lsp_set_error("invalid configuration of server %zu", i);
+            return ARC_ERR_INVALID_ARG;
+        }
+    }
+
+    *out = pool;
+    return ARC_OK;
+}
+
+static void shutdown_server(lsp_server_t *server) {
+    if (server->rpc && lsp_rpc_alive(server->rpc)) {
+        cJSON *result = NULL;
+        if (lsp_rpc_call(server->rpc, "shutdown", NULL, LSP_SHUTDOWN_MS, &result) == ARC_OK) {
+            lsp_rpc_notify(server->rpc, "exit", NULL);
+        }
+        cJSON_Delete(result);
+        lsp_rpc_stop(server->rpc, LSP_SHUTDOWN_MS);
+    }
+    lsp_rpc_free(server->rpc);
+    server->rpc = NULL;
+}
+
+void ac_lsp_pool_destroy(ac_lsp_pool_t *pool) {
+    if (!pool) return;
+
+    for (size_t i = 0; i < pool->server_count; i++) {
+        lsp_server_t *server = &pool->servers[i];
+        shutdown_server(server);
+        for (size_t j = 0; j < server->retired_count; j++) lsp_rpc_free(server->retired[j]);
+        free(server->retired);
+        for (size_t j = 0; j < server->doc_count; j++) free_document(server->docs[j]);
+        free(server->docs);
+        if (server->argv) {
+            for (char **a = server->argv; *a; a++) free(*a);
+            free(server->argv);
+        }
+        free(server->language);
+        free(server->extensions);
+        pthread_mutex_destroy(&server->start_lock);
+        pthread_mutex_destroy(&server->lock);
+        pthread_cond_destroy(&server->cond);
+    }
+    free(pool->servers);
+    free(pool->root);
+    free(pool->root_uri);
+    free(pool);
+}
+
+void ac_lsp_stats(ac_lsp_pool_t *pool, ac_lsp_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (!pool) return;
+
+    for (size_t i = 0; i < pool->server_count; i++) {
+        lsp_server_t *server = &pool->servers[i];
+        pthread_mutex_lock(&server->start_lock);
+        if (server->rpc && lsp_rpc_alive(server->rpc)) stats->servers++;
+        stats->starts += server->starts;
+        stats->incremental_changes += server->incremental_changes;
+        stats->full_changes += server->full_changes;
+        stats->documents += server->doc_count;
+        pthread_mutex_unlock(&server->start_lock);
+        stats->requests += __atomic_load_n(&server->requests, __ATOMIC_RELAXED);
+    }
+}
+
+/*============================================================================
+ * Document Sync
+ *============================================================================*/
+
+arc_err_t ac_lsp_file_changed(ac_lsp_pool_t *pool, const char *path, const char *text, size_t len) {
+    if (!pool || !path) return ARC_ERR_INVALID_ARG;
+
+    char *abs = absolute_path(pool, path);
+    if (!abs) return ARC_ERR_NO_MEMORY;
+    lsp_server_t *server = server_for_path(pool, abs);
+    if (!server) {
+        free(abs);
+        return ARC_OK;
+    }
+
+    arc_err_t err = ARC_OK;
+    pthread_mutex_lock(&server->start_lock);
+    if (server->rpc && lsp_rpc_alive(server->rpc) && find_document(server, abs)) {
+        char *copy = NULL;
+        if (text) {
+            copy = malloc(len + 1);
+            if (copy) {
+                memcpy(copy, text, len);
+                copy[len] = '\0';
+            }
+        }
+        if (text && !copy) {
+            err = ARC_ERR_NO_MEMORY;
+        } else {
+            lsp_document_t *doc;
+            err = sync_document(server, abs, copy, len, 0, &doc);
+            if (err == ARC_ERR_NOT_FOUND) err = ARC_OK;     /* Deleted: closed */
+        }
+    }
+    pthread_mutex_unlock(&server->start_lock);
+    free(abs);
+    return err;
+}
+
+/*============================================================================
+ * Queries
+ *============================================================================*/
+
+/* A request about one position, ready to send */
+typedef struct {
+    lsp_server_t *server;
+    lsp_rpc_t *rpc;
+    char *path;
+    cJSON *params;                      /* textDocument and position */
+} lsp_query_t;
+
+static void query_free(lsp_query_t *q) {
+    free(q->path);
+    cJSON_Delete(q->params);
+}
+
+/*
+ * Start the file's server, sync the file and build the position params
+ * (column 0 = no position).
+ */
+static arc_err_t query_prepare(ac_lsp_pool_t *pool, const char *path, unsigned line, unsigned column,
+                               int cap, lsp_query_t *q) {
+    memset(q, 0, sizeof(*q));
+    if (!pool || !path || (column > 0 && line == 0)) {
+        lsp_set_error("invalid arguments");
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    q->path = absolute_path(pool, path);
+    if (!q->path) return ARC_ERR_NO_MEMORY;
+    q->server = server_for_path(pool, q->path);
+    if (!q->server) {
+        const char *ext = file_extension(q->path);
+        lsp_set_error("no language server for %s files", ext ? ext : "extensionless");
+        query_free(q);
+        return ARC_ERR_NOT_FOUND;
+    }
+
+    lsp_server_t *server = q->server;
+    pthread_mutex_lock(&server->start_lock);
+    arc_err_t err = ensure_running(server);
+    if (err == ARC_OK && cap && !(server->caps & cap)) {
+        lsp_set_error("%s does not support this request", server->argv[0]);
+        err = ARC_ERR_NOT_IMPLEMENTED;
+    }
+
+    lsp_document_t *doc = NULL;
+    if (err == ARC_OK) err = sync_document(server, q->path, NULL, 0, 1, &doc);
+
+    if (err == ARC_OK && column > 0) {
+        if (line > count_lines(doc->text, doc->len)) {
+            lsp_set_error("line %u is past the end of %s", line, path);
+            err = ARC_ERR_INVALID_ARG;
+        } else {
+            size_t start = line_offset(doc->text, doc->len, line - 1);
+            size_t bytes = column - 1;
+            size_t line_len = line_length(doc->text, doc->len, start);
+            if (bytes > line_len) bytes = line_len;
+            q->params = cJSON_CreateObject();
+            if (q->params) {
+                cJSON *td = cJSON_AddObjectToObject(q->params, "textDocument");
+                cJSON_AddStringToObject(td, "uri", doc->uri);
+                cJSON_AddItemToObject(q->params, "position",
+                    position_json(line - 1, to_character(server, doc->text + start, bytes)));
+            } else {
+                err = ARC_ERR_NO_MEMORY;
+            }
+        }
+    }
+    q->rpc = server->rpc;
+    pthread_mutex_unlock(&server->start_lock);
+
+    if (err != ARC_OK) query_free(q);
+    return err;
+}
+
+static arc_err_t query_call(lsp_query_t *q, const char *method, cJSON **result) {
+    cJSON *params = q->params;
+    q->params = NULL;
+    arc_err_t err = lsp_rpc_call(q->rpc, method, params, q->server->pool->request_timeout_ms, result);
+    if (err == ARC_OK) __atomic_fetch_add(&q->server->requests, 1, __ATOMIC_RELAXED);
+    return err;
+}
+
+/* Collects locations; paths are packed into one block at the end */
+typedef struct {
+    ac_lsp_location_t *items;
+    char **paths;
+    size_t count;
+    size_t capacity;
+    char *text_path;                    /* File text_ holds, for UTF-16 columns */
+    char *text;
+    size_t text_len;
+} location_list_t;
+
+static void add_location(lsp_server_t *server, location_list_t *list, const char *uri, const cJSON *range) {
+    const cJSON *start = cJSON_GetObjectItem(range, "start");
+    const cJSON *end = cJSON_GetObjectItem(range, "end");
+    char *path = path_from_uri(uri);
+    if (!path || !start || !end) {
+        free(path);
+        return;
+    }
+
+    if (list->count == list->capacity) {
+        size_t cap = list->capacity ? list->capacity * 2 : 16;
+        ac_lsp_location_t *items = realloc(list->items, cap * sizeof(*items));
+        if (items) list->items = items;
+        char **paths = realloc(list->paths, cap * sizeof(*paths));
+        if (paths) list->paths = paths;
+        if (!items || !paths) {
+            free(path);
+            return;
+        }
+        list->capacity = cap;
+    }
+
+    /* Columns need the file's text unless the server counts bytes */
+    if (!server->utf8 && (!list->text_path || strcmp(list->text_path, path) != 0)) {
+        free(list->text_path);
+        free(list->text);
+        list->text_path = strdup(path);
+        list->text = read_file(path, &list->text_len);
+    }
+
+    ac_lsp_location_t *loc = &list->items[list->count];
+    from_protocol(server, list->text, list->text_len, start, &loc->line, &loc->column);
+    from_protocol(server, list->text, list->text_len, end, &loc->end_line, &loc->end_column);
+    list->paths[list->count++] = path;
+}
+
+/* Location, Location[], LocationLink[] or null */
+static void add_locations(lsp_server_t *server, location_list_t *list, const cJSON *result) {
+    if (cJSON_IsObject(result)) {
+        add_location(server, list, cJSON_GetStringValue(cJSON_GetObjectItem(result, "uri")),
+                     cJSON_GetObjectItem(result, "range"));
+        return;
+    }
+    const cJSON *item;
+    cJSON_ArrayForEach(item, result) {
+        const char *target = cJSON_GetStringValue(cJSON_GetObjectItem(item, "targetUri"));
+        if (target) {
+            const cJSON *range = cJSON_GetObjectItem(item, "targetSelectionRange");
+            if (!range) range = cJSON_GetObjectItem(item, "targetRange");
+            add_location(server, list, target, range);
+        } else {
+            add_location(server, list, cJSON_GetStringValue(cJSON_GetObjectItem(item, "uri")),
+                         cJSON_GetObjectItem(item, "range"));
+        }
+    }
+}
+
+static arc_err_t finish_locations(location_list_t *list, ac_lsp_locations_t *out) {
+    size_t size = 0;
+    for (size_t i = 0; i < list->count; i++) size += strlen(list->paths[i]) + 1;
+
+    arc_err_t err = ARC_OK;
+    out->strings = malloc(size ? size : 1);
+    if (out->strings) {
+        char *p = out->strings;
+        for (size_t i = 0; i < list->count; i++) {
+            size_t len = strlen(list->paths[i]) + 1;
+            memcpy(p, list->paths[i], len);
+            list->items[i].path = p;
+            p += len;
+        }
+        out->locations = list->items;
+        out->count = list->count;
+        list->items = NULL;
+    } else {
+        err = ARC_ERR_NO_MEMORY;
+    }
+
+    for (size_t i = 0; i < list->count; i++) free(list->paths[i]);
+    free(list->paths);
+    free(list->items);
+    free(list->text_path);
+    free(list->text);
+    return err;
+}
+
+static arc_err_t location_query(ac_lsp_pool_t *pool, const char *path, unsigned line, unsigned column,
+                                const char *method, int cap, ac_lsp_locations_t *out) {
+    if (!out) return ARC_ERR_INVALID_ARG;
+    memset(out, 0, sizeof(*out));
+
+    lsp_query_t q;
+    arc_err_t err = query_prepare(pool, path, line, column ? column : 1, cap, &q);
+    if (err != ARC_OK) return err;
+
+    if (cap == CAP_REFERENCES) {
+        cJSON *context = cJSON_AddObjectToObject(q.params, "context");
+        cJSON_AddBoolToObject(context, "includeDeclaration", 1);
+    }
+
+    cJSON *result = NULL;
+    err = query_call(&q, method, &result);
+    if (err == ARC_OK) {
+        location_list_t list = { 0 };
+        add_locations(q.server, &list, result);
+        err = finish_locations(&list, out);
+    }
+    cJSON_Delete(result);
+    query_free(&q);
+    return err;
+}
+
+arc_err_t ac_lsp_definition(ac_lsp_pool_t *pool, const char *path, unsigned line, unsigned column,
+                            ac_lsp_locations_t *out) {
+    return location_query(pool, path, line, column, "textDocument/definition", CAP_DEFINITION, out);
+}
+
+arc_err_t ac_lsp_references(ac_lsp_pool_t *pool, const char *path, unsigned line, unsigned column,
+                            ac_lsp_locations_t *out) {
+    return location_query(pool, path, line, column, "textDocument/references", CAP_REFERENCES, out);
+}
+
+void ac_lsp_locations_free(ac_lsp_locations_t *locations) {
+    if (!locations) return;
+    free(locations->locations);
+    free(locations->strings);
+    memset(locations, 0, sizeof(*locations));
+}
+
+/* Append one MarkedString or MarkupContent to the hover text */
+static void append_hover(char **text, size_t *len, const cJSON *content) {
+    const char *value = cJSON_GetStringValue(content);
+    const char *lang = NULL;
+    if (!value) {
+        value = cJSON_GetStringValue(cJSON_GetObjectItem(content, "value"));
+        lang = cJSON_GetStringValue(cJSON_GetObjectItem(content, "language"));
+    }
+    if (!value || !value[0]) return;
+
+    size_t need = *len + strlen(value) + (lang ? strlen(lang) : 0) + 16;
+    char *grown = realloc(*text, need);
+    if (!grown) return;
+    *text = grown;
+    int n = snprintf(*text + *len, need - *len, "%s%s%s%s%s",
+                     *len ? "\n\n" : "",
+                     lang ? "```" : "", lang ? lang : "", lang ? "\n" : "", value);
+    *len += (size_t)n;
+    if (lang) {
+        memcpy(*text + *len, "\n```", 5);
+        *len += 4;
+    }
+}
+
+arc_err_t ac_lsp_hover(ac_lsp_pool_t *pool, const char *path, unsigned line, unsigned column, char **out) {
+    if (!out) return ARC_ERR_INVALID_ARG;
+    *out = NULL;
+
+    lsp_query_t q;
+    arc_err_t err = query_prepare(pool, path, line, column ? column : 1, CAP_HOVER, &q);
+    if (err != ARC_OK) return err;
+
+    cJSON *result = NULL;
+    err = query_call(&q, "textDocument/hover", &result);
+    query_free(&q);
+    if (err != ARC_OK) return err;
+
+    char *text = NULL;
+    size_t len = 0;
+    const cJSON *contents = cJSON_GetObjectItem(result, "contents");
+    if (cJSON_IsArray(contents)) {
+        const cJSON *item;
+        cJSON_ArrayForEach(item, contents) append_hover(&text, &len, item);
+    } else if (contents) {
+        append_hover(&text, &len, contents);
+    }
+    cJSON_Delete(result);
+
+    *out = text ? text : strdup("");
+    return *out ? ARC_OK : ARC_ERR_NO_MEMORY;
+}
+
+/*============================================================================
+ * Diagnostics
+ *============================================================================*/
+
+/* Published for the document's current contents (lock held) */
+static int diagnostics_fresh(const lsp_document_t *doc) {
+    if (doc->diag_seq == 0) return 0;
+    if (doc->diag_version >= 0) return doc->diag_version >= doc->version;
+    return doc->diag_seq > doc->synced_seq;
+}
+
+static const char *json_string_or_number(const cJSON *item, char *buf, size_t size) {
+    if (cJSON_IsString(item)) return item->valuestring;
+    if (cJSON_IsNumber(item)) {
+        snprintf(buf, size, "%d", item->valueint);
+        return buf;
+    }
+    return "";
+}
+
+/* Convert the document's diagnostics (lock held) */
+static arc_err_t copy_diagnostics(const lsp_server_t *server, const lsp_document_t *doc, ac_lsp_diagnostics_t *out) {
+    int count = cJSON_GetArraySize(doc->diagnostics);
+    char code_buf[32];
+
+    size_t size = 1;
+    const cJSON *d;
+    cJSON_ArrayForEach(d, doc->diagnostics) {
+        const char *message = cJSON_GetStringValue(cJSON_GetObjectItem(d, "message"));
+        const char *source = cJSON_GetStringValue(cJSON_GetObjectItem(d, "source"));
+        size += strlen(message ? message : "") + strlen(source ? source : "") + 3;
+        size += strlen(json_string_or_number(cJSON_GetObjectItem(d, "code"), code_buf, sizeof(code_buf)));
+    }
+
+    out->items = calloc(count > 0 ? (size_t)count : 1, sizeof(ac_lsp_diagnostic_t));
+    out->strings = malloc(size);
+    if (!out->items || !out->strings) {
+        free(out->items);
+        free(out->strings);
+        out->items = NULL;
+        out->strings = NULL;
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    char *p = out->strings;
+    cJSON_ArrayForEach(d, doc->diagnostics) {
+        const cJSON *range = cJSON_GetObjectItem(d, "range");
+        const cJSON *severity = cJSON_GetObjectItem(d, "severity");
+        const char *strings[3] = {
+            cJSON_GetStringValue(cJSON_GetObjectItem(d, "message")),
+            cJSON_GetStringValue(cJSON_GetObjectItem(d, "source")),
+            json_string_or_number(cJSON_GetObjectItem(d, "code"), code_buf, sizeof(code_buf)),
+        };
+        if (!range) continue;
+
+        ac_lsp_diagnostic_t *item = &out->items[out->count++];
+        from_protocol(server, doc->text, doc->len, cJSON_GetObjectItem(range, "start"), &item->line, &item->column);
+        from_protocol(server, doc->text, doc->len, cJSON_GetObjectItem(range, "end"), &item->end_line, &item->end_column);
+        item->severity = cJSON_IsNumber(severity) && severity->valueint >= 1 && severity->valueint <= 4
+                       ? (ac_lsp_severity_t)severity->valueint : AC_LSP_ERROR;
+
+        const char **fields[3] = { &item->message, &item->source, &item->code };
+        for (int i = 0; i < 3; i++) {
+            const char *s = strings[i] ? strings[i] : "";
+            size_t len = strlen(s) + 1;
+            memcpy(p, s, len);
+            *fields[i] = p;
+            p += len;
+        }
+    }
+    return ARC_OK;
+}
+
+arc_err_t ac_lsp_diagnostics(ac_lsp_pool_t *pool, const char *path, int wait_ms, ac_lsp_diagnostics_t *out) {
+    if (!out) return ARC_ERR_INVALID_ARG;
+    memset(out, 0, sizeof(*out));
+
+    /* Opens or updates the file, which makes the server publish */
+    lsp_query_t q;
+    arc_err_t err = query_prepare(pool, path, 0, 0, 0, &q);
+    if (err != ARC_OK) return err;
+    lsp_server_t *server = q.server;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    uint64_t ns = (uint64_t)deadline.tv_nsec + (uint64_t)(wait_ms > 0 ? wait_ms : 0) * 1000000;
+    deadline.tv_sec += (time_t)(ns / 1000000000);
+    deadline.tv_nsec = (long)(ns % 1000000000);
+
+    pthread_mutex_lock(&server->lock);
+    lsp_document_t *doc;
+    while ((doc = find_document(server, q.path)) && !diagnostics_fresh(doc) && lsp_rpc_alive(q.rpc)) {
+        if (pthread_cond_timedwait(&server->cond, &server->lock, &deadline) != 0) break;
+    }
+    if (doc) {
+        out->stale = !diagnostics_fresh(doc);
+        err = copy_diagnostics(server, doc, out);
+    } else {
+        out->stale = 1;
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    query_free(&q);
+    return err;
+}
+
+void ac_lsp_diagnostics_free(ac_lsp_diagnostics_t *diagnostics) {
+    if (!diagnostics) return;
+    free(diagnostics->items);
+    free(diagnostics->strings);
+    memset(diagnostics, 0, sizeof(*diagnostics));
+}
+
+#endif /* !_WIN32 */
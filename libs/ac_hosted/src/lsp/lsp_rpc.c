@@ -0,0 +1,611 @@
+/**
+ * @file lsp_rpc.c
+ * @brief JSON-RPC with a language server over its stdin/stdout
+ *
+ * Messages are framed with a Content-Length header. A reader thread per
+ * server parses everything the server writes: responses are handed to
+ * the waiting caller by id, notifications and server requests go to the
+ * callbacks. Callers only hold the write lock while sending, so any
+ * number of requests can be in flight on one server.
+ *
+ * As for the persistent sandbox shell, the server's stdin is a socket so
+ * writes to a server that died fail instead of raising SIGPIPE.
+ */
+
+#if !defined(_WIN32)
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "lsp_internal.h"
+#include <arc/log.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+#define RPC_READ_SIZE       65536
+#define RPC_MAX_MESSAGE     (64u << 20)     /* Larger messages end the connection */
+#define RPC_POLL_MS         100             /* Reader checks for stop this often */
+#define RPC_HEADER_MAX      4096
+
+/* A caller waiting for one response */
+typedef struct rpc_pending {
+    int id;
+    cJSON *response;                    /* Whole message, once received */
+    struct rpc_pending *next;
+} rpc_pending_t;
+
+struct lsp_rpc {
+    pid_t pid;                          /* -1 once reaped */
+    int in_fd;                          /* Our end of the server's stdin */
+    int out_fd;                         /* Server's stdout */
+
+    lsp_notify_fn on_notify;
+    lsp_request_fn on_request;
+    void *user_data;
+
+    pthread_t reader;
+    int reader_started;
+
+    pthread_mutex_t lock;               /* Everything below */
+    pthread_cond_t cond;                /* A response arrived or the server is gone */
+    int alive;
+    int stopping;
+    int next_id;
+    rpc_pending_t *pending;
+
+    pthread_mutex_t write_lock;         /* One message at a time on in_fd */
+};
+
+/*============================================================================
+ * Helpers
+ *============================================================================*/
+
+static void timespec_after_ms(struct timespec *ts, int timeout_ms) {
+    clock_gettime(CLOCK_REALTIME, ts);
+    uint64_t ns = (uint64_t)ts->tv_nsec + (uint64_t)timeout_ms * 1000000;
+    ts->tv_sec += (time_t)(ns / 1000000000);
+    ts->tv_nsec = (long)(ns % 1000000000);
+}
+
+static int open_pipe(int fds[2]) {
+#if defined(__linux__)
+    return pipe2(fds, O_CLOEXEC);
+#else
+    if (pipe(fds) < 0) return -1;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return 0;
+#endif
+}
+
+static int open_socketpair(int fds[2]) {
+#if defined(SOCK_CLOEXEC)
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) return -1;
+#else
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) return -1;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#endif
+#if defined(SO_NOSIGPIPE)
+    int on = 1;
+    setsockopt(fds[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    return 0;
+}
+
+/* Frame and send one message */
+static arc_err_t send_message(lsp_rpc_t *rpc, const cJSON *message) {
+    char *body = cJSON_PrintUnformatted(message);
+    if (!body) return ARC_ERR_NO_MEMORY;
+
+    size_t body_len = strlen(body);
+    char header[64];
+    int header_len = snprintf(header, sizeof(header), "Content-Length: %zu\r\n\r\n", body_len);
+
+#if defined(MSG_NOSIGNAL)
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;                /* SO_NOSIGPIPE is set instead */
+#endif
+    struct { const char *data; size_t len; } parts[2] = {
+        { header, (size_t)header_len },
+        { body, body_len },
+    };
+
+    arc_err_t err = ARC_OK;
+    pthread_mutex_lock(&rpc->write_lock);
+    for (int i = 0; i < 2 && err == ARC_OK; i++) {
+        const char *p = parts[i].data;
+        size_t left = parts[i].len;
+        while (left > 0) {
+            ssize_t n = send(rpc->in_fd, p, left, flags);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                err = ARC_ERR_IO;
+                break;
+            }
+            p += n;
+            left -= (size_t)n;
+        }
+    }
+    pthread_mutex_unlock(&rpc->write_lock);
+
+    free(body);
+    return err;
+}
+
+static cJSON *new_message(void) {
+    cJSON *message = cJSON_CreateObject();
+    if (message) cJSON_AddStringToObject(message, "jsonrpc", "2.0");
+    return message;
+}
+
+/*============================================================================
+ * Reader Thread
+ *============================================================================*/
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} read_buffer_t;
+
+/* Read more from the server; 0 on EOF, error or stop */
+static int fill_buffer(lsp_rpc_t *rpc, read_buffer_t *buf, size_t want) {
+    if (buf->cap < want) {
+        size_t cap = buf->cap ? buf->cap : RPC_READ_SIZE;
+        while (cap < want) cap *= 2;
+        char *data = realloc(buf->data, cap);
+        if (!data) return 0;
+        buf->data = data;
+        buf->cap = cap;
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&rpc->lock);
+        int stopping = rpc->stopping;
+        pthread_mutex_unlock(&rpc->lock);
+        if (stopping) return 0;
+
+        struct pollfd pfd = { rpc->out_fd, POLLIN, 0 };
+        int ready = poll(&pfd, 1, RPC_POLL_MS);
+        if (ready < 0 && errno != EINTR) return 0;
+        if (ready <= 0) continue;
+
+        ssize_t n = read(rpc->out_fd, buf->data + buf->len, buf->cap - buf->len);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (n <= 0) return 0;
+        buf->len += (size_t)n;
+        return 1;
+    }
+}
+
+/*
+ * Next message body, NUL-terminated and removed from the buffer; NULL
+ * when the connection ends. A malformed header ends it too: the stream
+ * cannot be resynchronized.
+ */
+static char *read_message(lsp_rpc_t *rpc, read_buffer_t *buf, size_t *body_len) {
+    size_t header_end;
+    for (;;) {
+        char *end = NULL;
+        for (size_t i = 0; i + 3 < buf->len; i++) {
+            if (memcmp(buf->data + i, "\r\n\r\n", 4) == 0) {
+                end = buf->data + i;
+                break;
+            }
+        }
+        if (end) {
+            header_end = (size_t)(end - buf->data) + 4;
+            break;
+        }
+        if (buf->len >= RPC_HEADER_MAX) return NULL;
+        if (!fill_buffer(rpc, buf, buf->len + RPC_READ_SIZE)) return NULL;
+    }
+
+    /* Content-Length is required; Content-Type is ignored */
+    size_t length = 0;
+    int found = 0;
+    for (size_t i = 0; i < header_end; ) {
+        size_t eol = i;
+        while (eol < header_end && buf->data[eol] != '\r') eol++;
+        if (eol - i > 15 && strncasecmp(buf->data + i, "Content-Length:", 15) == 0) {
+            const char *p = buf->data + i + 15;
+            while (*p == ' ') p++;
+            char *num_end;
+            unsigned long long v = strtoull(p, &num_end, 10);
+            if (num_end == p || v > RPC_MAX_MESSAGE) return NULL;
+            length = (size_t)v;
+            found = 1;
+        }
+        i = eol + 2;
+    }
+    if (!found) return NULL;
+
+    while (buf->len < header_end + length) {
+        if (!fill_buffer(rpc, buf, header_end + length)) return NULL;
+    }
+
+    char *body = malloc(length + 1);
+    if (!body) return NULL;
+    memcpy(body, buf->data + header_end, length);
+    body[length] = '\0';
+    buf->len -= header_end + length;
+    memmove(buf->data, buf->data + header_end + length, buf->len);
+    *body_len = length;
+    return body;
+}
+
+static void answer_request(lsp_rpc_t *rpc, const cJSON *message, const char *method) {
+    int error_code = 0;
+    cJSON *result = rpc->on_request
+        ? rpc->on_request(rpc->user_data, method, cJSON_GetObjectItem(message, "params"), &error_code)
+        : (error_code = -32601, NULL);
+
+    cJSON *response = new_message();
+    if (!response) {
+        cJSON_Delete(result);
+        return;
+    }
+    cJSON_AddItemToObject(response, "id", cJSON_Duplicate(cJSON_GetObjectItem(message, "id"), 1));
+    if (error_code) {
+        cJSON_Delete(result);
+        cJSON *error = cJSON_AddObjectToObject(response, "error");
+        cJSON_AddNumberToObject(error, "code", error_code);
+        cJSON_AddStringToObject(error, "message", "Method not supported by client");
+    } else {
+        cJSON_AddItemToObject(response, "result", result ? result : cJSON_CreateNull());
+    }
+    send_message(rpc, response);
+    cJSON_Delete(response);
+}
+
+static void dispatch(lsp_rpc_t *rpc, cJSON *message) {
+    const char *method = cJSON_GetStringValue(cJSON_GetObjectItem(message, "method"));
+    cJSON *id = cJSON_GetObjectItem(message, "id");
+
+    if (method) {
+        if (id) {
+            answer_request(rpc, message, method);
+        } else if (rpc->on_notify) {
+            rpc->on_notify(rpc->user_data, method, cJSON_GetObjectItem(message, "params"));
+        }
+        cJSON_Delete(message);
+        return;
+    }
+
+    /* Response: hand it to its caller; one that gave up is gone */
+    if (cJSON_IsNumber(id)) {
+        pthread_mutex_lock(&rpc->lock);
+        for (rpc_pending_t *p = rpc->pending; p; p = p->next) {
+            if (p->id == id->valueint && !p->response) {
+                p->response = message;
+                message = NULL;
+                pthread_cond_broadcast(&rpc->cond);
+                break;
+            }
+        }
+        pthread_mutex_unlock(&rpc->lock);
+    }
+    cJSON_Delete(message);
+}
+
+static void *reader_main(void *arg) {
+    lsp_rpc_t *rpc = (lsp_rpc_t *)arg;
+    read_buffer_t buf = { NULL, 0, 0 };
+
+    size_t len;
+    char *body;
+    while ((body = read_message(rpc, &buf, &len)) != NULL) {
+        cJSON *message = cJSON_ParseWithLength(body, len);
+        free(body);
+        if (message) {
+            dispatch(rpc, message);
+        } else {
+            AC_LOG_WARN("LSP: ignoring malformed message from server %d", (int)rpc->pid);
+        }
+    }
+    free(buf.data);
+
+    pthread_mutex_lock(&rpc->lock);
+    rpc->alive = 0;
+    pthread_cond_broadcast(&rpc->cond);
+    pthread_mutex_unlock(&rpc->lock);
+    return NULL;
+}
+
+/*============================================================================
+ * Process
+ *============================================================================*/
+
+arc_err_t lsp_rpc_start(
+    const char *const *argv,
+    const char *cwd,
+    lsp_notify_fn on_notify,
+    lsp_request_fn on_request,
+    void *user_data,
+    lsp_rpc_t **out
+) {
+    if (!argv || !argv[0] || !cwd || !out) return ARC_ERR_INVALID_ARG;
+    *out = NULL;
+
+    lsp_rpc_t *rpc = calloc(1, sizeof(*rpc));
+    if (!rpc) return ARC_ERR_NO_MEMORY;
+    rpc->pid = -1;
+    rpc->in_fd = -1;
+    rpc->out_fd = -1;
+    rpc->on_notify = on_notify;
+    rpc->on_request = on_request;
+    rpc->user_data = user_data;
+    rpc->next_id = 1;
+    pthread_mutex_init(&rpc->lock, NULL);
+    pthread_cond_init(&rpc->cond, NULL);
+    pthread_mutex_init(&rpc->write_lock, NULL);
+
+    /* status reports a failed exec: it closes without data on success */
+    int sock[2], out_pipe[2], status[2];
+    if (open_socketpair(sock) < 0) {
+        lsp_set_error("cannot create a socket pair: %s", strerror(errno));
+        lsp_rpc_free(rpc);
+        return ARC_ERR_IO;
+    }
+    if (open_pipe(out_pipe) < 0) {
+        lsp_set_error("cannot create a pipe: %s", strerror(errno));
+        close(sock[0]);
+        close(sock[1]);
+        lsp_rpc_free(rpc);
+        return ARC_ERR_IO;
+    }
+    if (open_pipe(status) < 0) {
+        lsp_set_error("cannot create a pipe: %s", strerror(errno));
+        close(sock[0]);
+        close(sock[1]);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        lsp_rpc_free(rpc);
+        return ARC_ERR_IO;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        /* ===== Child process ===== */
+        setpgid(0, 0);
+        int err = 0;
+        if (chdir(cwd) < 0) err = errno;
+        if (!err) {
+            int null_fd = open("/dev/null", O_WRONLY);
+            dup2(sock[1], STDIN_FILENO);
+            dup2(out_pipe[1], STDOUT_FILENO);
+            if (null_fd >= 0) dup2(null_fd, STDERR_FILENO);
+            execvp(argv[0], (char *const *)argv);
+            err = errno;
+        }
+        if (write(status[1], &err, sizeof(err)) < 0) {
+            /* Parent sees a short read */
+        }
+        _exit(127);
+    }
+
+    int fork_err = errno;
+    close(sock[1]);
+    close(out_pipe[1]);
+    close(status[1]);
+    rpc->in_fd = sock[0];
+    rpc->out_fd = out_pipe[0];
+
+    if (pid < 0) {
+        close(status[0]);
+        lsp_set_error("cannot start %s: %s", argv[0], strerror(fork_err));
+        lsp_rpc_free(rpc);
+        return ARC_ERR_IO;
+    }
+    setpgid(pid, pid);
+    rpc->pid = pid;
+
+    int exec_err = 0;
+    ssize_t n;
+    while ((n = read(status[0], &exec_err, sizeof(exec_err))) < 0 && errno == EINTR) {
+    }
+    close(status[0]);
+    if (n > 0) {
+        lsp_set_error("cannot run %s: %s", argv[0], strerror(exec_err));
+        lsp_rpc_free(rpc);
+        return ARC_ERR_IO;
+    }
+
+    rpc->alive = 1;
+    if (pthread_create(&rpc->reader, NULL, reader_main, rpc) != 0) {
+        lsp_set_error("cannot create the reader thread");
+        lsp_rpc_free(rpc);
+        return ARC_ERR_IO;
+    }
+    rpc->reader_started = 1;
+
+    *out = rpc;
+    return ARC_OK;
+}
+
+int lsp_rpc_alive(lsp_rpc_t *rpc) {
+    pthread_mutex_lock(&rpc->lock);
+    int alive = rpc->alive && !rpc->stopping;
+    pthread_mutex_unlock(&rpc->lock);
+    return alive;
+}
+
+void lsp_rpc_stop(lsp_rpc_t *rpc, int wait_ms) {
+    pthread_mutex_lock(&rpc->lock);
+    int was_stopping = rpc->stopping;
+    rpc->stopping = 1;
+    pthread_cond_broadcast(&rpc->cond);
+    pthread_mutex_unlock(&rpc->lock);
+    if (was_stopping) return;
+
+    /* EOF on stdin asks the server to go; then give it wait_ms */
+    if (rpc->in_fd >= 0) shutdown(rpc->in_fd, SHUT_WR);
+    if (rpc->pid > 0) {
+        int waited = 0;
+        pid_t r;
+        while ((r = waitpid(rpc->pid, NULL, WNOHANG)) == 0 && waited < wait_ms) {
+            struct timespec slice = { 0, 10 * 1000000 };
+            nanosleep(&slice, NULL);
+            waited += 10;
+        }
+        /* The group too: servers often start helpers */
+        kill(-rpc->pid, SIGKILL);
+        if (r == 0) {
+            kill(rpc->pid, SIGKILL);
+            while (waitpid(rpc->pid, NULL, 0) < 0 && errno == EINTR) {
+            }
+        }
+        rpc->pid = -1;
+    }
+
+    if (rpc->reader_started) {
+        pthread_join(rpc->reader, NULL);
+        rpc->reader_started = 0;
+    }
+    pthread_mutex_lock(&rpc->lock);
+    rpc->alive = 0;
+    pthread_mutex_unlock(&rpc->lock);
+}
+
+void lsp_rpc_free(lsp_rpc_t *rpc) {
+    if (!rpc) return;
+    lsp_rpc_stop(rpc, 0);
+    if (rpc->in_fd >= 0) close(rpc->in_fd);
+    if (rpc->out_fd >= 0) close(rpc->out_fd);
+    pthread_mutex_destroy(&rpc->lock);
+    pthread_cond_destroy(&rpc->cond);
+    pthread_mutex_destroy(&rpc->write_lock);
+    free(rpc);
+}
+
+/*============================================================================
+ * Calls
+ *============================================================================*/
+
+arc_err_t lsp_rpc_notify(lsp_rpc_t *rpc, const char *method, cJSON *params) {
+    if (!lsp_rpc_alive(rpc)) {
+        cJSON_Delete(params);
+        lsp_set_error("language server is not running");
+        return ARC_ERR_IO;
+    }
+
+    cJSON *message = new_message();
+    if (!message) {
+        cJSON_Delete(params);
+        return ARC_ERR_NO_MEMORY;
+    }
+    cJSON_AddStringToObject(message, "method", method);
+    if (params) cJSON_AddItemToObject(message, "params", params);
+
+    arc_err_t err = send_message(rpc, message);
+    cJSON_Delete(message);
+    if (err == ARC_ERR_IO) lsp_set_error("language server closed its input");
+    return err;
+}
+
+static void remove_pending(lsp_rpc_t *rpc, rpc_pending_t *pending) {
+    for (rpc_pending_t **p = &rpc->pending; *p; p = &(*p)->next) {
+        if (*p == pending) {
+            *p = pending->next;
+            break;
+        }
+    }
+}
+
+arc_err_t lsp_rpc_call(lsp_rpc_t *rpc, const char *method, cJSON *params, int timeout_ms, cJSON **result) {
+    *result = NULL;
+
+    cJSON *message = new_message();
+    if (!message) {
+        cJSON_Delete(params);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    rpc_pending_t pending = { 0, NULL, NULL };
+    pthread_mutex_lock(&rpc->lock);
+    if (!rpc->alive || rpc->stopping) {
+        pthread_mutex_unlock(&rpc->lock);
+        cJSON_Delete(message);
+        cJSON_Delete(params);
+        lsp_set_error("language server is not running");
+        return ARC_ERR_IO;
+    }
+    pending.id = rpc->next_id++;
+    pending.next = rpc->pending;
+    rpc->pending = &pending;
+    pthread_mutex_unlock(&rpc->lock);
+
+    cJSON_AddNumberToObject(message, "id", pending.id);
+    cJSON_AddStringToObject(message, "method", method);
+    if (params) cJSON_AddItemToObject(message, "params", params);
+    arc_err_t err = send_message(rpc, message);
+    cJSON_Delete(message);
+
+    struct timespec deadline;
+    timespec_after_ms(&deadline, timeout_ms);
+
+    pthread_mutex_lock(&rpc->lock);
+    while (err == ARC_OK && !pending.response && rpc->alive && !rpc->stopping) {
+        if (pthread_cond_timedwait(&rpc->cond, &rpc->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    remove_pending(rpc, &pending);
+    int gone = !rpc->alive || rpc->stopping;
+    pthread_mutex_unlock(&rpc->lock);
+
+    cJSON *response = pending.response;
+    if (!response) {
+        if (err == ARC_ERR_IO || gone) {
+            lsp_set_error("language server exited");
+            return ARC_ERR_IO;
+        }
+        if (err != ARC_OK) return err;
+
+        cJSON *cancel = cJSON_CreateObject();
+        if (cancel) cJSON_AddNumberToObject(cancel, "id", pending.id);
+        lsp_rpc_notify(rpc, "$/cancelRequest", cancel);
+        lsp_set_error("%s timed out after %d ms", method, timeout_ms);
+        return ARC_ERR_TIMEOUT;
+    }
+
+    cJSON *error = cJSON_GetObjectItem(response, "error");
+    if (error) {
+        const char *msg = cJSON_GetStringValue(cJSON_GetObjectItem(error, "message"));
+        lsp_set_error("%s failed: %s", method, msg ? msg : "error response");
+        cJSON_Delete(response);
+        return ARC_ERR_PROTOCOL;
+    }
+
+    cJSON *value = cJSON_DetachItemFromObject(response, "result");
+    cJSON_Delete(response);
+    if (cJSON_IsNull(value)) {
+        cJSON_Delete(value);
+        value = NULL;
+    }
+    *result = value;
+    return ARC_OK;
+}
+
+#endif /* !_WIN32 */
@@ -0,0 +1,152 @@
+/**
+ * @file md_line.c
+ * @brief Single-pass Markdown block line classifier
+ *
+ * Dispatches on the first non-indent character, so each line is scanned
+ * at most once for its block type (plus the '|' search for table rows).
+ */
+
+#include "md_line.h"
+
+#include <string.h>
+
+/* Same set as PCRE2 \s and isspace() in the C locale */
+static int is_ws(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+static size_t skip_ws(const char* s, size_t i, size_t len) {
+    while (i < len && is_ws(s[i])) i++;
+    return i;
+}
+
+/* Table separator: [|] cell (| cell)* [|], cell = :?-+:? with optional spaces */
+static int scan_table_sep(const char* s, size_t i, size_t len) {
+    int cells = 0;
+
+    if (i < len && s[i] == '|') i++;
+    while (i < len) {
+        i = skip_ws(s, i, len);
+        if (i >= len) break;            /* Trailing pipe */
+
+        if (s[i] == ':') i++;
+        size_t dashes = 0;
+        while (i < len && s[i] == '-') {
+            dashes++;
+            i++;
+        }
+        if (dashes == 0) return 0;
+        if (i < len && s[i] == ':') i++;
+        i = skip_ws(s, i, len);
+        cells++;
+
+        if (i >= len) break;
+        if (s[i] != '|') return 0;
+        i++;
+    }
+    return cells > 0;
+}
+
+/* Rule: three or more of the same marker, only whitespace in between */
+static int scan_hr(const char* s, size_t i, size_t len, char c) {
+    int count = 0;
+    for (; i < len; i++) {
+        if (s[i] == c) count++;
+        else if (!is_ws(s[i])) return 0;
+    }
+    return count >= 3;
+}
+
+md_line_type_t md_classify_line(const char* line, size_t len, md_line_t* out) {
+    memset(out, 0, sizeof(*out));
+    out->type = MD_LINE_TEXT;
+    out->has_pipe = memchr(line, '|', len) != NULL;
+
+    /* Indent */
+    size_t i = 0;
+    int indent = 0;
+    while (i < len && (line[i] == ' ' || line[i] == '\t')) {
+        indent += line[i] == '\t' ? 4 : 1;
+        i++;
+    }
+    out->indent = indent;
+
+    if (skip_ws(line, i, len) == len) {
+        out->type = MD_LINE_BLANK;
+        return out->type;
+    }
+
+    char c = line[i];
+    out->content = i;
+
+    switch (c) {
+        case '`':
+            if (i == 0 && len >= 3 && line[1] == '`' && line[2] == '`') {
+                out->type = MD_LINE_FENCE;
+                out->content = 3;
+            }
+            break;
+
+        case '#': {
+            if (i != 0) break;
+            size_t n = 0;
+            while (n < len && line[n] == '#' && n < 7) n++;
+            if (n <= 6 && n < len && is_ws(line[n])) {
+                out->type = MD_LINE_HEADING;
+                out->level = (int)n;
+                out->content = skip_ws(line, n, len);
+            }
+            break;
+        }
+
+        case '-':
+        case '*':
+        case '_':
+            if (c == '-') {
+                out->table_sep = scan_table_sep(line, i, len);
+            }
+            if (scan_hr(line, i, len, c)) {
+                out->type = MD_LINE_HR;
+                out->marker = c;
+                break;
+            }
+            if (c != '_' && i + 1 < len && is_ws(line[i + 1])) {
+                out->type = MD_LINE_BULLET;
+                out->marker = c;
+                out->content = skip_ws(line, i + 1, len);
+            }
+            break;
+
+        case '+':
+            if (i + 1 < len && is_ws(line[i + 1])) {
+                out->type = MD_LINE_BULLET;
+                out->marker = c;
+                out->content = skip_ws(line, i + 1, len);
+            }
+            break;
+
+        case '>':
+            out->type = MD_LINE_QUOTE;
+            out->content = i + 1;
+            if (out->content < len && is_ws(line[out->content])) out->content++;
+            break;
+
+        case '|':
+        case ':':
+            out->table_sep = scan_table_sep(line, i, len);
+            break;
+
+        default:
+            if (c >= '0' && c <= '9') {
+                size_t p = i;
+                while (p < len && line[p] >= '0' && line[p] <= '9') p++;
+                if (p + 1 < len && line[p] == '.' && is_ws(line[p + 1])) {
+                    out->type = MD_LINE_ORDERED;
+                    out->content = skip_ws(line, p + 1, len);
+                }
+            }
+            break;
+    }
+
+    return out->type;
+}
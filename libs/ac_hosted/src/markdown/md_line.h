@@ -0,0 +1,60 @@
+/**
+ * @file md_line.h
+ * @brief Single-pass Markdown block line classifier
+ *
+ * Recognizes the block type of one line (fence, heading, rule, quote,
+ * list item, table separator) in a single left-to-right scan without
+ * allocating. Shared by the document parser and the streaming renderer.
+ */
+
+#ifndef MD_LINE_H
+#define MD_LINE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ========== Line types ========== */
+typedef enum {
+    MD_LINE_BLANK,          /* Empty or whitespace only */
+    MD_LINE_FENCE,          /* ``` code fence (open or close) */
+    MD_LINE_HEADING,        /* # .. ###### followed by whitespace */
+    MD_LINE_HR,             /* Three or more of -, * or _ (spaces allowed) */
+    MD_LINE_QUOTE,          /* > quote */
+    MD_LINE_BULLET,         /* -, * or + list item */
+    MD_LINE_ORDERED,        /* 1. list item */
+    MD_LINE_TEXT            /* Paragraph text or table row */
+} md_line_type_t;
+
+/* ========== Classification result ========== */
+typedef struct {
+    md_line_type_t type;
+    int level;              /* Heading level (1-6) */
+    int indent;             /* Leading indent in columns (tab = 4) */
+    char marker;            /* Bullet character, or rule character for HR */
+    size_t content;         /* Offset of content: heading/quote/item text, fence info */
+    int has_pipe;           /* Line contains '|' (table row candidate) */
+    int table_sep;          /* Line is a table separator row (|---|:--:|) */
+} md_line_t;
+
+/**
+ * Classify a Markdown line
+ *
+ * The content of every block type runs from `content` to the end of the
+ * line. A line may be both MD_LINE_HR and a table separator ("---"); the
+ * caller decides which applies from context.
+ *
+ * @param line Line text (no trailing newline)
+ * @param len Line length
+ * @param out Classification result
+ * @return Line type (same as out->type)
+ */
+md_line_type_t md_classify_line(const char* line, size_t len, md_line_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MD_LINE_H */
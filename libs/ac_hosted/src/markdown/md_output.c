@@ -0,0 +1,282 @@
+/**
+ * @file md_output.c
+ * @brief Batched terminal output with redundant SGR elimination
+ */
+
+#include "md_output.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/*
+ * Color tags: basic colors keep their SGR code (30-37, 90-97, 40-47,
+ * 100-107); 256-color and RGB colors are tagged so they cannot collide.
+ */
+#define COLOR_256       0x100u
+#define COLOR_RGB       0x1000000u
+
+/* ========== Helpers ========== */
+
+static uint64_t now_ms(void) {
+#ifdef _WIN32
+    return (uint64_t)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+#endif
+}
+
+static void emit(md_outbuf_t* out, const char* text, size_t len) {
+    if (out->sink) {
+        out->sink(text, len, out->userdata);
+    } else {
+        fwrite(text, 1, len, stdout);
+        fflush(stdout);
+    }
+}
+
+static void put(md_outbuf_t* out, const char* text, size_t len) {
+    if (out->len + len + 1 > out->cap) {
+        size_t new_cap = out->cap ? out->cap : 1024;
+        while (out->len + len + 1 > new_cap) new_cap *= 2;
+        char* buf = (char*)realloc(out->buf, new_cap);
+        if (!buf) {
+            /* Out of memory: write through */
+            if (out->len > 0) {
+                out->buf[out->len] = '\0';
+                emit(out, out->buf, out->len);
+                out->len = 0;
+            }
+            emit(out, text, len);
+            return;
+        }
+        out->buf = buf;
+        out->cap = new_cap;
+    }
+    memcpy(out->buf + out->len, text, len);
+    out->len += len;
+}
+
+static int sgr_equal(const md_sgr_t* a, const md_sgr_t* b) {
+    return a->attrs == b->attrs && a->fg == b->fg && a->bg == b->bg;
+}
+
+static size_t append_param(char* seq, size_t pos, size_t cap, unsigned value) {
+    int n = snprintf(seq + pos, cap - pos, pos > 2 ? ";%u" : "%u", value);
+    return n > 0 && (size_t)n < cap - pos ? pos + (size_t)n : pos;
+}
+
+static size_t append_color(char* seq, size_t pos, size_t cap, uint32_t color, unsigned ext) {
+    if (color & COLOR_RGB) {
+        pos = append_param(seq, pos, cap, ext);
+        pos = append_param(seq, pos, cap, 2);
+        pos = append_param(seq, pos, cap, (color >> 16) & 0xFF);
+        pos = append_param(seq, pos, cap, (color >> 8) & 0xFF);
+        return append_param(seq, pos, cap, color & 0xFF);
+    }
+    if (color & COLOR_256) {
+        pos = append_param(seq, pos, cap, ext);
+        pos = append_param(seq, pos, cap, 5);
+        return append_param(seq, pos, cap, color & 0xFF);
+    }
+    return append_param(seq, pos, cap, color);
+}
+
+/* Bring the terminal to the requested style with as few parameters as possible */
+static void sync_style(md_outbuf_t* out) {
+    const md_sgr_t* want = &out->want;
+    const md_sgr_t* have = &out->have;
+
+    if (!out->pending) return;
+    out->pending = 0;
+    if (out->have_known && sgr_equal(want, have)) return;
+
+    /* Anything switched off needs a full reset, then the rest re-applied */
+    int reset = !out->have_known ||
+                (have->attrs & ~want->attrs) ||
+                (have->fg && !want->fg) ||
+                (have->bg && !want->bg);
+    md_sgr_t base = {0, 0, 0};
+    if (!reset) base = *have;
+
+    char seq[96] = "\033[";
+    size_t pos = 2;
+    if (reset) pos = append_param(seq, pos, sizeof(seq), 0);
+    for (unsigned bit = 1; bit <= 9; bit++) {
+        if ((want->attrs & (1u << bit)) && !(base.attrs & (1u << bit))) {
+            pos = append_param(seq, pos, sizeof(seq), bit);
+        }
+    }
+    if (want->fg != base.fg) pos = append_color(seq, pos, sizeof(seq), want->fg, 38);
+    if (want->bg != base.bg) pos = append_color(seq, pos, sizeof(seq), want->bg, 48);
+    seq[pos++] = 'm';
+
+    put(out, seq, pos);
+    out->have = *want;
+    out->have_known = 1;
+}
+
+/* Read an extended color (after 38/48); returns 0 if malformed */
+static int parse_ext_color(const unsigned* p, size_t n, size_t* i, uint32_t* color) {
+    if (*i + 1 < n && p[*i + 1] == 5 && *i + 2 < n) {
+        *color = COLOR_256 | (p[*i + 2] & 0xFF);
+        *i += 2;
+        return 1;
+    }
+    if (*i + 1 < n && p[*i + 1] == 2 && *i + 4 < n) {
+        *color = COLOR_RGB | ((p[*i + 2] & 0xFF) << 16) | ((p[*i + 3] & 0xFF) << 8) | (p[*i + 4] & 0xFF);
+        *i += 4;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Apply "ESC [ params m" to the requested style. Returns 0 for parameters
+ * this model does not track; the caller then passes the sequence through.
+ */
+static int apply_sgr(md_sgr_t* sgr, const char* params, size_t len) {
+    unsigned p[16];
+    size_t n = 0;
+    unsigned value = 0;
+
+    for (size_t i = 0; i <= len; i++) {
+        if (i == len || params[i] == ';') {
+            if (n == sizeof(p) / sizeof(p[0])) return 0;
+            p[n++] = value;
+            value = 0;
+        } else {
+            value = value * 10 + (unsigned)(params[i] - '0');
+            if (value > 0xFFFF) return 0;
+        }
+    }
+
+    md_sgr_t next = *sgr;
+    for (size_t i = 0; i < n; i++) {
+        unsigned v = p[i];
+        if (v == 0) {
+            next.attrs = 0;
+            next.fg = 0;
+            next.bg = 0;
+        } else if (v <= 9) {
+            next.attrs |= (uint16_t)(1u << v);
+        } else if (v == 22) {
+            next.attrs &= (uint16_t)~((1u << 1) | (1u << 2));
+        } else if (v >= 23 && v <= 29 && v != 26) {
+            next.attrs &= (uint16_t)~(1u << (v - 20));
+        } else if ((v >= 30 && v <= 37) || (v >= 90 && v <= 97)) {
+            next.fg = v;
+        } else if (v == 39) {
+            next.fg = 0;
+        } else if ((v >= 40 && v <= 47) || (v >= 100 && v <= 107)) {
+            next.bg = v;
+        } else if (v == 49) {
+            next.bg = 0;
+        } else if (v == 38) {
+            if (!parse_ext_color(p, n, &i, &next.fg)) return 0;
+        } else if (v == 48) {
+            if (!parse_ext_color(p, n, &i, &next.bg)) return 0;
+        } else {
+            return 0;
+        }
+    }
+    *sgr = next;
+    return 1;
+}
+
+/* Length of an SGR sequence at text[0], or 0 if it is not one */
+static size_t sgr_length(const char* text, size_t len) {
+    if (len < 3 || text[1] != '[') return 0;
+    for (size_t i = 2; i < len; i++) {
+        char c = text[i];
+        if (c == 'm') return i + 1;
+        if ((c < '0' || c > '9') && c != ';') return 0;
+    }
+    return 0;
+}
+
+/* ========== Public interface ========== */
+
+void md_outbuf_init(md_outbuf_t* out, md_output_fn sink, void* userdata) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    out->sink = sink;
+    out->userdata = userdata;
+    out->flush_bytes = MD_OUTBUF_FLUSH_BYTES;
+    out->flush_ms = MD_OUTBUF_FLUSH_MS;
+    out->last_flush_ms = now_ms();
+}
+
+void md_outbuf_write(md_outbuf_t* out, const char* text, size_t len) {
+    if (!out || !text) return;
+
+    size_t i = 0;
+    while (i < len) {
+        if (text[i] == '\033') {
+            size_t n = sgr_length(text + i, len - i);
+            if (n) {
+                if (apply_sgr(&out->want, text + i + 2, n - 3)) {
+                    out->pending = 1;
+                } else {
+                    /* Untracked attribute: emit as-is, assume nothing about the result */
+                    sync_style(out);
+                    put(out, text + i, n);
+                    out->have_known = 0;
+                }
+                i += n;
+                continue;
+            }
+        }
+
+        /* Visible text or another control sequence: style must be current */
+        size_t start = i++;
+        while (i < len && text[i] != '\033') i++;
+        sync_style(out);
+        put(out, text + start, i - start);
+    }
+
+    if (out->len >= out->flush_bytes) {
+        md_outbuf_flush(out);
+    }
+}
+
+void md_outbuf_output(const char* text, size_t len, void* userdata) {
+    md_outbuf_write((md_outbuf_t*)userdata, text, len);
+}
+
+void md_outbuf_tick(md_outbuf_t* out) {
+    if (!out || out->flush_ms <= 0 || out->len == 0) return;
+    if (now_ms() - out->last_flush_ms >= (uint64_t)out->flush_ms) {
+        md_outbuf_flush(out);
+    }
+}
+
+void md_outbuf_flush(md_outbuf_t* out) {
+    if (!out) return;
+
+    /* Leave the terminal in the requested style (usually a trailing reset) */
+    sync_style(out);
+
+    if (out->len > 0) {
+        out->buf[out->len] = '\0';
+        emit(out, out->buf, out->len);
+        out->len = 0;
+    }
+    out->last_flush_ms = now_ms();
+}
+
+void md_outbuf_free(md_outbuf_t* out) {
+    if (!out) return;
+    free(out->buf);
+    out->buf = NULL;
+    out->len = 0;
+    out->cap = 0;
+}
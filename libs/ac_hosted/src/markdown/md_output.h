@@ -0,0 +1,98 @@
+/**
+ * @file md_output.h
+ * @brief Batched terminal output with redundant SGR elimination
+ *
+ * Collects rendered text and escape sequences in a buffer and hands them
+ * to the output callback (or stdout) in large writes. SGR (color/style)
+ * sequences are not written as they arrive: the buffer tracks the style
+ * they request and emits only the difference from the style already in
+ * effect, right before the next visible output. Output that never
+ * requests a style passes through untouched.
+ */
+
+#ifndef MD_OUTPUT_H
+#define MD_OUTPUT_H
+
+#include "md_renderer.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ========== Defaults ========== */
+#define MD_OUTBUF_FLUSH_BYTES   16384   /* Flush once this much is buffered */
+#define MD_OUTBUF_FLUSH_MS      16      /* ... or this long after the last flush */
+
+/* ========== SGR state ========== */
+typedef struct {
+    uint16_t attrs;         /* Bit n set: SGR attribute n (1..9) on */
+    uint32_t fg;            /* 0 = default, else color tag (see md_output.c) */
+    uint32_t bg;
+} md_sgr_t;
+
+/* ========== Output buffer ========== */
+typedef struct {
+    md_output_fn sink;      /* Destination callback, NULL = stdout */
+    void* userdata;
+
+    char* buf;
+    size_t len;
+    size_t cap;
+
+    size_t flush_bytes;     /* Size threshold, 0 = flush on every write */
+    int flush_ms;           /* Time threshold, 0 = none */
+    uint64_t last_flush_ms;
+
+    md_sgr_t want;          /* Style requested by the SGR sequences seen */
+    md_sgr_t have;          /* Style the terminal is in */
+    int have_known;         /* 0 until the first SGR reaches the terminal */
+    int pending;            /* SGR seen since the style was last synced */
+} md_outbuf_t;
+
+/**
+ * Initialize an output buffer with the default thresholds
+ * @param out Output buffer
+ * @param sink Destination callback, NULL for stdout
+ * @param userdata User data passed to the callback
+ */
+void md_outbuf_init(md_outbuf_t* out, md_output_fn sink, void* userdata);
+
+/**
+ * Append text, which may contain complete escape sequences
+ * Flushes when the size threshold is reached.
+ * @param out Output buffer
+ * @param text Text to append
+ * @param len Length of text
+ */
+void md_outbuf_write(md_outbuf_t* out, const char* text, size_t len);
+
+/**
+ * md_output_fn adapter: userdata is the md_outbuf_t
+ */
+void md_outbuf_output(const char* text, size_t len, void* userdata);
+
+/**
+ * Flush if the time threshold has passed since the last flush
+ * @param out Output buffer
+ */
+void md_outbuf_tick(md_outbuf_t* out);
+
+/**
+ * Apply any pending style change and write out the buffer
+ * @param out Output buffer
+ */
+void md_outbuf_flush(md_outbuf_t* out);
+
+/**
+ * Release buffer memory (does not flush)
+ * @param out Output buffer
+ */
+void md_outbuf_free(md_outbuf_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MD_OUTPUT_H */
@@ -1,68 +1,19 @@
 /**
  * @file md_parser.c
- * @brief Markdown parser implementation using PCRE2
+ * @brief Markdown parser implementation
  */
 
 #include "md_parser.h"
+#include "md_line.h"
 #include "md_utils.h"
 #include "arc/platform.h"
 #include "arc/log.h"
 
-#define PCRE2_CODE_UNIT_WIDTH 8
-#include <pcre2.h>
-
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdio.h>
 
-/* ========== Regex patterns ========== */
-static pcre2_code* re_heading = NULL;
-static pcre2_code* re_quote = NULL;
-static pcre2_code* re_bullet = NULL;
-static pcre2_code* re_ordered = NULL;
-static pcre2_code* re_hr = NULL;
-static pcre2_code* re_table_sep = NULL;
-
-static int regex_initialized = 0;
-
-/* ========== Helper macros ========== */
-#define STARTS_WITH(s, prefix) (strncmp((s), (prefix), strlen(prefix)) == 0)
-
-/* ========== Regex compilation ========== */
-
-static pcre2_code* compile_regex(const char* pattern) {
-    int errornumber;
-    PCRE2_SIZE erroroffset;
-    pcre2_code* re = pcre2_compile(
-        (PCRE2_SPTR)pattern,
-        PCRE2_ZERO_TERMINATED,
-        0,
-        &errornumber,
-        &erroroffset,
-        NULL
-    );
-    if (re == NULL) {
-        PCRE2_UCHAR buffer[256];
-        pcre2_get_error_message(errornumber, buffer, sizeof(buffer));
-        AC_LOG_ERROR( "PCRE2 compile error at offset %d: %s\n", (int)erroroffset, buffer);
-    }
-    return re;
-}
-
-static void init_regex(void) {
-    if (regex_initialized) return;
-
-    re_heading = compile_regex("^(#{1,6})\\s+(.*)$");
-    re_quote = compile_regex("^\\s*>\\s?(.*)$");
-    re_bullet = compile_regex("^(\\s*)([-*+])\\s+(.*)$");
-    re_ordered = compile_regex("^(\\s*)(\\d+)\\.\\s+(.*)$");
-    re_hr = compile_regex("^\\s*([-*_])\\s*\\1\\s*\\1\\s*$");
-    re_table_sep = compile_regex("^\\|?\\s*(:?-+:?)\\s*(\\|\\s*:?-+:?\\s*)*\\|?\\s*$");
-
-    regex_initialized = 1;
-}
-
 /* ========== Inline parser ========== */
 
 /* Parse until a delimiter is found, return content before delimiter */
@@ -250,34 +201,6 @@ md_inline_token_t* md_parse_inline(const char* text) {
 
 /* ========== Block parser helpers ========== */
 
-/* Match regex and get captured groups */
-static int match_regex(pcre2_code* re, const char* subject,
-                       PCRE2_SIZE* ovector, int ovector_count) {
-    if (!re) return 0;
-
-    pcre2_match_data* match_data = pcre2_match_data_create(ovector_count, NULL);
-    if (!match_data) return 0;
-
-    int rc = pcre2_match(re, (PCRE2_SPTR)subject, PCRE2_ZERO_TERMINATED,
-                         0, 0, match_data, NULL);
-
-    if (rc > 0) {
-        PCRE2_SIZE* ov = pcre2_get_ovector_pointer(match_data);
-        for (int i = 0; i < rc * 2 && i < ovector_count * 2; i++) {
-            ovector[i] = ov[i];
-        }
-    }
-
-    pcre2_match_data_free(match_data);
-    return rc > 0 ? rc : 0;
-}
-
-/* Extract substring from match */
-static char* extract_match(const char* subject, PCRE2_SIZE start, PCRE2_SIZE end) {
-    if (start == PCRE2_UNSET || end == PCRE2_UNSET) return NULL;
-    return md_strndup(subject + start, end - start);
-}
-
 /* Create a new block token */
 static md_block_token_t* new_block_token(md_block_type_t type) {
     md_block_token_t* tok = (md_block_token_t*)calloc(1, sizeof(md_block_token_t));
@@ -372,6 +295,81 @@ static md_inline_token_t** split_table_row(const char* line, size_t* out_count)
     return cells;
 }
 
+md_block_token_t* md_parse_table_header(const char* header, const char* separator) {
+    if (!header || !separator) return NULL;
+
+    md_block_token_t* table = new_block_token(MD_BLOCK_TABLE);
+    if (!table) return NULL;
+
+    /* Parse header row */
+    size_t col_count;
+    table->data.table.headers = split_table_row(header, &col_count);
+    table->data.table.col_count = col_count;
+    table->data.table.row_count = 0;
+    table->data.table.rows = NULL;
+
+    /* Parse alignments from separator */
+    table->data.table.aligns = (md_align_t*)calloc(col_count ? col_count : 1, sizeof(md_align_t));
+    if (table->data.table.aligns) {
+        const char* p = separator;
+        while (*p && isspace((unsigned char)*p)) p++;
+        if (*p == '|') p++;
+
+        size_t align_idx = 0;
+        while (*p && align_idx < col_count) {
+            const char* cell_start = p;
+            while (*p && *p != '|') p++;
+            char* cell = md_strndup(cell_start, p - cell_start);
+            if (cell) {
+                table->data.table.aligns[align_idx] = parse_align(cell);
+                free(cell);
+            }
+            align_idx++;
+            if (*p == '|') p++;
+        }
+    }
+
+    return table;
+}
+
+int md_table_append_row(md_block_token_t* table, const char* line) {
+    if (!table || table->type != MD_BLOCK_TABLE || !line) return -1;
+
+    md_table_t* t = &table->data.table;
+    size_t cell_count;
+    md_inline_token_t** cells = split_table_row(line, &cell_count);
+    if (!cells) return -1;
+
+    /* Rows are always col_count wide: pad short rows, drop extra cells */
+    md_inline_token_t** row = (md_inline_token_t**)calloc(t->col_count ? t->col_count : 1,
+                                                          sizeof(md_inline_token_t*));
+    if (!row) {
+        for (size_t i = 0; i < cell_count; i++) md_free_inline_tokens(cells[i]);
+        free(cells);
+        return -1;
+    }
+    for (size_t i = 0; i < cell_count; i++) {
+        if (i < t->col_count) {
+            row[i] = cells[i];
+        } else {
+            md_free_inline_tokens(cells[i]);
+        }
+    }
+    free(cells);
+
+    /* Resize rows array */
+    md_inline_token_t*** new_rows = (md_inline_token_t***)realloc(
+        t->rows, (t->row_count + 1) * sizeof(md_inline_token_t**));
+    if (!new_rows) {
+        for (size_t i = 0; i < t->col_count; i++) md_free_inline_tokens(row[i]);
+        free(row);
+        return -1;
+    }
+    t->rows = new_rows;
+    t->rows[t->row_count++] = row;
+    return 0;
+}
+
 /* ========== List parser ========== */
 
 static md_list_item_t* new_list_item(void) {
@@ -383,8 +381,6 @@ static md_list_item_t* new_list_item(void) {
 md_block_token_t* md_parse(const char* markdown) {
     if (!markdown || !*markdown) return NULL;
 
-    init_regex();
-
     md_block_token_t* head = NULL;
     md_block_token_t* tail = NULL;
 
@@ -425,16 +421,17 @@ md_block_token_t* md_parse(const char* markdown) {
             line_len--;
         }
 
-        PCRE2_SIZE ov[20];
+        md_line_t info;
+        md_classify_line(line, line_len, &info);
 
         /* ---- Code block handling ---- */
-        if (STARTS_WITH(line, "```")) {
+        if (info.type == MD_LINE_FENCE) {
             if (!in_code_block) {
                 /* Start code block */
                 in_code_block = 1;
                 in_list = 0;
                 in_table = 0;
-                code_lang = md_strdup(line + 3);
+                code_lang = md_strdup(line + info.content);
                 if (code_lang) md_rtrim(code_lang);
                 code_buf_len = 0;
                 if (!code_buffer) {
@@ -466,7 +463,7 @@ md_block_token_t* md_parse(const char* markdown) {
         }
 
         /* ---- Empty line ---- */
-        if (line_len == 0 || (line_len == 1 && isspace((unsigned char)line[0]))) {
+        if (info.type == MD_LINE_BLANK) {
             in_list = 0;
             in_table = 0;
             line = next_line;
@@ -474,26 +471,21 @@ md_block_token_t* md_parse(const char* markdown) {
         }
 
         /* ---- Heading ---- */
-        if (match_regex(re_heading, line, ov, 10)) {
+        if (info.type == MD_LINE_HEADING) {
             in_list = 0;
             in_table = 0;
-            char* hashes = extract_match(line, ov[2], ov[3]);
-            char* content = extract_match(line, ov[4], ov[5]);
-
             md_block_token_t* tok = new_block_token(MD_BLOCK_HEADING);
-            if (tok && hashes && content) {
-                tok->data.heading.level = (int)strlen(hashes);
-                tok->data.heading.content = md_parse_inline(content);
+            if (tok) {
+                tok->data.heading.level = info.level;
+                tok->data.heading.content = md_parse_inline(line + info.content);
                 append_block_token(&head, &tail, tok);
             }
-            free(hashes);
-            free(content);
             line = next_line;
             continue;
         }
 
         /* ---- Horizontal rule ---- */
-        if (match_regex(re_hr, line, ov, 10)) {
+        if (info.type == MD_LINE_HR) {
             in_list = 0;
             in_table = 0;
             md_block_token_t* tok = new_block_token(MD_BLOCK_HR);
@@ -503,26 +495,21 @@ md_block_token_t* md_parse(const char* markdown) {
         }
 
         /* ---- Block quote ---- */
-        if (match_regex(re_quote, line, ov, 10)) {
+        if (info.type == MD_LINE_QUOTE) {
             in_list = 0;
             in_table = 0;
-            char* content = extract_match(line, ov[2], ov[3]);
             md_block_token_t* tok = new_block_token(MD_BLOCK_QUOTE);
             if (tok) {
-                tok->data.quote.content = md_parse_inline(content ? content : "");
+                tok->data.quote.content = md_parse_inline(line + info.content);
                 append_block_token(&head, &tail, tok);
             }
-            free(content);
             line = next_line;
             continue;
         }
 
         /* ---- Unordered list ---- */
-        if (match_regex(re_bullet, line, ov, 10)) {
+        if (info.type == MD_LINE_BULLET) {
             in_table = 0;
-            char* indent_str = extract_match(line, ov[2], ov[3]);
-            char* content = extract_match(line, ov[6], ov[7]);
-            int indent = indent_str ? md_count_indent(indent_str) : 0;
 
             if (!in_list || current_list_type != MD_LIST_UNORDERED) {
                 /* Start new list */
@@ -540,8 +527,8 @@ md_block_token_t* md_parse(const char* markdown) {
             /* Add item */
             md_list_item_t* item = new_list_item();
             if (item) {
-                item->content = md_parse_inline(content ? content : "");
-                item->indent_level = indent / 2; /* 2 spaces per level */
+                item->content = md_parse_inline(line + info.content);
+                item->indent_level = info.indent / 2; /* 2 spaces per level */
                 if (list_tail) {
                     list_tail->next = item;
                 } else if (current_list) {
@@ -550,18 +537,13 @@ md_block_token_t* md_parse(const char* markdown) {
                 list_tail = item;
             }
 
-            free(indent_str);
-            free(content);
             line = next_line;
             continue;
         }
 
         /* ---- Ordered list ---- */
-        if (match_regex(re_ordered, line, ov, 10)) {
+        if (info.type == MD_LINE_ORDERED) {
             in_table = 0;
-            char* indent_str = extract_match(line, ov[2], ov[3]);
-            char* content = extract_match(line, ov[6], ov[7]);
-            int indent = indent_str ? md_count_indent(indent_str) : 0;
 
             if (!in_list || current_list_type != MD_LIST_ORDERED) {
                 in_list = 1;
@@ -577,8 +559,8 @@ md_block_token_t* md_parse(const char* markdown) {
 
             md_list_item_t* item = new_list_item();
             if (item) {
-                item->content = md_parse_inline(content ? content : "");
-                item->indent_level = indent / 3; /* 3 chars per level (e.g., "1. ") */
+                item->content = md_parse_inline(line + info.content);
+                item->indent_level = info.indent / 3; /* 3 chars per level (e.g., "1. ") */
                 if (list_tail) {
                     list_tail->next = item;
                 } else if (current_list) {
@@ -587,15 +569,13 @@ md_block_token_t* md_parse(const char* markdown) {
                 list_tail = item;
             }
 
-            free(indent_str);
-            free(content);
             line = next_line;
             continue;
         }
 
         /* ---- Table ---- */
         /* Check if this could be a table header (contains |) */
-        if (!in_table && !in_list && strchr(line, '|')) {
+        if (!in_table && !in_list && info.has_pipe) {
             /* Look ahead for separator line */
             if (next_line) {
                 char* sep_line = next_line;
@@ -606,43 +586,15 @@ md_block_token_t* md_parse(const char* markdown) {
                     *sep_end = '\0';
                 }
 
-                if (match_regex(re_table_sep, sep_line, ov, 10)) {
+                md_line_t sep_info;
+                md_classify_line(sep_line, strlen(sep_line), &sep_info);
+                if (sep_info.table_sep) {
                     /* This is a table! */
                     in_table = 1;
                     in_list = 0;
 
-                    current_table = new_block_token(MD_BLOCK_TABLE);
-                    if (current_table) {
-                        /* Parse header row */
-                        size_t col_count;
-                        current_table->data.table.headers = split_table_row(line, &col_count);
-                        current_table->data.table.col_count = col_count;
-                        current_table->data.table.row_count = 0;
-                        current_table->data.table.rows = NULL;
-
-                        /* Parse alignments from separator */
-                        current_table->data.table.aligns = (md_align_t*)calloc(col_count, sizeof(md_align_t));
-                        if (current_table->data.table.aligns) {
-                            const char* p = sep_line;
-                            while (*p && isspace((unsigned char)*p)) p++;
-                            if (*p == '|') p++;
-
-                            size_t align_idx = 0;
-                            while (*p && align_idx < col_count) {
-                                const char* cell_start = p;
-                                while (*p && *p != '|') p++;
-                                char* cell = md_strndup(cell_start, p - cell_start);
-                                if (cell) {
-                                    current_table->data.table.aligns[align_idx] = parse_align(cell);
-                                    free(cell);
-                                }
-                                align_idx++;
-                                if (*p == '|') p++;
-                            }
-                        }
-
-                        append_block_token(&head, &tail, current_table);
-                    }
+                    current_table = md_parse_table_header(line, sep_line);
+                    append_block_token(&head, &tail, current_table);
 
                     /* Skip separator line */
                     if (sep_end) *sep_end = saved;
@@ -656,25 +608,8 @@ md_block_token_t* md_parse(const char* markdown) {
         }
 
         /* Continue parsing table rows */
-        if (in_table && current_table && strchr(line, '|')) {
-            size_t row_col_count;
-            md_inline_token_t** row = split_table_row(line, &row_col_count);
-
-            if (row) {
-                /* Resize rows array */
-                size_t new_count = current_table->data.table.row_count + 1;
-                md_inline_token_t*** new_rows = (md_inline_token_t***)realloc(
-                    current_table->data.table.rows,
-                    new_count * sizeof(md_inline_token_t**)
-                );
-                if (new_rows) {
-                    current_table->data.table.rows = new_rows;
-                    current_table->data.table.rows[current_table->data.table.row_count] = row;
-                    current_table->data.table.row_count = new_count;
-                } else {
-                    free(row);
-                }
-            }
+        if (in_table && current_table && info.has_pipe) {
+            md_table_append_row(current_table, line);
 
             line = next_line;
             continue;
@@ -26,6 +26,23 @@ md_inline_token_t* md_parse_inline(const char* text);
  */
 md_block_token_t* md_parse(const char* markdown);
 
+/**
+ * Create a table token from its header and separator lines
+ * @param header Header row ("| a | b |")
+ * @param separator Separator row ("|---|:-:|"), used for alignments
+ * @return Table block token with no data rows, or NULL on error
+ */
+md_block_token_t* md_parse_table_header(const char* header, const char* separator);
+
+/**
+ * Parse a table row and append it to a table token
+ * Rows are padded or truncated to the table's column count.
+ * @param table Table block token
+ * @param line Row text
+ * @return 0 on success, -1 on error
+ */
+int md_table_append_row(md_block_token_t* table, const char* line);
+
 /**
  * Free inline token list
  * @param token Head of inline token list
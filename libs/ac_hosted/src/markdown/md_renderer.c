@@ -114,9 +114,9 @@ void md_render_inline(md_renderer_t* r, const md_inline_token_t* tokens) {
     }
 }
 
-/* ========== Get inline text for width calculation ========== */
+/* ========== Inline display width ========== */
 
-static int get_inline_width(const md_inline_token_t* tokens) {
+int md_inline_width(const md_inline_token_t* tokens) {
     int width = 0;
     for (const md_inline_token_t* tok = tokens; tok; tok = tok->next) {
         if (tok->text) {
@@ -216,20 +216,14 @@ static void render_code_block(md_renderer_t* r, const md_block_token_t* tok) {
     /* Calculate max line width */
     int max_width = 0;
     const char* p = code;
-    int current_width = 0;
     while (*p) {
-        if (*p == '\n') {
-            if (current_width > max_width) max_width = current_width;
-            current_width = 0;
-        } else {
-            int bytes;
-            uint32_t cp = md_utf8_decode(p, &bytes);
-            current_width += md_char_width(cp);
-            p += bytes - 1;
-        }
-        p++;
+        const char* nl = strchr(p, '\n');
+        size_t line_len = nl ? (size_t)(nl - p) : strlen(p);
+        int line_width = md_utf8_display_width_n(p, line_len);
+        if (line_width > max_width) max_width = line_width;
+        p += line_len;
+        if (*p == '\n') p++;
     }
-    if (current_width > max_width) max_width = current_width;
     
     /* Draw top border */
     int lang_len = md_utf8_display_width(lang);
@@ -297,6 +291,56 @@ static void render_code_block(md_renderer_t* r, const md_block_token_t* tok) {
     output(r, "\n\n");
 }
 
+void md_render_table_divider(md_renderer_t* r, const int* widths, size_t col_count,
+                             const char* left, const char* mid, const char* right) {
+    output(r, MD_COLOR_BRIGHT_BLACK);
+    output(r, left);
+    for (size_t i = 0; i < col_count; i++) {
+        output_n(r, MD_BOX_HORIZONTAL, widths[i] + 2);
+        output(r, i == col_count - 1 ? right : mid);
+    }
+    output(r, MD_STYLE_RESET);
+    output(r, "\n");
+}
+
+void md_render_table_row(md_renderer_t* r, const md_table_t* table,
+                         md_inline_token_t* const* cells, const int* widths, int is_header) {
+    output(r, MD_COLOR_BRIGHT_BLACK);
+    output(r, MD_BOX_VERTICAL);
+    output(r, MD_STYLE_RESET);
+    for (size_t i = 0; i < table->col_count; i++) {
+        output(r, " ");
+        if (is_header) output(r, MD_COLOR_BRIGHT_BLUE);
+        if (cells && cells[i]) {
+            int content_width = md_inline_width(cells[i]);
+            /* Apply alignment; overflowing cells push the border right */
+            md_align_t align = table->aligns ? table->aligns[i] : MD_ALIGN_LEFT;
+            int padding = widths[i] - content_width;
+            if (padding < 0) padding = 0;
+            int left_pad = 0, right_pad = 0;
+            if (align == MD_ALIGN_CENTER) {
+                left_pad = padding / 2;
+                right_pad = padding - left_pad;
+            } else if (align == MD_ALIGN_RIGHT) {
+                left_pad = padding;
+            } else {
+                right_pad = padding;
+            }
+            output_n(r, " ", left_pad);
+            md_render_inline(r, cells[i]);
+            output_n(r, " ", right_pad);
+        } else {
+            output_n(r, " ", widths[i]);
+        }
+        output(r, MD_STYLE_RESET);
+        output(r, " ");
+        output(r, MD_COLOR_BRIGHT_BLACK);
+        output(r, MD_BOX_VERTICAL);
+        output(r, MD_STYLE_RESET);
+    }
+    output(r, "\n");
+}
+
 static void render_table(md_renderer_t* r, const md_block_token_t* tok) {
     const md_table_t* table = &tok->data.table;
     size_t col_count = table->col_count;
@@ -310,7 +354,7 @@ static void render_table(md_renderer_t* r, const md_block_token_t* tok) {
     /* Headers */
     for (size_t i = 0; i < col_count; i++) {
         if (table->headers && table->headers[i]) {
-            int w = get_inline_width(table->headers[i]);
+            int w = md_inline_width(table->headers[i]);
             if (w > col_widths[i]) col_widths[i] = w;
         }
     }
@@ -320,86 +364,33 @@ static void render_table(md_renderer_t* r, const md_block_token_t* tok) {
         if (table->rows && table->rows[row]) {
             for (size_t col = 0; col < col_count; col++) {
                 if (table->rows[row][col]) {
-                    int w = get_inline_width(table->rows[row][col]);
+                    int w = md_inline_width(table->rows[row][col]);
                     if (w > col_widths[col]) col_widths[col] = w;
                 }
             }
         }
     }
     
-    /* Helper: print horizontal divider */
-    #define PRINT_DIVIDER(left, mid, right) do { \
-        output(r, MD_COLOR_BRIGHT_BLACK); \
-        output(r, left); \
-        for (size_t i = 0; i < col_count; i++) { \
-            output_n(r, MD_BOX_HORIZONTAL, col_widths[i] + 2); \
-            output(r, i == col_count - 1 ? right : mid); \
-        } \
-        output(r, MD_STYLE_RESET); \
-        output(r, "\n"); \
-    } while(0)
-    
-    /* Helper: print row */
-    #define PRINT_ROW(cells, is_header) do { \
-        output(r, MD_COLOR_BRIGHT_BLACK); \
-        output(r, MD_BOX_VERTICAL); \
-        output(r, MD_STYLE_RESET); \
-        for (size_t i = 0; i < col_count; i++) { \
-            output(r, " "); \
-            if (is_header) output(r, MD_COLOR_BRIGHT_BLUE); \
-            int content_width = 0; \
-            if (cells && cells[i]) { \
-                content_width = get_inline_width(cells[i]); \
-                /* Apply alignment */ \
-                md_align_t align = table->aligns ? table->aligns[i] : MD_ALIGN_LEFT; \
-                int padding = col_widths[i] - content_width; \
-                int left_pad = 0, right_pad = 0; \
-                if (align == MD_ALIGN_CENTER) { \
-                    left_pad = padding / 2; \
-                    right_pad = padding - left_pad; \
-                } else if (align == MD_ALIGN_RIGHT) { \
-                    left_pad = padding; \
-                } else { \
-                    right_pad = padding; \
-                } \
-                output_n(r, " ", left_pad); \
-                md_render_inline(r, cells[i]); \
-                output_n(r, " ", right_pad); \
-            } else { \
-                output_n(r, " ", col_widths[i]); \
-            } \
-            output(r, MD_STYLE_RESET); \
-            output(r, " "); \
-            output(r, MD_COLOR_BRIGHT_BLACK); \
-            output(r, MD_BOX_VERTICAL); \
-            output(r, MD_STYLE_RESET); \
-        } \
-        output(r, "\n"); \
-    } while(0)
-    
     /* Top border */
-    PRINT_DIVIDER(MD_BOX_TOP_LEFT, MD_BOX_T_DOWN, MD_BOX_TOP_RIGHT);
+    md_render_table_divider(r, col_widths, col_count, MD_BOX_TOP_LEFT, MD_BOX_T_DOWN, MD_BOX_TOP_RIGHT);
     
     /* Header row */
-    PRINT_ROW(table->headers, 1);
+    md_render_table_row(r, table, table->headers, col_widths, 1);
     
     /* Separator */
-    PRINT_DIVIDER(MD_BOX_T_RIGHT, MD_BOX_CROSS, MD_BOX_T_LEFT);
+    md_render_table_divider(r, col_widths, col_count, MD_BOX_T_RIGHT, MD_BOX_CROSS, MD_BOX_T_LEFT);
     
     /* Data rows */
     for (size_t row = 0; row < table->row_count; row++) {
         md_inline_token_t** row_cells = (table->rows && table->rows[row]) ? table->rows[row] : NULL;
-        PRINT_ROW(row_cells, 0);
+        md_render_table_row(r, table, row_cells, col_widths, 0);
     }
     
     /* Bottom border */
-    PRINT_DIVIDER(MD_BOX_BOTTOM_LEFT, MD_BOX_T_UP, MD_BOX_BOTTOM_RIGHT);
+    md_render_table_divider(r, col_widths, col_count, MD_BOX_BOTTOM_LEFT, MD_BOX_T_UP, MD_BOX_BOTTOM_RIGHT);
     
     output(r, "\n");
     
-    #undef PRINT_DIVIDER
-    #undef PRINT_ROW
-    
     free(col_widths);
 }
 
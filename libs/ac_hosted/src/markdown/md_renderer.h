@@ -66,6 +66,37 @@ void md_render_blocks(md_renderer_t* renderer, const md_block_token_t* tokens);
  */
 void md_render_block(md_renderer_t* renderer, const md_block_token_t* token);
 
+/**
+ * Display width of rendered inline tokens (links count their " (url)" suffix)
+ * @param tokens Inline token list
+ * @return Width in terminal columns
+ */
+int md_inline_width(const md_inline_token_t* tokens);
+
+/**
+ * Render a horizontal table border
+ * @param renderer Renderer context
+ * @param widths Content width of each column
+ * @param col_count Number of columns
+ * @param left Left corner/junction glyph
+ * @param mid Column junction glyph
+ * @param right Right corner/junction glyph
+ */
+void md_render_table_divider(md_renderer_t* renderer, const int* widths, size_t col_count,
+                             const char* left, const char* mid, const char* right);
+
+/**
+ * Render one table row at the given column widths
+ * Cells wider than their column are not truncated.
+ * @param renderer Renderer context
+ * @param table Table (column count and alignments)
+ * @param cells Row cells (col_count entries, NULL for empty)
+ * @param widths Content width of each column
+ * @param is_header Non-zero to style as header
+ */
+void md_render_table_row(md_renderer_t* renderer, const md_table_t* table,
+                         md_inline_token_t* const* cells, const int* widths, int is_header);
+
 /**
  * Simple render function - render Markdown to stdout
  * @param markdown Markdown string
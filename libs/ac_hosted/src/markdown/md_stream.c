@@ -5,6 +5,8 @@
 
 #include "md_stream.h"
 #include "md_parser.h"
+#include "md_line.h"
+#include "md_output.h"
 #include "md_renderer.h"
 #include "md_style.h"
 #include "md_utils.h"
@@ -13,11 +15,18 @@
 #include <string.h>
 #include <stdio.h>
 
+/* Rows held back to size the columns before a table is first drawn */
+#define MD_TABLE_EARLY_ROWS     3
+
+/* Column re-layouts allowed per table before cells are left to overflow */
+#define MD_TABLE_MAX_RELAYOUTS  4
+
 /* ========== Stream state ========== */
 
 struct md_stream {
-    /* Renderer */
+    /* Renderer; its output goes through the batching buffer */
     md_renderer_t renderer;
+    md_outbuf_t out;
     
     /* Line buffer for incomplete lines */
     char* line_buffer;
@@ -28,14 +37,28 @@ struct md_stream {
     md_stream_state_t state;
     
     /* Code block state */
+    md_code_mode_t code_mode;
+    int code_mode_set;          /* code_mode chosen by the caller */
+    md_code_mode_t code_block_mode; /* Mode of the open block */
+    int cursor_control;         /* -1 = auto (stdout is a terminal) */
     char* code_lang;
-    char* code_buffer;
+    char* code_buffer;          /* MD_CODE_BUFFERED only */
     size_t code_buf_size;
     size_t code_buf_len;
+    int* code_widths;           /* MD_CODE_STREAM: width of each emitted line */
+    size_t code_lines;
+    size_t code_widths_cap;
+    int code_max_width;
     
     /* Table state */
+    md_table_mode_t table_mode;
+    char* table_candidate;      /* Pipe line held until the next line shows if it is a header */
     md_block_token_t* pending_table;
-    int table_header_seen;
+    int* table_widths;          /* Column widths as drawn so far */
+    size_t table_lines;         /* Lines emitted for the table; 0 = not drawn yet */
+    int table_max_width;        /* Widest line emitted */
+    int table_relayouts;
+    int table_overflow;         /* A row was drawn wider than its columns */
     
     /* List state */
     int in_list;
@@ -50,19 +73,54 @@ md_stream_t* md_stream_new(void) {
     if (!stream) return NULL;
     
     md_renderer_init(&stream->renderer);
+    md_outbuf_init(&stream->out, NULL, NULL);
+    md_renderer_set_output(&stream->renderer, md_outbuf_output, &stream->out);
     stream->state = MD_STATE_NORMAL;
+    stream->code_mode = MD_CODE_STREAM;
+    stream->cursor_control = -1;
     
     return stream;
 }
 
 void md_stream_set_output(md_stream_t* stream, md_output_fn output, void* userdata) {
     if (!stream) return;
-    md_renderer_set_output(&stream->renderer, output, userdata);
+    md_outbuf_flush(&stream->out);
+    stream->out.sink = output;
+    stream->out.userdata = userdata;
+}
+
+void md_stream_set_flush_policy(md_stream_t* stream, size_t max_bytes, int max_delay_ms) {
+    if (!stream) return;
+    stream->out.flush_bytes = max_bytes;
+    stream->out.flush_ms = max_delay_ms;
+}
+
+void md_stream_flush(md_stream_t* stream) {
+    if (!stream) return;
+    md_outbuf_flush(&stream->out);
+}
+
+void md_stream_set_code_mode(md_stream_t* stream, md_code_mode_t mode) {
+    if (!stream) return;
+    stream->code_mode = mode;
+    stream->code_mode_set = 1;
+}
+
+void md_stream_set_table_mode(md_stream_t* stream, md_table_mode_t mode) {
+    if (!stream) return;
+    stream->table_mode = mode;
+}
+
+void md_stream_set_cursor_control(md_stream_t* stream, int enabled) {
+    if (!stream) return;
+    stream->cursor_control = enabled ? 1 : 0;
 }
 
 void md_stream_reset(md_stream_t* stream) {
     if (!stream) return;
     
+    md_outbuf_flush(&stream->out);
+    
     /* Clear line buffer */
     stream->line_buf_len = 0;
     if (stream->line_buffer) stream->line_buffer[0] = '\0';
@@ -75,13 +133,19 @@ void md_stream_reset(md_stream_t* stream) {
     stream->code_lang = NULL;
     stream->code_buf_len = 0;
     if (stream->code_buffer) stream->code_buffer[0] = '\0';
+    stream->code_lines = 0;
+    stream->code_max_width = 0;
     
     /* Clear table state */
+    free(stream->table_candidate);
+    stream->table_candidate = NULL;
     if (stream->pending_table) {
         md_free_tokens(stream->pending_table);
         stream->pending_table = NULL;
     }
-    stream->table_header_seen = 0;
+    free(stream->table_widths);
+    stream->table_widths = NULL;
+    stream->table_lines = 0;
     
     /* Reset list state */
     stream->in_list = 0;
@@ -91,9 +155,14 @@ void md_stream_reset(md_stream_t* stream) {
 void md_stream_free(md_stream_t* stream) {
     if (!stream) return;
     
+    md_outbuf_flush(&stream->out);
+    md_outbuf_free(&stream->out);
     free(stream->line_buffer);
     free(stream->code_lang);
     free(stream->code_buffer);
+    free(stream->code_widths);
+    free(stream->table_candidate);
+    free(stream->table_widths);
     
     if (stream->pending_table) {
         md_free_tokens(stream->pending_table);
@@ -107,15 +176,10 @@ void md_stream_free(md_stream_t* stream) {
 /* Forward declaration */
 static void process_line(md_stream_t* stream, const char* line);
 
-/* Helper to output directly */
+/* Helper to output through the batching buffer */
 static void output(md_stream_t* stream, const char* text) {
     if (!text) return;
-    if (stream->renderer.output) {
-        stream->renderer.output(text, strlen(text), stream->renderer.userdata);
-    } else {
-        fputs(text, stdout);
-        fflush(stdout);
-    }
+    md_outbuf_write(&stream->out, text, strlen(text));
 }
 
 static void output_n(md_stream_t* stream, const char* text, int n) {
@@ -130,199 +194,509 @@ static void render_and_free_inline(md_stream_t* stream, md_inline_token_t* token
     md_free_inline_tokens(tokens);
 }
 
+/*
+ * Whether output emitted so far can be redrawn in place: cursor movement is
+ * allowed, the last `lines` lines are still on screen and none of them
+ * wrapped (the widest was `width` columns).
+ */
+static int can_redraw(md_stream_t* stream, size_t lines, int width) {
+    int rows;
+    
+    if (stream->cursor_control == 0) return 0;
+    if (stream->cursor_control < 0 && stream->out.sink) return 0;
+    
+    rows = md_get_terminal_height();
+    if (rows <= 0) {
+        if (stream->cursor_control < 0) return 0;
+        rows = 1 << 30;     /* Explicitly enabled: caller vouches for the terminal */
+    }
+    
+    return lines < (size_t)rows && width <= stream->renderer.term_width;
+}
+
+/* ========== Code blocks ========== */
+
+/*
+ * Streamed blocks only come out right if the frame can be fixed up at the
+ * closing fence, so without cursor control the default is to buffer.
+ */
+static md_code_mode_t code_block_mode(md_stream_t* stream) {
+    if (stream->code_mode_set || stream->cursor_control > 0) return stream->code_mode;
+    if (stream->cursor_control == 0 || stream->out.sink) return MD_CODE_BUFFERED;
+    return md_get_terminal_height() > 0 ? MD_CODE_STREAM : MD_CODE_BUFFERED;
+}
+
+static const char* code_lang_label(md_stream_t* stream) {
+    return stream->code_lang && stream->code_lang[0] ? stream->code_lang : "code";
+}
+
+/* Top border; an open border has no right corner (width not known yet) */
+static void draw_code_top(md_stream_t* stream, int box_inner, int closed) {
+    const char* lang = code_lang_label(stream);
+    int lang_len = md_utf8_display_width(lang);
+    
+    output(stream, MD_STYLE_BOLD);
+    output(stream, MD_COLOR_BRIGHT_YELLOW);
+    output(stream, MD_BOX_TOP_LEFT);
+    output(stream, MD_BOX_HORIZONTAL);
+    output(stream, " ");
+    output(stream, lang);
+    output(stream, " ");
+    if (closed) {
+        int remaining = box_inner - lang_len - 3;
+        if (remaining > 0) {
+            output_n(stream, MD_BOX_HORIZONTAL, remaining);
+        }
+        output(stream, MD_BOX_TOP_RIGHT);
+    }
+    output(stream, MD_STYLE_RESET);
+    output(stream, "\n");
+}
+
+static void draw_code_line_start(md_stream_t* stream) {
+    output(stream, MD_COLOR_BRIGHT_YELLOW);
+    output(stream, MD_BOX_VERTICAL);
+    output(stream, " ");
+    output(stream, MD_STYLE_RESET);
+}
+
+/* Padding and right border, after a line of `line_width` columns */
+static void draw_code_line_end(md_stream_t* stream, int content_width, int line_width) {
+    int padding = content_width - line_width;
+    if (padding > 0) {
+        output_n(stream, " ", padding);
+    }
+    output(stream, " ");
+    output(stream, MD_COLOR_BRIGHT_YELLOW);
+    output(stream, MD_BOX_VERTICAL);
+    output(stream, MD_STYLE_RESET);
+}
+
+static void draw_code_bottom(md_stream_t* stream, int box_inner, int closed) {
+    output(stream, MD_COLOR_BRIGHT_YELLOW);
+    output(stream, MD_BOX_BOTTOM_LEFT);
+    output_n(stream, MD_BOX_HORIZONTAL, box_inner);
+    output(stream, closed ? MD_BOX_BOTTOM_RIGHT : MD_BOX_HORIZONTAL);
+    output(stream, MD_STYLE_RESET);
+    output(stream, "\n\n");
+}
+
+/* Render a complete buffered block */
+static void draw_code_box(md_stream_t* stream, const char* code) {
+    const char* lang = code_lang_label(stream);
+    
+    /* Calculate max line width */
+    int max_width = 0;
+    const char* p = code;
+    while (*p) {
+        const char* nl = strchr(p, '\n');
+        size_t line_len = nl ? (size_t)(nl - p) : strlen(p);
+        int line_width = md_utf8_display_width_n(p, line_len);
+        if (line_width > max_width) max_width = line_width;
+        p += line_len;
+        if (*p == '\n') p++;
+    }
+    
+    int lang_len = md_utf8_display_width(lang);
+    int content_width = max_width > lang_len ? max_width : lang_len;
+    int box_inner = content_width + 2;
+    
+    draw_code_top(stream, box_inner, 1);
+    
+    p = code;
+    while (*p) {
+        draw_code_line_start(stream);
+        
+        const char* line_start = p;
+        while (*p && *p != '\n') p++;
+        
+        int line_width = 0;
+        if (p > line_start) {
+            char* code_line = md_strndup(line_start, p - line_start);
+            if (code_line) {
+                output(stream, code_line);
+                line_width = md_utf8_display_width(code_line);
+                free(code_line);
+            }
+        }
+        
+        draw_code_line_end(stream, content_width, line_width);
+        output(stream, "\n");
+        if (*p == '\n') p++;
+    }
+    
+    draw_code_bottom(stream, box_inner, 1);
+}
+
+static void code_open(md_stream_t* stream, const char* info) {
+    stream->state = MD_STATE_CODE_BLOCK;
+    
+    /* Extract language */
+    free(stream->code_lang);
+    stream->code_lang = md_strdup(info);
+    if (stream->code_lang) md_rtrim(stream->code_lang);
+    
+    stream->code_lines = 0;
+    stream->code_max_width = 0;
+    stream->code_block_mode = code_block_mode(stream);
+    
+    if (stream->code_block_mode == MD_CODE_BUFFERED) {
+        /* Reset code buffer; rendered when the block ends */
+        stream->code_buf_len = 0;
+        if (!stream->code_buffer) {
+            stream->code_buf_size = 256;
+            stream->code_buffer = (char*)malloc(stream->code_buf_size);
+        }
+        if (stream->code_buffer) stream->code_buffer[0] = '\0';
+        return;
+    }
+    
+    draw_code_top(stream, 0, 0);
+}
+
+static void code_line(md_stream_t* stream, const char* line) {
+    if (stream->code_block_mode == MD_CODE_BUFFERED) {
+        md_buffer_append(&stream->code_buffer, &stream->code_buf_size, &stream->code_buf_len, line);
+        md_buffer_append(&stream->code_buffer, &stream->code_buf_size, &stream->code_buf_len, "\n");
+        return;
+    }
+    
+    int width = md_utf8_display_width(line);
+    
+    if (stream->code_lines == stream->code_widths_cap) {
+        size_t new_cap = stream->code_widths_cap ? stream->code_widths_cap * 2 : 64;
+        int* widths = (int*)realloc(stream->code_widths, new_cap * sizeof(int));
+        if (widths) {
+            stream->code_widths = widths;
+            stream->code_widths_cap = new_cap;
+        }
+    }
+    if (stream->code_lines < stream->code_widths_cap) {
+        stream->code_widths[stream->code_lines++] = width;
+    } else {
+        stream->cursor_control = 0;     /* Out of memory: cannot redraw later */
+    }
+    if (width > stream->code_max_width) stream->code_max_width = width;
+    
+    draw_code_line_start(stream);
+    output(stream, line);
+    output(stream, "\n");
+}
+
+static void code_close(md_stream_t* stream) {
+    stream->state = MD_STATE_NORMAL;
+    
+    if (stream->code_block_mode == MD_CODE_BUFFERED) {
+        draw_code_box(stream, stream->code_buffer ? stream->code_buffer : "");
+    } else {
+        int lang_len = md_utf8_display_width(code_lang_label(stream));
+        int content_width = stream->code_max_width > lang_len ? stream->code_max_width : lang_len;
+        int box_inner = content_width + 2;
+        
+        if (can_redraw(stream, stream->code_lines + 1, content_width + 4)) {
+            char seq[32];
+            
+            /* Back to the top border and redraw it at the final width */
+            snprintf(seq, sizeof(seq), MD_CURSOR_UP_FMT, (int)stream->code_lines + 1);
+            output(stream, seq);
+            output(stream, "\r" MD_CLEAR_LINE);
+            draw_code_top(stream, box_inner, 1);
+            
+            /* Close each line at its end column ("│ " is 2 columns wide) */
+            for (size_t i = 0; i < stream->code_lines; i++) {
+                snprintf(seq, sizeof(seq), MD_CURSOR_COLUMN_FMT, stream->code_widths[i] + 3);
+                output(stream, seq);
+                draw_code_line_end(stream, content_width, stream->code_widths[i]);
+                output(stream, "\n");
+            }
+            draw_code_bottom(stream, box_inner, 1);
+        } else {
+            draw_code_bottom(stream, box_inner, 0);
+        }
+    }
+    
+    free(stream->code_lang);
+    stream->code_lang = NULL;
+}
+
+/* ========== Tables ========== */
+
+/* Width of a row drawn at `widths` ("│ x │ y │": 3 columns per cell plus 1) */
+static int table_line_width(const int* widths, size_t col_count) {
+    int width = 1;
+    for (size_t i = 0; i < col_count; i++) {
+        width += widths[i] + 3;
+    }
+    return width;
+}
+
+/* Widen `widths` to fit a row of cells; returns non-zero if any column grew */
+static int table_fit_row(int* widths, md_inline_token_t* const* cells, size_t col_count) {
+    int grew = 0;
+    for (size_t i = 0; i < col_count; i++) {
+        if (cells && cells[i]) {
+            int w = md_inline_width(cells[i]);
+            if (w > widths[i]) {
+                widths[i] = w;
+                grew = 1;
+            }
+        }
+    }
+    return grew;
+}
+
+static void table_begin(md_stream_t* stream, const char* header, const char* separator) {
+    stream->pending_table = md_parse_table_header(header, separator);
+    if (!stream->pending_table) return;
+    
+    size_t col_count = stream->pending_table->data.table.col_count;
+    free(stream->table_widths);
+    stream->table_widths = (int*)calloc(col_count ? col_count : 1, sizeof(int));
+    if (stream->table_widths) {
+        table_fit_row(stream->table_widths, stream->pending_table->data.table.headers, col_count);
+    }
+    
+    stream->state = MD_STATE_TABLE;
+    stream->table_lines = 0;
+    stream->table_max_width = 0;
+    stream->table_relayouts = 0;
+    stream->table_overflow = 0;
+}
+
+static void table_emit_row(md_stream_t* stream, md_inline_token_t* const* cells, int is_header) {
+    const md_table_t* table = &stream->pending_table->data.table;
+    int* need = (int*)malloc((table->col_count ? table->col_count : 1) * sizeof(int));
+    int width;
+    
+    if (need) {
+        memcpy(need, stream->table_widths, table->col_count * sizeof(int));
+        if (table_fit_row(need, cells, table->col_count)) stream->table_overflow = 1;
+        width = table_line_width(need, table->col_count);
+        free(need);
+    } else {
+        width = stream->renderer.term_width + 1;    /* Unknown: rule out a redraw */
+    }
+    if (width > stream->table_max_width) stream->table_max_width = width;
+    
+    md_render_table_row(&stream->renderer, table, cells, stream->table_widths, is_header);
+    stream->table_lines++;
+}
+
+static void table_emit_divider(md_stream_t* stream, const char* left, const char* mid, const char* right) {
+    size_t col_count = stream->pending_table->data.table.col_count;
+    int width = table_line_width(stream->table_widths, col_count);
+    if (width > stream->table_max_width) stream->table_max_width = width;
+    
+    md_render_table_divider(&stream->renderer, stream->table_widths, col_count, left, mid, right);
+    stream->table_lines++;
+}
+
+/*
+ * Widen the columns a new row does not fit. Grown columns get 50% slack so
+ * a run of slowly growing rows does not cost a re-layout each; the slack is
+ * dropped if it would push the table past the terminal width.
+ */
+static int table_relayout(md_stream_t* stream, md_inline_token_t* const* cells) {
+    size_t col_count = stream->pending_table->data.table.col_count;
+    int* widths = (int*)malloc(col_count * sizeof(int));
+    if (!widths) return 0;
+    
+    memcpy(widths, stream->table_widths, col_count * sizeof(int));
+    if (!table_fit_row(widths, cells, col_count)) {
+        free(widths);
+        return 0;
+    }
+    
+    int* padded = (int*)malloc(col_count * sizeof(int));
+    if (padded) {
+        for (size_t i = 0; i < col_count; i++) {
+            int old = stream->table_widths[i];
+            padded[i] = widths[i];
+            if (widths[i] > old && old + old / 2 > widths[i]) padded[i] = old + old / 2;
+        }
+        if (table_line_width(padded, col_count) <= stream->renderer.term_width) {
+            memcpy(widths, padded, col_count * sizeof(int));
+        }
+        free(padded);
+    }
+    
+    free(stream->table_widths);
+    stream->table_widths = widths;
+    stream->table_relayouts++;
+    return 1;
+}
+
+static void table_row(md_stream_t* stream, const char* line) {
+    md_table_t* table = &stream->pending_table->data.table;
+    if (md_table_append_row(stream->pending_table, line) != 0) return;
+    if (stream->table_mode == MD_TABLE_BUFFERED || !stream->table_widths || table->col_count == 0) return;
+    
+    md_inline_token_t** cells = table->rows[table->row_count - 1];
+    
+    if (stream->table_lines == 0) {
+        /* Size the columns from the header and the first rows, then draw them */
+        table_fit_row(stream->table_widths, cells, table->col_count);
+        if (table->row_count < MD_TABLE_EARLY_ROWS) return;
+        
+        table_emit_divider(stream, MD_BOX_TOP_LEFT, MD_BOX_T_DOWN, MD_BOX_TOP_RIGHT);
+        table_emit_row(stream, table->headers, 1);
+        table_emit_divider(stream, MD_BOX_T_RIGHT, MD_BOX_CROSS, MD_BOX_T_LEFT);
+        for (size_t r = 0; r < table->row_count; r++) {
+            table_emit_row(stream, table->rows[r], 0);
+        }
+        return;
+    }
+    
+    if (stream->table_relayouts < MD_TABLE_MAX_RELAYOUTS && table_relayout(stream, cells)) {
+        /* Mark the width change; rows above keep their old borders */
+        table_emit_divider(stream, MD_BOX_T_RIGHT, MD_BOX_CROSS, MD_BOX_T_LEFT);
+    }
+    table_emit_row(stream, cells, 0);
+}
+
+static void table_end(md_stream_t* stream) {
+    stream->state = MD_STATE_NORMAL;
+    if (!stream->pending_table) return;
+    
+    size_t col_count = stream->pending_table->data.table.col_count;
+    
+    if (stream->table_lines == 0) {
+        /* Buffered, or ended before the first draw */
+        md_render_block(&stream->renderer, stream->pending_table);
+    } else if ((stream->table_relayouts > 0 || stream->table_overflow) &&
+               can_redraw(stream, stream->table_lines, stream->table_max_width)) {
+        /* Finalize: replace the progressive frame with the exact layout */
+        char seq[32];
+        snprintf(seq, sizeof(seq), MD_CURSOR_UP_FMT, (int)stream->table_lines);
+        output(stream, seq);
+        output(stream, "\r" MD_CLEAR_BELOW);
+        md_render_block(&stream->renderer, stream->pending_table);
+    } else {
+        /* Widths never changed, or cannot redraw: just close the frame */
+        md_render_table_divider(&stream->renderer, stream->table_widths, col_count,
+                                MD_BOX_BOTTOM_LEFT, MD_BOX_T_UP, MD_BOX_BOTTOM_RIGHT);
+        output(stream, "\n");
+    }
+    
+    md_free_tokens(stream->pending_table);
+    stream->pending_table = NULL;
+    stream->table_lines = 0;
+}
+
+static void render_paragraph_line(md_stream_t* stream, const char* line) {
+    stream->in_list = 0;
+    md_inline_token_t* tokens = md_parse_inline(line);
+    render_and_free_inline(stream, tokens);
+    output(stream, "\n\n");
+}
+
+/*
+ * Table handling ahead of the other block types. Returns non-zero if the
+ * line was consumed as part of a table.
+ */
+static int table_line(md_stream_t* stream, const char* line, const md_line_t* info) {
+    if (stream->state == MD_STATE_TABLE) {
+        if (info->type == MD_LINE_TEXT && info->has_pipe) {
+            table_row(stream, line);
+            return 1;
+        }
+        table_end(stream);
+    } else if (stream->table_candidate) {
+        char* header = stream->table_candidate;
+        stream->table_candidate = NULL;
+        if (info->table_sep) {
+            table_begin(stream, header, line);
+            free(header);
+            return 1;
+        }
+        render_paragraph_line(stream, header);
+        free(header);
+    }
+    
+    /* A pipe line may be a table header: decide on the next line */
+    if (info->type == MD_LINE_TEXT && info->has_pipe && !stream->in_list) {
+        stream->table_candidate = md_strdup(line);
+        return stream->table_candidate != NULL;
+    }
+    return 0;
+}
+
 /* Process a complete line */
 static void process_line(md_stream_t* stream, const char* line) {
     if (!stream || !line) return;
     
     size_t len = strlen(line);
+    md_line_t info;
+    md_classify_line(line, len, &info);
+    
+    /* ---- Tables ---- */
+    if (stream->state != MD_STATE_CODE_BLOCK && table_line(stream, line, &info)) {
+        return;
+    }
     
     /* ---- Code block handling ---- */
-    if (strncmp(line, "```", 3) == 0) {
+    if (info.type == MD_LINE_FENCE) {
         if (stream->state != MD_STATE_CODE_BLOCK) {
-            /* Start code block */
-            stream->state = MD_STATE_CODE_BLOCK;
             stream->in_list = 0;
-            
-            /* Extract language */
-            free(stream->code_lang);
-            stream->code_lang = md_strdup(line + 3);
-            if (stream->code_lang) md_rtrim(stream->code_lang);
-            
-            /* Reset code buffer */
-            stream->code_buf_len = 0;
-            if (!stream->code_buffer) {
-                stream->code_buf_size = 256;
-                stream->code_buffer = (char*)malloc(stream->code_buf_size);
-            }
-            if (stream->code_buffer) stream->code_buffer[0] = '\0';
-            
-            /* We'll render the code block when it ends */
+            code_open(stream, line + info.content);
         } else {
-            /* End code block - render it now */
-            stream->state = MD_STATE_NORMAL;
-            
-            const char* lang = stream->code_lang && stream->code_lang[0] ? stream->code_lang : "code";
-            const char* code = stream->code_buffer ? stream->code_buffer : "";
-            
-            /* Calculate max line width */
-            int max_width = 0;
-            const char* p = code;
-            int current_width = 0;
-            while (*p) {
-                if (*p == '\n') {
-                    if (current_width > max_width) max_width = current_width;
-                    current_width = 0;
-                } else {
-                    int bytes;
-                    uint32_t cp = md_utf8_decode(p, &bytes);
-                    current_width += md_char_width(cp);
-                    p += bytes - 1;
-                }
-                p++;
-            }
-            if (current_width > max_width) max_width = current_width;
-            
-            /* Draw code block */
-            int lang_len = md_utf8_display_width(lang);
-            int content_width = max_width > lang_len ? max_width : lang_len;
-            int box_inner = content_width + 2;
-            
-            output(stream, MD_STYLE_BOLD);
-            output(stream, MD_COLOR_BRIGHT_YELLOW);
-            output(stream, MD_BOX_TOP_LEFT);
-            output(stream, MD_BOX_HORIZONTAL);
-            output(stream, " ");
-            output(stream, lang);
-            output(stream, " ");
-            int remaining = box_inner - lang_len - 3;
-            if (remaining > 0) {
-                output_n(stream, MD_BOX_HORIZONTAL, remaining);
-            }
-            output(stream, MD_BOX_TOP_RIGHT);
-            output(stream, MD_STYLE_RESET);
-            output(stream, "\n");
-            
-            p = code;
-            while (*p) {
-                output(stream, MD_COLOR_BRIGHT_YELLOW);
-                output(stream, MD_BOX_VERTICAL);
-                output(stream, " ");
-                output(stream, MD_STYLE_RESET);
-                
-                const char* line_start = p;
-                while (*p && *p != '\n') p++;
-                
-                int line_width = 0;
-                if (p > line_start) {
-                    char* code_line = md_strndup(line_start, p - line_start);
-                    if (code_line) {
-                        output(stream, code_line);
-                        line_width = md_utf8_display_width(code_line);
-                        free(code_line);
-                    }
-                }
-                
-                /* Pad and add right border */
-                int padding = content_width - line_width;
-                if (padding > 0) {
-                    output_n(stream, " ", padding);
-                }
-                output(stream, " ");
-                output(stream, MD_COLOR_BRIGHT_YELLOW);
-                output(stream, MD_BOX_VERTICAL);
-                output(stream, MD_STYLE_RESET);
-                output(stream, "\n");
-                if (*p == '\n') p++;
-            }
-            
-            output(stream, MD_COLOR_BRIGHT_YELLOW);
-            output(stream, MD_BOX_BOTTOM_LEFT);
-            output_n(stream, MD_BOX_HORIZONTAL, box_inner);
-            output(stream, MD_BOX_BOTTOM_RIGHT);
-            output(stream, MD_STYLE_RESET);
-            output(stream, "\n\n");
-            
-            free(stream->code_lang);
-            stream->code_lang = NULL;
+            code_close(stream);
         }
         return;
     }
     
     if (stream->state == MD_STATE_CODE_BLOCK) {
-        /* Accumulate code */
-        md_buffer_append(&stream->code_buffer, &stream->code_buf_size, &stream->code_buf_len, line);
-        md_buffer_append(&stream->code_buffer, &stream->code_buf_size, &stream->code_buf_len, "\n");
+        code_line(stream, line);
         return;
     }
     
     /* ---- Empty line ---- */
-    if (len == 0) {
+    if (info.type == MD_LINE_BLANK) {
         stream->in_list = 0;
         return;
     }
     
     /* ---- Heading ---- */
-    if (line[0] == '#') {
+    if (info.type == MD_LINE_HEADING) {
         stream->in_list = 0;
-        int level = 0;
-        const char* p = line;
-        while (*p == '#' && level < 6) {
-            level++;
-            p++;
-        }
-        if (*p == ' ') {
-            p++;
-            const char* color;
-            switch (level) {
-                case 1: color = MD_HEADING1_COLOR; break;
-                case 2: color = MD_HEADING2_COLOR; break;
-                case 3: color = MD_HEADING3_COLOR; break;
-                case 4: color = MD_HEADING4_COLOR; break;
-                case 5: color = MD_HEADING5_COLOR; break;
-                case 6: color = MD_HEADING6_COLOR; break;
-                default: color = MD_STYLE_BOLD; break;
-            }
-            output(stream, color);
-            output(stream, MD_STYLE_BOLD);
-            md_inline_token_t* content = md_parse_inline(p);
-            render_and_free_inline(stream, content);
-            output(stream, MD_STYLE_RESET);
-            output(stream, "\n\n");
-            return;
+        const char* color;
+        switch (info.level) {
+            case 1: color = MD_HEADING1_COLOR; break;
+            case 2: color = MD_HEADING2_COLOR; break;
+            case 3: color = MD_HEADING3_COLOR; break;
+            case 4: color = MD_HEADING4_COLOR; break;
+            case 5: color = MD_HEADING5_COLOR; break;
+            case 6: color = MD_HEADING6_COLOR; break;
+            default: color = MD_STYLE_BOLD; break;
         }
+        output(stream, color);
+        output(stream, MD_STYLE_BOLD);
+        md_inline_token_t* content = md_parse_inline(line + info.content);
+        render_and_free_inline(stream, content);
+        output(stream, MD_STYLE_RESET);
+        output(stream, "\n\n");
+        return;
     }
     
     /* ---- Horizontal rule ---- */
-    if ((strncmp(line, "---", 3) == 0 || strncmp(line, "***", 3) == 0 || strncmp(line, "___", 3) == 0)) {
-        /* Check if it's all the same character (possibly with spaces) */
-        char c = line[0];
-        int is_hr = 1;
-        int count = 0;
-        for (const char* p = line; *p; p++) {
-            if (*p == c) count++;
-            else if (*p != ' ' && *p != '\t') { is_hr = 0; break; }
-        }
-        if (is_hr && count >= 3) {
-            stream->in_list = 0;
-            output(stream, MD_COLOR_DARK_GRAY);
-            output_n(stream, "_", stream->renderer.term_width);
-            output(stream, MD_STYLE_RESET);
-            output(stream, "\n\n");
-            return;
-        }
+    if (info.type == MD_LINE_HR) {
+        stream->in_list = 0;
+        output(stream, MD_COLOR_DARK_GRAY);
+        output_n(stream, "_", stream->renderer.term_width);
+        output(stream, MD_STYLE_RESET);
+        output(stream, "\n\n");
+        return;
     }
     
     /* ---- Block quote ---- */
-    if (line[0] == '>') {
+    if (info.type == MD_LINE_QUOTE) {
         stream->in_list = 0;
-        const char* content = line + 1;
-        if (*content == ' ') content++;
         
         output(stream, MD_BG_DARK_GRAY);
         output(stream, MD_COLOR_LIGHT_GRAY);
         output(stream, "> ");
         output(stream, MD_STYLE_ITALIC);
-        md_inline_token_t* tokens = md_parse_inline(content);
+        md_inline_token_t* tokens = md_parse_inline(line + info.content);
         render_and_free_inline(stream, tokens);
         output(stream, MD_STYLE_RESET);
         output(stream, "\n\n");
@@ -330,11 +704,8 @@ static void process_line(md_stream_t* stream, const char* line) {
     }
     
     /* ---- Unordered list ---- */
-    const char* trimmed = md_ltrim(line);
-    if ((*trimmed == '-' || *trimmed == '*' || *trimmed == '+') && 
-        trimmed[1] == ' ') {
-        int indent = md_count_indent(line) / 2;
-        const char* content = trimmed + 2;
+    if (info.type == MD_LINE_BULLET) {
+        int indent = info.indent / 2;
         
         if (!stream->in_list) {
             stream->in_list = 1;
@@ -354,47 +725,39 @@ static void process_line(md_stream_t* stream, const char* line) {
         output(stream, bullet);
         output(stream, " ");
         
-        md_inline_token_t* tokens = md_parse_inline(content);
+        md_inline_token_t* tokens = md_parse_inline(line + info.content);
         render_and_free_inline(stream, tokens);
         output(stream, "\n");
         return;
     }
     
     /* ---- Ordered list ---- */
-    if (*trimmed >= '0' && *trimmed <= '9') {
-        const char* p = trimmed;
-        while (*p >= '0' && *p <= '9') p++;
-        if (*p == '.' && *(p+1) == ' ') {
-            int indent = md_count_indent(line) / 3;
-            const char* content = p + 2;
-            
-            if (!stream->in_list || stream->list_type != MD_LIST_ORDERED) {
-                stream->in_list = 1;
-                stream->list_type = MD_LIST_ORDERED;
-                stream->list_item_number = 1;
-            }
-            
-            /* Indentation */
-            output_n(stream, "  ", indent);
-            
-            /* Number */
-            char num_buf[16];
-            snprintf(num_buf, sizeof(num_buf), "%d. ", stream->list_item_number);
-            output(stream, num_buf);
-            stream->list_item_number++;
-            
-            md_inline_token_t* tokens = md_parse_inline(content);
-            render_and_free_inline(stream, tokens);
-            output(stream, "\n");
-            return;
+    if (info.type == MD_LINE_ORDERED) {
+        int indent = info.indent / 3;
+        
+        if (!stream->in_list || stream->list_type != MD_LIST_ORDERED) {
+            stream->in_list = 1;
+            stream->list_type = MD_LIST_ORDERED;
+            stream->list_item_number = 1;
         }
+        
+        /* Indentation */
+        output_n(stream, "  ", indent);
+        
+        /* Number */
+        char num_buf[16];
+        snprintf(num_buf, sizeof(num_buf), "%d. ", stream->list_item_number);
+        output(stream, num_buf);
+        stream->list_item_number++;
+        
+        md_inline_token_t* tokens = md_parse_inline(line + info.content);
+        render_and_free_inline(stream, tokens);
+        output(stream, "\n");
+        return;
     }
     
     /* ---- Default: Paragraph ---- */
-    stream->in_list = 0;
-    md_inline_token_t* tokens = md_parse_inline(line);
-    render_and_free_inline(stream, tokens);
-    output(stream, "\n\n");
+    render_paragraph_line(stream, line);
 }
 
 /* ========== Streaming interface ========== */
@@ -411,6 +774,7 @@ void md_stream_feed(md_stream_t* stream, const char* data, size_t len) {
                 stream->line_buffer[stream->line_buf_len] = '\0';
             }
             process_line(stream, stream->line_buffer ? stream->line_buffer : "");
+            md_outbuf_tick(&stream->out);
             
             /* Reset line buffer */
             stream->line_buf_len = 0;
@@ -421,6 +785,9 @@ void md_stream_feed(md_stream_t* stream, const char* data, size_t len) {
                                   &stream->line_buf_len, c);
         }
     }
+    
+    /* Output only comes from completed lines: hand them over in one write */
+    md_outbuf_flush(&stream->out);
 }
 
 void md_stream_feed_str(md_stream_t* stream, const char* str) {
@@ -440,10 +807,26 @@ void md_stream_finish(md_stream_t* stream) {
         stream->line_buf_len = 0;
     }
     
+    /* A held pipe line with nothing after it is a paragraph */
+    if (stream->table_candidate) {
+        render_paragraph_line(stream, stream->table_candidate);
+        free(stream->table_candidate);
+        stream->table_candidate = NULL;
+    }
+    
+    if (stream->state == MD_STATE_TABLE) {
+        table_end(stream);
+    }
+    
     /* If we're in an unclosed code block, render what we have */
-    if (stream->state == MD_STATE_CODE_BLOCK && stream->code_buffer) {
-        output(stream, stream->code_buffer);
+    if (stream->state == MD_STATE_CODE_BLOCK) {
+        if (stream->code_block_mode == MD_CODE_STREAM) {
+            code_close(stream);
+        } else if (stream->code_buffer) {
+            output(stream, stream->code_buffer);
+        }
     }
     
     stream->state = MD_STATE_NORMAL;
+    md_outbuf_flush(&stream->out);
 }
@@ -19,6 +19,22 @@ extern "C" {
  */
 typedef struct md_stream md_stream_t;
 
+/**
+ * Fenced code block rendering mode
+ */
+typedef enum {
+    MD_CODE_STREAM,         /* Emit each code line as soon as it completes */
+    MD_CODE_BUFFERED        /* Render the whole block at the closing fence */
+} md_code_mode_t;
+
+/**
+ * Table rendering mode
+ */
+typedef enum {
+    MD_TABLE_PROGRESSIVE,   /* Emit each row as soon as it completes (default) */
+    MD_TABLE_BUFFERED       /* Render the whole table when it ends */
+} md_table_mode_t;
+
 /**
  * Create a new stream context
  * @return New stream context, or NULL on failure
@@ -33,6 +49,69 @@ md_stream_t* md_stream_new(void);
  */
 void md_stream_set_output(md_stream_t* stream, md_output_fn output, void* userdata);
 
+/**
+ * Set when buffered output is handed to the output callback
+ *
+ * Rendered output is batched: besides at the end of every
+ * md_stream_feed() call and in md_stream_finish(), the buffer is flushed
+ * once it holds max_bytes, or when a line completes max_delay_ms after
+ * the previous flush. Defaults: 16 KiB and 16 ms.
+ *
+ * @param stream Stream context
+ * @param max_bytes Size threshold (0 = flush on every write)
+ * @param max_delay_ms Time threshold (0 = none)
+ */
+void md_stream_set_flush_policy(md_stream_t* stream, size_t max_bytes, int max_delay_ms);
+
+/**
+ * Hand any buffered output to the output callback now
+ * @param stream Stream context
+ */
+void md_stream_flush(md_stream_t* stream);
+
+/**
+ * Set how fenced code blocks are rendered
+ *
+ * In MD_CODE_STREAM mode each line is drawn with its left border as soon
+ * as it arrives. The box width is only known at the closing fence; with
+ * cursor control the top border and right edge are then redrawn so the
+ * result is identical to MD_CODE_BUFFERED. Without it the box is left
+ * open on the right.
+ *
+ * Default: MD_CODE_STREAM when cursor control is available (see
+ * md_stream_set_cursor_control()), MD_CODE_BUFFERED otherwise.
+ *
+ * @param stream Stream context
+ * @param mode Rendering mode
+ */
+void md_stream_set_code_mode(md_stream_t* stream, md_code_mode_t mode);
+
+/**
+ * Set how tables are rendered
+ *
+ * In MD_TABLE_PROGRESSIVE mode the first few rows are held back to size the
+ * columns, then the frame is drawn and every later row is emitted as soon as
+ * it completes. A row that does not fit widens its columns with some slack,
+ * marked by an extra divider; after a few such re-layouts cells simply
+ * overflow. With cursor control a table that was re-laid out is redrawn at
+ * its end so the result is identical to MD_TABLE_BUFFERED.
+ *
+ * @param stream Stream context
+ * @param mode Rendering mode
+ */
+void md_stream_set_table_mode(md_stream_t* stream, md_table_mode_t mode);
+
+/**
+ * Allow or forbid cursor movement sequences in the output
+ *
+ * Default: enabled only when writing to stdout and stdout is a terminal.
+ * Enable explicitly when an output callback forwards to a terminal.
+ *
+ * @param stream Stream context
+ * @param enabled 1 to allow, 0 to forbid
+ */
+void md_stream_set_cursor_control(md_stream_t* stream, int enabled);
+
 /**
  * Feed data to the stream
  * Data will be parsed and rendered incrementally as complete lines are received.
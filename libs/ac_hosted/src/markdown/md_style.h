@@ -75,6 +75,12 @@ extern "C" {
 #define MD_HYPERLINK_SEP     "\033\\"
 #define MD_HYPERLINK_END     "\033]8;;\033\\"
 
+/* ========== Cursor control (printf formats take a count) ========== */
+#define MD_CURSOR_UP_FMT     "\033[%dA"
+#define MD_CURSOR_COLUMN_FMT "\033[%dG"
+#define MD_CLEAR_LINE        "\033[2K"
+#define MD_CLEAR_BELOW       "\033[J"
+
 /* ========== Box drawing characters (UTF-8) ========== */
 #define MD_BOX_TOP_LEFT      "┌"
 #define MD_BOX_TOP_RIGHT     "┐"
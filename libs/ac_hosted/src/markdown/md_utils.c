@@ -4,6 +4,7 @@
  */
 
 #include "md_utils.h"
+#include "md_width_table.h"
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
@@ -33,6 +34,22 @@ int md_get_terminal_width(void) {
 #endif
 }
 
+int md_get_terminal_height(void) {
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi)) {
+        return csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
+    }
+    return 0;
+#else
+    struct winsize w;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0 && w.ws_row > 0) {
+        return w.ws_row;
+    }
+    return 0;
+#endif
+}
+
 int md_supports_hyperlink(void) {
     const char* term_program = getenv("TERM_PROGRAM");
     const char* term = getenv("TERM");
@@ -111,56 +128,129 @@ uint32_t md_utf8_decode(const char* str, int* bytes_read) {
     return codepoint;
 }
 
+/* Width classes from md_width_table.h */
+#define WIDTH_ZERO          0
+#define WIDTH_NARROW        1
+#define WIDTH_WIDE          2
+#define WIDTH_EMOJI_TEXT    3   /* Narrow, wide when followed by VS16 */
+
+#define CP_ZWJ              0x200D
+#define CP_VS16             0xFE0F
+
+static inline int width_class(uint32_t cp) {
+    if (cp >= 0x110000) return WIDTH_NARROW;
+    uint8_t packed = s_width_blocks[s_width_stage1[cp >> 8]][(cp & 0xFF) >> 2];
+    return (packed >> ((cp & 3) * 2)) & 3;
+}
+
 int md_char_width(uint32_t codepoint) {
-    /* Zero-width characters */
-    if (codepoint == 0 ||
-        (codepoint >= 0x0300 && codepoint <= 0x036F) ||  /* Combining diacritical */
-        (codepoint >= 0x200B && codepoint <= 0x200F) ||  /* Zero-width space, etc. */
-        (codepoint >= 0x2060 && codepoint <= 0x206F) ||  /* Word joiner, etc. */
-        (codepoint >= 0xFE00 && codepoint <= 0xFE0F) ||  /* Variation selectors */
-        (codepoint >= 0xFE20 && codepoint <= 0xFE2F)) {  /* Combining half marks */
-        return 0;
-    }
+    if (codepoint == 0) return 0;
+    int cls = width_class(codepoint);
+    return cls == WIDTH_EMOJI_TEXT ? 1 : cls;
+}
+
+/* Keycap sequences ("1" VS16 U+20E3) start with one of these */
+static inline int is_keycap_base(unsigned char c) {
+    return (c >= '0' && c <= '9') || c == '#' || c == '*';
+}
+
+/* Bounded decode: never reads past `end`; invalid input yields U+FFFD */
+static inline uint32_t decode_n(const unsigned char* s, const unsigned char* end, int* bytes_read) {
+    uint32_t cp;
+    int len;
     
-    /* Wide characters (CJK, fullwidth forms, etc.) */
-    if ((codepoint >= 0x1100 && codepoint <= 0x115F) ||   /* Hangul Jamo */
-        (codepoint >= 0x2E80 && codepoint <= 0x9FFF) ||   /* CJK */
-        (codepoint >= 0xAC00 && codepoint <= 0xD7A3) ||   /* Hangul syllables */
-        (codepoint >= 0xF900 && codepoint <= 0xFAFF) ||   /* CJK Compatibility */
-        (codepoint >= 0xFE10 && codepoint <= 0xFE1F) ||   /* Vertical forms */
-        (codepoint >= 0xFE30 && codepoint <= 0xFE6F) ||   /* CJK Compatibility Forms */
-        (codepoint >= 0xFF00 && codepoint <= 0xFF60) ||   /* Fullwidth forms */
-        (codepoint >= 0xFFE0 && codepoint <= 0xFFE6) ||   /* Fullwidth signs */
-        (codepoint >= 0x20000 && codepoint <= 0x2FFFD) || /* CJK Extension B-F */
-        (codepoint >= 0x30000 && codepoint <= 0x3FFFD)) { /* CJK Extension G+ */
-        return 2;
+    if ((s[0] & 0xE0) == 0xC0) {
+        len = 2;
+        cp = s[0] & 0x1F;
+    } else if ((s[0] & 0xF0) == 0xE0) {
+        len = 3;
+        cp = s[0] & 0x0F;
+    } else if ((s[0] & 0xF8) == 0xF0) {
+        len = 4;
+        cp = s[0] & 0x07;
+    } else {
+        *bytes_read = 1;
+        return 0xFFFD;
     }
     
-    /* Emoji (most are wide) */
-    if ((codepoint >= 0x1F300 && codepoint <= 0x1F9FF) || /* Misc Symbols, Emoticons */
-        (codepoint >= 0x1FA00 && codepoint <= 0x1FAFF)) { /* Chess, Extended-A */
-        return 2;
+    for (int i = 1; i < len; i++) {
+        if (s + i >= end || (s[i] & 0xC0) != 0x80) {
+            *bytes_read = i;
+            return 0xFFFD;
+        }
+        cp = (cp << 6) | (s[i] & 0x3F);
     }
     
-    return 1;
+    *bytes_read = len;
+    return cp;
 }
 
-int md_utf8_display_width(const char* str) {
+int md_utf8_display_width_n(const char* str, size_t len) {
     if (!str) return 0;
     
+    const unsigned char* s = (const unsigned char*)str;
+    const unsigned char* end = s + len;
     int width = 0;
-    int bytes;
+    int prev = WIDTH_ZERO;      /* Class of the last visible code point */
+    int joining = 0;            /* Last code point was a ZWJ after an emoji */
     
-    while (*str) {
-        uint32_t cp = md_utf8_decode(str, &bytes);
-        if (bytes == 0) break;
-        width += md_char_width(cp);
-        str += bytes;
+    while (s < end) {
+        if (*s < 0x80) {
+            /* ASCII: 8 bytes at a time while no byte has the high bit set */
+            const unsigned char* start = s;
+            while (end - s >= 8) {
+                uint64_t word;
+                memcpy(&word, s, 8);
+                if (word & 0x8080808080808080ULL) break;
+                s += 8;
+            }
+            while (s < end && *s < 0x80) s++;
+            
+            width += (int)(s - start);
+            prev = is_keycap_base(s[-1]) ? WIDTH_EMOJI_TEXT : WIDTH_NARROW;
+            joining = 0;
+            continue;
+        }
+        
+        int bytes;
+        uint32_t cp = decode_n(s, end, &bytes);
+        s += bytes;
+        
+        if (cp == CP_VS16) {
+            /* Emoji presentation selector widens a text-style emoji */
+            if (prev == WIDTH_EMOJI_TEXT) {
+                width++;
+                prev = WIDTH_WIDE;
+            }
+            continue;
+        }
+        if (cp == CP_ZWJ) {
+            joining = prev == WIDTH_WIDE;
+            continue;
+        }
+        
+        int cls = width_class(cp);
+        if (cls == WIDTH_ZERO) continue;
+        
+        if (joining || (cp >= 0x1F3FB && cp <= 0x1F3FF && prev == WIDTH_WIDE)) {
+            /* Part of a ZWJ sequence, or a skin tone modifier: same glyph */
+            prev = WIDTH_WIDE;
+            joining = 0;
+            continue;
+        }
+        
+        width += cls == WIDTH_EMOJI_TEXT ? 1 : cls;
+        prev = cls;
     }
     
     return width;
 }
 
+int md_utf8_display_width(const char* str) {
+    if (!str) return 0;
+    return md_utf8_display_width_n(str, strlen(str));
+}
+
 /* ========== String utilities ========== */
 
 char* md_strdup(const char* str) {
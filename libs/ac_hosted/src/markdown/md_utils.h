@@ -19,6 +19,12 @@ extern "C" {
  */
 int md_get_terminal_width(void);
 
+/**
+ * Get terminal height
+ * @return Terminal height in rows, or 0 if stdout is not a terminal
+ */
+int md_get_terminal_height(void);
+
 /**
  * Check if terminal supports OSC 8 hyperlinks
  * @return 1 if supported, 0 otherwise
@@ -47,6 +53,16 @@ int md_char_width(uint32_t codepoint);
  */
 int md_utf8_display_width(const char* str);
 
+/**
+ * Calculate display width of a UTF-8 string of known length
+ * Emoji ZWJ sequences, skin tone modifiers and VS16 presentation
+ * selectors are counted as the single glyph terminals draw.
+ * @param str UTF-8 text (need not be NUL-terminated)
+ * @param len Length in bytes
+ * @return Display width in terminal columns
+ */
+int md_utf8_display_width_n(const char* str, size_t len);
+
 /**
  * Duplicate a string
  * @param str Source string
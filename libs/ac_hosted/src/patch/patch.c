@@ -0,0 +1,1208 @@
+/**
+ * @file patch.c
+ * @brief Atomic multi-file edits: string replacements and unified diffs
+ *
+ * Staged files keep their on-disk contents (for conflict checks and
+ * rollback) next to the edited contents. A diff is applied to private
+ * copies first and only installed once every hunk of every file has
+ * been placed.
+ *
+ * Hunk search works on a line table of the file: each line carries an
+ * exact hash and a hash with all whitespace removed, so candidate
+ * positions are rejected without touching the text.
+ */
+
+#include <arc/patch.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#else
+#include <direct.h>
+#include <io.h>
+#include <process.h>
+#define mkdir(path, mode) _mkdir(path)
+#define getpid _getpid
+#endif
+
+#define PATCH_MAX_FUZZ 2
+#define PATCH_ERROR_SIZE 512
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+typedef struct {
+    char *path;                         /* Resolved path (reported) */
+    char *write_path;                   /* Symlink target, or path */
+    int existed;                        /* On disk when staged */
+    char *original;                     /* On-disk contents */
+    size_t original_len;
+    off_t size;                         /* Conflict check */
+    int64_t mtime_ns;
+    mode_t mode;
+
+    char *content;                      /* Staged contents */
+    size_t len;
+    int deleted;
+
+    size_t changes;
+    size_t fuzzy;
+    size_t added;
+    size_t removed;
+
+    char *tmp_path;                     /* During commit */
+    int replaced;                       /* Renamed or unlinked during commit */
+} staged_file_t;
+
+struct ac_patch {
+    char *base_dir;
+    ac_textfile_cache_t *cache;         /* Optional */
+    ac_patch_path_check_t check;        /* Optional */
+    void *check_data;
+    staged_file_t *files;
+    size_t count;
+    size_t cap;
+    int committed;
+    char error[PATCH_ERROR_SIZE];
+};
+
+static arc_err_t fail(ac_patch_t *p, arc_err_t err, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(p->error, sizeof(p->error), fmt, ap);
+    va_end(ap);
+    return err;
+}
+
+static int64_t stat_mtime_ns(const struct stat *st) {
+#if defined(__APPLE__)
+    return (int64_t)st->st_mtimespec.tv_sec * 1000000000 + st->st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    return (int64_t)st->st_mtime * 1000000000;
+#else
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+static size_t count_lines(const char *s, size_t len) {
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) n += s[i] == '\n';
+    return n + (len > 0 && s[len - 1] != '\n');
+}
+
+/*============================================================================
+ * Staged Files
+ *============================================================================*/
+
+static void staged_free(staged_file_t *f) {
+    free(f->path);
+    free(f->write_path);
+    free(f->original);
+    free(f->content);
+    free(f->tmp_path);
+}
+
+static char *resolve(const ac_patch_t *p, const char *path) {
+    size_t len = strlen(path);
+    int absolute = path[0] == '/';
+#if defined(_WIN32)
+    absolute = absolute || path[0] == '\\' || (len > 1 && path[1] == ':');
+#endif
+    if (absolute || !p->base_dir) return strdup(path);
+
+    size_t base = strlen(p->base_dir);
+    char *out = malloc(base + len + 2);
+    if (!out) return NULL;
+    memcpy(out, p->base_dir, base);
+    out[base] = '/';
+    memcpy(out + base + 1, path, len + 1);
+    return out;
+}
+
+static arc_err_t read_all(const char *path, char **out, size_t *out_len) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return ARC_ERR_IO;
+    size_t cap = 65536, len = 0;
+    char *buf = malloc(cap);
+    while (buf) {
+        len += fread(buf + len, 1, cap - len, fp);
+        if (len < cap) break;
+        char *grown = realloc(buf, cap * 2);
+        if (!grown) {
+            free(buf);
+            buf = NULL;
+            break;
+        }
+        buf = grown;
+        cap *= 2;
+    }
+    int error = ferror(fp);
+    fclose(fp);
+    if (!buf) return ARC_ERR_NO_MEMORY;
+    if (error) {
+        free(buf);
+        return ARC_ERR_IO;
+    }
+    *out = buf;
+    *out_len = len;
+    return ARC_OK;
+}
+
+static arc_err_t read_cached(ac_textfile_cache_t *cache, const char *path, char **out, size_t *out_len) {
+    ac_textfile_t *file;
+    arc_err_t err = ac_textfile_open(cache, path, &file);
+    if (err != ARC_OK) return err;
+    size_t len = ac_textfile_size(file);
+    char *buf = malloc(len + 1);
+    if (buf) memcpy(buf, ac_textfile_data(file), len);
+    ac_textfile_release(file);
+    if (!buf) return ARC_ERR_NO_MEMORY;
+    *out = buf;
+    *out_len = len;
+    return ARC_OK;
+}
+
+/* Staged entry for a path, read from disk on first use */
+static arc_err_t stage(ac_patch_t *p, const char *path, staged_file_t **out) {
+    char *resolved = resolve(p, path);
+    if (!resolved) return fail(p, ARC_ERR_NO_MEMORY, "out of memory");
+
+    for (size_t i = 0; i < p->count; i++) {
+        if (strcmp(p->files[i].path, resolved) == 0) {
+            free(resolved);
+            *out = &p->files[i];
+            return ARC_OK;
+        }
+    }
+
+    if (p->check && !p->check(resolved, p->check_data)) {
+        free(resolved);
+        return fail(p, ARC_ERR_INVALID_ARG, "access to %s refused", path);
+    }
+
+    if (p->count == p->cap) {
+        size_t cap = p->cap ? p->cap * 2 : 8;
+        staged_file_t *files = realloc(p->files, cap * sizeof(*files));
+        if (!files) {
+            free(resolved);
+            return fail(p, ARC_ERR_NO_MEMORY, "out of memory");
+        }
+        p->files = files;
+        p->cap = cap;
+    }
+    staged_file_t *f = &p->files[p->count];
+    memset(f, 0, sizeof(*f));
+    f->path = resolved;
+
+    struct stat st;
+    if (stat(resolved, &st) == 0) {
+        if (!S_ISREG(st.st_mode)) {
+            staged_free(f);
+            return fail(p, ARC_ERR_INVALID_ARG, "%s is not a regular file", path);
+        }
+        arc_err_t err = ARC_ERR_IO;
+        if (p->cache) {
+            /* Only contents of the size just seen can belong to this stat */
+            err = read_cached(p->cache, resolved, &f->original, &f->original_len);
+            if (err == ARC_OK && f->original_len != (size_t)st.st_size) {
+                free(f->original);
+                f->original = NULL;
+                err = ARC_ERR_IO;
+            }
+        }
+        if (err != ARC_OK) err = read_all(resolved, &f->original, &f->original_len);
+        if (err != ARC_OK) {
+            staged_free(f);
+            return fail(p, err, "cannot read %s", path);
+        }
+        f->existed = 1;
+        f->size = st.st_size;
+        f->mtime_ns = stat_mtime_ns(&st);
+        f->mode = st.st_mode & 07777;
+    }
+
+    /* Replacing a symlink would turn it into a regular file */
+#if !defined(_WIN32)
+    struct stat lst;
+    if (f->existed && lstat(resolved, &lst) == 0 && S_ISLNK(lst.st_mode)) {
+        f->write_path = realpath(resolved, NULL);
+    }
+#endif
+    if (!f->write_path) f->write_path = strdup(resolved);
+
+    f->content = malloc(f->original_len + 1);
+    if (!f->write_path || !f->content) {
+        staged_free(f);
+        return fail(p, ARC_ERR_NO_MEMORY, "out of memory");
+    }
+    if (f->original_len) memcpy(f->content, f->original, f->original_len);
+    f->len = f->original_len;
+
+    p->count++;
+    *out = f;
+    return ARC_OK;
+}
+
+/* Drop entries staged after a failed operation began */
+static void unstage_from(ac_patch_t *p, size_t count) {
+    while (p->count > count) staged_free(&p->files[--p->count]);
+}
+
+static int file_present(const staged_file_t *f) {
+    return (f->existed || f->changes > 0) && !f->deleted;
+}
+
+/*============================================================================
+ * Replacements
+ *============================================================================*/
+
+static const char *find(const char *hay, size_t hay_len, const char *needle, size_t len) {
+    if (len == 0 || len > hay_len) return NULL;
+    const char *end = hay + hay_len - len;
+    for (const char *s = hay; s <= end; s++) {
+        s = memchr(s, needle[0], (size_t)(end - s) + 1);
+        if (!s) return NULL;
+        if (memcmp(s, needle, len) == 0) return s;
+    }
+    return NULL;
+}
+
+arc_err_t ac_patch_replace(
+    ac_patch_t *patch,
+    const char *path,
+    const char *old_str,
+    const char *new_str,
+    int replace_all,
+    size_t *replacements
+) {
+    if (replacements) *replacements = 0;
+    if (!patch || !path || !old_str || !new_str) return ARC_ERR_INVALID_ARG;
+    if (patch->committed) return fail(patch, ARC_ERR_INVALID_STATE, "patch already committed");
+    patch->error[0] = '\0';
+    if (strcmp(old_str, new_str) == 0) {
+        return fail(patch, ARC_ERR_INVALID_ARG, "oldString and newString must be different");
+    }
+
+    size_t before = patch->count;
+    staged_file_t *f;
+    arc_err_t err = stage(patch, path, &f);
+    if (err != ARC_OK) return err;
+
+    size_t old_len = strlen(old_str), new_len = strlen(new_str);
+
+    /* Empty old string: create the file */
+    if (old_len == 0) {
+        if (file_present(f) && f->len > 0) {
+            unstage_from(patch, before);
+            return fail(patch, ARC_ERR_INVALID_ARG, "%s already exists", path);
+        }
+        char *content = malloc(new_len + 1);
+        if (!content) {
+            unstage_from(patch, before);
+            return fail(patch, ARC_ERR_NO_MEMORY, "out of memory");
+        }
+        memcpy(content, new_str, new_len);
+        free(f->content);
+        f->content = content;
+        f->len = new_len;
+        f->deleted = 0;
+        f->changes++;
+        f->added += count_lines(new_str, new_len);
+        if (replacements) *replacements = 1;
+        return ARC_OK;
+    }
+
+    if (!file_present(f)) {
+        unstage_from(patch, before);
+        return fail(patch, ARC_ERR_NOT_FOUND, "file not found: %s", path);
+    }
+
+    size_t count = 0;
+    for (const char *s = f->content; (s = find(s, f->len - (size_t)(s - f->content), old_str, old_len));
+         s += old_len) {
+        count++;
+    }
+    if (count == 0) {
+        unstage_from(patch, before);
+        return fail(patch, ARC_ERR_NOT_FOUND, "oldString not found in %s", path);
+    }
+    if (count > 1 && !replace_all) {
+        unstage_from(patch, before);
+        return fail(patch, ARC_ERR_INVALID_ARG, "oldString found %zu times in %s", count, path);
+    }
+
+    size_t len = f->len - count * old_len + count * new_len;
+    char *out = malloc(len + 1);
+    if (!out) {
+        unstage_from(patch, before);
+        return fail(patch, ARC_ERR_NO_MEMORY, "out of memory");
+    }
+    char *dst = out;
+    const char *src = f->content, *end = f->content + f->len;
+    const char *hit;
+    while ((hit = find(src, (size_t)(end - src), old_str, old_len)) != NULL) {
+        memcpy(dst, src, (size_t)(hit - src));
+        dst += hit - src;
+        memcpy(dst, new_str, new_len);
+        dst += new_len;
+        src = hit + old_len;
+        if (!replace_all) break;
+    }
+    memcpy(dst, src, (size_t)(end - src));
+
+    free(f->content);
+    f->content = out;
+    f->len = len;
+    f->changes++;
+    f->removed += count * count_lines(old_str, old_len);
+    f->added += count * count_lines(new_str, new_len);
+    if (replacements) *replacements = count;
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Line Tables
+ *============================================================================*/
+
+typedef struct {
+    const char *text;                   /* Without line ending */
+    size_t len;
+    size_t raw_len;                     /* With line ending */
+    uint64_t hash;
+    uint64_t loose;                     /* Whitespace removed */
+} line_t;
+
+typedef struct {
+    line_t *lines;
+    size_t count;
+} line_table_t;
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static void hash_line(line_t *l) {
+    uint64_t h = 1469598103934665603ULL, loose = 1469598103934665603ULL;
+    for (size_t i = 0; i < l->len; i++) {
+        unsigned char c = (unsigned char)l->text[i];
+        h = (h ^ c) * 1099511628211ULL;
+        if (!is_space((char)c)) loose = (loose ^ c) * 1099511628211ULL;
+    }
+    l->hash = h;
+    l->loose = loose;
+}
+
+static int split_lines(const char *data, size_t len, line_table_t *t) {
+    t->count = count_lines(data, len);
+    t->lines = malloc((t->count ? t->count : 1) * sizeof(line_t));
+    if (!t->lines) return -1;
+    size_t n = 0;
+    for (size_t i = 0; i < len; n++) {
+        const char *nl = memchr(data + i, '\n', len - i);
+        size_t end = nl ? (size_t)(nl - data) : len;
+        line_t *l = &t->lines[n];
+        l->text = data + i;
+        l->len = end - i;
+        l->raw_len = (nl ? end + 1 : end) - i;
+        if (l->len > 0 && l->text[l->len - 1] == '\r') l->len--;
+        hash_line(l);
+        i += l->raw_len;
+    }
+    return 0;
+}
+
+static int loose_equal(const line_t *a, const line_t *b) {
+    size_t i = 0, j = 0;
+    for (;;) {
+        while (i < a->len && is_space(a->text[i])) i++;
+        while (j < b->len && is_space(b->text[j])) j++;
+        if (i == a->len || j == b->len) return i == a->len && j == b->len;
+        if (a->text[i++] != b->text[j++]) return 0;
+    }
+}
+
+/*============================================================================
+ * Diff Parsing
+ *============================================================================*/
+
+typedef struct {
+    char op;                            /* ' ', '-' or '+' */
+    line_t line;
+    int no_newline;                     /* Followed by "\ No newline at end of file" */
+} hunk_line_t;
+
+typedef struct {
+    size_t old_start;
+    size_t old_count;
+    size_t new_count;
+    hunk_line_t *lines;
+    size_t count;
+} hunk_t;
+
+typedef struct {
+    char *old_path;                     /* NULL = /dev/null */
+    char *new_path;
+    hunk_t *hunks;
+    size_t count;
+} file_diff_t;
+
+static void diffs_free(file_diff_t *diffs, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        for (size_t h = 0; h < diffs[i].count; h++) free(diffs[i].hunks[h].lines);
+        free(diffs[i].hunks);
+        free(diffs[i].old_path);
+        free(diffs[i].new_path);
+    }
+    free(diffs);
+}
+
+static int starts_with(const line_t *l, const char *prefix) {
+    size_t n = strlen(prefix);
+    return l->len >= n && memcmp(l->text, prefix, n) == 0;
+}
+
+/* Path from a "--- " / "+++ " line; NULL text means /dev/null */
+static int header_path(const line_t *l, int git, const ac_patch_t *p, char **out) {
+    const char *s = l->text + 4;
+    size_t len = l->len - 4;
+    while (len > 0 && (*s == ' ')) { s++; len--; }
+    const char *tab = memchr(s, '\t', len);           /* Timestamp */
+    if (tab) len = (size_t)(tab - s);
+    while (len > 0 && s[len - 1] == ' ') len--;
+    if (len >= 2 && s[0] == '"' && s[len - 1] == '"') { s++; len -= 2; }
+
+    *out = NULL;
+    if (len == 9 && memcmp(s, "/dev/null", 9) == 0) return 0;
+    if (len == 0) return -1;
+
+    /* git's a/ and b/ prefixes; for plain diffs only if no such directory exists */
+    if (len > 2 && (s[0] == 'a' || s[0] == 'b') && s[1] == '/') {
+        int strip = git;
+        if (!strip) {
+            char dir[2] = { s[0], '\0' };
+            char *full = resolve(p, dir);
+            struct stat st;
+            strip = !full || stat(full, &st) != 0 || !S_ISDIR(st.st_mode);
+            free(full);
+        }
+        if (strip) { s += 2; len -= 2; }
+    }
+    *out = malloc(len + 1);
+    if (!*out) return -1;
+    memcpy(*out, s, len);
+    (*out)[len] = '\0';
+    return 0;
+}
+
+static int parse_range(const char **s, const char *end, size_t *start, size_t *count) {
+    const char *p = *s;
+    if (p >= end || *p < '0' || *p > '9') return -1;
+    *start = 0;
+    while (p < end && *p >= '0' && *p <= '9') *start = *start * 10 + (size_t)(*p++ - '0');
+    *count = 1;
+    if (p < end && *p == ',') {
+        p++;
+        if (p >= end || *p < '0' || *p > '9') return -1;
+        *count = 0;
+        while (p < end && *p >= '0' && *p <= '9') *count = *count * 10 + (size_t)(*p++ - '0');
+    }
+    *s = p;
+    return 0;
+}
+
+static int parse_hunk_header(const line_t *l, hunk_t *h) {
+    const char *s = l->text + 2, *end = l->text + l->len;
+    size_t new_start;
+    while (s < end && *s == ' ') s++;
+    if (s >= end || *s++ != '-' || parse_range(&s, end, &h->old_start, &h->old_count) != 0) return -1;
+    while (s < end && *s == ' ') s++;
+    if (s >= end || *s++ != '+' || parse_range(&s, end, &new_start, &h->new_count) != 0) return -1;
+    return 0;
+}
+
+static int is_file_header(const line_table_t *t, size_t i) {
+    return starts_with(&t->lines[i], "--- ") && i + 1 < t->count &&
+           starts_with(&t->lines[i + 1], "+++ ");
+}
+
+static arc_err_t parse_diff(ac_patch_t *p, const char *diff, file_diff_t **out, size_t *out_count) {
+    line_table_t t;
+    if (split_lines(diff, strlen(diff), &t) != 0) return fail(p, ARC_ERR_NO_MEMORY, "out of memory");
+
+    file_diff_t *diffs = NULL;
+    size_t count = 0, cap = 0;
+    int git = 0;
+    arc_err_t err = ARC_OK;
+
+    size_t i = 0;
+    while (i < t.count && err == ARC_OK) {
+        const line_t *l = &t.lines[i];
+        if (starts_with(l, "diff --git ")) {
+            git = 1;
+            i++;
+            continue;
+        }
+        if (!is_file_header(&t, i)) {
+            i++;                        /* Preamble, "index ...", mode lines */
+            continue;
+        }
+
+        if (count == cap) {
+            cap = cap ? cap * 2 : 4;
+            file_diff_t *grown = realloc(diffs, cap * sizeof(*diffs));
+            if (!grown) {
+                err = fail(p, ARC_ERR_NO_MEMORY, "out of memory");
+                break;
+            }
+            diffs = grown;
+        }
+        file_diff_t *d = &diffs[count++];
+        memset(d, 0, sizeof(*d));
+        if (header_path(&t.lines[i], git, p, &d->old_path) != 0 ||
+            header_path(&t.lines[i + 1], git, p, &d->new_path) != 0 ||
+            (!d->old_path && !d->new_path)) {
+            err = fail(p, ARC_ERR_PARSE, "invalid file header at diff line %zu", i + 1);
+            break;
+        }
+        i += 2;
+
+        while (i < t.count && err == ARC_OK && starts_with(&t.lines[i], "@@")) {
+            hunk_t h;
+            memset(&h, 0, sizeof(h));
+            if (parse_hunk_header(&t.lines[i], &h) != 0) {
+                err = fail(p, ARC_ERR_PARSE, "invalid hunk header at diff line %zu", i + 1);
+                break;
+            }
+            size_t first = ++i;
+
+            /* Body: until the next header; counts are often wrong in hand-written diffs */
+            while (i < t.count) {
+                const line_t *b = &t.lines[i];
+                if (starts_with(b, "@@") || starts_with(b, "diff ") || is_file_header(&t, i)) break;
+                if (b->len > 0 && b->text[0] != ' ' && b->text[0] != '-' &&
+                    b->text[0] != '+' && b->text[0] != '\\') break;
+                i++;
+            }
+            h.lines = malloc((i - first + 1) * sizeof(hunk_line_t));
+            if (!h.lines) {
+                err = fail(p, ARC_ERR_NO_MEMORY, "out of memory");
+                break;
+            }
+            size_t olds = 0, news = 0;
+            for (size_t k = first; k < i; k++) {
+                const line_t *b = &t.lines[k];
+                if (b->len > 0 && b->text[0] == '\\') {
+                    if (h.count > 0) h.lines[h.count - 1].no_newline = 1;
+                    continue;
+                }
+                hunk_line_t *hl = &h.lines[h.count++];
+                hl->op = b->len > 0 ? b->text[0] : ' ';     /* Blank: stripped context */
+                hl->no_newline = 0;
+                hl->line.text = b->len > 0 ? b->text + 1 : b->text;
+                hl->line.len = b->len > 0 ? b->len - 1 : 0;
+                hl->line.raw_len = hl->line.len;
+                hash_line(&hl->line);
+                olds += hl->op != '+';
+                news += hl->op != '-';
+            }
+            /* Trailing blank lines past the stated counts are not part of the hunk */
+            while (h.count > 0 && olds > h.old_count && news > h.new_count &&
+                   h.lines[h.count - 1].op == ' ' && h.lines[h.count - 1].line.len == 0) {
+                h.count--;
+                olds--;
+                news--;
+            }
+            if (h.count == 0) {
+                free(h.lines);
+                err = fail(p, ARC_ERR_PARSE, "empty hunk at diff line %zu", first);
+                break;
+            }
+
+            hunk_t *grown = realloc(d->hunks, (d->count + 1) * sizeof(hunk_t));
+            if (!grown) {
+                free(h.lines);
+                err = fail(p, ARC_ERR_NO_MEMORY, "out of memory");
+                break;
+            }
+            d->hunks = grown;
+            d->hunks[d->count++] = h;
+        }
+        if (err == ARC_OK && d->count == 0 && d->old_path && d->new_path &&
+            strcmp(d->old_path, d->new_path) == 0) {
+            err = fail(p, ARC_ERR_PARSE, "no hunks for %s", d->new_path);
+        }
+    }
+    if (err == ARC_OK && count == 0) err = fail(p, ARC_ERR_PARSE, "no file headers (--- / +++) in diff");
+
+    /* Hunk lines point into the diff text, not into t */
+    free(t.lines);
+    if (err != ARC_OK) {
+        diffs_free(diffs, count);
+        return err;
+    }
+    *out = diffs;
+    *out_count = count;
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Hunk Placement
+ *============================================================================*/
+
+typedef struct {
+    size_t at;                          /* First file line matched */
+    size_t skip_front;                  /* Context lines dropped by fuzz */
+    size_t skip_back;
+} placement_t;
+
+/* Old side of a hunk (context and removed lines) */
+static size_t hunk_old_lines(const hunk_t *h, const line_t **out) {
+    size_t n = 0;
+    for (size_t i = 0; i < h->count; i++) {
+        if (h->lines[i].op != '+') out[n++] = &h->lines[i].line;
+    }
+    return n;
+}
+
+static int matches_at(const line_table_t *t, size_t at, const line_t **pat, size_t n, int loose) {
+    for (size_t k = 0; k < n; k++) {
+        const line_t *a = &t->lines[at + k], *b = pat[k];
+        if (!loose) {
+            if (a->hash != b->hash || a->len != b->len || memcmp(a->text, b->text, a->len) != 0) return 0;
+        } else if (a->loose != b->loose || !loose_equal(a, b)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Nearest match to expected within [lo, hi]; returns 1 if found */
+static int search(const line_table_t *t, const line_t **pat, size_t n, size_t lo,
+                  size_t expected, int loose, size_t *at) {
+    if (t->count < n || lo > t->count - n) return 0;
+    size_t hi = t->count - n;
+    if (expected < lo) expected = lo;
+    if (expected > hi) expected = hi;
+    for (size_t d = 0; expected - d >= lo || expected + d <= hi; d++) {
+        if (d <= expected && expected - d >= lo && matches_at(t, expected - d, pat, n, loose)) {
+            *at = expected - d;
+            return 1;
+        }
+        if (d > 0 && expected + d <= hi && matches_at(t, expected + d, pat, n, loose)) {
+            *at = expected + d;
+            return 1;
+        }
+        if (d > expected && expected + d > hi) break;
+    }
+    return 0;
+}
+
+static int place_hunk(const line_table_t *t, const hunk_t *h, size_t lo, long offset,
+                      placement_t *out, int *fuzzy) {
+    const line_t **pat = malloc((h->count + 1) * sizeof(*pat));
+    if (!pat) return -1;
+    size_t n = hunk_old_lines(h, pat);
+
+    /* Leading and trailing context available to fuzz away */
+    size_t lead = 0, trail = 0;
+    while (lead < h->count && h->lines[lead].op == ' ') lead++;
+    while (trail < h->count - lead && h->lines[h->count - 1 - trail].op == ' ') trail++;
+
+    long start = (long)(h->old_count == 0 ? h->old_start : (h->old_start ? h->old_start - 1 : 0)) + offset;
+    size_t expected = start < 0 ? 0 : (size_t)start;
+
+    int found = 0;
+    if (n == 0) {
+        /* Pure insertion */
+        out->at = expected < lo ? lo : (expected > t->count ? t->count : expected);
+        out->skip_front = out->skip_back = 0;
+        *fuzzy = out->at != expected;
+        found = 1;
+    }
+    for (size_t fuzz = 0; !found && fuzz <= PATCH_MAX_FUZZ; fuzz++) {
+        size_t front = fuzz < lead ? fuzz : lead;
+        size_t back = fuzz < trail ? fuzz : trail;
+        if (fuzz > 0 && front + back == 0) break;
+        if (front + back >= n) break;
+        for (int loose = 0; loose <= 1 && !found; loose++) {
+            size_t at;
+            if (search(t, pat + front, n - front - back, lo, expected + front, loose, &at)) {
+                out->at = at;
+                out->skip_front = front;
+                out->skip_back = back;
+                *fuzzy = fuzz > 0 || loose || at != expected + front;
+                found = 1;
+            }
+        }
+    }
+    free(pat);
+    return found;
+}
+
+/*============================================================================
+ * Applying Diffs
+ *============================================================================*/
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    int open_line;                      /* Last line written without newline */
+} out_buf_t;
+
+static int out_put(out_buf_t *o, const char *s, size_t len) {
+    if (o->len + len + 1 > o->cap) {
+        size_t cap = o->cap ? o->cap : 4096;
+        while (o->len + len + 1 > cap) cap *= 2;
+        char *data = realloc(o->data, cap);
+        if (!data) return -1;
+        o->data = data;
+        o->cap = cap;
+    }
+    memcpy(o->data + o->len, s, len);
+    o->len += len;
+    return 0;
+}
+
+static int out_line(out_buf_t *o, const char *text, size_t len, const char *eol, size_t eol_len) {
+    if (o->open_line && out_put(o, "\n", 1) != 0) return -1;
+    o->open_line = eol_len == 0;
+    return out_put(o, text, len) || out_put(o, eol, eol_len);
+}
+
+static int out_raw(out_buf_t *o, const line_t *l) {
+    return out_line(o, l->text, l->len, l->text + l->len, l->raw_len - l->len);
+}
+
+/* Apply hunks to content; returns a new buffer in *out */
+static arc_err_t apply_hunks(ac_patch_t *p, const char *name, const char *content, size_t len,
+                             const file_diff_t *d, char **out, size_t *out_len,
+                             size_t *added, size_t *removed, size_t *fuzzy) {
+    line_table_t t;
+    if (split_lines(content, len, &t) != 0) return fail(p, ARC_ERR_NO_MEMORY, "out of memory");
+
+    /* New lines follow the file's line endings */
+    const char *eol = "\n";
+    if (t.count > 0 && t.lines[0].raw_len == t.lines[0].len + 2) eol = "\r\n";
+    size_t eol_len = strlen(eol);
+
+    out_buf_t o = {0};
+    size_t cursor = 0;
+    long offset = 0;
+    arc_err_t err = ARC_OK;
+
+    for (size_t hi = 0; hi < d->count && err == ARC_OK; hi++) {
+        const hunk_t *h = &d->hunks[hi];
+        placement_t pl;
+        int was_fuzzy = 0;
+        int r = place_hunk(&t, h, cursor, offset, &pl, &was_fuzzy);
+        if (r < 0) {
+            err = fail(p, ARC_ERR_NO_MEMORY, "out of memory");
+            break;
+        }
+        if (r == 0) {
+            const char *first = "";
+            size_t first_len = 0;
+            for (size_t k = 0; k < h->count; k++) {
+                if (h->lines[k].op != '+') {
+                    first = h->lines[k].line.text;
+                    first_len = h->lines[k].line.len;
+                    break;
+                }
+            }
+            err = fail(p, ARC_ERR_NOT_FOUND, "hunk %zu of %s does not match near line %zu (\"%.*s\")",
+                       hi + 1, name, h->old_start, (int)(first_len > 60 ? 60 : first_len), first);
+            break;
+        }
+        *fuzzy += (size_t)was_fuzzy;
+
+        /* Untouched lines before the hunk */
+        for (; cursor < pl.at && err == ARC_OK; cursor++) {
+            if (out_raw(&o, &t.lines[cursor]) != 0) err = fail(p, ARC_ERR_NO_MEMORY, "out of memory");
+        }
+
+        size_t seen_old = 0, old_total = 0;
+        for (size_t k = 0; k < h->count; k++) old_total += h->lines[k].op != '+';
+
+        for (size_t k = 0; k < h->count && err == ARC_OK; k++) {
+            const hunk_line_t *hl = &h->lines[k];
+            if (hl->op != '+') {
+                size_t idx = seen_old++;
+                /* Context dropped by fuzz stays as it is in the file */
+                if (idx < pl.skip_front || idx >= old_total - pl.skip_back) continue;
+                if (hl->op == ' ') {
+                    if (out_raw(&o, &t.lines[cursor]) != 0) err = fail(p, ARC_ERR_NO_MEMORY, "out of memory");
+                } else {
+                    (*removed)++;
+                }
+                cursor++;
+            } else {
+                if (out_line(&o, hl->line.text, hl->line.len, eol, hl->no_newline ? 0 : eol_len) != 0) {
+                    err = fail(p, ARC_ERR_NO_MEMORY, "out of memory");
+                }
+                (*added)++;
+            }
+        }
+        offset = (long)pl.at - (long)(h->old_start ? h->old_start - 1 : 0) - (long)pl.skip_front;
+    }
+
+    for (; cursor < t.count && err == ARC_OK; cursor++) {
+        if (out_raw(&o, &t.lines[cursor]) != 0) err = fail(p, ARC_ERR_NO_MEMORY, "out of memory");
+    }
+    free(t.lines);
+    if (err != ARC_OK) {
+        free(o.data);
+        return err;
+    }
+    if (!o.data && !(o.data = malloc(1))) return fail(p, ARC_ERR_NO_MEMORY, "out of memory");
+    *out = o.data;
+    *out_len = o.len;
+    return ARC_OK;
+}
+
+/* Result for one staged file while a diff is pending */
+typedef struct {
+    size_t index;                       /* Into the staged files (they may move) */
+    char *content;
+    size_t len;
+    int deleted;
+    int touched;
+    size_t added, removed, fuzzy, changes;
+} pending_t;
+
+arc_err_t ac_patch_apply_diff(ac_patch_t *patch, const char *diff) {
+    if (!patch || !diff) return ARC_ERR_INVALID_ARG;
+    if (patch->committed) return fail(patch, ARC_ERR_INVALID_STATE, "patch already committed");
+    patch->error[0] = '\0';
+
+    file_diff_t *diffs;
+    size_t ndiffs;
+    arc_err_t err = parse_diff(patch, diff, &diffs, &ndiffs);
+    if (err != ARC_OK) return err;
+
+    size_t before = patch->count;
+    pending_t *pend = calloc(ndiffs * 2, sizeof(*pend));
+    size_t npend = 0;
+    if (!pend) err = fail(patch, ARC_ERR_NO_MEMORY, "out of memory");
+
+    for (size_t i = 0; i < ndiffs && err == ARC_OK; i++) {
+        const file_diff_t *d = &diffs[i];
+        const char *src_name = d->old_path ? d->old_path : d->new_path;
+        const char *dst_name = d->new_path ? d->new_path : d->old_path;
+
+        /* Stage source and target; later sections see earlier results */
+        size_t idx[2];
+        const char *names[2] = { src_name, dst_name };
+        for (int k = 0; k < 2 && err == ARC_OK; k++) {
+            staged_file_t *f;
+            err = stage(patch, names[k], &f);
+            if (err != ARC_OK) break;
+            idx[k] = (size_t)(f - patch->files);
+        }
+        if (err != ARC_OK) break;
+
+        pending_t *src = NULL, *dst = NULL;
+        for (size_t k = 0; k < npend; k++) {
+            if (pend[k].index == idx[0]) src = &pend[k];
+            if (pend[k].index == idx[1]) dst = &pend[k];
+        }
+        for (int k = 0; k < 2; k++) {
+            pending_t **slot = k == 0 ? &src : &dst;
+            if (*slot) continue;
+            if (k == 1 && idx[1] == idx[0]) {
+                dst = src;
+                break;
+            }
+            pending_t *pe = &pend[npend++];
+            staged_file_t *f = &patch->files[idx[k]];
+            pe->index = idx[k];
+            pe->deleted = !file_present(f);
+            pe->content = malloc(f->len + 1);
+            if (!pe->content) {
+                err = fail(patch, ARC_ERR_NO_MEMORY, "out of memory");
+                break;
+            }
+            memcpy(pe->content, f->content, f->len);
+            pe->len = f->len;
+            *slot = pe;
+        }
+        if (err != ARC_OK) break;
+
+        /* Source contents */
+        const char *base = "";
+        size_t base_len = 0;
+        if (d->old_path) {
+            if (src->deleted) {
+                err = fail(patch, ARC_ERR_NOT_FOUND, "file not found: %s", src_name);
+                break;
+            }
+            base = src->content;
+            base_len = src->len;
+        } else if (!dst->deleted && dst->len > 0) {
+            err = fail(patch, ARC_ERR_INVALID_ARG, "%s already exists", dst_name);
+            break;
+        }
+
+        char *result;
+        size_t result_len, added = 0, removed = 0, fuzzy = 0;
+        err = apply_hunks(patch, src_name, base, base_len, d, &result, &result_len, &added, &removed, &fuzzy);
+        if (err != ARC_OK) break;
+
+        if (!d->new_path) {
+            if (result_len > 0) {
+                free(result);
+                err = fail(patch, ARC_ERR_NOT_FOUND, "deleting %s: hunks leave %zu bytes", src_name, result_len);
+                break;
+            }
+            free(result);
+            src->deleted = 1;
+            src->len = 0;
+        } else {
+            if (src != dst) {
+                if (d->old_path) src->deleted = 1;      /* Rename */
+                src->touched = 1;
+            }
+            free(dst->content);
+            dst->content = result;
+            dst->len = result_len;
+            dst->deleted = 0;
+        }
+        src->touched = dst->touched = 1;
+        dst->added += added;
+        dst->removed += removed;
+        dst->fuzzy += fuzzy;
+        dst->changes += d->count ? d->count : 1;
+    }
+
+    /* Install everything, or nothing */
+    for (size_t k = 0; k < npend; k++) {
+        staged_file_t *f = &patch->files[pend[k].index];
+        if (err == ARC_OK && pend[k].touched) {
+            free(f->content);
+            f->content = pend[k].content;
+            f->len = pend[k].len;
+            f->deleted = pend[k].deleted;
+            f->changes += pend[k].changes ? pend[k].changes : 1;
+            f->added += pend[k].added;
+            f->removed += pend[k].removed;
+            f->fuzzy += pend[k].fuzzy;
+        } else {
+            free(pend[k].content);
+        }
+    }
+    free(pend);
+    diffs_free(diffs, ndiffs);
+    if (err != ARC_OK) unstage_from(patch, before);
+    return err;
+}
+
+/*============================================================================
+ * Commit
+ *============================================================================*/
+
+static int file_changed(const staged_file_t *f) {
+    if (f->deleted) return f->existed;
+    if (!f->existed) return f->changes > 0;
+    return f->len != f->original_len || memcmp(f->content, f->original, f->len) != 0;
+}
+
+static int make_parents(const char *path) {
+    char buf[4096];
+    if (snprintf(buf, sizeof(buf), "%s", path) >= (int)sizeof(buf)) return -1;
+    for (char *s = buf + 1; *s; s++) {
+        if (*s != '/') continue;
+        *s = '\0';
+        if (mkdir(buf, 0755) != 0 && errno != EEXIST) return -1;
+        *s = '/';
+    }
+    return 0;
+}
+
+/* Write data to a new temporary file next to path */
+static char *write_temp(const char *path, const char *data, size_t len, mode_t mode) {
+    static unsigned counter = 0;
+    size_t plen = strlen(path);
+    char *tmp = malloc(plen + 48);
+    if (!tmp) return NULL;
+
+    const char *slash = strrchr(path, '/');
+    size_t dir_len = slash ? (size_t)(slash - path) + 1 : 0;
+    int fd = -1;
+    for (int attempt = 0; attempt < 16 && fd < 0; attempt++) {
+        snprintf(tmp, plen + 48, "%.*s.%s.arc-%d-%u", (int)dir_len, path, path + dir_len,
+                 (int)getpid(), counter++);
+        fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL, 0600);
+        if (fd < 0 && errno != EEXIST) break;
+    }
+    if (fd < 0) {
+        free(tmp);
+        return NULL;
+    }
+    size_t done = 0;
+    while (done < len) {
+        long n = (long)write(fd, data + done, (unsigned)(len - done));
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+#if !defined(_WIN32)
+    int ok = done == len && fchmod(fd, mode) == 0;
+#else
+    (void)mode;
+    int ok = done == len;
+#endif
+    ok = (close(fd) == 0) && ok;
+    if (!ok) {
+        remove(tmp);
+        free(tmp);
+        return NULL;
+    }
+    return tmp;
+}
+
+static int replace_file(const char *tmp, const char *path) {
+#if defined(_WIN32)
+    remove(path);                       /* rename() does not overwrite */
+#endif
+    return rename(tmp, path);
+}
+
+/* Put a file back as it was before the commit; best effort */
+static void restore(staged_file_t *f) {
+    if (!f->existed) {
+        remove(f->write_path);
+        return;
+    }
+    char *tmp = write_temp(f->write_path, f->original, f->original_len, f->mode);
+    if (tmp && replace_file(tmp, f->write_path) != 0) remove(tmp);
+    free(tmp);
+}
+
+arc_err_t ac_patch_commit(ac_patch_t *patch) {
+    if (!patch) return ARC_ERR_INVALID_ARG;
+    if (patch->committed) return fail(patch, ARC_ERR_INVALID_STATE, "patch already committed");
+    patch->error[0] = '\0';
+
+    /* Nothing is written if anything changed underneath */
+    for (size_t i = 0; i < patch->count; i++) {
+        staged_file_t *f = &patch->files[i];
+        if (!file_changed(f)) continue;
+        struct stat st;
+        int exists = stat(f->path, &st) == 0;
+        if (exists != f->existed ||
+            (exists && (st.st_size != f->size || stat_mtime_ns(&st) != f->mtime_ns))) {
+            return fail(patch, ARC_ERR_INVALID_STATE, "%s changed on disk since it was read", f->path);
+        }
+    }
+
+    /* Stage new contents in temporary files */
+    arc_err_t err = ARC_OK;
+    for (size_t i = 0; i < patch->count && err == ARC_OK; i++) {
+        staged_file_t *f = &patch->files[i];
+        if (!file_changed(f) || f->deleted) continue;
+        if (!f->existed && make_parents(f->write_path) != 0) {
+            err = fail(patch, ARC_ERR_IO, "cannot create directories for %s: %s", f->path, strerror(errno));
+            break;
+        }
+        f->tmp_path = write_temp(f->write_path, f->content, f->len, f->existed ? f->mode : 0644);
+        if (!f->tmp_path) err = fail(patch, ARC_ERR_IO, "cannot write %s: %s", f->path, strerror(errno));
+    }
+
+    /* Swap them in */
+    for (size_t i = 0; i < patch->count && err == ARC_OK; i++) {
+        staged_file_t *f = &patch->files[i];
+        if (!file_changed(f)) continue;
+        int rc = f->deleted ? remove(f->write_path) : replace_file(f->tmp_path, f->write_path);
+        if (rc != 0) {
+            err = fail(patch, ARC_ERR_IO, "cannot replace %s: %s (changes rolled back)", f->path, strerror(errno));
+            break;
+        }
+        f->replaced = 1;
+        free(f->tmp_path);
+        f->tmp_path = NULL;
+    }
+
+    for (size_t i = 0; i < patch->count; i++) {
+        staged_file_t *f = &patch->files[i];
+        if (f->tmp_path) {
+            remove(f->tmp_path);
+            free(f->tmp_path);
+            f->tmp_path = NULL;
+        }
+        if (err != ARC_OK && f->replaced) {
+            restore(f);
+            f->replaced = 0;
+        }
+    }
+    if (patch->cache) {
+        for (size_t i = 0; i < patch->count; i++) {
+            if (!file_changed(&patch->files[i])) continue;
+            ac_textfile_cache_invalidate(patch->cache, patch->files[i].path);
+            ac_textfile_cache_invalidate(patch->cache, patch->files[i].write_path);
+        }
+    }
+    if (err == ARC_OK) patch->committed = 1;
+    return err;
+}
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+ac_patch_t *ac_patch_create(const char *base_dir) {
+    ac_patch_t *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    if (base_dir && !(p->base_dir = strdup(base_dir))) {
+        free(p);
+        return NULL;
+    }
+    return p;
+}
+
+void ac_patch_set_file_cache(ac_patch_t *patch, ac_textfile_cache_t *cache) {
+    if (patch) patch->cache = cache;
+}
+
+void ac_patch_set_path_check(ac_patch_t *patch, ac_patch_path_check_t check, void *user_data) {
+    if (!patch) return;
+    patch->check = check;
+    patch->check_data = user_data;
+}
+
+const char *ac_patch_error(const ac_patch_t *patch) {
+    return patch ? patch->error : "";
+}
+
+size_t ac_patch_file_count(const ac_patch_t *patch) {
+    return patch ? patch->count : 0;
+}
+
+void ac_patch_file_info(const ac_patch_t *patch, size_t index, ac_patch_file_info_t *info) {
+    if (!info) return;
+    memset(info, 0, sizeof(*info));
+    if (!patch || index >= patch->count) return;
+    const staged_file_t *f = &patch->files[index];
+    info->path = f->path;
+    info->created = !f->existed && !f->deleted;
+    info->deleted = f->existed && f->deleted;
+    info->changes = f->changes;
+    info->fuzzy = f->fuzzy;
+    info->lines_added = f->added;
+    info->lines_removed = f->removed;
+}
+
+void ac_patch_free(ac_patch_t *patch) {
+    if (!patch) return;
+    unstage_from(patch, 0);
+    free(patch->files);
+    free(patch->base_dir);
+    free(patch);
+}
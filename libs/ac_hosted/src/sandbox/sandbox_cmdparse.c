@@ -0,0 +1,1075 @@
+/**
+ * @file sandbox_cmdparse.c
+ * @brief Shell Command Tokenizer
+ *
+ * Splits a command line into simple commands the way a POSIX shell
+ * would, without expanding anything: quotes and backslashes are
+ * removed, words containing parameter expansions or globs are kept
+ * literally and flagged, and everything that can run code of its own is
+ * parsed recursively one level deeper:
+ *
+ * - ( ... ) subshells and { ...; } groups (inline, depth + 1 for subshells)
+ * - $( ... ), ` ... `, <( ... ) and >( ... ) substitutions
+ * - the script argument of sh/bash -c, su -c and eval
+ * - here-documents and here-strings fed to a shell
+ *
+ * Shell keywords (if, while, for, case, ...) and function definitions
+ * are skipped so the commands inside them are seen as commands.
+ * Malformed input is parsed as far as possible and flagged.
+ */
+
+#include "sandbox_internal.h"
+#include <arc/command_policy.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+#define PARSE_MAX_LEVEL     32      /* Nested substitutions / shells */
+#define ARENA_BLOCK_SIZE    4096
+
+/*============================================================================
+ * Arena
+ *============================================================================*/
+
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t used;
+    size_t cap;
+    char data[];
+} arena_block_t;
+
+static void *arena_alloc(ac_cmd_script_t *script, size_t size) {
+    arena_block_t *block = script->arena;
+    size = (size + 7) & ~(size_t)7;
+
+    if (!block || block->cap - block->used < size) {
+        size_t cap = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        arena_block_t *fresh = malloc(sizeof(arena_block_t) + cap);
+        if (!fresh) return NULL;
+        fresh->next = block;
+        fresh->used = 0;
+        fresh->cap = cap;
+        script->arena = block = fresh;
+    }
+
+    void *p = block->data + block->used;
+    block->used += size;
+    return p;
+}
+
+static char *arena_strndup(ac_cmd_script_t *script, const char *s, size_t len) {
+    char *copy = arena_alloc(script, len + 1);
+    if (!copy) return NULL;
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+/*============================================================================
+ * Growable Buffers
+ *============================================================================*/
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} strbuf_t;
+
+static int strbuf_put(strbuf_t *b, const char *s, size_t len) {
+    if (b->len + len + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap * 2 : 64;
+        while (b->len + len + 1 > cap) cap *= 2;
+        char *data = realloc(b->data, cap);
+        if (!data) return -1;
+        b->data = data;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, s, len);
+    b->len += len;
+    b->data[b->len] = '\0';
+    return 0;
+}
+
+static int strbuf_putc(strbuf_t *b, char c) {
+    return strbuf_put(b, &c, 1);
+}
+
+/* Grow a heap array of `item` bytes per element to hold count + 1 */
+static int grow(void **items, int *cap, int count, size_t item) {
+    if (count < *cap) return 0;
+    int next = *cap ? *cap * 2 : 8;
+    void *p = realloc(*items, (size_t)next * item);
+    if (!p) return -1;
+    *items = p;
+    *cap = next;
+    return 0;
+}
+
+/*============================================================================
+ * Parser State
+ *============================================================================*/
+
+/* A word as lexed: unquoted text plus what it contained */
+typedef struct {
+    char *text;                         /* Arena copy */
+    int dynamic;                        /* Expansion or unquoted glob */
+    int quoted;                         /* Any quoting at all */
+    int assignment;                     /* NAME=... with an unquoted name */
+} word_t;
+
+typedef struct {
+    ac_cmd_redir_t redir;
+    int strip_tabs;                     /* <<- */
+} pending_redir_t;
+
+/* The simple command being collected */
+typedef struct {
+    word_t *words;
+    int word_count;
+    int word_cap;
+    pending_redir_t *redirs;
+    int redir_count;
+    int redir_cap;
+} builder_t;
+
+/* A here-document whose body follows the next newline */
+typedef struct {
+    ac_cmd_redir_t *redir;              /* In the arena; target = delimiter until read */
+    int strip_tabs;
+    int feeds_shell;                    /* Body is a script for a shell */
+    int depth;
+} heredoc_t;
+
+typedef struct {
+    ac_cmd_script_t *script;
+    int command_cap;
+    int oom;
+} parser_t;
+
+/* One level of source text: the command line or a nested script */
+typedef struct {
+    parser_t *parser;
+    const char *src;
+    size_t len;
+    size_t pos;
+    int level;                          /* Recursion level */
+    int depth;                          /* Current nesting depth */
+    int subshells;                      /* Open ( ... ) */
+    builder_t cmd;
+    strbuf_t word;
+    heredoc_t *heredocs;
+    int heredoc_count;
+    int heredoc_cap;
+
+    /* Keyword handling */
+    int skip_words;                     /* for/select header: skip to ; or newline */
+    int skip_next;                      /* function NAME */
+    int case_word;                      /* After `case`: skip the subject and `in` */
+    int case_patterns;                  /* Inside case, before a pattern's ')' */
+} lexer_t;
+
+static void parse_source(parser_t *parser, const char *src, size_t len, int level, int depth);
+
+/*============================================================================
+ * Program Names and Wrappers
+ *============================================================================*/
+
+static const char *basename_of(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash && slash[1] ? slash + 1 : path;
+}
+
+/* Programs that run their arguments as another command */
+static const struct {
+    const char *name;
+    const char *arg_options;            /* Short options that take a value */
+    int operands;                       /* Operands before the command */
+} g_wrappers[] = {
+    { "env",     "uCS",        0 },
+    { "sudo",    "ugChpUDrtT", 0 },
+    { "doas",    "uC",         0 },
+    { "pkexec",  "u",          0 },
+    { "nice",    "n",          0 },
+    { "ionice",  "cnpt",       0 },
+    { "nohup",   "",           0 },
+    { "time",    "fo",         0 },
+    { "command", "",           0 },
+    { "builtin", "",           0 },
+    { "exec",    "a",          0 },
+    { "setsid",  "",           0 },
+    { "stdbuf",  "ioe",        0 },
+    { "xargs",   "IdELnPsa",   0 },
+    { "timeout", "sk",         1 },
+    { "chroot",  "",           1 },
+};
+
+static int is_assignment_text(const char *s) {
+    if (!(*s == '_' || (*s >= 'A' && *s <= 'Z') || (*s >= 'a' && *s <= 'z'))) return 0;
+    for (s++; *s && *s != '='; s++) {
+        if (!(*s == '_' || (*s >= 'A' && *s <= 'Z') || (*s >= 'a' && *s <= 'z') ||
+              (*s >= '0' && *s <= '9'))) {
+            return 0;
+        }
+    }
+    return *s == '=';
+}
+
+int ac_cmd_wrapped_program(const char **argv, int argc, int index) {
+    if (index < 0 || index >= argc) return -1;
+
+    const char *name = basename_of(argv[index]);
+    size_t w;
+    for (w = 0; w < sizeof(g_wrappers) / sizeof(g_wrappers[0]); w++) {
+        if (strcmp(name, g_wrappers[w].name) == 0) break;
+    }
+    if (w == sizeof(g_wrappers) / sizeof(g_wrappers[0])) return -1;
+
+    int operands = g_wrappers[w].operands;
+    int i = index + 1;
+    while (i < argc) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--") == 0) {
+            i++;
+            break;
+        }
+        if (arg[0] == '-' && arg[1]) {
+            /* "-u root": the value is the next word */
+            if (arg[1] != '-' && arg[2] == '\0' && strchr(g_wrappers[w].arg_options, arg[1])) i++;
+            i++;
+            continue;
+        }
+        if (w == 0 && is_assignment_text(arg)) {
+            i++;                        /* env NAME=value */
+            continue;
+        }
+        break;
+    }
+    i += operands;
+    return i < argc ? i : -1;
+}
+
+const char *ac_cmd_program_name(const ac_cmd_simple_t *command) {
+    if (!command || command->program < 0) return NULL;
+    return basename_of(command->argv[command->program]);
+}
+
+static int is_shell(const char *name) {
+    static const char *shells[] = { "sh", "bash", "dash", "zsh", "ksh", "mksh", "ash", "busybox", NULL };
+    for (int i = 0; shells[i]; i++) {
+        if (strcmp(name, shells[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+/*
+ * The script a command runs itself: the operand of sh -c, the -c value
+ * of su, or the words after eval. Returns NULL if there is none.
+ */
+static const char *inline_script(parser_t *parser, const ac_cmd_simple_t *cmd) {
+    if (cmd->program < 0) return NULL;
+    const char *name = basename_of(cmd->argv[cmd->program]);
+    int i = cmd->program + 1;
+
+    if (strcmp(name, "eval") == 0) {
+        strbuf_t joined = {0};
+        for (; i < cmd->argc; i++) {
+            if (joined.len && strbuf_putc(&joined, ' ') < 0) break;
+            if (strbuf_put(&joined, cmd->argv[i], strlen(cmd->argv[i])) < 0) break;
+        }
+        char *script = joined.data ? arena_strndup(parser->script, joined.data, joined.len) : NULL;
+        free(joined.data);
+        return script;
+    }
+
+    if (strcmp(name, "su") == 0) {
+        for (; i < cmd->argc; i++) {
+            if ((strcmp(cmd->argv[i], "-c") == 0 || strcmp(cmd->argv[i], "--command") == 0) &&
+                i + 1 < cmd->argc) {
+                return cmd->argv[i + 1];
+            }
+            if (strncmp(cmd->argv[i], "--command=", 10) == 0) return cmd->argv[i] + 10;
+        }
+        return NULL;
+    }
+
+    if (!is_shell(name)) return NULL;
+
+    int has_c = 0;
+    for (; i < cmd->argc; i++) {
+        const char *arg = cmd->argv[i];
+        if (strcmp(arg, "--") == 0) {
+            i++;
+            break;
+        }
+        if ((arg[0] != '-' && arg[0] != '+') || arg[1] == '\0') break;
+        if (arg[0] == '-' && arg[1] == '-') continue;
+        if (strchr(arg + 1, 'c')) has_c = 1;
+        if (strcmp(arg + 1, "o") == 0 || strcmp(arg + 1, "O") == 0) i++;
+    }
+    return has_c && i < cmd->argc ? cmd->argv[i] : NULL;
+}
+
+/*============================================================================
+ * Emitting Commands
+ *============================================================================*/
+
+static void builder_reset(builder_t *b) {
+    b->word_count = 0;
+    b->redir_count = 0;
+}
+
+static int builder_empty(const builder_t *b) {
+    return b->word_count == 0 && b->redir_count == 0;
+}
+
+/* Turn the collected words into a simple command */
+static void emit_command(lexer_t *lx, ac_cmd_link_t link) {
+    parser_t *parser = lx->parser;
+    ac_cmd_script_t *script = parser->script;
+    builder_t *b = &lx->cmd;
+
+    if (builder_empty(b)) {
+        /* "a | | b" etc.: still link the previous command */
+        if (script->count > 0 && link != AC_CMD_LINK_END &&
+            script->commands[script->count - 1].link == AC_CMD_LINK_END) {
+            script->commands[script->count - 1].link = link;
+        }
+        return;
+    }
+
+    if (grow((void **)&script->commands, &parser->command_cap, script->count,
+             sizeof(ac_cmd_simple_t)) < 0) {
+        parser->oom = 1;
+        builder_reset(b);
+        return;
+    }
+
+    int assigns = 0;
+    while (assigns < b->word_count && b->words[assigns].assignment) assigns++;
+    int argc = b->word_count - assigns;
+
+    ac_cmd_simple_t cmd = {0};
+    cmd.argv = arena_alloc(script, sizeof(char *) * (size_t)(argc + 1));
+    cmd.assigns = arena_alloc(script, sizeof(char *) * (size_t)(assigns + 1));
+    cmd.redirs = arena_alloc(script, sizeof(ac_cmd_redir_t) * (size_t)(b->redir_count + 1));
+    if (!cmd.argv || !cmd.assigns || !cmd.redirs) {
+        parser->oom = 1;
+        builder_reset(b);
+        return;
+    }
+    for (int i = 0; i < assigns; i++) cmd.assigns[i] = b->words[i].text;
+    for (int i = 0; i < argc; i++) cmd.argv[i] = b->words[assigns + i].text;
+    for (int i = 0; i < b->redir_count; i++) cmd.redirs[i] = b->redirs[i].redir;
+    cmd.argv[argc] = NULL;
+    cmd.assigns[assigns] = NULL;
+    cmd.argc = argc;
+    cmd.assign_count = assigns;
+    cmd.redir_count = b->redir_count;
+    cmd.depth = lx->depth;
+    cmd.link = link;
+
+    /* Follow wrappers to the program that finally runs */
+    cmd.program = argc > 0 ? 0 : -1;
+    for (int next; cmd.program >= 0 &&
+                   (next = ac_cmd_wrapped_program(cmd.argv, argc, cmd.program)) >= 0;) {
+        cmd.program = next;
+    }
+    if (argc > 0) cmd.dynamic = b->words[assigns].dynamic;
+
+    script->commands[script->count++] = cmd;
+    int index = script->count - 1;
+    int feeds_shell = cmd.program >= 0 && is_shell(basename_of(cmd.argv[cmd.program]));
+
+    /* Here-document bodies are read at the next newline */
+    for (int i = 0; i < b->redir_count; i++) {
+        ac_cmd_redir_t *r = &script->commands[index].redirs[i];
+        if (r->op == AC_CMD_REDIR_HEREDOC) {
+            if (grow((void **)&lx->heredocs, &lx->heredoc_cap, lx->heredoc_count,
+                     sizeof(heredoc_t)) < 0) {
+                parser->oom = 1;
+                break;
+            }
+            lx->heredocs[lx->heredoc_count++] = (heredoc_t){
+                .redir = r,
+                .strip_tabs = b->redirs[i].strip_tabs,
+                .feeds_shell = feeds_shell,
+                .depth = lx->depth,
+            };
+        } else if (r->op == AC_CMD_REDIR_HERESTRING && feeds_shell) {
+            parse_source(parser, r->target, strlen(r->target), lx->level + 1, lx->depth + 1);
+        }
+    }
+    builder_reset(b);
+
+    const char *inner = inline_script(parser, &script->commands[index]);
+    if (inner) parse_source(parser, inner, strlen(inner), lx->level + 1, lx->depth + 1);
+}
+
+/*============================================================================
+ * Lexing Helpers
+ *============================================================================*/
+
+static int at(const lexer_t *lx, size_t offset) {
+    return lx->pos + offset < lx->len ? (unsigned char)lx->src[lx->pos + offset] : -1;
+}
+
+static int is_blank(int c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static int is_meta(int c) {
+    return c < 0 || is_blank(c) || c == '\n' || c == ';' || c == '&' || c == '|' ||
+           c == '<' || c == '>' || c == '(' || c == ')';
+}
+
+/*
+ * Find the end of a $( ... ) / <( ... ) body starting at `start` (after
+ * the open paren). Returns the index of the closing paren, or len.
+ */
+static size_t match_paren(const char *s, size_t start, size_t len) {
+    int nest = 1;
+    size_t i = start;
+    while (i < len) {
+        char c = s[i];
+        if (c == '\\') {
+            i += 2;
+            continue;
+        }
+        if (c == '\'') {
+            const char *q = memchr(s + i + 1, '\'', len - i - 1);
+            i = q ? (size_t)(q - s) + 1 : len;
+            continue;
+        }
+        if (c == '"') {
+            for (i++; i < len && s[i] != '"'; i++) {
+                if (s[i] == '\\') i++;
+            }
+            i++;
+            continue;
+        }
+        if (c == '#' && (i == start || is_blank((unsigned char)s[i - 1]) || s[i - 1] == '\n')) {
+            while (i < len && s[i] != '\n') i++;
+            continue;
+        }
+        if (c == '(') nest++;
+        if (c == ')' && --nest == 0) return i;
+        i++;
+    }
+    return len;
+}
+
+/* Index of the brace closing a ${ ... } starting at `start`, or len */
+static size_t match_brace(const char *s, size_t start, size_t len) {
+    int nest = 1;
+    for (size_t i = start; i < len; i++) {
+        if (s[i] == '\\') i++;
+        else if (s[i] == '{') nest++;
+        else if (s[i] == '}' && --nest == 0) return i;
+    }
+    return len;
+}
+
+/* Parse a substitution body one level down */
+static void nested(lexer_t *lx, const char *body, size_t len) {
+    parse_source(lx->parser, body, len, lx->level + 1, lx->depth + 1);
+}
+
+/*
+ * Handle a '$' at lx->pos: command substitution is parsed, anything else
+ * is copied literally. Marks the word dynamic either way.
+ */
+static void lex_dollar(lexer_t *lx, word_t *w) {
+    const char *s = lx->src;
+    size_t start = lx->pos;
+    w->dynamic = 1;
+
+    if (at(lx, 1) == '(' && at(lx, 2) == '(') {
+        /* $(( arithmetic )) */
+        size_t end = match_paren(s, start + 2, lx->len);
+        lx->pos = end < lx->len ? end + 1 : lx->len;
+    } else if (at(lx, 1) == '(') {
+        size_t end = match_paren(s, start + 2, lx->len);
+        if (end >= lx->len) lx->parser->script->error = 1;
+        nested(lx, s + start + 2, end - start - 2);
+        lx->pos = end < lx->len ? end + 1 : lx->len;
+    } else if (at(lx, 1) == '{') {
+        size_t end = match_brace(s, start + 2, lx->len);
+        if (end >= lx->len) lx->parser->script->error = 1;
+        lx->pos = end < lx->len ? end + 1 : lx->len;
+    } else {
+        lx->pos++;
+        int c = at(lx, 0);
+        if (c == '_' || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) {
+            while ((c = at(lx, 0)) == '_' || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+                   (c >= '0' && c <= '9')) {
+                lx->pos++;
+            }
+        } else if (c >= 0 && strchr("0123456789@*#?$!-", c)) {
+            lx->pos++;
+        } else {
+            w->dynamic = 0;             /* A lone '$' is literal */
+        }
+    }
+    if (strbuf_put(&lx->word, s + start, lx->pos - start) < 0) lx->parser->oom = 1;
+}
+
+/* Handle a backquoted substitution starting at lx->pos */
+static void lex_backquote(lexer_t *lx, word_t *w) {
+    const char *s = lx->src;
+    size_t start = lx->pos;
+    strbuf_t body = {0};
+
+    w->dynamic = 1;
+    lx->pos++;
+    while (lx->pos < lx->len && s[lx->pos] != '`') {
+        /* Inside backquotes, \` \\ and \$ lose their backslash */
+        if (s[lx->pos] == '\\' && lx->pos + 1 < lx->len && strchr("`\\$", s[lx->pos + 1])) {
+            lx->pos++;
+        }
+        if (strbuf_putc(&body, s[lx->pos]) < 0) lx->parser->oom = 1;
+        lx->pos++;
+    }
+    if (lx->pos >= lx->len) lx->parser->script->error = 1;
+    else lx->pos++;
+
+    if (body.data) nested(lx, body.data, body.len);
+    free(body.data);
+    if (strbuf_put(&lx->word, s + start, lx->pos - start) < 0) lx->parser->oom = 1;
+}
+
+static char ansi_escape(lexer_t *lx) {
+    int c = at(lx, 0);
+    lx->pos++;
+    switch (c) {
+        case 'n': return '\n';
+        case 't': return '\t';
+        case 'r': return '\r';
+        case 'a': return '\a';
+        case 'b': return '\b';
+        case 'e': case 'E': return 27;
+        case 'f': return '\f';
+        case 'v': return '\v';
+        case 'x': {
+            int value = 0;
+            for (int i = 0; i < 2; i++) {
+                int h = at(lx, 0);
+                int d = (h >= '0' && h <= '9') ? h - '0' :
+                        (h >= 'a' && h <= 'f') ? h - 'a' + 10 :
+                        (h >= 'A' && h <= 'F') ? h - 'A' + 10 : -1;
+                if (d < 0) break;
+                value = value * 16 + d;
+                lx->pos++;
+            }
+            return (char)value;
+        }
+        default:
+            if (c >= '0' && c <= '7') {
+                int value = c - '0';
+                for (int i = 0; i < 2 && at(lx, 0) >= '0' && at(lx, 0) <= '7'; i++) {
+                    value = value * 8 + at(lx, 0) - '0';
+                    lx->pos++;
+                }
+                return (char)value;
+            }
+            return c < 0 ? '\\' : (char)c;
+    }
+}
+
+/*
+ * Read one word starting at lx->pos. Quotes and backslashes are removed;
+ * substitutions are parsed as nested scripts and kept literally.
+ */
+static word_t lex_word(lexer_t *lx) {
+    word_t w = {0};
+    int name_ok = 1;                    /* Unquoted NAME so far (for assignments) */
+    int saw_equals = 0;
+    const char *s = lx->src;
+
+    lx->word.len = 0;
+
+    while (lx->pos < lx->len) {
+        int c = at(lx, 0);
+
+        /* <( ... ) and >( ... ) process substitution */
+        if ((c == '<' || c == '>') && at(lx, 1) == '(') {
+            size_t end = match_paren(s, lx->pos + 2, lx->len);
+            nested(lx, s + lx->pos + 2, end - lx->pos - 2);
+            if (strbuf_put(&lx->word, s + lx->pos, (end < lx->len ? end + 1 : end) - lx->pos) < 0) {
+                lx->parser->oom = 1;
+            }
+            lx->pos = end < lx->len ? end + 1 : lx->len;
+            w.dynamic = 1;
+            name_ok = 0;
+            continue;
+        }
+        if (is_meta(c)) break;
+
+        if (!saw_equals && c == '=') {
+            saw_equals = 1;
+            w.assignment = name_ok && lx->word.len > 0;
+        } else if (!saw_equals && !(c == '_' || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+                                    (c >= '0' && c <= '9' && lx->word.len > 0))) {
+            name_ok = 0;
+        }
+
+        if (c == '\\') {
+            if (at(lx, 1) == '\n') {
+                lx->pos += 2;           /* Line continuation */
+                continue;
+            }
+            w.quoted = 1;
+            if (at(lx, 1) >= 0 && strbuf_putc(&lx->word, s[lx->pos + 1]) < 0) lx->parser->oom = 1;
+            lx->pos += at(lx, 1) >= 0 ? 2 : 1;
+        } else if (c == '\'') {
+            const char *q = memchr(s + lx->pos + 1, '\'', lx->len - lx->pos - 1);
+            size_t end = q ? (size_t)(q - s) : lx->len;
+            if (!q) lx->parser->script->error = 1;
+            if (strbuf_put(&lx->word, s + lx->pos + 1, end - lx->pos - 1) < 0) lx->parser->oom = 1;
+            lx->pos = q ? end + 1 : end;
+            w.quoted = 1;
+        } else if (c == '$' && at(lx, 1) == '\'') {
+            /* $'...' with C escapes */
+            lx->pos += 2;
+            while (lx->pos < lx->len && s[lx->pos] != '\'') {
+                char ch = s[lx->pos++];
+                if (ch == '\\' && lx->pos < lx->len) ch = ansi_escape(lx);
+                if (strbuf_putc(&lx->word, ch) < 0) lx->parser->oom = 1;
+            }
+            if (lx->pos >= lx->len) lx->parser->script->error = 1;
+            else lx->pos++;
+            w.quoted = 1;
+        } else if (c == '"') {
+            w.quoted = 1;
+            lx->pos++;
+            while (lx->pos < lx->len && s[lx->pos] != '"') {
+                int d = at(lx, 0);
+                if (d == '\\' && at(lx, 1) >= 0 && strchr("$`\"\\\n", at(lx, 1))) {
+                    if (at(lx, 1) != '\n' && strbuf_putc(&lx->word, s[lx->pos + 1]) < 0) {
+                        lx->parser->oom = 1;
+                    }
+                    lx->pos += 2;
+                } else if (d == '$') {
+                    lex_dollar(lx, &w);
+                } else if (d == '`') {
+                    lex_backquote(lx, &w);
+                } else {
+                    if (strbuf_putc(&lx->word, (char)d) < 0) lx->parser->oom = 1;
+                    lx->pos++;
+                }
+            }
+            if (lx->pos >= lx->len) lx->parser->script->error = 1;
+            else lx->pos++;
+        } else if (c == '$') {
+            lex_dollar(lx, &w);
+        } else if (c == '`') {
+            lex_backquote(lx, &w);
+        } else {
+            if (c == '*' || c == '?' || c == '[') w.dynamic = 1;
+            if (strbuf_putc(&lx->word, (char)c) < 0) lx->parser->oom = 1;
+            lx->pos++;
+        }
+    }
+
+    w.text = arena_strndup(lx->parser->script, lx->word.data ? lx->word.data : "", lx->word.len);
+    if (!w.text) lx->parser->oom = 1;
+    return w;
+}
+
+/*============================================================================
+ * Here-Documents
+ *============================================================================*/
+
+/* Read the bodies of pending here-documents, starting at lx->pos */
+static void read_heredocs(lexer_t *lx) {
+    for (int h = 0; h < lx->heredoc_count; h++) {
+        heredoc_t *doc = &lx->heredocs[h];
+        const char *delim = doc->redir->target;
+        size_t delim_len = strlen(delim);
+        strbuf_t body = {0};
+        int found = 0;
+
+        while (lx->pos < lx->len) {
+            const char *line = lx->src + lx->pos;
+            const char *nl = memchr(line, '\n', lx->len - lx->pos);
+            size_t line_len = nl ? (size_t)(nl - line) : lx->len - lx->pos;
+            lx->pos += line_len + (nl ? 1 : 0);
+
+            if (doc->strip_tabs) {
+                while (line_len > 0 && *line == '\t') {
+                    line++;
+                    line_len--;
+                }
+            }
+            if (line_len == delim_len && memcmp(line, delim, delim_len) == 0) {
+                found = 1;
+                break;
+            }
+            if (strbuf_put(&body, line, line_len) < 0 || strbuf_putc(&body, '\n') < 0) {
+                lx->parser->oom = 1;
+            }
+        }
+        (void)found;                    /* sh runs a body that hits EOF too */
+
+        char *text = arena_strndup(lx->parser->script, body.data ? body.data : "", body.len);
+        free(body.data);
+        if (!text) {
+            lx->parser->oom = 1;
+            continue;
+        }
+        doc->redir->target = text;
+        if (doc->feeds_shell) {
+            parse_source(lx->parser, text, strlen(text), lx->level + 1, doc->depth + 1);
+        }
+    }
+    lx->heredoc_count = 0;
+}
+
+/*============================================================================
+ * Redirections
+ *============================================================================*/
+
+/* Parse a redirection operator at lx->pos (fd already consumed) */
+static void lex_redirect(lexer_t *lx, int fd) {
+    pending_redir_t r = { .redir = { .fd = fd } };
+    int c = at(lx, 0);
+    int both = 0;                       /* &> and &>> */
+
+    if (c == '&') {
+        both = 1;
+        lx->pos++;
+        c = at(lx, 0);
+    }
+
+    if (c == '<') {
+        if (at(lx, 1) == '<' && at(lx, 2) == '<') {
+            r.redir.op = AC_CMD_REDIR_HERESTRING;
+            lx->pos += 3;
+        } else if (at(lx, 1) == '<') {
+            r.redir.op = AC_CMD_REDIR_HEREDOC;
+            lx->pos += 2;
+            if (at(lx, 0) == '-') {
+                r.strip_tabs = 1;
+                lx->pos++;
+            }
+        } else if (at(lx, 1) == '&') {
+            r.redir.op = AC_CMD_REDIR_DUP;
+            lx->pos += 2;
+        } else if (at(lx, 1) == '>') {
+            r.redir.op = AC_CMD_REDIR_INOUT;
+            lx->pos += 2;
+        } else {
+            r.redir.op = AC_CMD_REDIR_IN;
+            lx->pos++;
+        }
+    } else {
+        if (at(lx, 1) == '>') {
+            r.redir.op = AC_CMD_REDIR_APPEND;
+            lx->pos += 2;
+        } else if (at(lx, 1) == '&' && !both) {
+            r.redir.op = AC_CMD_REDIR_DUP;
+            lx->pos += 2;
+        } else {
+            r.redir.op = AC_CMD_REDIR_OUT;
+            lx->pos += at(lx, 1) == '|' ? 2 : 1;
+        }
+    }
+
+    while (is_blank(at(lx, 0))) lx->pos++;
+    if (is_meta(at(lx, 0))) {
+        lx->parser->script->error = 1;  /* Missing target */
+        return;
+    }
+    word_t target = lex_word(lx);
+    if (!target.text) return;
+    r.redir.target = target.text;
+
+    /* ">&file" writes to a file; ">&2" and ">&-" duplicate / close */
+    if (r.redir.op == AC_CMD_REDIR_DUP && at(lx, 0) != '<') {
+        const char *t = target.text;
+        int numeric = *t != '\0';
+        for (; *t; t++) numeric = numeric && *t >= '0' && *t <= '9';
+        if (!numeric && strcmp(target.text, "-") != 0) r.redir.op = AC_CMD_REDIR_OUT;
+    }
+
+    builder_t *b = &lx->cmd;
+    if (grow((void **)&b->redirs, &b->redir_cap, b->redir_count, sizeof(pending_redir_t)) < 0) {
+        lx->parser->oom = 1;
+        return;
+    }
+    b->redirs[b->redir_count++] = r;
+}
+
+/*============================================================================
+ * Keywords
+ *============================================================================*/
+
+static int is_keyword(const char *word, const char *const *list) {
+    for (int i = 0; list[i]; i++) {
+        if (strcmp(word, list[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+/*
+ * Handle a word in command position that the shell treats as syntax.
+ * Returns 1 if the word was consumed.
+ */
+static int handle_keyword(lexer_t *lx, const word_t *w) {
+    static const char *const plain[] = {
+        "if", "then", "else", "elif", "fi", "do", "done", "while", "until",
+        "!", "{", "}", "esac", NULL
+    };
+
+    if (w->quoted || lx->cmd.word_count > 0 || lx->cmd.redir_count > 0) return 0;
+
+    if (is_keyword(w->text, plain)) {
+        if (strcmp(w->text, "esac") == 0) lx->case_patterns = 0;
+        return 1;
+    }
+    if (strcmp(w->text, "for") == 0 || strcmp(w->text, "select") == 0) {
+        lx->skip_words = 1;
+        return 1;
+    }
+    if (strcmp(w->text, "function") == 0) {
+        lx->skip_next = 1;
+        return 1;
+    }
+    if (strcmp(w->text, "case") == 0) {
+        lx->case_word = 1;
+        return 1;
+    }
+    return 0;
+}
+
+/*============================================================================
+ * Main Loop
+ *============================================================================*/
+
+static void end_command(lexer_t *lx, ac_cmd_link_t link) {
+    emit_command(lx, link);
+    lx->skip_words = 0;
+    lx->skip_next = 0;
+}
+
+static void add_word(lexer_t *lx, const word_t *w) {
+    if (lx->skip_next) {
+        lx->skip_next = 0;
+        return;
+    }
+    if (lx->skip_words) {
+        if (strcmp(w->text, "do") == 0 && !w->quoted) lx->skip_words = 0;
+        return;
+    }
+    if (lx->case_word) {
+        if (strcmp(w->text, "in") == 0 && !w->quoted) {
+            lx->case_word = 0;
+            lx->case_patterns = 1;
+        }
+        return;
+    }
+    if (lx->case_patterns) {
+        if (strcmp(w->text, "esac") == 0 && !w->quoted) lx->case_patterns = 0;
+        return;                         /* Pattern text up to ')' */
+    }
+    if (handle_keyword(lx, w)) return;
+
+    builder_t *b = &lx->cmd;
+    word_t word = *w;
+
+    /* Assignments only count before the program name */
+    if (b->word_count > 0 && !b->words[b->word_count - 1].assignment) word.assignment = 0;
+
+    if (grow((void **)&b->words, &b->word_cap, b->word_count, sizeof(word_t)) < 0) {
+        lx->parser->oom = 1;
+        return;
+    }
+    b->words[b->word_count++] = word;
+}
+
+static void parse_source(parser_t *parser, const char *src, size_t len, int level, int depth) {
+    if (level > PARSE_MAX_LEVEL) {
+        parser->script->error = 1;
+        return;
+    }
+
+    lexer_t lx = {
+        .parser = parser,
+        .src = src,
+        .len = len,
+        .level = level,
+        .depth = depth,
+    };
+
+    while (lx.pos < lx.len && !parser->oom) {
+        int c = at(&lx, 0);
+
+        if (is_blank(c)) {
+            lx.pos++;
+            continue;
+        }
+
+        if (c == '#') {
+            while (lx.pos < lx.len && lx.src[lx.pos] != '\n') lx.pos++;
+            continue;
+        }
+
+        if (c == '\n') {
+            lx.pos++;
+            end_command(&lx, AC_CMD_LINK_SEQ);
+            read_heredocs(&lx);
+            continue;
+        }
+
+        if (c == '\\' && at(&lx, 1) == '\n') {
+            lx.pos += 2;
+            continue;
+        }
+
+        if (c == ';') {
+            size_t start = lx.pos++;
+            while (at(&lx, 0) == ';' || at(&lx, 0) == '&') lx.pos++;
+            end_command(&lx, AC_CMD_LINK_SEQ);
+            if (lx.pos - start > 1) lx.case_patterns = 1;      /* ;; ;& ;;& end a case branch */
+            continue;
+        }
+
+        if (c == '&' && at(&lx, 1) == '&') {
+            lx.pos += 2;
+            end_command(&lx, AC_CMD_LINK_AND);
+            continue;
+        }
+        if (c == '|' && at(&lx, 1) == '|') {
+            lx.pos += 2;
+            end_command(&lx, AC_CMD_LINK_OR);
+            continue;
+        }
+        if (c == '|') {
+            if (lx.case_patterns) {
+                lx.pos++;               /* a|b) pattern alternatives */
+                continue;
+            }
+            lx.pos += at(&lx, 1) == '&' ? 2 : 1;
+            end_command(&lx, AC_CMD_LINK_PIPE);
+            continue;
+        }
+        if (c == '&' && at(&lx, 1) != '>') {
+            lx.pos++;
+            end_command(&lx, AC_CMD_LINK_BACKGROUND);
+            continue;
+        }
+
+        if (c == '(') {
+            if (lx.case_patterns) {
+                lx.pos++;               /* (pattern) form */
+                continue;
+            }
+            if (lx.cmd.word_count == 1 && lx.cmd.redir_count == 0) {
+                /* name() { ...; }: a function definition */
+                size_t p = lx.pos + 1;
+                while (p < lx.len && is_blank((unsigned char)lx.src[p])) p++;
+                if (p < lx.len && lx.src[p] == ')') {
+                    lx.pos = p + 1;
+                    builder_reset(&lx.cmd);
+                    continue;
+                }
+            }
+            if (at(&lx, 1) == '(' && builder_empty(&lx.cmd)) {
+                /* (( arithmetic )) */
+                size_t end = match_paren(lx.src, lx.pos + 2, lx.len);
+                lx.pos = end < lx.len ? end + 1 : lx.len;
+                if (at(&lx, 0) == ')') lx.pos++;
+                continue;
+            }
+            end_command(&lx, AC_CMD_LINK_SEQ);
+            lx.pos++;
+            lx.subshells++;
+            lx.depth++;
+            continue;
+        }
+
+        if (c == ')') {
+            lx.pos++;
+            if (lx.case_patterns) {
+                lx.case_patterns = 0;   /* Pattern done: the branch body follows */
+                builder_reset(&lx.cmd);
+                continue;
+            }
+            end_command(&lx, AC_CMD_LINK_END);
+            if (lx.subshells > 0) {
+                lx.subshells--;
+                lx.depth--;
+            } else {
+                parser->script->error = 1;
+            }
+            continue;
+        }
+
+        if (c == '<' || c == '>' || (c == '&' && at(&lx, 1) == '>')) {
+            if ((c == '<' || c == '>') && at(&lx, 1) == '(') {
+                word_t w = lex_word(&lx);   /* Process substitution */
+                if (w.text) add_word(&lx, &w);
+                continue;
+            }
+            if (lx.case_patterns) lx.case_patterns = 0;
+            lex_redirect(&lx, -1);
+            continue;
+        }
+
+        /* "2>" / "10<": a number directly before a redirection is its fd */
+        if (c >= '0' && c <= '9') {
+            size_t p = lx.pos;
+            while (p < lx.len && lx.src[p] >= '0' && lx.src[p] <= '9') p++;
+            if (p < lx.len && (lx.src[p] == '<' || lx.src[p] == '>') &&
+                !(p + 1 < lx.len && lx.src[p + 1] == '(')) {
+                int fd = 0;
+                for (size_t i = lx.pos; i < p && fd < 100000; i++) fd = fd * 10 + (lx.src[i] - '0');
+                lx.pos = p;
+                lex_redirect(&lx, fd);
+                continue;
+            }
+        }
+
+        word_t w = lex_word(&lx);
+        if (w.text) add_word(&lx, &w);
+    }
+
+    end_command(&lx, AC_CMD_LINK_END);
+    read_heredocs(&lx);
+    if (lx.subshells > 0) parser->script->error = 1;
+
+    free(lx.cmd.words);
+    free(lx.cmd.redirs);
+    free(lx.word.data);
+    free(lx.heredocs);
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+arc_err_t ac_cmd_parse(const char *source, ac_cmd_script_t *script) {
+    if (!script) return ARC_ERR_INVALID_ARG;
+    memset(script, 0, sizeof(*script));
+    if (!source) return ARC_ERR_INVALID_ARG;
+
+    parser_t parser = { .script = script };
+    parse_source(&parser, source, strlen(source), 0, 0);
+
+    return parser.oom ? ARC_ERR_NO_MEMORY : ARC_OK;
+}
+
+void ac_cmd_script_free(ac_cmd_script_t *script) {
+    if (!script) return;
+    arena_block_t *block = script->arena;
+    while (block) {
+        arena_block_t *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(script->commands);
+    memset(script, 0, sizeof(*script));
+}
@@ -7,6 +7,7 @@
 
 #include <arc/sandbox.h>
 #include <arc/log.h>
+#include <arc/command_policy.h>
 #include "sandbox_internal.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -225,80 +226,45 @@ int ac_sandbox_path_is_under(const char *parent, const char *child) {
  * Dangerous Command Detection
  *============================================================================*/
 
-/* Patterns that indicate dangerous commands */
-static const char *g_dangerous_patterns[] = {
-    /* Destructive file operations */
-    "rm -rf /",
-    "rm -rf /*",
-    "rm -fr /",
-    "rm -fr /*",
-    "> /dev/sd",
-    "> /dev/nv",
-    "dd if=",
-    "mkfs",
-
-    /* Privilege escalation */
-    "sudo ",
-    "su -",
-    "su root",
-    "doas ",
-
-    /* Permission changes */
-    "chmod 777 /",
-    "chmod -R 777 /",
-    "chown -R",
-
-    /* System modifications */
-    "systemctl ",
-    "service ",
-    "/etc/init.d/",
-
-    /* Network exfiltration */
-    "curl ",
-    "wget ",
-    "nc -",
-    "netcat ",
-
-    /* Shell fork bomb */
-    ":(){ :|:& };:",
-
-    /* Dangerous redirections */
-    "> /etc/",
-    ">> /etc/",
-
-    NULL
-};
-
-/* Commands that are safe even if they match dangerous patterns */
-static const char *g_safe_overrides[] = {
-    "curl --version",
-    "wget --version",
-    NULL
-};
+/*
+ * Both checks go through the shared command policy (sandbox_policy.c),
+ * which parses the command first, so quoting and wrappers don't hide
+ * the program. A command the policy cannot evaluate counts as dangerous.
+ */
 
 int ac_sandbox_is_command_dangerous(const char *command) {
     if (!command) {
         return 0;
     }
 
-    /* Check safe overrides first */
-    for (int i = 0; g_safe_overrides[i] != NULL; i++) {
-        if (strstr(command, g_safe_overrides[i]) != NULL) {
-            return 0;
-        }
+    const ac_cmd_policy_t *policy = ac_cmd_policy_default();
+    ac_cmd_verdict_t verdict;
+    if (!policy || ac_cmd_policy_eval(policy, command, &verdict) != ARC_OK) {
+        AC_LOG_WARN("Command policy unavailable, treating command as dangerous");
+        return 1;
     }
 
-    /* Check dangerous patterns */
-    for (int i = 0; g_dangerous_patterns[i] != NULL; i++) {
-        if (strstr(command, g_dangerous_patterns[i]) != NULL) {
-            AC_LOG_WARN("Dangerous command pattern detected: %s", g_dangerous_patterns[i]);
-            return 1;
-        }
+    if (verdict.action >= AC_CMD_CONFIRM) {
+        AC_LOG_WARN("Dangerous command detected: %s", verdict.reason);
+        return 1;
     }
 
     return 0;
 }
 
+int ac_sandbox_is_network_command(const char *command) {
+    if (!command) {
+        return 0;
+    }
+
+    const ac_cmd_policy_t *policy = ac_cmd_policy_default();
+    ac_cmd_verdict_t verdict;
+    if (!policy || ac_cmd_policy_eval(policy, command, &verdict) != ARC_OK) {
+        return 1;
+    }
+    return (verdict.categories & AC_CMD_CATEGORY_BIT(AC_CMD_CAT_NETWORK)) != 0;
+}
+
 /*============================================================================
  * Default Readonly Paths
  *============================================================================*/
@@ -428,6 +394,24 @@ ac_sandbox_confirm_result_t ac_sandbox_request_confirm(
     return result;
 }
 
+int ac_sandbox_check_network(ac_sandbox_t *sandbox, const char *resource) {
+    if (!sandbox) return 1;
+    if (sandbox->allow_network || sandbox->session_allow_network) return 1;
+
+    ac_sandbox_confirm_request_t request = {
+        .type = AC_SANDBOX_CONFIRM_NETWORK,
+        .resource = resource,
+        .reason = "Tool requires network access",
+        .ai_suggestion = "This will fetch data from an external server."
+    };
+    ac_sandbox_confirm_result_t result = ac_sandbox_request_confirm(sandbox, &request);
+    if (result != AC_SANDBOX_ALLOW && result != AC_SANDBOX_ALLOW_SESSION) {
+        ac_sandbox_set_denial_reason("Network access denied by user");
+        return 0;
+    }
+    return 1;
+}
+
 /**
  * @brief Get confirmation type as string
  */
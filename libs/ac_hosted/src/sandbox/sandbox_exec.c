@@ -0,0 +1,465 @@
+/**
+ * @file sandbox_exec.c
+ * @brief Sandboxed Subprocess Execution (POSIX)
+ *
+ * Runs an approved command via /bin/sh in its own process group and
+ * collects its output with poll(). The shell is started with
+ * posix_spawn(), which the C library implements with vfork-style
+ * cloning (CLONE_VM|CLONE_VFORK on glibc), so spawn latency does not
+ * grow with the agent's resident memory the way fork() does. Stdout and stderr come from separate
+ * pipes and are drained with large non-blocking reads. A monotonic
+ * deadline covers the whole run; on Linux the child's exit is observed
+ * through a pidfd, elsewhere by polling waitpid() in short slices.
+ *
+ * Once the shell has exited, output already in the pipes is drained and
+ * the run ends, even if a background job still holds the pipes open.
+ */
+
+#if !defined(_WIN32)
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "sandbox_internal.h"
+#include <arc/log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open 434     /* Same number on all architectures */
+#endif
+#endif
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+#define EXEC_READ_SIZE      65536   /* Bytes per read() */
+#define EXEC_WAIT_SLICE_MS  20      /* waitpid() polling interval without pidfd */
+
+extern char **environ;
+
+/*============================================================================
+ * Helpers
+ *============================================================================*/
+
+void ac_sandbox_sink_init(ac_sandbox_sink_t *sink, char *buf, size_t size) {
+    sink->buf = size > 0 ? buf : NULL;
+    sink->size = size;
+    sink->len = 0;
+    if (sink->buf) sink->buf[0] = '\0';
+}
+
+void ac_sandbox_sink_append(ac_sandbox_sink_t *sink, const char *data, size_t len) {
+    if (!sink->buf) return;
+    size_t room = sink->size - 1 - sink->len;
+    if (len > room) len = room;
+    memcpy(sink->buf + sink->len, data, len);
+    sink->len += len;
+    sink->buf[sink->len] = '\0';
+}
+
+long long ac_sandbox_monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int ac_sandbox_open_pipe(int fds[2]) {
+#if defined(__linux__)
+    return pipe2(fds, O_CLOEXEC);
+#else
+    if (pipe(fds) < 0) return -1;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return 0;
+#endif
+}
+
+int ac_sandbox_open_pidfd(pid_t pid) {
+#if defined(__linux__)
+    return (int)syscall(__NR_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    return -1;
+#endif
+}
+
+static void close_fd(int *fd) {
+    if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+int ac_sandbox_decode_status(int status) {
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return -1;
+}
+
+/*============================================================================
+ * Spawning
+ *============================================================================*/
+
+static int spawn_fork(const char *command, int stdin_fd, int stdout_fd, int stderr_fd,
+                      const ac_sandbox_child_setup_t *setup, pid_t *pid_out) {
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        return errno;
+    }
+
+    if (pid == 0) {
+        /* ===== Child process ===== */
+
+        /* Own process group, so a timeout can kill everything it started */
+        setpgid(0, 0);
+
+        /* Quotas first: nothing runs outside them */
+        if (setup && setup->cgroup_procs_fd >= 0 && write(setup->cgroup_procs_fd, "0", 1) != 1) {
+            static const char msg[] = "sandbox: cannot join the command's cgroup\n";
+            if (write(stderr_fd, msg, sizeof(msg) - 1) < 0) {
+                /* Nothing left to report to */
+            }
+            _exit(126);
+        }
+        if (setup) ac_sandbox_apply_rlimits(setup->limits);
+
+        /* Pipe ends are close-on-exec; the duplicates are not */
+        if (stdin_fd >= 0) dup2(stdin_fd, STDIN_FILENO);
+        dup2(stdout_fd, STDOUT_FILENO);
+        dup2(stderr_fd, STDERR_FILENO);
+
+        execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+
+        /* If execl fails */
+        fprintf(stderr, "execl failed: %s\n", strerror(errno));
+        _exit(127);
+    }
+
+    /* Also set here: whichever runs first wins, the other is a no-op */
+    setpgid(pid, pid);
+
+    *pid_out = pid;
+    return 0;
+}
+
+static int spawn_posix(const char *command, int stdin_fd, int stdout_fd, int stderr_fd,
+                       pid_t *pid_out) {
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    int err;
+
+    err = posix_spawn_file_actions_init(&actions);
+    if (err != 0) return err;
+    err = posix_spawnattr_init(&attr);
+    if (err != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        return err;
+    }
+
+    /* Pipe ends are close-on-exec; the duplicates are not */
+    if (stdin_fd >= 0) posix_spawn_file_actions_adddup2(&actions, stdin_fd, STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, stdout_fd, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, stderr_fd, STDERR_FILENO);
+
+    /* Own process group (0 = the child's pid), set before exec */
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+
+    char *const argv[] = { "sh", "-c", (char *)command, NULL };
+    err = posix_spawn(pid_out, "/bin/sh", &actions, &attr, argv, environ);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    return err;
+}
+
+int ac_sandbox_spawn_shell(
+    const char *command,
+    int stdin_fd,
+    int stdout_fd,
+    int stderr_fd,
+    ac_sandbox_spawn_method_t method,
+    const ac_sandbox_child_setup_t *setup,
+    pid_t *pid_out
+) {
+    /* posix_spawn() cannot set rlimits or join a cgroup before exec */
+    if (setup && (setup->cgroup_procs_fd >= 0 || ac_sandbox_limits_need_rlimits(setup->limits))) {
+        method = AC_SANDBOX_SPAWN_FORK;
+    }
+    if (method == AC_SANDBOX_SPAWN_FORK) {
+        return spawn_fork(command, stdin_fd, stdout_fd, stderr_fd, setup, pid_out);
+    }
+    return spawn_posix(command, stdin_fd, stdout_fd, stderr_fd, pid_out);
+}
+
+/*============================================================================
+ * Output Collection
+ *============================================================================*/
+
+typedef struct {
+    int fd[2];                          /* Read ends: stdout, stderr (-1 = closed) */
+    ac_sandbox_sink_t out;
+    ac_sandbox_sink_t err;
+    int separate_err;
+    const ac_sandbox_exec_options_t *options;
+    char *chunk;
+    int stop;                           /* Callback or output limit: kill the command */
+    size_t total;                       /* Bytes read from both pipes */
+    size_t limit;                       /* Output limit (0 = none) */
+    int limit_hit;
+} exec_io_t;
+
+/*
+ * Read everything currently available from one pipe. Closes the pipe at
+ * EOF. Returns after one read unless `drain` is set.
+ */
+static void read_pipe(exec_io_t *io, int index, int drain) {
+    ac_sandbox_stream_t stream = index == 0 ? AC_SANDBOX_STDOUT : AC_SANDBOX_STDERR;
+    ac_sandbox_sink_t *sink = (index == 1 && io->separate_err) ? &io->err : &io->out;
+
+    while (io->fd[index] >= 0) {
+        ssize_t n = read(io->fd[index], io->chunk, EXEC_READ_SIZE);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) close_fd(&io->fd[index]);
+            return;
+        }
+        if (n == 0) {
+            close_fd(&io->fd[index]);
+            return;
+        }
+        if (io->limit && io->total + (size_t)n > io->limit) {
+            /* Keep what fits, then have the command killed */
+            n = (ssize_t)(io->limit - io->total);
+            io->limit_hit = 1;
+            io->stop = 1;
+        }
+        io->total += (size_t)n;
+
+        ac_sandbox_sink_append(sink, io->chunk, (size_t)n);
+        if (io->options->on_output && n > 0 && (!io->stop || io->limit_hit) &&
+            io->options->on_output(stream, io->chunk, (size_t)n, io->options->user_data) != 0) {
+            io->stop = 1;
+        }
+        if (io->limit_hit || (!drain && (size_t)n < EXEC_READ_SIZE)) return;
+    }
+}
+
+/*============================================================================
+ * Execution
+ *============================================================================*/
+
+arc_err_t ac_sandbox_run_command(
+    const char *command,
+    char *output,
+    size_t output_size,
+    int *exit_code,
+    const ac_sandbox_exec_options_t *options,
+    const ac_sandbox_limits_t *limits
+) {
+    static const ac_sandbox_exec_options_t default_options = {0};
+    if (!options) options = &default_options;
+    long long started = ac_sandbox_monotonic_ms();
+
+    int out_pipe[2], err_pipe[2];
+    if (ac_sandbox_open_pipe(out_pipe) < 0) {
+        AC_LOG_ERROR("Failed to create pipe: %s", strerror(errno));
+        return ARC_ERR_IO;
+    }
+    if (ac_sandbox_open_pipe(err_pipe) < 0) {
+        AC_LOG_ERROR("Failed to create pipe: %s", strerror(errno));
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        return ARC_ERR_IO;
+    }
+
+    ac_sandbox_cgroup_t cgroup;
+    ac_sandbox_cgroup_create(limits, &cgroup);
+    ac_sandbox_child_setup_t setup = {
+        .limits = limits,
+        .cgroup_procs_fd = cgroup.procs_fd,
+    };
+
+    pid_t pid;
+    int spawn_err = ac_sandbox_spawn_shell(command, -1, out_pipe[1], err_pipe[1],
+                                           AC_SANDBOX_SPAWN_POSIX, &setup, &pid);
+    if (spawn_err != 0) {
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        ac_sandbox_cgroup_finish(&cgroup, NULL);
+        AC_LOG_ERROR("Failed to start /bin/sh: %s", strerror(spawn_err));
+        return ARC_ERR_IO;
+    }
+
+    close(out_pipe[1]);
+    close(err_pipe[1]);
+    fcntl(out_pipe[0], F_SETFL, fcntl(out_pipe[0], F_GETFL) | O_NONBLOCK);
+    fcntl(err_pipe[0], F_SETFL, fcntl(err_pipe[0], F_GETFL) | O_NONBLOCK);
+
+    exec_io_t io = {
+        .fd = { out_pipe[0], err_pipe[0] },
+        .separate_err = options->error_output != NULL,
+        .options = options,
+        .limit = limits ? limits->output_bytes : 0,
+    };
+    ac_sandbox_sink_init(&io.out, output, output_size);
+    ac_sandbox_sink_init(&io.err, options->error_output, options->error_output_size);
+
+    io.chunk = malloc(EXEC_READ_SIZE);
+    if (!io.chunk) {
+        kill(-pid, SIGKILL);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        close_fd(&io.fd[0]);
+        close_fd(&io.fd[1]);
+        ac_sandbox_cgroup_finish(&cgroup, NULL);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    int pidfd = ac_sandbox_open_pidfd(pid);
+    long long deadline = options->timeout_ms > 0 ? ac_sandbox_monotonic_ms() + options->timeout_ms : -1;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    int status = 0;
+    int exited = 0;
+    int timed_out = 0;
+    int failed = 0;
+
+    while (!exited && !io.stop) {
+        struct pollfd fds[3];
+        int nfds = 0;
+        int pid_index = -1;
+
+        for (int i = 0; i < 2; i++) {
+            if (io.fd[i] >= 0) {
+                fds[nfds].fd = io.fd[i];
+                fds[nfds].events = POLLIN;
+                nfds++;
+            }
+        }
+        if (pidfd >= 0) {
+            pid_index = nfds;
+            fds[nfds].fd = pidfd;
+            fds[nfds].events = POLLIN;
+            nfds++;
+        }
+
+        int wait_ms = -1;
+        if (deadline >= 0) {
+            long long left = deadline - ac_sandbox_monotonic_ms();
+            if (left <= 0) {
+                timed_out = 1;
+                break;
+            }
+            wait_ms = left > 0x7fffffff ? 0x7fffffff : (int)left;
+        }
+        if (pidfd < 0 && (wait_ms < 0 || wait_ms > EXEC_WAIT_SLICE_MS)) {
+            wait_ms = EXEC_WAIT_SLICE_MS;
+        }
+
+        int ready = poll(fds, (nfds_t)nfds, wait_ms);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            AC_LOG_ERROR("poll failed: %s", strerror(errno));
+            failed = 1;
+            break;
+        }
+
+        /* Pipes first: anything written before exit is read in order */
+        for (int i = 0; i < nfds; i++) {
+            if (i == pid_index || !fds[i].revents) continue;
+            read_pipe(&io, fds[i].fd == io.fd[0] ? 0 : 1, 0);
+        }
+
+        /* Without a pidfd, check for exit on every wakeup */
+        if (pid_index < 0 || fds[pid_index].revents) {
+            pid_t r = wait4(pid, &status, WNOHANG, &usage);
+            if (r == pid) {
+                exited = 1;
+            } else if (r < 0 && errno != EINTR) {
+                AC_LOG_ERROR("waitpid failed: %s", strerror(errno));
+                failed = 1;
+                break;
+            }
+        }
+    }
+
+    if (exited) {
+        /* Collect what the command wrote; don't wait for background jobs */
+        read_pipe(&io, 0, 1);
+        read_pipe(&io, 1, 1);
+    } else {
+        /* Timeout, callback stop or error: take down the whole group */
+        kill(-pid, SIGKILL);
+        kill(pid, SIGKILL);
+        while (wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {
+        }
+    }
+
+    if (pidfd >= 0) close(pidfd);
+    close_fd(&io.fd[0]);
+    close_fd(&io.fd[1]);
+    free(io.chunk);
+
+    ac_sandbox_exec_stats_t *stats = options->stats;
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+        stats->wall_ms = ac_sandbox_monotonic_ms() - started;
+        stats->user_cpu_ms = (long long)usage.ru_utime.tv_sec * 1000 + usage.ru_utime.tv_usec / 1000;
+        stats->system_cpu_ms = (long long)usage.ru_stime.tv_sec * 1000 + usage.ru_stime.tv_usec / 1000;
+#if defined(__APPLE__)
+        stats->max_rss_bytes = (size_t)usage.ru_maxrss;             /* bytes on macOS */
+#else
+        stats->max_rss_bytes = (size_t)usage.ru_maxrss * 1024;      /* KiB elsewhere */
+#endif
+        stats->output_bytes = io.total;
+        if (io.limit_hit) {
+            stats->limit_hit = AC_SANDBOX_LIMIT_OUTPUT;
+        } else if (limits && limits->cpu_seconds && WIFSIGNALED(status) &&
+                   (WTERMSIG(status) == SIGXCPU ||
+                    (WTERMSIG(status) == SIGKILL &&
+                     stats->user_cpu_ms + stats->system_cpu_ms >= (long long)limits->cpu_seconds * 1000))) {
+            stats->limit_hit = AC_SANDBOX_LIMIT_CPU;
+        }
+    }
+    ac_sandbox_cgroup_finish(&cgroup, stats);
+    if (io.limit_hit) {
+        AC_LOG_WARN("Command killed after %zu bytes of output", io.total);
+    }
+
+    if (failed) {
+        if (exit_code) *exit_code = -1;
+        return ARC_ERR_IO;
+    }
+
+    if (timed_out) {
+        AC_LOG_WARN("Command timed out after %d ms", options->timeout_ms);
+        if (exit_code) *exit_code = -1;
+        return ARC_ERR_TIMEOUT;
+    }
+
+    if (exit_code) *exit_code = ac_sandbox_decode_status(status);
+    return ARC_OK;
+}
+
+#endif /* !_WIN32 */
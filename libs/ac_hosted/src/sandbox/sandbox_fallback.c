@@ -30,7 +30,6 @@
 #define PATH_SEP '\\'
 #else
 #include <unistd.h>
-#include <sys/wait.h>
 #define PATH_SEP '/'
 #endif
 
@@ -137,6 +136,10 @@ ac_sandbox_t *ac_sandbox_create(const ac_sandbox_config_t *config) {
     sandbox->allow_process_exec = config->allow_process_exec;
     sandbox->strict_mode = config->strict_mode;
     sandbox->log_violations = config->log_violations;
+    sandbox->limits = config->limits;
+    if (config->limits.cgroup_parent) {
+        sandbox->limits.cgroup_parent = strdup(config->limits.cgroup_parent);
+    }
 
     /* Copy path rules */
     if (config->path_rules && config->path_rules_count > 0) {
@@ -215,6 +218,7 @@ void ac_sandbox_destroy(ac_sandbox_t *sandbox) {
         free(data);
     }
 
+    free((void *)sandbox->limits.cgroup_parent);
     free(sandbox->workspace_path);
 
     if (sandbox->path_rules) {
@@ -456,38 +460,38 @@ int ac_sandbox_check_command(
 
     /* Check for network commands if network is disabled */
     if (!sandbox->allow_network && !sandbox->session_allow_network) {
+        int is_network;
 #if defined(_WIN32)
+        /* cmd.exe / PowerShell syntax is not understood by the shell parser */
         const char *net_commands[] = {
             "curl", "wget", "Invoke-WebRequest", "Invoke-RestMethod",
             "ssh", "scp", "sftp", "ftp", "telnet", NULL
         };
+        is_network = 0;
+        for (int i = 0; net_commands[i] && !is_network; i++) {
+            if (strstr(command, net_commands[i]) &&
+                !strstr(command, "--version") && !strstr(command, "/version") &&
+                !strstr(command, "/?")) {
+                is_network = 1;
+            }
+        }
 #else
-        const char *net_commands[] = {
-            "curl", "wget", "nc", "netcat", "ssh", "scp", NULL
-        };
+        is_network = ac_sandbox_is_network_command(command);
 #endif
-        for (int i = 0; net_commands[i]; i++) {
-            if (strstr(command, net_commands[i])) {
-                if (strstr(command, "--version") || strstr(command, "-V") ||
-                    strstr(command, "/version") || strstr(command, "/?")) {
-                    continue;
-                }
-
-                ac_sandbox_confirm_request_t request = {
-                    .type = AC_SANDBOX_CONFIRM_NETWORK,
-                    .resource = command,
-                    .reason = "Command requires network access",
-                    .ai_suggestion = "This command will access the network."
-                };
+        if (is_network) {
+            ac_sandbox_confirm_request_t request = {
+                .type = AC_SANDBOX_CONFIRM_NETWORK,
+                .resource = command,
+                .reason = "Command requires network access",
+                .ai_suggestion = "This command will access the network."
+            };
 
-                ac_sandbox_confirm_result_t result = ac_sandbox_request_confirm(
-                    (ac_sandbox_t *)sandbox, &request);
+            ac_sandbox_confirm_result_t result = ac_sandbox_request_confirm(
+                (ac_sandbox_t *)sandbox, &request);
 
-                if (result != AC_SANDBOX_ALLOW && result != AC_SANDBOX_ALLOW_SESSION) {
-                    ac_sandbox_set_denial_reason("Network command denied by user");
-                    return 0;
-                }
-                break;
+            if (result != AC_SANDBOX_ALLOW && result != AC_SANDBOX_ALLOW_SESSION) {
+                ac_sandbox_set_denial_reason("Network command denied by user");
+                return 0;
             }
         }
     }
@@ -499,13 +503,13 @@ int ac_sandbox_check_command(
  * Sandboxed Subprocess Execution (Fallback - Software filtering only)
  *============================================================================*/
 
-arc_err_t ac_sandbox_exec_timeout(
+arc_err_t ac_sandbox_exec_ex(
     ac_sandbox_t *sandbox,
     const char *command,
     char *output,
     size_t output_size,
     int *exit_code,
-    int timeout_ms
+    const ac_sandbox_exec_options_t *options
 ) {
     if (!sandbox || !command) {
         return ARC_ERR_INVALID_ARG;
@@ -550,54 +554,39 @@ arc_err_t ac_sandbox_exec_timeout(
                 total_read += to_copy;
                 output[total_read] = '\0';
             }
+            if (options && options->on_output &&
+                options->on_output(AC_SANDBOX_STDOUT, buf, len, options->user_data) != 0) {
+                break;
+            }
         }
     }
 
     int status = _pclose(fp);
     if (exit_code) *exit_code = status;
 
+    /* Timeout and separate stderr are not implemented on Windows */
+    return ARC_OK;
 #else
-    /* Non-Windows fallback using popen (no kernel sandbox) */
-    FILE *fp = popen(command, "r");
-    if (!fp) {
-        if (output && output_size > 0) {
-            snprintf(output, output_size,
-                     "{\"error\":\"Failed to execute command\"}");
-        }
-        if (exit_code) *exit_code = -1;
-        return ARC_ERR_IO;
-    }
+    /* Non-Windows fallback: same process handling as the kernel backends */
+    arc_err_t err = ac_sandbox_run_command(command, output, output_size, exit_code, options,
+                                           &sandbox->limits);
 
-    if (output && output_size > 0) {
-        output[0] = '\0';
-        size_t total_read = 0;
-        char buf[256];
-
-        while (fgets(buf, sizeof(buf), fp) != NULL) {
-            size_t len = strlen(buf);
-            size_t remaining = output_size - total_read - 1;
-            if (remaining > 0) {
-                size_t to_copy = len < remaining ? len : remaining;
-                memcpy(output + total_read, buf, to_copy);
-                total_read += to_copy;
-                output[total_read] = '\0';
-            }
-        }
-    }
-
-    int status = pclose(fp);
-    if (exit_code) {
-        if (WIFEXITED(status)) {
-            *exit_code = WEXITSTATUS(status);
-        } else {
-            *exit_code = -1;
-        }
-    }
+    /* The command may have moved directories or planted symlinks */
+    ac_sandbox_invalidate_path_cache(sandbox);
+    return err;
 #endif
+}
 
-    (void)timeout_ms;  /* Timeout not implemented in fallback */
-
-    return ARC_OK;
+arc_err_t ac_sandbox_exec_timeout(
+    ac_sandbox_t *sandbox,
+    const char *command,
+    char *output,
+    size_t output_size,
+    int *exit_code,
+    int timeout_ms
+) {
+    ac_sandbox_exec_options_t options = { .timeout_ms = timeout_ms };
+    return ac_sandbox_exec_ex(sandbox, command, output, output_size, exit_code, &options);
 }
 
 arc_err_t ac_sandbox_exec(
@@ -29,6 +29,7 @@ struct ac_sandbox {
     int allow_process_exec;
     int strict_mode;
     int log_violations;
+    ac_sandbox_limits_t limits;     /* cgroup_parent is owned (strdup) */
 
     /* State */
     int is_active;
@@ -44,6 +45,9 @@ struct ac_sandbox {
     int session_allow_external_paths;
     int session_allow_network;
 
+    /* Compiled path permissions (NULL = walk the lists) */
+    struct ac_sandbox_path_index *path_index;
+
     /* Platform-specific data */
     void *platform_data;
 };
@@ -84,7 +88,7 @@ int ac_sandbox_normalize_path(const char *path, char *buffer, size_t size);
 int ac_sandbox_path_is_under(const char *parent, const char *child);
 
 /**
- * @brief Check if command contains dangerous patterns
+ * @brief Check if the command policy wants a command confirmed or denied
  */
 int ac_sandbox_is_command_dangerous(const char *command);
 
@@ -93,6 +97,176 @@ int ac_sandbox_is_command_dangerous(const char *command);
  */
 const char **ac_sandbox_get_default_readonly_paths(void);
 
+/**
+ * @brief Check if a command needs the network (for the allow_network check)
+ */
+int ac_sandbox_is_network_command(const char *command);
+
+/*============================================================================
+ * Path Permission Index (from sandbox_pathindex.c)
+ *============================================================================*/
+
+typedef struct ac_sandbox_path_index ac_sandbox_path_index_t;
+
+/**
+ * @brief Compile the workspace, path rules and readonly paths of a sandbox
+ * @return Index, or NULL (out of memory, Windows): checks walk the lists
+ */
+ac_sandbox_path_index_t *ac_sandbox_path_index_create(const ac_sandbox_t *sandbox);
+
+void ac_sandbox_path_index_free(ac_sandbox_path_index_t *index);
+
+/**
+ * @brief Check a path against the configured paths (no confirmation)
+ * @return 1 if the configuration grants the permissions, 0 otherwise
+ */
+int ac_sandbox_path_allowed(const ac_sandbox_t *sandbox, const char *path, unsigned int permissions);
+
+/*============================================================================
+ * Command Parsing (from sandbox_cmdparse.c)
+ *============================================================================*/
+
+/**
+ * @brief argv index of the command a wrapper program runs
+ *
+ * For wrappers such as env, sudo, nice or timeout, skips their options
+ * and operands. Returns -1 if argv[index] is not a wrapper or runs
+ * nothing.
+ */
+int ac_cmd_wrapped_program(const char **argv, int argc, int index);
+
+/*============================================================================
+ * Process Execution (from sandbox_exec.c, POSIX only)
+ *============================================================================*/
+
+#if !defined(_WIN32)
+
+#include <sys/types.h>
+
+/**
+ * @brief How the shell process is created
+ */
+typedef enum {
+    AC_SANDBOX_SPAWN_POSIX = 0,         /* posix_spawn(): no page-table copy */
+    AC_SANDBOX_SPAWN_FORK,              /* fork() + execl(): cost grows with RSS */
+} ac_sandbox_spawn_method_t;
+
+/**
+ * @brief Work done in the child between fork and exec
+ */
+typedef struct {
+    const ac_sandbox_limits_t *limits;  /* rlimits to set (NULL = none) */
+    int cgroup_procs_fd;                /* cgroup.procs to join (-1 = none) */
+} ac_sandbox_child_setup_t;
+
+/**
+ * @brief Start "/bin/sh -c command" in a new process group
+ *
+ * stdin_fd (-1 = inherit), stdout_fd and stderr_fd become the child's
+ * standard streams; they should be close-on-exec in the parent. A setup
+ * that sets rlimits or joins a cgroup needs code in the child, so it
+ * always uses AC_SANDBOX_SPAWN_FORK.
+ *
+ * @return 0 on success, errno value on failure
+ */
+int ac_sandbox_spawn_shell(
+    const char *command,
+    int stdin_fd,
+    int stdout_fd,
+    int stderr_fd,
+    ac_sandbox_spawn_method_t method,
+    const ac_sandbox_child_setup_t *setup,
+    pid_t *pid_out
+);
+
+/*============================================================================
+ * Resource Limits (from sandbox_limits.c, POSIX only)
+ *============================================================================*/
+
+/**
+ * @brief Whether limits need setrlimit() calls in the child
+ */
+int ac_sandbox_limits_need_rlimits(const ac_sandbox_limits_t *limits);
+
+/**
+ * @brief Set the rlimits in the current process (async-signal-safe)
+ */
+void ac_sandbox_apply_rlimits(const ac_sandbox_limits_t *limits);
+
+/**
+ * @brief Per-command cgroup
+ */
+typedef struct {
+    char path[512];                     /* Empty = not in use */
+    int procs_fd;                       /* cgroup.procs, for the child to join */
+} ac_sandbox_cgroup_t;
+
+/**
+ * @brief Create a cgroup under limits->cgroup_parent with the limits set
+ * @return 0 on success, -1 if cgroups are not configured or usable
+ */
+int ac_sandbox_cgroup_create(const ac_sandbox_limits_t *limits, ac_sandbox_cgroup_t *cg);
+
+/**
+ * @brief Kill what is left in the cgroup, read its usage and remove it
+ */
+void ac_sandbox_cgroup_finish(ac_sandbox_cgroup_t *cg, ac_sandbox_exec_stats_t *stats);
+
+/**
+ * @brief Caller-provided output buffer, filled up to its size
+ */
+typedef struct {
+    char *buf;                          /* NULL = discard */
+    size_t size;
+    size_t len;
+} ac_sandbox_sink_t;
+
+void ac_sandbox_sink_init(ac_sandbox_sink_t *sink, char *buf, size_t size);
+
+/**
+ * @brief Append as much as fits, keeping the buffer NUL-terminated
+ */
+void ac_sandbox_sink_append(ac_sandbox_sink_t *sink, const char *data, size_t len);
+
+/**
+ * @brief Create a pipe with both ends close-on-exec
+ * @return 0 on success, -1 on error (errno set)
+ */
+int ac_sandbox_open_pipe(int fds[2]);
+
+/**
+ * @brief Monotonic clock in milliseconds
+ */
+long long ac_sandbox_monotonic_ms(void);
+
+/**
+ * @brief pidfd for a child, or -1 where unavailable (non-Linux, pre-5.3)
+ */
+int ac_sandbox_open_pidfd(pid_t pid);
+
+/**
+ * @brief Exit code from a waitpid() status (128 + signal if killed)
+ */
+int ac_sandbox_decode_status(int status);
+
+/**
+ * @brief Run a command via /bin/sh in its own process group
+ *
+ * Implements the I/O, deadline, limit and kill handling of
+ * ac_sandbox_exec_ex(). The command must already have passed the
+ * sandbox checks. limits may be NULL.
+ */
+arc_err_t ac_sandbox_run_command(
+    const char *command,
+    char *output,
+    size_t output_size,
+    int *exit_code,
+    const ac_sandbox_exec_options_t *options,
+    const ac_sandbox_limits_t *limits
+);
+
+#endif /* !_WIN32 */
+
 /*============================================================================
  * Platform Detection Helpers
  *============================================================================*/
@@ -0,0 +1,244 @@
+/**
+ * @file sandbox_limits.c
+ * @brief Resource limits for sandboxed commands (POSIX)
+ *
+ * rlimits are set in the child between fork() and exec(), so only
+ * async-signal-safe calls are used there. Per-command cgroups are
+ * created under a delegated cgroup v2 directory: the limit files are
+ * written before the command starts, the child joins the cgroup by
+ * writing "0" to its cgroup.procs, and once the command has ended the
+ * cgroup is killed, its counters read and the directory removed.
+ */
+
+#if !defined(_WIN32)
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "sandbox_internal.h"
+#include <arc/log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/*============================================================================
+ * rlimits
+ *============================================================================*/
+
+int ac_sandbox_limits_need_rlimits(const ac_sandbox_limits_t *limits) {
+    return limits && (limits->cpu_seconds || limits->address_space_bytes ||
+                      limits->open_files || limits->processes);
+}
+
+/* Lower one limit, never above the current hard limit */
+static void lower_limit(int resource, rlim_t soft, rlim_t hard) {
+    struct rlimit rl;
+    if (getrlimit(resource, &rl) != 0) return;
+    if (rl.rlim_max != RLIM_INFINITY) {
+        if (hard > rl.rlim_max) hard = rl.rlim_max;
+        if (soft > hard) soft = hard;
+    }
+    rl.rlim_cur = soft;
+    rl.rlim_max = hard;
+    setrlimit(resource, &rl);
+}
+
+void ac_sandbox_apply_rlimits(const ac_sandbox_limits_t *limits) {
+    if (!limits) return;
+
+    /* SIGXCPU at the soft limit, SIGKILL a second later */
+    if (limits->cpu_seconds) {
+        lower_limit(RLIMIT_CPU, limits->cpu_seconds, (rlim_t)limits->cpu_seconds + 1);
+    }
+    if (limits->address_space_bytes) {
+        lower_limit(RLIMIT_AS, limits->address_space_bytes, limits->address_space_bytes);
+    }
+    if (limits->open_files) {
+        lower_limit(RLIMIT_NOFILE, limits->open_files, limits->open_files);
+    }
+#if defined(RLIMIT_NPROC)
+    if (limits->processes) {
+        lower_limit(RLIMIT_NPROC, limits->processes, limits->processes);
+    }
+#endif
+}
+
+/*============================================================================
+ * cgroup v2
+ *============================================================================*/
+
+#if defined(__linux__)
+
+static int write_file(const char *dir, const char *name, const char *value) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = write(fd, value, strlen(value));
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return n == (ssize_t)strlen(value) ? 0 : -1;
+}
+
+static int read_file(const char *dir, const char *name, char *buf, size_t size) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n < 0) return -1;
+    buf[n] = '\0';
+    return 0;
+}
+
+/* Value of "key N" in a flat-keyed file such as cpu.stat (-1 = absent) */
+static long long read_keyed(const char *dir, const char *name, const char *key) {
+    char buf[1024];
+    if (read_file(dir, name, buf, sizeof(buf)) < 0) return -1;
+    size_t klen = strlen(key);
+    char *line = buf;
+    while (line && *line) {
+        if (strncmp(line, key, klen) == 0 && line[klen] == ' ') {
+            return strtoll(line + klen + 1, NULL, 10);
+        }
+        line = strchr(line, '\n');
+        if (line) line++;
+    }
+    return -1;
+}
+
+static long long read_number(const char *dir, const char *name) {
+    char buf[64];
+    if (read_file(dir, name, buf, sizeof(buf)) < 0) return -1;
+    return strtoll(buf, NULL, 10);
+}
+
+/* Write a limit file, enabling its controller in the parent if needed */
+static int set_limit(const ac_sandbox_cgroup_t *cg, const char *parent,
+                     const char *controller, const char *file, const char *value) {
+    if (write_file(cg->path, file, value) == 0) return 0;
+    if (errno != ENOENT) return -1;
+
+    char enable[32];
+    snprintf(enable, sizeof(enable), "+%s", controller);
+    write_file(parent, "cgroup.subtree_control", enable);
+    return write_file(cg->path, file, value);
+}
+
+int ac_sandbox_cgroup_create(const ac_sandbox_limits_t *limits, ac_sandbox_cgroup_t *cg) {
+    static unsigned int s_counter = 0;
+    static int s_warned = 0;
+
+    cg->path[0] = '\0';
+    cg->procs_fd = -1;
+    if (!limits || !limits->cgroup_parent) {
+        return -1;
+    }
+
+    const char *parent = limits->cgroup_parent;
+    unsigned int id = __sync_fetch_and_add(&s_counter, 1);
+    int n = snprintf(cg->path, sizeof(cg->path), "%s/arc-%ld-%u", parent, (long)getpid(), id);
+    if (n < 0 || (size_t)n >= sizeof(cg->path) || mkdir(cg->path, 0755) != 0) {
+        if (!s_warned) {
+            s_warned = 1;
+            AC_LOG_WARN("cgroup limits unavailable under %s: %s", parent, strerror(errno));
+        }
+        cg->path[0] = '\0';
+        return -1;
+    }
+
+    char value[64];
+    int rc = 0;
+    if (limits->memory_max_bytes) {
+        snprintf(value, sizeof(value), "%zu", limits->memory_max_bytes);
+        rc |= set_limit(cg, parent, "memory", "memory.max", value);
+        /* Without this, hitting memory.max swaps instead of failing */
+        write_file(cg->path, "memory.swap.max", "0");
+    }
+    if (limits->pids_max) {
+        snprintf(value, sizeof(value), "%u", limits->pids_max);
+        rc |= set_limit(cg, parent, "pids", "pids.max", value);
+    }
+    if (limits->cpu_max_percent) {
+        snprintf(value, sizeof(value), "%u 100000", limits->cpu_max_percent * 1000);
+        rc |= set_limit(cg, parent, "cpu", "cpu.max", value);
+    }
+
+    char procs[600];
+    snprintf(procs, sizeof(procs), "%s/cgroup.procs", cg->path);
+    cg->procs_fd = rc == 0 ? open(procs, O_WRONLY | O_CLOEXEC) : -1;
+    if (cg->procs_fd < 0) {
+        if (!s_warned) {
+            s_warned = 1;
+            AC_LOG_WARN("cgroup limits unavailable under %s: %s", parent, strerror(errno));
+        }
+        rmdir(cg->path);
+        cg->path[0] = '\0';
+        return -1;
+    }
+    return 0;
+}
+
+void ac_sandbox_cgroup_finish(ac_sandbox_cgroup_t *cg, ac_sandbox_exec_stats_t *stats) {
+    if (cg->procs_fd >= 0) {
+        close(cg->procs_fd);
+        cg->procs_fd = -1;
+    }
+    if (!cg->path[0]) {
+        return;
+    }
+
+    /* Background jobs do not outlive the command */
+    write_file(cg->path, "cgroup.kill", "1");
+
+    if (stats) {
+        long long v;
+        stats->in_cgroup = 1;
+        if ((v = read_number(cg->path, "memory.peak")) > 0) stats->cgroup_memory_peak_bytes = (size_t)v;
+        if ((v = read_number(cg->path, "pids.peak")) > 0) stats->cgroup_pids_peak = (unsigned int)v;
+        if ((v = read_keyed(cg->path, "cpu.stat", "usage_usec")) >= 0) stats->cgroup_cpu_ms = v / 1000;
+        if (stats->limit_hit == AC_SANDBOX_LIMIT_NONE) {
+            if (read_keyed(cg->path, "memory.events", "oom_kill") > 0) {
+                stats->limit_hit = AC_SANDBOX_LIMIT_MEMORY;
+            } else if (read_keyed(cg->path, "pids.events", "max") > 0) {
+                stats->limit_hit = AC_SANDBOX_LIMIT_PROCESSES;
+            }
+        }
+    }
+
+    /* Killed processes leave asynchronously: retry for up to ~200 ms */
+    for (int i = 0; i < 100 && rmdir(cg->path) != 0 && errno == EBUSY; i++) {
+        struct timespec ts = { 0, 2000000 };
+        nanosleep(&ts, NULL);
+    }
+    cg->path[0] = '\0';
+}
+
+#else /* !__linux__ */
+
+int ac_sandbox_cgroup_create(const ac_sandbox_limits_t *limits, ac_sandbox_cgroup_t *cg) {
+    (void)limits;
+    cg->path[0] = '\0';
+    cg->procs_fd = -1;
+    return -1;
+}
+
+void ac_sandbox_cgroup_finish(ac_sandbox_cgroup_t *cg, ac_sandbox_exec_stats_t *stats) {
+    (void)cg;
+    (void)stats;
+}
+
+#endif /* __linux__ */
+
+#endif /* !_WIN32 */
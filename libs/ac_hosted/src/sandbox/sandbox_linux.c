@@ -527,6 +527,10 @@ ac_sandbox_t *ac_sandbox_create(const ac_sandbox_config_t *config) {
     sandbox->allow_process_exec = config->allow_process_exec;
     sandbox->strict_mode = config->strict_mode;
     sandbox->log_violations = config->log_violations;
+    sandbox->limits = config->limits;
+    if (config->limits.cgroup_parent) {
+        sandbox->limits.cgroup_parent = strdup(config->limits.cgroup_parent);
+    }
 
     /* Copy path rules */
     if (config->path_rules && config->path_rules_count > 0) {
@@ -561,6 +565,9 @@ ac_sandbox_t *ac_sandbox_create(const ac_sandbox_config_t *config) {
     AC_LOG_INFO("Created sandbox (backend=%s, level=%d)",
                 ac_sandbox_backend_name(), sandbox->level);
 
+    /* Compile path permissions; checks walk the lists without it */
+    sandbox->path_index = ac_sandbox_path_index_create(sandbox);
+
     return sandbox;
 }
 
@@ -639,6 +646,8 @@ void ac_sandbox_destroy(ac_sandbox_t *sandbox) {
         free(data);
     }
 
+    ac_sandbox_path_index_free(sandbox->path_index);
+    free((void *)sandbox->limits.cgroup_parent);
     free(sandbox->workspace_path);
 
     if (sandbox->path_rules) {
@@ -672,42 +681,11 @@ int ac_sandbox_check_path(
         return 0;
     }
 
-    /* Check workspace path */
-    if (sandbox->workspace_path &&
-        ac_sandbox_path_is_under(sandbox->workspace_path, path)) {
+    /* Check workspace, custom path rules and readonly paths */
+    if (ac_sandbox_path_allowed(sandbox, path, permissions)) {
         return 1;
     }
 
-    /* Check custom path rules */
-    for (size_t i = 0; i < sandbox->path_rules_count; i++) {
-        const ac_sandbox_path_rule_t *rule = &sandbox->path_rules[i];
-        if (ac_sandbox_path_is_under(rule->path, path)) {
-            if ((rule->permissions & permissions) == permissions) {
-                return 1;
-            }
-        }
-    }
-
-    /* Check readonly paths */
-    if ((permissions & ~AC_SANDBOX_PERM_FS_READ) == 0) {
-        /* Only read permission requested */
-        if (sandbox->readonly_paths) {
-            for (int i = 0; sandbox->readonly_paths[i]; i++) {
-                if (ac_sandbox_path_is_under(sandbox->readonly_paths[i], path)) {
-                    return 1;
-                }
-            }
-        }
-
-        /* Check default readonly paths */
-        const char **defaults = ac_sandbox_get_default_readonly_paths();
-        for (int i = 0; defaults[i]; i++) {
-            if (ac_sandbox_path_is_under(defaults[i], path)) {
-                return 1;
-            }
-        }
-    }
-
     /* Path not in allowed list - request human confirmation */
 
     /* Check if session-level permission was granted */
@@ -789,31 +767,22 @@ int ac_sandbox_check_command(
 
     /* Check for network commands if network is disabled */
     if (!sandbox->allow_network && !sandbox->session_allow_network) {
-        const char *net_commands[] = {"curl", "wget", "nc", "netcat", "ssh", "scp", NULL};
-        for (int i = 0; net_commands[i]; i++) {
-            if (strstr(command, net_commands[i])) {
-                /* Allow version checks */
-                if (strstr(command, "--version") || strstr(command, "-V")) {
-                    continue;
-                }
-
-                /* Request human confirmation */
-                ac_sandbox_confirm_request_t request = {
-                    .type = AC_SANDBOX_CONFIRM_NETWORK,
-                    .resource = command,
-                    .reason = "Command requires network access",
-                    .ai_suggestion = "This command will access the network. "
-                                     "It may download files or send data to external servers."
-                };
-
-                ac_sandbox_confirm_result_t result = ac_sandbox_request_confirm(
-                    (ac_sandbox_t *)sandbox, &request);
-
-                if (result != AC_SANDBOX_ALLOW && result != AC_SANDBOX_ALLOW_SESSION) {
-                    ac_sandbox_set_denial_reason("Network command denied by user");
-                    return 0;
-                }
-                break;  /* User approved, no need to check other patterns */
+        if (ac_sandbox_is_network_command(command)) {
+            /* Request human confirmation */
+            ac_sandbox_confirm_request_t request = {
+                .type = AC_SANDBOX_CONFIRM_NETWORK,
+                .resource = command,
+                .reason = "Command requires network access",
+                .ai_suggestion = "This command will access the network. "
+                                 "It may download files or send data to external servers."
+            };
+
+            ac_sandbox_confirm_result_t result = ac_sandbox_request_confirm(
+                (ac_sandbox_t *)sandbox, &request);
+
+            if (result != AC_SANDBOX_ALLOW && result != AC_SANDBOX_ALLOW_SESSION) {
+                ac_sandbox_set_denial_reason("Network command denied by user");
+                return 0;
             }
         }
     }
@@ -825,13 +794,13 @@ int ac_sandbox_check_command(
  * Sandboxed Subprocess Execution
  *============================================================================*/
 
-arc_err_t ac_sandbox_exec_timeout(
+arc_err_t ac_sandbox_exec_ex(
     ac_sandbox_t *sandbox,
     const char *command,
     char *output,
     size_t output_size,
     int *exit_code,
-    int timeout_ms
+    const ac_sandbox_exec_options_t *options
 ) {
     if (!sandbox || !command) {
         return ARC_ERR_INVALID_ARG;
@@ -848,139 +817,38 @@ arc_err_t ac_sandbox_exec_timeout(
         return ARC_ERR_INVALID_ARG;
     }
 
-    /* Create pipe for capturing output */
-    int pipefd[2];
-    if (pipe(pipefd) < 0) {
-        AC_LOG_ERROR("Failed to create pipe: %s", strerror(errno));
-        return ARC_ERR_IO;
-    }
-
-    pid_t pid = fork();
-
-    if (pid < 0) {
-        /* Fork failed */
-        close(pipefd[0]);
-        close(pipefd[1]);
-        AC_LOG_ERROR("Fork failed: %s", strerror(errno));
-        return ARC_ERR_IO;
-    }
-
-    if (pid == 0) {
-        /* ===== Child process ===== */
-
-        /* Close read end of pipe */
-        close(pipefd[0]);
-
-        /* Redirect stdout and stderr to pipe */
-        dup2(pipefd[1], STDOUT_FILENO);
-        dup2(pipefd[1], STDERR_FILENO);
-        close(pipefd[1]);
-
-        /*
-         * NOTE: We do NOT enter Landlock sandbox in child process.
-         *
-         * Reason: Landlock has compatibility issues with special filesystems
-         * like /dev, /proc, /sys which are needed by many commands (git, etc.)
-         *
-         * Security is ensured by:
-         * 1. Software-level command validation (ac_sandbox_check_command)
-         * 2. Human-in-the-loop confirmation for dangerous operations
-         * 3. The command has already been approved before reaching here
-         *
-         * This approach trades kernel-level enforcement for better compatibility
-         * while maintaining security through explicit user consent.
-         */
-
-        /* Execute command via shell */
-        execl("/bin/sh", "sh", "-c", command, (char *)NULL);
-
-        /* If execl fails */
-        fprintf(stderr, "execl failed: %s\n", strerror(errno));
-        _exit(127);
-    }
-
-    /* ===== Parent process ===== */
-
-    /* Close write end of pipe */
-    close(pipefd[1]);
-
-    /* Set up for reading with optional timeout */
-    if (output && output_size > 0) {
-        output[0] = '\0';
-        size_t total_read = 0;
-        char buf[256];
-        ssize_t n;
-
-        /* TODO: Implement proper timeout with select/poll if needed */
-        while ((n = read(pipefd[0], buf, sizeof(buf) - 1)) > 0) {
-            buf[n] = '\0';
-            size_t remaining = output_size - total_read - 1;
-            if (remaining > 0) {
-                size_t to_copy = (size_t)n < remaining ? (size_t)n : remaining;
-                memcpy(output + total_read, buf, to_copy);
-                total_read += to_copy;
-                output[total_read] = '\0';
-            }
-        }
-    }
-
-    close(pipefd[0]);
-
-    /* Wait for child process */
-    int status;
-    pid_t wait_result;
-
-    if (timeout_ms > 0) {
-        /* Implement timeout with alarm or polling */
-        int waited_ms = 0;
-        int interval_ms = 10;
-
-        while (waited_ms < timeout_ms) {
-            wait_result = waitpid(pid, &status, WNOHANG);
-            if (wait_result == pid) {
-                break;
-            } else if (wait_result < 0) {
-                AC_LOG_ERROR("waitpid failed: %s", strerror(errno));
-                return ARC_ERR_IO;
-            }
-
-            usleep(interval_ms * 1000);
-            waited_ms += interval_ms;
-        }
-
-        if (waited_ms >= timeout_ms) {
-            /* Timeout - kill child process */
-            kill(pid, SIGKILL);
-            waitpid(pid, &status, 0);
-
-            if (output && output_size > 0) {
-                snprintf(output, output_size,
-                         "{\"error\":\"Command timed out after %d ms\"}", timeout_ms);
-            }
-            if (exit_code) *exit_code = -1;
-            return ARC_ERR_TIMEOUT;
-        }
-    } else {
-        /* No timeout - wait indefinitely */
-        wait_result = waitpid(pid, &status, 0);
-        if (wait_result < 0) {
-            AC_LOG_ERROR("waitpid failed: %s", strerror(errno));
-            return ARC_ERR_IO;
-        }
-    }
-
-    /* Extract exit code */
-    if (exit_code) {
-        if (WIFEXITED(status)) {
-            *exit_code = WEXITSTATUS(status);
-        } else if (WIFSIGNALED(status)) {
-            *exit_code = 128 + WTERMSIG(status);
-        } else {
-            *exit_code = -1;
-        }
-    }
+    /*
+     * NOTE: We do NOT enter Landlock sandbox in child process.
+     *
+     * Reason: Landlock has compatibility issues with special filesystems
+     * like /dev, /proc, /sys which are needed by many commands (git, etc.)
+     *
+     * Security is ensured by:
+     * 1. Software-level command validation (ac_sandbox_check_command)
+     * 2. Human-in-the-loop confirmation for dangerous operations
+     * 3. The command has already been approved before reaching here
+     *
+     * This approach trades kernel-level enforcement for better compatibility
+     * while maintaining security through explicit user consent.
+     */
+    arc_err_t err = ac_sandbox_run_command(command, output, output_size, exit_code, options,
+                                           &sandbox->limits);
+
+    /* The command may have moved directories or planted symlinks */
+    ac_sandbox_invalidate_path_cache(sandbox);
+    return err;
+}
 
-    return ARC_OK;
+arc_err_t ac_sandbox_exec_timeout(
+    ac_sandbox_t *sandbox,
+    const char *command,
+    char *output,
+    size_t output_size,
+    int *exit_code,
+    int timeout_ms
+) {
+    ac_sandbox_exec_options_t options = { .timeout_ms = timeout_ms };
+    return ac_sandbox_exec_ex(sandbox, command, output, output_size, exit_code, &options);
 }
 
 arc_err_t ac_sandbox_exec(
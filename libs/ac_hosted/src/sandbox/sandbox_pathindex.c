@@ -0,0 +1,662 @@
+/**
+ * @file sandbox_pathindex.c
+ * @brief Compiled path permissions for ac_sandbox_check_path()
+ *
+ * The workspace, path rules and readonly paths of a sandbox are compiled
+ * once into a trie keyed by path component. Every node carries the set
+ * of permission requests granted at that point (its own rules plus those
+ * inherited from its ancestors), so a check is one walk down the
+ * components of the canonical path.
+ *
+ * Canonicalization resolves the directory part of a path through a
+ * bounded cache of realpath() results. Each cached directory also
+ * remembers which of its entries are symlinks, so only a path whose last
+ * component is a symlink needs a realpath() of its own. In the common
+ * case a check costs one lstat() of its directory.
+ *
+ * That lstat() revalidates the cached entry: the directory must still be
+ * the same inode with the same mtime and ctime, so replacing it with a
+ * symlink, retargeting a symlink above it, or adding or removing an entry
+ * (such as a new symlink) forces a fresh realpath() and scan. Entries
+ * whose directory changed in the last few seconds are never trusted,
+ * since a change within one timestamp tick would not show. Directories
+ * that did not exist are always resolved again through their parent.
+ *
+ * The whole cache is also dropped by ac_sandbox_invalidate_path_cache(),
+ * which the sandbox calls after every command it runs; relative paths are
+ * resolved against the working directory captured at that point (or when
+ * the sandbox was created).
+ */
+
+#include <arc/sandbox.h>
+#include "sandbox_internal.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+/*============================================================================
+ * List Walk (no index)
+ *============================================================================*/
+
+/*
+ * Checks every configured path in turn. Used when the index could not be
+ * built, and on Windows.
+ */
+static int lists_allowed(const ac_sandbox_t *sandbox, const char *path, unsigned int permissions) {
+    if (sandbox->workspace_path &&
+        ac_sandbox_path_is_under(sandbox->workspace_path, path)) {
+        return 1;
+    }
+
+    for (size_t i = 0; i < sandbox->path_rules_count; i++) {
+        const ac_sandbox_path_rule_t *rule = &sandbox->path_rules[i];
+        if ((rule->permissions & permissions) == permissions &&
+            ac_sandbox_path_is_under(rule->path, path)) {
+            return 1;
+        }
+    }
+
+    if ((permissions & ~AC_SANDBOX_PERM_FS_READ) == 0) {
+        if (sandbox->readonly_paths) {
+            for (int i = 0; sandbox->readonly_paths[i]; i++) {
+                if (ac_sandbox_path_is_under(sandbox->readonly_paths[i], path)) {
+                    return 1;
+                }
+            }
+        }
+
+        const char **defaults = ac_sandbox_get_default_readonly_paths();
+        for (int i = 0; defaults[i]; i++) {
+            if (ac_sandbox_path_is_under(defaults[i], path)) {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+#if !defined(_WIN32)
+
+/*============================================================================
+ * Permission Trie
+ *============================================================================*/
+
+#define INDEX_PATH_MAX      4096
+#define CACHE_SLOTS         1024        /* Directories remembered (power of two) */
+#define CACHE_MAX_LINKS     64          /* Symlink names kept per directory */
+#define CACHE_RACY_SECONDS  2           /* Changes this recent may hide within a tick */
+
+typedef struct {
+    uint32_t parent;
+    uint32_t hash;
+    uint32_t name;                      /* Offset into names */
+    uint32_t len;
+    uint32_t allowed;                   /* Bit r set: request r (within FS_ALL) granted */
+    int full;                           /* Everything granted (workspace) */
+} trie_node_t;
+
+typedef struct {
+    char *key;                          /* Directory as given (absolute) */
+    char *canonical;
+    char *links;                        /* NUL-separated symlink entry names */
+    size_t links_len;
+    int many_links;                     /* Too many to keep: resolve every leaf */
+    int missing;                        /* Did not exist: canonical came from the parent */
+    int key_is_link;                    /* Last component of key is a symlink */
+    int racy;                           /* Changed too recently to trust the stamp */
+    dev_t dev;                          /* Stamp of the directory when resolved */
+    ino_t ino;
+    int64_t mtime_ns;
+    int64_t ctime_ns;
+} cache_entry_t;
+
+struct ac_sandbox_path_index {
+    trie_node_t *nodes;
+    size_t node_count;
+    size_t node_cap;
+    uint32_t *slots;                    /* Child table: node index + 1, 0 = empty */
+    size_t slot_mask;
+    char *names;                        /* Component storage */
+    size_t names_len;
+    size_t names_cap;
+
+    pthread_mutex_t lock;               /* Guards cache and cwd */
+    cache_entry_t cache[CACHE_SLOTS];
+    char cwd[INDEX_PATH_MAX];
+};
+
+static uint32_t hash_bytes(uint32_t h, const char *s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint32_t child_hash(uint32_t parent, const char *name, size_t len) {
+    uint32_t h = 2166136261u ^ parent;
+    h *= 16777619u;
+    return hash_bytes(h, name, len);
+}
+
+static long find_child(const ac_sandbox_path_index_t *index, uint32_t parent, const char *name, size_t len) {
+    uint32_t h = child_hash(parent, name, len);
+    for (size_t s = h & index->slot_mask;; s = (s + 1) & index->slot_mask) {
+        uint32_t slot = index->slots[s];
+        if (slot == 0) return -1;
+        const trie_node_t *node = &index->nodes[slot - 1];
+        if (node->hash == h && node->parent == parent && node->len == len &&
+            memcmp(index->names + node->name, name, len) == 0) {
+            return (long)(slot - 1);
+        }
+    }
+}
+
+static int grow_slots(ac_sandbox_path_index_t *index) {
+    size_t size = (index->slot_mask + 1) * 2;
+    uint32_t *slots = calloc(size, sizeof(*slots));
+    if (!slots) return -1;
+    for (size_t i = 1; i < index->node_count; i++) {
+        size_t s = index->nodes[i].hash & (size - 1);
+        while (slots[s]) s = (s + 1) & (size - 1);
+        slots[s] = (uint32_t)i + 1;
+    }
+    free(index->slots);
+    index->slots = slots;
+    index->slot_mask = size - 1;
+    return 0;
+}
+
+static long add_child(ac_sandbox_path_index_t *index, uint32_t parent, const char *name, size_t len) {
+    long existing = find_child(index, parent, name, len);
+    if (existing >= 0) return existing;
+
+    if (index->node_count == index->node_cap) {
+        size_t cap = index->node_cap * 2;
+        trie_node_t *nodes = realloc(index->nodes, cap * sizeof(*nodes));
+        if (!nodes) return -1;
+        index->nodes = nodes;
+        index->node_cap = cap;
+    }
+    if ((index->node_count + 1) * 2 > index->slot_mask + 1 && grow_slots(index) < 0) {
+        return -1;
+    }
+
+    if (index->names_len + len > index->names_cap) {
+        size_t cap = index->names_cap * 2 + len;
+        char *names = realloc(index->names, cap);
+        if (!names) return -1;
+        index->names = names;
+        index->names_cap = cap;
+    }
+    memcpy(index->names + index->names_len, name, len);
+
+    trie_node_t *node = &index->nodes[index->node_count];
+    node->parent = parent;
+    node->hash = child_hash(parent, name, len);
+    node->name = (uint32_t)index->names_len;
+    node->len = (uint32_t)len;
+    node->allowed = 0;
+    node->full = 0;
+    index->names_len += len;
+
+    size_t s = node->hash & index->slot_mask;
+    while (index->slots[s]) s = (s + 1) & index->slot_mask;
+    index->slots[s] = (uint32_t)index->node_count + 1;
+    return (long)index->node_count++;
+}
+
+/* Requests r (subsets of FS_ALL) that a rule granting mask satisfies */
+static uint32_t requests_granted(unsigned int mask) {
+    uint32_t bits = 0;
+    for (unsigned int r = 0; r <= AC_SANDBOX_PERM_FS_ALL; r++) {
+        if ((mask & r) == r) bits |= 1u << r;
+    }
+    return bits;
+}
+
+/*============================================================================
+ * Canonical Paths
+ *============================================================================*/
+
+/* Absolute path of path, relative ones joined to the captured cwd */
+static int make_absolute(const ac_sandbox_path_index_t *index, const char *path, char *out, size_t size) {
+    int n = path[0] == '/' ? snprintf(out, size, "%s", path)
+                           : snprintf(out, size, "%s/%s", index->cwd, path);
+    return n < 0 || (size_t)n >= size ? -1 : 0;
+}
+
+/* Collapse "//", "." and ".." without touching the filesystem */
+static void normalize_lexical(char *path) {
+    char *out = path;
+    const char *p = path;
+    while (*p) {
+        while (*p == '/') p++;
+        const char *start = p;
+        while (*p && *p != '/') p++;
+        size_t len = (size_t)(p - start);
+        if (len == 0 || (len == 1 && start[0] == '.')) continue;
+        if (len == 2 && start[0] == '.' && start[1] == '.') {
+            while (out > path && *--out != '/') {}
+            continue;
+        }
+        *out++ = '/';
+        memmove(out, start, len);
+        out += len;
+    }
+    if (out == path) *out++ = '/';
+    *out = '\0';
+}
+
+static int64_t stat_mtime_ns(const struct stat *st) {
+#if defined(__APPLE__)
+    return (int64_t)st->st_mtimespec.tv_sec * 1000000000 + st->st_mtimespec.tv_nsec;
+#else
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+static int64_t stat_ctime_ns(const struct stat *st) {
+#if defined(__APPLE__)
+    return (int64_t)st->st_ctimespec.tv_sec * 1000000000 + st->st_ctimespec.tv_nsec;
+#else
+    return (int64_t)st->st_ctim.tv_sec * 1000000000 + st->st_ctim.tv_nsec;
+#endif
+}
+
+/*
+ * Identity of the directory a key names: lstat() unless the key itself
+ * ends in a symlink, in which case the link must still be one and its
+ * target is stamped. Returns 1 for a link, 0 for a directory, -1 else.
+ */
+static int stamp_key(const char *key, struct stat *st) {
+    if (lstat(key, st) != 0) return -1;
+    if (S_ISDIR(st->st_mode)) return 0;
+    if (!S_ISLNK(st->st_mode)) return -1;
+    return stat(key, st) == 0 && S_ISDIR(st->st_mode) ? 1 : -1;
+}
+
+static void set_stamp(cache_entry_t *entry, const struct stat *st, int is_link) {
+    entry->key_is_link = is_link;
+    entry->dev = st->st_dev;
+    entry->ino = st->st_ino;
+    entry->mtime_ns = stat_mtime_ns(st);
+    entry->ctime_ns = stat_ctime_ns(st);
+    int64_t changed = entry->mtime_ns > entry->ctime_ns ? entry->mtime_ns : entry->ctime_ns;
+    entry->racy = changed / 1000000000 >= (int64_t)time(NULL) - CACHE_RACY_SECONDS;
+}
+
+/* Whether a cached entry still describes its directory */
+static int entry_current(const cache_entry_t *entry) {
+    if (entry->missing || entry->racy) {
+        return 0;
+    }
+    struct stat st;
+    int is_link = stamp_key(entry->key, &st);
+    return is_link == entry->key_is_link &&
+           st.st_dev == entry->dev && st.st_ino == entry->ino &&
+           stat_mtime_ns(&st) == entry->mtime_ns && stat_ctime_ns(&st) == entry->ctime_ns;
+}
+
+static void cache_entry_clear(cache_entry_t *entry) {
+    free(entry->key);
+    free(entry->canonical);
+    free(entry->links);
+    memset(entry, 0, sizeof(*entry));
+}
+
+/* Record the names of symlinks in a directory */
+static void scan_links(cache_entry_t *entry) {
+    DIR *dir = opendir(entry->canonical);
+    if (!dir) {
+        entry->many_links = 1;
+        return;
+    }
+
+    size_t cap = 0;
+    int count = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        int is_link = 0;
+#ifdef DT_LNK
+        if (de->d_type == DT_LNK) {
+            is_link = 1;
+        } else if (de->d_type == DT_UNKNOWN)
+#endif
+        {
+            struct stat st;
+            is_link = fstatat(dirfd(dir), de->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+                      S_ISLNK(st.st_mode);
+        }
+        if (!is_link) continue;
+
+        size_t len = strlen(de->d_name) + 1;
+        if (++count > CACHE_MAX_LINKS) {
+            entry->many_links = 1;
+            break;
+        }
+        if (entry->links_len + len > cap) {
+            cap = cap * 2 + len + 64;
+            char *links = realloc(entry->links, cap);
+            if (!links) {
+                entry->many_links = 1;
+                break;
+            }
+            entry->links = links;
+        }
+        memcpy(entry->links + entry->links_len, de->d_name, len);
+        entry->links_len += len;
+    }
+    closedir(dir);
+}
+
+static int is_link_entry(const cache_entry_t *entry, const char *name) {
+    if (entry->many_links) return 1;
+    for (size_t off = 0; off < entry->links_len; off += strlen(entry->links + off) + 1) {
+        if (strcmp(entry->links + off, name) == 0) return 1;
+    }
+    return 0;
+}
+
+/*
+ * Cache entry for an absolute directory, resolving it on a miss or when
+ * the directory changed. A missing directory is resolved through its
+ * parent, so symlinks above it still count. Called with the lock held.
+ */
+static const cache_entry_t *resolve_dir(ac_sandbox_path_index_t *index, const char *dir, int depth) {
+    size_t len = strlen(dir);
+    cache_entry_t *entry = &index->cache[hash_bytes(2166136261u, dir, len) & (CACHE_SLOTS - 1)];
+    if (entry->key && strcmp(entry->key, dir) == 0 && entry_current(entry)) {
+        return entry;
+    }
+
+    /* Stamp before resolving, so a change during the scan shows next time */
+    struct stat st;
+    int is_link = stamp_key(dir, &st);
+
+    char canonical[INDEX_PATH_MAX];
+    int missing = 0;
+    char *resolved = realpath(dir, NULL);
+    if (resolved) {
+        size_t n = strlen(resolved);
+        if (n >= sizeof(canonical)) {
+            free(resolved);
+            return NULL;
+        }
+        memcpy(canonical, resolved, n + 1);
+        free(resolved);
+    } else if ((errno == ENOENT || errno == ENOTDIR) && depth < 64 && strcmp(dir, "/") != 0) {
+        /* Resolve the parent, then append the last component */
+        char parent[INDEX_PATH_MAX];
+        memcpy(parent, dir, len + 1);
+        char *slash = strrchr(parent, '/');
+        const char *base = dir + (slash - parent) + 1;
+        if (slash == parent) parent[1] = '\0';
+        else *slash = '\0';
+
+        const cache_entry_t *up = resolve_dir(index, parent, depth + 1);
+        if (!up) return NULL;
+        int n = snprintf(canonical, sizeof(canonical), "%s/%s", up->canonical, base);
+        if (n < 0 || (size_t)n >= sizeof(canonical)) return NULL;
+        normalize_lexical(canonical);
+        missing = 1;
+    } else {
+        return NULL;
+    }
+
+    cache_entry_clear(entry);
+    entry->key = strdup(dir);
+    entry->canonical = strdup(canonical);
+    if (!entry->key || !entry->canonical) {
+        cache_entry_clear(entry);
+        return NULL;
+    }
+    entry->missing = missing || is_link < 0;
+    if (!entry->missing) {
+        set_stamp(entry, &st, is_link);
+        scan_links(entry);
+    }
+    return entry;
+}
+
+/*
+ * Canonical form of path: the directory comes from the cache, the last
+ * component is appended unless it is a symlink.
+ */
+static int canonicalize(ac_sandbox_path_index_t *index, const char *path, char *out, size_t size) {
+    char abs[INDEX_PATH_MAX];
+    if (make_absolute(index, path, abs, sizeof(abs)) < 0) {
+        return -1;
+    }
+
+    /* Split off the last component; "x/." and "x/.." are directories */
+    size_t len = strlen(abs);
+    while (len > 1 && abs[len - 1] == '/') abs[--len] = '\0';
+    char *slash = strrchr(abs, '/');
+    const char *leaf = slash + 1;
+    if (*leaf == '\0' || strcmp(leaf, ".") == 0 || strcmp(leaf, "..") == 0) {
+        leaf = NULL;
+    }
+
+    char dir[INDEX_PATH_MAX];
+    if (!leaf) {
+        memcpy(dir, abs, len + 1);
+    } else if (slash == abs) {
+        memcpy(dir, "/", 2);
+    } else {
+        memcpy(dir, abs, (size_t)(slash - abs));
+        dir[slash - abs] = '\0';
+    }
+
+    pthread_mutex_lock(&index->lock);
+    const cache_entry_t *entry = resolve_dir(index, dir, 0);
+    int follow = 0;
+    int n = -1;
+    if (entry) {
+        follow = leaf && is_link_entry(entry, leaf);
+        n = leaf ? snprintf(out, size, "%s/%s", strcmp(entry->canonical, "/") == 0 ? "" : entry->canonical, leaf)
+                 : snprintf(out, size, "%s", entry->canonical);
+    }
+    pthread_mutex_unlock(&index->lock);
+
+    if (n < 0 || (size_t)n >= size) {
+        return -1;
+    }
+    if (follow) {
+        /* Symlink (or unknown): where it points decides; dangling keeps its name */
+        char *resolved = realpath(abs, NULL);
+        if (resolved) {
+            n = snprintf(out, size, "%s", resolved);
+            free(resolved);
+            if (n < 0 || (size_t)n >= size) return -1;
+        }
+    }
+    return 0;
+}
+
+/*============================================================================
+ * Building
+ *============================================================================*/
+
+static int add_path(ac_sandbox_path_index_t *index, const char *path, unsigned int mask, int full) {
+    char canonical[INDEX_PATH_MAX];
+    if (canonicalize(index, path, canonical, sizeof(canonical)) < 0) {
+        /* Unresolvable now: the list walk would never match it either */
+        return 0;
+    }
+
+    uint32_t node = 0;
+    const char *p = canonical;
+    while (*p) {
+        while (*p == '/') p++;
+        const char *start = p;
+        while (*p && *p != '/') p++;
+        if (p == start) break;
+        long child = add_child(index, node, start, (size_t)(p - start));
+        if (child < 0) return -1;
+        node = (uint32_t)child;
+    }
+
+    index->nodes[node].allowed |= requests_granted(mask);
+    index->nodes[node].full |= full;
+    return 0;
+}
+
+ac_sandbox_path_index_t *ac_sandbox_path_index_create(const ac_sandbox_t *sandbox) {
+    ac_sandbox_path_index_t *index = calloc(1, sizeof(*index));
+    if (!index) {
+        return NULL;
+    }
+    if (pthread_mutex_init(&index->lock, NULL) != 0) {
+        free(index);
+        return NULL;
+    }
+    if (!getcwd(index->cwd, sizeof(index->cwd))) {
+        memcpy(index->cwd, "/", 2);
+    }
+
+    index->node_cap = 64;
+    index->nodes = calloc(index->node_cap, sizeof(*index->nodes));
+    index->slot_mask = 127;
+    index->slots = calloc(index->slot_mask + 1, sizeof(*index->slots));
+    if (!index->nodes || !index->slots) {
+        ac_sandbox_path_index_free(index);
+        return NULL;
+    }
+    index->node_count = 1;              /* Root "/" */
+
+    int rc = 0;
+    if (sandbox->workspace_path) {
+        rc |= add_path(index, sandbox->workspace_path, AC_SANDBOX_PERM_FS_ALL, 1);
+    }
+    for (size_t i = 0; i < sandbox->path_rules_count; i++) {
+        rc |= add_path(index, sandbox->path_rules[i].path, sandbox->path_rules[i].permissions, 0);
+    }
+    if (sandbox->readonly_paths) {
+        for (int i = 0; sandbox->readonly_paths[i]; i++) {
+            rc |= add_path(index, sandbox->readonly_paths[i], AC_SANDBOX_PERM_FS_READ, 0);
+        }
+    }
+    const char **defaults = ac_sandbox_get_default_readonly_paths();
+    for (int i = 0; defaults[i]; i++) {
+        rc |= add_path(index, defaults[i], AC_SANDBOX_PERM_FS_READ, 0);
+    }
+    if (rc != 0) {
+        ac_sandbox_path_index_free(index);
+        return NULL;
+    }
+
+    /* Parents precede their children, so one pass pushes grants down */
+    for (size_t i = 1; i < index->node_count; i++) {
+        const trie_node_t *parent = &index->nodes[index->nodes[i].parent];
+        index->nodes[i].allowed |= parent->allowed;
+        index->nodes[i].full |= parent->full;
+    }
+    return index;
+}
+
+void ac_sandbox_path_index_free(ac_sandbox_path_index_t *index) {
+    if (!index) {
+        return;
+    }
+    for (size_t i = 0; i < CACHE_SLOTS; i++) {
+        cache_entry_clear(&index->cache[i]);
+    }
+    pthread_mutex_destroy(&index->lock);
+    free(index->nodes);
+    free(index->slots);
+    free(index->names);
+    free(index);
+}
+
+/*============================================================================
+ * Checking
+ *============================================================================*/
+
+static int index_allowed(ac_sandbox_path_index_t *index, const char *path, unsigned int permissions) {
+    char canonical[INDEX_PATH_MAX];
+    if (canonicalize(index, path, canonical, sizeof(canonical)) < 0) {
+        return 0;
+    }
+
+    /* Deepest configured node on the path decides */
+    const trie_node_t *match = &index->nodes[0];
+    uint32_t node = 0;
+    const char *p = canonical;
+    while (*p) {
+        while (*p == '/') p++;
+        const char *start = p;
+        while (*p && *p != '/') p++;
+        if (p == start) break;
+        long child = find_child(index, node, start, (size_t)(p - start));
+        if (child < 0) break;
+        node = (uint32_t)child;
+        match = &index->nodes[node];
+    }
+
+    if (match->full) {
+        return 1;
+    }
+    if (permissions & ~(unsigned int)AC_SANDBOX_PERM_FS_ALL) {
+        return 0;
+    }
+    return (match->allowed >> permissions) & 1u;
+}
+
+#else /* _WIN32 */
+
+ac_sandbox_path_index_t *ac_sandbox_path_index_create(const ac_sandbox_t *sandbox) {
+    (void)sandbox;
+    return NULL;
+}
+
+void ac_sandbox_path_index_free(ac_sandbox_path_index_t *index) {
+    (void)index;
+}
+
+#endif /* !_WIN32 */
+
+/*============================================================================
+ * Public Entry Points
+ *============================================================================*/
+
+int ac_sandbox_path_allowed(const ac_sandbox_t *sandbox, const char *path, unsigned int permissions) {
+#if !defined(_WIN32)
+    if (sandbox->path_index) {
+        return index_allowed(sandbox->path_index, path, permissions);
+    }
+#endif
+    return lists_allowed(sandbox, path, permissions);
+}
+
+void ac_sandbox_invalidate_path_cache(ac_sandbox_t *sandbox) {
+#if !defined(_WIN32)
+    ac_sandbox_path_index_t *index = sandbox ? sandbox->path_index : NULL;
+    if (!index) {
+        return;
+    }
+    pthread_mutex_lock(&index->lock);
+    for (size_t i = 0; i < CACHE_SLOTS; i++) {
+        cache_entry_clear(&index->cache[i]);
+    }
+    if (!getcwd(index->cwd, sizeof(index->cwd))) {
+        memcpy(index->cwd, "/", 2);
+    }
+    pthread_mutex_unlock(&index->lock);
+#else
+    (void)sandbox;
+#endif
+}
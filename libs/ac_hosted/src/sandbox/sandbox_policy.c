@@ -0,0 +1,682 @@
+/**
+ * @file sandbox_policy.c
+ * @brief Compiled Command Policy
+ *
+ * A policy is a rule table compiled into two Aho-Corasick automata:
+ *
+ * - token automaton: run over a stream built from the parsed command,
+ *   one record per program in each wrapper chain and per write
+ *   redirection target:
+ *
+ *       \x01 basename \x02      program name
+ *       \x05 path \x02          program path (only if it contains '/')
+ *       \x03 target \x02        redirection target
+ *
+ *   Program keys are compiled as "\x01name\x02" (exact) or "\x01name"
+ *   (prefix), path and redirect keys as "\x05prefix" / "\x03prefix".
+ * - raw automaton: run over the command text with whitespace removed,
+ *   for rules that are about syntax rather than programs (fork bombs).
+ *
+ * Both use byte classes (bytes absent from every key share class 0)
+ * and a full transition table, so a scan is one table lookup per byte.
+ * Each hit names a rule and, through the record it ended in, a simple
+ * command; the rule's flag / operand / exemption columns are then
+ * checked against that command's words.
+ */
+
+#include "sandbox_internal.h"
+#include <arc/command_policy.h>
+#include <arc/log.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+#define TOK_PROGRAM     '\x01'
+#define TOK_END         '\x02'
+#define TOK_REDIRECT    '\x03'
+#define TOK_PATH        '\x05'
+
+#define POLICY_MAX_WORD 4096
+
+/*============================================================================
+ * Aho-Corasick Automaton
+ *============================================================================*/
+
+typedef struct {
+    const char *text;
+    size_t len;
+    int rule;
+} ac_pattern_t;
+
+typedef struct {
+    uint8_t classes[256];               /* Byte -> class, 0 = in no pattern */
+    int class_count;
+    int state_count;
+    int32_t *delta;                     /* [state * class_count + class] -> state */
+    int32_t *output;                    /* First pattern ending here, -1 = none */
+    int32_t *output_link;               /* Nearest state on the fail chain with output */
+    int32_t *pattern_next;              /* Next pattern with the same text */
+    int *pattern_rule;
+} automaton_t;
+
+static void automaton_free(automaton_t *a) {
+    free(a->delta);
+    free(a->output);
+    free(a->output_link);
+    free(a->pattern_next);
+    free(a->pattern_rule);
+    memset(a, 0, sizeof(*a));
+}
+
+static int automaton_build(automaton_t *a, const ac_pattern_t *patterns, int count) {
+    memset(a, 0, sizeof(*a));
+
+    size_t max_states = 1;
+    a->class_count = 1;
+    for (int p = 0; p < count; p++) {
+        max_states += patterns[p].len;
+        for (size_t i = 0; i < patterns[p].len; i++) {
+            uint8_t b = (uint8_t)patterns[p].text[i];
+            if (!a->classes[b]) a->classes[b] = (uint8_t)a->class_count++;
+        }
+    }
+    if (a->class_count > 255) return -1;
+
+    int k = a->class_count;
+    a->delta = calloc(max_states * (size_t)k, sizeof(int32_t));
+    a->output = malloc(max_states * sizeof(int32_t));
+    a->output_link = malloc(max_states * sizeof(int32_t));
+    int32_t *fail = malloc(max_states * sizeof(int32_t));
+    int32_t *queue = malloc(max_states * sizeof(int32_t));
+    a->pattern_next = malloc((size_t)(count ? count : 1) * sizeof(int32_t));
+    a->pattern_rule = malloc((size_t)(count ? count : 1) * sizeof(int));
+    if (!a->delta || !a->output || !a->output_link || !fail || !queue ||
+        !a->pattern_next || !a->pattern_rule) {
+        free(fail);
+        free(queue);
+        automaton_free(a);
+        return -1;
+    }
+
+    /* Trie: 0 means "no child" since no edge leads back to the root */
+    a->state_count = 1;
+    a->output[0] = -1;
+    for (int p = 0; p < count; p++) {
+        int32_t s = 0;
+        for (size_t i = 0; i < patterns[p].len; i++) {
+            int c = a->classes[(uint8_t)patterns[p].text[i]];
+            if (!a->delta[s * k + c]) {
+                a->output[a->state_count] = -1;
+                a->delta[s * k + c] = a->state_count++;
+            }
+            s = a->delta[s * k + c];
+        }
+        a->pattern_rule[p] = patterns[p].rule;
+        a->pattern_next[p] = a->output[s];
+        a->output[s] = p;
+    }
+
+    /* Breadth-first: fail links, output links, missing transitions */
+    int head = 0, tail = 0;
+    fail[0] = 0;
+    a->output_link[0] = -1;
+    for (int c = 0; c < k; c++) {
+        int32_t child = a->delta[c];
+        if (child) {
+            fail[child] = 0;
+            a->output_link[child] = -1;
+            queue[tail++] = child;
+        }
+    }
+    while (head < tail) {
+        int32_t s = queue[head++];
+        for (int c = 0; c < k; c++) {
+            int32_t child = a->delta[s * k + c];
+            int32_t via = a->delta[fail[s] * k + c];
+            if (child) {
+                fail[child] = via;
+                a->output_link[child] = a->output[via] >= 0 ? via : a->output_link[via];
+                queue[tail++] = child;
+            } else {
+                a->delta[s * k + c] = via;
+            }
+        }
+    }
+
+    free(fail);
+    free(queue);
+    return 0;
+}
+
+typedef void (*match_fn)(int rule, size_t end, void *ctx);
+
+static void automaton_scan(const automaton_t *a, const char *text, size_t len, match_fn on_match, void *ctx) {
+    if (a->state_count <= 1) return;
+    int32_t s = 0;
+    int k = a->class_count;
+    for (size_t i = 0; i < len; i++) {
+        s = a->delta[s * k + a->classes[(uint8_t)text[i]]];
+        for (int32_t t = a->output[s] >= 0 ? s : a->output_link[s]; t >= 0; t = a->output_link[t]) {
+            for (int32_t p = a->output[t]; p >= 0; p = a->pattern_next[p]) {
+                on_match(a->pattern_rule[p], i, ctx);
+            }
+        }
+    }
+}
+
+/*============================================================================
+ * Policy
+ *============================================================================*/
+
+struct ac_cmd_policy {
+    const ac_cmd_rule_t *rules;
+    size_t rule_count;
+    automaton_t tokens;
+    automaton_t raw;
+    char *keys;                         /* Storage for compiled key text */
+};
+
+/* Number of '|'-separated alternatives */
+static int alt_count(const char *list) {
+    int n = 1;
+    for (; *list; list++) n += *list == '|';
+    return n;
+}
+
+/* Length of the alternative at `list` */
+static size_t alt_len(const char *list) {
+    const char *bar = strchr(list, '|');
+    return bar ? (size_t)(bar - list) : strlen(list);
+}
+
+ac_cmd_policy_t *ac_cmd_policy_compile(const ac_cmd_rule_t *rules, size_t count) {
+    if (!rules && count > 0) return NULL;
+
+    /* Size the key storage */
+    size_t key_bytes = 0;
+    int token_count = 0, raw_count = 0;
+    for (size_t r = 0; r < count; r++) {
+        const ac_cmd_rule_t *rule = &rules[r];
+        int keys = (rule->program != NULL) + (rule->redirect != NULL) + (rule->raw != NULL);
+        if (keys != 1) {
+            AC_LOG_ERROR("Command rule %zu needs exactly one of program/redirect/raw", r);
+            return NULL;
+        }
+        const char *list = rule->program ? rule->program : rule->redirect ? rule->redirect : rule->raw;
+        key_bytes += strlen(list) + 2 * (size_t)alt_count(list);
+        if (rule->raw) raw_count++;
+        else token_count += alt_count(list);
+    }
+
+    ac_cmd_policy_t *policy = calloc(1, sizeof(*policy));
+    ac_pattern_t *token_patterns = malloc(sizeof(ac_pattern_t) * (size_t)(token_count + 1));
+    ac_pattern_t *raw_patterns = malloc(sizeof(ac_pattern_t) * (size_t)(raw_count + 1));
+    char *keys = malloc(key_bytes + 1);
+    if (!policy || !token_patterns || !raw_patterns || !keys) {
+        free(policy);
+        free(token_patterns);
+        free(raw_patterns);
+        free(keys);
+        return NULL;
+    }
+    policy->rules = rules;
+    policy->rule_count = count;
+    policy->keys = keys;
+
+    int nt = 0, nr = 0;
+    char *k = keys;
+    for (size_t r = 0; r < count; r++) {
+        const ac_cmd_rule_t *rule = &rules[r];
+        const char *list = rule->program ? rule->program : rule->redirect ? rule->redirect : rule->raw;
+
+        for (const char *alt = list;; alt += alt_len(alt) + 1) {
+            size_t len = rule->raw ? strlen(alt) : alt_len(alt);
+            char *key = k;
+
+            if (rule->raw) {
+                /* Matched against text without whitespace */
+                for (size_t i = 0; i < len; i++) {
+                    if (alt[i] != ' ' && alt[i] != '\t' && alt[i] != '\n') *k++ = alt[i];
+                }
+                raw_patterns[nr++] = (ac_pattern_t){ key, (size_t)(k - key), (int)r };
+            } else if (rule->redirect) {
+                *k++ = TOK_REDIRECT;
+                memcpy(k, alt, len);
+                k += len;
+                token_patterns[nt++] = (ac_pattern_t){ key, (size_t)(k - key), (int)r };
+            } else if (memchr(alt, '/', len)) {
+                *k++ = TOK_PATH;
+                memcpy(k, alt, len);
+                k += len;
+                token_patterns[nt++] = (ac_pattern_t){ key, (size_t)(k - key), (int)r };
+            } else {
+                int prefix = len > 0 && alt[len - 1] == '*';
+                *k++ = TOK_PROGRAM;
+                memcpy(k, alt, len - (size_t)prefix);
+                k += len - (size_t)prefix;
+                if (!prefix) *k++ = TOK_END;
+                token_patterns[nt++] = (ac_pattern_t){ key, (size_t)(k - key), (int)r };
+            }
+
+            if (rule->raw || alt[len] != '|') break;
+        }
+    }
+
+    int failed = automaton_build(&policy->tokens, token_patterns, nt) < 0 ||
+                 automaton_build(&policy->raw, raw_patterns, nr) < 0;
+    free(token_patterns);
+    free(raw_patterns);
+    if (failed) {
+        ac_cmd_policy_free(policy);
+        return NULL;
+    }
+    return policy;
+}
+
+void ac_cmd_policy_free(ac_cmd_policy_t *policy) {
+    if (!policy) return;
+    automaton_free(&policy->tokens);
+    automaton_free(&policy->raw);
+    free(policy->keys);
+    free(policy);
+}
+
+/*============================================================================
+ * Token Conditions
+ *============================================================================*/
+
+/* Does `word` equal (or, for "x*", start with) an alternative of `list` */
+static int word_in_list(const char *word, const char *list) {
+    size_t word_len = strlen(word);
+    for (const char *alt = list;; alt += alt_len(alt) + 1) {
+        size_t len = alt_len(alt);
+        if (len > 0 && alt[len - 1] == '*') {
+            if (word_len >= len - 1 && memcmp(word, alt, len - 1) == 0) return 1;
+        } else if (word_len == len && memcmp(word, alt, len) == 0) {
+            return 1;
+        }
+        if (alt[len] != '|') return 0;
+    }
+}
+
+/*
+ * Canonical form of a path-like operand: repeated slashes collapsed,
+ * "/." segments and a trailing slash or slash-star dropped, ${HOME} spelled $HOME.
+ * "name=/path" (dd of=...) has its value normalized.
+ */
+static const char *normalize_operand(const char *arg, char *buf, size_t size) {
+    const char *value = arg;
+    const char *eq = strchr(arg, '=');
+    if (eq && arg[0] != '/' && (eq[1] == '/' || eq[1] == '~' || eq[1] == '$')) value = eq + 1;
+    if (value[0] != '/' && value[0] != '~' && value[0] != '$') return arg;
+
+    size_t n = 0;
+    size_t prefix = (size_t)(value - arg);
+    if (prefix + 1 >= size) return arg;
+    memcpy(buf, arg, prefix);
+    n = prefix;
+
+    if (strncmp(value, "${HOME}", 7) == 0) {
+        memcpy(buf + n, "$HOME", 5);
+        n += 5;
+        value += 7;
+    }
+
+    for (const char *p = value; *p && n + 1 < size; p++) {
+        if (*p == '/' && n > prefix && buf[n - 1] == '/') continue;
+        if (*p == '/' && p[1] == '.' && (p[2] == '/' || p[2] == '\0')) {
+            p++;
+            continue;
+        }
+        buf[n++] = *p;
+    }
+
+    /* A trailing slash-star (all entries) and "/" name the directory itself */
+    for (;;) {
+        if (n >= prefix + 2 && buf[n - 1] == '*' && buf[n - 2] == '/') n -= 2;
+        else if (n > prefix + 1 && buf[n - 1] == '/') n--;
+        else break;
+    }
+    if (n == prefix && value[0] == '/') buf[n++] = '/';
+    buf[n] = '\0';
+    return buf;
+}
+
+static int has_flag(const ac_cmd_simple_t *cmd, int from, const char *list) {
+    for (int i = from; i < cmd->argc; i++) {
+        const char *arg = cmd->argv[i];
+        if (strcmp(arg, "--") == 0) break;
+        if (arg[0] != '-' || arg[1] == '\0') continue;
+
+        for (const char *alt = list;; alt += alt_len(alt) + 1) {
+            size_t len = alt_len(alt);
+            if (len == 2 && alt[0] == '-' && alt[1] != '-') {
+                /* Single letter: also inside "-rf" */
+                if (arg[1] != '-' && memchr(arg + 1, alt[1], strlen(arg + 1))) return 1;
+            } else if (strncmp(arg, alt, len) == 0 && (arg[len] == '\0' || arg[len] == '=')) {
+                return 1;
+            }
+            if (alt[len] != '|') break;
+        }
+    }
+    return 0;
+}
+
+static int has_operand(const ac_cmd_simple_t *cmd, int from, const char *list) {
+    char buf[POLICY_MAX_WORD];
+    int options = 1;
+    for (int i = from; i < cmd->argc; i++) {
+        const char *arg = cmd->argv[i];
+        if (options && strcmp(arg, "--") == 0) {
+            options = 0;
+            continue;
+        }
+        if (options && arg[0] == '-' && arg[1] != '\0') continue;
+        if (word_in_list(normalize_operand(arg, buf, sizeof(buf)), list)) return 1;
+    }
+    return 0;
+}
+
+static int has_word(const ac_cmd_simple_t *cmd, int from, const char *list) {
+    for (int i = from; i < cmd->argc; i++) {
+        if (word_in_list(cmd->argv[i], list)) return 1;
+    }
+    return 0;
+}
+
+/* Check the token columns of a rule for the program at argv[argi] */
+static int rule_holds(const ac_cmd_rule_t *rule, const ac_cmd_simple_t *cmd, int argi) {
+    int from = argi + 1;
+    if (rule->flags && !has_flag(cmd, from, rule->flags)) return 0;
+    if (rule->operands && !has_operand(cmd, from, rule->operands)) return 0;
+    if (rule->unless && has_word(cmd, from, rule->unless)) return 0;
+    return 1;
+}
+
+/*============================================================================
+ * Evaluation
+ *============================================================================*/
+
+/* A record in the token stream */
+typedef struct {
+    size_t end;                         /* Offset just past the record */
+    int command;
+    int argi;                           /* Program's argv index, -1 = redirect */
+} segment_t;
+
+typedef struct {
+    const ac_cmd_policy_t *policy;
+    const ac_cmd_script_t *script;
+    ac_cmd_verdict_t *verdict;
+    segment_t *segments;
+    int segment_count;
+
+    char *stream;
+    size_t len;
+    size_t cap;
+    int oom;
+} eval_t;
+
+static void stream_put(eval_t *ev, const char *s, size_t len) {
+    if (ev->len + len > ev->cap) {
+        size_t cap = ev->cap ? ev->cap * 2 : 256;
+        while (ev->len + len > cap) cap *= 2;
+        char *p = realloc(ev->stream, cap);
+        if (!p) {
+            ev->oom = 1;
+            return;
+        }
+        ev->stream = p;
+        ev->cap = cap;
+    }
+    memcpy(ev->stream + ev->len, s, len);
+    ev->len += len;
+}
+
+static void add_record(eval_t *ev, char tag, const char *text, int command, int argi, int *seg_cap) {
+    stream_put(ev, &tag, 1);
+    stream_put(ev, text, strlen(text));
+    char end = TOK_END;
+    stream_put(ev, &end, 1);
+
+    if (ev->segment_count == *seg_cap) {
+        int cap = *seg_cap ? *seg_cap * 2 : 16;
+        segment_t *p = realloc(ev->segments, sizeof(segment_t) * (size_t)cap);
+        if (!p) {
+            ev->oom = 1;
+            return;
+        }
+        ev->segments = p;
+        *seg_cap = cap;
+    }
+    ev->segments[ev->segment_count++] = (segment_t){ ev->len, command, argi };
+}
+
+static void apply(ac_cmd_verdict_t *verdict, const ac_cmd_rule_t *rule) {
+    verdict->categories |= AC_CMD_CATEGORY_BIT(rule->category);
+    verdict->matches++;
+    if (!verdict->reason || rule->action > verdict->action) {
+        verdict->action = rule->action > verdict->action ? rule->action : verdict->action;
+        verdict->reason = rule->reason;
+    }
+}
+
+static void on_token_match(int rule_index, size_t end, void *ctx) {
+    eval_t *ev = ctx;
+
+    /* First record ending after the match */
+    int lo = 0, hi = ev->segment_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (ev->segments[mid].end <= end) lo = mid + 1;
+        else hi = mid;
+    }
+    const segment_t *seg = &ev->segments[lo];
+    const ac_cmd_rule_t *rule = &ev->policy->rules[rule_index];
+    const ac_cmd_simple_t *cmd = &ev->script->commands[seg->command];
+
+    if (rule->redirect ? seg->argi >= 0 : seg->argi < 0) return;
+    if (seg->argi >= 0 && !rule_holds(rule, cmd, seg->argi)) return;
+    apply(ev->verdict, rule);
+}
+
+static void on_raw_match(int rule_index, size_t end, void *ctx) {
+    eval_t *ev = ctx;
+    (void)end;
+    apply(ev->verdict, &ev->policy->rules[rule_index]);
+}
+
+arc_err_t ac_cmd_policy_eval_script(
+    const ac_cmd_policy_t *policy,
+    const char *command,
+    const ac_cmd_script_t *script,
+    ac_cmd_verdict_t *verdict
+) {
+    if (!policy || !command || !script || !verdict) return ARC_ERR_INVALID_ARG;
+    memset(verdict, 0, sizeof(*verdict));
+
+    eval_t ev = { .policy = policy, .script = script, .verdict = verdict };
+    int seg_cap = 0;
+    char buf[POLICY_MAX_WORD];
+
+    /* Token stream: every program of each wrapper chain, write targets */
+    for (int c = 0; c < script->count; c++) {
+        const ac_cmd_simple_t *cmd = &script->commands[c];
+        for (int i = cmd->argc > 0 ? 0 : -1; i >= 0; i = ac_cmd_wrapped_program(cmd->argv, cmd->argc, i)) {
+            const char *word = cmd->argv[i];
+            const char *slash = strrchr(word, '/');
+            add_record(&ev, TOK_PROGRAM, slash && slash[1] ? slash + 1 : word, c, i, &seg_cap);
+            if (slash) add_record(&ev, TOK_PATH, normalize_operand(word, buf, sizeof(buf)), c, i, &seg_cap);
+        }
+        for (int r = 0; r < cmd->redir_count; r++) {
+            ac_cmd_redir_op_t op = cmd->redirs[r].op;
+            if (op == AC_CMD_REDIR_OUT || op == AC_CMD_REDIR_APPEND || op == AC_CMD_REDIR_INOUT) {
+                add_record(&ev, TOK_REDIRECT, normalize_operand(cmd->redirs[r].target, buf, sizeof(buf)),
+                           c, -1, &seg_cap);
+            }
+        }
+    }
+    if (!ev.oom && ev.segment_count > 0) {
+        automaton_scan(&policy->tokens, ev.stream, ev.len, on_token_match, &ev);
+    }
+
+    /* Raw text without whitespace */
+    ev.len = 0;
+    for (const char *p = command; *p; p++) {
+        if (*p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') stream_put(&ev, p, 1);
+    }
+    if (!ev.oom) automaton_scan(&policy->raw, ev.stream, ev.len, on_raw_match, &ev);
+
+    free(ev.stream);
+    free(ev.segments);
+    if (ev.oom) return ARC_ERR_NO_MEMORY;
+
+    if (script->error) {
+        verdict->categories |= AC_CMD_CATEGORY_BIT(AC_CMD_CAT_UNPARSED);
+        if (verdict->action < AC_CMD_CONFIRM) {
+            verdict->action = AC_CMD_CONFIRM;
+            verdict->reason = "Command could not be parsed completely";
+        }
+    }
+    return ARC_OK;
+}
+
+arc_err_t ac_cmd_policy_eval(const ac_cmd_policy_t *policy, const char *command, ac_cmd_verdict_t *verdict) {
+    if (!policy || !command || !verdict) return ARC_ERR_INVALID_ARG;
+
+    ac_cmd_script_t script;
+    arc_err_t err = ac_cmd_parse(command, &script);
+    if (err == ARC_OK) err = ac_cmd_policy_eval_script(policy, command, &script, verdict);
+    ac_cmd_script_free(&script);
+    return err;
+}
+
+/*============================================================================
+ * Default Policy
+ *============================================================================*/
+
+/* Directories whose recursive removal or chmod wrecks the system or home */
+#define ROOT_PATHS \
+    "/|~|$HOME|..|/bin|/boot|/dev|/etc|/home|/lib|/lib32|/lib64|/opt|/proc|/root|" \
+    "/sbin|/srv|/sys|/usr|/usr/bin|/usr/lib|/usr/local|/var"
+
+#define SYSTEM_DIRS "/etc/*|/boot/*|/bin/*|/sbin/*|/usr/*|/lib/*|/lib64/*|/sys/*|/proc/*"
+
+static const ac_cmd_rule_t g_default_rules[] = {
+    /* Destructive file operations */
+    { .program = "rm", .flags = "-r|-R|--recursive", .operands = ROOT_PATHS,
+      .action = AC_CMD_DENY, .category = AC_CMD_CAT_DESTRUCTIVE,
+      .reason = "Recursive delete of a system or home directory" },
+    { .program = "find", .flags = "-delete", .operands = ROOT_PATHS,
+      .action = AC_CMD_DENY, .category = AC_CMD_CAT_DESTRUCTIVE,
+      .reason = "find -delete over a system or home directory" },
+    { .program = "mv", .operands = "/|~|$HOME",
+      .action = AC_CMD_DENY, .category = AC_CMD_CAT_DESTRUCTIVE,
+      .reason = "Moves the root or home directory" },
+    { .program = "shred|wipefs",
+      .action = AC_CMD_CONFIRM, .category = AC_CMD_CAT_DESTRUCTIVE,
+      .reason = "Irrecoverably destroys data" },
+
+    /* Devices and filesystems */
+    { .program = "mkfs*|mkswap|fdisk|sfdisk|parted",
+      .action = AC_CMD_DENY, .category = AC_CMD_CAT_DEVICE,
+      .reason = "Rewrites a disk or filesystem" },
+    { .program = "dd", .operands = "of=/dev/*",
+      .action = AC_CMD_DENY, .category = AC_CMD_CAT_DEVICE,
+      .reason = "Writes a raw device" },
+    { .program = "dd", .operands = "if=*",
+      .action = AC_CMD_CONFIRM, .category = AC_CMD_CAT_DEVICE,
+      .reason = "Raw copy with dd" },
+    { .redirect = "/dev/sd|/dev/hd|/dev/vd|/dev/nvme|/dev/mmcblk|/dev/disk",
+      .action = AC_CMD_DENY, .category = AC_CMD_CAT_DEVICE,
+      .reason = "Redirects output onto a disk device" },
+
+    /* Privilege escalation */
+    { .program = "sudo|doas|su|pkexec",
+      .action = AC_CMD_CONFIRM, .category = AC_CMD_CAT_PRIVILEGE,
+      .reason = "Runs a command as another user" },
+
+    /* Permission changes */
+    { .program = "chmod|chown|chgrp", .operands = ROOT_PATHS,
+      .action = AC_CMD_DENY, .category = AC_CMD_CAT_PERMISSION,
+      .reason = "Changes permissions of a system or home directory" },
+    { .program = "chown", .flags = "-R|--recursive",
+      .action = AC_CMD_CONFIRM, .category = AC_CMD_CAT_PERMISSION,
+      .reason = "Recursive ownership change" },
+
+    /* System modifications */
+    { .program = "systemctl|service|shutdown|reboot|halt|poweroff|init|telinit|/etc/init.d/",
+      .action = AC_CMD_CONFIRM, .category = AC_CMD_CAT_SYSTEM,
+      .reason = "Controls system services or power" },
+
+    /* System paths */
+    { .redirect = "/etc/|/boot/|/bin/|/sbin/|/usr/|/lib/|/lib64/|/sys/|/proc/",
+      .action = AC_CMD_CONFIRM, .category = AC_CMD_CAT_SYSTEM_PATH,
+      .reason = "Writes under a system directory" },
+    { .program = "tee|truncate", .operands = SYSTEM_DIRS,
+      .action = AC_CMD_CONFIRM, .category = AC_CMD_CAT_SYSTEM_PATH,
+      .reason = "Writes under a system directory" },
+
+    /* Network */
+    { .program = "curl|wget", .unless = "--version|-V",
+      .action = AC_CMD_CONFIRM, .category = AC_CMD_CAT_NETWORK,
+      .reason = "Transfers data over the network" },
+    { .program = "nc|ncat|netcat|socat",
+      .action = AC_CMD_CONFIRM, .category = AC_CMD_CAT_NETWORK,
+      .reason = "Opens raw network connections" },
+    { .program = "ssh|scp|sftp|ftp|telnet", .unless = "-V",
+      .action = AC_CMD_ALLOW, .category = AC_CMD_CAT_NETWORK,
+      .reason = "Connects to a remote host" },
+
+    /* Resource exhaustion */
+    { .raw = ":(){ :|:& };:",
+      .action = AC_CMD_DENY, .category = AC_CMD_CAT_RESOURCE,
+      .reason = "Fork bomb" },
+};
+
+/* Compiled exactly once: sandboxes on several threads may ask at the same time */
+static ac_cmd_policy_t *s_default_policy = NULL;
+
+static void compile_default_policy(void) {
+    s_default_policy = ac_cmd_policy_compile(g_default_rules,
+                                             sizeof(g_default_rules) / sizeof(g_default_rules[0]));
+}
+
+#if defined(_WIN32)
+
+static INIT_ONCE s_default_policy_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK compile_default_policy_once(PINIT_ONCE once, PVOID param, PVOID *ctx) {
+    (void)once;
+    (void)param;
+    (void)ctx;
+    compile_default_policy();
+    return TRUE;
+}
+
+const ac_cmd_policy_t *ac_cmd_policy_default(void) {
+    InitOnceExecuteOnce(&s_default_policy_once, compile_default_policy_once, NULL, NULL);
+    return s_default_policy;
+}
+
+#else
+
+static pthread_once_t s_default_policy_once = PTHREAD_ONCE_INIT;
+
+const ac_cmd_policy_t *ac_cmd_policy_default(void) {
+    pthread_once(&s_default_policy_once, compile_default_policy);
+    return s_default_policy;
+}
+
+#endif
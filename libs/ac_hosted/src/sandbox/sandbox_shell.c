@@ -0,0 +1,645 @@
+/**
+ * @file sandbox_shell.c
+ * @brief Persistent Sandboxed Shell Sessions (POSIX)
+ *
+ * Keeps one /bin/sh running per session and feeds it commands over a
+ * socket on its stdin. The shell starts with private copies of its
+ * stdout and stderr pipes on fds 8 and 9, and each command is sent as
+ *
+ *     { command eval '<command>'
+ *     } < /dev/null 8>&- 9>&-; printf '%s %d %s\n' SENTINEL "$?" "$PWD" >&8
+ *     printf '%s\n' SENTINEL >&9
+ *
+ * and its output is read from the pipes until the sentinel has appeared
+ * on both, so output written just before the sentinel is never cut off.
+ * The sentinels go to the private fds, so a command that redirects the
+ * shell's own output (`exec >log`) does not lose them; the command runs
+ * with those fds closed. `command eval` keeps a syntax error in the
+ * command from exiting the shell. The sentinel is random per session and
+ * held-back bytes that could be the start of it are only passed on once
+ * they turn out not to be. A stream at EOF is finished: without its
+ * sentinel, the shell is going away.
+ *
+ * Timeouts and callback stops kill the shell's process group, exactly as
+ * for a one-shot command; the session then restarts lazily in the last
+ * working directory the shell reported.
+ */
+
+#if !defined(_WIN32)
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "sandbox_internal.h"
+#include <arc/log.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+#define SHELL_READ_SIZE      65536  /* Bytes per read() */
+#define SHELL_WAIT_SLICE_MS  20     /* waitpid() polling interval without pidfd */
+#define SHELL_MAX_CWD        4096
+#define SHELL_TRAILER_MAX    (SHELL_MAX_CWD + 64)   /* Sentinel line on stdout */
+#define SHELL_EOF_GRACE_MS   1000   /* Wait for the shell to exit after its pipes close */
+
+struct ac_sandbox_shell {
+    ac_sandbox_t *sandbox;
+    pid_t pid;                          /* -1 = not running */
+    int pidfd;
+    int in_fd;                          /* Our end of the shell's stdin */
+    int out_fd;
+    int err_fd;
+    char cwd[SHELL_MAX_CWD];
+    char sentinel[48];
+    size_t sentinel_len;
+};
+
+/*============================================================================
+ * Shell Process
+ *============================================================================*/
+
+static void close_fd(int *fd) {
+    if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+/* Append `text` to `dst` as a single-quoted shell word */
+static size_t quote_into(char *dst, const char *text) {
+    size_t n = 0;
+    dst[n++] = '\'';
+    for (const char *p = text; *p; p++) {
+        if (*p == '\'') {
+            memcpy(dst + n, "'\\''", 4);
+            n += 4;
+        } else {
+            dst[n++] = *p;
+        }
+    }
+    dst[n++] = '\'';
+    return n;
+}
+
+/* Bytes quote_into() writes for `text` */
+static size_t quoted_len(const char *text) {
+    size_t n = 2;
+    for (const char *p = text; *p; p++) n += *p == '\'' ? 4 : 1;
+    return n;
+}
+
+/* Kill the shell and everything it started; the next command restarts it */
+static void shell_stop(ac_sandbox_shell_t *shell) {
+    if (shell->pid > 0) {
+        kill(-shell->pid, SIGKILL);
+        kill(shell->pid, SIGKILL);
+        while (waitpid(shell->pid, NULL, 0) < 0 && errno == EINTR) {
+        }
+    }
+    shell->pid = -1;
+    close_fd(&shell->pidfd);
+    close_fd(&shell->in_fd);
+    close_fd(&shell->out_fd);
+    close_fd(&shell->err_fd);
+}
+
+static arc_err_t shell_start(ac_sandbox_shell_t *shell) {
+    int sock[2], out_pipe[2], err_pipe[2];
+
+    /* A socket rather than a pipe: sends can opt out of SIGPIPE */
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sock) < 0) {
+        AC_LOG_ERROR("Failed to create socket pair: %s", strerror(errno));
+        return ARC_ERR_IO;
+    }
+    fcntl(sock[0], F_SETFD, FD_CLOEXEC);
+    fcntl(sock[1], F_SETFD, FD_CLOEXEC);
+#if defined(SO_NOSIGPIPE)
+    int on = 1;
+    setsockopt(sock[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    if (ac_sandbox_open_pipe(out_pipe) < 0) {
+        AC_LOG_ERROR("Failed to create pipe: %s", strerror(errno));
+        close(sock[0]);
+        close(sock[1]);
+        return ARC_ERR_IO;
+    }
+    if (ac_sandbox_open_pipe(err_pipe) < 0) {
+        AC_LOG_ERROR("Failed to create pipe: %s", strerror(errno));
+        close(sock[0]);
+        close(sock[1]);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        return ARC_ERR_IO;
+    }
+
+    /* cd before exec, so the session shell starts in the right place */
+    char *command = malloc(quoted_len(shell->cwd) + 64);
+    if (!command) {
+        close(sock[0]);
+        close(sock[1]);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        return ARC_ERR_NO_MEMORY;
+    }
+    size_t n = 6;
+    memcpy(command, "cd -- ", 6);
+    n += quote_into(command + n, shell->cwd);
+    strcpy(command + n, " 2>/dev/null; exec /bin/sh 8>&1 9>&2");
+
+    /* The session shell gets the rlimits; cgroups are per exec command */
+    ac_sandbox_child_setup_t setup = {
+        .limits = &shell->sandbox->limits,
+        .cgroup_procs_fd = -1,
+    };
+
+    pid_t pid;
+    int spawn_err = ac_sandbox_spawn_shell(command, sock[1], out_pipe[1], err_pipe[1],
+                                           AC_SANDBOX_SPAWN_POSIX, &setup, &pid);
+    free(command);
+    close(sock[1]);
+    close(out_pipe[1]);
+    close(err_pipe[1]);
+    if (spawn_err != 0) {
+        close(sock[0]);
+        close(out_pipe[0]);
+        close(err_pipe[0]);
+        AC_LOG_ERROR("Failed to start /bin/sh: %s", strerror(spawn_err));
+        return ARC_ERR_IO;
+    }
+
+    fcntl(out_pipe[0], F_SETFL, fcntl(out_pipe[0], F_GETFL) | O_NONBLOCK);
+    fcntl(err_pipe[0], F_SETFL, fcntl(err_pipe[0], F_GETFL) | O_NONBLOCK);
+
+    shell->pid = pid;
+    shell->pidfd = ac_sandbox_open_pidfd(pid);
+    shell->in_fd = sock[0];
+    shell->out_fd = out_pipe[0];
+    shell->err_fd = err_pipe[0];
+    return ARC_OK;
+}
+
+/* Wait up to wait_ms for the shell to exit; 1 once it is reaped */
+static int shell_reap(ac_sandbox_shell_t *shell, int *status, int wait_ms) {
+    long long deadline = ac_sandbox_monotonic_ms() + wait_ms;
+    for (;;) {
+        pid_t r = waitpid(shell->pid, status, WNOHANG);
+        if (r == shell->pid) return 1;
+        if (r < 0 && errno != EINTR) return 0;
+
+        long long left = deadline - ac_sandbox_monotonic_ms();
+        if (left <= 0) return 0;
+        if (shell->pidfd >= 0) {
+            struct pollfd pfd = { .fd = shell->pidfd, .events = POLLIN };
+            poll(&pfd, 1, (int)left);
+        } else {
+            poll(NULL, 0, left < SHELL_WAIT_SLICE_MS ? (int)left : SHELL_WAIT_SLICE_MS);
+        }
+    }
+}
+
+/* Write the whole framed command to the shell's stdin */
+static int shell_send(ac_sandbox_shell_t *shell, const char *data, size_t len) {
+#if defined(MSG_NOSIGNAL)
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;                /* SO_NOSIGPIPE is set instead */
+#endif
+    while (len > 0) {
+        ssize_t n = send(shell->in_fd, data, len, flags);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/*============================================================================
+ * Output Framing
+ *============================================================================*/
+
+typedef struct {
+    int fd;
+    ac_sandbox_stream_t stream;
+    ac_sandbox_sink_t *sink;
+    char *buf;                          /* Read but not yet passed on */
+    size_t len;
+    int done;                           /* Sentinel seen */
+    int eof;                            /* Shell closed the stream */
+} shell_stream_t;
+
+typedef struct {
+    ac_sandbox_shell_t *shell;
+    shell_stream_t streams[2];          /* stdout, stderr */
+    ac_sandbox_sink_t out;
+    ac_sandbox_sink_t err;
+    const ac_sandbox_exec_options_t *options;
+    int status;                         /* Exit code from the sentinel line */
+    int stop;                           /* Callback or output limit: kill the command */
+    size_t total;                       /* Output bytes passed on */
+    size_t limit;                       /* Output limit (0 = none) */
+    int limit_hit;
+} shell_io_t;
+
+static void emit(shell_io_t *io, shell_stream_t *s, const char *data, size_t len) {
+    if (len == 0 || io->limit_hit) return;
+    if (io->limit && io->total + len > io->limit) {
+        len = io->limit - io->total;
+        io->limit_hit = 1;
+        io->stop = 1;
+    }
+    io->total += len;
+    ac_sandbox_sink_append(s->sink, data, len);
+    if (io->options->on_output && len > 0 && (!io->stop || io->limit_hit) &&
+        io->options->on_output(s->stream, data, len, io->options->user_data) != 0) {
+        io->stop = 1;
+    }
+}
+
+/* Parse "SENTINEL <rc> <pwd>\n" at the start of the stdout buffer */
+static int parse_trailer(shell_io_t *io, shell_stream_t *s) {
+    ac_sandbox_shell_t *shell = io->shell;
+    char *line = s->buf + shell->sentinel_len;
+    char *end = memchr(line, '\n', s->len - shell->sentinel_len);
+    if (!end) return 0;
+
+    *end = '\0';
+    char *pwd = NULL;
+    io->status = (int)strtol(line, &pwd, 10);
+    if (pwd && *pwd == ' ' && pwd[1] && strlen(pwd + 1) < sizeof(shell->cwd)) {
+        strcpy(shell->cwd, pwd + 1);
+    }
+    return 1;
+}
+
+/*
+ * Pass on everything before the sentinel. Without a sentinel, the last
+ * sentinel_len - 1 bytes are held back in case it is split across reads.
+ */
+static void scan(shell_io_t *io, shell_stream_t *s) {
+    ac_sandbox_shell_t *shell = io->shell;
+    char *hit = memmem(s->buf, s->len, shell->sentinel, shell->sentinel_len);
+
+    if (!hit) {
+        size_t keep = s->len < shell->sentinel_len - 1 ? s->len : shell->sentinel_len - 1;
+        emit(io, s, s->buf, s->len - keep);
+        memmove(s->buf, s->buf + s->len - keep, keep);
+        s->len = keep;
+        return;
+    }
+
+    emit(io, s, s->buf, (size_t)(hit - s->buf));
+    s->len -= (size_t)(hit - s->buf);
+    memmove(s->buf, hit, s->len);
+
+    if (s->stream == AC_SANDBOX_STDERR || parse_trailer(io, s) ||
+        s->len >= SHELL_TRAILER_MAX) {
+        s->done = 1;
+        s->len = 0;
+    }
+}
+
+/*
+ * Read what is available from one stream, marking it at EOF (usually
+ * the shell exiting). Stops after one read unless `drain` is set.
+ */
+static void read_stream(shell_io_t *io, shell_stream_t *s, int drain) {
+    while (!s->done && !s->eof) {
+        ssize_t n = read(s->fd, s->buf + s->len, SHELL_READ_SIZE);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) s->eof = 1;
+            return;
+        }
+        if (n == 0) {
+            s->eof = 1;
+            return;
+        }
+
+        s->len += (size_t)n;
+        scan(io, s);
+        if (!drain && (size_t)n < SHELL_READ_SIZE) return;
+    }
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+ac_sandbox_shell_t *ac_sandbox_shell_open(ac_sandbox_t *sandbox, const char *cwd) {
+    if (!sandbox) return NULL;
+
+    ac_sandbox_shell_t *shell = calloc(1, sizeof(*shell));
+    if (!shell) return NULL;
+
+    shell->sandbox = sandbox;
+    shell->pid = -1;
+    shell->pidfd = -1;
+    shell->in_fd = -1;
+    shell->out_fd = -1;
+    shell->err_fd = -1;
+
+    if (!cwd) cwd = sandbox->workspace_path;
+    if (cwd) {
+        snprintf(shell->cwd, sizeof(shell->cwd), "%s", cwd);
+    } else if (!getcwd(shell->cwd, sizeof(shell->cwd))) {
+        strcpy(shell->cwd, "/");
+    }
+
+    /* Random per session, so command output cannot forge the framing */
+    unsigned long long token = 0;
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || read(fd, &token, sizeof(token)) != (ssize_t)sizeof(token)) {
+        token = (unsigned long long)time(NULL) ^ ((unsigned long long)getpid() << 32) ^
+                (unsigned long long)(uintptr_t)shell;
+    }
+    if (fd >= 0) close(fd);
+    snprintf(shell->sentinel, sizeof(shell->sentinel), "__ARC_SHELL_%016llx__", token);
+    shell->sentinel_len = strlen(shell->sentinel);
+
+    return shell;
+}
+
+arc_err_t ac_sandbox_shell_exec(
+    ac_sandbox_shell_t *shell,
+    const char *command,
+    char *output,
+    size_t output_size,
+    int *exit_code,
+    const ac_sandbox_exec_options_t *options
+) {
+    static const ac_sandbox_exec_options_t default_options = {0};
+    if (!options) options = &default_options;
+
+    if (!shell || !command) {
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    /* Software-level validation, as for one-shot commands */
+    if (!ac_sandbox_check_command(shell->sandbox, command)) {
+        if (output && output_size > 0) {
+            snprintf(output, output_size,
+                     "{\"error\":\"Command blocked by sandbox\",\"reason\":\"%s\"}",
+                     ac_sandbox_denial_reason());
+        }
+        if (exit_code) *exit_code = -1;
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    long long started = ac_sandbox_monotonic_ms();
+    long long deadline = options->timeout_ms > 0 ? started + options->timeout_ms : -1;
+
+    if (shell->pid < 0) {
+        arc_err_t err = shell_start(shell);
+        if (err != ARC_OK) {
+            if (exit_code) *exit_code = -1;
+            return err;
+        }
+    }
+
+    /* Frame the command */
+    size_t slen = shell->sentinel_len;
+    char *script = malloc(quoted_len(command) + 2 * slen + 128);
+    char *bufs = malloc(2 * (SHELL_READ_SIZE + SHELL_TRAILER_MAX));
+    if (!script || !bufs) {
+        free(script);
+        free(bufs);
+        if (exit_code) *exit_code = -1;
+        return ARC_ERR_NO_MEMORY;
+    }
+    size_t n = 15;
+    memcpy(script, "{ command eval ", 15);
+    n += quote_into(script + n, command);
+    n += (size_t)sprintf(script + n,
+                         "\n} < /dev/null 8>&- 9>&-; printf '%%s %%d %%s\\n' %s \"$?\" \"$PWD\" >&8\n"
+                         "printf '%%s\\n' %s >&9\n",
+                         shell->sentinel, shell->sentinel);
+
+    shell_io_t io = {
+        .shell = shell,
+        .options = options,
+        .status = -1,
+        .limit = shell->sandbox->limits.output_bytes,
+    };
+    ac_sandbox_sink_init(&io.out, output, output_size);
+    ac_sandbox_sink_init(&io.err, options->error_output, options->error_output_size);
+    io.streams[0] = (shell_stream_t){
+        .fd = shell->out_fd, .stream = AC_SANDBOX_STDOUT, .sink = &io.out, .buf = bufs,
+    };
+    io.streams[1] = (shell_stream_t){
+        .fd = shell->err_fd, .stream = AC_SANDBOX_STDERR,
+        .sink = options->error_output ? &io.err : &io.out,
+        .buf = bufs + SHELL_READ_SIZE + SHELL_TRAILER_MAX,
+    };
+
+    int status = 0;
+    int exited = 0;
+    int timed_out = 0;
+    int failed = 0;
+    if (shell_send(shell, script, n) < 0) {
+        AC_LOG_ERROR("Failed to send command to shell: %s", strerror(errno));
+        failed = 1;
+    }
+    free(script);
+
+    while (!failed && !io.stop &&
+           !((io.streams[0].done || io.streams[0].eof) && (io.streams[1].done || io.streams[1].eof))) {
+        struct pollfd fds[3];
+        int nfds = 0;
+        int pid_index = -1;
+
+        for (int i = 0; i < 2; i++) {
+            if (!io.streams[i].done && !io.streams[i].eof) {
+                fds[nfds].fd = io.streams[i].fd;
+                fds[nfds].events = POLLIN;
+                nfds++;
+            }
+        }
+        if (shell->pidfd >= 0) {
+            pid_index = nfds;
+            fds[nfds].fd = shell->pidfd;
+            fds[nfds].events = POLLIN;
+            nfds++;
+        }
+
+        int wait_ms = -1;
+        if (deadline >= 0) {
+            long long left = deadline - ac_sandbox_monotonic_ms();
+            if (left <= 0) {
+                timed_out = 1;
+                break;
+            }
+            wait_ms = left > 0x7fffffff ? 0x7fffffff : (int)left;
+        }
+        if (shell->pidfd < 0 && (wait_ms < 0 || wait_ms > SHELL_WAIT_SLICE_MS)) {
+            wait_ms = SHELL_WAIT_SLICE_MS;
+        }
+
+        int ready = poll(fds, (nfds_t)nfds, wait_ms);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            AC_LOG_ERROR("poll failed: %s", strerror(errno));
+            failed = 1;
+            break;
+        }
+
+        for (int i = 0; i < nfds; i++) {
+            if (i == pid_index || !fds[i].revents) continue;
+            read_stream(&io, fds[i].fd == io.streams[0].fd ? &io.streams[0] : &io.streams[1], 0);
+        }
+
+        /* The command may have ended the shell (exit, exec, set -e, ...) */
+        if (pid_index < 0 || fds[pid_index].revents) {
+            pid_t r = waitpid(shell->pid, &status, WNOHANG);
+            if (r == shell->pid) {
+                exited = 1;
+                break;
+            } else if (r < 0 && errno != EINTR) {
+                AC_LOG_ERROR("waitpid failed: %s", strerror(errno));
+                failed = 1;
+                break;
+            }
+        }
+    }
+
+    /* A stream closed without its sentinel: the shell is exiting, or lost */
+    int lost = 0;
+    if (!failed && !io.stop && !exited &&
+        ((io.streams[0].eof && !io.streams[0].done) || (io.streams[1].eof && !io.streams[1].done))) {
+        int grace = SHELL_EOF_GRACE_MS;
+        if (deadline >= 0) {
+            long long left = deadline - ac_sandbox_monotonic_ms();
+            if (left < grace) grace = left > 0 ? (int)left : 0;
+        }
+        exited = shell_reap(shell, &status, grace);
+        lost = !exited;
+        if (lost && deadline >= 0 && ac_sandbox_monotonic_ms() >= deadline) {
+            lost = 0;
+            timed_out = 1;
+        }
+    }
+
+    /* Without a sentinel, held-back bytes were output after all */
+    for (int i = 0; i < 2; i++) {
+        shell_stream_t *s = &io.streams[i];
+        if (exited) read_stream(&io, s, 1);
+        if (!s->done) emit(&io, s, s->buf, s->len);
+    }
+    if (exited) {
+        /* Already reaped: its pid must not be signalled again */
+        shell->pid = -1;
+        shell_stop(shell);
+    } else if (failed || lost || timed_out || io.stop) {
+        shell_stop(shell);
+    }
+    free(bufs);
+
+    /* The command may have moved directories or planted symlinks */
+    ac_sandbox_invalidate_path_cache(shell->sandbox);
+
+    if (options->stats) {
+        memset(options->stats, 0, sizeof(*options->stats));
+        options->stats->wall_ms = ac_sandbox_monotonic_ms() - started;
+        options->stats->output_bytes = io.total;
+        if (io.limit_hit) {
+            options->stats->limit_hit = AC_SANDBOX_LIMIT_OUTPUT;
+            AC_LOG_WARN("Shell command killed after %zu bytes of output", io.total);
+        }
+    }
+
+    if (failed) {
+        if (exit_code) *exit_code = -1;
+        return ARC_ERR_IO;
+    }
+
+    if (lost) {
+        AC_LOG_WARN("Shell closed its output without finishing the command, restarting shell");
+        if (exit_code) *exit_code = -1;
+        return ARC_ERR_IO;
+    }
+
+    if (timed_out) {
+        AC_LOG_WARN("Shell command timed out after %d ms, restarting shell", options->timeout_ms);
+        if (exit_code) *exit_code = -1;
+        return ARC_ERR_TIMEOUT;
+    }
+
+    if (exit_code) {
+        if (exited) *exit_code = ac_sandbox_decode_status(status);
+        else if (io.stop) *exit_code = 128 + SIGKILL;
+        else *exit_code = io.status;
+    }
+    return ARC_OK;
+}
+
+const char *ac_sandbox_shell_cwd(const ac_sandbox_shell_t *shell) {
+    return shell ? shell->cwd : NULL;
+}
+
+void ac_sandbox_shell_close(ac_sandbox_shell_t *shell) {
+    if (!shell) return;
+    shell_stop(shell);
+    free(shell);
+}
+
+#else /* _WIN32 */
+
+#include "sandbox_internal.h"
+
+/*============================================================================
+ * Windows: not supported
+ *============================================================================*/
+
+ac_sandbox_shell_t *ac_sandbox_shell_open(ac_sandbox_t *sandbox, const char *cwd) {
+    (void)sandbox;
+    (void)cwd;
+    return NULL;
+}
+
+arc_err_t ac_sandbox_shell_exec(
+    ac_sandbox_shell_t *shell,
+    const char *command,
+    char *output,
+    size_t output_size,
+    int *exit_code,
+    const ac_sandbox_exec_options_t *options
+) {
+    (void)shell;
+    (void)command;
+    (void)options;
+    if (output && output_size > 0) output[0] = '\0';
+    if (exit_code) *exit_code = -1;
+    return ARC_ERR_NOT_IMPLEMENTED;
+}
+
+const char *ac_sandbox_shell_cwd(const ac_sandbox_shell_t *shell) {
+    (void)shell;
+    return NULL;
+}
+
+void ac_sandbox_shell_close(ac_sandbox_shell_t *shell) {
+    (void)shell;
+}
+
+#endif /* _WIN32 */
@@ -0,0 +1,472 @@
+/**
+ * @file search_glob.c
+ * @brief Compiled path globs and mtime-ordered file finding
+ *
+ * Braces are expanded at compile time. Every alternative becomes a run
+ * of segment matchers closed by an accept state, all in one array, and
+ * a path is matched by stepping a set of active states (a bitset) one
+ * segment at a time: a "**" state stays active and also passes straight
+ * on to the next segment. Once a directory's set holds no state that
+ * still expects a segment, nothing below it can match.
+ *
+ * ac_glob_find() keeps the newest matches in a min-heap keyed on the
+ * modification time, so only max_results paths are ever retained.
+ */
+
+#include <arc/glob.h>
+#include <arc/walk.h>
+#include "search_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define GLOB_MAX_ALTERNATIVES 256
+#define GLOB_DEFAULT_RESULTS 1000
+#define GLOB_STACK_WORDS 8              /* States matched without malloc: 512 */
+
+/*============================================================================
+ * Compiled Pattern
+ *============================================================================*/
+
+typedef enum {
+    SEG_MATCH = 0,                      /* One segment against a glob */
+    SEG_GLOBSTAR,                       /* "**": zero or more segments */
+    SEG_ACCEPT,                         /* End of an alternative */
+} seg_kind_t;
+
+typedef struct {
+    seg_kind_t kind;
+    ac_glob_t glob;                     /* SEG_MATCH only */
+} glob_seg_t;
+
+struct ac_glob_pattern {
+    glob_seg_t *segs;
+    size_t count;
+    size_t capacity;
+    size_t words;                       /* Bitset size in 64-bit words */
+    uint64_t *initial;                  /* Active states before the first segment */
+    uint64_t *accept;                   /* SEG_ACCEPT states */
+    int hidden;                         /* A segment names a dot file literally */
+};
+
+static void set_error(char *err, size_t errsize, const char *msg) {
+    if (err && errsize > 0) snprintf(err, errsize, "%s", msg);
+}
+
+static int push_seg(ac_glob_pattern_t *g, seg_kind_t kind, const char *text, size_t len) {
+    if (g->count == g->capacity) {
+        size_t cap = g->capacity ? g->capacity * 2 : 16;
+        glob_seg_t *segs = realloc(g->segs, cap * sizeof(*segs));
+        if (!segs) return -1;
+        g->segs = segs;
+        g->capacity = cap;
+    }
+    glob_seg_t *seg = &g->segs[g->count];
+    memset(seg, 0, sizeof(*seg));
+    seg->kind = kind;
+    if (kind == SEG_MATCH && ac_glob_compile(&seg->glob, text, len) != 0) return -1;
+    g->count++;
+    return 0;
+}
+
+/* One brace-free alternative; returns its first state or (size_t)-1 */
+static size_t add_alternative(ac_glob_pattern_t *g, const char *p) {
+    while (p[0] == '.' && p[1] == '/') p += 2;
+    while (*p == '/') p++;
+    size_t len = strlen(p);
+    while (len > 0 && p[len - 1] == '/') len--;
+    if (len == 0) return (size_t)-1;
+
+    size_t start = g->count;
+    int ok = 0;
+
+    /* No slash: the name at any depth */
+    if (!memchr(p, '/', len) && push_seg(g, SEG_GLOBSTAR, NULL, 0) != 0) return (size_t)-1;
+
+    const char *end = p + len;
+    while (p < end) {
+        const char *slash = memchr(p, '/', (size_t)(end - p));
+        size_t seg_len = slash ? (size_t)(slash - p) : (size_t)(end - p);
+
+        if (seg_len == 2 && p[0] == '*' && p[1] == '*') {
+            if (g->count == start || g->segs[g->count - 1].kind != SEG_GLOBSTAR) {
+                if (push_seg(g, SEG_GLOBSTAR, NULL, 0) != 0) return (size_t)-1;
+            }
+        } else if (seg_len > 0 && !(seg_len == 1 && p[0] == '.')) {
+            if (push_seg(g, SEG_MATCH, p, seg_len) != 0) return (size_t)-1;
+            if (p[0] == '.') g->hidden = 1;
+        }
+        p += seg_len + (slash ? 1 : 0);
+    }
+
+    /* A trailing "**" matches files below, not the directory itself */
+    if (g->count > start && g->segs[g->count - 1].kind == SEG_GLOBSTAR) {
+        ok = push_seg(g, SEG_MATCH, "*", 1) == 0;
+    } else {
+        ok = g->count > start;
+    }
+    if (!ok || push_seg(g, SEG_ACCEPT, NULL, 0) != 0) return (size_t)-1;
+    return start;
+}
+
+/*============================================================================
+ * Brace Expansion
+ *============================================================================*/
+
+typedef struct {
+    char **items;
+    size_t count;
+} alt_list_t;
+
+/* Find the first "{...,...}" group: open, close and comma positions at its level */
+static int find_group(const char *p, size_t *open, size_t *close, size_t *commas, size_t *ncommas) {
+    for (size_t i = 0; p[i]; i++) {
+        if (p[i] == '\\' && p[i + 1]) {
+            i++;
+            continue;
+        }
+        if (p[i] != '{') continue;
+
+        int depth = 0;
+        size_t n = 0;
+        for (size_t j = i; p[j]; j++) {
+            if (p[j] == '\\' && p[j + 1]) {
+                j++;
+            } else if (p[j] == '{') {
+                depth++;
+            } else if (p[j] == ',' && depth == 1) {
+                if (n < GLOB_MAX_ALTERNATIVES) commas[n] = j;
+                n++;
+            } else if (p[j] == '}' && --depth == 0) {
+                if (n == 0 || n >= GLOB_MAX_ALTERNATIVES) break;   /* "{x}" is literal */
+                *open = i;
+                *close = j;
+                *ncommas = n;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int expand_braces(const char *p, alt_list_t *out) {
+    size_t open, close, ncommas;
+    size_t commas[GLOB_MAX_ALTERNATIVES];
+
+    if (!find_group(p, &open, &close, commas, &ncommas)) {
+        if (out->count >= GLOB_MAX_ALTERNATIVES) return -1;
+        char *copy = strdup(p);
+        if (!copy) return -1;
+        out->items[out->count++] = copy;
+        return 0;
+    }
+
+    size_t total = strlen(p);
+    char *buf = malloc(total + 1);
+    if (!buf) return -1;
+
+    int rc = 0;
+    size_t from = open + 1;
+    for (size_t k = 0; k <= ncommas && rc == 0; k++) {
+        size_t to = k < ncommas ? commas[k] : close;
+        size_t n = 0;
+        memcpy(buf, p, open);
+        n += open;
+        memcpy(buf + n, p + from, to - from);
+        n += to - from;
+        memcpy(buf + n, p + close + 1, total - close - 1);
+        n += total - close - 1;
+        buf[n] = '\0';
+        rc = expand_braces(buf, out);
+        from = to + 1;
+    }
+    free(buf);
+    return rc;
+}
+
+/*============================================================================
+ * State Sets
+ *============================================================================*/
+
+static void add_state(const ac_glob_pattern_t *g, uint64_t *set, size_t i) {
+    set[i / 64] |= (uint64_t)1 << (i % 64);
+    if (g->segs[i].kind == SEG_GLOBSTAR) add_state(g, set, i + 1);
+}
+
+static void step(const ac_glob_pattern_t *g, const uint64_t *in, uint64_t *out,
+                 const char *name, size_t len) {
+    memset(out, 0, g->words * sizeof(uint64_t));
+    for (size_t w = 0; w < g->words; w++) {
+        uint64_t bits = in[w];
+        while (bits) {
+            size_t i = w * 64 + (size_t)__builtin_ctzll(bits);
+            bits &= bits - 1;
+            const glob_seg_t *seg = &g->segs[i];
+            if (seg->kind == SEG_GLOBSTAR) {
+                add_state(g, out, i);
+            } else if (seg->kind == SEG_MATCH && ac_glob_match(&seg->glob, name, len)) {
+                add_state(g, out, i + 1);
+            }
+        }
+    }
+}
+
+/* States after every segment of path; returns 0 if the set went empty */
+static int run(const ac_glob_pattern_t *g, const char *path, uint64_t *set, uint64_t *tmp) {
+    memcpy(set, g->initial, g->words * sizeof(uint64_t));
+    const char *p = path;
+    while (*p) {
+        const char *slash = strchr(p, '/');
+        size_t len = slash ? (size_t)(slash - p) : strlen(p);
+        if (len > 0 && !(len == 1 && p[0] == '.')) {
+            step(g, set, tmp, p, len);
+            memcpy(set, tmp, g->words * sizeof(uint64_t));
+            int any = 0;
+            for (size_t w = 0; w < g->words && !any; w++) any = set[w] != 0;
+            if (!any) return 0;
+        }
+        if (!slash) break;
+        p = slash + 1;
+    }
+    return 1;
+}
+
+/* Run path and test the final set against accept (want_accept) or the rest */
+static int run_test(const ac_glob_pattern_t *g, const char *path, int want_accept) {
+    uint64_t stack_buf[2 * GLOB_STACK_WORDS];
+    uint64_t *buf = stack_buf;
+    if (g->words > GLOB_STACK_WORDS) {
+        buf = malloc(2 * g->words * sizeof(uint64_t));
+        if (!buf) return 0;
+    }
+    uint64_t *set = buf;
+    uint64_t *tmp = buf + g->words;
+
+    int hit = 0;
+    if (run(g, path, set, tmp)) {
+        for (size_t w = 0; w < g->words && !hit; w++) {
+            uint64_t mask = want_accept ? g->accept[w] : ~g->accept[w];
+            hit = (set[w] & mask) != 0;
+        }
+    }
+    if (buf != stack_buf) free(buf);
+    return hit;
+}
+
+/*============================================================================
+ * Pattern API
+ *============================================================================*/
+
+ac_glob_pattern_t *ac_glob_pattern_compile(const char *pattern, char *err, size_t errsize) {
+    if (!pattern || !pattern[0]) {
+        set_error(err, errsize, "empty pattern");
+        return NULL;
+    }
+
+    ac_glob_pattern_t *g = calloc(1, sizeof(*g));
+    alt_list_t alts = { calloc(GLOB_MAX_ALTERNATIVES, sizeof(char *)), 0 };
+    size_t *starts = calloc(GLOB_MAX_ALTERNATIVES, sizeof(size_t));
+    size_t nstarts = 0;
+    if (!g || !alts.items || !starts) {
+        set_error(err, errsize, "out of memory");
+        goto fail;
+    }
+
+    if (expand_braces(pattern, &alts) != 0) {
+        set_error(err, errsize, "too many brace alternatives");
+        goto fail;
+    }
+    for (size_t i = 0; i < alts.count; i++) {
+        size_t start = add_alternative(g, alts.items[i]);
+        if (start != (size_t)-1) starts[nstarts++] = start;
+    }
+    if (nstarts == 0) {
+        set_error(err, errsize, "pattern matches no path");
+        goto fail;
+    }
+
+    g->words = (g->count + 64) / 64;    /* One spare bit for the closure past the end */
+    g->initial = calloc(g->words, sizeof(uint64_t));
+    g->accept = calloc(g->words, sizeof(uint64_t));
+    if (!g->initial || !g->accept) {
+        set_error(err, errsize, "out of memory");
+        goto fail;
+    }
+    for (size_t i = 0; i < nstarts; i++) add_state(g, g->initial, starts[i]);
+    for (size_t i = 0; i < g->count; i++) {
+        if (g->segs[i].kind == SEG_ACCEPT) g->accept[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+
+    for (size_t i = 0; i < alts.count; i++) free(alts.items[i]);
+    free(alts.items);
+    free(starts);
+    return g;
+
+fail:
+    if (alts.items) {
+        for (size_t i = 0; i < alts.count; i++) free(alts.items[i]);
+        free(alts.items);
+    }
+    free(starts);
+    ac_glob_pattern_free(g);
+    return NULL;
+}
+
+int ac_glob_pattern_match(const ac_glob_pattern_t *pattern, const char *rel_path) {
+    if (!pattern || !rel_path) return 0;
+    return run_test(pattern, rel_path, 1);
+}
+
+int ac_glob_pattern_can_descend(const ac_glob_pattern_t *pattern, const char *rel_dir) {
+    if (!pattern || !rel_dir) return 0;
+    return run_test(pattern, rel_dir, 0);
+}
+
+void ac_glob_pattern_free(ac_glob_pattern_t *pattern) {
+    if (!pattern) return;
+    for (size_t i = 0; i < pattern->count; i++) {
+        if (pattern->segs[i].kind == SEG_MATCH) ac_glob_free(&pattern->segs[i].glob);
+    }
+    free(pattern->segs);
+    free(pattern->initial);
+    free(pattern->accept);
+    free(pattern);
+}
+
+/*============================================================================
+ * Finding Files
+ *============================================================================*/
+
+typedef struct {
+    const ac_glob_pattern_t *pattern;
+    ac_glob_file_t *heap;               /* Min-heap: the oldest kept file on top */
+    size_t count;
+    size_t max;
+    size_t total;
+    int failed;
+} find_t;
+
+/* Newer first; equal times by path so results do not depend on the walk */
+static int newer(int64_t a_time, const char *a_path, const ac_glob_file_t *b) {
+    if (a_time != b->mtime_ns) return a_time > b->mtime_ns;
+    return strcmp(a_path, b->path) < 0;
+}
+
+static void sift_down(ac_glob_file_t *heap, size_t count, size_t i) {
+    for (;;) {
+        size_t l = 2 * i + 1, r = l + 1, m = i;
+        if (l < count && newer(heap[m].mtime_ns, heap[m].path, &heap[l])) m = l;
+        if (r < count && newer(heap[m].mtime_ns, heap[m].path, &heap[r])) m = r;
+        if (m == i) return;
+        ac_glob_file_t t = heap[i];
+        heap[i] = heap[m];
+        heap[m] = t;
+        i = m;
+    }
+}
+
+static void sift_up(ac_glob_file_t *heap, size_t i) {
+    while (i > 0) {
+        size_t p = (i - 1) / 2;
+        if (!newer(heap[p].mtime_ns, heap[p].path, &heap[i])) return;
+        ac_glob_file_t t = heap[i];
+        heap[i] = heap[p];
+        heap[p] = t;
+        i = p;
+    }
+}
+
+static int descend_dir(const char *rel_path, void *ctx) {
+    return ac_glob_pattern_can_descend((const ac_glob_pattern_t *)ctx, rel_path);
+}
+
+static int find_entry(const ac_walk_entry_t *entry, void *user_data) {
+    find_t *f = (find_t *)user_data;
+
+    if (entry->type != AC_WALK_FILE && entry->type != AC_WALK_SYMLINK) return AC_WALK_CONTINUE;
+    if (!run_test(f->pattern, entry->rel_path, 1)) return AC_WALK_CONTINUE;
+
+    struct stat st;
+    if (stat(entry->path, &st) != 0 || !S_ISREG(st.st_mode)) return AC_WALK_CONTINUE;
+    int64_t t = ac_stat_mtime_ns(&st);
+    f->total++;
+
+    if (f->count < f->max) {
+        char *path = strdup(entry->path);
+        if (!path) {
+            f->failed = 1;
+            return AC_WALK_STOP;
+        }
+        f->heap[f->count].path = path;
+        f->heap[f->count].mtime_ns = t;
+        sift_up(f->heap, f->count++);
+    } else if (newer(t, entry->path, &f->heap[0])) {
+        char *path = strdup(entry->path);
+        if (!path) {
+            f->failed = 1;
+            return AC_WALK_STOP;
+        }
+        free(f->heap[0].path);
+        f->heap[0].path = path;
+        f->heap[0].mtime_ns = t;
+        sift_down(f->heap, f->count, 0);
+    }
+    return AC_WALK_CONTINUE;
+}
+
+static int compare_newest(const void *a, const void *b) {
+    const ac_glob_file_t *fa = (const ac_glob_file_t *)a;
+    const ac_glob_file_t *fb = (const ac_glob_file_t *)b;
+    if (newer(fa->mtime_ns, fa->path, fb)) return -1;
+    return newer(fb->mtime_ns, fb->path, fa) ? 1 : 0;
+}
+
+arc_err_t ac_glob_find(
+    const char *root,
+    const ac_glob_pattern_t *pattern,
+    const ac_glob_find_options_t *options,
+    ac_glob_result_t *result
+) {
+    if (!root || !pattern || !result) return ARC_ERR_INVALID_ARG;
+    memset(result, 0, sizeof(*result));
+
+    ac_glob_find_options_t defaults = {0};
+    const ac_glob_find_options_t *opts = options ? options : &defaults;
+
+    find_t f = {0};
+    f.pattern = pattern;
+    f.max = opts->max_results ? opts->max_results : GLOB_DEFAULT_RESULTS;
+    f.heap = calloc(f.max, sizeof(*f.heap));
+    if (!f.heap) return ARC_ERR_NO_MEMORY;
+
+    ac_walk_options_t walk = {
+        .hidden = opts->hidden || pattern->hidden,
+        .no_ignore = opts->no_ignore,
+        .ignore_globs = opts->ignore_globs,
+        .ignore_globs_count = opts->ignore_globs_count,
+        .descend = descend_dir,
+        .descend_ctx = (void *)pattern,
+    };
+    arc_err_t err = ac_walk(root, &walk, find_entry, &f);
+    if (err == ARC_OK && f.failed) err = ARC_ERR_NO_MEMORY;
+    if (err != ARC_OK) {
+        for (size_t i = 0; i < f.count; i++) free(f.heap[i].path);
+        free(f.heap);
+        return err;
+    }
+
+    qsort(f.heap, f.count, sizeof(*f.heap), compare_newest);
+    result->files = f.heap;
+    result->count = f.count;
+    result->total = f.total;
+    return ARC_OK;
+}
+
+void ac_glob_result_free(ac_glob_result_t *result) {
+    if (!result) return;
+    for (size_t i = 0; i < result->count; i++) free(result->files[i].path);
+    free(result->files);
+    memset(result, 0, sizeof(*result));
+}
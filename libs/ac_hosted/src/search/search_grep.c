@@ -0,0 +1,702 @@
+/**
+ * @file search_grep.c
+ * @brief Content search: PCRE2 on whole buffers behind a literal prefilter
+ *
+ * Line-oriented search without a prefilter runs the regex over the
+ * whole buffer and maps each match back to its line. A match that runs
+ * past the end of its line is retried on that line alone, so lines are
+ * matched independently as in ripgrep.
+ *
+ * With a required literal the buffer is scanned with memmem()/memchr()
+ * and the regex only confirms the lines the literal occurs in, which is
+ * where nearly all of the time went before: most lines of most files
+ * cannot match.
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#define PCRE2_CODE_UNIT_WIDTH 8
+
+#include <arc/grep.h>
+#include <pcre2.h>
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+/* Files below this are read(); mapping them costs more than copying */
+#define GREP_MMAP_MIN (64 * 1024)
+
+/* Bytes inspected for NUL by the binary check */
+#define GREP_BINARY_PROBE 8192
+
+#define GREP_LITERAL_MAX 256
+
+struct ac_grep {
+    pcre2_code *code;                   /* NULL when literal_exact */
+    int caseless;
+    int multiline;
+    size_t max_filesize;
+    char literal[GREP_LITERAL_MAX + 1]; /* Required literal, lower case if caseless */
+    size_t literal_len;
+    int literal_exact;                  /* The pattern is the literal: no regex needed */
+};
+
+/*============================================================================
+ * Pattern Analysis
+ *============================================================================*/
+
+/* Skip a delimited escape argument at p ({..}, <..> or '..'); returns past the close */
+static const char *skip_delimited(const char *p) {
+    char close = *p == '{' ? '}' : *p == '<' ? '>' : '\'';
+    p++;
+    while (*p && *p != close) p++;
+    return *p ? p + 1 : p;
+}
+
+/* Bytes taken by the escape at p (p[0] is '\\', p[1] is not NUL), payload included */
+static size_t escape_len(const char *p) {
+    const char *q = p + 2;
+    switch (p[1]) {
+    case 'x':                           /* \xHH, \x{H..} */
+        if (*q == '{') return (size_t)(skip_delimited(q) - p);
+        for (int i = 0; i < 2 && isxdigit((unsigned char)*q); i++) q++;
+        break;
+    case 'o': case 'N':                 /* \o{O..}, \N{U+H..} */
+        if (*q == '{') return (size_t)(skip_delimited(q) - p);
+        break;
+    case 'p': case 'P':                 /* \p{Name}, \pL */
+        if (*q == '{') return (size_t)(skip_delimited(q) - p);
+        if (*q) q++;
+        break;
+    case 'c':                           /* \cX */
+        if (*q) q++;
+        break;
+    case 'k':                           /* \k<name>, \k'name', \k{name} */
+        if (*q == '<' || *q == '\'' || *q == '{') return (size_t)(skip_delimited(q) - p);
+        break;
+    case 'g':                           /* \gN, \g-N, \g{..}, \g<..>, \g'..' */
+        if (*q == '<' || *q == '\'' || *q == '{') return (size_t)(skip_delimited(q) - p);
+        if (*q == '-' || *q == '+') q++;
+        while (isdigit((unsigned char)*q)) q++;
+        break;
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+        /* \0NN octal, \NNN back reference or octal: taking every digit is safe */
+        while (isdigit((unsigned char)*q)) q++;
+        break;
+    default:
+        break;
+    }
+    return (size_t)(q - p);
+}
+
+/* ripgrep --smart-case: any uppercase letter outside escapes */
+static int has_uppercase(const char *p) {
+    while (*p) {
+        if (*p == '\\' && p[1]) {
+            p += escape_len(p);
+            continue;
+        }
+        if (isupper((unsigned char)*p)) return 1;
+        p++;
+    }
+    return 0;
+}
+
+/* Longest run of literal bytes that every match contains */
+typedef struct {
+    int caseless;
+    char run[GREP_LITERAL_MAX];
+    size_t run_len;
+    char best[GREP_LITERAL_MAX];
+    size_t best_len;
+    int broken;                         /* Anything but literal bytes was seen */
+} literal_builder_t;
+
+static void lit_flush(literal_builder_t *b) {
+    if (b->run_len > b->best_len) {
+        memcpy(b->best, b->run, b->run_len);
+        b->best_len = b->run_len;
+    }
+    b->run_len = 0;
+}
+
+static void lit_break(literal_builder_t *b) {
+    b->broken = 1;
+    lit_flush(b);
+}
+
+static void lit_add(literal_builder_t *b, unsigned char c) {
+    /*
+     * Caseless matching folds more than ASCII case in UTF mode: 'k'
+     * also matches U+212A (Kelvin) and 's' U+017F (long s). Such bytes
+     * end the run rather than risk a missed match.
+     */
+    if (b->caseless && (c >= 0x80 || c == 'k' || c == 'K' || c == 's' || c == 'S')) {
+        lit_break(b);
+        return;
+    }
+    if (b->run_len == sizeof(b->run)) {
+        lit_break(b);
+    }
+    b->run[b->run_len++] = b->caseless ? (char)tolower(c) : (char)c;
+}
+
+/* The last character was optional: take it back, whole if multi-byte */
+static void lit_drop_last(literal_builder_t *b) {
+    while (b->run_len > 0 && ((unsigned char)b->run[b->run_len - 1] & 0xC0) == 0x80) {
+        b->run_len--;
+    }
+    if (b->run_len > 0) b->run_len--;
+    lit_break(b);
+}
+
+/* "{n}", "{n,}", "{n,m}" or "{,m}": length of the quantifier, 0 if none */
+static size_t quantifier_len(const char *p, int *min_zero) {
+    const char *q = p + 1;
+    while (*q == ' ') q++;
+    const char *min = q;
+    while (isdigit((unsigned char)*q)) q++;
+    size_t min_digits = (size_t)(q - min);
+    size_t max_digits = 0;
+    while (*q == ' ') q++;
+    if (*q == ',') {
+        q++;
+        while (*q == ' ') q++;
+        const char *max = q;
+        while (isdigit((unsigned char)*q)) q++;
+        max_digits = (size_t)(q - max);
+        while (*q == ' ') q++;
+    } else if (min_digits == 0) {
+        return 0;
+    }
+    if (*q != '}' || (min_digits == 0 && max_digits == 0)) {
+        return 0;
+    }
+    *min_zero = min_digits == 0 || strtol(min, NULL, 10) == 0;
+    return (size_t)(q - p + 1);
+}
+
+/*
+ * Walk the pattern conservatively: top-level literal characters extend
+ * the current run, everything else ends it, and anything that might
+ * make the literal optional (top-level alternation, inline flags,
+ * quoting) gives up on a literal altogether.
+ */
+static void extract_literal(const char *p, literal_builder_t *b) {
+    int depth = 0;
+
+    while (*p) {
+        unsigned char c = (unsigned char)*p;
+
+        if (c == '\\') {
+            unsigned char e = (unsigned char)p[1];
+            if (!e) {
+                lit_break(b);
+                break;
+            }
+            if (e == 'Q') {
+                goto none;
+            }
+            if (depth == 0 && e < 0x80 && !isalnum(e)) {
+                lit_add(b, e);
+                p += 2;
+                continue;
+            }
+            lit_break(b);
+            p += escape_len(p);
+            continue;
+        }
+
+        switch (c) {
+        case '[': {
+            /* Skip the class; "]" right after "[" or "[^" is a member */
+            p++;
+            if (*p == '^') p++;
+            if (*p == ']') p++;
+            while (*p && *p != ']') {
+                if (*p == '\\' && p[1]) p++;
+                else if (*p == '[' && p[1] == ':') {
+                    const char *close = strstr(p, ":]");
+                    if (close) p = close + 1;
+                }
+                p++;
+            }
+            if (*p) p++;
+            lit_break(b);
+            continue;
+        }
+        case '(':
+            if (p[1] == '?' && p[2] && strchr("imnsxJU-^)", p[2])) {
+                goto none;                  /* Inline flags */
+            }
+            depth++;
+            lit_break(b);
+            p++;
+            continue;
+        case ')':
+            if (depth > 0) depth--;
+            lit_break(b);
+            p++;
+            continue;
+        case '|':
+            if (depth == 0) goto none;
+            p++;
+            continue;
+        case '*':
+        case '?':
+            lit_drop_last(b);
+            p++;
+            continue;
+        case '+':
+            lit_break(b);
+            p++;
+            continue;
+        case '{': {
+            int min_zero = 0;
+            size_t qlen = quantifier_len(p, &min_zero);
+            if (qlen > 0) {
+                if (min_zero) lit_drop_last(b);
+                else lit_break(b);
+                p += qlen;
+                continue;
+            }
+            break;                          /* A literal brace */
+        }
+        case '.':
+        case '^':
+        case '$':
+            lit_break(b);
+            p++;
+            continue;
+        default:
+            break;
+        }
+
+        if (depth == 0) {
+            lit_add(b, c);
+        }
+        p++;
+    }
+    lit_flush(b);
+    return;
+
+none:
+    b->broken = 1;
+    b->run_len = 0;
+    b->best_len = 0;
+}
+
+/*============================================================================
+ * Compile
+ *============================================================================*/
+
+static void set_error(char *error, size_t error_size, const char *msg) {
+    if (error && error_size > 0) {
+        snprintf(error, error_size, "%s", msg);
+    }
+}
+
+ac_grep_t *ac_grep_compile(
+    const char *pattern,
+    const ac_grep_options_t *options,
+    char *error,
+    size_t error_size
+) {
+    if (!pattern) {
+        set_error(error, error_size, "pattern is required");
+        return NULL;
+    }
+
+    ac_grep_options_t defaults = {0};
+    if (!options) options = &defaults;
+
+    ac_grep_t *grep = calloc(1, sizeof(*grep));
+    if (!grep) {
+        set_error(error, error_size, "out of memory");
+        return NULL;
+    }
+    grep->multiline = options->multiline;
+    grep->max_filesize = options->max_filesize;
+    grep->caseless = options->case_mode == AC_GREP_CASE_INSENSITIVE ||
+                     (options->case_mode == AC_GREP_CASE_SMART && !has_uppercase(pattern));
+
+    literal_builder_t builder;
+    memset(&builder, 0, sizeof(builder));
+    builder.caseless = grep->caseless;
+    if (options->fixed_strings) {
+        for (const char *p = pattern; *p; p++) lit_add(&builder, (unsigned char)*p);
+        lit_flush(&builder);
+    } else {
+        extract_literal(pattern, &builder);
+    }
+    memcpy(grep->literal, builder.best, builder.best_len);
+    grep->literal_len = builder.best_len;
+    grep->literal[grep->literal_len] = '\0';
+
+    /*
+     * The literal is the whole match if nothing was dropped. Caseless
+     * runs stop at characters with non-ASCII case variants, so an
+     * unbroken caseless literal is matched exactly by find_literal().
+     */
+    grep->literal_exact = !builder.broken && grep->literal_len > 0 &&
+                          memchr(grep->literal, '\n', grep->literal_len) == NULL;
+    if (grep->literal_exact) {
+        return grep;
+    }
+
+    uint32_t flags = PCRE2_UTF | PCRE2_MATCH_INVALID_UTF;
+    if (grep->caseless) flags |= PCRE2_CASELESS;
+    if (options->fixed_strings) flags |= PCRE2_LITERAL;
+    else flags |= PCRE2_MULTILINE;
+
+    int errcode = 0;
+    PCRE2_SIZE erroffset = 0;
+    grep->code = pcre2_compile((PCRE2_SPTR)pattern, PCRE2_ZERO_TERMINATED, flags,
+                               &errcode, &erroffset, NULL);
+    if (!grep->code) {
+        PCRE2_UCHAR msg[256];
+        pcre2_get_error_message(errcode, msg, sizeof(msg));
+        if (error && error_size > 0) {
+            snprintf(error, error_size, "%s at offset %zu", (const char *)msg, (size_t)erroffset);
+        }
+        free(grep);
+        return NULL;
+    }
+
+    /* Fails harmlessly when the library was built without JIT support */
+    pcre2_jit_compile(grep->code, PCRE2_JIT_COMPLETE);
+    return grep;
+}
+
+const char *ac_grep_literal(const ac_grep_t *grep) {
+    return grep ? grep->literal : "";
+}
+
+void ac_grep_free(ac_grep_t *grep) {
+    if (!grep) return;
+    if (grep->code) pcre2_code_free(grep->code);
+    free(grep);
+}
+
+/*============================================================================
+ * Search
+ *============================================================================*/
+
+#if defined(_WIN32)
+static const char *find_bytes(const char *hay, size_t n, const char *needle, size_t m) {
+    if (m == 0) return hay;
+    while (n >= m) {
+        const char *p = memchr(hay, needle[0], n - m + 1);
+        if (!p) return NULL;
+        if (memcmp(p, needle, m) == 0) return p;
+        n -= (size_t)(p - hay) + 1;
+        hay = p + 1;
+    }
+    return NULL;
+}
+#else
+#define find_bytes(hay, n, needle, m) ((const char *)memmem((hay), (n), (needle), (m)))
+#endif
+
+static int equal_folded(const char *text, const char *lower, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (tolower((unsigned char)text[i]) != (unsigned char)lower[i]) return 0;
+    }
+    return 1;
+}
+
+/* Next occurrence of the literal in [p, end) */
+static const char *find_literal(const ac_grep_t *grep, const char *p, const char *end) {
+    size_t len = grep->literal_len;
+    if ((size_t)(end - p) < len) return NULL;
+    if (!grep->caseless) {
+        return find_bytes(p, (size_t)(end - p), grep->literal, len);
+    }
+
+    /* Both cases of the first byte, like memchr2() */
+    unsigned char lo = (unsigned char)grep->literal[0];
+    unsigned char up = (unsigned char)toupper(lo);
+    const char *last = end - len + 1;
+    const char *a = memchr(p, lo, (size_t)(last - p));
+    const char *b = up != lo ? memchr(p, up, (size_t)(last - p)) : NULL;
+    while (a || b) {
+        const char *c = (!b || (a && a < b)) ? a : b;
+        if (equal_folded(c + 1, grep->literal + 1, len - 1)) return c;
+        if (c == a) a = memchr(c + 1, lo, (size_t)(last - c - 1));
+        else b = memchr(c + 1, up, (size_t)(last - c - 1));
+    }
+    return NULL;
+}
+
+static const char *line_start(const char *floor, const char *p) {
+    while (p > floor && p[-1] != '\n') p--;
+    return p;
+}
+
+static const char *line_end(const char *p, const char *end) {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    return nl ? nl : end;
+}
+
+typedef struct {
+    const char *at;
+    size_t line;
+} line_counter_t;
+
+static size_t line_number(line_counter_t *lc, const char *to) {
+    const char *p = lc->at;
+    while (p < to && (p = memchr(p, '\n', (size_t)(to - p))) != NULL) {
+        lc->line++;
+        p++;
+    }
+    lc->at = to;
+    return lc->line;
+}
+
+/* First match within [start, start + len) alone */
+static int match_line(const ac_grep_t *grep, pcre2_match_data *md,
+                      const char *start, size_t len, size_t *ms, size_t *me) {
+    int rc = pcre2_match(grep->code, (PCRE2_SPTR)start, len, 0, 0, md, NULL);
+    if (rc < 0) return 0;
+    PCRE2_SIZE *ov = pcre2_get_ovector_pointer(md);
+    *ms = ov[0];
+    *me = ov[1] > len ? len : ov[1];
+    return 1;
+}
+
+typedef struct {
+    const ac_grep_t *grep;
+    pcre2_match_data *md;
+    const char *data;
+    const char *end;
+    const char *path;
+    ac_grep_match_fn on_match;
+    void *user_data;
+    line_counter_t lines;
+    int count;
+} search_t;
+
+/* Report one match; returns non-zero to stop */
+static int report(search_t *s, const char *ls, const char *le, size_t ms, size_t me) {
+    s->count++;
+    if (!s->on_match) return 0;
+    ac_grep_match_t m = {
+        .path = s->path,
+        .line_number = line_number(&s->lines, ls),
+        .line = ls,
+        .line_len = (size_t)(le - ls),
+        .match_start = ms,
+        .match_end = me,
+    };
+    return s->on_match(&m, s->user_data);
+}
+
+static void search_lines(search_t *s) {
+    const ac_grep_t *grep = s->grep;
+    const char *pos = s->data;
+
+    while (pos < s->end) {
+        const char *ls, *le;
+        size_t ms, me;
+
+        if (grep->literal_len > 0) {
+            const char *hit = find_literal(grep, pos, s->end);
+            if (!hit) break;
+            ls = line_start(pos, hit);
+            le = line_end(hit, s->end);
+            if (grep->literal_exact) {
+                ms = (size_t)(hit - ls);
+                me = ms + grep->literal_len;
+            } else if (!match_line(grep, s->md, ls, (size_t)(le - ls), &ms, &me)) {
+                if (le >= s->end) break;
+                pos = le + 1;
+                continue;
+            }
+        } else {
+            int rc = pcre2_match(grep->code, (PCRE2_SPTR)s->data, (size_t)(s->end - s->data),
+                                 (size_t)(pos - s->data), 0, s->md, NULL);
+            if (rc < 0) break;
+            PCRE2_SIZE *ov = pcre2_get_ovector_pointer(s->md);
+            const char *mstart = s->data + ov[0];
+            const char *mend = s->data + ov[1];
+            ls = line_start(pos, mstart);
+            le = line_end(mstart, s->end);
+            if (mend > le) {
+                /* Ran into the next line: only a match within this one counts */
+                if (!match_line(grep, s->md, ls, (size_t)(le - ls), &ms, &me)) {
+                    if (le >= s->end) break;
+                    pos = le + 1;
+                    continue;
+                }
+            } else {
+                ms = (size_t)(mstart - ls);
+                me = (size_t)(mend - ls);
+            }
+        }
+
+        if (report(s, ls, le, ms, me)) break;
+        if (le >= s->end) break;
+        pos = le + 1;
+    }
+}
+
+static void search_multiline(search_t *s) {
+    const ac_grep_t *grep = s->grep;
+    if (grep->literal_len > 0 && !find_literal(grep, s->data, s->end)) {
+        return;
+    }
+
+    const char *pos = s->data;
+    while (pos < s->end) {
+        int rc = pcre2_match(grep->code, (PCRE2_SPTR)s->data, (size_t)(s->end - s->data),
+                             (size_t)(pos - s->data), 0, s->md, NULL);
+        if (rc < 0) break;
+        PCRE2_SIZE *ov = pcre2_get_ovector_pointer(s->md);
+        const char *mstart = s->data + ov[0];
+        const char *mend = s->data + ov[1];
+
+        /* Report every line the match touches */
+        const char *ls = line_start(pos, mstart);
+        const char *le = line_end(mend > mstart ? mend - 1 : mstart, s->end);
+        if (report(s, ls, le, (size_t)(mstart - ls), (size_t)(mend - ls))) break;
+        if (le >= s->end) break;
+        pos = le + 1;
+    }
+}
+
+static int search(const ac_grep_t *grep, const char *data, size_t len, const char *path,
+                  ac_grep_match_fn on_match, void *user_data) {
+    search_t s = {
+        .grep = grep,
+        .data = data,
+        .end = data + len,
+        .path = path,
+        .on_match = on_match,
+        .user_data = user_data,
+        .lines = { data, 1 },
+    };
+    if (len == 0) return 0;
+
+    if (grep->code) {
+        s.md = pcre2_match_data_create_from_pattern(grep->code, NULL);
+        if (!s.md) return AC_GREP_ERROR;
+    }
+    if (grep->multiline && grep->code) {
+        search_multiline(&s);
+    } else {
+        search_lines(&s);
+    }
+    if (s.md) pcre2_match_data_free(s.md);
+    return s.count;
+}
+
+int ac_grep_is_binary(const char *data, size_t len) {
+    return memchr(data, '\0', len < GREP_BINARY_PROBE ? len : GREP_BINARY_PROBE) != NULL;
+}
+
+int ac_grep_buffer(
+    const ac_grep_t *grep,
+    const char *data,
+    size_t len,
+    ac_grep_match_fn on_match,
+    void *user_data
+) {
+    if (!grep || (!data && len > 0)) return AC_GREP_ERROR;
+    return search(grep, data, len, NULL, on_match, user_data);
+}
+
+/* Read a whole file into memory */
+static char *read_all(int fd, size_t size, size_t *out_len) {
+    char *buf = malloc(size > 0 ? size : 1);
+    if (!buf) return NULL;
+    size_t got = 0;
+    while (got < size) {
+        long n = (long)read(fd, buf + got, (unsigned int)(size - got));
+        if (n < 0) {
+            free(buf);
+            return NULL;
+        }
+        if (n == 0) break;
+        got += (size_t)n;
+    }
+    *out_len = got;
+    return buf;
+}
+
+int ac_grep_file(
+    const ac_grep_t *grep,
+    const char *path,
+    ac_grep_match_fn on_match,
+    void *user_data
+) {
+    if (!grep || !path) return AC_GREP_ERROR;
+
+#if defined(_WIN32)
+    int fd = open(path, O_RDONLY | O_BINARY);
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+#endif
+    if (fd < 0) return AC_GREP_ERROR;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return AC_GREP_ERROR;
+    }
+    size_t size = (size_t)st.st_size;
+    if (grep->max_filesize && size > grep->max_filesize) {
+        close(fd);
+        return AC_GREP_SKIPPED;
+    }
+    if (size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    const char *data = NULL;
+    char *owned = NULL;
+    size_t len = 0;
+#if !defined(_WIN32)
+    void *map = MAP_FAILED;
+    if (size >= GREP_MMAP_MIN) {
+        map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+#if defined(MADV_SEQUENTIAL)
+            madvise(map, size, MADV_SEQUENTIAL);
+#endif
+            data = map;
+            len = size;
+        }
+    }
+#endif
+    if (!data) {
+        owned = read_all(fd, size, &len);
+        data = owned;
+    }
+    close(fd);
+    if (!data) return AC_GREP_ERROR;
+
+    int result = ac_grep_is_binary(data, len)
+        ? AC_GREP_SKIPPED
+        : search(grep, data, len, path, on_match, user_data);
+
+#if !defined(_WIN32)
+    if (map != MAP_FAILED) munmap(map, size);
+#endif
+    free(owned);
+    return result;
+}
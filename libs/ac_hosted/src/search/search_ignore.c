@@ -0,0 +1,320 @@
+/**
+ * @file search_ignore.c
+ * @brief Glob matching and gitignore rule sets
+ *
+ * Each rule is compiled once: literal names, "*.ext" suffixes and
+ * "name*" prefixes (most of a typical .gitignore) are compared
+ * directly, the rest go through a backtracking glob matcher.
+ * Rules are tried last-to-first so the last matching rule decides, as
+ * in git, and rule sets from deeper directories come first.
+ */
+
+#include "search_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * Glob Matching
+ *============================================================================*/
+
+/* Match a "[...]" class at p against c; *end receives the byte after it */
+static int match_class(const char *p, const char *pe, unsigned char c, const char **end) {
+    const char *q = p + 1;
+    int negate = 0;
+    int matched = 0;
+
+    if (q < pe && (*q == '!' || *q == '^')) {
+        negate = 1;
+        q++;
+    }
+    const char *first = q;
+    while (q < pe && (*q != ']' || q == first)) {
+        unsigned char lo = (unsigned char)*q;
+        if (lo == '\\' && q + 1 < pe) lo = (unsigned char)*++q;
+        q++;
+        if (q + 1 < pe && *q == '-' && q[1] != ']') {
+            unsigned char hi = (unsigned char)q[1];
+            if (hi == '\\' && q + 2 < pe) {
+                hi = (unsigned char)q[2];
+                q++;
+            }
+            q += 2;
+            if (c >= lo && c <= hi) matched = 1;
+        } else if (c == lo) {
+            matched = 1;
+        }
+    }
+    if (q >= pe) return -1;             /* Unterminated: '[' is literal */
+    *end = q + 1;
+    return matched != negate;
+}
+
+typedef struct {
+    const char *start;                  /* Pattern start, for "**" component checks */
+    const char *pe;
+    const char *se;
+} glob_ctx_t;
+
+static int match_here(const glob_ctx_t *ctx, const char *p, const char *s) {
+    const char *pe = ctx->pe;
+    const char *se = ctx->se;
+
+    while (p < pe) {
+        if (*p == '*') {
+            /* "**" as a whole component spans directories */
+            if (p + 1 < pe && p[1] == '*' && (p == ctx->start || p[-1] == '/') &&
+                (p + 2 == pe || p[2] == '/')) {
+                p += 2;
+                if (p == pe) return 1;
+                p++;                    /* The '/' after it */
+                for (;;) {
+                    if (match_here(ctx, p, s)) return 1;
+                    const char *slash = memchr(s, '/', (size_t)(se - s));
+                    if (!slash) return 0;
+                    s = slash + 1;
+                }
+            }
+
+            while (p < pe && *p == '*') p++;
+            if (p == pe) return memchr(s, '/', (size_t)(se - s)) == NULL;
+            for (;; s++) {
+                if (match_here(ctx, p, s)) return 1;
+                if (s == se || *s == '/') return 0;
+            }
+        }
+
+        if (s == se) return 0;
+
+        if (*p == '?') {
+            if (*s == '/') return 0;
+            p++;
+            s++;
+            continue;
+        }
+        if (*p == '[') {
+            const char *end = NULL;
+            int r = *s == '/' ? 0 : match_class(p, pe, (unsigned char)*s, &end);
+            if (r == 0) return 0;
+            if (r > 0) {
+                p = end;
+                s++;
+                continue;
+            }
+            /* Unterminated class: fall through and compare '[' literally */
+        }
+        if (*p == '\\' && p + 1 < pe) p++;
+        if (*p != *s) return 0;
+        p++;
+        s++;
+    }
+    return s == se;
+}
+
+int ac_glob_match_raw(const char *pattern, size_t pattern_len, const char *str, size_t len) {
+    glob_ctx_t ctx = { pattern, pattern + pattern_len, str + len };
+    return match_here(&ctx, pattern, str);
+}
+
+static int is_special(char c) {
+    return c == '*' || c == '?' || c == '[' || c == '\\';
+}
+
+static int has_special(const char *p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (is_special(p[i])) return 1;
+    }
+    return 0;
+}
+
+int ac_glob_compile(ac_glob_t *glob, const char *pattern, size_t len) {
+    memset(glob, 0, sizeof(*glob));
+    glob->pattern = malloc(len + 1);
+    if (!glob->pattern) return -1;
+    memcpy(glob->pattern, pattern, len);
+    glob->pattern[len] = '\0';
+    glob->len = len;
+    glob->kind = AC_GLOB_GENERAL;
+
+    const char *p = glob->pattern;
+    if (!has_special(p, len)) {
+        glob->kind = AC_GLOB_LITERAL;
+        glob->literal = p;
+        glob->literal_len = len;
+    } else if (len >= 2 && p[0] == '*' && p[1] != '*' && !has_special(p + 1, len - 1)) {
+        glob->kind = AC_GLOB_SUFFIX;
+        glob->literal = p + 1;
+        glob->literal_len = len - 1;
+    } else if (len >= 2 && p[len - 1] == '*' && p[len - 2] != '*' && !has_special(p, len - 1)) {
+        glob->kind = AC_GLOB_PREFIX;
+        glob->literal = p;
+        glob->literal_len = len - 1;
+    }
+    return 0;
+}
+
+int ac_glob_match(const ac_glob_t *glob, const char *str, size_t len) {
+    size_t n = glob->literal_len;
+    switch (glob->kind) {
+    case AC_GLOB_LITERAL:
+        return len == n && memcmp(str, glob->literal, n) == 0;
+    case AC_GLOB_SUFFIX:
+        /* The '*' cannot cross a '/' */
+        return len >= n && memcmp(str + len - n, glob->literal, n) == 0 &&
+               memchr(str, '/', len - n) == NULL;
+    case AC_GLOB_PREFIX:
+        return len >= n && memcmp(str, glob->literal, n) == 0 &&
+               memchr(str + n, '/', len - n) == NULL;
+    default:
+        return ac_glob_match_raw(glob->pattern, glob->len, str, len);
+    }
+}
+
+void ac_glob_free(ac_glob_t *glob) {
+    free(glob->pattern);
+    glob->pattern = NULL;
+}
+
+/*============================================================================
+ * Ignore Rules
+ *============================================================================*/
+
+/* Parse one gitignore line into a rule; 0 if it holds none */
+static int parse_rule(const char *line, size_t len, ac_ignore_rule_t *rule) {
+    memset(rule, 0, sizeof(*rule));
+
+    if (len > 0 && line[len - 1] == '\r') len--;
+    /* Trailing spaces are ignored unless escaped */
+    while (len > 0 && line[len - 1] == ' ' && !(len > 1 && line[len - 2] == '\\')) len--;
+    if (len == 0 || line[0] == '#') return 0;
+
+    if (line[0] == '!') {
+        rule->negate = 1;
+        line++;
+        len--;
+    } else if (line[0] == '\\' && len > 1 && (line[1] == '#' || line[1] == '!')) {
+        line++;
+        len--;
+    }
+    if (len > 0 && line[len - 1] == '/') {
+        rule->dir_only = 1;
+        len--;
+    }
+    if (len == 0) return 0;
+
+    /* A slash anywhere but the end anchors the pattern to its directory */
+    if (memchr(line, '/', len)) {
+        rule->anchored = 1;
+        if (line[0] == '/') {
+            line++;
+            len--;
+        }
+    }
+    if (len == 0) return 0;
+    return ac_glob_compile(&rule->glob, line, len) == 0;
+}
+
+size_t ac_ignore_add_rules(ac_ignore_t *ignore, const char *text, size_t len) {
+    size_t added = 0;
+    const char *end = text + len;
+    const char *line = text;
+
+    while (line < end) {
+        const char *nl = memchr(line, '\n', (size_t)(end - line));
+        size_t line_len = nl ? (size_t)(nl - line) : (size_t)(end - line);
+
+        ac_ignore_rule_t rule;
+        if (parse_rule(line, line_len, &rule)) {
+            if (ignore->count == ignore->capacity) {
+                size_t cap = ignore->capacity ? ignore->capacity * 2 : 16;
+                ac_ignore_rule_t *rules = realloc(ignore->rules, cap * sizeof(*rules));
+                if (!rules) {
+                    ac_glob_free(&rule.glob);
+                    break;
+                }
+                ignore->rules = rules;
+                ignore->capacity = cap;
+            }
+            ignore->rules[ignore->count++] = rule;
+            added++;
+        }
+        if (!nl) break;
+        line = nl + 1;
+    }
+    return added;
+}
+
+size_t ac_ignore_add_file(ac_ignore_t *ignore, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+
+    size_t added = 0;
+    size_t cap = 4096, len = 0;
+    char *buf = malloc(cap);
+    while (buf) {
+        size_t n = fread(buf + len, 1, cap - len, f);
+        len += n;
+        if (len < cap) break;
+        char *grown = realloc(buf, cap * 2);
+        if (!grown) break;
+        buf = grown;
+        cap *= 2;
+    }
+    fclose(f);
+    if (buf) {
+        added = ac_ignore_add_rules(ignore, buf, len);
+        free(buf);
+    }
+    return added;
+}
+
+/* Decision of one rule set: 1 ignored, 0 re-included, -1 no rule matched */
+static int match_set(const ac_ignore_t *set, const char *rel, size_t rel_len,
+                     const char *name, int is_dir) {
+    if (set->count == 0) return -1;
+
+    /* Path relative to the directory holding the rules */
+    char buf[4096];
+    const char *path = rel;
+    size_t path_len = rel_len;
+    if (set->prefix && set->prefix[0]) {
+        int n = snprintf(buf, sizeof(buf), "%s/%.*s", set->prefix, (int)rel_len, rel);
+        if (n < 0 || (size_t)n >= sizeof(buf)) return -1;
+        path = buf;
+        path_len = (size_t)n;
+    } else if (set->strip > 0) {
+        if (rel_len <= set->strip) return -1;
+        path = rel + set->strip;
+        path_len = rel_len - set->strip;
+    }
+    size_t name_len = strlen(name);
+
+    for (size_t i = set->count; i-- > 0;) {
+        const ac_ignore_rule_t *rule = &set->rules[i];
+        if (rule->dir_only && !is_dir) continue;
+        int hit = rule->anchored ? ac_glob_match(&rule->glob, path, path_len)
+                                 : ac_glob_match(&rule->glob, name, name_len);
+        if (hit) return !rule->negate;
+    }
+    return -1;
+}
+
+int ac_ignore_match(const ac_ignore_t *ignore, const char *rel_path, size_t rel_len,
+                    const char *name, int is_dir) {
+    for (const ac_ignore_t *set = ignore; set; set = set->parent) {
+        int r = match_set(set, rel_path, rel_len, name, is_dir);
+        if (r >= 0) return r;
+    }
+    return 0;
+}
+
+void ac_ignore_free(ac_ignore_t *ignore) {
+    if (!ignore) return;
+    for (size_t i = 0; i < ignore->count; i++) {
+        ac_glob_free(&ignore->rules[i].glob);
+    }
+    free(ignore->rules);
+    free(ignore->prefix);
+    free(ignore);
+}
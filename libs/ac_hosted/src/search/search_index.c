@@ -0,0 +1,1130 @@
+/**
+ * @file search_index.c
+ * @brief Persistent trigram index with inotify-driven updates
+ *
+ * File layout (native byte order, guarded by the magic):
+ *
+ *   header | root path | file table | trigram table | path strings | postings
+ *
+ * The file table is in walk order. The trigram table is sorted and
+ * points at posting lists of delta-encoded varint file ids; a query
+ * intersects the lists of its trigrams, smallest first.
+ *
+ * Writing walks the tree and stats every file. Files whose size and
+ * mtime match the previous index (and that inotify did not report)
+ * keep their postings, renumbered; only the rest are read. The new
+ * file replaces the old one with a rename.
+ *
+ * Between writes, edited files are kept in a dirty set: they are left
+ * out of the index's answers and always returned as candidates.
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include <arc/search_index.h>
+#include <arc/grep.h>
+#include <arc/log.h>
+#include <arc/walk.h>
+#include "search_internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <direct.h>
+#include <io.h>
+#include <process.h>
+#define mkdir(path, mode) _mkdir(path)
+#define realpath(name, resolved) _fullpath((resolved), (name), 4096)
+#define getpid _getpid
+#endif
+
+#define INDEX_MAGIC "ARCTRI\0\1"
+#define INDEX_VERSION 1
+#define INDEX_MAX_FILE_SIZE (4u << 20)
+#define INDEX_MIN_DIRTY 64              /* Dirty files tolerated before a rewrite... */
+#define INDEX_DIRTY_SHARE 16            /* ...or 1/16 of the files, if more */
+#define INDEX_PATH_MAX 4096
+#define TRIGRAM_SPACE (1u << 24)
+#define NO_ID UINT32_MAX
+
+enum {
+    FILE_BINARY = 1,                    /* Never a candidate (grep skips it) */
+    FILE_UNINDEXED = 2,                 /* Too large to index: always a candidate */
+};
+
+/*============================================================================
+ * On-Disk Format
+ *============================================================================*/
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t file_count;
+    uint32_t trigram_count;
+    uint32_t root_len;
+    uint64_t root_off;
+    uint64_t files_off;
+    uint64_t trigrams_off;
+    uint64_t postings_off;
+    uint64_t total_size;
+} index_header_t;
+
+typedef struct {
+    uint64_t path_off;
+    uint32_t path_len;
+    uint32_t flags;
+    uint64_t size;
+    int64_t mtime_ns;
+} index_file_t;
+
+typedef struct {
+    uint32_t trigram;
+    uint32_t count;
+    uint64_t offset;
+} index_trigram_t;
+
+/*============================================================================
+ * Path Tables
+ *============================================================================*/
+
+static uint64_t hash_bytes(const char *s, size_t len) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/* Path -> file id over the mapped strings; sized once */
+typedef struct {
+    const char *key;
+    uint32_t len;
+    uint32_t id;
+} id_slot_t;
+
+typedef struct {
+    id_slot_t *slots;
+    size_t mask;
+} id_map_t;
+
+static int id_map_init(id_map_t *m, size_t count) {
+    size_t cap = 16;
+    while (cap < count * 2) cap <<= 1;
+    m->slots = calloc(cap, sizeof(*m->slots));
+    m->mask = cap - 1;
+    return m->slots ? 0 : -1;
+}
+
+static void id_map_put(id_map_t *m, const char *key, uint32_t len, uint32_t id) {
+    size_t i = (size_t)hash_bytes(key, len) & m->mask;
+    while (m->slots[i].key) i = (i + 1) & m->mask;
+    m->slots[i].key = key;
+    m->slots[i].len = len;
+    m->slots[i].id = id;
+}
+
+static uint32_t id_map_get(const id_map_t *m, const char *key, size_t len) {
+    if (!m->slots) return NO_ID;
+    size_t i = (size_t)hash_bytes(key, len) & m->mask;
+    while (m->slots[i].key) {
+        if (m->slots[i].len == len && memcmp(m->slots[i].key, key, len) == 0) return m->slots[i].id;
+        i = (i + 1) & m->mask;
+    }
+    return NO_ID;
+}
+
+/* Growable set of owned relative paths */
+typedef struct {
+    char **slots;
+    size_t cap;
+    size_t count;
+} path_set_t;
+
+static int path_set_has(const path_set_t *s, const char *path, size_t len) {
+    if (s->count == 0) return 0;
+    size_t i = (size_t)hash_bytes(path, len) & (s->cap - 1);
+    while (s->slots[i]) {
+        if (strlen(s->slots[i]) == len && memcmp(s->slots[i], path, len) == 0) return 1;
+        i = (i + 1) & (s->cap - 1);
+    }
+    return 0;
+}
+
+static int path_set_add(path_set_t *s, const char *path) {
+    size_t len = strlen(path);
+    if (path_set_has(s, path, len)) return 0;
+    if ((s->count + 1) * 2 > s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 64;
+        char **slots = calloc(cap, sizeof(char *));
+        if (!slots) return -1;
+        for (size_t i = 0; i < s->cap; i++) {
+            if (!s->slots[i]) continue;
+            size_t j = (size_t)hash_bytes(s->slots[i], strlen(s->slots[i])) & (cap - 1);
+            while (slots[j]) j = (j + 1) & (cap - 1);
+            slots[j] = s->slots[i];
+        }
+        free(s->slots);
+        s->slots = slots;
+        s->cap = cap;
+    }
+    char *copy = strdup(path);
+    if (!copy) return -1;
+    size_t i = (size_t)hash_bytes(path, len) & (s->cap - 1);
+    while (s->slots[i]) i = (i + 1) & (s->cap - 1);
+    s->slots[i] = copy;
+    s->count++;
+    return 0;
+}
+
+static void path_set_clear(path_set_t *s) {
+    for (size_t i = 0; i < s->cap; i++) free(s->slots[i]);
+    free(s->slots);
+    memset(s, 0, sizeof(*s));
+}
+
+/*============================================================================
+ * Index Handle
+ *============================================================================*/
+
+struct ac_search_index {
+    char *root;
+    char *index_path;
+    ac_search_index_options_t opts;
+
+    /* Mapped index file */
+    unsigned char *map;
+    size_t map_size;
+    const index_header_t *hdr;
+    const index_file_t *files;
+    const index_trigram_t *trigrams;
+    id_map_t ids;
+    uint32_t *unindexed;                /* Ids of FILE_UNINDEXED files */
+    size_t unindexed_count;
+
+    path_set_t dirty;                   /* Changed since the write */
+    int need_check;                     /* Walk the tree before answering */
+    int stale;
+    size_t writes;
+    size_t reused;
+
+    ac_tree_watch_t watch;
+};
+
+static size_t dirty_limit(const ac_search_index_t *idx) {
+    size_t files = idx->hdr ? idx->hdr->file_count : 0;
+    size_t share = files / INDEX_DIRTY_SHARE;
+    return share > INDEX_MIN_DIRTY ? share : INDEX_MIN_DIRTY;
+}
+
+/*============================================================================
+ * Mapping
+ *============================================================================*/
+
+static void unmap_index(ac_search_index_t *idx) {
+    if (idx->map) {
+#if !defined(_WIN32)
+        munmap(idx->map, idx->map_size);
+#else
+        free(idx->map);
+#endif
+    }
+    free(idx->ids.slots);
+    free(idx->unindexed);
+    idx->map = NULL;
+    idx->map_size = 0;
+    idx->hdr = NULL;
+    idx->files = NULL;
+    idx->trigrams = NULL;
+    idx->ids.slots = NULL;
+    idx->unindexed = NULL;
+    idx->unindexed_count = 0;
+}
+
+static int region_ok(uint64_t off, uint64_t len, size_t size) {
+    return off <= size && len <= size - off;
+}
+
+/* Map and validate the index file; -1 if missing or unusable */
+static int map_index(ac_search_index_t *idx) {
+    unmap_index(idx);
+
+    int fd = open(idx->index_path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(index_header_t)) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+
+#if !defined(_WIN32)
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+#else
+    unsigned char *map = malloc(size);
+    size_t got = 0;
+    while (map && got < size) {
+        int n = _read(fd, map + got, (unsigned)(size - got));
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    _close(fd);
+    if (!map || got < size) {
+        free(map);
+        return -1;
+    }
+#endif
+    idx->map = map;
+    idx->map_size = size;
+
+    const index_header_t *h = (const index_header_t *)idx->map;
+    size_t root_len = strlen(idx->root);
+    if (memcmp(h->magic, INDEX_MAGIC, 8) != 0 || h->version != INDEX_VERSION ||
+        h->total_size != size || h->root_len != root_len ||
+        !region_ok(h->root_off, h->root_len, size) ||
+        memcmp(idx->map + h->root_off, idx->root, root_len) != 0 ||
+        h->files_off % 8 != 0 || h->trigrams_off % 8 != 0 ||
+        !region_ok(h->files_off, (uint64_t)h->file_count * sizeof(index_file_t), size) ||
+        !region_ok(h->trigrams_off, (uint64_t)h->trigram_count * sizeof(index_trigram_t), size) ||
+        h->postings_off > size) {
+        unmap_index(idx);
+        return -1;
+    }
+    idx->hdr = h;
+    idx->files = (const index_file_t *)(idx->map + h->files_off);
+    idx->trigrams = (const index_trigram_t *)(idx->map + h->trigrams_off);
+
+    if (id_map_init(&idx->ids, h->file_count) != 0) {
+        unmap_index(idx);
+        return -1;
+    }
+    size_t unindexed = 0;
+    for (uint32_t i = 0; i < h->file_count; i++) {
+        const index_file_t *f = &idx->files[i];
+        if (!region_ok(f->path_off, f->path_len, size)) {
+            unmap_index(idx);
+            return -1;
+        }
+        id_map_put(&idx->ids, (const char *)idx->map + f->path_off, f->path_len, i);
+        if (f->flags & FILE_UNINDEXED) unindexed++;
+    }
+    if (unindexed > 0) {
+        idx->unindexed = malloc(unindexed * sizeof(uint32_t));
+        if (!idx->unindexed) {
+            unmap_index(idx);
+            return -1;
+        }
+        for (uint32_t i = 0; i < h->file_count; i++) {
+            if (idx->files[i].flags & FILE_UNINDEXED) idx->unindexed[idx->unindexed_count++] = i;
+        }
+    }
+    return 0;
+}
+
+/* Decode one posting list; returns the ids read (fewer if corrupt) */
+static size_t decode_postings(const ac_search_index_t *idx, const index_trigram_t *t, uint32_t *out) {
+    const unsigned char *p = idx->map + t->offset;
+    const unsigned char *end = idx->map + idx->map_size;
+    if (t->offset < idx->hdr->postings_off || t->offset > idx->map_size) return 0;
+
+    uint32_t id = 0;
+    size_t n = 0;
+    for (uint32_t k = 0; k < t->count; k++) {
+        uint32_t delta = 0;
+        int shift = 0;
+        unsigned char b;
+        do {
+            if (p >= end || shift > 28) return n;
+            b = *p++;
+            delta |= (uint32_t)(b & 0x7f) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        id += delta;
+        if (id >= idx->hdr->file_count) return n;
+        out[n++] = id;
+    }
+    return n;
+}
+
+static const index_trigram_t *find_trigram(const ac_search_index_t *idx, uint32_t trigram) {
+    size_t lo = 0, hi = idx->hdr->trigram_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        uint32_t t = idx->trigrams[mid].trigram;
+        if (t == trigram) return &idx->trigrams[mid];
+        if (t < trigram) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+
+/*============================================================================
+ * Watching
+ *============================================================================*/
+
+static int on_watch_event(void *user_data, const char *rel, size_t len, unsigned int flags) {
+    ac_search_index_t *idx = (ac_search_index_t *)user_data;
+    if (id_map_get(&idx->ids, rel, len) != NO_ID) {
+        return path_set_add(&idx->dirty, rel) != 0;
+    }
+    /* Possibly a new file: the walk applies the ignore rules */
+    return (flags & AC_TREE_CREATED) != 0;
+}
+
+static void drain_events(ac_search_index_t *idx) {
+    if (ac_tree_watch_drain(&idx->watch, on_watch_event, idx)) idx->need_check = 1;
+}
+
+/*============================================================================
+ * Tree Listing
+ *============================================================================*/
+
+typedef struct {
+    char *rel;
+    uint64_t size;
+    int64_t mtime_ns;
+} tree_file_t;
+
+typedef struct {
+    ac_search_index_t *idx;
+    tree_file_t *files;
+    size_t count;
+    size_t cap;
+    int failed;
+} tree_t;
+
+static void tree_free(tree_t *t) {
+    for (size_t i = 0; i < t->count; i++) free(t->files[i].rel);
+    free(t->files);
+    t->files = NULL;
+    t->count = t->cap = 0;
+}
+
+static int collect_entry(const ac_walk_entry_t *entry, void *user_data) {
+    tree_t *t = (tree_t *)user_data;
+
+    if (entry->type == AC_WALK_DIR) {
+        ac_tree_watch_dir(&t->idx->watch, entry->path, entry->rel_path);
+        return AC_WALK_CONTINUE;
+    }
+    if (entry->type != AC_WALK_FILE) return AC_WALK_CONTINUE;
+
+    struct stat st;
+    if (stat(entry->path, &st) != 0) return AC_WALK_CONTINUE;
+    if (t->count == t->cap) {
+        size_t cap = t->cap ? t->cap * 2 : 1024;
+        tree_file_t *files = realloc(t->files, cap * sizeof(*files));
+        if (!files) {
+            t->failed = 1;
+            return AC_WALK_STOP;
+        }
+        t->files = files;
+        t->cap = cap;
+    }
+    tree_file_t *f = &t->files[t->count];
+    f->rel = strdup(entry->rel_path);
+    if (!f->rel) {
+        t->failed = 1;
+        return AC_WALK_STOP;
+    }
+    f->size = (uint64_t)st.st_size;
+    f->mtime_ns = ac_stat_mtime_ns(&st);
+    t->count++;
+    return AC_WALK_CONTINUE;
+}
+
+static arc_err_t collect_tree(ac_search_index_t *idx, tree_t *t) {
+    memset(t, 0, sizeof(*t));
+    t->idx = idx;
+    ac_tree_watch_root(&idx->watch, idx->root);
+
+    ac_walk_options_t walk = {
+        .ignore_globs = idx->opts.ignore_globs,
+        .ignore_globs_count = idx->opts.ignore_globs_count,
+    };
+    arc_err_t err = ac_walk(idx->root, &walk, collect_entry, t);
+    if (err == ARC_OK && t->failed) err = ARC_ERR_NO_MEMORY;
+    if (err != ARC_OK) tree_free(t);
+    return err;
+}
+
+/*============================================================================
+ * Building
+ *============================================================================*/
+
+typedef struct {
+    uint32_t key;                       /* trigram + 1; 0 = empty slot */
+    uint32_t count;
+    uint32_t cap;
+    uint32_t *ids;
+} build_list_t;
+
+typedef struct {
+    build_list_t *slots;
+    size_t cap;
+    size_t used;
+    uint64_t *seen;                     /* Trigrams of the current file */
+    uint32_t *file_trigrams;
+    size_t file_trigrams_cap;
+    char *buf;                          /* File contents */
+    size_t buf_cap;
+} builder_t;
+
+static unsigned char fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + 32) : c;
+}
+
+static int builder_init(builder_t *b) {
+    memset(b, 0, sizeof(*b));
+    b->cap = 1 << 16;
+    b->slots = calloc(b->cap, sizeof(*b->slots));
+    b->seen = calloc(TRIGRAM_SPACE / 64, sizeof(uint64_t));
+    return b->slots && b->seen ? 0 : -1;
+}
+
+static void builder_free(builder_t *b) {
+    for (size_t i = 0; b->slots && i < b->cap; i++) free(b->slots[i].ids);
+    free(b->slots);
+    free(b->seen);
+    free(b->file_trigrams);
+    free(b->buf);
+}
+
+static build_list_t *builder_list(builder_t *b, uint32_t trigram) {
+    if ((b->used + 1) * 2 > b->cap) {
+        size_t cap = b->cap * 2;
+        build_list_t *slots = calloc(cap, sizeof(*slots));
+        if (!slots) return NULL;
+        for (size_t i = 0; i < b->cap; i++) {
+            if (!b->slots[i].key) continue;
+            size_t j = ((b->slots[i].key - 1) * 2654435761u) & (cap - 1);
+            while (slots[j].key) j = (j + 1) & (cap - 1);
+            slots[j] = b->slots[i];
+        }
+        free(b->slots);
+        b->slots = slots;
+        b->cap = cap;
+    }
+    size_t i = (trigram * 2654435761u) & (b->cap - 1);
+    while (b->slots[i].key && b->slots[i].key != trigram + 1) i = (i + 1) & (b->cap - 1);
+    if (!b->slots[i].key) {
+        b->slots[i].key = trigram + 1;
+        b->used++;
+    }
+    return &b->slots[i];
+}
+
+static int builder_add(builder_t *b, uint32_t trigram, uint32_t id) {
+    build_list_t *l = builder_list(b, trigram);
+    if (!l) return -1;
+    if (l->count == l->cap) {
+        uint32_t cap = l->cap ? l->cap * 2 : 4;
+        uint32_t *ids = realloc(l->ids, cap * sizeof(uint32_t));
+        if (!ids) return -1;
+        l->ids = ids;
+        l->cap = cap;
+    }
+    l->ids[l->count++] = id;
+    return 0;
+}
+
+/* Add the distinct trigrams of a buffer as file id */
+static int builder_add_text(builder_t *b, const unsigned char *data, size_t len, uint32_t id) {
+    size_t n = 0;
+    uint32_t t = 0;
+    int rc = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        t = ((t << 8) | fold(data[i])) & (TRIGRAM_SPACE - 1);
+        if (i < 2) continue;
+        uint64_t bit = (uint64_t)1 << (t % 64);
+        if (b->seen[t / 64] & bit) continue;
+        b->seen[t / 64] |= bit;
+        if (n == b->file_trigrams_cap) {
+            size_t cap = b->file_trigrams_cap ? b->file_trigrams_cap * 2 : 4096;
+            uint32_t *grown = realloc(b->file_trigrams, cap * sizeof(uint32_t));
+            if (!grown) {
+                rc = -1;
+                break;
+            }
+            b->file_trigrams = grown;
+            b->file_trigrams_cap = cap;
+        }
+        b->file_trigrams[n++] = t;
+    }
+    for (size_t i = 0; i < n; i++) {
+        t = b->file_trigrams[i];
+        b->seen[t / 64] &= ~((uint64_t)1 << (t % 64));
+        if (rc == 0 && builder_add(b, t, id) != 0) rc = -1;
+    }
+    return rc;
+}
+
+/* Read and index one file; returns its flags or -1 on memory failure */
+static int index_file(ac_search_index_t *idx, builder_t *b, const tree_file_t *f, uint32_t id) {
+    size_t max = idx->opts.max_file_size ? idx->opts.max_file_size : INDEX_MAX_FILE_SIZE;
+    if (f->size > max) return FILE_UNINDEXED;
+
+    char path[INDEX_PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/%s", idx->root, f->rel) >= (int)sizeof(path)) {
+        return FILE_UNINDEXED;
+    }
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return FILE_UNINDEXED;     /* Vanished or unreadable: let grep decide */
+
+    size_t want = (size_t)f->size + 1;  /* One extra byte detects growth */
+    if (want > b->buf_cap) {
+        size_t cap = want > 65536 ? want : 65536;
+        char *buf = realloc(b->buf, cap);
+        if (!buf) {
+            fclose(fp);
+            return -1;
+        }
+        b->buf = buf;
+        b->buf_cap = cap;
+    }
+    size_t len = fread(b->buf, 1, want, fp);
+    fclose(fp);
+    if (len == want) return FILE_UNINDEXED;     /* Grew since the stat */
+
+    if (ac_grep_is_binary(b->buf, len)) return FILE_BINARY;
+    return builder_add_text(b, (const unsigned char *)b->buf, len, id) == 0 ? 0 : -1;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_lists(const void *a, const void *b) {
+    const build_list_t *x = *(const build_list_t *const *)a;
+    const build_list_t *y = *(const build_list_t *const *)b;
+    return (x->key > y->key) - (x->key < y->key);
+}
+
+static size_t put_varint(unsigned char *out, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (unsigned char)v;
+    return n;
+}
+
+static size_t align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+/* Write tree + postings to a temporary file and rename it over the index */
+static arc_err_t write_index(ac_search_index_t *idx, const tree_t *tree, const uint32_t *flags,
+                             builder_t *b) {
+    build_list_t **lists = malloc((b->used ? b->used : 1) * sizeof(*lists));
+    if (!lists) return ARC_ERR_NO_MEMORY;
+    size_t nlists = 0;
+    size_t postings_cap = 0;
+    for (size_t i = 0; i < b->cap; i++) {
+        if (!b->slots[i].key) continue;
+        lists[nlists++] = &b->slots[i];
+        postings_cap += (size_t)b->slots[i].count * 5;
+    }
+    qsort(lists, nlists, sizeof(*lists), compare_lists);
+
+    unsigned char *postings = malloc(postings_cap ? postings_cap : 1);
+    index_trigram_t *table = malloc((nlists ? nlists : 1) * sizeof(*table));
+    index_file_t *files = malloc((tree->count ? tree->count : 1) * sizeof(*files));
+    if (!postings || !table || !files) {
+        free(lists);
+        free(postings);
+        free(table);
+        free(files);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    size_t root_len = strlen(idx->root);
+    size_t strings_len = 0;
+    for (size_t i = 0; i < tree->count; i++) strings_len += strlen(tree->files[i].rel);
+
+    index_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, INDEX_MAGIC, 8);
+    hdr.version = INDEX_VERSION;
+    hdr.file_count = (uint32_t)tree->count;
+    hdr.trigram_count = (uint32_t)nlists;
+    hdr.root_len = (uint32_t)root_len;
+    hdr.root_off = sizeof(hdr);
+    hdr.files_off = align8(hdr.root_off + root_len);
+    hdr.trigrams_off = hdr.files_off + tree->count * sizeof(index_file_t);
+    uint64_t strings_off = hdr.trigrams_off + nlists * sizeof(index_trigram_t);
+    hdr.postings_off = strings_off + strings_len;
+
+    size_t plen = 0;
+    for (size_t i = 0; i < nlists; i++) {
+        build_list_t *l = lists[i];
+        qsort(l->ids, l->count, sizeof(uint32_t), compare_u32);
+        table[i].trigram = l->key - 1;
+        table[i].count = l->count;
+        table[i].offset = hdr.postings_off + plen;
+        uint32_t prev = 0;
+        for (uint32_t k = 0; k < l->count; k++) {
+            plen += put_varint(postings + plen, l->ids[k] - prev);
+            prev = l->ids[k];
+        }
+    }
+    hdr.total_size = hdr.postings_off + plen;
+
+    uint64_t off = strings_off;
+    for (size_t i = 0; i < tree->count; i++) {
+        size_t len = strlen(tree->files[i].rel);
+        files[i].path_off = off;
+        files[i].path_len = (uint32_t)len;
+        files[i].flags = flags[i];
+        files[i].size = tree->files[i].size;
+        files[i].mtime_ns = tree->files[i].mtime_ns;
+        off += len;
+    }
+
+    char tmp[INDEX_PATH_MAX + 32];
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", idx->index_path, (int)getpid());
+    FILE *fp = fopen(tmp, "wb");
+    int ok = fp != NULL;
+    if (ok) {
+        static const char pad[8] = {0};
+        ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+             fwrite(idx->root, 1, root_len, fp) == root_len &&
+             fwrite(pad, 1, hdr.files_off - hdr.root_off - root_len, fp) ==
+                 hdr.files_off - hdr.root_off - root_len &&
+             (tree->count == 0 || fwrite(files, sizeof(*files), tree->count, fp) == tree->count) &&
+             (nlists == 0 || fwrite(table, sizeof(*table), nlists, fp) == nlists);
+        for (size_t i = 0; ok && i < tree->count; i++) {
+            size_t len = files[i].path_len;
+            ok = fwrite(tree->files[i].rel, 1, len, fp) == len;
+        }
+        ok = ok && fwrite(postings, 1, plen, fp) == plen;
+        ok = (fclose(fp) == 0) && ok;
+    }
+    if (ok) {
+#if defined(_WIN32)
+        unmap_index(idx);               /* The target must not be open */
+        remove(idx->index_path);
+#endif
+        ok = rename(tmp, idx->index_path) == 0;
+    }
+    if (!ok) remove(tmp);
+
+    free(lists);
+    free(postings);
+    free(table);
+    free(files);
+    return ok ? ARC_OK : ARC_ERR_IO;
+}
+
+/* Write a new index for tree, reusing unchanged files' postings */
+static arc_err_t rebuild(ac_search_index_t *idx, const tree_t *tree) {
+    builder_t b;
+    uint32_t *flags = calloc(tree->count ? tree->count : 1, sizeof(uint32_t));
+    size_t old_count = idx->hdr ? idx->hdr->file_count : 0;
+    uint32_t *remap = malloc((old_count ? old_count : 1) * sizeof(uint32_t));
+    if (!flags || !remap || builder_init(&b) != 0) {
+        free(flags);
+        free(remap);
+        builder_free(&b);
+        return ARC_ERR_NO_MEMORY;
+    }
+    for (size_t i = 0; i < old_count; i++) remap[i] = NO_ID;
+
+    arc_err_t err = ARC_OK;
+    size_t reused = 0;
+    for (size_t i = 0; i < tree->count && err == ARC_OK; i++) {
+        const tree_file_t *f = &tree->files[i];
+        size_t len = strlen(f->rel);
+        uint32_t old = id_map_get(&idx->ids, f->rel, len);
+        if (old != NO_ID && idx->files[old].size == f->size &&
+            idx->files[old].mtime_ns == f->mtime_ns && !path_set_has(&idx->dirty, f->rel, len)) {
+            remap[old] = (uint32_t)i;
+            flags[i] = idx->files[old].flags;
+            reused++;
+            continue;
+        }
+        int r = index_file(idx, &b, f, (uint32_t)i);
+        if (r < 0) err = ARC_ERR_NO_MEMORY;
+        else flags[i] = (uint32_t)r;
+    }
+
+    /* Carry over the postings of unchanged files */
+    if (err == ARC_OK && reused > 0) {
+        uint32_t *ids = malloc(old_count * sizeof(uint32_t));
+        if (!ids) err = ARC_ERR_NO_MEMORY;
+        for (uint32_t t = 0; ids && err == ARC_OK && t < idx->hdr->trigram_count; t++) {
+            size_t n = decode_postings(idx, &idx->trigrams[t], ids);
+            for (size_t k = 0; k < n && err == ARC_OK; k++) {
+                uint32_t id = remap[ids[k]];
+                if (id != NO_ID && builder_add(&b, idx->trigrams[t].trigram, id) != 0) {
+                    err = ARC_ERR_NO_MEMORY;
+                }
+            }
+        }
+        free(ids);
+    }
+
+    if (err == ARC_OK) err = write_index(idx, tree, flags, &b);
+    builder_free(&b);
+    free(flags);
+    free(remap);
+
+    if (err == ARC_OK && map_index(idx) != 0) err = ARC_ERR_IO;
+    if (err != ARC_OK) {
+        AC_LOG_WARN("search index: cannot write %s", idx->index_path);
+        return err;
+    }
+    path_set_clear(&idx->dirty);
+    idx->writes++;
+    idx->reused = reused;
+    return ARC_OK;
+}
+
+/* Compare the tree with the index: note changes, rewrite if there are many */
+static arc_err_t check(ac_search_index_t *idx) {
+    tree_t tree;
+    arc_err_t err = collect_tree(idx, &tree);
+    if (err != ARC_OK) {
+        idx->stale = 1;
+        return err;
+    }
+    idx->need_check = 0;
+
+    if (!idx->hdr) {
+        err = rebuild(idx, &tree);
+        idx->stale = err != ARC_OK;
+        tree_free(&tree);
+        return err;
+    }
+
+    /* Watching, the set also holds edits that kept size and mtime */
+    if (idx->watch.fd < 0) path_set_clear(&idx->dirty);
+
+    size_t old_count = idx->hdr->file_count;
+    unsigned char *seen = calloc(old_count ? old_count : 1, 1);
+    if (!seen) {
+        tree_free(&tree);
+        idx->stale = 1;
+        return ARC_ERR_NO_MEMORY;
+    }
+    int failed = 0;
+    for (size_t i = 0; i < tree.count && !failed; i++) {
+        const tree_file_t *f = &tree.files[i];
+        uint32_t old = id_map_get(&idx->ids, f->rel, strlen(f->rel));
+        if (old != NO_ID) seen[old] = 1;
+        if (old == NO_ID || idx->files[old].size != f->size || idx->files[old].mtime_ns != f->mtime_ns) {
+            failed = path_set_add(&idx->dirty, f->rel) != 0;
+        }
+    }
+    char rel[INDEX_PATH_MAX];
+    for (size_t i = 0; i < old_count && !failed; i++) {
+        if (seen[i]) continue;
+        const index_file_t *f = &idx->files[i];
+        if (f->path_len >= sizeof(rel)) continue;
+        memcpy(rel, idx->map + f->path_off, f->path_len);
+        rel[f->path_len] = '\0';
+        failed = path_set_add(&idx->dirty, rel) != 0;
+    }
+    free(seen);
+
+    if (failed || idx->dirty.count > dirty_limit(idx)) err = rebuild(idx, &tree);
+    idx->stale = err != ARC_OK;
+    tree_free(&tree);
+    return err;
+}
+
+/*============================================================================
+ * Cache Location
+ *============================================================================*/
+
+static int make_dirs(const char *path) {
+    char buf[INDEX_PATH_MAX];
+    if (snprintf(buf, sizeof(buf), "%s", path) >= (int)sizeof(buf)) return -1;
+    for (char *p = buf + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        mkdir(buf, 0755);
+        *p = '/';
+    }
+    return (mkdir(buf, 0755) == 0 || errno == EEXIST) ? 0 : -1;
+}
+
+static int default_cache_dir(char *out, size_t size) {
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    if (xdg && xdg[0]) return snprintf(out, size, "%s/arc/index", xdg) < (int)size ? 0 : -1;
+#if defined(_WIN32)
+    const char *home = getenv("LOCALAPPDATA");
+    if (home && home[0]) return snprintf(out, size, "%s/arc/index", home) < (int)size ? 0 : -1;
+#else
+    const char *home = getenv("HOME");
+    if (home && home[0]) return snprintf(out, size, "%s/.cache/arc/index", home) < (int)size ? 0 : -1;
+#endif
+    return -1;
+}
+
+int ac_index_cache_dir(const char *configured, char *out, size_t size) {
+    if (configured) {
+        if (snprintf(out, size, "%s", configured) >= (int)size) return -1;
+    } else if (default_cache_dir(out, size) != 0) {
+        return -1;
+    }
+    return make_dirs(out);
+}
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+arc_err_t ac_search_index_open(
+    const char *root,
+    const ac_search_index_options_t *options,
+    ac_search_index_t **out
+) {
+    if (!root || !out) return ARC_ERR_INVALID_ARG;
+    *out = NULL;
+
+    char real[INDEX_PATH_MAX];
+    struct stat st;
+    if (!realpath(root, real) || stat(real, &st) != 0 || !S_ISDIR(st.st_mode)) return ARC_ERR_IO;
+
+    char dir[INDEX_PATH_MAX];
+    if (ac_index_cache_dir(options ? options->cache_dir : NULL, dir, sizeof(dir)) != 0) {
+        return ARC_ERR_IO;
+    }
+
+    ac_search_index_t *idx = calloc(1, sizeof(*idx));
+    if (!idx) return ARC_ERR_NO_MEMORY;
+    idx->watch.fd = -1;
+    if (options) idx->opts = *options;
+    idx->root = strdup(real);
+    char name[INDEX_PATH_MAX + 32];
+    snprintf(name, sizeof(name), "%s/%016llx.idx", dir,
+             (unsigned long long)hash_bytes(real, strlen(real)));
+    idx->index_path = strdup(name);
+    if (!idx->root || !idx->index_path) {
+        ac_search_index_close(idx);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    ac_tree_watch_init(&idx->watch, "search index", idx->opts.watch);
+
+    map_index(idx);                     /* Missing or unusable: built by check() */
+    arc_err_t err = check(idx);
+    if (err != ARC_OK) {
+        ac_search_index_close(idx);
+        return err;
+    }
+    *out = idx;
+    return ARC_OK;
+}
+
+arc_err_t ac_search_index_refresh(ac_search_index_t *index) {
+    if (!index) return ARC_ERR_INVALID_ARG;
+
+    if (index->watch.fd >= 0) {
+        drain_events(index);
+        /* drain_events() may have given up watching */
+        if (index->watch.fd >= 0 && !index->need_check && !index->stale) {
+            if (index->dirty.count <= dirty_limit(index)) return ARC_OK;
+            tree_t tree;
+            arc_err_t err = collect_tree(index, &tree);
+            if (err == ARC_OK) {
+                err = rebuild(index, &tree);
+                tree_free(&tree);
+            }
+            index->stale = err != ARC_OK;
+            return err;
+        }
+    }
+    return check(index);
+}
+
+/* Intersect sorted id lists in place; returns the new count */
+static size_t intersect(uint32_t *a, size_t na, const uint32_t *b, size_t nb) {
+    size_t i = 0, j = 0, n = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) i++;
+        else if (a[i] > b[j]) j++;
+        else {
+            a[n++] = a[i];
+            i++;
+            j++;
+        }
+    }
+    return n;
+}
+
+static int compare_trigram_ptrs(const void *a, const void *b) {
+    const index_trigram_t *x = *(const index_trigram_t *const *)a;
+    const index_trigram_t *y = *(const index_trigram_t *const *)b;
+    return (x->count > y->count) - (x->count < y->count);
+}
+
+static int compare_strings(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static int result_add(ac_search_index_result_t *r, size_t *cap, const char *path, size_t len) {
+    if (r->count == *cap) {
+        size_t grown = *cap ? *cap * 2 : 64;
+        char **paths = realloc(r->paths, grown * sizeof(char *));
+        if (!paths) return -1;
+        r->paths = paths;
+        *cap = grown;
+    }
+    char *copy = malloc(len + 1);
+    if (!copy) return -1;
+    memcpy(copy, path, len);
+    copy[len] = '\0';
+    r->paths[r->count++] = copy;
+    return 0;
+}
+
+int ac_search_index_query(
+    ac_search_index_t *index,
+    const char *literal,
+    size_t len,
+    ac_search_index_result_t *result
+) {
+    if (!result) return 0;
+    memset(result, 0, sizeof(*result));
+    if (!index || !literal || len < 3) return 0;
+    ac_search_index_refresh(index);
+    if (index->stale || !index->hdr) return 0;
+
+    /* Posting lists of the literal's trigrams, shortest first */
+    size_t ntri = len - 2;
+    const index_trigram_t **lists = malloc(ntri * sizeof(*lists));
+    if (!lists) return 0;
+    int missing = 0;
+    uint32_t t = 0;
+    size_t nlists = 0;
+    for (size_t i = 0; i < len && !missing; i++) {
+        t = ((t << 8) | fold((unsigned char)literal[i])) & (TRIGRAM_SPACE - 1);
+        if (i < 2) continue;
+        const index_trigram_t *e = find_trigram(index, t);
+        if (!e) missing = 1;
+        else lists[nlists++] = e;
+    }
+    qsort(lists, nlists, sizeof(*lists), compare_trigram_ptrs);
+
+    uint32_t *cand = NULL, *tmp = NULL;
+    size_t ncand = 0;
+    if (!missing && nlists > 0) {
+        cand = malloc(lists[0]->count * sizeof(uint32_t) + 1);
+        tmp = malloc(lists[0]->count * sizeof(uint32_t) + 1);
+        if (!cand || !tmp) {
+            free(cand);
+            free(tmp);
+            free(lists);
+            return 0;
+        }
+        ncand = decode_postings(index, lists[0], cand);
+        for (size_t i = 1; i < nlists && ncand > 0; i++) {
+            if (lists[i] == lists[i - 1]) continue;         /* Repeated trigram */
+            uint32_t *ids = malloc(lists[i]->count * sizeof(uint32_t) + 1);
+            if (!ids) {
+                ncand = 0;
+                missing = 1;
+                break;
+            }
+            size_t n = decode_postings(index, lists[i], ids);
+            ncand = intersect(cand, ncand, ids, n);
+            free(ids);
+        }
+    }
+    free(lists);
+    free(tmp);
+
+    /* Merge with the unindexed files, skipping dirty ones, in walk order */
+    size_t cap = 0;
+    int failed = 0;
+    size_t i = 0, j = 0;
+    while (!failed && (i < ncand || j < index->unindexed_count)) {
+        uint32_t id;
+        if (j >= index->unindexed_count || (i < ncand && cand[i] < index->unindexed[j])) {
+            id = cand[i++];
+        } else {
+            if (i < ncand && cand[i] == index->unindexed[j]) i++;
+            id = index->unindexed[j++];
+        }
+        const index_file_t *f = &index->files[id];
+        const char *path = (const char *)index->map + f->path_off;
+        if (f->flags & FILE_BINARY) continue;
+        if (path_set_has(&index->dirty, path, f->path_len)) continue;
+        failed = result_add(result, &cap, path, f->path_len) != 0;
+    }
+    free(cand);
+
+    /* Changed files are always candidates */
+    size_t first_dirty = result->count;
+    for (size_t k = 0; !failed && k < index->dirty.cap; k++) {
+        const char *path = index->dirty.slots[k];
+        if (!path) continue;
+        char full[INDEX_PATH_MAX];
+        struct stat st;
+        snprintf(full, sizeof(full), "%s/%s", index->root, path);
+        if (stat(full, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        failed = result_add(result, &cap, path, strlen(path)) != 0;
+    }
+    if (failed) {
+        ac_search_index_result_free(result);
+        return 0;
+    }
+    qsort(result->paths + first_dirty, result->count - first_dirty, sizeof(char *), compare_strings);
+    return 1;
+}
+
+void ac_search_index_result_free(ac_search_index_result_t *result) {
+    if (!result) return;
+    for (size_t i = 0; i < result->count; i++) free(result->paths[i]);
+    free(result->paths);
+    result->paths = NULL;
+    result->count = 0;
+}
+
+void ac_search_index_stats(const ac_search_index_t *index, ac_search_index_stats_t *stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!index) return;
+    if (index->hdr) {
+        stats->files = index->hdr->file_count;
+        stats->trigrams = index->hdr->trigram_count;
+        stats->index_bytes = index->map_size;
+    }
+    stats->dirty = index->dirty.count;
+    stats->writes = index->writes;
+    stats->reused = index->reused;
+    stats->watching = index->watch.fd >= 0;
+    stats->stale = index->stale;
+}
+
+const char *ac_search_index_root(const ac_search_index_t *index) {
+    return index ? index->root : NULL;
+}
+
+void ac_search_index_close(ac_search_index_t *index) {
+    if (!index) return;
+    ac_tree_watch_stop(&index->watch);
+    unmap_index(index);
+    path_set_clear(&index->dirty);
+    free(index->root);
+    free(index->index_path);
+    free(index);
+}
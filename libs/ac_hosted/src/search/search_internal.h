@@ -0,0 +1,170 @@
+/**
+ * @file search_internal.h
+ * @brief Internal declarations shared by the search components
+ */
+
+#ifndef ARC_HOSTED_SEARCH_INTERNAL_H
+#define ARC_HOSTED_SEARCH_INTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+/*============================================================================
+ * Glob Patterns
+ *============================================================================*/
+
+/* How a glob is matched; the common gitignore shapes avoid the matcher */
+typedef enum {
+    AC_GLOB_LITERAL = 0,                /* "Makefile" */
+    AC_GLOB_SUFFIX,                     /* "*.o" */
+    AC_GLOB_PREFIX,                     /* "build*" */
+    AC_GLOB_GENERAL,                    /* Anything else */
+} ac_glob_kind_t;
+
+/**
+ * @brief Compiled glob
+ *
+ * '*' and '?' do not match '/', "[...]" classes support ranges and
+ * "!"/"^" negation, and "**" as a whole path component matches any
+ * number of directories ("**" + "/x", "a/" + "**" + "/x", "a/" + "**").
+ */
+typedef struct {
+    ac_glob_kind_t kind;
+    char *pattern;                      /* Owned copy */
+    size_t len;
+    const char *literal;                /* Fixed part for LITERAL / SUFFIX / PREFIX */
+    size_t literal_len;
+} ac_glob_t;
+
+int ac_glob_compile(ac_glob_t *glob, const char *pattern, size_t len);
+int ac_glob_match(const ac_glob_t *glob, const char *str, size_t len);
+void ac_glob_free(ac_glob_t *glob);
+
+/* Match without compiling */
+int ac_glob_match_raw(const char *pattern, size_t pattern_len, const char *str, size_t len);
+
+/*============================================================================
+ * Ignore Files
+ *============================================================================*/
+
+typedef struct ac_ignore_rule {
+    ac_glob_t glob;
+    unsigned char negate;               /* "!pattern" re-includes */
+    unsigned char dir_only;             /* "pattern/" */
+    unsigned char anchored;             /* Contains a slash: relative to the file's directory */
+} ac_ignore_rule_t;
+
+/**
+ * @brief Rules of one directory level (or global excludes)
+ *
+ * Entry paths are relative to the walk root. A rule set applies to an
+ * entry below its own directory: `strip` leading bytes of the entry's
+ * path are removed (in-tree files) or `prefix` is prepended (files in
+ * directories above the root) to get the path the rules expect.
+ */
+typedef struct ac_ignore {
+    ac_ignore_rule_t *rules;
+    size_t count;
+    size_t capacity;
+    char *prefix;                       /* Prepended to entry paths ("" = none) */
+    size_t strip;                       /* Bytes removed from entry paths */
+    struct ac_ignore *parent;           /* Next lower-priority rule set */
+} ac_ignore_t;
+
+/* Add the rules of a gitignore-format buffer; returns rules added */
+size_t ac_ignore_add_rules(ac_ignore_t *ignore, const char *text, size_t len);
+
+/* Add the rules of a file, if it exists */
+size_t ac_ignore_add_file(ac_ignore_t *ignore, const char *path);
+
+/**
+ * @brief Whether an entry is ignored by a chain of rule sets
+ *
+ * @param ignore    Highest-priority rule set (NULL = nothing ignored)
+ * @param rel_path  Entry path relative to the walk root
+ * @param name      Last component of rel_path
+ * @param is_dir    Entry is a directory
+ */
+int ac_ignore_match(const ac_ignore_t *ignore, const char *rel_path, size_t rel_len,
+                    const char *name, int is_dir);
+
+void ac_ignore_free(ac_ignore_t *ignore);
+
+/*============================================================================
+ * File Times
+ *============================================================================*/
+
+/* Modification time in ns since the epoch */
+static inline int64_t ac_stat_mtime_ns(const struct stat *st) {
+#if defined(__APPLE__)
+    return (int64_t)st->st_mtimespec.tv_sec * 1000000000 + st->st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    return (int64_t)st->st_mtime * 1000000000;
+#else
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+/*============================================================================
+ * Index Files
+ *============================================================================*/
+
+/**
+ * @brief Directory holding the persistent indexes, created if missing
+ *
+ * @param configured  Directory from the options (NULL = $XDG_CACHE_HOME/arc/index,
+ *                    ~/.cache/arc/index)
+ * @return 0, or -1 if there is no usable directory
+ */
+int ac_index_cache_dir(const char *configured, char *out, size_t size);
+
+/*============================================================================
+ * Tree Watching
+ *============================================================================*/
+
+/* What a file event may mean */
+enum {
+    AC_TREE_CREATED = 1,                /* Created or moved in */
+    AC_TREE_WRITTEN = 2,                /* Closed after writing */
+};
+
+/**
+ * @brief File changed below the root
+ *
+ * @param rel    Path relative to the root
+ * @param flags  AC_TREE_* bits of the event
+ * @return Nonzero if the tree needs a full walk
+ */
+typedef int (*ac_tree_event_fn)(void *user_data, const char *rel, size_t len, unsigned int flags);
+
+/**
+ * @brief inotify watches over the directories of an indexed tree (Linux)
+ *
+ * Hidden entries are not reported to the owner. A change to an ignore
+ * file (.gitignore, .ignore, or the repository's info/exclude, also
+ * above the root), to the set of directories, or a lost event asks for
+ * a full walk instead. A watcher that cannot add a watch gives up
+ * (fd -1) and its owner falls back to checking mtimes.
+ */
+typedef struct {
+    int fd;                             /* inotify descriptor, -1 = not watching */
+    const char *owner;                  /* Log prefix */
+    char **dirs;                        /* Relative directory per watch descriptor;
+                                           absolute above the root (ignore files only) */
+    size_t cap;
+} ac_tree_watch_t;
+
+void ac_tree_watch_init(ac_tree_watch_t *w, const char *owner, int enable);
+void ac_tree_watch_stop(ac_tree_watch_t *w);
+
+/* Watch the root and the directories above it whose ignore files apply */
+void ac_tree_watch_root(ac_tree_watch_t *w, const char *root);
+
+/* Watch a directory the walk reached */
+void ac_tree_watch_dir(ac_tree_watch_t *w, const char *path, const char *rel);
+
+/* Hand pending file events to on_file; returns nonzero if a full walk is needed */
+int ac_tree_watch_drain(ac_tree_watch_t *w, ac_tree_event_fn on_file, void *user_data);
+
+#endif /* ARC_HOSTED_SEARCH_INTERNAL_H */
@@ -0,0 +1,1932 @@
+/**
+ * @file search_symbols.c
+ * @brief Persistent symbol index built with tree-sitter queries
+ *
+ * File layout (native byte order, guarded by the magic):
+ *
+ *   header | root path | file table | symbols | string offsets | strings | paths
+ *
+ * Names and scopes are interned: a symbol is a 16-byte record of two
+ * string ids, a position, its kind and its role, stored per file in
+ * walk order.
+ *
+ * In memory every file owns its symbol array, and a name -> occurrences
+ * table (postings) answers queries. Files parsed after the postings were
+ * built ("fresh" files) are left out of them and scanned directly; once
+ * enough accumulate the postings are rebuilt and the index file is
+ * rewritten. Parsing runs on several threads when many files changed.
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include <arc/symbol_index.h>
+#include <arc/grep.h>
+#include <arc/log.h>
+#include <arc/walk.h>
+#include "search_internal.h"
+
+#include <tree_sitter/api.h>
+#include <tree_sitter/tree-sitter-c.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#else
+#include <process.h>
+#define realpath(name, resolved) _fullpath((resolved), (name), 4096)
+#define getpid _getpid
+#define strcasecmp _stricmp
+#endif
+
+#define SYM_MAGIC "ARCSYM\0\1"
+#define SYM_VERSION 1
+#define SYM_MAX_FILE_SIZE (1u << 20)
+#define SYM_MIN_CHANGED 64              /* Changed files tolerated before a rewrite... */
+#define SYM_CHANGED_SHARE 16            /* ...or 1/16 of the files, if more */
+#define SYM_PATH_MAX 4096
+#define SYM_MAX_THREADS 8
+#define SYM_FILES_PER_THREAD 16         /* Fewer changed files are parsed on the caller */
+#define SYM_MAX_DEPTH 128               /* Scope nesting tracked by the lexical scanner */
+#define NO_ID UINT32_MAX
+
+/*============================================================================
+ * On-Disk Format
+ *============================================================================*/
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t file_count;
+    uint32_t string_count;
+    uint32_t root_len;
+    uint64_t symbol_count;
+    uint64_t strings_len;
+    uint64_t paths_len;
+    uint64_t total_size;
+} index_header_t;
+
+typedef struct {
+    uint64_t size;
+    int64_t mtime_ns;
+    uint32_t path_off;                  /* In the paths region */
+    uint32_t path_len;
+    uint32_t count;                     /* Symbols, following the previous file's */
+    uint32_t lang;
+} index_file_t;
+
+/* Symbol record, in memory and on disk */
+typedef struct {
+    uint32_t name;                      /* String id */
+    uint32_t scope;                     /* String id (0 = "", file scope) */
+    uint32_t line;                      /* 0-based */
+    uint16_t column;                    /* 0-based, saturated */
+    uint8_t kind;
+    uint8_t role;
+} sym_t;
+
+/*============================================================================
+ * Languages
+ *============================================================================*/
+
+typedef enum {
+    LANG_NONE = 0,
+    LANG_C,
+    LANG_CPP,                           /* Parsed with the C grammar */
+    LANG_PYTHON,
+    LANG_JS,                            /* JavaScript and TypeScript */
+    LANG_GO,
+    LANG_RUST,
+} lang_t;
+
+static const struct {
+    const char *ext;
+    lang_t lang;
+} g_extensions[] = {
+    { "c", LANG_C }, { "h", LANG_C },
+    { "cc", LANG_CPP }, { "cpp", LANG_CPP }, { "cxx", LANG_CPP },
+    { "hh", LANG_CPP }, { "hpp", LANG_CPP }, { "hxx", LANG_CPP },
+    { "py", LANG_PYTHON },
+    { "js", LANG_JS }, { "jsx", LANG_JS }, { "mjs", LANG_JS }, { "cjs", LANG_JS },
+    { "ts", LANG_JS }, { "tsx", LANG_JS },
+    { "go", LANG_GO },
+    { "rs", LANG_RUST },
+};
+
+static lang_t path_lang(const char *path) {
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    const char *dot = strrchr(base, '.');
+    if (!dot || dot == base) return LANG_NONE;
+    for (size_t i = 0; i < sizeof(g_extensions) / sizeof(g_extensions[0]); i++) {
+        if (strcmp(dot + 1, g_extensions[i].ext) == 0) return g_extensions[i].lang;
+    }
+    return LANG_NONE;
+}
+
+/* Word introducing a definition in the lexically scanned languages */
+typedef struct {
+    const char *word;
+    int kind;
+} def_word_t;
+
+typedef struct {
+    const def_word_t *defs;
+    const char *const *keywords;        /* Sorted; never references */
+    size_t keyword_count;
+    int hash_comments;                  /* '#' comments, else C style */
+    int indent_scopes;                  /* Scopes follow indentation (Python) */
+    int backtick_strings;
+    int receivers;                      /* "func (r T) Name": skip the parentheses */
+    int lifetimes;                      /* 'a is not a character literal */
+} lexer_lang_t;
+
+static const def_word_t g_py_defs[] = {
+    { "def", AC_SYMBOL_FUNCTION }, { "class", AC_SYMBOL_CLASS }, { NULL, 0 },
+};
+static const char *const g_py_keywords[] = {
+    "False", "None", "True", "and", "as", "assert", "async", "await", "break", "class",
+    "continue", "def", "del", "elif", "else", "except", "finally", "for", "from", "global",
+    "if", "import", "in", "is", "lambda", "nonlocal", "not", "or", "pass", "raise", "return",
+    "self", "try", "while", "with", "yield",
+};
+
+static const def_word_t g_js_defs[] = {
+    { "function", AC_SYMBOL_FUNCTION }, { "class", AC_SYMBOL_CLASS },
+    { "interface", AC_SYMBOL_TYPEDEF }, { "type", AC_SYMBOL_TYPEDEF }, { "enum", AC_SYMBOL_ENUM },
+    { "const", AC_SYMBOL_VARIABLE }, { "let", AC_SYMBOL_VARIABLE }, { "var", AC_SYMBOL_VARIABLE },
+    { NULL, 0 },
+};
+static const char *const g_js_keywords[] = {
+    "as", "async", "await", "break", "case", "catch", "class", "const", "continue", "debugger",
+    "default", "delete", "do", "else", "enum", "export", "extends", "false", "finally", "for",
+    "from", "function", "if", "implements", "import", "in", "instanceof", "interface", "let",
+    "new", "null", "of", "return", "static", "super", "switch", "this", "throw", "true", "try",
+    "type", "typeof", "undefined", "var", "void", "while", "with", "yield",
+};
+
+static const def_word_t g_go_defs[] = {
+    { "func", AC_SYMBOL_FUNCTION }, { "type", AC_SYMBOL_TYPEDEF },
+    { "var", AC_SYMBOL_VARIABLE }, { "const", AC_SYMBOL_VARIABLE }, { NULL, 0 },
+};
+static const char *const g_go_keywords[] = {
+    "break", "case", "chan", "const", "continue", "default", "defer", "else", "fallthrough",
+    "false", "for", "func", "go", "goto", "if", "import", "interface", "iota", "map", "nil",
+    "package", "range", "return", "select", "struct", "switch", "true", "type", "var",
+};
+
+static const def_word_t g_rust_defs[] = {
+    { "fn", AC_SYMBOL_FUNCTION }, { "struct", AC_SYMBOL_STRUCT }, { "enum", AC_SYMBOL_ENUM },
+    { "union", AC_SYMBOL_UNION }, { "trait", AC_SYMBOL_TYPEDEF }, { "type", AC_SYMBOL_TYPEDEF },
+    { "const", AC_SYMBOL_VARIABLE }, { "static", AC_SYMBOL_VARIABLE }, { "let", AC_SYMBOL_VARIABLE },
+    { "macro_rules", AC_SYMBOL_MACRO }, { NULL, 0 },
+};
+static const char *const g_rust_keywords[] = {
+    "Self", "as", "async", "await", "break", "const", "continue", "crate", "dyn", "else",
+    "enum", "extern", "false", "fn", "for", "if", "impl", "in", "let", "loop", "macro_rules",
+    "match", "mod", "move", "mut", "pub", "ref", "return", "self", "static", "struct", "super",
+    "trait", "true", "type", "union", "unsafe", "use", "where", "while",
+};
+
+#define KEYWORDS(list) list, sizeof(list) / sizeof(list[0])
+
+static const lexer_lang_t g_python = { g_py_defs, KEYWORDS(g_py_keywords), 1, 1, 0, 0, 0 };
+static const lexer_lang_t g_js = { g_js_defs, KEYWORDS(g_js_keywords), 0, 0, 1, 0, 0 };
+static const lexer_lang_t g_go = { g_go_defs, KEYWORDS(g_go_keywords), 0, 0, 1, 1, 0 };
+static const lexer_lang_t g_rust = { g_rust_defs, KEYWORDS(g_rust_keywords), 0, 0, 0, 0, 1 };
+
+static const lexer_lang_t *lexer_for(lang_t lang) {
+    switch (lang) {
+    case LANG_PYTHON: return &g_python;
+    case LANG_JS: return &g_js;
+    case LANG_GO: return &g_go;
+    case LANG_RUST: return &g_rust;
+    default: return NULL;
+    }
+}
+
+/*============================================================================
+ * Strings
+ *============================================================================*/
+
+static uint64_t hash_bytes(const char *s, size_t len) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/* Interned strings: id -> NUL-terminated bytes; id 0 is "" */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    uint32_t *offs;
+    uint32_t count;
+    uint32_t offs_cap;
+    uint32_t *slots;                    /* id + 1, 0 = empty */
+    size_t mask;
+} strtab_t;
+
+static const char *str_at(const strtab_t *t, uint32_t id) {
+    return t->data + t->offs[id];
+}
+
+static int strtab_grow_slots(strtab_t *t) {
+    size_t cap = t->slots ? (t->mask + 1) * 2 : 1024;
+    uint32_t *slots = calloc(cap, sizeof(uint32_t));
+    if (!slots) return -1;
+    for (uint32_t id = 0; id < t->count; id++) {
+        const char *s = str_at(t, id);
+        size_t i = (size_t)hash_bytes(s, strlen(s)) & (cap - 1);
+        while (slots[i]) i = (i + 1) & (cap - 1);
+        slots[i] = id + 1;
+    }
+    free(t->slots);
+    t->slots = slots;
+    t->mask = cap - 1;
+    return 0;
+}
+
+static uint32_t strtab_find(const strtab_t *t, const char *s, size_t len) {
+    if (!t->slots) return NO_ID;
+    size_t i = (size_t)hash_bytes(s, len) & t->mask;
+    while (t->slots[i]) {
+        uint32_t id = t->slots[i] - 1;
+        const char *e = str_at(t, id);
+        if (memcmp(e, s, len) == 0 && e[len] == '\0') return id;
+        i = (i + 1) & t->mask;
+    }
+    return NO_ID;
+}
+
+static uint32_t strtab_intern(strtab_t *t, const char *s, size_t len) {
+    uint32_t id = strtab_find(t, s, len);
+    if (id != NO_ID) return id;
+
+    if (((size_t)t->count + 1) * 2 > (t->slots ? t->mask + 1 : 0) && strtab_grow_slots(t) != 0) {
+        return NO_ID;
+    }
+    if (t->count == t->offs_cap) {
+        uint32_t cap = t->offs_cap ? t->offs_cap * 2 : 1024;
+        uint32_t *offs = realloc(t->offs, cap * sizeof(uint32_t));
+        if (!offs) return NO_ID;
+        t->offs = offs;
+        t->offs_cap = cap;
+    }
+    if (t->len + len + 1 > t->cap) {
+        size_t cap = t->cap ? t->cap : 65536;
+        while (cap < t->len + len + 1) cap *= 2;
+        if (cap > UINT32_MAX) return NO_ID;
+        char *data = realloc(t->data, cap);
+        if (!data) return NO_ID;
+        t->data = data;
+        t->cap = cap;
+    }
+    memcpy(t->data + t->len, s, len);
+    t->data[t->len + len] = '\0';
+    id = t->count++;
+    t->offs[id] = (uint32_t)t->len;
+    t->len += len + 1;
+
+    size_t i = (size_t)hash_bytes(s, len) & t->mask;
+    while (t->slots[i]) i = (i + 1) & t->mask;
+    t->slots[i] = id + 1;
+    return id;
+}
+
+static void strtab_free(strtab_t *t) {
+    free(t->data);
+    free(t->offs);
+    free(t->slots);
+    memset(t, 0, sizeof(*t));
+}
+
+/*============================================================================
+ * Index Handle
+ *============================================================================*/
+
+typedef struct {
+    char *path;                         /* Relative to the root */
+    uint64_t size;
+    int64_t mtime_ns;
+    sym_t *syms;
+    uint32_t count;
+    uint32_t seen;                      /* Generation of the last walk listing it */
+    uint8_t lang;
+    uint8_t owned;                      /* syms is malloc'd (else in the loaded file) */
+    uint8_t fresh;                      /* Not in the postings: scanned directly */
+    uint8_t removed;
+    uint8_t dirty;                      /* Reported by inotify */
+} file_t;
+
+typedef struct {
+    uint32_t file;
+    uint32_t sym;
+} post_t;
+
+/* Tree-sitter language with its compiled query */
+typedef struct {
+    const TSLanguage *language;
+    TSQuery *query;
+    unsigned char *capture_kinds;       /* Capture id -> CAPTURE_* */
+    TSSymbol identifier;
+    TSSymbol field_identifier;
+    TSSymbol type_identifier;
+    TSSymbol function_declarator;
+    TSSymbol storage_class;
+    TSFieldId declarator_field;
+    TSFieldId name_field;
+} ts_lang_t;
+
+typedef struct parse_ctx parse_ctx_t;
+
+struct ac_symbol_index {
+    char *root;
+    char *index_path;
+    ac_symbol_index_options_t opts;
+    ts_lang_t c;
+
+    strtab_t strings;
+    pthread_mutex_t lock;               /* strings, while parsing on several threads */
+    file_t *files;
+    size_t file_count;
+    size_t file_cap;
+    uint32_t *path_slots;               /* Path -> file id + 1 */
+    size_t path_mask;
+    void *loaded;                       /* Symbols read from the index file */
+    uint32_t gen;
+
+    uint32_t *post_start;               /* Name id -> first posting; post_names + 1 entries */
+    post_t *posts;
+    uint32_t post_names;
+    size_t fresh;                       /* Files left out of the postings */
+    size_t changed;                     /* Files changed since the write */
+    parse_ctx_t *ctx;                   /* Parser for the calling thread */
+
+    uint32_t *dirty;                    /* File ids reported by inotify */
+    size_t dirty_count;
+    size_t dirty_cap;
+    int need_check;                     /* Walk the tree before answering */
+
+    size_t index_bytes;
+    size_t parsed;
+    size_t writes;
+
+    ac_tree_watch_t watch;
+};
+
+static size_t change_limit(const ac_symbol_index_t *idx) {
+    size_t share = idx->file_count / SYM_CHANGED_SHARE;
+    return share > SYM_MIN_CHANGED ? share : SYM_MIN_CHANGED;
+}
+
+static size_t max_file_size(const ac_symbol_index_t *idx) {
+    return idx->opts.max_file_size ? idx->opts.max_file_size : SYM_MAX_FILE_SIZE;
+}
+
+/*============================================================================
+ * File Table
+ *============================================================================*/
+
+static int path_map_grow(ac_symbol_index_t *idx) {
+    size_t cap = idx->path_slots ? (idx->path_mask + 1) * 2 : 1024;
+    while (cap < idx->file_count * 2) cap *= 2;
+    uint32_t *slots = calloc(cap, sizeof(uint32_t));
+    if (!slots) return -1;
+    for (size_t id = 0; id < idx->file_count; id++) {
+        const char *p = idx->files[id].path;
+        size_t i = (size_t)hash_bytes(p, strlen(p)) & (cap - 1);
+        while (slots[i]) i = (i + 1) & (cap - 1);
+        slots[i] = (uint32_t)id + 1;
+    }
+    free(idx->path_slots);
+    idx->path_slots = slots;
+    idx->path_mask = cap - 1;
+    return 0;
+}
+
+static uint32_t find_file(const ac_symbol_index_t *idx, const char *path, size_t len) {
+    if (!idx->path_slots) return NO_ID;
+    size_t i = (size_t)hash_bytes(path, len) & idx->path_mask;
+    while (idx->path_slots[i]) {
+        uint32_t id = idx->path_slots[i] - 1;
+        const char *p = idx->files[id].path;
+        if (strncmp(p, path, len) == 0 && p[len] == '\0') return id;
+        i = (i + 1) & idx->path_mask;
+    }
+    return NO_ID;
+}
+
+/* Append a file (not yet parsed); returns its id or NO_ID */
+static uint32_t add_file(ac_symbol_index_t *idx, const char *path, lang_t lang) {
+    if (idx->file_count == idx->file_cap) {
+        size_t cap = idx->file_cap ? idx->file_cap * 2 : 256;
+        file_t *files = realloc(idx->files, cap * sizeof(*files));
+        if (!files) return NO_ID;
+        idx->files = files;
+        idx->file_cap = cap;
+    }
+    if ((idx->file_count + 1) * 2 > (idx->path_slots ? idx->path_mask + 1 : 0) &&
+        path_map_grow(idx) != 0) {
+        return NO_ID;
+    }
+    file_t *f = &idx->files[idx->file_count];
+    memset(f, 0, sizeof(*f));
+    f->path = strdup(path);
+    if (!f->path) return NO_ID;
+    f->lang = (uint8_t)lang;
+    f->fresh = 1;
+    idx->fresh++;
+
+    uint32_t id = (uint32_t)idx->file_count++;
+    size_t i = (size_t)hash_bytes(path, strlen(path)) & idx->path_mask;
+    while (idx->path_slots[i]) i = (i + 1) & idx->path_mask;
+    idx->path_slots[i] = id + 1;
+    return id;
+}
+
+static void set_syms(file_t *f, sym_t *syms, uint32_t count) {
+    if (f->owned) free(f->syms);
+    f->syms = syms;
+    f->count = count;
+    f->owned = 1;
+}
+
+static void mark_fresh(ac_symbol_index_t *idx, file_t *f) {
+    if (!f->fresh) {
+        f->fresh = 1;
+        idx->fresh++;
+    }
+    idx->changed++;
+}
+
+static void remove_file(ac_symbol_index_t *idx, file_t *f) {
+    if (f->removed) return;
+    set_syms(f, NULL, 0);
+    f->removed = 1;
+    mark_fresh(idx, f);
+}
+
+/*============================================================================
+ * Symbol Extraction
+ *============================================================================*/
+
+/* Symbol before interning: the name is a range of the source */
+typedef struct {
+    uint32_t start;
+    uint32_t len;
+    uint32_t line;
+    uint32_t column;
+    int32_t scope;                      /* Index of the symbol naming the scope, -1 = none */
+    uint8_t kind;
+    uint8_t role;
+    uint32_t scope_end;                 /* End of the range a definition encloses, from its name */
+} raw_sym_t;
+
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+    uint32_t owner;
+} scope_range_t;
+
+struct parse_ctx {
+    TSParser *parser;
+    TSQueryCursor *cursor;
+    raw_sym_t *raw;
+    size_t raw_count;
+    size_t raw_cap;
+    scope_range_t *scopes;
+    size_t scopes_cap;
+    int32_t *remap;
+    size_t remap_cap;
+    char *buf;
+    size_t buf_cap;
+    int failed;
+};
+
+static raw_sym_t *raw_add(parse_ctx_t *ctx) {
+    if (ctx->raw_count == ctx->raw_cap) {
+        size_t cap = ctx->raw_cap ? ctx->raw_cap * 2 : 1024;
+        raw_sym_t *raw = realloc(ctx->raw, cap * sizeof(*raw));
+        if (!raw) {
+            ctx->failed = 1;
+            return NULL;
+        }
+        ctx->raw = raw;
+        ctx->raw_cap = cap;
+    }
+    raw_sym_t *s = &ctx->raw[ctx->raw_count++];
+    memset(s, 0, sizeof(*s));
+    s->scope = -1;
+    return s;
+}
+
+/*
+ * One pattern per construct; the code below finds the name inside the
+ * captured node. Identifiers that are not a definition's name are
+ * references.
+ */
+static const char g_c_query[] =
+    "(function_definition) @function\n"
+    "(declaration) @declaration\n"
+    "(field_declaration) @field\n"
+    "(type_definition) @typedef\n"
+    "(parameter_declaration) @parameter\n"
+    "(struct_specifier name: (type_identifier) body: (field_declaration_list)) @struct\n"
+    "(union_specifier name: (type_identifier) body: (field_declaration_list)) @union\n"
+    "(enum_specifier name: (type_identifier) body: (enumerator_list)) @enum\n"
+    "(enumerator name: (identifier) @enumerator)\n"
+    "(preproc_def name: (identifier) @macro)\n"
+    "(preproc_function_def name: (identifier) @macro)\n"
+    "[(identifier) (type_identifier) (field_identifier)] @reference\n";
+
+enum {
+    CAPTURE_NONE = 0,
+    CAPTURE_FUNCTION,
+    CAPTURE_DECLARATION,
+    CAPTURE_FIELD,
+    CAPTURE_TYPEDEF,
+    CAPTURE_PARAMETER,
+    CAPTURE_STRUCT,
+    CAPTURE_UNION,
+    CAPTURE_ENUM,
+    CAPTURE_ENUMERATOR,
+    CAPTURE_MACRO,
+    CAPTURE_REFERENCE,
+};
+
+static const char *const g_capture_names[] = {
+    "", "function", "declaration", "field", "typedef", "parameter",
+    "struct", "union", "enum", "enumerator", "macro", "reference",
+};
+
+static int ts_lang_init(ts_lang_t *l) {
+    memset(l, 0, sizeof(*l));
+    l->language = tree_sitter_c();
+    uint32_t error_offset = 0;
+    TSQueryError error = TSQueryErrorNone;
+    l->query = ts_query_new(l->language, g_c_query, (uint32_t)strlen(g_c_query), &error_offset, &error);
+    if (!l->query) {
+        AC_LOG_WARN("symbol index: query error %d at offset %u", (int)error, error_offset);
+        return -1;
+    }
+    uint32_t captures = ts_query_capture_count(l->query);
+    l->capture_kinds = calloc(captures ? captures : 1, 1);
+    if (!l->capture_kinds) return -1;
+    for (uint32_t i = 0; i < captures; i++) {
+        uint32_t len = 0;
+        const char *name = ts_query_capture_name_for_id(l->query, i, &len);
+        for (size_t k = 1; k < sizeof(g_capture_names) / sizeof(g_capture_names[0]); k++) {
+            if (strlen(g_capture_names[k]) == len && memcmp(g_capture_names[k], name, len) == 0) {
+                l->capture_kinds[i] = (unsigned char)k;
+            }
+        }
+    }
+    l->identifier = ts_language_symbol_for_name(l->language, "identifier", 10, true);
+    l->field_identifier = ts_language_symbol_for_name(l->language, "field_identifier", 16, true);
+    l->type_identifier = ts_language_symbol_for_name(l->language, "type_identifier", 15, true);
+    l->function_declarator = ts_language_symbol_for_name(l->language, "function_declarator", 19, true);
+    l->storage_class = ts_language_symbol_for_name(l->language, "storage_class_specifier", 23, true);
+    l->declarator_field = ts_language_field_id_for_name(l->language, "declarator", 10);
+    l->name_field = ts_language_field_id_for_name(l->language, "name", 4);
+    return 0;
+}
+
+static void ts_lang_free(ts_lang_t *l) {
+    if (l->query) ts_query_delete(l->query);
+    free(l->capture_kinds);
+    memset(l, 0, sizeof(*l));
+}
+
+static int is_name_node(const ts_lang_t *l, TSSymbol s) {
+    return s == l->identifier || s == l->field_identifier || s == l->type_identifier;
+}
+
+/*
+ * Innermost name of a declarator ("*(*f)(int)" -> f). Declares a
+ * function when the name sits directly in a function_declarator
+ * ("int *f(void)"), not when it is wrapped first ("int (*f)(void)").
+ */
+static TSNode declarator_name(const ts_lang_t *l, TSNode node, int *is_function) {
+    int function = 0;
+    for (int depth = 0; depth < 32 && !ts_node_is_null(node); depth++) {
+        TSSymbol s = ts_node_symbol(node);
+        if (is_name_node(l, s)) {
+            *is_function = function;
+            return node;
+        }
+        function = s == l->function_declarator;
+        TSNode next = ts_node_child_by_field_id(node, l->declarator_field);
+        if (ts_node_is_null(next)) next = ts_node_named_child(node, 0);     /* Parenthesized */
+        node = next;
+    }
+    *is_function = 0;
+    TSNode none = { { 0, 0, 0, 0 }, NULL, NULL };
+    return none;
+}
+
+static raw_sym_t *add_node(parse_ctx_t *ctx, TSNode name, int kind, int role) {
+    raw_sym_t *s = raw_add(ctx);
+    if (!s) return NULL;
+    TSPoint p = ts_node_start_point(name);
+    s->start = ts_node_start_byte(name);
+    s->len = ts_node_end_byte(name) - s->start;
+    s->line = p.row;
+    s->column = p.column;
+    s->kind = (uint8_t)kind;
+    s->role = (uint8_t)role;
+    return s;
+}
+
+static int is_extern(const ts_lang_t *l, TSNode decl, const char *src) {
+    uint32_t n = ts_node_named_child_count(decl);
+    for (uint32_t i = 0; i < n; i++) {
+        TSNode c = ts_node_named_child(decl, i);
+        if (ts_node_symbol(c) != l->storage_class) continue;
+        uint32_t start = ts_node_start_byte(c);
+        if (ts_node_end_byte(c) - start == 6 && memcmp(src + start, "extern", 6) == 0) return 1;
+    }
+    return 0;
+}
+
+/* Names of every "declarator:" child of a declaration-like node */
+static void add_declarators(parse_ctx_t *ctx, const ts_lang_t *l, TSNode node, int capture,
+                            const char *src) {
+    int ext = capture == CAPTURE_DECLARATION && is_extern(l, node, src);
+    TSTreeCursor cursor = ts_tree_cursor_new(node);
+    if (ts_tree_cursor_goto_first_child(&cursor)) {
+        do {
+            if (ts_tree_cursor_current_field_id(&cursor) != l->declarator_field) continue;
+            int is_function = 0;
+            TSNode name = declarator_name(l, ts_tree_cursor_current_node(&cursor), &is_function);
+            if (ts_node_is_null(name)) continue;
+
+            int kind = AC_SYMBOL_VARIABLE, role = AC_SYMBOL_DEFINITION;
+            switch (capture) {
+            case CAPTURE_DECLARATION:
+                if (is_function) kind = AC_SYMBOL_FUNCTION;
+                if (is_function || ext) role = AC_SYMBOL_DECLARATION;
+                break;
+            case CAPTURE_FIELD: kind = AC_SYMBOL_FIELD; break;
+            case CAPTURE_TYPEDEF: kind = AC_SYMBOL_TYPEDEF; break;
+            case CAPTURE_PARAMETER: kind = AC_SYMBOL_PARAMETER; break;
+            }
+            add_node(ctx, name, kind, role);
+        } while (ts_tree_cursor_goto_next_sibling(&cursor));
+    }
+    ts_tree_cursor_delete(&cursor);
+}
+
+static int compare_raw(const void *a, const void *b) {
+    const raw_sym_t *x = a, *y = b;
+    if (x->start != y->start) return x->start < y->start ? -1 : 1;
+    return (x->role > y->role) - (x->role < y->role);   /* Definitions first */
+}
+
+static int compare_scopes(const void *a, const void *b) {
+    const scope_range_t *x = a, *y = b;
+    if (x->start != y->start) return x->start < y->start ? -1 : 1;
+    return (x->end < y->end) - (x->end > y->end);       /* Outer first */
+}
+
+/* Sort, drop references that are definitions, and assign scopes */
+static void resolve_scopes(parse_ctx_t *ctx) {
+    qsort(ctx->raw, ctx->raw_count, sizeof(raw_sym_t), compare_raw);
+    size_t n = 0;
+    for (size_t i = 0; i < ctx->raw_count; i++) {
+        if (n > 0 && ctx->raw[i].role == AC_SYMBOL_REFERENCE && ctx->raw[n - 1].start == ctx->raw[i].start) {
+            continue;
+        }
+        ctx->raw[n++] = ctx->raw[i];
+    }
+    ctx->raw_count = n;
+
+    size_t nscopes = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (ctx->raw[i].scope_end == 0) continue;
+        if (nscopes == ctx->scopes_cap) {
+            size_t cap = ctx->scopes_cap ? ctx->scopes_cap * 2 : 256;
+            scope_range_t *scopes = realloc(ctx->scopes, cap * sizeof(*scopes));
+            if (!scopes) {
+                ctx->failed = 1;
+                return;
+            }
+            ctx->scopes = scopes;
+            ctx->scopes_cap = cap;
+        }
+        ctx->scopes[nscopes].start = ctx->raw[i].start;
+        ctx->scopes[nscopes].end = ctx->raw[i].scope_end;
+        ctx->scopes[nscopes].owner = (uint32_t)i;
+        nscopes++;
+    }
+    qsort(ctx->scopes, nscopes, sizeof(scope_range_t), compare_scopes);
+
+    /* Sweep: the stack holds the ranges containing the current position */
+    uint32_t stack[SYM_MAX_DEPTH];
+    size_t depth = 0, next = 0;
+    for (size_t i = 0; i < n; i++) {
+        raw_sym_t *s = &ctx->raw[i];
+        while (next < nscopes && ctx->scopes[next].start <= s->start) {
+            const scope_range_t *open = &ctx->scopes[next++];
+            while (depth > 0 && ctx->scopes[stack[depth - 1]].end <= open->start) depth--;
+            if (depth < SYM_MAX_DEPTH) stack[depth++] = (uint32_t)(open - ctx->scopes);
+        }
+        while (depth > 0 && ctx->scopes[stack[depth - 1]].end <= s->start) depth--;
+        size_t d = depth;
+        if (d > 0 && ctx->scopes[stack[d - 1]].owner == i) d--;     /* A definition names its own scope */
+        s->scope = d > 0 ? (int32_t)ctx->scopes[stack[d - 1]].owner : -1;
+    }
+}
+
+/* Prototype parameters are noise: keep parameters inside functions only */
+static void drop_prototype_parameters(parse_ctx_t *ctx) {
+    if (ctx->raw_count > ctx->remap_cap) {
+        int32_t *remap = realloc(ctx->remap, ctx->raw_count * sizeof(int32_t));
+        if (!remap) {
+            ctx->failed = 1;
+            return;
+        }
+        ctx->remap = remap;
+        ctx->remap_cap = ctx->raw_count;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < ctx->raw_count; i++) {
+        raw_sym_t *s = &ctx->raw[i];
+        if (s->kind == AC_SYMBOL_PARAMETER &&
+            (s->scope < 0 || ctx->raw[s->scope].kind != AC_SYMBOL_FUNCTION)) {
+            ctx->remap[i] = -1;
+            continue;
+        }
+        ctx->remap[i] = (int32_t)n;
+        if (s->scope >= 0) s->scope = ctx->remap[s->scope];     /* Owners come first */
+        ctx->raw[n++] = *s;
+    }
+    ctx->raw_count = n;
+}
+
+static void extract_c(parse_ctx_t *ctx, const ts_lang_t *l, const char *src, size_t len) {
+    TSTree *tree = ts_parser_parse_string(ctx->parser, NULL, src, (uint32_t)len);
+    if (!tree) return;
+    TSNode root = ts_tree_root_node(tree);
+    ts_query_cursor_exec(ctx->cursor, l->query, root);
+
+    TSQueryMatch match;
+    while (!ctx->failed && ts_query_cursor_next_match(ctx->cursor, &match)) {
+        if (match.capture_count == 0) continue;
+        TSNode node = match.captures[0].node;
+        int capture = l->capture_kinds[match.captures[0].index];
+
+        switch (capture) {
+        case CAPTURE_FUNCTION: {
+            int is_function = 0;
+            TSNode decl = ts_node_child_by_field_id(node, l->declarator_field);
+            TSNode name = declarator_name(l, decl, &is_function);
+            if (ts_node_is_null(name)) break;
+            raw_sym_t *s = add_node(ctx, name, AC_SYMBOL_FUNCTION, AC_SYMBOL_DEFINITION);
+            if (s) s->scope_end = ts_node_end_byte(node);
+            break;
+        }
+        case CAPTURE_DECLARATION:
+        case CAPTURE_FIELD:
+        case CAPTURE_TYPEDEF:
+        case CAPTURE_PARAMETER:
+            add_declarators(ctx, l, node, capture, src);
+            break;
+        case CAPTURE_STRUCT:
+        case CAPTURE_UNION:
+        case CAPTURE_ENUM: {
+            TSNode name = ts_node_child_by_field_id(node, l->name_field);
+            int kind = capture == CAPTURE_STRUCT ? AC_SYMBOL_STRUCT
+                     : capture == CAPTURE_UNION ? AC_SYMBOL_UNION : AC_SYMBOL_ENUM;
+            raw_sym_t *s = add_node(ctx, name, kind, AC_SYMBOL_DEFINITION);
+            if (s) s->scope_end = ts_node_end_byte(node);
+            break;
+        }
+        case CAPTURE_ENUMERATOR:
+            add_node(ctx, node, AC_SYMBOL_ENUMERATOR, AC_SYMBOL_DEFINITION);
+            break;
+        case CAPTURE_MACRO:
+            add_node(ctx, node, AC_SYMBOL_MACRO, AC_SYMBOL_DEFINITION);
+            break;
+        case CAPTURE_REFERENCE:
+            add_node(ctx, node, AC_SYMBOL_NAME, AC_SYMBOL_REFERENCE);
+            break;
+        }
+    }
+    ts_tree_delete(tree);
+
+    if (!ctx->failed) resolve_scopes(ctx);
+    if (!ctx->failed) drop_prototype_parameters(ctx);
+}
+
+static int is_ident_start(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '$' || c >= 0x80;
+}
+
+static int is_ident_char(unsigned char c) {
+    return is_ident_start(c) || (c >= '0' && c <= '9');
+}
+
+static int find_word(const char *const *words, size_t count, const char *s, size_t len) {
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int c = strncmp(words[mid], s, len);
+        if (c == 0 && words[mid][len] != '\0') c = 1;
+        if (c == 0) return 1;
+        if (c < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return 0;
+}
+
+static int def_kind(const lexer_lang_t *lx, const char *s, size_t len) {
+    for (const def_word_t *d = lx->defs; d->word; d++) {
+        if (strlen(d->word) == len && memcmp(d->word, s, len) == 0) return d->kind;
+    }
+    return -1;
+}
+
+static int opens_scope(int kind) {
+    return kind != AC_SYMBOL_VARIABLE && kind != AC_SYMBOL_MACRO;
+}
+
+/*
+ * Lexical scan: a name right after a definition keyword is defined,
+ * every other identifier outside strings and comments is a reference.
+ * Scopes follow braces (the body after a definition) or indentation.
+ */
+static void extract_lexical(parse_ctx_t *ctx, const lexer_lang_t *lx, const char *src, size_t len) {
+    struct {
+        int32_t owner;
+        uint32_t level;                 /* Indentation (Python) */
+    } stack[SYM_MAX_DEPTH];
+    size_t depth = 0;                   /* May exceed SYM_MAX_DEPTH; deeper levels are not tracked */
+    int32_t pending = -1;               /* Definition whose body the next '{' opens */
+    int kind = -1;                      /* Set right after a definition keyword */
+    int after_word = 0;                 /* Nothing but the keyword since */
+    int parens = 0;                     /* Python: no indentation inside brackets */
+    uint32_t line = 0, indent = 0;
+    size_t line_start = 0, i = 0;
+    int at_line_start = 1;
+
+#define TOP_OWNER() (depth > 0 ? stack[(depth > SYM_MAX_DEPTH ? SYM_MAX_DEPTH : depth) - 1].owner : -1)
+
+    while (i < len && !ctx->failed) {
+        unsigned char c = (unsigned char)src[i];
+        if (c == '\n') {
+            line++;
+            line_start = ++i;
+            at_line_start = 1;
+            continue;
+        }
+        if (at_line_start) {
+            at_line_start = 0;
+            size_t j = i;
+            while (j < len && (src[j] == ' ' || src[j] == '\t')) j++;
+            if (lx->indent_scopes && parens == 0 && j < len && src[j] != '\n' && src[j] != '\r' &&
+                src[j] != '#') {
+                indent = (uint32_t)(j - i);
+                while (depth > 0 && (depth > SYM_MAX_DEPTH || stack[depth - 1].level >= indent)) depth--;
+            }
+            i = j;
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == '\r') {
+            i++;
+            continue;
+        }
+
+        /* Comments */
+        if ((lx->hash_comments && c == '#') || (!lx->hash_comments && c == '/' && i + 1 < len && src[i + 1] == '/')) {
+            while (i < len && src[i] != '\n') i++;
+            continue;
+        }
+        if (!lx->hash_comments && c == '/' && i + 1 < len && src[i + 1] == '*') {
+            for (i += 2; i < len && !(src[i] == '*' && i + 1 < len && src[i + 1] == '/'); i++) {
+                if (src[i] == '\n') {
+                    line++;
+                    line_start = i + 1;
+                }
+            }
+            i += 2;
+            continue;
+        }
+
+        /* Strings */
+        if (c == '\'' && lx->lifetimes && i + 2 < len && is_ident_start((unsigned char)src[i + 1]) &&
+            src[i + 2] != '\'') {
+            for (i++; i < len && is_ident_char((unsigned char)src[i]); i++) {}
+            continue;
+        }
+        if (c == '"' || c == '\'' || (c == '`' && lx->backtick_strings)) {
+            int triple = lx->indent_scopes && i + 2 < len && src[i + 1] == (char)c && src[i + 2] == (char)c;
+            int multiline = triple || c == '`';
+            i += triple ? 3 : 1;
+            while (i < len) {
+                if (src[i] == '\\' && c != '`') {
+                    if (i + 1 < len && src[i + 1] == '\n') {
+                        line++;
+                        line_start = i + 2;
+                    }
+                    i += 2;
+                    continue;
+                }
+                if (src[i] == '\n') {
+                    if (!multiline) break;
+                    line++;
+                    line_start = i + 1;
+                }
+                if (src[i] == (char)c && (!triple || (i + 2 < len && src[i + 1] == (char)c && src[i + 2] == (char)c))) {
+                    i += triple ? 3 : 1;
+                    break;
+                }
+                i++;
+            }
+            kind = -1;
+            continue;
+        }
+
+        if (is_ident_start(c)) {
+            size_t start = i;
+            while (i < len && is_ident_char((unsigned char)src[i])) i++;
+            size_t n = i - start;
+
+            /* String prefixes: r"", b'', f"", br"" */
+            if (n <= 2 && i < len && (src[i] == '"' || src[i] == '\'') &&
+                strspn(src + start, "rbfuRBFU") >= n) {
+                continue;
+            }
+            if (find_word(lx->keywords, lx->keyword_count, src + start, n)) {
+                int k = def_kind(lx, src + start, n);
+                if (k >= 0) {
+                    kind = k;
+                    after_word = 1;
+                }
+                continue;
+            }
+
+            raw_sym_t *s = raw_add(ctx);
+            if (!s) break;
+            s->start = (uint32_t)start;
+            s->len = (uint32_t)n;
+            s->line = line;
+            s->column = (uint32_t)(start - line_start);
+            s->scope = TOP_OWNER();
+            s->kind = (uint8_t)(kind >= 0 ? kind : AC_SYMBOL_NAME);
+            s->role = kind >= 0 ? AC_SYMBOL_DEFINITION : AC_SYMBOL_REFERENCE;
+
+            if (kind >= 0 && opens_scope(kind)) {
+                int32_t self = (int32_t)(ctx->raw_count - 1);
+                if (lx->indent_scopes) {
+                    if (depth < SYM_MAX_DEPTH) {
+                        stack[depth].owner = self;
+                        stack[depth].level = indent;
+                    }
+                    depth++;
+                } else {
+                    pending = self;
+                }
+            }
+            kind = -1;
+            after_word = 0;
+            continue;
+        }
+
+        if (c >= '0' && c <= '9') {
+            while (i < len && is_ident_char((unsigned char)src[i])) i++;
+            kind = -1;
+            continue;
+        }
+
+        /* Punctuation */
+        if (c == '(' && after_word && kind == AC_SYMBOL_FUNCTION && lx->receivers) {
+            int nest = 0;
+            for (; i < len; i++) {
+                if (src[i] == '(') nest++;
+                else if (src[i] == ')' && --nest == 0) break;
+                else if (src[i] == '\n') {
+                    line++;
+                    line_start = i + 1;
+                }
+            }
+            i++;
+            continue;
+        }
+        if ((c == '*' || c == '!') && after_word) {     /* function*, macro_rules! */
+            i++;
+            continue;
+        }
+        if (lx->indent_scopes) {
+            if (c == '(' || c == '[' || c == '{') parens++;
+            else if ((c == ')' || c == ']' || c == '}') && parens > 0) parens--;
+        } else if (c == '{') {
+            int32_t owner = pending >= 0 ? pending : TOP_OWNER();
+            if (depth < SYM_MAX_DEPTH) {
+                stack[depth].owner = owner;
+                stack[depth].level = 0;
+            }
+            depth++;
+            pending = -1;
+        } else if (c == '}') {
+            if (depth > 0) depth--;
+        } else if (c == ';') {
+            pending = -1;
+        }
+        kind = -1;
+        after_word = 0;
+        i++;
+    }
+#undef TOP_OWNER
+}
+
+/*============================================================================
+ * Parsing
+ *============================================================================*/
+
+static parse_ctx_t *ctx_create(const ac_symbol_index_t *idx) {
+    parse_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (!ctx) return NULL;
+    ctx->parser = ts_parser_new();
+    ctx->cursor = ts_query_cursor_new();
+    if (!ctx->parser || !ctx->cursor || !ts_parser_set_language(ctx->parser, idx->c.language)) {
+        if (ctx->parser) ts_parser_delete(ctx->parser);
+        if (ctx->cursor) ts_query_cursor_delete(ctx->cursor);
+        free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+static void ctx_free(parse_ctx_t *ctx) {
+    if (!ctx) return;
+    ts_parser_delete(ctx->parser);
+    ts_query_cursor_delete(ctx->cursor);
+    free(ctx->raw);
+    free(ctx->scopes);
+    free(ctx->remap);
+    free(ctx->buf);
+    free(ctx);
+}
+
+/* Read a file into ctx->buf; returns its length, or -1 if it cannot be indexed */
+static long read_source(const ac_symbol_index_t *idx, parse_ctx_t *ctx, const file_t *f) {
+    char path[SYM_PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/%s", idx->root, f->path) >= (int)sizeof(path)) return -1;
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return -1;
+
+    size_t want = max_file_size(idx) + 1;       /* One extra byte detects growth */
+    size_t hint = (size_t)f->size + 1 < want ? (size_t)f->size + 1 : want;
+    if (hint > ctx->buf_cap) {
+        char *buf = realloc(ctx->buf, hint);
+        if (!buf) {
+            fclose(fp);
+            return -1;
+        }
+        ctx->buf = buf;
+        ctx->buf_cap = hint;
+    }
+    size_t len = fread(ctx->buf, 1, ctx->buf_cap, fp);
+    while (len == ctx->buf_cap && ctx->buf_cap < want) {
+        size_t cap = ctx->buf_cap * 2 < want ? ctx->buf_cap * 2 : want;
+        char *buf = realloc(ctx->buf, cap);
+        if (!buf) break;
+        ctx->buf = buf;
+        ctx->buf_cap = cap;
+        len += fread(ctx->buf + len, 1, cap - len, fp);
+    }
+    fclose(fp);
+    if (len >= want || ac_grep_is_binary(ctx->buf, len)) return -1;
+    return (long)len;
+}
+
+/* Parse one file and replace its symbols; -1 on memory failure */
+static int parse_file(ac_symbol_index_t *idx, parse_ctx_t *ctx, file_t *f, int locked) {
+    ctx->raw_count = 0;
+    ctx->failed = 0;
+
+    long len = read_source(idx, ctx, f);
+    if (len > 0) {
+        const lexer_lang_t *lx = lexer_for((lang_t)f->lang);
+        if (lx) extract_lexical(ctx, lx, ctx->buf, (size_t)len);
+        else extract_c(ctx, &idx->c, ctx->buf, (size_t)len);
+    }
+    if (ctx->failed) return -1;
+
+    sym_t *syms = NULL;
+    if (ctx->raw_count > 0) {
+        syms = malloc(ctx->raw_count * sizeof(sym_t));
+        if (!syms) return -1;
+    }
+
+    if (locked) pthread_mutex_lock(&idx->lock);
+    int rc = 0;
+    for (size_t i = 0; i < ctx->raw_count && rc == 0; i++) {
+        const raw_sym_t *r = &ctx->raw[i];
+        sym_t *s = &syms[i];
+        s->name = strtab_intern(&idx->strings, ctx->buf + r->start, r->len);
+        s->scope = r->scope >= 0 ? syms[r->scope].name : 0;
+        s->line = r->line;
+        s->column = (uint16_t)(r->column > UINT16_MAX ? UINT16_MAX : r->column);
+        s->kind = r->kind;
+        s->role = r->role;
+        if (s->name == NO_ID) rc = -1;
+    }
+    if (locked) pthread_mutex_unlock(&idx->lock);
+
+    if (rc != 0) {
+        free(syms);
+        return -1;
+    }
+    set_syms(f, syms, (uint32_t)ctx->raw_count);
+    return 0;
+}
+
+typedef struct {
+    ac_symbol_index_t *idx;
+    const uint32_t *ids;
+    size_t count;
+    size_t next;
+    int failed;
+} parse_job_t;
+
+static void *parse_worker(void *arg) {
+    parse_job_t *job = (parse_job_t *)arg;
+    parse_ctx_t *ctx = ctx_create(job->idx);
+    if (!ctx) {
+        __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    for (;;) {
+        size_t i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (i >= job->count) break;
+        if (parse_file(job->idx, ctx, &job->idx->files[job->ids[i]], 1) != 0) {
+            __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+        }
+    }
+    ctx_free(ctx);
+    return NULL;
+}
+
+static int default_threads(void) {
+    long n = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (n < 1) n = 1;
+    return n > SYM_MAX_THREADS ? SYM_MAX_THREADS : (int)n;
+}
+
+/* Parse files by id; a few on the calling thread, many on a pool */
+static arc_err_t parse_files(ac_symbol_index_t *idx, const uint32_t *ids, size_t count) {
+    if (count == 0) return ARC_OK;
+    idx->parsed += count;
+
+    size_t threads = (size_t)default_threads();
+    if (threads > count / SYM_FILES_PER_THREAD) threads = count / SYM_FILES_PER_THREAD;
+    if (threads <= 1) {
+        if (!idx->ctx) idx->ctx = ctx_create(idx);
+        if (!idx->ctx) return ARC_ERR_NO_MEMORY;
+        for (size_t i = 0; i < count; i++) {
+            if (parse_file(idx, idx->ctx, &idx->files[ids[i]], 0) != 0) return ARC_ERR_NO_MEMORY;
+        }
+        return ARC_OK;
+    }
+
+    parse_job_t job = { idx, ids, count, 0, 0 };
+    pthread_t tids[SYM_MAX_THREADS];
+    size_t started = 0;
+    for (; started < threads - 1; started++) {
+        if (pthread_create(&tids[started], NULL, parse_worker, &job) != 0) break;
+    }
+    parse_worker(&job);
+    for (size_t i = 0; i < started; i++) pthread_join(tids[i], NULL);
+    return job.failed ? ARC_ERR_NO_MEMORY : ARC_OK;
+}
+
+/*============================================================================
+ * Postings
+ *============================================================================*/
+
+/* Drop removed files, renumbering the rest */
+static int compact_files(ac_symbol_index_t *idx) {
+    size_t n = 0;
+    for (size_t i = 0; i < idx->file_count; i++) {
+        file_t *f = &idx->files[i];
+        if (f->removed) {
+            free(f->path);
+            if (f->owned) free(f->syms);
+            continue;
+        }
+        idx->files[n++] = *f;
+    }
+    if (n == idx->file_count) return 0;
+    idx->file_count = n;
+    return path_map_grow(idx);
+}
+
+static arc_err_t build_postings(ac_symbol_index_t *idx) {
+    if (compact_files(idx) != 0) return ARC_ERR_NO_MEMORY;
+
+    uint32_t names = idx->strings.count;
+    size_t total = 0;
+    for (size_t i = 0; i < idx->file_count; i++) total += idx->files[i].count;
+
+    uint32_t *start = calloc((size_t)names + 1, sizeof(uint32_t));
+    post_t *posts = malloc((total ? total : 1) * sizeof(post_t));
+    if (!start || !posts || total > UINT32_MAX) {
+        free(start);
+        free(posts);
+        return ARC_ERR_NO_MEMORY;
+    }
+    for (size_t i = 0; i < idx->file_count; i++) {
+        const file_t *f = &idx->files[i];
+        for (uint32_t k = 0; k < f->count; k++) start[f->syms[k].name + 1]++;
+    }
+    for (uint32_t id = 0; id < names; id++) start[id + 1] += start[id];
+    for (size_t i = 0; i < idx->file_count; i++) {
+        file_t *f = &idx->files[i];
+        for (uint32_t k = 0; k < f->count; k++) {
+            post_t *p = &posts[start[f->syms[k].name]++];
+            p->file = (uint32_t)i;
+            p->sym = k;
+        }
+        f->fresh = 0;
+    }
+    /* start[id] now holds the end of id's list: shift back */
+    memmove(start + 1, start, (size_t)names * sizeof(uint32_t));
+    start[0] = 0;
+
+    free(idx->post_start);
+    free(idx->posts);
+    idx->post_start = start;
+    idx->posts = posts;
+    idx->post_names = names;
+    idx->fresh = 0;
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Persistence
+ *============================================================================*/
+
+static size_t align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static int region_ok(uint64_t off, uint64_t len, size_t size) {
+    return off <= size && len <= size - off;
+}
+
+/* Load the index file; -1 if missing or unusable (then everything is parsed) */
+static int load_index(ac_symbol_index_t *idx) {
+    FILE *fp = fopen(idx->index_path, "rb");
+    if (!fp) return -1;
+    struct stat st;
+    if (fstat(fileno(fp), &st) != 0 || (size_t)st.st_size < sizeof(index_header_t)) {
+        fclose(fp);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    unsigned char *data = malloc(size);
+    int ok = data && fread(data, 1, size, fp) == size;
+    fclose(fp);
+
+    const index_header_t *h = (const index_header_t *)data;
+    size_t root_len = strlen(idx->root);
+    uint64_t files_off = align8(sizeof(*h) + root_len);
+    uint64_t syms_off = files_off + (ok ? (uint64_t)h->file_count * sizeof(index_file_t) : 0);
+    uint64_t offs_off = ok ? syms_off + h->symbol_count * sizeof(sym_t) : 0;
+    uint64_t strings_off = ok ? offs_off + (uint64_t)h->string_count * sizeof(uint32_t) : 0;
+    uint64_t paths_off = ok ? strings_off + h->strings_len : 0;
+    ok = ok && memcmp(h->magic, SYM_MAGIC, 8) == 0 && h->version == SYM_VERSION &&
+         h->total_size == size && h->root_len == root_len &&
+         memcmp(data + sizeof(*h), idx->root, root_len) == 0 &&
+         h->string_count > 0 && h->symbol_count <= size / sizeof(sym_t) &&
+         h->strings_len <= size && h->paths_len <= size &&
+         (uint64_t)h->file_count <= size / sizeof(index_file_t) &&
+         (uint64_t)h->string_count <= size / sizeof(uint32_t) &&
+         region_ok(paths_off, h->paths_len, size) && h->strings_len > 0 &&
+         data[strings_off + h->strings_len - 1] == '\0';
+    if (!ok) {
+        free(data);
+        return -1;
+    }
+
+    /* Strings: interning them in order gives the same ids */
+    const uint32_t *offs = (const uint32_t *)(data + offs_off);
+    const char *strings = (const char *)(data + strings_off);
+    for (uint32_t id = 0; ok && id < h->string_count; id++) {
+        ok = offs[id] < h->strings_len;
+        if (ok) {
+            const char *s = strings + offs[id];
+            ok = strtab_intern(&idx->strings, s, strlen(s)) == id;
+        }
+    }
+
+    const index_file_t *files = (const index_file_t *)(data + files_off);
+    const char *paths = (const char *)(data + paths_off);
+    sym_t *syms = (sym_t *)(data + syms_off);
+    uint64_t next = 0;
+    char path[SYM_PATH_MAX];
+    for (uint32_t i = 0; ok && i < h->file_count; i++) {
+        const index_file_t *df = &files[i];
+        ok = region_ok(df->path_off, df->path_len, h->paths_len) && df->path_len < sizeof(path) &&
+             df->count <= h->symbol_count - next;
+        if (!ok) break;
+        memcpy(path, paths + df->path_off, df->path_len);
+        path[df->path_len] = '\0';
+        uint32_t id = add_file(idx, path, (lang_t)df->lang);
+        ok = id != NO_ID;
+        if (!ok) break;
+        file_t *f = &idx->files[id];
+        f->size = df->size;
+        f->mtime_ns = df->mtime_ns;
+        f->syms = syms + next;
+        f->count = df->count;
+        for (uint32_t k = 0; ok && k < f->count; k++) {
+            ok = f->syms[k].name < h->string_count && f->syms[k].scope < h->string_count;
+        }
+        next += df->count;
+    }
+    if (!ok) {
+        for (size_t i = 0; i < idx->file_count; i++) free(idx->files[i].path);
+        idx->file_count = 0;
+        idx->fresh = 0;
+        free(idx->path_slots);
+        idx->path_slots = NULL;
+        strtab_free(&idx->strings);
+        strtab_intern(&idx->strings, "", 0);
+        free(data);
+        return -1;
+    }
+    idx->loaded = data;
+    idx->index_bytes = size;
+    return 0;
+}
+
+static arc_err_t write_index(ac_symbol_index_t *idx) {
+    size_t root_len = strlen(idx->root);
+    index_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SYM_MAGIC, 8);
+    hdr.version = SYM_VERSION;
+    hdr.string_count = idx->strings.count;
+    hdr.root_len = (uint32_t)root_len;
+    hdr.strings_len = idx->strings.len;
+
+    index_file_t *files = malloc((idx->file_count ? idx->file_count : 1) * sizeof(*files));
+    if (!files) return ARC_ERR_NO_MEMORY;
+    size_t n = 0;
+    for (size_t i = 0; i < idx->file_count; i++) {
+        const file_t *f = &idx->files[i];
+        if (f->removed) continue;
+        size_t len = strlen(f->path);
+        files[n].size = f->size;
+        files[n].mtime_ns = f->mtime_ns;
+        files[n].path_off = (uint32_t)hdr.paths_len;
+        files[n].path_len = (uint32_t)len;
+        files[n].count = f->count;
+        files[n].lang = f->lang;
+        hdr.paths_len += len;
+        hdr.symbol_count += f->count;
+        n++;
+    }
+    hdr.file_count = (uint32_t)n;
+    size_t pad = align8(sizeof(hdr) + root_len) - sizeof(hdr) - root_len;
+    hdr.total_size = sizeof(hdr) + root_len + pad + n * sizeof(index_file_t) +
+                     hdr.symbol_count * sizeof(sym_t) + (uint64_t)hdr.string_count * sizeof(uint32_t) +
+                     hdr.strings_len + hdr.paths_len;
+
+    char tmp[SYM_PATH_MAX + 32];
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", idx->index_path, (int)getpid());
+    FILE *fp = fopen(tmp, "wb");
+    int ok = fp != NULL;
+    if (ok) {
+        static const char zeros[8] = {0};
+        ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+             fwrite(idx->root, 1, root_len, fp) == root_len &&
+             fwrite(zeros, 1, pad, fp) == pad &&
+             (n == 0 || fwrite(files, sizeof(*files), n, fp) == n);
+        for (size_t i = 0; ok && i < idx->file_count; i++) {
+            const file_t *f = &idx->files[i];
+            if (!f->removed && f->count > 0) ok = fwrite(f->syms, sizeof(sym_t), f->count, fp) == f->count;
+        }
+        ok = ok && fwrite(idx->strings.offs, sizeof(uint32_t), idx->strings.count, fp) == idx->strings.count &&
+             fwrite(idx->strings.data, 1, idx->strings.len, fp) == idx->strings.len;
+        for (size_t i = 0; ok && i < idx->file_count; i++) {
+            const file_t *f = &idx->files[i];
+            if (f->removed) continue;
+            size_t len = strlen(f->path);
+            ok = fwrite(f->path, 1, len, fp) == len;
+        }
+        ok = (fclose(fp) == 0) && ok;
+    }
+    if (ok) {
+#if defined(_WIN32)
+        remove(idx->index_path);
+#endif
+        ok = rename(tmp, idx->index_path) == 0;
+    }
+    if (!ok) remove(tmp);
+    free(files);
+
+    if (!ok) {
+        AC_LOG_WARN("symbol index: cannot write %s", idx->index_path);
+        return ARC_ERR_IO;
+    }
+    idx->index_bytes = (size_t)hdr.total_size;
+    idx->changed = 0;
+    idx->writes++;
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Watching
+ *============================================================================*/
+
+static void mark_dirty(ac_symbol_index_t *idx, uint32_t id) {
+    file_t *f = &idx->files[id];
+    if (f->dirty) return;
+    if (idx->dirty_count == idx->dirty_cap) {
+        size_t cap = idx->dirty_cap ? idx->dirty_cap * 2 : 64;
+        uint32_t *dirty = realloc(idx->dirty, cap * sizeof(uint32_t));
+        if (!dirty) {
+            idx->need_check = 1;
+            return;
+        }
+        idx->dirty = dirty;
+        idx->dirty_cap = cap;
+    }
+    idx->dirty[idx->dirty_count++] = id;
+    f->dirty = 1;
+}
+
+static int on_watch_event(void *user_data, const char *rel, size_t len, unsigned int flags) {
+    ac_symbol_index_t *idx = (ac_symbol_index_t *)user_data;
+    if (path_lang(rel) == LANG_NONE) return 0;
+
+    uint32_t id = find_file(idx, rel, len);
+    if (id != NO_ID && !idx->files[id].removed) {
+        mark_dirty(idx, id);
+        return 0;
+    }
+    /* Possibly a new file: the walk applies the ignore rules */
+    return (flags & (AC_TREE_CREATED | AC_TREE_WRITTEN)) != 0;
+}
+
+static void drain_events(ac_symbol_index_t *idx) {
+    if (ac_tree_watch_drain(&idx->watch, on_watch_event, idx)) idx->need_check = 1;
+}
+
+/*============================================================================
+ * Updating
+ *============================================================================*/
+
+typedef struct {
+    ac_symbol_index_t *idx;
+    uint32_t *ids;                      /* Files to parse */
+    size_t count;
+    size_t cap;
+    int failed;
+} check_t;
+
+static int queue_parse(check_t *c, uint32_t id) {
+    if (c->count == c->cap) {
+        size_t cap = c->cap ? c->cap * 2 : 256;
+        uint32_t *ids = realloc(c->ids, cap * sizeof(uint32_t));
+        if (!ids) return -1;
+        c->ids = ids;
+        c->cap = cap;
+    }
+    c->ids[c->count++] = id;
+    return 0;
+}
+
+/* Note a file's current size and mtime; queue it if it changed */
+static int update_file(check_t *c, uint32_t id, const struct stat *st) {
+    ac_symbol_index_t *idx = c->idx;
+    file_t *f = &idx->files[id];
+    f->seen = idx->gen;
+    uint64_t size = (uint64_t)st->st_size;
+    int64_t mtime = ac_stat_mtime_ns(st);
+    if (!f->removed && !f->dirty && f->size == size && f->mtime_ns == mtime) {
+        return 0;
+    }
+    f->size = size;
+    f->mtime_ns = mtime;
+    f->removed = 0;
+    f->dirty = 0;
+    mark_fresh(idx, f);
+    return queue_parse(c, id);
+}
+
+static int check_entry(const ac_walk_entry_t *entry, void *user_data) {
+    check_t *c = (check_t *)user_data;
+    ac_symbol_index_t *idx = c->idx;
+
+    if (entry->type == AC_WALK_DIR) {
+        ac_tree_watch_dir(&idx->watch, entry->path, entry->rel_path);
+        return AC_WALK_CONTINUE;
+    }
+    if (entry->type != AC_WALK_FILE) return AC_WALK_CONTINUE;
+    lang_t lang = path_lang(entry->rel_path);
+    if (lang == LANG_NONE) return AC_WALK_CONTINUE;
+
+    struct stat st;
+    if (stat(entry->path, &st) != 0 || (size_t)st.st_size > max_file_size(idx)) return AC_WALK_CONTINUE;
+
+    uint32_t id = find_file(idx, entry->rel_path, strlen(entry->rel_path));
+    if (id == NO_ID) id = add_file(idx, entry->rel_path, lang);
+    if (id == NO_ID || update_file(c, id, &st) != 0) {
+        c->failed = 1;
+        return AC_WALK_STOP;
+    }
+    return AC_WALK_CONTINUE;
+}
+
+/* Walk the tree: parse new and changed files, drop vanished ones */
+static arc_err_t check(ac_symbol_index_t *idx) {
+    check_t c = { idx, NULL, 0, 0, 0 };
+    idx->gen++;
+    ac_tree_watch_root(&idx->watch, idx->root);
+
+    ac_walk_options_t walk = {
+        .ignore_globs = idx->opts.ignore_globs,
+        .ignore_globs_count = idx->opts.ignore_globs_count,
+    };
+    arc_err_t err = ac_walk(idx->root, &walk, check_entry, &c);
+    if (err == ARC_OK && c.failed) err = ARC_ERR_NO_MEMORY;
+    if (err == ARC_OK) {
+        for (size_t i = 0; i < idx->file_count; i++) {
+            file_t *f = &idx->files[i];
+            if (f->seen != idx->gen) remove_file(idx, f);
+            f->dirty = 0;
+        }
+        idx->dirty_count = 0;
+        idx->need_check = 0;
+        err = parse_files(idx, c.ids, c.count);
+    }
+    free(c.ids);
+    return err;
+}
+
+/* Parse the files inotify reported */
+static arc_err_t apply_dirty(ac_symbol_index_t *idx) {
+    check_t c = { idx, NULL, 0, 0, 0 };
+    char path[SYM_PATH_MAX];
+    int failed = 0;
+    for (size_t i = 0; i < idx->dirty_count && !failed; i++) {
+        file_t *f = &idx->files[idx->dirty[i]];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", idx->root, f->path);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size > max_file_size(idx)) {
+            f->dirty = 0;
+            remove_file(idx, f);
+            continue;
+        }
+        failed = update_file(&c, idx->dirty[i], &st) != 0;
+    }
+    for (size_t i = 0; i < idx->dirty_count; i++) idx->files[idx->dirty[i]].dirty = 0;
+    idx->dirty_count = 0;
+    arc_err_t err = failed ? ARC_ERR_NO_MEMORY : parse_files(idx, c.ids, c.count);
+    free(c.ids);
+    return err;
+}
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+arc_err_t ac_symbol_index_open(
+    const char *root,
+    const ac_symbol_index_options_t *options,
+    ac_symbol_index_t **out
+) {
+    if (!root || !out) return ARC_ERR_INVALID_ARG;
+    *out = NULL;
+
+    char real[SYM_PATH_MAX];
+    struct stat st;
+    if (!realpath(root, real) || stat(real, &st) != 0 || !S_ISDIR(st.st_mode)) return ARC_ERR_IO;
+
+    char dir[SYM_PATH_MAX];
+    if (ac_index_cache_dir(options ? options->cache_dir : NULL, dir, sizeof(dir)) != 0) {
+        return ARC_ERR_IO;
+    }
+
+    ac_symbol_index_t *idx = calloc(1, sizeof(*idx));
+    if (!idx) return ARC_ERR_NO_MEMORY;
+    idx->watch.fd = -1;
+    pthread_mutex_init(&idx->lock, NULL);
+    if (options) idx->opts = *options;
+    idx->root = strdup(real);
+    char name[SYM_PATH_MAX + 32];
+    snprintf(name, sizeof(name), "%s/%016llx.sym", dir,
+             (unsigned long long)hash_bytes(real, strlen(real)));
+    idx->index_path = strdup(name);
+    if (!idx->root || !idx->index_path || strtab_intern(&idx->strings, "", 0) != 0) {
+        ac_symbol_index_close(idx);
+        return ARC_ERR_NO_MEMORY;
+    }
+    if (ts_lang_init(&idx->c) != 0) {
+        ac_symbol_index_close(idx);
+        return ARC_ERR_INVALID_STATE;
+    }
+
+    ac_tree_watch_init(&idx->watch, "symbol index", idx->opts.watch);
+
+    load_index(idx);                    /* Missing or unusable: everything is parsed */
+    idx->changed = 0;
+    arc_err_t err = check(idx);
+    if (err == ARC_OK) err = build_postings(idx);
+    if (err == ARC_OK && idx->changed > 0) write_index(idx);    /* A failed write only costs the next open */
+    if (err != ARC_OK) {
+        ac_symbol_index_close(idx);
+        return err;
+    }
+    *out = idx;
+    return ARC_OK;
+}
+
+arc_err_t ac_symbol_index_refresh(ac_symbol_index_t *index) {
+    if (!index) return ARC_ERR_INVALID_ARG;
+
+    arc_err_t err;
+    if (index->watch.fd >= 0) drain_events(index);
+    if (index->watch.fd >= 0 && !index->need_check) err = apply_dirty(index);
+    else err = check(index);
+
+    if (err == ARC_OK && index->fresh > change_limit(index)) err = build_postings(index);
+    if (err == ARC_OK && index->changed > change_limit(index)) write_index(index);
+    return err;
+}
+
+arc_err_t ac_symbol_index_save(ac_symbol_index_t *index) {
+    if (!index) return ARC_ERR_INVALID_ARG;
+    return index->changed > 0 ? write_index(index) : ARC_OK;
+}
+
+typedef struct {
+    const file_t *file;
+    const sym_t *sym;
+} hit_t;
+
+typedef struct {
+    hit_t *hits;
+    size_t count;
+    size_t cap;
+} hits_t;
+
+static int hits_add(hits_t *h, const file_t *file, const sym_t *sym) {
+    if (h->count == h->cap) {
+        size_t cap = h->cap ? h->cap * 2 : 64;
+        hit_t *hits = realloc(h->hits, cap * sizeof(*hits));
+        if (!hits) return -1;
+        h->hits = hits;
+        h->cap = cap;
+    }
+    h->hits[h->count].file = file;
+    h->hits[h->count].sym = sym;
+    h->count++;
+    return 0;
+}
+
+static int compare_hits(const void *a, const void *b) {
+    const hit_t *x = a, *y = b;
+    if (x->sym->role != y->sym->role) return x->sym->role < y->sym->role ? -1 : 1;
+    if (x->file != y->file) {
+        int c = strcmp(x->file->path, y->file->path);
+        if (c != 0) return c;
+    }
+    if (x->sym->line != y->sym->line) return x->sym->line < y->sym->line ? -1 : 1;
+    return (x->sym->column > y->sym->column) - (x->sym->column < y->sym->column);
+}
+
+/* Copy hits into a result, strings included */
+static arc_err_t make_result(const ac_symbol_index_t *idx, const hits_t *h, size_t limit,
+                             ac_symbol_result_t *result) {
+    size_t n = limit && h->count > limit ? limit : h->count;
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; i++) {
+        bytes += strlen(h->hits[i].file->path) + 1;
+        bytes += strlen(str_at(&idx->strings, h->hits[i].sym->name)) + 1;
+        bytes += strlen(str_at(&idx->strings, h->hits[i].sym->scope)) + 1;
+    }
+    result->symbols = calloc(n ? n : 1, sizeof(ac_symbol_t));
+    result->strings = malloc(bytes ? bytes : 1);
+    if (!result->symbols || !result->strings) {
+        ac_symbol_result_free(result);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    char *p = result->strings;
+    const char *prev_path = NULL;
+    for (size_t i = 0; i < n; i++) {
+        const hit_t *hit = &h->hits[i];
+        ac_symbol_t *s = &result->symbols[i];
+        const char *strs[3] = {
+            hit->file->path,
+            str_at(&idx->strings, hit->sym->name),
+            str_at(&idx->strings, hit->sym->scope),
+        };
+        const char **dst[3] = { &s->path, &s->name, &s->scope };
+        for (int k = 0; k < 3; k++) {
+            if (k == 0 && prev_path && i > 0 && h->hits[i - 1].file == hit->file) {
+                s->path = prev_path;
+                continue;
+            }
+            size_t len = strlen(strs[k]);
+            memcpy(p, strs[k], len + 1);
+            *dst[k] = p;
+            p += len + 1;
+        }
+        prev_path = s->path;
+        s->line = hit->sym->line + 1;
+        s->column = (unsigned)hit->sym->column + 1;
+        s->kind = (ac_symbol_kind_t)hit->sym->kind;
+        s->role = hit->sym->role;
+    }
+    result->count = n;
+    result->total = h->count;
+    return ARC_OK;
+}
+
+static int id_in(const uint32_t *ids, size_t count, uint32_t id) {
+    for (size_t i = 0; i < count; i++) {
+        if (ids[i] == id) return 1;
+    }
+    return 0;
+}
+
+arc_err_t ac_symbol_index_find(
+    ac_symbol_index_t *index,
+    const char *name,
+    int flags,
+    size_t limit,
+    ac_symbol_result_t *result
+) {
+    if (!result) return ARC_ERR_INVALID_ARG;
+    memset(result, 0, sizeof(*result));
+    if (!index || !name || !name[0]) return ARC_ERR_INVALID_ARG;
+
+    /* A failed update still leaves the last state to answer from */
+    if (ac_symbol_index_refresh(index) == ARC_ERR_NO_MEMORY) return ARC_ERR_NO_MEMORY;
+
+    int roles = flags & AC_SYMBOL_ALL;
+    if (!roles) roles = AC_SYMBOL_ALL;
+
+    uint32_t *ids = NULL;
+    size_t nids = 0;
+    uint32_t exact = NO_ID;
+    if (flags & AC_SYMBOL_IGNORE_CASE) {
+        size_t cap = 0;
+        for (uint32_t id = 1; id < index->strings.count; id++) {
+            if (strcasecmp(str_at(&index->strings, id), name) != 0) continue;
+            if (nids == cap) {
+                cap = cap ? cap * 2 : 8;
+                uint32_t *grown = realloc(ids, cap * sizeof(uint32_t));
+                if (!grown) {
+                    free(ids);
+                    return ARC_ERR_NO_MEMORY;
+                }
+                ids = grown;
+            }
+            ids[nids++] = id;
+        }
+    } else {
+        exact = strtab_find(&index->strings, name, strlen(name));
+        if (exact != NO_ID) {
+            ids = &exact;
+            nids = 1;
+        }
+    }
+
+    hits_t h = { NULL, 0, 0 };
+    int failed = 0;
+    for (size_t k = 0; k < nids && !failed; k++) {
+        if (ids[k] >= index->post_names) continue;
+        for (uint32_t p = index->post_start[ids[k]]; p < index->post_start[ids[k] + 1] && !failed; p++) {
+            const file_t *f = &index->files[index->posts[p].file];
+            if (f->fresh) continue;
+            const sym_t *s = &f->syms[index->posts[p].sym];
+            if (s->role & roles) failed = hits_add(&h, f, s) != 0;
+        }
+    }
+    for (size_t i = 0; i < index->file_count && nids > 0 && !failed; i++) {
+        const file_t *f = &index->files[i];
+        if (!f->fresh) continue;
+        for (uint32_t k = 0; k < f->count && !failed; k++) {
+            const sym_t *s = &f->syms[k];
+            if ((s->role & roles) && id_in(ids, nids, s->name)) failed = hits_add(&h, f, s) != 0;
+        }
+    }
+    if (flags & AC_SYMBOL_IGNORE_CASE) free(ids);
+
+    arc_err_t err = ARC_ERR_NO_MEMORY;
+    if (!failed) {
+        qsort(h.hits, h.count, sizeof(hit_t), compare_hits);
+        err = make_result(index, &h, limit, result);
+    }
+    free(h.hits);
+    return err;
+}
+
+arc_err_t ac_symbol_index_file_symbols(
+    ac_symbol_index_t *index,
+    const char *path,
+    ac_symbol_result_t *result
+) {
+    if (!result) return ARC_ERR_INVALID_ARG;
+    memset(result, 0, sizeof(*result));
+    if (!index || !path) return ARC_ERR_INVALID_ARG;
+
+    if (ac_symbol_index_refresh(index) == ARC_ERR_NO_MEMORY) return ARC_ERR_NO_MEMORY;
+
+    uint32_t id = find_file(index, path, strlen(path));
+    if (id == NO_ID || index->files[id].removed) return ARC_ERR_NOT_FOUND;
+
+    const file_t *f = &index->files[id];
+    hits_t h = { NULL, 0, 0 };
+    for (uint32_t k = 0; k < f->count; k++) {
+        if (f->syms[k].role == AC_SYMBOL_REFERENCE) continue;
+        if (hits_add(&h, f, &f->syms[k]) != 0) {
+            free(h.hits);
+            return ARC_ERR_NO_MEMORY;
+        }
+    }
+    arc_err_t err = make_result(index, &h, 0, result);
+    free(h.hits);
+    return err;
+}
+
+void ac_symbol_result_free(ac_symbol_result_t *result) {
+    if (!result) return;
+    free(result->symbols);
+    free(result->strings);
+    memset(result, 0, sizeof(*result));
+}
+
+void ac_symbol_index_stats(const ac_symbol_index_t *index, ac_symbol_index_stats_t *stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!index) return;
+    for (size_t i = 0; i < index->file_count; i++) {
+        if (index->files[i].removed) continue;
+        stats->files++;
+        stats->symbols += index->files[i].count;
+    }
+    stats->names = index->strings.count - 1;
+    stats->index_bytes = index->index_bytes;
+    stats->parsed = index->parsed;
+    stats->writes = index->writes;
+    stats->watching = index->watch.fd >= 0;
+}
+
+const char *ac_symbol_kind_name(ac_symbol_kind_t kind) {
+    static const char *const names[] = {
+        "function", "variable", "parameter", "field", "struct", "union",
+        "enum", "enumerator", "typedef", "macro", "class", "name",
+    };
+    return (unsigned)kind < sizeof(names) / sizeof(names[0]) ? names[kind] : "name";
+}
+
+const char *ac_symbol_index_root(const ac_symbol_index_t *index) {
+    return index ? index->root : NULL;
+}
+
+void ac_symbol_index_close(ac_symbol_index_t *index) {
+    if (!index) return;
+    if (index->changed > 0 && index->posts) write_index(index);
+    ac_tree_watch_stop(&index->watch);
+    for (size_t i = 0; i < index->file_count; i++) {
+        free(index->files[i].path);
+        if (index->files[i].owned) free(index->files[i].syms);
+    }
+    free(index->files);
+    free(index->path_slots);
+    free(index->loaded);
+    free(index->post_start);
+    free(index->posts);
+    free(index->dirty);
+    ctx_free(index->ctx);
+    ts_lang_free(&index->c);
+    strtab_free(&index->strings);
+    pthread_mutex_destroy(&index->lock);
+    free(index->root);
+    free(index->index_path);
+    free(index);
+}
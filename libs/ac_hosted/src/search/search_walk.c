@@ -0,0 +1,665 @@
+/**
+ * @file search_walk.c
+ * @brief Parallel, gitignore-aware directory walker
+ *
+ * Every directory is a job: a thread reads it, loads its ignore files,
+ * filters and sorts its entries and queues its subdirectories as new
+ * jobs. The queue is a stack with the first subdirectory on top, so the
+ * readers run roughly along the order the caller consumes entries in.
+ *
+ * The calling thread emits entries depth first. When it reaches a
+ * directory no reader has picked up yet it reads the directory itself,
+ * so a walk with threads = 1 needs no other thread at all. Results are
+ * kept until emitted; everything is freed once the walk ends.
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include <arc/walk.h>
+#include "search_internal.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(_WIN32)
+#define realpath(name, resolved) _fullpath((resolved), (name), 4096)
+#define lstat stat
+#endif
+
+#define WALK_MAX_THREADS 8
+#define WALK_PATH_MAX 4096
+
+typedef enum {
+    DIR_QUEUED = 0,
+    DIR_CLAIMED,
+    DIR_DONE,
+} dir_state_t;
+
+typedef struct walk_dir walk_dir_t;
+
+typedef struct {
+    size_t name_off;                    /* Into the directory's name block while reading */
+    const char *name;
+    ac_walk_type_t type;
+    walk_dir_t *child;                  /* Job for a subdirectory to descend into */
+} walk_item_t;
+
+struct walk_dir {
+    char *path;
+    int depth;                          /* Depth of the entries inside */
+    const ac_ignore_t *ignore;          /* Rules inherited from above */
+    int in_repo;                        /* Inside a git repository: .gitignore applies */
+    dir_state_t state;
+    walk_item_t *items;
+    size_t count;
+    char *names;
+    walk_dir_t *parent;
+    dev_t dev;                          /* Only set with follow_links */
+    ino_t ino;
+    walk_dir_t *prev;                   /* Queue links */
+    walk_dir_t *next;
+    walk_dir_t *all_next;               /* Every job, freed at the end */
+};
+
+typedef struct {
+    const ac_walk_options_t *opts;
+    size_t rel_off;                     /* Where relative paths start in full paths */
+    int in_repo;                        /* The root is inside a repository */
+
+    ac_ignore_t *overrides;             /* options->ignore_globs */
+
+    pthread_mutex_t mutex;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    walk_dir_t *queue;
+    walk_dir_t *all;
+    ac_ignore_t **sets;                 /* Every rule set, freed at the end */
+    size_t set_count;
+    size_t set_capacity;
+    int finished;
+} walk_t;
+
+/*============================================================================
+ * Helpers
+ *============================================================================*/
+
+/* dir + "/" + name; 0 if it does not fit */
+static size_t join_path(char *buf, const char *dir, const char *name) {
+    size_t dlen = strlen(dir);
+    int sep = dlen > 0 && dir[dlen - 1] != '/';
+    int n = snprintf(buf, WALK_PATH_MAX, "%s%s%s", dir, sep ? "/" : "", name);
+    return (n < 0 || n >= WALK_PATH_MAX) ? 0 : (size_t)n;
+}
+
+static int path_exists(const char *dir, const char *name) {
+    char path[WALK_PATH_MAX];
+    struct stat st;
+    return join_path(path, dir, name) && stat(path, &st) == 0;
+}
+
+static void register_set(walk_t *w, ac_ignore_t *set) {
+    pthread_mutex_lock(&w->mutex);
+    if (w->set_count == w->set_capacity) {
+        size_t cap = w->set_capacity ? w->set_capacity * 2 : 16;
+        ac_ignore_t **sets = realloc(w->sets, cap * sizeof(*sets));
+        if (sets) {
+            w->sets = sets;
+            w->set_capacity = cap;
+        }
+    }
+    if (w->set_count < w->set_capacity) {
+        w->sets[w->set_count++] = set;
+        set = NULL;
+    }
+    pthread_mutex_unlock(&w->mutex);
+    ac_ignore_free(set);                /* Only if it could not be kept */
+}
+
+/* New rule set from files in dir; NULL if they hold no rules */
+static ac_ignore_t *load_set(walk_t *w, const ac_ignore_t *parent, const char *dir,
+                             const char *const *files, const char *prefix, size_t strip) {
+    ac_ignore_t *set = calloc(1, sizeof(*set));
+    if (!set) return NULL;
+    for (size_t i = 0; files[i]; i++) {
+        char path[WALK_PATH_MAX];
+        if (join_path(path, dir, files[i])) ac_ignore_add_file(set, path);
+    }
+    if (set->count == 0) {
+        ac_ignore_free(set);
+        return NULL;
+    }
+    set->parent = (ac_ignore_t *)parent;
+    set->prefix = prefix && *prefix ? strdup(prefix) : NULL;
+    set->strip = strip;
+    register_set(w, set);
+    return set;
+}
+
+/*============================================================================
+ * Repository and Global Ignores
+ *============================================================================*/
+
+/* core.excludesFile from a git config file */
+static int config_excludes(const char *config, char *out, size_t size) {
+    FILE *f = fopen(config, "r");
+    if (!f) return 0;
+
+    char line[1024];
+    int in_core = 0, found = 0;
+    while (!found && fgets(line, sizeof(line), f)) {
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '[') {
+            in_core = strncasecmp(p, "[core]", 6) == 0;
+            continue;
+        }
+        if (!in_core || strncasecmp(p, "excludesfile", 12) != 0) continue;
+        p += 12;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p++ != '=') continue;
+        while (*p == ' ' || *p == '\t' || *p == '"') p++;
+        size_t len = strcspn(p, "\"\r\n");
+        while (len > 0 && (p[len - 1] == ' ' || p[len - 1] == '\t')) len--;
+        if (len == 0) continue;
+
+        const char *home = getenv("HOME");
+        if (p[0] == '~' && p[1] == '/' && home) {
+            snprintf(out, size, "%s/%.*s", home, (int)(len - 2), p + 2);
+        } else {
+            snprintf(out, size, "%.*s", (int)len, p);
+        }
+        found = 1;
+    }
+    fclose(f);
+    return found;
+}
+
+/* git's global excludes file: core.excludesFile, else XDG git/ignore */
+static int global_excludes_path(char *out, size_t size) {
+    const char *home = getenv("HOME");
+    const char *xdg = getenv("XDG_CONFIG_HOME");
+    char config[WALK_PATH_MAX];
+
+    if (home) {
+        snprintf(config, sizeof(config), "%s/.gitconfig", home);
+        if (config_excludes(config, out, size)) return 1;
+    }
+    if (xdg && *xdg) {
+        snprintf(config, sizeof(config), "%s/git/config", xdg);
+        if (config_excludes(config, out, size)) return 1;
+        snprintf(out, size, "%s/git/ignore", xdg);
+        return 1;
+    }
+    if (home) {
+        snprintf(out, size, "%s/.config/git/ignore", home);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Rules that apply from above the root: global excludes, the
+ * repository's info/exclude, and ignore files of the directories
+ * between the repository top and the root. Returns the chain head.
+ */
+static const ac_ignore_t *load_ancestor_rules(walk_t *w, const char *root) {
+    char real[WALK_PATH_MAX];
+    if (!realpath(root, real)) return NULL;
+
+    /* Find the repository top */
+    char top[WALK_PATH_MAX];
+    snprintf(top, sizeof(top), "%s", real);
+    for (;;) {
+        if (path_exists(top, ".git")) {
+            w->in_repo = 1;
+            break;
+        }
+        char *slash = strrchr(top, '/');
+        if (!slash || slash == top) return NULL;
+        *slash = '\0';
+    }
+
+    size_t top_len = strlen(top);
+    const char *below_top = real[top_len] == '/' ? real + top_len + 1 : "";
+    const ac_ignore_t *chain = NULL;
+    const ac_ignore_t *set;
+
+    char global[WALK_PATH_MAX];
+    if (global_excludes_path(global, sizeof(global))) {
+        const char *dir_end = strrchr(global, '/');
+        if (dir_end) {
+            char dir[WALK_PATH_MAX];
+            snprintf(dir, sizeof(dir), "%.*s", (int)(dir_end - global), global);
+            const char *files[] = { dir_end + 1, NULL };
+            if ((set = load_set(w, chain, dir, files, below_top, 0))) chain = set;
+        }
+    }
+
+    char info[WALK_PATH_MAX];
+    const char *exclude[] = { "exclude", NULL };
+    if (join_path(info, top, ".git/info") &&
+        (set = load_set(w, chain, info, exclude, below_top, 0))) chain = set;
+
+    /* Directories from the top down to the root's parent */
+    const char *ignore_files[] = { ".gitignore", ".ignore", NULL };
+    char dir[WALK_PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", top);
+    const char *rest = below_top;
+    while (*rest) {
+        if ((set = load_set(w, chain, dir, ignore_files, rest, 0))) chain = set;
+        const char *slash = strchr(rest, '/');
+        size_t comp = slash ? (size_t)(slash - rest) : strlen(rest);
+        size_t len = strlen(dir);
+        snprintf(dir + len, sizeof(dir) - len, "/%.*s", (int)comp, rest);
+        rest = slash ? slash + 1 : rest + comp;
+    }
+    return chain;
+}
+
+/*============================================================================
+ * Reading a Directory
+ *============================================================================*/
+
+static ac_walk_type_t type_of(const char *path, int follow) {
+    struct stat st;
+    if ((follow ? stat(path, &st) : lstat(path, &st)) != 0) {
+        return AC_WALK_OTHER;
+    }
+    if (S_ISDIR(st.st_mode)) return AC_WALK_DIR;
+    if (S_ISREG(st.st_mode)) return AC_WALK_FILE;
+#if defined(S_ISLNK)
+    if (S_ISLNK(st.st_mode)) return AC_WALK_SYMLINK;
+#endif
+    return AC_WALK_OTHER;
+}
+
+/* Directory link cycle: target already among the ancestors */
+static int is_loop(const walk_dir_t *d, dev_t dev, ino_t ino) {
+    for (; d; d = d->parent) {
+        if (d->dev == dev && d->ino == ino) return 1;
+    }
+    return 0;
+}
+
+static int compare_items(const void *a, const void *b) {
+    const walk_item_t *x = a, *y = b;
+    return strcmp(x->name, y->name);
+}
+
+static walk_dir_t *new_dir(walk_t *w, walk_dir_t *parent, const char *path, int depth,
+                           const ac_ignore_t *ignore) {
+    walk_dir_t *d = calloc(1, sizeof(*d));
+    if (!d) return NULL;
+    d->path = strdup(path);
+    if (!d->path) {
+        free(d);
+        return NULL;
+    }
+    d->parent = parent;
+    d->depth = depth;
+    d->ignore = ignore;
+    pthread_mutex_lock(&w->mutex);
+    d->all_next = w->all;
+    w->all = d;
+    pthread_mutex_unlock(&w->mutex);
+    return d;
+}
+
+static void read_dir(walk_t *w, walk_dir_t *d) {
+    const ac_walk_options_t *opts = w->opts;
+    walk_item_t *items = NULL;
+    size_t count = 0, cap = 0;
+    char *names = NULL;
+    size_t names_len = 0, names_cap = 0;
+    int has_gitignore = 0, has_ignore = 0;
+    int in_repo = d->in_repo;
+    char path[WALK_PATH_MAX];
+
+    /* The walk may have been stopped; no need to read what nobody emits */
+    pthread_mutex_lock(&w->mutex);
+    int finished = w->finished;
+    pthread_mutex_unlock(&w->mutex);
+
+    DIR *dh = finished ? NULL : opendir(d->path);
+    struct dirent *e;
+    while (dh && (e = readdir(dh)) != NULL) {
+        const char *name = e->d_name;
+        if (name[0] == '.') {
+            if (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')) continue;
+            if (strcmp(name, ".gitignore") == 0) has_gitignore = 1;
+            else if (strcmp(name, ".ignore") == 0) has_ignore = 1;
+            else if (strcmp(name, ".git") == 0) {
+                in_repo = 1;            /* A nested repository starts here */
+                continue;
+            }
+            if (!opts->hidden) continue;
+        }
+
+        ac_walk_type_t type;
+        switch (e->d_type) {
+        case DT_DIR: type = AC_WALK_DIR; break;
+        case DT_REG: type = AC_WALK_FILE; break;
+#if defined(DT_LNK)
+        case DT_LNK: type = AC_WALK_SYMLINK; break;
+#endif
+        case DT_UNKNOWN:
+            type = join_path(path, d->path, name) ? type_of(path, 0) : AC_WALK_OTHER;
+            break;
+        default: type = AC_WALK_OTHER; break;
+        }
+        if (type == AC_WALK_SYMLINK && opts->follow_links && join_path(path, d->path, name)) {
+            ac_walk_type_t target = type_of(path, 1);
+            if (target == AC_WALK_DIR || target == AC_WALK_FILE) type = target;
+        }
+
+        size_t len = strlen(name) + 1;
+        if (count == cap) {
+            size_t ncap = cap ? cap * 2 : 64;
+            walk_item_t *grown = realloc(items, ncap * sizeof(*items));
+            if (!grown) break;
+            items = grown;
+            cap = ncap;
+        }
+        if (names_len + len > names_cap) {
+            size_t ncap = names_cap ? names_cap * 2 : 2048;
+            while (ncap < names_len + len) ncap *= 2;
+            char *grown = realloc(names, ncap);
+            if (!grown) break;
+            names = grown;
+            names_cap = ncap;
+        }
+        memcpy(names + names_len, name, len);
+        items[count].name_off = names_len;
+        items[count].type = type;
+        items[count].child = NULL;
+        count++;
+        names_len += len;
+    }
+    if (dh) closedir(dh);
+    for (size_t i = 0; i < count; i++) {
+        items[i].name = names + items[i].name_off;
+    }
+
+    /* This directory's own ignore files come before the inherited rules */
+    const char *rel_dir = strlen(d->path) > w->rel_off ? d->path + w->rel_off : "";
+    const ac_ignore_t *rules = d->ignore;
+    if (!opts->no_ignore && ((has_gitignore && in_repo) || has_ignore)) {
+        const char *files[3] = { NULL, NULL, NULL };
+        size_t n = 0;
+        if (has_gitignore && in_repo) files[n++] = ".gitignore";
+        if (has_ignore) files[n++] = ".ignore";
+        size_t strip = *rel_dir ? strlen(rel_dir) + 1 : 0;
+        const ac_ignore_t *set = load_set(w, rules, d->path, files, NULL, strip);
+        if (set) rules = set;
+    }
+
+    /* Drop ignored entries */
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        const char *name = items[i].name;
+        size_t len = join_path(path, d->path, name);
+        if (!len) continue;
+        const char *rel = path + w->rel_off;
+        size_t rel_len = len - w->rel_off;
+        int is_dir = items[i].type == AC_WALK_DIR;
+        if (w->overrides && ac_ignore_match(w->overrides, rel, rel_len, name, is_dir)) continue;
+        if (rules && ac_ignore_match(rules, rel, rel_len, name, is_dir)) continue;
+        items[kept++] = items[i];
+    }
+    count = kept;
+
+    if (count > 1) qsort(items, count, sizeof(*items), compare_items);
+
+    /* Jobs for the subdirectories */
+    int descend = opts->max_depth <= 0 || d->depth < opts->max_depth;
+    for (size_t i = 0; descend && i < count; i++) {
+        if (items[i].type != AC_WALK_DIR) continue;
+        if (!join_path(path, d->path, items[i].name)) continue;
+        if (opts->descend && !opts->descend(path + w->rel_off, opts->descend_ctx)) continue;
+        walk_dir_t *child = new_dir(w, d, path, d->depth + 1, rules);
+        if (!child) continue;
+        child->in_repo = in_repo;
+        if (opts->follow_links) {
+            struct stat st;
+            if (stat(path, &st) != 0 || is_loop(d, st.st_dev, st.st_ino)) continue;
+            child->dev = st.st_dev;
+            child->ino = st.st_ino;
+        }
+        items[i].child = child;
+    }
+
+    pthread_mutex_lock(&w->mutex);
+    for (size_t i = count; i-- > 0;) {
+        walk_dir_t *child = items[i].child;
+        if (!child) continue;
+        child->prev = NULL;
+        child->next = w->queue;
+        if (w->queue) w->queue->prev = child;
+        w->queue = child;
+    }
+    d->items = items;
+    d->count = count;
+    d->names = names;
+    d->state = DIR_DONE;
+    pthread_cond_broadcast(&w->work);
+    pthread_cond_broadcast(&w->done);
+    pthread_mutex_unlock(&w->mutex);
+}
+
+/* Remove a queued job; called with the mutex held */
+static void unqueue(walk_t *w, walk_dir_t *d) {
+    if (d->prev) d->prev->next = d->next;
+    else w->queue = d->next;
+    if (d->next) d->next->prev = d->prev;
+    d->prev = d->next = NULL;
+}
+
+static void *reader_thread(void *arg) {
+    walk_t *w = (walk_t *)arg;
+    pthread_mutex_lock(&w->mutex);
+    for (;;) {
+        while (!w->queue && !w->finished) {
+            pthread_cond_wait(&w->work, &w->mutex);
+        }
+        if (!w->queue) break;
+        walk_dir_t *d = w->queue;
+        unqueue(w, d);
+        d->state = DIR_CLAIMED;
+        pthread_mutex_unlock(&w->mutex);
+        read_dir(w, d);
+        pthread_mutex_lock(&w->mutex);
+    }
+    pthread_mutex_unlock(&w->mutex);
+    return NULL;
+}
+
+/*============================================================================
+ * Emitting Entries
+ *============================================================================*/
+
+/* Wait for a directory, reading it here if no reader has taken it */
+static void wait_for(walk_t *w, walk_dir_t *d) {
+    pthread_mutex_lock(&w->mutex);
+    while (d->state != DIR_DONE) {
+        if (d->state == DIR_QUEUED) {
+            unqueue(w, d);
+            d->state = DIR_CLAIMED;
+            pthread_mutex_unlock(&w->mutex);
+            read_dir(w, d);
+            pthread_mutex_lock(&w->mutex);
+        } else {
+            pthread_cond_wait(&w->done, &w->mutex);
+        }
+    }
+    pthread_mutex_unlock(&w->mutex);
+}
+
+/* A skipped directory that nobody has read yet is dropped */
+static void cancel(walk_t *w, walk_dir_t *d) {
+    pthread_mutex_lock(&w->mutex);
+    if (d->state == DIR_QUEUED) {
+        unqueue(w, d);
+        d->state = DIR_DONE;
+    }
+    pthread_mutex_unlock(&w->mutex);
+}
+
+static int emit_dir(walk_t *w, walk_dir_t *d, ac_walk_fn on_entry, void *user_data) {
+    wait_for(w, d);
+
+    char path[WALK_PATH_MAX];
+    int rc = AC_WALK_CONTINUE;
+    for (size_t i = 0; i < d->count && rc != AC_WALK_STOP; i++) {
+        const walk_item_t *item = &d->items[i];
+        const char *name = item->name;
+        if (!join_path(path, d->path, name)) continue;
+
+        ac_walk_entry_t entry = {
+            .path = path,
+            .rel_path = path + w->rel_off,
+            .name = name,
+            .type = item->type,
+            .depth = d->depth,
+        };
+        int r = on_entry(&entry, user_data);
+        if (r == AC_WALK_STOP) {
+            rc = AC_WALK_STOP;
+        } else if (item->child) {
+            if (r == AC_WALK_SKIP) cancel(w, item->child);
+            else rc = emit_dir(w, item->child, on_entry, user_data);
+        }
+    }
+
+    free(d->items);
+    free(d->names);
+    d->items = NULL;
+    d->names = NULL;
+    d->count = 0;
+    return rc;
+}
+
+/*============================================================================
+ * Walk
+ *============================================================================*/
+
+static int default_threads(void) {
+    long n = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (n < 1) n = 1;
+    return n > WALK_MAX_THREADS ? WALK_MAX_THREADS : (int)n;
+}
+
+arc_err_t ac_walk(
+    const char *root,
+    const ac_walk_options_t *options,
+    ac_walk_fn on_entry,
+    void *user_data
+) {
+    if (!root || !*root || !on_entry) return ARC_ERR_INVALID_ARG;
+
+    ac_walk_options_t defaults = {0};
+    if (!options) options = &defaults;
+
+    struct stat st;
+    if (stat(root, &st) != 0) return ARC_ERR_IO;
+
+    if (!S_ISDIR(st.st_mode)) {
+        const char *slash = strrchr(root, '/');
+        const char *name = slash ? slash + 1 : root;
+        ac_walk_entry_t entry = {
+            .path = root,
+            .rel_path = name,
+            .name = name,
+            .type = S_ISREG(st.st_mode) ? AC_WALK_FILE : AC_WALK_OTHER,
+            .depth = 0,
+        };
+        on_entry(&entry, user_data);
+        return ARC_OK;
+    }
+
+    /* Without trailing slashes, except for "/" itself */
+    char root_path[WALK_PATH_MAX];
+    snprintf(root_path, sizeof(root_path), "%s", root);
+    size_t root_len = strlen(root_path);
+    while (root_len > 1 && root_path[root_len - 1] == '/') root_path[--root_len] = '\0';
+
+    walk_t w;
+    memset(&w, 0, sizeof(w));
+    w.opts = options;
+    w.rel_off = root_len + (root_path[root_len - 1] == '/' ? 0 : 1);
+    pthread_mutex_init(&w.mutex, NULL);
+    pthread_cond_init(&w.work, NULL);
+    pthread_cond_init(&w.done, NULL);
+
+    if (options->ignore_globs_count > 0) {
+        w.overrides = calloc(1, sizeof(*w.overrides));
+        for (size_t i = 0; w.overrides && i < options->ignore_globs_count; i++) {
+            const char *glob = options->ignore_globs[i];
+            if (glob) ac_ignore_add_rules(w.overrides, glob, strlen(glob));
+        }
+    }
+
+    const ac_ignore_t *inherited = options->no_ignore ? NULL : load_ancestor_rules(&w, root_path);
+
+    arc_err_t err = ARC_OK;
+    walk_dir_t *top = new_dir(&w, NULL, root_path, 1, inherited);
+    if (!top) {
+        err = ARC_ERR_NO_MEMORY;
+    } else {
+        top->in_repo = w.in_repo;
+        top->dev = st.st_dev;
+        top->ino = st.st_ino;
+
+        int threads = options->threads > 0 ? options->threads : default_threads();
+        if (threads > WALK_MAX_THREADS) threads = WALK_MAX_THREADS;
+        pthread_t readers[WALK_MAX_THREADS];
+        int started = 0;
+        for (int i = 0; i < threads - 1; i++) {
+            if (pthread_create(&readers[started], NULL, reader_thread, &w) == 0) started++;
+        }
+
+        pthread_mutex_lock(&w.mutex);
+        w.queue = top;
+        pthread_cond_broadcast(&w.work);
+        pthread_mutex_unlock(&w.mutex);
+        emit_dir(&w, top, on_entry, user_data);
+
+        /* Readers finish whatever is still queued without reading it */
+        pthread_mutex_lock(&w.mutex);
+        w.finished = 1;
+        pthread_cond_broadcast(&w.work);
+        pthread_mutex_unlock(&w.mutex);
+        for (int i = 0; i < started; i++) {
+            pthread_join(readers[i], NULL);
+        }
+    }
+
+    while (w.all) {
+        walk_dir_t *next = w.all->all_next;
+        free(w.all->items);
+        free(w.all->names);
+        free(w.all->path);
+        free(w.all);
+        w.all = next;
+    }
+    for (size_t i = 0; i < w.set_count; i++) {
+        ac_ignore_free(w.sets[i]);
+    }
+    free(w.sets);
+    ac_ignore_free(w.overrides);
+    pthread_mutex_destroy(&w.mutex);
+    pthread_cond_destroy(&w.work);
+    pthread_cond_destroy(&w.done);
+    return err;
+}
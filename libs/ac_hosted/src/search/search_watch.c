@@ -0,0 +1,188 @@
+/**
+ * @file search_watch.c
+ * @brief inotify watches over an indexed tree
+ *
+ * Each watch descriptor maps to the directory it watches, relative to
+ * the root, so an event names a file the way the index stores it.
+ * Directories above the root are kept by absolute path instead: only
+ * their ignore files matter, and a leading '/' tells them apart.
+ */
+
+#include <arc/log.h>
+#include "search_internal.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+#define WATCH_PATH_MAX 4096
+
+/* Files the walk reads ignore rules from */
+static int is_ignore_file(const char *name) {
+    return strcmp(name, ".gitignore") == 0 || strcmp(name, ".ignore") == 0;
+}
+
+void ac_tree_watch_init(ac_tree_watch_t *w, const char *owner, int enable) {
+    memset(w, 0, sizeof(*w));
+    w->fd = -1;
+    w->owner = owner;
+#if defined(__linux__)
+    if (enable) {
+        w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (w->fd < 0) {
+            AC_LOG_WARN("%s: inotify unavailable (%s), checking mtimes instead",
+                        owner, strerror(errno));
+        }
+    }
+#else
+    (void)enable;
+#endif
+}
+
+void ac_tree_watch_stop(ac_tree_watch_t *w) {
+#if defined(__linux__)
+    if (w->fd >= 0) close(w->fd);
+#endif
+    w->fd = -1;
+    for (size_t i = 0; i < w->cap; i++) free(w->dirs[i]);
+    free(w->dirs);
+    w->dirs = NULL;
+    w->cap = 0;
+}
+
+void ac_tree_watch_dir(ac_tree_watch_t *w, const char *path, const char *rel) {
+#if defined(__linux__)
+    if (w->fd < 0) return;
+    int wd = inotify_add_watch(w->fd, path,
+                               IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB |
+                               IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF |
+                               IN_ONLYDIR);
+    if (wd < 0) {
+        AC_LOG_WARN("%s: cannot watch %s (%s), checking mtimes instead",
+                    w->owner, path, strerror(errno));
+        ac_tree_watch_stop(w);
+        return;
+    }
+    if ((size_t)wd >= w->cap) {
+        size_t cap = w->cap ? w->cap : 64;
+        while (cap <= (size_t)wd) cap *= 2;
+        char **dirs = realloc(w->dirs, cap * sizeof(char *));
+        if (!dirs) {
+            ac_tree_watch_stop(w);
+            return;
+        }
+        memset(dirs + w->cap, 0, (cap - w->cap) * sizeof(char *));
+        w->dirs = dirs;
+        w->cap = cap;
+    }
+    free(w->dirs[wd]);
+    w->dirs[wd] = strdup(rel);
+#else
+    (void)w;
+    (void)path;
+    (void)rel;
+#endif
+}
+
+/*
+ * The places above the root whose rules the walk applies: the
+ * directories up to the repository top, and the top's .git/info.
+ */
+static void watch_ancestors(ac_tree_watch_t *w, const char *root) {
+    char top[WATCH_PATH_MAX];
+    char path[WATCH_PATH_MAX];
+    struct stat st;
+    snprintf(top, sizeof(top), "%s", root);
+    for (;;) {
+        int n = snprintf(path, sizeof(path), "%s/.git", top);
+        if (n > 0 && (size_t)n < sizeof(path) && stat(path, &st) == 0) break;
+        char *slash = strrchr(top, '/');
+        if (!slash || slash == top) return;         /* Not in a repository */
+        *slash = '\0';
+    }
+
+    int n = snprintf(path, sizeof(path), "%s/.git/info", top);
+    if (n > 0 && (size_t)n < sizeof(path) && stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        ac_tree_watch_dir(w, path, path);
+    }
+    size_t top_len = strlen(top);
+    snprintf(path, sizeof(path), "%s", root);
+    for (char *slash = strrchr(path, '/'); slash && (size_t)(slash - path) >= top_len;
+         slash = strrchr(path, '/')) {
+        *slash = '\0';
+        ac_tree_watch_dir(w, path, path);
+    }
+}
+
+void ac_tree_watch_root(ac_tree_watch_t *w, const char *root) {
+    if (w->fd < 0) return;
+    ac_tree_watch_dir(w, root, "");
+    watch_ancestors(w, root);
+}
+
+#if defined(__linux__)
+/* Returns nonzero if the tree needs a full walk */
+static int handle_event(ac_tree_watch_t *w, const struct inotify_event *ev,
+                        ac_tree_event_fn on_file, void *user_data) {
+    if (ev->mask & IN_Q_OVERFLOW) return 1;
+    if (ev->wd < 0 || (size_t)ev->wd >= w->cap || !w->dirs[ev->wd]) return 0;
+    if (ev->mask & IN_IGNORED) {
+        free(w->dirs[ev->wd]);
+        w->dirs[ev->wd] = NULL;
+        return 0;
+    }
+    if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) return 1;
+    if (ev->len == 0) return 0;
+
+    /* Changed rules can add or drop any file below */
+    const char *dir = w->dirs[ev->wd];
+    if (is_ignore_file(ev->name) || (dir[0] == '/' && strcmp(ev->name, "exclude") == 0)) return 1;
+    if (dir[0] == '/' || ev->name[0] == '.') return 0;  /* Above the root, or hidden */
+
+    if (ev->mask & IN_ISDIR) {
+        /* New or vanished subtrees need a walk (and new watches) */
+        return (ev->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)) != 0;
+    }
+
+    char rel[WATCH_PATH_MAX];
+    int n = dir[0] ? snprintf(rel, sizeof(rel), "%s/%s", dir, ev->name)
+                   : snprintf(rel, sizeof(rel), "%s", ev->name);
+    if (n < 0 || (size_t)n >= sizeof(rel)) return 0;
+
+    unsigned int flags = 0;
+    if (ev->mask & (IN_CREATE | IN_MOVED_TO)) flags |= AC_TREE_CREATED;
+    if (ev->mask & IN_CLOSE_WRITE) flags |= AC_TREE_WRITTEN;
+    return on_file(user_data, rel, (size_t)n, flags);
+}
+#endif
+
+int ac_tree_watch_drain(ac_tree_watch_t *w, ac_tree_event_fn on_file, void *user_data) {
+    int rescan = 0;
+#if defined(__linux__)
+    char buf[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while (w->fd >= 0) {
+        ssize_t n = read(w->fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (char *p = buf; p < buf + n;) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            if (handle_event(w, ev, on_file, user_data)) rescan = 1;
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+#else
+    (void)w;
+    (void)on_file;
+    (void)user_data;
+#endif
+    return rescan;
+}
@@ -0,0 +1,669 @@
+/**
+ * @file textfile.c
+ * @brief Mapped text files with a line-offset index
+ *
+ * The line index is built in two vector passes: one counts newlines so
+ * the offset array is allocated once at its exact size, the second
+ * records the offsets. The array holds one extra entry (the end of the
+ * data), so a line's extent is always lines[i] .. lines[i + 1].
+ *
+ * The cache is a short LRU list; lookups compare path hashes linearly,
+ * which is cheaper than a hash table at the sizes it is meant for.
+ *
+ * A watching cache adds an inotify watch on a file's directory before
+ * loading it, so no change after the load can go unreported. Pending
+ * events are drained under the cache lock at every lookup; a file with
+ * a watch is then trusted as it is. Events name entries of the real
+ * directory, so only a canonical path (absolute, no symlinks, no dot
+ * segments) gets a watch; other spellings keep the stat() check.
+ */
+
+#include <arc/textfile.h>
+#include <arc/grep.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#define read _read
+#define close _close
+#endif
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define TEXTFILE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define TEXTFILE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define TEXTFILE_MAX_FILES 32
+#define TEXTFILE_MAX_BYTES ((size_t)256 << 20)
+#define TEXTFILE_MAP_MIN 65536          /* Smaller files are read into memory */
+
+struct ac_textfile {
+    ac_textfile_cache_t *cache;         /* NULL once detached from the cache */
+    char *path;
+    uint64_t path_hash;                 /* Compared before the path */
+    dev_t dev;
+    ino_t ino;
+    int64_t mtime_ns;
+    size_t size;
+
+    char *data;
+    int mapped;
+    int binary;
+
+    pthread_mutex_t lock;               /* Guards the lazy line index */
+    size_t *lines;                      /* line_count + 1 start offsets */
+    size_t line_count;
+    int indexed;
+
+    int wd;                             /* Watch on the directory (-1 = none) */
+    const char *name;                   /* Base name, into path */
+
+    int refs;                           /* Handles plus the cache's own (atomic) */
+    struct ac_textfile *prev;           /* LRU list, most recent first */
+    struct ac_textfile *next;
+};
+
+struct ac_textfile_cache {
+    pthread_mutex_t lock;
+    ac_textfile_cache_options_t opts;
+    ac_textfile_t *head;
+    ac_textfile_t *tail;
+    size_t files;
+    size_t bytes;
+    size_t hits;
+    size_t misses;
+    size_t invalidations;
+    int inotify_fd;                     /* -1 = not watching */
+};
+
+static int64_t stat_mtime_ns(const struct stat *st) {
+#if defined(__APPLE__)
+    return (int64_t)st->st_mtimespec.tv_sec * 1000000000 + st->st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    return (int64_t)st->st_mtime * 1000000000;
+#else
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+static uint64_t hash_path(const char *path) {
+    uint64_t h = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) h = (h ^ *p) * 1099511628211ULL;
+    return h;
+}
+
+/*============================================================================
+ * Newline Scanning
+ *============================================================================*/
+
+size_t ac_textfile_count_newlines(const char *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    size_t count = 0;
+    size_t i = 0;
+
+    if (!data) return 0;
+
+#if defined(TEXTFILE_SSE2)
+    const __m128i nl = _mm_set1_epi8('\n');
+    while (i + 16 <= len) {
+        /* Byte counters overflow after 255 blocks */
+        size_t blocks = (len - i) / 16;
+        if (blocks > 255) blocks = 255;
+        __m128i acc = _mm_setzero_si128();
+        for (size_t b = 0; b < blocks; b++, i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(v, nl));
+        }
+        __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+        count += (size_t)_mm_cvtsi128_si32(sums) +
+                 (size_t)_mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums));
+    }
+#elif defined(TEXTFILE_NEON)
+    const uint8x16_t nl = vdupq_n_u8('\n');
+    while (i + 16 <= len) {
+        size_t blocks = (len - i) / 16;
+        if (blocks > 255) blocks = 255;
+        uint8x16_t acc = vdupq_n_u8(0);
+        for (size_t b = 0; b < blocks; b++, i += 16) {
+            acc = vsubq_u8(acc, vceqq_u8(vld1q_u8(p + i), nl));
+        }
+        uint64x2_t sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(acc)));
+        count += (size_t)(vgetq_lane_u64(sums, 0) + vgetq_lane_u64(sums, 1));
+    }
+#endif
+    for (; i < len; i++) count += p[i] == '\n';
+    return count;
+}
+
+/* Store the offset after each newline; returns the number stored */
+static size_t record_newlines(const char *data, size_t len, size_t *out) {
+    size_t n = 0;
+
+#if defined(TEXTFILE_SSE2)
+    const unsigned char *p = (const unsigned char *)data;
+    const __m128i nl = _mm_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)), nl));
+        while (mask) {
+            out[n++] = i + (size_t)__builtin_ctz(mask) + 1;
+            mask &= mask - 1;
+        }
+    }
+    for (; i < len; i++) {
+        if (p[i] == '\n') out[n++] = i + 1;
+    }
+#else
+    const char *p = data;
+    const char *end = data + len;
+    while (p < end && (p = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+        p++;
+        out[n++] = (size_t)(p - data);
+    }
+#endif
+    return n;
+}
+
+static int build_index(ac_textfile_t *f) {
+    size_t newlines = ac_textfile_count_newlines(f->data, f->size);
+    size_t count = newlines + (f->size > 0 && f->data[f->size - 1] != '\n');
+
+    size_t *lines = malloc((count + 1) * sizeof(size_t));
+    if (!lines) return -1;
+    lines[0] = 0;
+    record_newlines(f->data, f->size, lines + 1);
+    lines[count] = f->size;             /* Unterminated last line */
+
+    f->lines = lines;
+    f->line_count = count;
+    return 0;
+}
+
+/* Built once; callers then read lines and line_count without the lock */
+static int ensure_index(ac_textfile_t *f) {
+    pthread_mutex_lock(&f->lock);
+    if (!f->indexed) f->indexed = build_index(f) == 0;
+    int ok = f->indexed;
+    pthread_mutex_unlock(&f->lock);
+    return ok;
+}
+
+/*============================================================================
+ * Loading
+ *============================================================================*/
+
+static void file_free(ac_textfile_t *f) {
+    if (f->mapped) {
+#if !defined(_WIN32)
+        munmap(f->data, f->size);
+#endif
+    } else if (f->size > 0) {
+        free(f->data);
+    }
+    pthread_mutex_destroy(&f->lock);
+    free(f->lines);
+    free(f->path);
+    free(f);
+}
+
+static arc_err_t file_load(const char *path, ac_textfile_t **out) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return ARC_ERR_IO;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return ARC_ERR_IO;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        close(fd);
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    ac_textfile_t *f = calloc(1, sizeof(*f));
+    if (!f || !(f->path = strdup(path))) {
+        free(f);
+        close(fd);
+        return ARC_ERR_NO_MEMORY;
+    }
+    pthread_mutex_init(&f->lock, NULL);
+    f->path_hash = hash_path(f->path);
+    const char *slash = strrchr(f->path, '/');
+    f->name = slash ? slash + 1 : f->path;
+    f->wd = -1;
+    f->dev = st.st_dev;
+    f->ino = st.st_ino;
+    f->mtime_ns = stat_mtime_ns(&st);
+    f->size = (size_t)st.st_size;
+    f->refs = 1;
+
+    arc_err_t err = ARC_OK;
+    if (f->size == 0) {
+        f->data = (char *)"";
+    } else {
+#if !defined(_WIN32)
+        if (f->size >= TEXTFILE_MAP_MIN) {
+            void *map = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                f->data = map;
+                f->mapped = 1;
+            }
+        }
+#endif
+        if (!f->mapped) {
+            f->data = malloc(f->size);
+            size_t got = 0;
+            while (f->data && got < f->size) {
+                long n = (long)read(fd, f->data + got, (unsigned)(f->size - got));
+                if (n <= 0) break;
+                got += (size_t)n;
+            }
+            if (!f->data) {
+                err = ARC_ERR_NO_MEMORY;
+            } else if (got < f->size) {
+                f->size = got;          /* Shrank since the stat */
+                if (got == 0) {
+                    free(f->data);
+                    f->data = (char *)"";
+                }
+            }
+        }
+    }
+    close(fd);
+
+    if (err != ARC_OK) {
+        f->size = 0;                    /* data is not allocated */
+        file_free(f);
+        return err;
+    }
+    f->binary = ac_grep_is_binary(f->data, f->size);
+    *out = f;
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Cache
+ *============================================================================*/
+
+ac_textfile_cache_t *ac_textfile_cache_create(const ac_textfile_cache_options_t *options) {
+    ac_textfile_cache_t *cache = calloc(1, sizeof(*cache));
+    if (!cache) return NULL;
+    if (options) cache->opts = *options;
+    if (!cache->opts.max_files) cache->opts.max_files = TEXTFILE_MAX_FILES;
+    if (!cache->opts.max_bytes) cache->opts.max_bytes = TEXTFILE_MAX_BYTES;
+    cache->inotify_fd = -1;
+#if defined(__linux__)
+    if (cache->opts.watch) cache->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+/* Caller holds the cache lock */
+static void cache_unlink(ac_textfile_cache_t *cache, ac_textfile_t *f) {
+    if (f->prev) f->prev->next = f->next;
+    else cache->head = f->next;
+    if (f->next) f->next->prev = f->prev;
+    else cache->tail = f->prev;
+    f->prev = f->next = NULL;
+    __atomic_store_n(&f->cache, NULL, __ATOMIC_RELEASE);
+    cache->files--;
+    cache->bytes -= f->size;
+}
+
+static void cache_push_front(ac_textfile_cache_t *cache, ac_textfile_t *f) {
+    f->prev = NULL;
+    f->next = cache->head;
+    if (cache->head) cache->head->prev = f;
+    cache->head = f;
+    if (!cache->tail) cache->tail = f;
+    __atomic_store_n(&f->cache, cache, __ATOMIC_RELEASE);
+    cache->files++;
+    cache->bytes += f->size;
+}
+
+/* Drop the cache's reference; returns 1 if the file is to be freed */
+static int cache_drop(ac_textfile_cache_t *cache, ac_textfile_t *f) {
+    cache_unlink(cache, f);
+    return __atomic_sub_fetch(&f->refs, 1, __ATOMIC_ACQ_REL) == 0;
+}
+
+/* Evict least recently used files nobody holds; collects them in *freed */
+static void cache_trim(ac_textfile_cache_t *cache, ac_textfile_t **freed) {
+    ac_textfile_t *f = cache->tail;
+    while (f && (cache->files > cache->opts.max_files || cache->bytes > cache->opts.max_bytes)) {
+        ac_textfile_t *prev = f->prev;
+        /* New references are only taken under the lock */
+        if (__atomic_load_n(&f->refs, __ATOMIC_ACQUIRE) == 1 && cache_drop(cache, f)) {
+            f->next = *freed;
+            *freed = f;
+        }
+        f = prev;
+    }
+}
+
+static void free_list(ac_textfile_t *f) {
+    while (f) {
+        ac_textfile_t *next = f->next;
+        file_free(f);
+        f = next;
+    }
+}
+
+/* Caller holds the cache lock */
+static ac_textfile_t *cache_find(ac_textfile_cache_t *cache, const char *path) {
+    uint64_t hash = hash_path(path);
+    for (ac_textfile_t *f = cache->head; f; f = f->next) {
+        if (f->path_hash == hash && strcmp(f->path, path) == 0) return f;
+    }
+    return NULL;
+}
+
+/* Caller holds the cache lock; takes a reference for the caller */
+static void cache_hit(ac_textfile_cache_t *cache, ac_textfile_t *f) {
+    __atomic_add_fetch(&f->refs, 1, __ATOMIC_RELAXED);
+    cache->hits++;
+    if (f != cache->head) {
+        cache_unlink(cache, f);
+        cache_push_front(cache, f);
+    }
+}
+
+/* Drop files matching wd (-1 = any) and name (NULL = any) */
+static void cache_invalidate(ac_textfile_cache_t *cache, int wd, const char *name, ac_textfile_t **freed) {
+    ac_textfile_t *f = cache->head;
+    while (f) {
+        ac_textfile_t *next = f->next;
+        if ((wd < 0 || f->wd == wd) && (!name || strcmp(f->name, name) == 0)) {
+            cache->invalidations++;
+            if (cache_drop(cache, f)) {
+                f->next = *freed;
+                *freed = f;
+            }
+        }
+        f = next;
+    }
+}
+
+/*============================================================================
+ * Watching
+ *============================================================================*/
+
+/* Watch the directory of a canonical path; returns the watch descriptor or -1 */
+static int watch_dir(ac_textfile_cache_t *cache, const char *path) {
+#if defined(__linux__)
+    if (cache->inotify_fd < 0 || path[0] != '/') return -1;
+
+    /* Through a symlink, changes happen under another name or directory */
+    char *real = realpath(path, NULL);
+    int canonical = real && strcmp(real, path) == 0;
+    free(real);
+    if (!canonical) return -1;
+
+    char dir[4096];
+    const char *slash = strrchr(path, '/');
+    if (!slash) {
+        snprintf(dir, sizeof(dir), ".");
+    } else if (slash == path) {
+        snprintf(dir, sizeof(dir), "/");
+    } else if ((size_t)(slash - path) < sizeof(dir)) {
+        memcpy(dir, path, (size_t)(slash - path));
+        dir[slash - path] = '\0';
+    } else {
+        return -1;
+    }
+    return inotify_add_watch(cache->inotify_fd, dir,
+                             IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE |
+                             IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF |
+                             IN_ONLYDIR);
+#else
+    (void)cache;
+    (void)path;
+    return -1;
+#endif
+}
+
+/* Caller holds the cache lock */
+static void drain_events(ac_textfile_cache_t *cache, ac_textfile_t **freed) {
+#if defined(__linux__)
+    char buf[8192] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while (cache->inotify_fd >= 0) {
+        ssize_t n = read(cache->inotify_fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (char *p = buf; p < buf + n;) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            if (ev->mask & IN_Q_OVERFLOW) {
+                cache_invalidate(cache, -1, NULL, freed);
+            } else if (ev->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                cache_invalidate(cache, ev->wd, NULL, freed);
+            } else if (ev->len > 0) {
+                cache_invalidate(cache, ev->wd, ev->name, freed);
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+#else
+    (void)cache;
+    (void)freed;
+#endif
+}
+
+/*
+ * Watched file that is still cached; the caller holds the cache lock.
+ * Returns NULL when the file has to be checked with stat() instead.
+ */
+static ac_textfile_t *watched_lookup(ac_textfile_cache_t *cache, const char *path, ac_textfile_t **freed) {
+    if (cache->inotify_fd < 0) return NULL;
+    drain_events(cache, freed);
+    ac_textfile_t *f = cache_find(cache, path);
+    return f && f->wd >= 0 ? f : NULL;
+}
+
+void ac_textfile_cache_stats(ac_textfile_cache_t *cache, ac_textfile_cache_stats_t *stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!cache) return;
+    pthread_mutex_lock(&cache->lock);
+    stats->files = cache->files;
+    stats->bytes = cache->bytes;
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->invalidations = cache->invalidations;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void ac_textfile_cache_invalidate(ac_textfile_cache_t *cache, const char *path) {
+    if (!cache) return;
+    ac_textfile_t *freed = NULL;
+    pthread_mutex_lock(&cache->lock);
+    if (!path) {
+        cache_invalidate(cache, -1, NULL, &freed);
+    } else {
+        ac_textfile_t *f = cache_find(cache, path);
+        if (f) {
+            cache->invalidations++;
+            if (cache_drop(cache, f)) freed = f;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+    free_list(freed);
+}
+
+void ac_textfile_cache_destroy(ac_textfile_cache_t *cache) {
+    if (!cache) return;
+    ac_textfile_t *freed = NULL;
+    pthread_mutex_lock(&cache->lock);
+    while (cache->head) {
+        ac_textfile_t *f = cache->head;
+        if (cache_drop(cache, f)) {
+            f->next = freed;
+            freed = f;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+    free_list(freed);
+#if defined(__linux__)
+    if (cache->inotify_fd >= 0) close(cache->inotify_fd);
+#endif
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+/*============================================================================
+ * Files
+ *============================================================================*/
+
+/* Whether a cached file still matches what stat() reports */
+static int entry_current(const ac_textfile_t *f, const struct stat *st) {
+    return f->dev == st->st_dev && f->ino == st->st_ino && f->size == (size_t)st->st_size &&
+           f->mtime_ns == stat_mtime_ns(st);
+}
+
+arc_err_t ac_textfile_open(ac_textfile_cache_t *cache, const char *path, ac_textfile_t **out) {
+    if (!path || !out) return ARC_ERR_INVALID_ARG;
+    *out = NULL;
+    if (!cache) return file_load(path, out);
+
+    ac_textfile_t *freed = NULL;
+    pthread_mutex_lock(&cache->lock);
+    ac_textfile_t *f = watched_lookup(cache, path, &freed);
+    if (f) cache_hit(cache, f);
+    pthread_mutex_unlock(&cache->lock);
+    free_list(freed);
+    if (f) {
+        *out = f;
+        return ARC_OK;
+    }
+
+    struct stat st;
+    if (stat(path, &st) != 0) return ARC_ERR_IO;
+    if (!S_ISREG(st.st_mode)) return ARC_ERR_INVALID_ARG;
+
+    freed = NULL;
+    pthread_mutex_lock(&cache->lock);
+    f = cache_find(cache, path);
+    if (f && entry_current(f, &st)) {
+        cache_hit(cache, f);
+        pthread_mutex_unlock(&cache->lock);
+        *out = f;
+        return ARC_OK;
+    }
+    /* Changed: holders keep the old contents */
+    if (f && cache_drop(cache, f)) freed = f;
+    cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+    if (freed) file_free(freed);
+
+    /* Watch first: a change while loading then drops the new entry */
+    int wd = watch_dir(cache, path);
+
+    /* Map outside the lock; a racing open of the same file maps it too */
+    f = NULL;
+    arc_err_t err = file_load(path, &f);
+    if (err != ARC_OK) return err;
+    f->wd = wd;
+
+    freed = NULL;
+    pthread_mutex_lock(&cache->lock);
+    ac_textfile_t *g = cache_find(cache, path);
+    if (g && cache_drop(cache, g)) {
+        g->next = freed;
+        freed = g;
+    }
+    f->refs++;                          /* The cache's reference; f is not shared yet */
+    cache_push_front(cache, f);
+    cache_trim(cache, &freed);
+    pthread_mutex_unlock(&cache->lock);
+    free_list(freed);
+
+    *out = f;
+    return ARC_OK;
+}
+
+arc_err_t ac_textfile_peek(ac_textfile_cache_t *cache, const char *path, ac_textfile_t **out) {
+    if (!cache || !path || !out) return ARC_ERR_INVALID_ARG;
+    *out = NULL;
+
+    ac_textfile_t *freed = NULL;
+    pthread_mutex_lock(&cache->lock);
+    ac_textfile_t *f = watched_lookup(cache, path, &freed);
+    if (!f && (f = cache_find(cache, path)) != NULL) {
+        /* Only cached files get a stat(), so holding the lock is fine */
+        struct stat st;
+        if (stat(path, &st) != 0 || !entry_current(f, &st)) f = NULL;
+    }
+    if (f) cache_hit(cache, f);
+    pthread_mutex_unlock(&cache->lock);
+    free_list(freed);
+
+    if (!f) return ARC_ERR_NOT_FOUND;
+    *out = f;
+    return ARC_OK;
+}
+
+void ac_textfile_release(ac_textfile_t *file) {
+    if (!file) return;
+
+    /*
+     * A cached file always keeps a reference of the cache's, so only a
+     * detached one can reach zero here. The last holder of a cached file
+     * gives the cache a chance to trim it.
+     */
+    ac_textfile_cache_t *cache = __atomic_load_n(&file->cache, __ATOMIC_ACQUIRE);
+    if (__atomic_sub_fetch(&file->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        file_free(file);
+        return;
+    }
+    if (!cache) return;
+    ac_textfile_t *freed = NULL;
+    pthread_mutex_lock(&cache->lock);
+    cache_trim(cache, &freed);
+    pthread_mutex_unlock(&cache->lock);
+    free_list(freed);
+}
+
+const char *ac_textfile_data(const ac_textfile_t *file) {
+    return file ? file->data : NULL;
+}
+
+size_t ac_textfile_size(const ac_textfile_t *file) {
+    return file ? file->size : 0;
+}
+
+int ac_textfile_is_binary(const ac_textfile_t *file) {
+    return file ? file->binary : 0;
+}
+
+size_t ac_textfile_line_count(ac_textfile_t *file) {
+    if (!file || !ensure_index(file)) return 0;
+    return file->line_count;
+}
+
+const char *ac_textfile_line(ac_textfile_t *file, size_t index, size_t *len) {
+    if (len) *len = 0;
+    if (!file || !ensure_index(file) || index >= file->line_count) return NULL;
+
+    size_t start = file->lines[index];
+    size_t end = file->lines[index + 1];
+    if (end > start && file->data[end - 1] == '\n') end--;
+    if (end > start && file->data[end - 1] == '\r') end--;
+    if (len) *len = end - start;
+    return file->data + start;
+}
@@ -0,0 +1,297 @@
+/**
+ * @file trace_binary_common.c
+ * @brief Encoding helpers shared by the binary trace writer and reader
+ */
+
+#include "trace_binary_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ARC_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef ARC_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+/*============================================================================
+ * CRC32 (IEEE 802.3, reflected)
+ *============================================================================*/
+
+static uint32_t s_crc_table[256];
+static int s_crc_ready = 0;
+
+static void crc_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        s_crc_table[i] = c;
+    }
+    s_crc_ready = 1;
+}
+
+uint32_t act_crc32(const void *data, size_t len) {
+    if (!s_crc_ready) {
+        crc_init();
+    }
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) {
+        c = s_crc_table[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+/*============================================================================
+ * Fixed-width Integers
+ *============================================================================*/
+
+void act_put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+void act_put_u32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+void act_put_u64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+uint16_t act_get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+uint32_t act_get_u32(const uint8_t *p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+uint64_t act_get_u64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+/*============================================================================
+ * Varints
+ *============================================================================*/
+
+size_t act_varint_encode(uint8_t *out, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+size_t act_varint_decode(const uint8_t *p, size_t avail, uint64_t *out) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < avail && i < 10; i++) {
+        v |= (uint64_t)(p[i] & 0x7F) << (7 * i);
+        if (!(p[i] & 0x80)) {
+            *out = v;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/*============================================================================
+ * Block Header / Index Entry
+ *============================================================================*/
+
+void act_block_header_encode(uint8_t out[ACT_BLOCK_HEADER_SIZE], const act_block_header_t *h) {
+    act_put_u32(out, h->magic);
+    out[4] = h->codec;
+    out[5] = h->flags;
+    act_put_u16(out + 6, 0);
+    act_put_u32(out + 8, h->raw_len);
+    act_put_u32(out + 12, h->stored_len);
+    act_put_u32(out + 16, h->crc);
+}
+
+int act_block_header_decode(const uint8_t in[ACT_BLOCK_HEADER_SIZE], act_block_header_t *h) {
+    h->magic = act_get_u32(in);
+    h->codec = in[4];
+    h->flags = in[5];
+    h->raw_len = act_get_u32(in + 8);
+    h->stored_len = act_get_u32(in + 12);
+    h->crc = act_get_u32(in + 16);
+
+    if (h->magic != ACT_BLOCK_MAGIC ||
+        h->raw_len > ACT_MAX_BLOCK_SIZE ||
+        h->stored_len > ACT_MAX_BLOCK_SIZE) {
+        return -1;
+    }
+    if (h->codec == ACT_CODEC_NONE && h->raw_len != h->stored_len) {
+        return -1;
+    }
+    return 0;
+}
+
+void act_index_entry_encode(uint8_t out[ACT_INDEX_ENTRY_SIZE], const act_index_entry_t *e) {
+    memset(out, 0, ACT_INDEX_ENTRY_SIZE);
+    memcpy(out, e->trace_id, ACT_TRACE_ID_LEN);
+    memcpy(out + 32, e->agent_name, ACT_AGENT_NAME_LEN);
+    act_put_u64(out + 96, e->offset);
+    act_put_u64(out + 104, e->start_ms);
+    act_put_u64(out + 112, e->end_ms);
+    act_put_u32(out + 120, e->event_count);
+    act_put_u32(out + 124, e->flags);
+}
+
+void act_index_entry_decode(const uint8_t in[ACT_INDEX_ENTRY_SIZE], act_index_entry_t *e) {
+    memcpy(e->trace_id, in, ACT_TRACE_ID_LEN);
+    e->trace_id[ACT_TRACE_ID_LEN - 1] = '\0';
+    memcpy(e->agent_name, in + 32, ACT_AGENT_NAME_LEN);
+    e->agent_name[ACT_AGENT_NAME_LEN - 1] = '\0';
+    e->offset = act_get_u64(in + 96);
+    e->start_ms = act_get_u64(in + 104);
+    e->end_ms = act_get_u64(in + 112);
+    e->event_count = act_get_u32(in + 120);
+    e->flags = act_get_u32(in + 124);
+}
+
+/*============================================================================
+ * Compression
+ *============================================================================*/
+
+int act_codec_available(int codec) {
+    switch (codec) {
+        case ACT_CODEC_NONE:
+            return 1;
+#ifdef ARC_HAVE_LZ4
+        case ACT_CODEC_LZ4:
+            return 1;
+#endif
+#ifdef ARC_HAVE_ZSTD
+        case ACT_CODEC_ZSTD:
+            return 1;
+#endif
+        default:
+            return 0;
+    }
+}
+
+int act_compress(int codec, const uint8_t *src, size_t len,
+                 uint8_t **out, size_t *out_len) {
+    *out = NULL;
+    *out_len = 0;
+
+#ifdef ARC_HAVE_LZ4
+    if (codec == ACT_CODEC_LZ4 && len <= (size_t)LZ4_MAX_INPUT_SIZE) {
+        int bound = LZ4_compressBound((int)len);
+        uint8_t *buf = malloc((size_t)bound);
+        if (buf) {
+            int n = LZ4_compress_default((const char *)src, (char *)buf, (int)len, bound);
+            if (n > 0 && (size_t)n < len) {
+                *out = buf;
+                *out_len = (size_t)n;
+                return ACT_CODEC_LZ4;
+            }
+            free(buf);
+        }
+    }
+#endif
+
+#ifdef ARC_HAVE_ZSTD
+    if (codec == ACT_CODEC_ZSTD) {
+        size_t bound = ZSTD_compressBound(len);
+        uint8_t *buf = malloc(bound);
+        if (buf) {
+            size_t n = ZSTD_compress(buf, bound, src, len, 3);
+            if (!ZSTD_isError(n) && n < len) {
+                *out = buf;
+                *out_len = n;
+                return ACT_CODEC_ZSTD;
+            }
+            free(buf);
+        }
+    }
+#endif
+
+    (void)codec;
+    (void)src;
+    (void)len;
+    return ACT_CODEC_NONE;
+}
+
+int act_decompress(int codec, const uint8_t *src, size_t len,
+                   uint8_t *dst, size_t raw_len) {
+    switch (codec) {
+        case ACT_CODEC_NONE:
+            if (len != raw_len) return -1;
+            memcpy(dst, src, len);
+            return 0;
+#ifdef ARC_HAVE_LZ4
+        case ACT_CODEC_LZ4: {
+            int n = LZ4_decompress_safe((const char *)src, (char *)dst, (int)len, (int)raw_len);
+            return (n >= 0 && (size_t)n == raw_len) ? 0 : -1;
+        }
+#endif
+#ifdef ARC_HAVE_ZSTD
+        case ACT_CODEC_ZSTD: {
+            size_t n = ZSTD_decompress(dst, raw_len, src, len);
+            return (!ZSTD_isError(n) && n == raw_len) ? 0 : -1;
+        }
+#endif
+        default:
+            return -1;
+    }
+}
+
+/*============================================================================
+ * File Scanning
+ *============================================================================*/
+
+int act_seek(FILE *f, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, (__int64)offset, SEEK_SET);
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET);
+#endif
+}
+
+uint64_t act_scan_blocks(FILE *f, uint64_t from,
+                         void (*on_run_start)(uint64_t offset, void *ud),
+                         void *ud) {
+    uint64_t pos = from;
+    uint8_t *payload = NULL;
+    size_t payload_cap = 0;
+
+    if (act_seek(f, pos) != 0) {
+        return from;
+    }
+
+    for (;;) {
+        uint8_t hdr[ACT_BLOCK_HEADER_SIZE];
+        act_block_header_t h;
+
+        if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr)) break;
+        if (act_block_header_decode(hdr, &h) != 0) break;
+
+        if (h.stored_len > payload_cap) {
+            uint8_t *grown = realloc(payload, h.stored_len);
+            if (!grown) break;
+            payload = grown;
+            payload_cap = h.stored_len;
+        }
+        if (h.stored_len > 0 && fread(payload, 1, h.stored_len, f) != h.stored_len) break;
+        if (act_crc32(payload, h.stored_len) != h.crc) break;
+
+        if ((h.flags & ACT_BLOCK_RUN_START) && on_run_start) {
+            on_run_start(pos, ud);
+        }
+        pos += ACT_BLOCK_HEADER_SIZE + h.stored_len;
+    }
+
+    free(payload);
+    return pos;
+}
@@ -0,0 +1,777 @@
+/**
+ * @file trace_binary_exporter.c
+ * @brief Compact binary file exporter for ArC traces
+ *
+ * Events are encoded into length-prefixed records, buffered into blocks and
+ * appended to a single trace file. See trace_binary_internal.h for the
+ * on-disk layout.
+ *
+ * Size reductions compared to the JSON exporter:
+ * - Short strings (names, ids, models) are interned once per run
+ * - messages_json/tools_json are delta-encoded against the previous request,
+ *   since the conversation history only grows within a run
+ * - Integers are varints, timestamps are deltas
+ * - Blocks can optionally be compressed with LZ4 or zstd
+ *
+ * Running out of memory never writes a truncated record: an event that
+ * does not fit is dropped, and a block that cannot grow is dropped whole.
+ */
+
+#include "arc/trace_exporters.h"
+#include "arc/trace.h"
+#include "trace_binary_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#define mkdir_p(path) _mkdir(path)
+#define truncate_file(f, len) _chsize_s(_fileno(f), (__int64)(len))
+#else
+#include <unistd.h>
+#define mkdir_p(path) mkdir(path, 0755)
+#define truncate_file(f, len) ftruncate(fileno(f), (off_t)(len))
+#endif
+
+/*============================================================================
+ * Static State
+ *============================================================================*/
+
+typedef struct {
+    char *str;
+    size_t len;
+    uint32_t hash;
+    uint32_t id;
+} intern_slot_t;
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    int failed;                         /* Sticky: an append was lost */
+} byte_buf_t;
+
+typedef struct {
+    ac_trace_binary_config_t config;
+    FILE *file;
+    FILE *index;
+    char current_path[512];
+    char index_path[520];
+    uint64_t file_end;
+
+    /* Pending block */
+    byte_buf_t block;
+    byte_buf_t record;
+    int block_run_start;
+    uint32_t block_events;              /* Events in the pending block */
+    uint64_t block_ts;                  /* last_ts before the pending block */
+
+    /* Per-run string table (open addressing) */
+    intern_slot_t *interns;
+    size_t intern_cap;
+    uint32_t intern_count;
+
+    /* Per-run delta slots */
+    char *slot_prev[ACT_SLOT_COUNT];
+    size_t slot_len[ACT_SLOT_COUNT];
+
+    /* Current run */
+    act_index_entry_t run;
+    int in_run;
+    uint64_t last_ts;
+
+    int initialized;
+} binary_exporter_state_t;
+
+static binary_exporter_state_t s_bin = {0};
+
+/* Cap on interned strings per run; further strings are written inline */
+#define INTERN_MAX_COUNT 4096
+
+/*============================================================================
+ * Byte Buffer
+ *============================================================================*/
+
+static int buf_reserve(byte_buf_t *b, size_t extra) {
+    if (b->len + extra <= b->cap) {
+        return 0;
+    }
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + extra) {
+        cap *= 2;
+    }
+    uint8_t *data = realloc(b->data, cap);
+    if (!data) {
+        return -1;
+    }
+    b->data = data;
+    b->cap = cap;
+    return 0;
+}
+
+static void buf_put(byte_buf_t *b, const void *data, size_t len) {
+    if (len == 0 || b->failed) return;
+    if (buf_reserve(b, len) != 0) {
+        b->failed = 1;
+        return;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+}
+
+static void buf_u8(byte_buf_t *b, uint8_t v) {
+    buf_put(b, &v, 1);
+}
+
+static void buf_varint(byte_buf_t *b, uint64_t v) {
+    uint8_t tmp[10];
+    buf_put(b, tmp, act_varint_encode(tmp, v));
+}
+
+static void buf_svarint(byte_buf_t *b, int64_t v) {
+    buf_varint(b, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static void buf_free(byte_buf_t *b) {
+    free(b->data);
+    b->data = NULL;
+    b->len = b->cap = 0;
+    b->failed = 0;
+}
+
+/*============================================================================
+ * String Interning
+ *============================================================================*/
+
+static uint32_t hash_bytes(const char *s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)s[i]) * 16777619u;
+    }
+    return h;
+}
+
+static void intern_reset(void) {
+    for (size_t i = 0; i < s_bin.intern_cap; i++) {
+        free(s_bin.interns[i].str);
+    }
+    free(s_bin.interns);
+    s_bin.interns = NULL;
+    s_bin.intern_cap = 0;
+    s_bin.intern_count = 0;
+}
+
+/**
+ * Look up a string, defining it with an ACT_REC_STRING record in the
+ * current block if it has not been seen in this run.
+ * Returns the id, or -1 if the table is full.
+ */
+static int64_t intern_lookup(const char *s, size_t len) {
+    if (s_bin.intern_cap == 0) {
+        s_bin.interns = calloc(256, sizeof(intern_slot_t));
+        if (!s_bin.interns) return -1;
+        s_bin.intern_cap = 256;
+    }
+
+    uint32_t h = hash_bytes(s, len);
+    size_t mask = s_bin.intern_cap - 1;
+    size_t i = h & mask;
+
+    while (s_bin.interns[i].str) {
+        intern_slot_t *slot = &s_bin.interns[i];
+        if (slot->hash == h && slot->len == len && memcmp(slot->str, s, len) == 0) {
+            return slot->id;
+        }
+        i = (i + 1) & mask;
+    }
+
+    if (s_bin.intern_count >= INTERN_MAX_COUNT) {
+        return -1;
+    }
+
+    /* Grow at 50% load, then re-probe */
+    if ((s_bin.intern_count + 1) * 2 > s_bin.intern_cap) {
+        size_t new_cap = s_bin.intern_cap * 2;
+        intern_slot_t *grown = calloc(new_cap, sizeof(intern_slot_t));
+        if (!grown) return -1;
+        for (size_t j = 0; j < s_bin.intern_cap; j++) {
+            if (!s_bin.interns[j].str) continue;
+            size_t k = s_bin.interns[j].hash & (new_cap - 1);
+            while (grown[k].str) k = (k + 1) & (new_cap - 1);
+            grown[k] = s_bin.interns[j];
+        }
+        free(s_bin.interns);
+        s_bin.interns = grown;
+        s_bin.intern_cap = new_cap;
+        mask = new_cap - 1;
+        i = h & mask;
+        while (s_bin.interns[i].str) i = (i + 1) & mask;
+    }
+
+    char *copy = malloc(len + 1);
+    if (!copy) return -1;
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+
+    intern_slot_t *slot = &s_bin.interns[i];
+    slot->str = copy;
+    slot->len = len;
+    slot->hash = h;
+    slot->id = s_bin.intern_count++;
+
+    /* Emit the definition ahead of the event that references it */
+    uint8_t tmp[24];
+    size_t n = act_varint_encode(tmp + 1, slot->id);
+    n += act_varint_encode(tmp + 1 + n, len);
+    tmp[0] = ACT_REC_STRING;
+    buf_varint(&s_bin.block, 1 + n + len);
+    buf_put(&s_bin.block, tmp, 1 + n);
+    buf_put(&s_bin.block, s, len);
+
+    return slot->id;
+}
+
+/*============================================================================
+ * Field Encoders
+ *============================================================================*/
+
+static void put_str(const char *s) {
+    byte_buf_t *r = &s_bin.record;
+
+    if (!s) {
+        buf_varint(r, ACT_STR_NULL);
+        return;
+    }
+
+    size_t len = strlen(s);
+    if (len <= ACT_INTERN_MAX_LEN) {
+        int64_t id = intern_lookup(s, len);
+        if (id >= 0) {
+            buf_varint(r, ACT_STR_REF);
+            buf_varint(r, (uint64_t)id);
+            return;
+        }
+    }
+
+    buf_varint(r, ACT_STR_INLINE);
+    buf_varint(r, len);
+    buf_put(r, s, len);
+}
+
+/**
+ * Encode a large field as a delta against its previous value in the run.
+ * Falls back to inline when the shared prefix is too short to pay off.
+ */
+static void put_slot_str(int slot, const char *s) {
+    byte_buf_t *r = &s_bin.record;
+
+    if (!s) {
+        buf_varint(r, ACT_STR_NULL);
+        return;
+    }
+
+    size_t len = strlen(s);
+    const char *prev = s_bin.slot_prev[slot];
+    size_t prev_len = s_bin.slot_len[slot];
+    size_t prefix = 0;
+
+    if (prev) {
+        size_t max = len < prev_len ? len : prev_len;
+        while (prefix < max && prev[prefix] == s[prefix]) {
+            prefix++;
+        }
+    }
+
+    if (prefix >= 16) {
+        buf_varint(r, ACT_STR_DELTA);
+        buf_varint(r, prefix);
+        buf_varint(r, len - prefix);
+        buf_put(r, s + prefix, len - prefix);
+    } else {
+        buf_varint(r, ACT_STR_INLINE);
+        buf_varint(r, len);
+        buf_put(r, s, len);
+    }
+
+    /* Reader mirrors this: every non-null value becomes the new base */
+    char *copy = realloc(s_bin.slot_prev[slot], len + 1);
+    if (copy) {
+        memcpy(copy, s, len + 1);
+        s_bin.slot_prev[slot] = copy;
+        s_bin.slot_len[slot] = len;
+    }
+}
+
+static void reset_slots(void) {
+    for (int i = 0; i < ACT_SLOT_COUNT; i++) {
+        free(s_bin.slot_prev[i]);
+        s_bin.slot_prev[i] = NULL;
+        s_bin.slot_len[i] = 0;
+    }
+}
+
+static void reset_run_state(void) {
+    intern_reset();
+    reset_slots();
+    s_bin.last_ts = 0;
+}
+
+/*============================================================================
+ * Block and Index Output
+ *============================================================================*/
+
+static int flush_block(void) {
+    if (!s_bin.file || s_bin.block.len == 0) {
+        return 0;
+    }
+
+    uint8_t *packed = NULL;
+    size_t packed_len = 0;
+    int codec = act_compress((int)s_bin.config.compression,
+                             s_bin.block.data, s_bin.block.len,
+                             &packed, &packed_len);
+
+    const uint8_t *payload = packed ? packed : s_bin.block.data;
+    size_t payload_len = packed ? packed_len : s_bin.block.len;
+
+    act_block_header_t h = {
+        .magic = ACT_BLOCK_MAGIC,
+        .codec = (uint8_t)codec,
+        .flags = s_bin.block_run_start ? ACT_BLOCK_RUN_START : 0,
+        .raw_len = (uint32_t)s_bin.block.len,
+        .stored_len = (uint32_t)payload_len,
+        .crc = act_crc32(payload, payload_len)
+    };
+    uint8_t hdr[ACT_BLOCK_HEADER_SIZE];
+    act_block_header_encode(hdr, &h);
+
+    int rc = 0;
+    if (fwrite(hdr, 1, sizeof(hdr), s_bin.file) != sizeof(hdr) ||
+        fwrite(payload, 1, payload_len, s_bin.file) != payload_len ||
+        fflush(s_bin.file) != 0) {
+        fprintf(stderr, "[TRACE] Failed to write %s: %s\n",
+                s_bin.current_path, strerror(errno));
+        rc = -1;
+    } else {
+        s_bin.file_end += sizeof(hdr) + payload_len;
+    }
+
+    free(packed);
+    s_bin.block.len = 0;
+    s_bin.block_run_start = 0;
+    s_bin.block_events = 0;
+    return rc;
+}
+
+/**
+ * Discard a block that could not grow. Its string definitions and delta
+ * bases are gone with it, so later events start over from inline values;
+ * the reader simply redefines reused string ids.
+ */
+static void drop_block(void) {
+    fprintf(stderr, "[TRACE] Out of memory, dropped a block of %u events\n",
+            (unsigned)s_bin.block_events);
+    s_bin.run.event_count -= s_bin.block_events;
+    s_bin.block_events = 0;
+    s_bin.block.len = 0;
+    s_bin.block.failed = 0;
+    s_bin.last_ts = s_bin.block_ts;
+    intern_reset();
+    reset_slots();
+}
+
+static void write_index_entry(void) {
+    if (!s_bin.index) return;
+
+    uint8_t entry[ACT_INDEX_ENTRY_SIZE];
+    act_index_entry_encode(entry, &s_bin.run);
+    if (fwrite(entry, 1, sizeof(entry), s_bin.index) == sizeof(entry)) {
+        fflush(s_bin.index);
+    }
+}
+
+/*============================================================================
+ * Event Encoding
+ *============================================================================*/
+
+/* Returns 0 if the event was added to the pending block */
+static int encode_event(const ac_trace_event_t *event) {
+    byte_buf_t *r = &s_bin.record;
+    r->len = 0;
+    r->failed = 0;
+    if (s_bin.block.len == 0) {
+        s_bin.block_ts = s_bin.last_ts;
+    }
+
+    buf_u8(r, ACT_REC_EVENT);
+    buf_u8(r, (uint8_t)event->type);
+    buf_svarint(r, (int64_t)(event->timestamp_ms - s_bin.last_ts));
+    buf_varint(r, (uint64_t)(event->sequence < 0 ? 0 : event->sequence));
+    put_str(event->trace_id);
+    put_str(event->agent_name);
+
+    switch (event->type) {
+        case AC_TRACE_AGENT_START: {
+            const ac_trace_agent_start_t *d = &event->data.agent_start;
+            put_str(d->message);
+            put_str(d->instructions);
+            buf_svarint(r, d->max_iterations);
+            buf_varint(r, d->tool_count);
+            break;
+        }
+        case AC_TRACE_AGENT_END: {
+            const ac_trace_agent_end_t *d = &event->data.agent_end;
+            put_str(d->content);
+            buf_svarint(r, d->iterations);
+            buf_svarint(r, d->total_prompt_tokens);
+            buf_svarint(r, d->total_completion_tokens);
+            buf_varint(r, d->duration_ms);
+            break;
+        }
+        case AC_TRACE_ITER_START:
+        case AC_TRACE_ITER_END:
+            buf_svarint(r, event->data.iter.iteration);
+            buf_svarint(r, event->data.iter.max_iterations);
+            break;
+        case AC_TRACE_LLM_REQUEST: {
+            const ac_trace_llm_request_t *d = &event->data.llm_request;
+            put_str(d->model);
+            put_slot_str(ACT_SLOT_MESSAGES, d->messages_json);
+            put_slot_str(ACT_SLOT_TOOLS, d->tools_json);
+            buf_varint(r, d->message_count);
+            break;
+        }
+        case AC_TRACE_LLM_RESPONSE: {
+            const ac_trace_llm_response_t *d = &event->data.llm_response;
+            put_str(d->content);
+            put_str(d->tool_calls_json);
+            buf_svarint(r, d->tool_call_count);
+            buf_svarint(r, d->prompt_tokens);
+            buf_svarint(r, d->completion_tokens);
+            buf_svarint(r, d->total_tokens);
+            put_str(d->finish_reason);
+            buf_varint(r, d->duration_ms);
+            break;
+        }
+        case AC_TRACE_TOOL_START: {
+            const ac_trace_tool_start_t *d = &event->data.tool_start;
+            put_str(d->id);
+            put_str(d->name);
+            put_str(d->arguments);
+            break;
+        }
+        case AC_TRACE_TOOL_END: {
+            const ac_trace_tool_end_t *d = &event->data.tool_end;
+            put_str(d->id);
+            put_str(d->name);
+            put_str(d->result);
+            buf_varint(r, d->duration_ms);
+            buf_svarint(r, d->success);
+            break;
+        }
+    }
+
+    if (!r->failed) {
+        buf_varint(&s_bin.block, r->len);
+        buf_put(&s_bin.block, r->data, r->len);
+    }
+    if (s_bin.block.failed) {
+        drop_block();
+        return -1;
+    }
+    if (r->failed) {
+        /* The reader never sees this record: forget the bases it set */
+        fprintf(stderr, "[TRACE] Out of memory, dropped a trace event\n");
+        reset_slots();
+        return -1;
+    }
+    s_bin.last_ts = event->timestamp_ms;
+    s_bin.run.event_count++;
+    s_bin.block_events++;
+    return 0;
+}
+
+/*============================================================================
+ * Trace Handler
+ *============================================================================*/
+
+static void binary_trace_handler(const ac_trace_event_t *event, void *user_data) {
+    (void)user_data;
+
+    if (!event || !s_bin.file) return;
+
+    if (event->type == AC_TRACE_AGENT_START) {
+        /* A run that never ended is kept and indexed without an end time */
+        flush_block();
+        if (s_bin.in_run) {
+            write_index_entry();
+        }
+
+        reset_run_state();
+        memset(&s_bin.run, 0, sizeof(s_bin.run));
+        snprintf(s_bin.run.trace_id, sizeof(s_bin.run.trace_id), "%s",
+                 event->trace_id ? event->trace_id : "");
+        snprintf(s_bin.run.agent_name, sizeof(s_bin.run.agent_name), "%s",
+                 event->agent_name ? event->agent_name : "agent");
+        s_bin.run.offset = s_bin.file_end;
+        s_bin.run.start_ms = event->timestamp_ms;
+        s_bin.in_run = 1;
+        s_bin.block_run_start = 1;
+    }
+
+    if (!s_bin.in_run) return;
+
+    encode_event(event);
+
+    if (event->type == AC_TRACE_AGENT_END) {
+        s_bin.run.end_ms = event->timestamp_ms;
+        if (flush_block() == 0) {
+            write_index_entry();
+        }
+        s_bin.in_run = 0;
+        reset_run_state();
+    } else if (s_bin.config.flush_after_event ||
+               s_bin.block.len >= s_bin.config.block_size) {
+        flush_block();
+    }
+}
+
+/*============================================================================
+ * File Setup
+ *============================================================================*/
+
+static int ensure_dir(const char *path) {
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        return S_ISDIR(st.st_mode) ? 0 : -1;
+    }
+    if (mkdir_p(path) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    return 0;
+}
+
+static int write_file_header(FILE *f, const char *magic) {
+    uint8_t hdr[ACT_FILE_HEADER_SIZE] = {0};
+    memcpy(hdr, magic, 8);
+    act_put_u32(hdr + 8, ACT_FORMAT_VERSION);
+    return fwrite(hdr, 1, sizeof(hdr), f) == sizeof(hdr) ? 0 : -1;
+}
+
+static int check_file_header(FILE *f, const char *magic) {
+    uint8_t hdr[ACT_FILE_HEADER_SIZE];
+    if (act_seek(f, 0) != 0 || fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr)) {
+        return -1;
+    }
+    if (memcmp(hdr, magic, 8) != 0 || act_get_u32(hdr + 8) != ACT_FORMAT_VERSION) {
+        return -1;
+    }
+    return 0;
+}
+
+static void note_run_start(uint64_t offset, void *ud) {
+    *(uint64_t *)ud = offset;
+}
+
+/**
+ * Check that the index covers the last run in the data file.
+ */
+static int index_is_current(uint64_t last_run_offset) {
+    FILE *idx = fopen(s_bin.index_path, "rb");
+    if (!idx) {
+        return last_run_offset == 0;
+    }
+
+    int ok = 0;
+    if (check_file_header(idx, ACT_INDEX_MAGIC) == 0) {
+        fseek(idx, 0, SEEK_END);
+        long size = ftell(idx);
+        long entries = (size - ACT_FILE_HEADER_SIZE) / ACT_INDEX_ENTRY_SIZE;
+        if (entries == 0) {
+            ok = last_run_offset == 0;
+        } else {
+            uint8_t raw[ACT_INDEX_ENTRY_SIZE];
+            act_index_entry_t e;
+            fseek(idx, ACT_FILE_HEADER_SIZE + (entries - 1) * ACT_INDEX_ENTRY_SIZE, SEEK_SET);
+            if (fread(raw, 1, sizeof(raw), idx) == sizeof(raw)) {
+                act_index_entry_decode(raw, &e);
+                ok = e.offset == last_run_offset;
+            }
+        }
+    }
+    fclose(idx);
+    return ok;
+}
+
+/**
+ * Open the trace file for appending. An existing file is validated and
+ * truncated after its last intact block so new data is never appended
+ * behind a torn write.
+ */
+static int open_trace_file(void) {
+    FILE *f = fopen(s_bin.current_path, "r+b");
+    int recovered = 0;
+
+    if (f) {
+        if (check_file_header(f, ACT_FILE_MAGIC) != 0) {
+            fprintf(stderr, "[TRACE] %s is not a binary trace file\n", s_bin.current_path);
+            fclose(f);
+            return -1;
+        }
+        uint64_t last_run = 0;
+        s_bin.file_end = act_scan_blocks(f, ACT_FILE_HEADER_SIZE, note_run_start, &last_run);
+        recovered = !index_is_current(last_run);
+
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        if (size >= 0 && (uint64_t)size > s_bin.file_end) {
+            fflush(f);
+            if (truncate_file(f, s_bin.file_end) != 0) {
+                fprintf(stderr, "[TRACE] Failed to truncate torn tail of %s\n",
+                        s_bin.current_path);
+            }
+            recovered = 1;
+        }
+        act_seek(f, s_bin.file_end);
+    } else {
+        f = fopen(s_bin.current_path, "w+b");
+        if (!f) {
+            fprintf(stderr, "[TRACE] Failed to open %s: %s\n",
+                    s_bin.current_path, strerror(errno));
+            return -1;
+        }
+        if (write_file_header(f, ACT_FILE_MAGIC) != 0) {
+            fclose(f);
+            return -1;
+        }
+        fflush(f);
+        s_bin.file_end = ACT_FILE_HEADER_SIZE;
+    }
+
+    s_bin.file = f;
+
+    /* After a crash the index may miss or mis-point runs; rebuild it */
+    if (recovered) {
+        ac_trace_binary_rebuild_index(s_bin.current_path);
+    }
+
+    FILE *idx = fopen(s_bin.index_path, "r+b");
+    if (idx && check_file_header(idx, ACT_INDEX_MAGIC) == 0) {
+        /* Drop a partially written trailing entry */
+        fseek(idx, 0, SEEK_END);
+        long size = ftell(idx);
+        long entries = (size - ACT_FILE_HEADER_SIZE) / ACT_INDEX_ENTRY_SIZE;
+        long valid = ACT_FILE_HEADER_SIZE + entries * ACT_INDEX_ENTRY_SIZE;
+        if (size != valid) {
+            fflush(idx);
+            truncate_file(idx, valid);
+        }
+        fseek(idx, valid, SEEK_SET);
+    } else {
+        if (idx) fclose(idx);
+        idx = fopen(s_bin.index_path, "wb");
+        if (idx && write_file_header(idx, ACT_INDEX_MAGIC) != 0) {
+            fclose(idx);
+            idx = NULL;
+        }
+        /* Index is an accelerator only; readers fall back to scanning */
+        if (idx) {
+            fflush(idx);
+        } else {
+            fprintf(stderr, "[TRACE] Failed to open index %s\n", s_bin.index_path);
+        }
+    }
+    s_bin.index = idx;
+
+    return 0;
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+int ac_trace_binary_exporter_init(const ac_trace_binary_config_t *config) {
+    ac_trace_binary_exporter_cleanup();
+
+    if (config) {
+        s_bin.config = *config;
+    }
+    if (!s_bin.config.output_dir) {
+        s_bin.config.output_dir = AC_TRACE_JSON_DEFAULT_DIR;
+    }
+    if (s_bin.config.block_size == 0) {
+        s_bin.config.block_size = AC_TRACE_BINARY_DEFAULT_BLOCK_SIZE;
+    }
+
+    if (!act_codec_available((int)s_bin.config.compression)) {
+        fprintf(stderr, "[TRACE] Compression codec %d not compiled in, writing uncompressed\n",
+                (int)s_bin.config.compression);
+        s_bin.config.compression = AC_TRACE_COMPRESS_NONE;
+    }
+
+    if (ensure_dir(s_bin.config.output_dir) != 0) {
+        fprintf(stderr, "[TRACE] Failed to create directory: %s\n",
+                s_bin.config.output_dir);
+        return -1;
+    }
+
+    if (s_bin.config.file_name) {
+        snprintf(s_bin.current_path, sizeof(s_bin.current_path), "%s/%s",
+                 s_bin.config.output_dir, s_bin.config.file_name);
+    } else {
+        time_t now = time(NULL);
+        struct tm *tm_info = localtime(&now);
+        snprintf(s_bin.current_path, sizeof(s_bin.current_path),
+                 "%s/trace_%04d%02d%02d_%02d%02d%02d%s",
+                 s_bin.config.output_dir,
+                 tm_info->tm_year + 1900, tm_info->tm_mon + 1, tm_info->tm_mday,
+                 tm_info->tm_hour, tm_info->tm_min, tm_info->tm_sec,
+                 AC_TRACE_BINARY_EXT);
+    }
+    snprintf(s_bin.index_path, sizeof(s_bin.index_path), "%s.idx", s_bin.current_path);
+
+    if (open_trace_file() != 0) {
+        return -1;
+    }
+
+    ac_trace_enable(binary_trace_handler, NULL);
+
+    s_bin.initialized = 1;
+
+    return 0;
+}
+
+void ac_trace_binary_exporter_cleanup(void) {
+    if (s_bin.file) {
+        /* Persist an unfinished run; it is indexed without an end time */
+        flush_block();
+        if (s_bin.in_run) {
+            write_index_entry();
+        }
+        fclose(s_bin.file);
+    }
+    if (s_bin.index) {
+        fclose(s_bin.index);
+    }
+
+    if (s_bin.initialized) {
+        ac_trace_disable();
+    }
+
+    reset_run_state();
+    buf_free(&s_bin.block);
+    buf_free(&s_bin.record);
+    memset(&s_bin, 0, sizeof(s_bin));
+}
+
+const char *ac_trace_binary_exporter_get_path(void) {
+    if (s_bin.current_path[0]) {
+        return s_bin.current_path;
+    }
+    return NULL;
+}
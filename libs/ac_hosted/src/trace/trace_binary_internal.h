@@ -0,0 +1,203 @@
+/**
+ * @file trace_binary_internal.h
+ * @brief Binary trace format internals
+ *
+ * Shared between the binary exporter (writer) and the reader.
+ * This header is NOT part of the public API.
+ *
+ * File layout (all integers little-endian):
+ *
+ *   header  : "ACTRACE\0" | u32 version | u32 reserved          (16 bytes)
+ *   block*  : u32 magic | u8 codec | u8 flags | u16 reserved |
+ *             u32 raw_len | u32 stored_len | u32 crc32(stored)   (20 bytes)
+ *             + stored_len bytes of (optionally compressed) records
+ *
+ * A block is only valid if its header is complete, its payload is fully
+ * present and the CRC matches. Readers stop at the first invalid block, so
+ * a crash mid-write loses at most the block being written.
+ *
+ * Every run (agent_start .. agent_end) begins a new block flagged with
+ * ACT_BLOCK_RUN_START and resets all per-run state (string table, delta
+ * slots, timestamps), so a run can be decoded starting from its offset.
+ *
+ * Records inside a block:
+ *
+ *   varint payload_len | u8 record_type | payload
+ *
+ *   ACT_REC_STRING : varint id | varint len | bytes   (intern definition)
+ *   ACT_REC_EVENT  : u8 event_type | svarint ts_delta | varint sequence |
+ *                    per-event fields (see trace_binary_exporter.c)
+ *
+ * An svarint is a zigzag-encoded signed varint: (v << 1) ^ (v >> 63).
+ *
+ * String fields are encoded as a varint tag followed by data:
+ *
+ *   ACT_STR_NULL   : (nothing)
+ *   ACT_STR_INLINE : varint len | bytes
+ *   ACT_STR_REF    : varint id                        (interned string)
+ *   ACT_STR_DELTA  : varint prefix_len | varint suffix_len | bytes
+ *                    (prefix of the previous value of the same slot)
+ *
+ * Index sidecar (<file>.idx): "ACTIDX\0\0" | u32 version | u32 reserved,
+ * followed by fixed ACT_INDEX_ENTRY_SIZE entries, one per completed run.
+ */
+
+#ifndef ARC_TRACE_BINARY_INTERNAL_H
+#define ARC_TRACE_BINARY_INTERNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*============================================================================
+ * Format Constants
+ *============================================================================*/
+
+#define ACT_FILE_MAGIC          "ACTRACE"       /* 7 chars + NUL = 8 bytes */
+#define ACT_INDEX_MAGIC         "ACTIDX\0"      /* 7 chars + NUL = 8 bytes */
+#define ACT_FORMAT_VERSION      1
+#define ACT_FILE_HEADER_SIZE    16
+
+#define ACT_BLOCK_MAGIC         0x31425441u     /* "ATB1" */
+#define ACT_BLOCK_HEADER_SIZE   20
+#define ACT_BLOCK_RUN_START     0x01
+
+#define ACT_INDEX_ENTRY_SIZE    128
+#define ACT_TRACE_ID_LEN        32
+#define ACT_AGENT_NAME_LEN      64
+
+/* Block codecs */
+#define ACT_CODEC_NONE          0
+#define ACT_CODEC_LZ4           1
+#define ACT_CODEC_ZSTD          2
+
+/* Record types */
+#define ACT_REC_STRING          0x01
+#define ACT_REC_EVENT           0x02
+
+/* String field tags */
+#define ACT_STR_NULL            0
+#define ACT_STR_INLINE          1
+#define ACT_STR_REF             2
+#define ACT_STR_DELTA           3
+
+/* Delta slots (large fields that grow incrementally across a run) */
+#define ACT_SLOT_MESSAGES       0
+#define ACT_SLOT_TOOLS          1
+#define ACT_SLOT_COUNT          2
+
+/* Strings up to this size are interned; larger ones are written inline */
+#define ACT_INTERN_MAX_LEN      256
+
+/* Upper bound on a decoded block, rejects corrupt length fields */
+#define ACT_MAX_BLOCK_SIZE      (64u * 1024u * 1024u)
+
+/*============================================================================
+ * Block Header
+ *============================================================================*/
+
+typedef struct {
+    uint32_t magic;
+    uint8_t codec;
+    uint8_t flags;
+    uint32_t raw_len;
+    uint32_t stored_len;
+    uint32_t crc;
+} act_block_header_t;
+
+/*============================================================================
+ * Index Entry
+ *============================================================================*/
+
+typedef struct {
+    char trace_id[ACT_TRACE_ID_LEN];
+    char agent_name[ACT_AGENT_NAME_LEN];
+    uint64_t offset;
+    uint64_t start_ms;
+    uint64_t end_ms;
+    uint32_t event_count;
+    uint32_t flags;
+} act_index_entry_t;
+
+/*============================================================================
+ * Encoding Helpers (trace_binary_common.c)
+ *============================================================================*/
+
+uint32_t act_crc32(const void *data, size_t len);
+
+void act_put_u16(uint8_t *p, uint16_t v);
+void act_put_u32(uint8_t *p, uint32_t v);
+void act_put_u64(uint8_t *p, uint64_t v);
+uint16_t act_get_u16(const uint8_t *p);
+uint32_t act_get_u32(const uint8_t *p);
+uint64_t act_get_u64(const uint8_t *p);
+
+/**
+ * @brief Encode an unsigned LEB128 varint
+ * @return Bytes written (1..10)
+ */
+size_t act_varint_encode(uint8_t *out, uint64_t v);
+
+/**
+ * @brief Decode an unsigned LEB128 varint
+ * @return Bytes consumed, or 0 if truncated/overlong
+ */
+size_t act_varint_decode(const uint8_t *p, size_t avail, uint64_t *out);
+
+void act_block_header_encode(uint8_t out[ACT_BLOCK_HEADER_SIZE], const act_block_header_t *h);
+int act_block_header_decode(const uint8_t in[ACT_BLOCK_HEADER_SIZE], act_block_header_t *h);
+
+void act_index_entry_encode(uint8_t out[ACT_INDEX_ENTRY_SIZE], const act_index_entry_t *e);
+void act_index_entry_decode(const uint8_t in[ACT_INDEX_ENTRY_SIZE], act_index_entry_t *e);
+
+/**
+ * @brief Compress a block payload with the given codec
+ *
+ * @param codec  Requested codec (may be downgraded to ACT_CODEC_NONE)
+ * @param out    Receives a malloc'd buffer, or NULL when stored uncompressed
+ * @return Codec actually used
+ */
+int act_compress(int codec, const uint8_t *src, size_t len,
+                 uint8_t **out, size_t *out_len);
+
+/**
+ * @brief Decompress a block payload into a buffer of exactly raw_len bytes
+ * @return 0 on success, -1 on error or unsupported codec
+ */
+int act_decompress(int codec, const uint8_t *src, size_t len,
+                   uint8_t *dst, size_t raw_len);
+
+/**
+ * @brief Check whether a codec is compiled in
+ */
+int act_codec_available(int codec);
+
+/**
+ * @brief Scan a trace file and return the end offset of the last valid block
+ *
+ * Used by the writer to drop a torn tail before appending, and by the
+ * reader to locate runs that are missing from the index.
+ *
+ * @param f            Open file (position is changed)
+ * @param from         Offset of the first block to examine
+ * @param on_run_start Optional callback for every run-start block
+ * @return Offset just past the last valid block
+ */
+uint64_t act_scan_blocks(FILE *f, uint64_t from,
+                         void (*on_run_start)(uint64_t offset, void *ud),
+                         void *ud);
+
+/**
+ * @brief Portable 64-bit seek
+ */
+int act_seek(FILE *f, uint64_t offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARC_TRACE_BINARY_INTERNAL_H */
@@ -0,0 +1,650 @@
+/**
+ * @file trace_binary_reader.c
+ * @brief Reader for binary trace files
+ *
+ * Decodes files written by trace_binary_exporter.c back into
+ * ac_trace_event_t and replays them through a regular trace handler, so
+ * existing exporters and tools can consume binary traces.
+ */
+
+#include "arc/trace_exporters.h"
+#include "arc/trace.h"
+#include "trace_binary_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * Reader State
+ *============================================================================*/
+
+struct ac_trace_reader {
+    FILE *file;
+    ac_trace_run_info_t *runs;
+    size_t run_count;
+    size_t run_cap;
+};
+
+typedef struct {
+    char **strings;
+    size_t *string_lens;
+    size_t string_count;
+    size_t string_cap;
+    char *slot[ACT_SLOT_COUNT];
+    size_t slot_len[ACT_SLOT_COUNT];
+    uint64_t last_ts;
+
+    /* Inline strings allocated for the event being decoded */
+    char *temps[16];
+    int temp_count;
+} act_decoder_t;
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    int error;
+} cursor_t;
+
+/*============================================================================
+ * Decoder
+ *============================================================================*/
+
+static void decoder_free_temps(act_decoder_t *d) {
+    for (int i = 0; i < d->temp_count; i++) {
+        free(d->temps[i]);
+    }
+    d->temp_count = 0;
+}
+
+static void decoder_free(act_decoder_t *d) {
+    decoder_free_temps(d);
+    for (size_t i = 0; i < d->string_count; i++) {
+        free(d->strings[i]);
+    }
+    free(d->strings);
+    free(d->string_lens);
+    for (int i = 0; i < ACT_SLOT_COUNT; i++) {
+        free(d->slot[i]);
+    }
+    memset(d, 0, sizeof(*d));
+}
+
+static uint64_t get_varint(cursor_t *c) {
+    uint64_t v = 0;
+    size_t n = act_varint_decode(c->p, (size_t)(c->end - c->p), &v);
+    if (n == 0) {
+        c->error = 1;
+        return 0;
+    }
+    c->p += n;
+    return v;
+}
+
+static int64_t get_svarint(cursor_t *c) {
+    uint64_t v = get_varint(c);
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static uint8_t get_u8(cursor_t *c) {
+    if (c->p >= c->end) {
+        c->error = 1;
+        return 0;
+    }
+    return *c->p++;
+}
+
+static const uint8_t *get_bytes(cursor_t *c, uint64_t len) {
+    if ((uint64_t)(c->end - c->p) < len) {
+        c->error = 1;
+        return NULL;
+    }
+    const uint8_t *p = c->p;
+    c->p += len;
+    return p;
+}
+
+static char *dup_bytes(const uint8_t *p, size_t len) {
+    char *s = malloc(len + 1);
+    if (s) {
+        memcpy(s, p, len);
+        s[len] = '\0';
+    }
+    return s;
+}
+
+static const char *get_str(act_decoder_t *d, cursor_t *c) {
+    uint64_t tag = get_varint(c);
+
+    switch (tag) {
+        case ACT_STR_NULL:
+            return NULL;
+
+        case ACT_STR_REF: {
+            uint64_t id = get_varint(c);
+            if (c->error || id >= d->string_count || !d->strings[id]) {
+                c->error = 1;
+                return NULL;
+            }
+            return d->strings[id];
+        }
+
+        case ACT_STR_INLINE: {
+            uint64_t len = get_varint(c);
+            const uint8_t *p = get_bytes(c, len);
+            if (!p || d->temp_count >= (int)(sizeof(d->temps) / sizeof(d->temps[0]))) {
+                c->error = 1;
+                return NULL;
+            }
+            char *s = dup_bytes(p, (size_t)len);
+            if (!s) {
+                c->error = 1;
+                return NULL;
+            }
+            d->temps[d->temp_count++] = s;
+            return s;
+        }
+
+        default:
+            c->error = 1;
+            return NULL;
+    }
+}
+
+static const char *get_slot_str(act_decoder_t *d, cursor_t *c, int slot) {
+    const uint8_t *mark = c->p;
+    uint64_t tag = get_varint(c);
+    size_t prefix = 0;
+    const uint8_t *suffix = NULL;
+    uint64_t suffix_len = 0;
+
+    if (tag == ACT_STR_NULL) {
+        return NULL;
+    }
+    if (tag == ACT_STR_DELTA) {
+        prefix = (size_t)get_varint(c);
+        suffix_len = get_varint(c);
+        suffix = get_bytes(c, suffix_len);
+        if (c->error || prefix > d->slot_len[slot]) {
+            c->error = 1;
+            return NULL;
+        }
+    } else if (tag == ACT_STR_INLINE) {
+        suffix_len = get_varint(c);
+        suffix = get_bytes(c, suffix_len);
+        if (c->error) return NULL;
+    } else {
+        c->p = mark;
+        return get_str(d, c);
+    }
+
+    size_t len = prefix + (size_t)suffix_len;
+    char *s = malloc(len + 1);
+    if (!s) {
+        c->error = 1;
+        return NULL;
+    }
+    if (prefix) memcpy(s, d->slot[slot], prefix);
+    if (suffix_len) memcpy(s + prefix, suffix, (size_t)suffix_len);
+    s[len] = '\0';
+
+    free(d->slot[slot]);
+    d->slot[slot] = s;
+    d->slot_len[slot] = len;
+    return s;
+}
+
+static int define_string(act_decoder_t *d, cursor_t *c) {
+    uint64_t id = get_varint(c);
+    uint64_t len = get_varint(c);
+    const uint8_t *p = get_bytes(c, len);
+    if (c->error || id > ACT_MAX_BLOCK_SIZE) {
+        return -1;
+    }
+
+    if (id >= d->string_cap) {
+        size_t cap = d->string_cap ? d->string_cap : 64;
+        while (cap <= id) cap *= 2;
+        char **strings = realloc(d->strings, cap * sizeof(char *));
+        if (!strings) return -1;
+        d->strings = strings;
+        size_t *lens = realloc(d->string_lens, cap * sizeof(size_t));
+        if (!lens) return -1;
+        d->string_lens = lens;
+        memset(d->strings + d->string_cap, 0, (cap - d->string_cap) * sizeof(char *));
+        d->string_cap = cap;
+    }
+
+    free(d->strings[id]);
+    d->strings[id] = dup_bytes(p, (size_t)len);
+    d->string_lens[id] = (size_t)len;
+    if (id >= d->string_count) {
+        d->string_count = (size_t)id + 1;
+    }
+    return d->strings[id] ? 0 : -1;
+}
+
+static int decode_event(act_decoder_t *d, cursor_t *c, ac_trace_event_t *ev) {
+    memset(ev, 0, sizeof(*ev));
+
+    ev->type = (ac_trace_event_type_t)get_u8(c);
+    d->last_ts += (uint64_t)get_svarint(c);
+    ev->timestamp_ms = d->last_ts;
+    ev->sequence = (int)get_varint(c);
+    ev->trace_id = get_str(d, c);
+    ev->agent_name = get_str(d, c);
+
+    switch (ev->type) {
+        case AC_TRACE_AGENT_START: {
+            ac_trace_agent_start_t *x = &ev->data.agent_start;
+            x->message = get_str(d, c);
+            x->instructions = get_str(d, c);
+            x->max_iterations = (int)get_svarint(c);
+            x->tool_count = (size_t)get_varint(c);
+            break;
+        }
+        case AC_TRACE_AGENT_END: {
+            ac_trace_agent_end_t *x = &ev->data.agent_end;
+            x->content = get_str(d, c);
+            x->iterations = (int)get_svarint(c);
+            x->total_prompt_tokens = (int)get_svarint(c);
+            x->total_completion_tokens = (int)get_svarint(c);
+            x->duration_ms = get_varint(c);
+            break;
+        }
+        case AC_TRACE_ITER_START:
+        case AC_TRACE_ITER_END:
+            ev->data.iter.iteration = (int)get_svarint(c);
+            ev->data.iter.max_iterations = (int)get_svarint(c);
+            break;
+        case AC_TRACE_LLM_REQUEST: {
+            ac_trace_llm_request_t *x = &ev->data.llm_request;
+            x->model = get_str(d, c);
+            x->messages_json = get_slot_str(d, c, ACT_SLOT_MESSAGES);
+            x->tools_json = get_slot_str(d, c, ACT_SLOT_TOOLS);
+            x->message_count = (size_t)get_varint(c);
+            break;
+        }
+        case AC_TRACE_LLM_RESPONSE: {
+            ac_trace_llm_response_t *x = &ev->data.llm_response;
+            x->content = get_str(d, c);
+            x->tool_calls_json = get_str(d, c);
+            x->tool_call_count = (int)get_svarint(c);
+            x->prompt_tokens = (int)get_svarint(c);
+            x->completion_tokens = (int)get_svarint(c);
+            x->total_tokens = (int)get_svarint(c);
+            x->finish_reason = get_str(d, c);
+            x->duration_ms = get_varint(c);
+            break;
+        }
+        case AC_TRACE_TOOL_START: {
+            ac_trace_tool_start_t *x = &ev->data.tool_start;
+            x->id = get_str(d, c);
+            x->name = get_str(d, c);
+            x->arguments = get_str(d, c);
+            break;
+        }
+        case AC_TRACE_TOOL_END: {
+            ac_trace_tool_end_t *x = &ev->data.tool_end;
+            x->id = get_str(d, c);
+            x->name = get_str(d, c);
+            x->result = get_str(d, c);
+            x->duration_ms = get_varint(c);
+            x->success = (int)get_svarint(c);
+            break;
+        }
+        default:
+            /* Unknown event type from a newer writer: skip the record */
+            return 1;
+    }
+
+    return c->error ? -1 : 0;
+}
+
+/*============================================================================
+ * Run Decoding
+ *============================================================================*/
+
+/**
+ * Decode all events of the run starting at `offset`.
+ * Returns the number of events delivered, or -1 if nothing could be read.
+ */
+static int decode_run(FILE *f, uint64_t offset,
+                      ac_trace_handler_t handler, void *user_data) {
+    act_decoder_t dec = {0};
+    uint8_t *stored = NULL;
+    uint8_t *raw = NULL;
+    size_t stored_cap = 0;
+    size_t raw_cap = 0;
+    int events = 0;
+    int first = 1;
+
+    if (act_seek(f, offset) != 0) {
+        return -1;
+    }
+
+    for (;;) {
+        uint8_t hdr[ACT_BLOCK_HEADER_SIZE];
+        act_block_header_t h;
+
+        if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr)) break;
+        if (act_block_header_decode(hdr, &h) != 0) break;
+
+        int run_start = (h.flags & ACT_BLOCK_RUN_START) != 0;
+        if (first ? !run_start : run_start) break;
+
+        if (h.stored_len > stored_cap) {
+            uint8_t *grown = realloc(stored, h.stored_len);
+            if (!grown) break;
+            stored = grown;
+            stored_cap = h.stored_len;
+        }
+        if (h.raw_len > raw_cap) {
+            uint8_t *grown = realloc(raw, h.raw_len);
+            if (!grown) break;
+            raw = grown;
+            raw_cap = h.raw_len;
+        }
+        if (h.stored_len > 0 && fread(stored, 1, h.stored_len, f) != h.stored_len) break;
+        if (act_crc32(stored, h.stored_len) != h.crc) break;
+        if (act_decompress(h.codec, stored, h.stored_len, raw, h.raw_len) != 0) break;
+        first = 0;                      /* A run is readable once its first block checks out */
+
+        cursor_t block = { raw, raw + h.raw_len, 0 };
+        while (block.p < block.end) {
+            uint64_t len = get_varint(&block);
+            const uint8_t *body = get_bytes(&block, len);
+            if (block.error || len == 0) {
+                goto done;
+            }
+
+            cursor_t rec = { body, body + len, 0 };
+            uint8_t type = get_u8(&rec);
+
+            if (type == ACT_REC_STRING) {
+                if (define_string(&dec, &rec) != 0) goto done;
+            } else if (type == ACT_REC_EVENT) {
+                ac_trace_event_t ev;
+                int rc = decode_event(&dec, &rec, &ev);
+                if (rc < 0) {
+                    decoder_free_temps(&dec);
+                    goto done;
+                }
+                if (rc == 0) {
+                    events++;
+                    if (handler) handler(&ev, user_data);
+                }
+                decoder_free_temps(&dec);
+            }
+            /* Unknown record types are skipped for forward compatibility */
+        }
+    }
+
+done:
+    free(stored);
+    free(raw);
+    decoder_free(&dec);
+    return first ? -1 : events;
+}
+
+typedef struct {
+    ac_trace_run_info_t *info;
+} run_summary_ctx_t;
+
+static void summarize_handler(const ac_trace_event_t *event, void *user_data) {
+    ac_trace_run_info_t *info = ((run_summary_ctx_t *)user_data)->info;
+
+    if (event->type == AC_TRACE_AGENT_START) {
+        snprintf(info->trace_id, sizeof(info->trace_id), "%s",
+                 event->trace_id ? event->trace_id : "");
+        snprintf(info->agent_name, sizeof(info->agent_name), "%s",
+                 event->agent_name ? event->agent_name : "");
+        info->start_ms = event->timestamp_ms;
+    } else if (event->type == AC_TRACE_AGENT_END) {
+        info->end_ms = event->timestamp_ms;
+        info->complete = 1;
+    }
+    info->event_count++;
+}
+
+/*============================================================================
+ * Run Table
+ *============================================================================*/
+
+static ac_trace_run_info_t *add_run(ac_trace_reader_t *r) {
+    if (r->run_count == r->run_cap) {
+        size_t cap = r->run_cap ? r->run_cap * 2 : 16;
+        ac_trace_run_info_t *runs = realloc(r->runs, cap * sizeof(*runs));
+        if (!runs) return NULL;
+        r->runs = runs;
+        r->run_cap = cap;
+    }
+    ac_trace_run_info_t *info = &r->runs[r->run_count++];
+    memset(info, 0, sizeof(*info));
+    return info;
+}
+
+static int is_run_start_block(FILE *f, uint64_t offset) {
+    uint8_t hdr[ACT_BLOCK_HEADER_SIZE];
+    act_block_header_t h;
+    if (act_seek(f, offset) != 0 ||
+        fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr) ||
+        act_block_header_decode(hdr, &h) != 0) {
+        return 0;
+    }
+    return (h.flags & ACT_BLOCK_RUN_START) != 0;
+}
+
+static void load_index(ac_trace_reader_t *r, const char *path) {
+    char idx_path[1024];
+    snprintf(idx_path, sizeof(idx_path), "%s.idx", path);
+
+    FILE *idx = fopen(idx_path, "rb");
+    if (!idx) return;
+
+    uint8_t hdr[ACT_FILE_HEADER_SIZE];
+    if (fread(hdr, 1, sizeof(hdr), idx) != sizeof(hdr) ||
+        memcmp(hdr, ACT_INDEX_MAGIC, 8) != 0 ||
+        act_get_u32(hdr + 8) != ACT_FORMAT_VERSION) {
+        fclose(idx);
+        return;
+    }
+
+    uint8_t raw[ACT_INDEX_ENTRY_SIZE];
+    uint64_t last_offset = 0;
+    while (fread(raw, 1, sizeof(raw), idx) == sizeof(raw)) {
+        act_index_entry_t e;
+        act_index_entry_decode(raw, &e);
+
+        /* Entries must be ordered and point at a run-start block */
+        if (e.offset <= last_offset || !is_run_start_block(r->file, e.offset)) {
+            break;
+        }
+        last_offset = e.offset;
+
+        ac_trace_run_info_t *info = add_run(r);
+        if (!info) break;
+        memcpy(info->trace_id, e.trace_id, sizeof(info->trace_id));
+        memcpy(info->agent_name, e.agent_name, sizeof(info->agent_name));
+        info->offset = e.offset;
+        info->start_ms = e.start_ms;
+        info->end_ms = e.end_ms;
+        info->event_count = e.event_count;
+        info->complete = e.end_ms != 0;
+    }
+
+    fclose(idx);
+}
+
+typedef struct {
+    uint64_t *offsets;
+    size_t count;
+    size_t cap;
+} offset_list_t;
+
+static void collect_run_start(uint64_t offset, void *ud) {
+    offset_list_t *list = (offset_list_t *)ud;
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 16;
+        uint64_t *grown = realloc(list->offsets, cap * sizeof(uint64_t));
+        if (!grown) return;
+        list->offsets = grown;
+        list->cap = cap;
+    }
+    list->offsets[list->count++] = offset;
+}
+
+/**
+ * Find runs that are not in the index (crash, missing index) by scanning
+ * from the last indexed run to the end of valid data.
+ */
+static void scan_tail(ac_trace_reader_t *r) {
+    /*
+     * The index is written after the data, so only its last entries can
+     * outlive a torn or truncated tail: re-read the last indexed run and
+     * drop entries whose data is gone.
+     */
+    while (r->run_count > 0) {
+        ac_trace_run_info_t *last = &r->runs[r->run_count - 1];
+        ac_trace_run_info_t check = { .offset = last->offset };
+        run_summary_ctx_t ctx = { &check };
+        if (decode_run(r->file, last->offset, summarize_handler, &ctx) > 0) {
+            *last = check;
+            break;
+        }
+        r->run_count--;
+    }
+
+    uint64_t from = r->run_count > 0 ? r->runs[r->run_count - 1].offset : ACT_FILE_HEADER_SIZE;
+    uint64_t known = r->run_count > 0 ? from : 0;
+
+    offset_list_t list = {0};
+    act_scan_blocks(r->file, from, collect_run_start, &list);
+
+    for (size_t i = 0; i < list.count; i++) {
+        if (list.offsets[i] == known) continue;
+
+        ac_trace_run_info_t *info = add_run(r);
+        if (!info) break;
+        info->offset = list.offsets[i];
+
+        run_summary_ctx_t ctx = { info };
+        decode_run(r->file, info->offset, summarize_handler, &ctx);
+        /* add_run may have moved the array; info stays valid until next add */
+    }
+
+    free(list.offsets);
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+ac_trace_reader_t *ac_trace_reader_open(const char *path) {
+    if (!path) return NULL;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    uint8_t hdr[ACT_FILE_HEADER_SIZE];
+    if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr) ||
+        memcmp(hdr, ACT_FILE_MAGIC, 8) != 0 ||
+        act_get_u32(hdr + 8) != ACT_FORMAT_VERSION) {
+        fclose(f);
+        return NULL;
+    }
+
+    ac_trace_reader_t *r = calloc(1, sizeof(*r));
+    if (!r) {
+        fclose(f);
+        return NULL;
+    }
+    r->file = f;
+
+    load_index(r, path);
+    scan_tail(r);
+
+    return r;
+}
+
+void ac_trace_reader_close(ac_trace_reader_t *reader) {
+    if (!reader) return;
+    if (reader->file) fclose(reader->file);
+    free(reader->runs);
+    free(reader);
+}
+
+size_t ac_trace_reader_run_count(const ac_trace_reader_t *reader) {
+    return reader ? reader->run_count : 0;
+}
+
+const ac_trace_run_info_t *ac_trace_reader_run(const ac_trace_reader_t *reader, size_t index) {
+    if (!reader || index >= reader->run_count) return NULL;
+    return &reader->runs[index];
+}
+
+int ac_trace_reader_find_run(const ac_trace_reader_t *reader, const char *trace_id) {
+    if (!reader || !trace_id) return -1;
+    for (size_t i = 0; i < reader->run_count; i++) {
+        if (strcmp(reader->runs[i].trace_id, trace_id) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int ac_trace_reader_replay(ac_trace_reader_t *reader, size_t index,
+                           ac_trace_handler_t handler, void *user_data) {
+    if (!reader || index >= reader->run_count) return -1;
+    return decode_run(reader->file, reader->runs[index].offset, handler, user_data);
+}
+
+int ac_trace_binary_rebuild_index(const char *path) {
+    if (!path) return -1;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+
+    ac_trace_reader_t r = {0};
+    r.file = f;
+    scan_tail(&r);
+
+    char idx_path[1024];
+    char tmp_path[1040];
+    snprintf(idx_path, sizeof(idx_path), "%s.idx", path);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", idx_path);
+
+    int rc = -1;
+    FILE *out = fopen(tmp_path, "wb");
+    if (out) {
+        uint8_t hdr[ACT_FILE_HEADER_SIZE] = {0};
+        memcpy(hdr, ACT_INDEX_MAGIC, 8);
+        act_put_u32(hdr + 8, ACT_FORMAT_VERSION);
+        rc = fwrite(hdr, 1, sizeof(hdr), out) == sizeof(hdr) ? 0 : -1;
+
+        for (size_t i = 0; rc == 0 && i < r.run_count; i++) {
+            act_index_entry_t e = {0};
+            memcpy(e.trace_id, r.runs[i].trace_id, sizeof(e.trace_id));
+            memcpy(e.agent_name, r.runs[i].agent_name, sizeof(e.agent_name));
+            e.offset = r.runs[i].offset;
+            e.start_ms = r.runs[i].start_ms;
+            e.end_ms = r.runs[i].complete ? r.runs[i].end_ms : 0;
+            e.event_count = r.runs[i].event_count;
+
+            uint8_t raw[ACT_INDEX_ENTRY_SIZE];
+            act_index_entry_encode(raw, &e);
+            if (fwrite(raw, 1, sizeof(raw), out) != sizeof(raw)) rc = -1;
+        }
+
+        if (fclose(out) != 0) rc = -1;
+        if (rc == 0) {
+            remove(idx_path);
+            rc = rename(tmp_path, idx_path) == 0 ? 0 : -1;
+        } else {
+            remove(tmp_path);
+        }
+    }
+
+    fclose(f);
+    free(r.runs);
+    return rc == 0 ? (int)r.run_count : -1;
+}
@@ -5,6 +5,7 @@
 
 #include "arc/trace_exporters.h"
 #include "arc/trace.h"
+#include "arc/json_escape.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -85,21 +86,16 @@ static void write_json_string(FILE *f, const char *str) {
         return;
     }
 
+    char buf[8192];
+    size_t len = strlen(str);
+    size_t pos = 0;
+
     fputc('"', f);
-    for (const char *p = str; *p; p++) {
-        switch (*p) {
-            case '"':  fputs("\\\"", f); break;
-            case '\\': fputs("\\\\", f); break;
-            case '\n': fputs("\\n", f); break;
-            case '\r': fputs("\\r", f); break;
-            case '\t': fputs("\\t", f); break;
-            default:
-                if ((unsigned char)*p < 0x20) {
-                    fprintf(f, "\\u%04x", (unsigned char)*p);
-                } else {
-                    fputc(*p, f);
-                }
-        }
+    while (pos < len) {
+        size_t used = 0;
+        size_t n = ac_json_escape(buf, sizeof(buf), str + pos, len - pos, &used, NULL);
+        fwrite(buf, 1, n, f);
+        pos += used;
     }
     fputc('"', f);
 }
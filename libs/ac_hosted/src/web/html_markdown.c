@@ -0,0 +1,1165 @@
+/**
+ * @file html_markdown.c
+ * @brief Streaming HTML to Markdown conversion
+ *
+ * A small tokenizer (text, tags, comments, raw-text elements) that only
+ * keeps an unfinished token between feeds, and a writer that owes line
+ * breaks, list and quote prefixes and inline markers until content
+ * arrives, so empty elements leave no stray markup or blank lines.
+ */
+
+#include <arc/html_markdown.h>
+#include "web_internal.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define MAX_TAG_BYTES   (64 * 1024)     /* An unterminated "tag" longer than this is text */
+#define MAX_ENTITY      32              /* Longest character reference held back */
+#define MAX_LISTS       16
+#define MAX_ATTRS       32
+#define MAX_INLINE      16
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+typedef enum {
+    CHARSET_UTF8,
+    CHARSET_CP1252,                     /* Also what HTML means by ISO-8859-1 */
+} charset_t;
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} buf_t;
+
+typedef struct {
+    int ordered;
+    unsigned next;
+    size_t indent;                      /* Column of the item content */
+} list_t;
+
+typedef struct {
+    const char *name;
+    size_t name_len;
+    const char *value;                  /* Raw, references not decoded */
+    size_t value_len;
+} attr_t;
+
+typedef struct {
+    char name[32];                      /* Lower case */
+    int closing;
+    int self_closing;
+    attr_t attrs[MAX_ATTRS];
+    size_t attr_count;
+} tag_t;
+
+struct ac_html_md {
+    int markdown;                       /* Else plain text */
+    size_t max_output;
+    charset_t charset;
+    int charset_fixed;                  /* From the options: <meta> is ignored */
+    char *base_url;
+
+    buf_t in;                           /* Held back: an unfinished token */
+    buf_t out;
+    buf_t title;
+    int truncated;
+    int finished;
+    int oom;
+
+    /* Tokenizer */
+    char raw_tag[32];                   /* Inside script, style, textarea or title */
+    int in_comment;
+    int title_done;
+
+    /* Dropped subtree */
+    char skip_tag[32];
+    int skip_nest;
+
+    /* Writer */
+    int pending_breaks;                 /* Newlines owed before the next content */
+    int trailing_newlines;              /* At the end of out */
+    int at_line_start;
+    int space_pending;
+    int text_started;
+    char marker[48];                    /* List marker or heading prefix of the next line */
+    const char *opens[MAX_INLINE];      /* Open inline markers, innermost last */
+    int open_count;
+    int opens_written;                  /* The first ones; the rest wait for content */
+
+    int quote_depth;
+    int line_quote_depth;               /* Of the last line written */
+    list_t lists[MAX_LISTS];
+    int list_depth;
+
+    int pre_depth;
+    int pre_fence_pending;              /* Fence not written: the <pre> is still empty */
+    int pre_skip_newline;               /* A newline right after <pre> is not content */
+    char pre_lang[32];
+
+    char *href;                         /* Of the open link, resolved */
+
+    int table_depth;
+    int cell_depth;
+    int row_cells;
+    int table_rows;
+};
+
+/*============================================================================
+ * Buffers
+ *============================================================================*/
+
+static int buf_append(buf_t *b, const char *s, size_t n) {
+    if (b->len + n + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap * 2 : 1024;
+        while (cap < b->len + n + 1) cap *= 2;
+        char *data = realloc(b->data, cap);
+        if (!data) return -1;
+        b->data = data;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+    b->data[b->len] = '\0';
+    return 0;
+}
+
+/*============================================================================
+ * Character Decoding
+ *============================================================================*/
+
+/* windows-1252 0x80-0x9F; 0 where undefined */
+static const uint16_t CP1252_HIGH[32] = {
+    0x20AC, 0, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0, 0x017D, 0,
+    0, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0, 0x017E, 0x0178,
+};
+
+static const struct {
+    const char *name;
+    uint32_t cp;
+} ENTITIES[] = {
+    { "amp", '&' }, { "lt", '<' }, { "gt", '>' }, { "quot", '"' }, { "apos", '\'' },
+    { "nbsp", 0xA0 }, { "ensp", 0x2002 }, { "emsp", 0x2003 }, { "thinsp", 0x2009 },
+    { "zwj", 0x200D }, { "zwnj", 0x200C }, { "shy", 0xAD },
+    { "ndash", 0x2013 }, { "mdash", 0x2014 }, { "hellip", 0x2026 }, { "bull", 0x2022 },
+    { "middot", 0xB7 }, { "lsquo", 0x2018 }, { "rsquo", 0x2019 }, { "sbquo", 0x201A },
+    { "ldquo", 0x201C }, { "rdquo", 0x201D }, { "bdquo", 0x201E }, { "laquo", 0xAB },
+    { "raquo", 0xBB }, { "lsaquo", 0x2039 }, { "rsaquo", 0x203A }, { "prime", 0x2032 },
+    { "copy", 0xA9 }, { "reg", 0xAE }, { "trade", 0x2122 }, { "deg", 0xB0 },
+    { "plusmn", 0xB1 }, { "times", 0xD7 }, { "divide", 0xF7 }, { "minus", 0x2212 },
+    { "le", 0x2264 }, { "ge", 0x2265 }, { "ne", 0x2260 }, { "asymp", 0x2248 },
+    { "infin", 0x221E }, { "micro", 0xB5 }, { "para", 0xB6 }, { "sect", 0xA7 },
+    { "dagger", 0x2020 }, { "Dagger", 0x2021 }, { "permil", 0x2030 },
+    { "larr", 0x2190 }, { "uarr", 0x2191 }, { "rarr", 0x2192 }, { "darr", 0x2193 },
+    { "harr", 0x2194 }, { "lArr", 0x21D0 }, { "rArr", 0x21D2 }, { "hArr", 0x21D4 },
+    { "euro", 0x20AC }, { "pound", 0xA3 }, { "yen", 0xA5 }, { "cent", 0xA2 },
+    { "iexcl", 0xA1 }, { "iquest", 0xBF }, { "frac12", 0xBD }, { "frac14", 0xBC },
+    { "frac34", 0xBE }, { "sup2", 0xB2 }, { "sup3", 0xB3 }, { "ordm", 0xBA },
+    { "alpha", 0x3B1 }, { "beta", 0x3B2 }, { "gamma", 0x3B3 }, { "delta", 0x3B4 },
+    { "lambda", 0x3BB }, { "mu", 0x3BC }, { "pi", 0x3C0 }, { "sigma", 0x3C3 },
+    { "check", 0x2713 }, { "hyphen", 0x2010 }, { "Tab", '\t' }, { "NewLine", '\n' },
+    { "eacute", 0xE9 }, { "egrave", 0xE8 }, { "agrave", 0xE0 }, { "aacute", 0xE1 },
+    { "uuml", 0xFC }, { "ouml", 0xF6 }, { "auml", 0xE4 }, { "szlig", 0xDF },
+    { "ccedil", 0xE7 }, { "ntilde", 0xF1 },
+};
+
+static size_t utf8_encode(uint32_t cp, char *out) {
+    if (cp == 0 || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) cp = 0xFFFD;
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/*
+ * Character reference at s[0] == '&'. Returns the bytes it spans and
+ * its code point, or 0 if it is not one (the '&' is then literal).
+ */
+static size_t decode_reference(const char *s, size_t n, uint32_t *cp) {
+    size_t i = 1;
+    if (i < n && s[i] == '#') {
+        i++;
+        int hex = i < n && (s[i] == 'x' || s[i] == 'X');
+        if (hex) i++;
+        size_t start = i;
+        uint32_t value = 0;
+        while (i < n && (hex ? isxdigit((unsigned char)s[i]) : isdigit((unsigned char)s[i]))) {
+            int d = isdigit((unsigned char)s[i]) ? s[i] - '0' : (tolower((unsigned char)s[i]) - 'a' + 10);
+            if (value < 0x110000) value = value * (hex ? 16 : 10) + (uint32_t)d;
+            i++;
+        }
+        if (i == start) return 0;
+        if (i < n && s[i] == ';') i++;
+        /* Numeric references in 0x80-0x9F mean windows-1252, as browsers read them */
+        if (value >= 0x80 && value <= 0x9F && CP1252_HIGH[value - 0x80]) value = CP1252_HIGH[value - 0x80];
+        *cp = value;
+        return i;
+    }
+
+    while (i < n && i <= MAX_ENTITY && isalnum((unsigned char)s[i])) i++;
+    size_t name_len = i - 1;
+    if (name_len == 0) return 0;
+    int terminated = i < n && s[i] == ';';
+    for (size_t k = 0; k < sizeof(ENTITIES) / sizeof(ENTITIES[0]); k++) {
+        if (strlen(ENTITIES[k].name) == name_len && memcmp(ENTITIES[k].name, s + 1, name_len) == 0) {
+            /* Without ';' only the most common legacy names are taken */
+            if (!terminated && ENTITIES[k].cp > 0xFF) return 0;
+            *cp = ENTITIES[k].cp;
+            return i + (terminated ? 1 : 0);
+        }
+    }
+    return 0;
+}
+
+/*
+ * Decode n bytes of markup text (or an attribute value) to UTF-8 into
+ * out, which must hold 3 * n + 1 bytes. Returns the length.
+ */
+static size_t decode_text(charset_t charset, const char *s, size_t n, char *out) {
+    size_t o = 0;
+    for (size_t i = 0; i < n;) {
+        unsigned char ch = (unsigned char)s[i];
+        if (ch == '&') {
+            uint32_t cp;
+            size_t used = decode_reference(s + i, n - i, &cp);
+            if (used > 0) {
+                /* Only a reference of 3+ bytes can need 4 output bytes */
+                o += utf8_encode(cp, out + o);
+                i += used;
+                continue;
+            }
+        }
+        if (ch >= 0x80 && charset == CHARSET_CP1252) {
+            uint32_t cp = ch <= 0x9F ? CP1252_HIGH[ch - 0x80] : ch;
+            o += utf8_encode(cp ? cp : 0xFFFD, out + o);
+        } else {
+            out[o++] = (char)ch;
+        }
+        i++;
+    }
+    out[o] = '\0';
+    return o;
+}
+
+static int charset_from_label(const char *label, size_t len, charset_t *out) {
+    while (len > 0 && (*label == ' ' || *label == '"' || *label == '\'')) {
+        label++;
+        len--;
+    }
+    while (len > 0 && (label[len - 1] == ' ' || label[len - 1] == '"' || label[len - 1] == '\'' ||
+                       label[len - 1] == ';')) {
+        len--;
+    }
+    static const char *const cp1252[] = {
+        "iso-8859-1", "iso8859-1", "latin1", "l1", "windows-1252", "cp1252", "us-ascii", "ascii",
+    };
+    if (len == 5 && strncasecmp(label, "utf-8", 5) == 0) {
+        *out = CHARSET_UTF8;
+        return 1;
+    }
+    if (len == 4 && strncasecmp(label, "utf8", 4) == 0) {
+        *out = CHARSET_UTF8;
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(cp1252) / sizeof(cp1252[0]); i++) {
+        if (strlen(cp1252[i]) == len && strncasecmp(label, cp1252[i], len) == 0) {
+            *out = CHARSET_CP1252;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*============================================================================
+ * Output
+ *============================================================================*/
+
+static void out_write(ac_html_md_t *c, const char *s, size_t n) {
+    if (c->truncated || n == 0) return;
+    if (c->max_output && c->out.len + n > c->max_output) {
+        c->truncated = 1;
+        return;
+    }
+    if (buf_append(&c->out, s, n) != 0) {
+        c->oom = 1;
+        return;
+    }
+    size_t nl = 0;
+    while (nl < n && s[n - 1 - nl] == '\n') nl++;
+    c->trailing_newlines = nl == n ? c->trailing_newlines + (int)nl : (int)nl;
+}
+
+static void out_str(ac_html_md_t *c, const char *s) {
+    out_write(c, s, strlen(s));
+}
+
+/* Owe `n` line breaks (2 = blank line) before the next content */
+static void block(ac_html_md_t *c, int n) {
+    if (c->pre_depth) return;
+    if (c->cell_depth) {
+        c->space_pending = 1;           /* Table cells stay on one line */
+        return;
+    }
+    if (n > c->pending_breaks) c->pending_breaks = n;
+}
+
+/* Pay owed breaks, then the line prefix or a pending space, then openers */
+static void begin_content(ac_html_md_t *c) {
+    if (c->out.len == 0) {
+        c->at_line_start = 1;
+    } else if (c->pending_breaks) {
+        for (int i = c->trailing_newlines; i < c->pending_breaks; i++) {
+            /* A blank line inside a quote stays in it */
+            if (i > 0 && c->markdown) {
+                int depth = c->quote_depth < c->line_quote_depth ? c->quote_depth : c->line_quote_depth;
+                for (int q = 0; q < depth; q++) out_write(c, ">", 1);
+            }
+            out_write(c, "\n", 1);
+        }
+        c->at_line_start = 1;
+    }
+    c->pending_breaks = 0;
+
+    if (c->at_line_start) {
+        for (int i = 0; i < c->quote_depth; i++) out_str(c, c->markdown ? "> " : "  ");
+        c->line_quote_depth = c->quote_depth;
+        if (c->marker[0]) {
+            out_str(c, c->marker);
+            c->marker[0] = '\0';
+        } else if (c->list_depth) {
+            size_t indent = c->lists[(c->list_depth < MAX_LISTS ? c->list_depth : MAX_LISTS) - 1].indent;
+            for (size_t i = 0; i < indent; i++) out_write(c, " ", 1);
+        }
+        c->at_line_start = 0;
+    } else if (c->space_pending) {
+        out_write(c, " ", 1);
+    }
+    c->space_pending = 0;
+
+    for (; c->opens_written < c->open_count; c->opens_written++) out_str(c, c->opens[c->opens_written]);
+    c->text_started = 1;
+}
+
+static void open_inline(ac_html_md_t *c, const char *m) {
+    if (!c->markdown || c->pre_depth || c->open_count == MAX_INLINE) return;
+    c->opens[c->open_count++] = m;
+}
+
+/* Innermost open marker m, -1 if none */
+static int find_inline(const ac_html_md_t *c, const char *m) {
+    for (int k = c->open_count - 1; k >= 0; k--) {
+        if (strcmp(c->opens[k], m) == 0) return k;
+    }
+    return -1;
+}
+
+/* Returns whether the marker was written; one never written (the element
+   was empty) is dropped instead */
+static int remove_inline(ac_html_md_t *c, int k) {
+    int written = k < c->opens_written;
+    memmove(c->opens + k, c->opens + k + 1, (size_t)(c->open_count - k - 1) * sizeof(c->opens[0]));
+    c->open_count--;
+    if (written) c->opens_written--;
+    return written;
+}
+
+static void close_inline(ac_html_md_t *c, const char *closer) {
+    if (!c->markdown || c->pre_depth) return;
+    int k = find_inline(c, closer);
+    if (k >= 0 && remove_inline(c, k)) out_str(c, closer);
+}
+
+/* Preformatted text, as is */
+static void put_pre(ac_html_md_t *c, const char *s, size_t n) {
+    if (c->pre_skip_newline && n > 0) {
+        if (s[0] == '\r') {
+            s++;
+            n--;
+        }
+        if (n > 0 && s[0] == '\n') {
+            s++;
+            n--;
+        }
+        if (n > 0) c->pre_skip_newline = 0;
+    }
+    if (n == 0) return;
+    if (c->pre_fence_pending) {
+        begin_content(c);
+        if (c->markdown) {
+            out_str(c, "```");
+            out_str(c, c->pre_lang);
+            out_write(c, "\n", 1);
+        }
+        c->pre_fence_pending = 0;
+    }
+    size_t start = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (s[i] == '\r') {
+            out_write(c, s + start, i - start);
+            start = i + 1;
+        }
+    }
+    out_write(c, s + start, n - start);
+}
+
+static int is_space(const char *s, size_t n, size_t i, size_t *width) {
+    unsigned char ch = (unsigned char)s[i];
+    *width = 1;
+    if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f') return 1;
+    if (ch == 0xC2 && i + 1 < n && (unsigned char)s[i + 1] == 0xA0) {
+        *width = 2;                     /* No-break space */
+        return 1;
+    }
+    return 0;
+}
+
+/* Decoded text: whitespace collapsed, content written after what is owed */
+static void put_text(ac_html_md_t *c, const char *s, size_t n) {
+    if (c->skip_nest) return;
+    if (c->pre_depth) {
+        put_pre(c, s, n);
+        return;
+    }
+    size_t i = 0, w;
+    while (i < n) {
+        if (is_space(s, n, i, &w)) {
+            c->space_pending = 1;
+            i += w;
+            continue;
+        }
+        size_t j = i;
+        while (j < n && !is_space(s, n, j, &w)) j++;
+        begin_content(c);
+        out_write(c, s + i, j - i);
+        i = j;
+    }
+}
+
+/* Raw markup text: decode, then write */
+static void emit_text(ac_html_md_t *c, const char *s, size_t n) {
+    if (c->skip_nest || n == 0 || c->truncated) return;
+    char buf[3 * 1024 + 1];
+    while (n > 0) {
+        size_t take = n > 1024 ? 1024 : n;
+        /* Don't split a reference */
+        if (take < n) {
+            for (size_t k = take; k > 0 && take - k < MAX_ENTITY; k--) {
+                if (s[k - 1] == '&') {
+                    if (k - 1 > 0) take = k - 1;
+                    break;
+                }
+                if (s[k - 1] == ';' || s[k - 1] == ' ') break;
+            }
+        }
+        size_t len = decode_text(c->charset, s, take, buf);
+        put_text(c, buf, len);
+        s += take;
+        n -= take;
+    }
+}
+
+static void append_title(ac_html_md_t *c, const char *s, size_t n) {
+    char *buf = malloc(3 * n + 1);
+    if (!buf) {
+        c->oom = 1;
+        return;
+    }
+    size_t len = decode_text(c->charset, s, n, buf);
+    for (size_t i = 0; i < len && c->title.len < 1024; i++) {
+        char ch = buf[i];
+        if (ch == '\n' || ch == '\r' || ch == '\t') ch = ' ';
+        if (ch == ' ' && (c->title.len == 0 || c->title.data[c->title.len - 1] == ' ')) continue;
+        if (buf_append(&c->title, &ch, 1) != 0) c->oom = 1;
+    }
+    free(buf);
+}
+
+/*============================================================================
+ * Tags
+ *============================================================================*/
+
+static void parse_tag(const char *s, size_t n, tag_t *t) {
+    memset(t, 0, sizeof(*t));
+    size_t i = 0;
+    if (i < n && s[i] == '/') {
+        t->closing = 1;
+        i++;
+    }
+    size_t k = 0;
+    while (i < n && !isspace((unsigned char)s[i]) && s[i] != '/' && s[i] != '>') {
+        if (k < sizeof(t->name) - 1) t->name[k++] = (char)tolower((unsigned char)s[i]);
+        i++;
+    }
+    t->name[k] = '\0';
+
+    while (i < n) {
+        while (i < n && (isspace((unsigned char)s[i]) || s[i] == '/')) {
+            if (s[i] == '/' && i == n - 1) t->self_closing = 1;
+            i++;
+        }
+        if (i >= n) break;
+        size_t name_start = i;
+        while (i < n && !isspace((unsigned char)s[i]) && s[i] != '=' && s[i] != '/') i++;
+        attr_t a = { s + name_start, i - name_start, "", 0 };
+        while (i < n && isspace((unsigned char)s[i])) i++;
+        if (i < n && s[i] == '=') {
+            i++;
+            while (i < n && isspace((unsigned char)s[i])) i++;
+            if (i < n && (s[i] == '"' || s[i] == '\'')) {
+                char q = s[i++];
+                size_t v = i;
+                while (i < n && s[i] != q) i++;
+                a.value = s + v;
+                a.value_len = i - v;
+                if (i < n) i++;
+            } else {
+                size_t v = i;
+                while (i < n && !isspace((unsigned char)s[i])) i++;
+                a.value = s + v;
+                a.value_len = i - v;
+            }
+        }
+        if (a.name_len > 0 && t->attr_count < MAX_ATTRS) t->attrs[t->attr_count++] = a;
+    }
+}
+
+static const attr_t *find_attr(const tag_t *t, const char *name) {
+    size_t len = strlen(name);
+    for (size_t i = 0; i < t->attr_count; i++) {
+        if (t->attrs[i].name_len == len && strncasecmp(t->attrs[i].name, name, len) == 0) return &t->attrs[i];
+    }
+    return NULL;
+}
+
+/* Attribute value with references decoded; free() it. NULL if absent */
+static char *attr_dup(const ac_html_md_t *c, const tag_t *t, const char *name) {
+    const attr_t *a = find_attr(t, name);
+    if (!a) return NULL;
+    char *out = malloc(3 * a->value_len + 1);
+    if (out) decode_text(c->charset, a->value, a->value_len, out);
+    return out;
+}
+
+static int attr_is(const tag_t *t, const char *name, const char *value) {
+    const attr_t *a = find_attr(t, name);
+    return a && a->value_len == strlen(value) && strncasecmp(a->value, value, a->value_len) == 0;
+}
+
+static int name_in(const char *name, const char *const *list, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(name, list[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+#define NAME_IN(name, list) name_in(name, list, sizeof(list) / sizeof(list[0]))
+
+static const char *const VOID_TAGS[] = {
+    "area", "base", "br", "col", "embed", "hr", "img", "input", "link", "meta",
+    "param", "source", "track", "wbr",
+};
+
+/* Content never worth reading */
+static const char *const DROPPED_TAGS[] = {
+    "noscript", "template", "svg", "math", "iframe", "object", "canvas", "video",
+    "audio", "nav", "aside", "footer", "button", "select", "dialog", "datalist",
+};
+
+static const char *const PARAGRAPH_TAGS[] = {
+    "p", "section", "article", "main", "header", "figure", "address", "details",
+    "fieldset", "center", "dl", "hgroup",
+};
+
+static const char *const LINE_TAGS[] = {
+    "div", "dt", "dd", "figcaption", "summary", "caption", "legend", "option",
+};
+
+static int is_dropped(const tag_t *t) {
+    if (NAME_IN(t->name, DROPPED_TAGS)) return 1;
+    if (find_attr(t, "hidden") || attr_is(t, "aria-hidden", "true")) return 1;
+    const attr_t *role = find_attr(t, "role");
+    if (role) {
+        static const char *const roles[] = { "navigation", "banner", "contentinfo", "complementary", "search" };
+        for (size_t i = 0; i < sizeof(roles) / sizeof(roles[0]); i++) {
+            if (role->value_len == strlen(roles[i]) && strncasecmp(role->value, roles[i], role->value_len) == 0) {
+                return 1;
+            }
+        }
+    }
+    const attr_t *style = find_attr(t, "style");
+    if (style) {
+        char compact[128];
+        size_t k = 0;
+        for (size_t i = 0; i < style->value_len && k < sizeof(compact) - 1; i++) {
+            if (!isspace((unsigned char)style->value[i])) compact[k++] = (char)tolower((unsigned char)style->value[i]);
+        }
+        compact[k] = '\0';
+        if (strstr(compact, "display:none") || strstr(compact, "visibility:hidden")) return 1;
+    }
+    return 0;
+}
+
+/* "language-c" or "lang-c" in a class attribute */
+static void class_language(const tag_t *t, char *out, size_t size) {
+    const attr_t *a = find_attr(t, "class");
+    if (!a) return;
+    for (size_t i = 0; i < a->value_len; i++) {
+        if (i > 0 && !isspace((unsigned char)a->value[i - 1])) continue;
+        size_t skip = 0;
+        if (a->value_len - i > 9 && strncmp(a->value + i, "language-", 9) == 0) skip = 9;
+        else if (a->value_len - i > 5 && strncmp(a->value + i, "lang-", 5) == 0) skip = 5;
+        if (!skip) continue;
+        size_t k = 0;
+        for (i += skip; i < a->value_len && !isspace((unsigned char)a->value[i]) && k < size - 1; i++) {
+            out[k++] = a->value[i];
+        }
+        out[k] = '\0';
+        return;
+    }
+}
+
+static void set_base(ac_html_md_t *c, const char *href) {
+    char *url = web_resolve_url(c->base_url, href);
+    if (url) {
+        free(c->base_url);
+        c->base_url = url;
+    }
+}
+
+static void handle_meta(ac_html_md_t *c, const tag_t *t) {
+    if (c->charset_fixed || c->text_started) return;
+    const attr_t *a = find_attr(t, "charset");
+    if (a) {
+        charset_from_label(a->value, a->value_len, &c->charset);
+        return;
+    }
+    if (!attr_is(t, "http-equiv", "content-type")) return;
+    a = find_attr(t, "content");
+    if (!a) return;
+    for (size_t i = 0; i + 8 <= a->value_len; i++) {
+        if (strncasecmp(a->value + i, "charset=", 8) == 0) {
+            charset_from_label(a->value + i + 8, a->value_len - i - 8, &c->charset);
+            return;
+        }
+    }
+}
+
+static void close_link(ac_html_md_t *c) {
+    if (!c->href) return;
+    int k = find_inline(c, "[");
+    if (k >= 0 && remove_inline(c, k)) {
+        out_str(c, "](");
+        out_str(c, c->href);
+        out_str(c, ")");
+    }
+    free(c->href);
+    c->href = NULL;
+}
+
+static void open_tag(ac_html_md_t *c, const tag_t *t) {
+    const char *name = t->name;
+
+    if (name[0] == 'h' && name[1] >= '1' && name[1] <= '6' && !name[2]) {
+        block(c, 2);
+        if (c->markdown && !c->cell_depth && !c->pre_depth) {
+            int level = name[1] - '0';
+            memset(c->marker, '#', (size_t)level);
+            c->marker[level] = ' ';
+            c->marker[level + 1] = '\0';
+        }
+    } else if (NAME_IN(name, PARAGRAPH_TAGS)) {
+        block(c, 2);
+    } else if (NAME_IN(name, LINE_TAGS)) {
+        block(c, 1);
+    } else if (strcmp(name, "br") == 0) {
+        if (c->pre_depth) put_pre(c, "\n", 1);
+        else if (c->cell_depth) c->space_pending = 1;
+        else block(c, 1);
+    } else if (strcmp(name, "hr") == 0) {
+        block(c, 2);
+        if (c->markdown && !c->cell_depth) {
+            begin_content(c);
+            out_str(c, "---");
+            block(c, 2);
+        }
+    } else if (strcmp(name, "ul") == 0 || strcmp(name, "ol") == 0 || strcmp(name, "menu") == 0) {
+        block(c, c->list_depth ? 1 : 2);
+        if (c->list_depth < MAX_LISTS) {
+            list_t *l = &c->lists[c->list_depth];
+            l->ordered = strcmp(name, "ol") == 0;
+            l->next = 1;
+            l->indent = c->list_depth ? c->lists[c->list_depth - 1].indent : 0;
+            char *start = l->ordered ? attr_dup(c, t, "start") : NULL;
+            if (start) {
+                long v = strtol(start, NULL, 10);
+                if (v > 0 && v < 1000000) l->next = (unsigned)v;
+                free(start);
+            }
+        }
+        c->list_depth++;
+    } else if (strcmp(name, "li") == 0) {
+        block(c, 1);
+        if (!c->cell_depth) {
+            /* Nested items start where the content of their parent item does */
+            int depth = c->list_depth < MAX_LISTS ? c->list_depth : MAX_LISTS;
+            list_t *l = depth ? &c->lists[depth - 1] : NULL;
+            size_t indent = depth > 1 ? c->lists[depth - 2].indent : 0;
+            if (indent > 32) indent = 32;
+            memset(c->marker, ' ', indent);
+            if (l && l->ordered) {
+                snprintf(c->marker + indent, sizeof(c->marker) - indent, "%u. ", l->next++);
+            } else {
+                snprintf(c->marker + indent, sizeof(c->marker) - indent, "- ");
+            }
+            if (l) l->indent = strlen(c->marker);
+        }
+    } else if (strcmp(name, "blockquote") == 0) {
+        block(c, 2);
+        c->quote_depth++;
+    } else if (strcmp(name, "pre") == 0 || strcmp(name, "listing") == 0) {
+        block(c, 2);
+        if (c->pre_depth++ == 0) {
+            c->pre_fence_pending = 1;
+            c->pre_skip_newline = 1;
+            c->pre_lang[0] = '\0';
+            class_language(t, c->pre_lang, sizeof(c->pre_lang));
+        }
+    } else if (strcmp(name, "code") == 0 || strcmp(name, "kbd") == 0 || strcmp(name, "samp") == 0 ||
+               strcmp(name, "tt") == 0) {
+        if (c->pre_depth) {
+            if (c->pre_fence_pending && !c->pre_lang[0]) class_language(t, c->pre_lang, sizeof(c->pre_lang));
+        } else {
+            open_inline(c, "`");
+        }
+    } else if (strcmp(name, "strong") == 0 || strcmp(name, "b") == 0) {
+        open_inline(c, "**");
+    } else if (strcmp(name, "em") == 0 || strcmp(name, "i") == 0) {
+        open_inline(c, "*");
+    } else if (strcmp(name, "del") == 0 || strcmp(name, "s") == 0 || strcmp(name, "strike") == 0) {
+        open_inline(c, "~~");
+    } else if (strcmp(name, "a") == 0) {
+        close_link(c);
+        char *href = attr_dup(c, t, "href");
+        if (href && c->markdown && !c->pre_depth && href[0] && href[0] != '#' &&
+            strncasecmp(href, "javascript:", 11) != 0) {
+            c->href = web_resolve_url(c->base_url, href);
+            if (c->href) open_inline(c, "[");
+        }
+        free(href);
+    } else if (strcmp(name, "img") == 0) {
+        char *alt = attr_dup(c, t, "alt");
+        char *src = attr_dup(c, t, "src");
+        /* No alt text: decorative */
+        if (alt && alt[0]) {
+            if (c->markdown && src && src[0] && strncasecmp(src, "data:", 5) != 0 && !c->pre_depth) {
+                char *url = web_resolve_url(c->base_url, src);
+                begin_content(c);
+                out_str(c, "![");
+                out_str(c, alt);
+                out_str(c, "](");
+                if (url) out_str(c, url);
+                out_str(c, ")");
+                free(url);
+            } else {
+                put_text(c, alt, strlen(alt));
+            }
+        }
+        free(alt);
+        free(src);
+    } else if (strcmp(name, "table") == 0) {
+        block(c, 2);
+        if (c->table_depth++ == 0) c->table_rows = 0;
+    } else if (strcmp(name, "tr") == 0) {
+        if (c->table_depth <= 1) {
+            block(c, 1);
+            c->row_cells = 0;
+        }
+    } else if (strcmp(name, "td") == 0 || strcmp(name, "th") == 0) {
+        if (c->table_depth <= 1 && c->cell_depth == 0) {
+            begin_content(c);
+            out_str(c, c->row_cells == 0 ? "| " : " | ");
+            c->row_cells++;
+            c->space_pending = 0;
+        }
+        c->cell_depth++;
+    }
+}
+
+static void close_tag(ac_html_md_t *c, const tag_t *t) {
+    const char *name = t->name;
+
+    if (name[0] == 'h' && name[1] >= '1' && name[1] <= '6' && !name[2]) {
+        c->marker[0] = '\0';
+        block(c, 2);
+    } else if (NAME_IN(name, PARAGRAPH_TAGS)) {
+        block(c, 2);
+    } else if (NAME_IN(name, LINE_TAGS)) {
+        block(c, 1);
+    } else if (strcmp(name, "ul") == 0 || strcmp(name, "ol") == 0 || strcmp(name, "menu") == 0) {
+        if (c->list_depth > 0) c->list_depth--;
+        c->marker[0] = '\0';
+        block(c, c->list_depth ? 1 : 2);
+    } else if (strcmp(name, "li") == 0) {
+        block(c, 1);
+    } else if (strcmp(name, "blockquote") == 0) {
+        block(c, 2);
+        if (c->quote_depth > 0) c->quote_depth--;
+    } else if (strcmp(name, "pre") == 0 || strcmp(name, "listing") == 0) {
+        if (c->pre_depth > 0 && --c->pre_depth == 0) {
+            if (!c->pre_fence_pending && c->markdown) {
+                if (c->trailing_newlines == 0) out_write(c, "\n", 1);
+                out_str(c, "```");
+            }
+            c->pre_fence_pending = 0;
+            block(c, 2);
+        }
+    } else if (strcmp(name, "code") == 0 || strcmp(name, "kbd") == 0 || strcmp(name, "samp") == 0 ||
+               strcmp(name, "tt") == 0) {
+        if (!c->pre_depth) close_inline(c, "`");
+    } else if (strcmp(name, "strong") == 0 || strcmp(name, "b") == 0) {
+        close_inline(c, "**");
+    } else if (strcmp(name, "em") == 0 || strcmp(name, "i") == 0) {
+        close_inline(c, "*");
+    } else if (strcmp(name, "del") == 0 || strcmp(name, "s") == 0 || strcmp(name, "strike") == 0) {
+        close_inline(c, "~~");
+    } else if (strcmp(name, "a") == 0) {
+        close_link(c);
+    } else if (strcmp(name, "table") == 0) {
+        if (c->table_depth > 0) c->table_depth--;
+        block(c, 2);
+    } else if (strcmp(name, "td") == 0 || strcmp(name, "th") == 0) {
+        if (c->cell_depth > 0) c->cell_depth--;
+        c->space_pending = 0;
+    } else if (strcmp(name, "tr") == 0) {
+        if (c->table_depth <= 1 && c->row_cells > 0) {
+            c->cell_depth = 0;
+            out_str(c, " |");
+            if (++c->table_rows == 1 && c->markdown) {
+                out_str(c, "\n|");
+                for (int i = 0; i < c->row_cells; i++) out_str(c, " --- |");
+            }
+            c->row_cells = 0;
+            block(c, 1);
+        }
+    }
+}
+
+static void handle_tag(ac_html_md_t *c, const char *s, size_t n) {
+    tag_t t;
+    parse_tag(s, n, &t);
+    if (!t.name[0]) return;
+
+    if (t.closing) {
+        if (c->skip_nest) {
+            if (strcmp(t.name, c->skip_tag) == 0 && --c->skip_nest == 0) c->skip_tag[0] = '\0';
+            return;
+        }
+        close_tag(c, &t);
+        return;
+    }
+
+    /* Raw text: the content is not markup, whether kept or not */
+    if (strcmp(t.name, "script") == 0 || strcmp(t.name, "style") == 0 ||
+        strcmp(t.name, "textarea") == 0 || strcmp(t.name, "title") == 0 || strcmp(t.name, "xmp") == 0) {
+        if (!t.self_closing) snprintf(c->raw_tag, sizeof(c->raw_tag), "%s", t.name);
+        return;
+    }
+    if (strcmp(t.name, "meta") == 0) {
+        handle_meta(c, &t);
+        return;
+    }
+    if (strcmp(t.name, "base") == 0) {
+        char *href = attr_dup(c, &t, "href");
+        if (href) set_base(c, href);
+        free(href);
+        return;
+    }
+
+    int is_void = NAME_IN(t.name, VOID_TAGS);
+    if (c->skip_nest) {
+        if (!is_void && !t.self_closing && strcmp(t.name, c->skip_tag) == 0) c->skip_nest++;
+        return;
+    }
+    if (!is_void && !t.self_closing && is_dropped(&t)) {
+        snprintf(c->skip_tag, sizeof(c->skip_tag), "%s", t.name);
+        c->skip_nest = 1;
+        return;
+    }
+    if (is_void && is_dropped(&t)) return;
+    open_tag(c, &t);
+}
+
+/*============================================================================
+ * Tokenizer
+ *============================================================================*/
+
+static const char *find_ci(const char *s, size_t n, const char *needle) {
+    size_t len = strlen(needle);
+    for (size_t i = 0; i + len <= n; i++) {
+        if (strncasecmp(s + i, needle, len) == 0) return s + i;
+    }
+    return NULL;
+}
+
+/* End of a raw-text element: "</name" then a space, '/' or '>' */
+static const char *find_raw_end(const char *s, size_t n, const char *tag) {
+    char needle[24];
+    snprintf(needle, sizeof(needle), "</%s", tag);
+    size_t len = strlen(needle);
+    while (n >= len) {
+        const char *p = find_ci(s, n, needle);
+        if (!p) return NULL;
+        size_t at = (size_t)(p - s);
+        if (at + len < n) {
+            char next = p[len];
+            if (next == '>' || next == '/' || isspace((unsigned char)next)) return p;
+        } else {
+            return NULL;                /* Can't tell yet */
+        }
+        s = p + 1;
+        n -= at + 1;
+    }
+    return NULL;
+}
+
+/* '>' closing the tag at s[0] == '<', skipping quoted attribute values */
+static const char *find_tag_end(const char *s, size_t n) {
+    char quote = 0;
+    int after_eq = 0;
+    for (size_t i = 1; i < n; i++) {
+        char ch = s[i];
+        if (quote) {
+            if (ch == quote) quote = 0;
+            continue;
+        }
+        if (ch == '>') return s + i;
+        if ((ch == '"' || ch == '\'') && after_eq) {
+            quote = ch;
+            after_eq = 0;
+            continue;
+        }
+        if (ch == '=') after_eq = 1;
+        else if (!isspace((unsigned char)ch)) after_eq = 0;
+    }
+    return NULL;
+}
+
+/* Convert as much of s as is complete; returns the bytes consumed */
+static size_t process(ac_html_md_t *c, const char *s, size_t n, int final) {
+    size_t i = 0;
+    while (i < n && !c->truncated) {
+        if (c->raw_tag[0]) {
+            const char *end = find_raw_end(s + i, n - i, c->raw_tag);
+            size_t stop;
+            if (end) {
+                stop = (size_t)(end - s);
+            } else {
+                /* Keep what might be the start of the end tag */
+                size_t keep = strlen(c->raw_tag) + 2;
+                stop = final ? n : (n - i > keep ? n - keep : i);
+            }
+            int is_title = strcmp(c->raw_tag, "title") == 0;
+            if (is_title && !end && !final) {
+                /* Nor split a reference in the title */
+                for (size_t k = stop; k > i && stop - k < MAX_ENTITY; k--) {
+                    if (s[k - 1] == ';') break;
+                    if (s[k - 1] == '&') {
+                        stop = k - 1;
+                        break;
+                    }
+                }
+            }
+            if (is_title && !c->title_done && !c->skip_nest) {
+                append_title(c, s + i, stop - i);
+            }
+            i = stop;
+            if (!end) return final ? n : i;
+            if (is_title && c->title.len > 0) c->title_done = 1;
+            c->raw_tag[0] = '\0';
+            continue;                   /* The end tag is parsed as a tag */
+        }
+
+        if (c->in_comment) {
+            const char *end = NULL;
+            for (size_t k = i; k + 3 <= n; k++) {
+                if (s[k] == '-' && s[k + 1] == '-' && s[k + 2] == '>') {
+                    end = s + k;
+                    break;
+                }
+            }
+            if (!end) {
+                /* Keep a "--" that may begin the end */
+                if (final) return n;
+                return n - i > 2 ? n - 2 : i;
+            }
+            c->in_comment = 0;
+            i = (size_t)(end - s) + 3;
+            continue;
+        }
+
+        if (s[i] == '<') {
+            char next = i + 1 < n ? s[i + 1] : '\0';
+            if (i + 1 >= n && !final) return i;
+            if (next == '!' || next == '?' || next == '/' || isalpha((unsigned char)next)) {
+                if (next == '!') {
+                    if (n - i < 4 && !final) return i;
+                    if (n - i >= 4 && s[i + 2] == '-' && s[i + 3] == '-') {
+                        c->in_comment = 1;
+                        i += 4;
+                        continue;
+                    }
+                }
+                const char *end = find_tag_end(s + i, n - i);
+                if (!end) {
+                    if (final) return n;
+                    if (n - i <= MAX_TAG_BYTES) return i;
+                    emit_text(c, "&lt;", 4);
+                    i++;
+                    continue;
+                }
+                if (next == '!' || next == '?') {
+                    i = (size_t)(end - s) + 1; /* Doctype, CDATA, processing instruction */
+                    continue;
+                }
+                handle_tag(c, s + i + 1, (size_t)(end - s) - i - 1);
+                i = (size_t)(end - s) + 1;
+                continue;
+            }
+            emit_text(c, "&lt;", 4);
+            i++;
+            continue;
+        }
+
+        /* Text up to the next tag; a reference cut by the chunk end waits */
+        const char *lt = memchr(s + i, '<', n - i);
+        size_t stop = lt ? (size_t)(lt - s) : n;
+        if (!lt && !final) {
+            for (size_t k = stop; k > i && stop - k < MAX_ENTITY; k--) {
+                char ch = s[k - 1];
+                if (ch == ';' || isspace((unsigned char)ch)) break;
+                if (ch == '&') {
+                    stop = k - 1;
+                    break;
+                }
+            }
+            if (stop == i) return i;
+        }
+        emit_text(c, s + i, stop - i);
+        i = stop;
+    }
+    return c->truncated ? n : i;
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+arc_err_t ac_html_md_create(const ac_html_md_options_t *options, ac_html_md_t **out) {
+    if (!out) return ARC_ERR_INVALID_ARG;
+    *out = NULL;
+    ac_html_md_t *c = calloc(1, sizeof(*c));
+    if (!c) return ARC_ERR_NO_MEMORY;
+
+    c->markdown = !options || options->format != AC_HTML_MD_TEXT;
+    c->charset = CHARSET_UTF8;
+    if (options) {
+        c->max_output = options->max_output;
+        if (options->charset && options->charset[0]) {
+            c->charset_fixed = charset_from_label(options->charset, strlen(options->charset), &c->charset);
+        }
+        if (options->base_url && options->base_url[0]) {
+            c->base_url = strdup(options->base_url);
+            if (!c->base_url) {
+                free(c);
+                return ARC_ERR_NO_MEMORY;
+            }
+        }
+    }
+    *out = c;
+    return ARC_OK;
+}
+
+arc_err_t ac_html_md_feed(ac_html_md_t *conv, const char *html, size_t len) {
+    if (!conv || (!html && len > 0)) return ARC_ERR_INVALID_ARG;
+    if (conv->finished || conv->truncated || len == 0) return ARC_OK;
+
+    if (conv->in.len == 0) {
+        size_t used = process(conv, html, len, 0);
+        if (used < len && buf_append(&conv->in, html + used, len - used) != 0) conv->oom = 1;
+    } else {
+        if (buf_append(&conv->in, html, len) != 0) {
+            conv->oom = 1;
+        } else {
+            size_t used = process(conv, conv->in.data, conv->in.len, 0);
+            memmove(conv->in.data, conv->in.data + used, conv->in.len - used);
+            conv->in.len -= used;
+        }
+    }
+    return conv->oom ? ARC_ERR_NO_MEMORY : ARC_OK;
+}
+
+const char *ac_html_md_finish(ac_html_md_t *conv, size_t *len) {
+    if (!conv) return NULL;
+    if (!conv->finished) {
+        if (conv->in.len > 0 && !conv->truncated) process(conv, conv->in.data, conv->in.len, 1);
+        conv->in.len = 0;
+        close_link(conv);
+        while (conv->open_count > 0) {
+            const char *m = conv->opens[conv->open_count - 1];
+            if (remove_inline(conv, conv->open_count - 1) && !conv->truncated) out_str(conv, m);
+        }
+        if (conv->pre_depth && !conv->pre_fence_pending && conv->markdown && !conv->truncated) {
+            if (conv->trailing_newlines == 0) out_write(conv, "\n", 1);
+            out_str(conv, "```");
+        }
+        while (conv->out.len > 0 && isspace((unsigned char)conv->out.data[conv->out.len - 1])) conv->out.len--;
+        if (conv->out.data) conv->out.data[conv->out.len] = '\0';
+        while (conv->title.len > 0 && conv->title.data[conv->title.len - 1] == ' ') conv->title.len--;
+        if (conv->title.data) conv->title.data[conv->title.len] = '\0';
+        conv->finished = 1;
+    }
+    if (len) *len = conv->out.len;
+    return conv->out.data ? conv->out.data : "";
+}
+
+const char *ac_html_md_title(const ac_html_md_t *conv) {
+    return conv && conv->title.data ? conv->title.data : "";
+}
+
+int ac_html_md_truncated(const ac_html_md_t *conv) {
+    return conv ? conv->truncated : 0;
+}
+
+void ac_html_md_free(ac_html_md_t *conv) {
+    if (!conv) return;
+    free(conv->base_url);
+    free(conv->href);
+    free(conv->in.data);
+    free(conv->out.data);
+    free(conv->title.data);
+    free(conv);
+}
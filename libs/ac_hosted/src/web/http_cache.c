@@ -0,0 +1,721 @@
+/**
+ * @file http_cache.c
+ * @brief On-disk HTTP cache with conditional requests
+ *
+ * An entry is <key>.body and <key>.json in the cache directory, where
+ * the key is a hash of the URL asked for. The body is renamed into place
+ * before the metadata, and the metadata records the body's size, so a
+ * reader never takes a half-written body for a complete one. Reading an
+ * entry touches its metadata file: eviction removes the entries with
+ * the oldest metadata first.
+ */
+
+#if !defined(_WIN32)
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include <arc/http_cache.h>
+#include <arc/log.h>
+#include "http_client.h"
+#include "web_internal.h"
+
+#include <cJSON.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+#define CACHE_MAX_BYTES     (64 * 1024 * 1024)
+#define CACHE_MAX_BODY      (5 * 1024 * 1024)
+#define CACHE_MAX_AGE_S     (24 * 60 * 60)
+#define CACHE_TIMEOUT_MS    30000
+#define CACHE_MAX_REDIRECTS 5
+#define CACHE_PATH_MAX      4096
+
+#define DEFAULT_USER_AGENT  "arc-webfetch/1.0"
+#define DEFAULT_ACCEPT      "text/html, application/xhtml+xml, text/markdown;q=0.9, text/plain;q=0.8, */*;q=0.5"
+
+/*============================================================================
+ * Types
+ *============================================================================*/
+
+struct ac_http_cache {
+    char dir[CACHE_PATH_MAX];
+    size_t max_bytes;
+    size_t max_body;
+    int max_age_s;
+    int timeout_ms;
+    int max_redirects;
+    char *user_agent;
+    char *accept;
+    arc_http_client_t *client;
+    ac_http_cache_stats_t stats;
+    char error[512];
+};
+
+/* Metadata of a stored response */
+typedef struct {
+    char *url;                          /* Asked for */
+    char *final_url;                    /* After redirects; revalidated here */
+    char *content_type;
+    char *etag;
+    char *last_modified;
+    long long stored;                   /* When last received or revalidated */
+    long long fresh_for;                /* Seconds from `stored` */
+    size_t size;
+} entry_t;
+
+/* What the response headers allow */
+typedef struct {
+    int no_store;
+    long long fresh_for;
+} policy_t;
+
+/*============================================================================
+ * Helpers
+ *============================================================================*/
+
+static void set_error(ac_http_cache_t *cache, const char *fmt, const char *detail) {
+    snprintf(cache->error, sizeof(cache->error), fmt, detail ? detail : "");
+}
+
+static char *dup_or_empty(const char *s) {
+    return strdup(s ? s : "");
+}
+
+static int make_dirs(const char *path) {
+    char buf[CACHE_PATH_MAX];
+    if (snprintf(buf, sizeof(buf), "%s", path) >= (int)sizeof(buf)) return -1;
+    for (char *p = buf + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        mkdir(buf, 0755);
+        *p = '/';
+    }
+    return (mkdir(buf, 0755) == 0 || errno == EEXIST) ? 0 : -1;
+}
+
+static int default_cache_dir(char *out, size_t size) {
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    if (xdg && xdg[0]) return snprintf(out, size, "%s/arc/web", xdg) < (int)size ? 0 : -1;
+    const char *home = getenv("HOME");
+    if (home && home[0]) return snprintf(out, size, "%s/.cache/arc/web", home) < (int)size ? 0 : -1;
+    return -1;
+}
+
+/* FNV-1a of the URL, as 16 hex digits */
+static void url_key(const char *url, char out[17]) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const unsigned char *p = (const unsigned char *)url; *p; p++) {
+        h ^= *p;
+        h *= 0x100000001b3ULL;
+    }
+    snprintf(out, 17, "%016llx", (unsigned long long)h);
+}
+
+static void entry_path(const ac_http_cache_t *cache, const char *key, const char *ext, char *out, size_t size) {
+    snprintf(out, size, "%s/%s.%s", cache->dir, key, ext);
+}
+
+static void entry_free(entry_t *e) {
+    free(e->url);
+    free(e->final_url);
+    free(e->content_type);
+    free(e->etag);
+    free(e->last_modified);
+    memset(e, 0, sizeof(*e));
+}
+
+static char *read_file(const char *path, size_t max, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0 || (size_t)st.st_size > max) {
+        fclose(f);
+        return NULL;
+    }
+    char *data = malloc((size_t)st.st_size + 1);
+    size_t got = data ? fread(data, 1, (size_t)st.st_size, f) : 0;
+    fclose(f);
+    if (!data || got != (size_t)st.st_size) {
+        free(data);
+        return NULL;
+    }
+    data[got] = '\0';
+    *len = got;
+    return data;
+}
+
+/* Write a file under a temporary name, then rename it into place */
+static int write_file(const char *path, const char *data, size_t len) {
+    char tmp[CACHE_PATH_MAX + 32];
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return -1;
+    int ok = fwrite(data, 1, len, f) == len;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+/*============================================================================
+ * Response Headers
+ *============================================================================*/
+
+static const char *header(const arc_http_header_t *headers, const char *name) {
+    const arc_http_header_t *h = arc_http_header_find(headers, name);
+    return h ? h->value : NULL;
+}
+
+static long long parse_http_date(const char *s) {
+    if (!s) return -1;
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char *end = strptime(s, "%a, %d %b %Y %H:%M:%S", &tm);
+    if (!end) return -1;
+    return (long long)timegm(&tm);
+}
+
+/* Directive of a Cache-Control header: 1 if present, with its number in *value */
+static int cache_directive(const char *cc, const char *name, long long *value) {
+    size_t len = strlen(name);
+    for (const char *p = cc; p && *p;) {
+        while (*p == ' ' || *p == ',') p++;
+        if (strncasecmp(p, name, len) == 0 && (p[len] == '\0' || p[len] == ',' || p[len] == '=' || p[len] == ' ')) {
+            if (value) {
+                *value = -1;
+                if (p[len] == '=') {
+                    const char *v = p + len + 1;
+                    if (*v == '"') v++;
+                    char *num_end;
+                    long long n = strtoll(v, &num_end, 10);
+                    if (num_end != v && n >= 0) *value = n;
+                }
+            }
+            return 1;
+        }
+        p = strchr(p, ',');
+    }
+    return 0;
+}
+
+static policy_t response_policy(const ac_http_cache_t *cache, const arc_http_header_t *headers, long long now) {
+    policy_t policy = { 0, 0 };
+    const char *cc = header(headers, "Cache-Control");
+    long long value;
+
+    if (cc && cache_directive(cc, "no-store", NULL)) {
+        policy.no_store = 1;
+        return policy;
+    }
+    if (cc && cache_directive(cc, "no-cache", NULL)) {
+        return policy;                  /* Stored, but revalidated on every use */
+    }
+
+    long long date = parse_http_date(header(headers, "Date"));
+    if (date < 0) date = now;
+
+    if (cc && cache_directive(cc, "max-age", &value) && value >= 0) {
+        const char *age = header(headers, "Age");
+        long long age_s = age ? strtoll(age, NULL, 10) : 0;
+        policy.fresh_for = value - (age_s > 0 ? age_s : 0);
+    } else if (header(headers, "Expires")) {
+        long long expires = parse_http_date(header(headers, "Expires"));
+        policy.fresh_for = expires > date ? expires - date : 0;
+    } else {
+        long long modified = parse_http_date(header(headers, "Last-Modified"));
+        if (modified > 0 && modified < date) policy.fresh_for = (date - modified) / 10;
+    }
+
+    if (policy.fresh_for < 0) policy.fresh_for = 0;
+    if (policy.fresh_for > cache->max_age_s) policy.fresh_for = cache->max_age_s;
+    return policy;
+}
+
+/*============================================================================
+ * Entries
+ *============================================================================*/
+
+static char *json_string(const cJSON *obj, const char *name) {
+    const cJSON *item = cJSON_GetObjectItemCaseSensitive(obj, name);
+    return dup_or_empty(cJSON_IsString(item) ? item->valuestring : NULL);
+}
+
+static int entry_load(const ac_http_cache_t *cache, const char *key, const char *url, entry_t *e) {
+    memset(e, 0, sizeof(*e));
+    char path[CACHE_PATH_MAX + 32];
+    entry_path(cache, key, "json", path, sizeof(path));
+    size_t len;
+    char *text = read_file(path, 64 * 1024, &len);
+    if (!text) return -1;
+    cJSON *json = cJSON_Parse(text);
+    free(text);
+    if (!json) return -1;
+
+    const cJSON *stored = cJSON_GetObjectItemCaseSensitive(json, "stored");
+    const cJSON *fresh = cJSON_GetObjectItemCaseSensitive(json, "fresh_for");
+    const cJSON *size = cJSON_GetObjectItemCaseSensitive(json, "size");
+    e->url = json_string(json, "url");
+    e->final_url = json_string(json, "final_url");
+    e->content_type = json_string(json, "content_type");
+    e->etag = json_string(json, "etag");
+    e->last_modified = json_string(json, "last_modified");
+    e->stored = cJSON_IsNumber(stored) ? (long long)stored->valuedouble : 0;
+    e->fresh_for = cJSON_IsNumber(fresh) ? (long long)fresh->valuedouble : 0;
+    e->size = cJSON_IsNumber(size) ? (size_t)size->valuedouble : 0;
+    cJSON_Delete(json);
+
+    /* Another URL with the same hash */
+    if (!e->url || !e->final_url || !e->content_type || !e->etag || !e->last_modified ||
+        strcmp(e->url, url) != 0 || !e->final_url[0]) {
+        entry_free(e);
+        return -1;
+    }
+    return 0;
+}
+
+static int entry_save_meta(const ac_http_cache_t *cache, const char *key, const entry_t *e) {
+    cJSON *json = cJSON_CreateObject();
+    if (!json) return -1;
+    cJSON_AddStringToObject(json, "url", e->url);
+    cJSON_AddStringToObject(json, "final_url", e->final_url);
+    cJSON_AddStringToObject(json, "content_type", e->content_type);
+    cJSON_AddStringToObject(json, "etag", e->etag);
+    cJSON_AddStringToObject(json, "last_modified", e->last_modified);
+    cJSON_AddNumberToObject(json, "stored", (double)e->stored);
+    cJSON_AddNumberToObject(json, "fresh_for", (double)e->fresh_for);
+    cJSON_AddNumberToObject(json, "size", (double)e->size);
+    char *text = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    if (!text) return -1;
+
+    char path[CACHE_PATH_MAX + 32];
+    entry_path(cache, key, "json", path, sizeof(path));
+    int rc = write_file(path, text, strlen(text));
+    free(text);
+    return rc;
+}
+
+static void entry_remove(const ac_http_cache_t *cache, const char *key) {
+    char path[CACHE_PATH_MAX + 32];
+    entry_path(cache, key, "json", path, sizeof(path));
+    unlink(path);
+    entry_path(cache, key, "body", path, sizeof(path));
+    unlink(path);
+}
+
+/* Body of a loaded entry, if it is the one the metadata describes */
+static char *entry_body(const ac_http_cache_t *cache, const char *key, const entry_t *e) {
+    char path[CACHE_PATH_MAX + 32];
+    entry_path(cache, key, "body", path, sizeof(path));
+    size_t len;
+    char *body = read_file(path, e->size, &len);
+    if (body && len != e->size) {
+        free(body);
+        return NULL;
+    }
+    return body;
+}
+
+/* Mark an entry as just used, for eviction */
+static void entry_touch(const ac_http_cache_t *cache, const char *key) {
+    char path[CACHE_PATH_MAX + 32];
+    entry_path(cache, key, "json", path, sizeof(path));
+    utimensat(AT_FDCWD, path, NULL, 0);
+}
+
+typedef struct {
+    char key[17];
+    long long used;
+    size_t size;
+} usage_t;
+
+static int compare_usage(const void *a, const void *b) {
+    long long x = ((const usage_t *)a)->used, y = ((const usage_t *)b)->used;
+    return x < y ? -1 : x > y;
+}
+
+/* Remove least recently used entries until the bodies fit in max_bytes */
+static void evict(ac_http_cache_t *cache, const char *keep) {
+    DIR *dir = opendir(cache->dir);
+    if (!dir) return;
+
+    usage_t *entries = NULL;
+    size_t count = 0, cap = 0, total = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        size_t len = strlen(de->d_name);
+        if (len != 16 + 5 || strcmp(de->d_name + 16, ".body") != 0) continue;
+
+        usage_t u;
+        memcpy(u.key, de->d_name, 16);
+        u.key[16] = '\0';
+        char path[CACHE_PATH_MAX + 32];
+        struct stat body_st, meta_st;
+        entry_path(cache, u.key, "body", path, sizeof(path));
+        if (stat(path, &body_st) != 0) continue;
+        entry_path(cache, u.key, "json", path, sizeof(path));
+        u.used = stat(path, &meta_st) == 0
+                     ? (long long)meta_st.st_mtim.tv_sec * 1000000000LL + meta_st.st_mtim.tv_nsec : 0;
+        u.size = (size_t)body_st.st_size;
+        total += u.size;
+
+        if (count == cap) {
+            size_t new_cap = cap ? cap * 2 : 64;
+            usage_t *grown = realloc(entries, new_cap * sizeof(*grown));
+            if (!grown) break;
+            entries = grown;
+            cap = new_cap;
+        }
+        entries[count++] = u;
+    }
+    closedir(dir);
+
+    if (total > cache->max_bytes) {
+        qsort(entries, count, sizeof(*entries), compare_usage);
+        for (size_t i = 0; i < count && total > cache->max_bytes; i++) {
+            if (strcmp(entries[i].key, keep) == 0) continue;
+            entry_remove(cache, entries[i].key);
+            total -= entries[i].size;
+            cache->stats.evicted++;
+        }
+    }
+    free(entries);
+}
+
+static void entry_store(
+    ac_http_cache_t *cache,
+    const char *key,
+    const char *url,
+    const char *final_url,
+    const arc_http_response_t *resp,
+    const policy_t *policy,
+    long long now
+) {
+    entry_t e = {
+        .url = (char *)url,
+        .final_url = (char *)final_url,
+        .content_type = (char *)(header(resp->headers, "Content-Type") ? header(resp->headers, "Content-Type") : ""),
+        .etag = (char *)(header(resp->headers, "ETag") ? header(resp->headers, "ETag") : ""),
+        .last_modified = (char *)(header(resp->headers, "Last-Modified") ? header(resp->headers, "Last-Modified") : ""),
+        .stored = now,
+        .fresh_for = policy->fresh_for,
+        .size = resp->body_len,
+    };
+
+    /* Without a validator or freshness an entry could never be used */
+    if (!e.etag[0] && !e.last_modified[0] && e.fresh_for <= 0) {
+        entry_remove(cache, key);
+        return;
+    }
+    if (resp->body_len > cache->max_bytes) return;
+
+    char path[CACHE_PATH_MAX + 32];
+    entry_path(cache, key, "body", path, sizeof(path));
+    if (write_file(path, resp->body ? resp->body : "", resp->body_len) != 0 ||
+        entry_save_meta(cache, key, &e) != 0) {
+        AC_LOG_WARN("HTTP cache: cannot write %s", path);
+        entry_remove(cache, key);
+        return;
+    }
+    cache->stats.stored++;
+    evict(cache, key);
+}
+
+/*============================================================================
+ * Requests
+ *============================================================================*/
+
+/* Only http and https are fetched, whatever a redirect points to */
+static int is_http_url(const char *url) {
+    return strncasecmp(url, "http://", 7) == 0 || strncasecmp(url, "https://", 8) == 0;
+}
+
+static int is_redirect(int status) {
+    return status == 301 || status == 302 || status == 303 || status == 307 || status == 308;
+}
+
+/* One GET; conditional when the validators are given */
+static arc_err_t send_get(
+    ac_http_cache_t *cache,
+    const char *url,
+    const char *etag,
+    const char *last_modified,
+    int timeout_ms,
+    arc_http_response_t *resp
+) {
+    arc_http_header_t *headers = NULL;
+    arc_http_header_append(&headers, arc_http_header_create("User-Agent", cache->user_agent));
+    arc_http_header_append(&headers, arc_http_header_create("Accept", cache->accept));
+    if (etag && etag[0]) {
+        arc_http_header_append(&headers, arc_http_header_create("If-None-Match", etag));
+    }
+    if (last_modified && last_modified[0]) {
+        arc_http_header_append(&headers, arc_http_header_create("If-Modified-Since", last_modified));
+    }
+
+    arc_http_request_t req = {
+        .url = url,
+        .method = ARC_HTTP_GET,
+        .headers = headers,
+        .timeout_ms = (uint32_t)(timeout_ms > 0 ? timeout_ms : 1),
+        .verify_ssl = 1,
+        .keep_headers = 1,
+    };
+    cache->stats.requests++;
+    arc_err_t err = arc_http_request(cache->client, &req, resp);
+    arc_http_header_free(headers);
+
+    if (err == ARC_ERR_RESPONSE_TOO_LARGE) {
+        char limit[32];
+        snprintf(limit, sizeof(limit), "%zu", cache->max_body);
+        set_error(cache, "response larger than %s bytes", limit);
+    } else if (err != ARC_OK) {
+        set_error(cache, "%s", resp->error_msg ? resp->error_msg : "request failed");
+    }
+    return err;
+}
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Fill out from a cached entry; takes the body */
+static arc_err_t serve_entry(ac_http_fetch_t *out, const entry_t *e, char *body, ac_http_source_t source) {
+    out->status = 200;
+    out->url = strdup(e->final_url);
+    out->content_type = strdup(e->content_type);
+    out->body = body;
+    out->size = e->size;
+    out->source = source;
+    if (!out->url || !out->content_type) {
+        ac_http_fetch_free(out);
+        return ARC_ERR_NO_MEMORY;
+    }
+    return ARC_OK;
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+arc_err_t ac_http_cache_open(const ac_http_cache_options_t *options, ac_http_cache_t **out) {
+    if (!out) return ARC_ERR_INVALID_ARG;
+    *out = NULL;
+
+    ac_http_cache_t *cache = calloc(1, sizeof(*cache));
+    if (!cache) return ARC_ERR_NO_MEMORY;
+
+    const char *dir = options ? options->dir : NULL;
+    if (dir ? snprintf(cache->dir, sizeof(cache->dir), "%s", dir) >= (int)sizeof(cache->dir)
+            : default_cache_dir(cache->dir, sizeof(cache->dir)) != 0) {
+        free(cache);
+        return ARC_ERR_IO;
+    }
+    if (make_dirs(cache->dir) != 0) {
+        AC_LOG_WARN("HTTP cache: cannot create %s: %s", cache->dir, strerror(errno));
+        free(cache);
+        return ARC_ERR_IO;
+    }
+
+    cache->max_bytes = options && options->max_bytes ? options->max_bytes : CACHE_MAX_BYTES;
+    cache->max_body = options && options->max_body ? options->max_body : CACHE_MAX_BODY;
+    cache->max_age_s = options && options->max_age_s > 0 ? options->max_age_s : CACHE_MAX_AGE_S;
+    cache->timeout_ms = options && options->timeout_ms > 0 ? options->timeout_ms : CACHE_TIMEOUT_MS;
+    cache->max_redirects = options && options->max_redirects > 0 ? options->max_redirects : CACHE_MAX_REDIRECTS;
+    cache->user_agent = strdup(options && options->user_agent ? options->user_agent : DEFAULT_USER_AGENT);
+    cache->accept = strdup(options && options->accept ? options->accept : DEFAULT_ACCEPT);
+    if (!cache->user_agent || !cache->accept) {
+        ac_http_cache_close(cache);
+        return ARC_ERR_NO_MEMORY;
+    }
+
+    /* One connection, reused while the server keeps it alive */
+    arc_http_client_config_t config = {
+        .default_timeout_ms = (uint32_t)cache->timeout_ms,
+        .max_response_size = cache->max_body,
+    };
+    arc_err_t err = arc_http_client_create(&config, &cache->client);
+    if (err != ARC_OK) {
+        ac_http_cache_close(cache);
+        return err;
+    }
+
+    *out = cache;
+    return ARC_OK;
+}
+
+void ac_http_cache_close(ac_http_cache_t *cache) {
+    if (!cache) return;
+    arc_http_client_destroy(cache->client);
+    free(cache->user_agent);
+    free(cache->accept);
+    free(cache);
+}
+
+arc_err_t ac_http_cache_fetch(ac_http_cache_t *cache, const char *url, ac_http_fetch_t *out) {
+    if (!out) return ARC_ERR_INVALID_ARG;
+    memset(out, 0, sizeof(*out));
+    if (!cache || !url || !url[0]) return ARC_ERR_INVALID_ARG;
+    cache->error[0] = '\0';
+    if (!is_http_url(url)) {
+        set_error(cache, "not an http or https URL: %.400s", url);
+        return ARC_ERR_INVALID_ARG;
+    }
+
+    char key[17];
+    url_key(url, key);
+    long long now = (long long)time(NULL);
+
+    entry_t e;
+    char *cached = NULL;
+    if (entry_load(cache, key, url, &e) == 0) {
+        cached = entry_body(cache, key, &e);
+        if (!cached) entry_free(&e);
+    }
+
+    if (cached && e.fresh_for > 0 && now >= e.stored && now - e.stored < e.fresh_for) {
+        cache->stats.hits++;
+        entry_touch(cache, key);
+        arc_err_t err = serve_entry(out, &e, cached, AC_HTTP_FROM_CACHE);
+        entry_free(&e);
+        return err;
+    }
+
+    /* Revalidate where the cached copy came from; a redirect drops the validators */
+    char *target = strdup(cached ? e.final_url : url);
+    arc_http_response_t resp;
+    memset(&resp, 0, sizeof(resp));
+    long long deadline = now_ms() + cache->timeout_ms;
+    arc_err_t err = ARC_OK;
+
+    for (int hop = 0; target; hop++) {
+        int conditional = cached && hop == 0;
+        err = send_get(cache, target, conditional ? e.etag : NULL, conditional ? e.last_modified : NULL,
+                       (int)(deadline - now_ms()), &resp);
+        if (err != ARC_OK || !is_redirect(resp.status_code)) break;
+
+        const char *location = header(resp.headers, "Location");
+        if (!location || !location[0]) break;
+        if (hop >= cache->max_redirects) {
+            snprintf(cache->error, sizeof(cache->error), "more than %d redirects", cache->max_redirects);
+            err = ARC_ERR_PROTOCOL;
+            break;
+        }
+        char *next = web_resolve_url(target, location);
+        if (next && !is_http_url(next)) {
+            snprintf(cache->error, sizeof(cache->error), "redirect to a non-HTTP URL: %.400s", next);
+            free(next);
+            err = ARC_ERR_PROTOCOL;
+            break;
+        }
+        free(target);
+        target = next;
+        arc_http_response_free(&resp);
+        memset(&resp, 0, sizeof(resp));
+    }
+    if (!target) err = ARC_ERR_NO_MEMORY;
+
+    if (err != ARC_OK) {
+        arc_http_response_free(&resp);
+        free(target);
+        if (cached && err != ARC_ERR_PROTOCOL) {
+            /* Better an old copy than none */
+            AC_LOG_WARN("HTTP cache: serving stale %s: %s", url, cache->error);
+            err = serve_entry(out, &e, cached, AC_HTTP_FROM_CACHE);
+            out->stale = 1;
+            entry_free(&e);
+            return err;
+        }
+        free(cached);
+        if (cached) entry_free(&e);
+        return err;
+    }
+
+    if (resp.status_code == 304 && cached) {
+        /* Headers of a 304 update the stored ones */
+        policy_t policy = response_policy(cache, resp.headers, now);
+        const char *etag = header(resp.headers, "ETag");
+        const char *modified = header(resp.headers, "Last-Modified");
+        if (etag) {
+            free(e.etag);
+            e.etag = strdup(etag);
+        }
+        if (modified) {
+            free(e.last_modified);
+            e.last_modified = strdup(modified);
+        }
+        e.stored = now;
+        e.fresh_for = policy.fresh_for;
+        if (e.etag && e.last_modified) {
+            if (policy.no_store) entry_remove(cache, key);
+            else entry_save_meta(cache, key, &e);
+        }
+        cache->stats.revalidated++;
+        arc_http_response_free(&resp);
+        free(target);
+        err = serve_entry(out, &e, cached, AC_HTTP_REVALIDATED);
+        entry_free(&e);
+        return err;
+    }
+
+    if (resp.status_code == 200) {
+        policy_t policy = response_policy(cache, resp.headers, now);
+        if (policy.no_store) entry_remove(cache, key);
+        else entry_store(cache, key, url, target, &resp, &policy, now);
+    }
+    free(cached);
+    if (cached) entry_free(&e);
+
+    out->status = resp.status_code;
+    out->url = target;
+    out->content_type = dup_or_empty(header(resp.headers, "Content-Type"));
+    out->body = resp.body ? resp.body : strdup("");
+    out->size = resp.body_len;
+    out->source = AC_HTTP_FROM_NETWORK;
+    resp.body = NULL;
+    arc_http_response_free(&resp);
+    if (!out->content_type || !out->body) {
+        ac_http_fetch_free(out);
+        return ARC_ERR_NO_MEMORY;
+    }
+    return ARC_OK;
+}
+
+void ac_http_fetch_free(ac_http_fetch_t *fetch) {
+    if (!fetch) return;
+    free(fetch->url);
+    free(fetch->content_type);
+    free(fetch->body);
+    memset(fetch, 0, sizeof(*fetch));
+}
+
+const char *ac_http_cache_error(const ac_http_cache_t *cache) {
+    return cache ? cache->error : "";
+}
+
+void ac_http_cache_stats(const ac_http_cache_t *cache, ac_http_cache_stats_t *stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (cache) *stats = cache->stats;
+}
+
+#endif /* !_WIN32 */
@@ -0,0 +1,16 @@
+/**
+ * @file web_internal.h
+ * @brief Internal declarations shared by the web fetching components
+ */
+
+#ifndef ARC_HOSTED_WEB_INTERNAL_H
+#define ARC_HOSTED_WEB_INTERNAL_H
+
+/*
+ * ref resolved against base (RFC 3986, with "." and ".." segments
+ * removed). A ref with a scheme, or a NULL base, is returned as is.
+ * Returns NULL on allocation failure; free() the result.
+ */
+char *web_resolve_url(const char *base, const char *ref);
+
+#endif /* ARC_HOSTED_WEB_INTERNAL_H */
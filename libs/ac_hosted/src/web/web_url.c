@@ -0,0 +1,100 @@
+/**
+ * @file web_url.c
+ * @brief Resolving links and redirects against a page URL
+ */
+
+#include "web_internal.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int has_scheme(const char *s) {
+    if (!isalpha((unsigned char)s[0])) return 0;
+    size_t i = 1;
+    while (isalnum((unsigned char)s[i]) || s[i] == '+' || s[i] == '-' || s[i] == '.') i++;
+    return s[i] == ':';
+}
+
+/* Remove "." and ".." segments from the path of url, in place */
+static void remove_dot_segments(char *url) {
+    char *path = strstr(url, "://");
+    path = path ? strchr(path + 3, '/') : NULL;
+    if (!path) return;
+    size_t tail_at = strcspn(path, "?#");
+    char tail[4096];
+    snprintf(tail, sizeof(tail), "%s", path + tail_at);
+    path[tail_at] = '\0';
+
+    /* Segments after the leading '/' */
+    char *segs[512];
+    size_t count = 0;
+    int trailing_slash = 0;
+    char *p = path + 1;
+    while (p) {
+        char *slash = strchr(p, '/');
+        if (slash) *slash = '\0';
+        trailing_slash = 0;
+        if (strcmp(p, ".") == 0) {
+            trailing_slash = 1;
+        } else if (strcmp(p, "..") == 0) {
+            if (count > 0) count--;
+            trailing_slash = 1;
+        } else if (count < sizeof(segs) / sizeof(segs[0])) {
+            segs[count++] = p;
+        }
+        p = slash ? slash + 1 : NULL;
+    }
+
+    char result[4096];
+    size_t len = 0;
+    for (size_t i = 0; i < count && len < sizeof(result) - 2; i++) {
+        len += (size_t)snprintf(result + len, sizeof(result) - len, "/%s", segs[i]);
+    }
+    if (len == 0 || (trailing_slash && len < sizeof(result) - 1)) result[len++] = '/';
+    result[len] = '\0';
+    /* Never longer than the original path */
+    strcpy(path, result);
+    strcat(path, tail);
+}
+
+/* ref resolved against base (RFC 3986, enough for links in pages); free() it */
+char *web_resolve_url(const char *base, const char *ref) {
+    while (*ref == ' ' || *ref == '\t' || *ref == '\n' || *ref == '\r') ref++;
+    if (!base || !base[0] || has_scheme(ref)) return strdup(ref);
+
+    const char *authority = strstr(base, "://");
+    if (!authority) return strdup(ref);
+    size_t scheme_len = (size_t)(authority - base);
+    const char *path = strchr(authority + 3, '/');
+    size_t origin_len = path ? (size_t)(path - base) : strcspn(base, "?#");
+
+    size_t size = strlen(base) + strlen(ref) + 4;
+    char *out = malloc(size);
+    if (!out) return NULL;
+
+    if (ref[0] == '/' && ref[1] == '/') {
+        snprintf(out, size, "%.*s:%s", (int)scheme_len, base, ref);
+    } else if (ref[0] == '/') {
+        snprintf(out, size, "%.*s%s", (int)origin_len, base, ref);
+    } else if (ref[0] == '?') {
+        snprintf(out, size, "%.*s%s", (int)strcspn(base, "?#"), base, ref);
+    } else if (ref[0] == '#' || ref[0] == '\0') {
+        snprintf(out, size, "%.*s%s", (int)strcspn(base, "#"), base, ref);
+    } else {
+        /* Relative to the directory of the base path */
+        size_t base_path_end = strcspn(base, "?#");
+        size_t dir_end = origin_len;
+        for (size_t i = origin_len; i < base_path_end; i++) {
+            if (base[i] == '/') dir_end = i + 1;
+        }
+        if (dir_end == origin_len) {
+            snprintf(out, size, "%.*s/%s", (int)origin_len, base, ref);
+        } else {
+            snprintf(out, size, "%.*s%s", (int)dir_end, base, ref);
+        }
+    }
+    if (strlen(out) < 4096) remove_dot_segments(out);
+    return out;
+}
+
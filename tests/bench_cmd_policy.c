@@ -0,0 +1,126 @@
+/**
+ * @file bench_cmd_policy.c
+ * @brief Command policy throughput: compiled policy vs. a strstr table
+ *
+ * Evaluates a mix of typical agent commands against
+ *   - a strstr() scan over a pattern table (the previous sandbox check),
+ *   - the built-in compiled policy,
+ *   - compiled policies with growing numbers of synthetic program rules,
+ *     next to a strstr() scan over the same number of names.
+ * The compiled policy scans each command once, so its cost should stay
+ * flat as rules are added while the strstr scan grows linearly.
+ *
+ * Usage: bench_cmd_policy [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <arc/command_policy.h>
+
+static const char *g_commands[] = {
+    "ls -la src",
+    "git status --short",
+    "make -j8 && ./build/tests/run_all",
+    "grep -rn 'TODO' --include='*.c' libs | head -20",
+    "cd build && cmake .. -DCMAKE_BUILD_TYPE=Release",
+    "find . -name '*.o' -newer Makefile -print",
+    "python3 -c 'import sys; print(sys.version)'",
+    "cat README.md | sed -n '1,40p'",
+    "FOO=1 env nice -n 5 ./scripts/run.sh --fast > out.log 2>&1",
+    "echo $(git rev-parse HEAD) > .version",
+    "rm -rf build/CMakeFiles",
+    "curl --version",
+};
+
+#define COMMAND_COUNT (sizeof(g_commands) / sizeof(g_commands[0]))
+
+/* The strstr table the sandbox used before the compiled policy */
+static const char *g_strstr_patterns[] = {
+    "rm -rf /", "rm -rf /*", "rm -rf ~", "rm -rf $HOME", "mkfs", "dd if=",
+    "> /dev/sd", "chmod -R 777 /", "chown -R", ":(){:|:&};:", "sudo ", "su -",
+    "shutdown", "reboot", "init 0", "init 6", "systemctl", "curl", "wget",
+    "nc ", "netcat", "ssh ", "scp ",
+};
+
+static volatile int g_sink;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int strstr_scan(const char *command, const char **patterns, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (strstr(command, patterns[i])) return 1;
+    }
+    return 0;
+}
+
+/* Nanoseconds per command */
+static double bench_strstr(const char **patterns, size_t count, int iterations) {
+    double start = now_sec();
+    for (int i = 0; i < iterations; i++) {
+        for (size_t c = 0; c < COMMAND_COUNT; c++) {
+            g_sink += strstr_scan(g_commands[c], patterns, count);
+        }
+    }
+    return (now_sec() - start) * 1e9 / ((double)iterations * COMMAND_COUNT);
+}
+
+static double bench_policy(const ac_cmd_policy_t *policy, int iterations) {
+    ac_cmd_verdict_t verdict;
+    double start = now_sec();
+    for (int i = 0; i < iterations; i++) {
+        for (size_t c = 0; c < COMMAND_COUNT; c++) {
+            ac_cmd_policy_eval(policy, g_commands[c], &verdict);
+            g_sink += (int)verdict.action;
+        }
+    }
+    return (now_sec() - start) * 1e9 / ((double)iterations * COMMAND_COUNT);
+}
+
+int main(int argc, char **argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+
+    const ac_cmd_policy_t *builtin = ac_cmd_policy_default();
+    if (!builtin) return 1;
+
+    printf("%-28s %12s\n", "matcher", "ns/command");
+    printf("%-28s %12.0f\n", "strstr table (23 patterns)",
+           bench_strstr(g_strstr_patterns, sizeof(g_strstr_patterns) / sizeof(g_strstr_patterns[0]),
+                        iterations));
+    printf("%-28s %12.0f\n", "default policy", bench_policy(builtin, iterations));
+
+    printf("\n%-8s %14s %14s\n", "rules", "strstr (ns)", "policy (ns)");
+    for (size_t rules = 16; rules <= 4096; rules *= 4) {
+        ac_cmd_rule_t *table = calloc(rules, sizeof(*table));
+        char **names = calloc(rules, sizeof(*names));
+        if (!table || !names) return 1;
+        for (size_t i = 0; i < rules; i++) {
+            names[i] = malloc(24);
+            snprintf(names[i], 24, "tool%zu", i * 7919 % 100003);
+            table[i].program = names[i];
+            table[i].action = AC_CMD_CONFIRM;
+            table[i].category = AC_CMD_CAT_SYSTEM;
+            table[i].reason = "synthetic";
+        }
+
+        ac_cmd_policy_t *policy = ac_cmd_policy_compile(table, rules);
+        if (!policy) return 1;
+        int rounds = iterations / 4 > 0 ? iterations / 4 : 1;
+        double naive = bench_strstr((const char **)names, rules, rounds);
+        double compiled = bench_policy(policy, rounds);
+        printf("%-8zu %14.0f %14.0f\n", rules, naive, compiled);
+
+        ac_cmd_policy_free(policy);
+        for (size_t i = 0; i < rules; i++) free(names[i]);
+        free(names);
+        free(table);
+    }
+
+    return g_sink == -1;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file bench_json_escape.c
+ * @brief Throughput of ac_json_escape vs. a byte-at-a-time escaper
+ *
+ * Usage: bench_json_escape [megabytes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "arc/json_escape.h"
+#include "cJSON.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* The escaper this replaces (cJSON print_string_ptr / trace exporter) */
+static size_t escape_bytewise(char *out, const char *in, size_t len) {
+    char *w = out;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)in[i];
+        if (c > 31 && c != '"' && c != '\\') {
+            *w++ = (char)c;
+            continue;
+        }
+        *w++ = '\\';
+        switch (c) {
+            case '"':  *w++ = '"'; break;
+            case '\\': *w++ = '\\'; break;
+            case '\n': *w++ = 'n'; break;
+            case '\r': *w++ = 'r'; break;
+            case '\t': *w++ = 't'; break;
+            default:   w += sprintf(w, "u%04x", c); break;
+        }
+    }
+    return (size_t)(w - out);
+}
+
+static void fill(char *buf, size_t len, const char *pattern) {
+    size_t plen = strlen(pattern);
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = pattern[i % plen];
+    }
+}
+
+static void run(const char *name, const char *in, size_t len, char *out, int iters) {
+    double t0 = now_sec();
+    size_t sink = 0;
+    for (int i = 0; i < iters; i++) {
+        sink += escape_bytewise(out, in, len);
+    }
+    double t_byte = now_sec() - t0;
+
+    t0 = now_sec();
+    for (int i = 0; i < iters; i++) {
+        size_t used = 0;
+        sink += ac_json_escape(out, AC_JSON_ESCAPE_MAX(len), in, len, &used, NULL);
+    }
+    double t_simd = now_sec() - t0;
+
+    double mb = (double)len * iters / (1024.0 * 1024.0);
+    printf("%-22s bytewise %8.1f MB/s   ac_json_escape %8.1f MB/s   x%.2f  (%zu)\n",
+           name, mb / t_byte, mb / t_simd, t_byte / t_simd, sink & 1);
+}
+
+int main(int argc, char **argv) {
+    size_t mb = argc > 1 ? (size_t)atoi(argv[1]) : 16;
+    size_t len = mb * 1024 * 1024;
+    char *in = malloc(len);
+    char *out = malloc(AC_JSON_ESCAPE_MAX(len));
+    int iters = 8;
+
+    printf("implementation: %s, input %zu MB x %d\n\n", ac_json_escape_impl(), mb, iters);
+
+    fill(in, len, "The quick brown fox jumps over the lazy dog. ");
+    run("plain ascii", in, len, out, iters);
+
+    fill(in, len, "    if (x) {\n        return \"value\";\n    }\n");
+    run("source code", in, len, out, iters);
+
+    fill(in, len, "{\"role\":\"user\",\"content\":\"line\\n\"},");
+    run("nested json", in, len, out, iters);
+
+    fill(in, len, "\xe4\xb8\xad\xe6\x96\x87\xe6\xb5\x8b\xe8\xaf\x95 text ");
+    run("mixed utf-8", in, len, out, iters);
+
+    /* End to end: cJSON_PrintUnformatted of a large message body */
+    fill(in, len, "    if (x) {\n        return \"value\";\n    }\n");
+    in[len - 1] = '\0';
+    cJSON *obj = cJSON_CreateObject();
+    cJSON_AddStringToObject(obj, "content", in);
+    double t0 = now_sec();
+    for (int i = 0; i < iters; i++) {
+        char *s = cJSON_PrintUnformatted(obj);
+        cJSON_free(s);
+    }
+    double t = now_sec() - t0;
+    printf("%-22s %8.1f MB/s\n", "cJSON print", (double)len * iters / (1024.0 * 1024.0) / t);
+    cJSON_Delete(obj);
+
+    free(out);
+    free(in);
+    return 0;
+}
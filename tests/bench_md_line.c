@@ -0,0 +1,176 @@
+/**
+ * @file bench_md_line.c
+ * @brief Markdown block classification: line classifier vs. per-line PCRE2
+ *
+ * Builds a synthetic model response (prose, lists, tables, code) and
+ * measures block classification and full parse/stream throughput.
+ *
+ * Usage: bench_md_line [megabytes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+
+#include "md_line.h"
+#include "md_parser.h"
+#include "md_stream.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static const char* s_sample =
+    "## Analysis\n"
+    "\n"
+    "The function `parse_config` reads the file and **validates** each entry\n"
+    "before it is applied. There are a few issues worth pointing out:\n"
+    "\n"
+    "1. The buffer is never freed on the error path.\n"
+    "2. `strtol` results are not range-checked.\n"
+    "   - negative values wrap around\n"
+    "   - values above INT_MAX are truncated\n"
+    "\n"
+    "> Note: this only affects builds without assertions.\n"
+    "\n"
+    "| Field | Type | Default |\n"
+    "|-------|:----:|--------:|\n"
+    "| port  | int  | 8080    |\n"
+    "| host  | str  | *any*   |\n"
+    "\n"
+    "```c\n"
+    "int parse_config(const char *path) {\n"
+    "    FILE *f = fopen(path, \"r\");\n"
+    "    if (!f) return -1;\n"
+    "}\n"
+    "```\n"
+    "\n"
+    "---\n"
+    "\n";
+
+/* The per-line matching this classifier replaced */
+static pcre2_code* compile(const char* pattern) {
+    int err;
+    PCRE2_SIZE off;
+    return pcre2_compile((PCRE2_SPTR)pattern, PCRE2_ZERO_TERMINATED, 0, &err, &off, NULL);
+}
+
+static int regex_match(pcre2_code* re, const char* line) {
+    pcre2_match_data* md = pcre2_match_data_create(10, NULL);
+    int rc = pcre2_match(re, (PCRE2_SPTR)line, PCRE2_ZERO_TERMINATED, 0, 0, md, NULL);
+    pcre2_match_data_free(md);
+    return rc > 0;
+}
+
+static void null_output(const char* text, size_t len, void* userdata) {
+    (void)text;
+    *(size_t*)userdata += len;
+}
+
+int main(int argc, char** argv) {
+    size_t mb = argc > 1 ? (size_t)atoi(argv[1]) : 4;
+    size_t target = mb * 1024 * 1024;
+    size_t sample_len = strlen(s_sample);
+    size_t reps = target / sample_len + 1;
+
+    char* doc = malloc(reps * sample_len + 1);
+    for (size_t i = 0; i < reps; i++) {
+        memcpy(doc + i * sample_len, s_sample, sample_len);
+    }
+    size_t doc_len = reps * sample_len;
+    doc[doc_len] = '\0';
+
+    /* Split into NUL-terminated lines */
+    char* lines_buf = malloc(doc_len + 1);
+    memcpy(lines_buf, doc, doc_len + 1);
+    size_t line_count = 0;
+    for (size_t i = 0; i < doc_len; i++) {
+        if (lines_buf[i] == '\n') line_count++;
+    }
+    char** lines = malloc(line_count * sizeof(char*));
+    size_t* lens = malloc(line_count * sizeof(size_t));
+    char* p = lines_buf;
+    for (size_t i = 0; i < line_count; i++) {
+        char* nl = strchr(p, '\n');
+        *nl = '\0';
+        lines[i] = p;
+        lens[i] = (size_t)(nl - p);
+        p = nl + 1;
+    }
+
+    double mbytes = (double)doc_len / (1024.0 * 1024.0);
+    printf("input: %.1f MB, %zu lines\n\n", mbytes, line_count);
+
+    /* PCRE2, in the order md_parse used to try them */
+    pcre2_code* re[6] = {
+        compile("^(#{1,6})\\s+(.*)$"),
+        compile("^\\s*([-*_])\\s*\\1\\s*\\1\\s*$"),
+        compile("^\\s*>\\s?(.*)$"),
+        compile("^(\\s*)([-*+])\\s+(.*)$"),
+        compile("^(\\s*)(\\d+)\\.\\s+(.*)$"),
+        compile("^\\|?\\s*(:?-+:?)\\s*(\\|\\s*:?-+:?\\s*)*\\|?\\s*$"),
+    };
+    size_t hits = 0;
+    double t0 = now_sec();
+    for (size_t i = 0; i < line_count; i++) {
+        for (int r = 0; r < 6; r++) {
+            if (regex_match(re[r], lines[i])) {
+                hits++;
+                break;
+            }
+        }
+    }
+    double t_regex = now_sec() - t0;
+
+    size_t blocks = 0;
+    t0 = now_sec();
+    for (size_t i = 0; i < line_count; i++) {
+        md_line_t info;
+        if (md_classify_line(lines[i], lens[i], &info) != MD_LINE_TEXT || info.table_sep) {
+            blocks++;
+        }
+    }
+    double t_class = now_sec() - t0;
+
+    printf("%-20s %9.1f MB/s  %8.1f ns/line  (%zu)\n", "pcre2 per line",
+           mbytes / t_regex, t_regex * 1e9 / line_count, hits);
+    printf("%-20s %9.1f MB/s  %8.1f ns/line  (%zu)\n", "md_classify_line",
+           mbytes / t_class, t_class * 1e9 / line_count, blocks);
+    printf("%-20s x%.1f\n\n", "speedup", t_regex / t_class);
+
+    /* End to end */
+    t0 = now_sec();
+    md_block_token_t* tokens = md_parse(doc);
+    double t_parse = now_sec() - t0;
+    md_free_tokens(tokens);
+    printf("%-20s %9.1f MB/s\n", "md_parse", mbytes / t_parse);
+
+    size_t out_bytes = 0;
+    md_stream_t* stream = md_stream_new();
+    md_stream_set_output(stream, null_output, &out_bytes);
+    t0 = now_sec();
+    /* Feed in small chunks, as tokens arrive from the model */
+    for (size_t off = 0; off < doc_len; off += 16) {
+        size_t n = doc_len - off < 16 ? doc_len - off : 16;
+        md_stream_feed(stream, doc + off, n);
+    }
+    md_stream_finish(stream);
+    double t_stream = now_sec() - t0;
+    md_stream_free(stream);
+    printf("%-20s %9.1f MB/s  (%zu bytes out)\n", "md_stream", mbytes / t_stream, out_bytes);
+
+    for (int r = 0; r < 6; r++) {
+        pcre2_code_free(re[r]);
+    }
+    free(lens);
+    free(lines);
+    free(lines_buf);
+    free(doc);
+    return 0;
+}
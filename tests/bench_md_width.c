@@ -0,0 +1,159 @@
+/**
+ * @file bench_md_width.c
+ * @brief Display width: lookup table + ASCII fast path vs. range comparisons
+ *
+ * Measures per-line width computation, as done for code lines and table
+ * cells, on code, CJK prose, emoji-heavy chat and a mix of the three.
+ *
+ * Usage: bench_md_width [megabytes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "md_utils.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static const char* s_code =
+    "static int parse_config(const char *path, config_t *out) {\n"
+    "    FILE *f = fopen(path, \"r\");\n"
+    "    if (!f) return -1;  /* caller logs errno */\n"
+    "    while (fgets(line, sizeof(line), f)) {\n"
+    "        if (line[0] == '#') continue;\n"
+    "    }\n"
+    "}\n";
+
+static const char* s_cjk =
+    "\xe8\xbf\x99\xe4\xb8\xaa\xe5\x87\xbd\xe6\x95\xb0\xe8\xaf\xbb\xe5\x8f\x96\xe9\x85\x8d\xe7\xbd\xae"
+    "\xe6\x96\x87\xe4\xbb\xb6\xef\xbc\x8c\xe5\xb9\xb6\xe9\xaa\x8c\xe8\xaf\x81\xe6\xaf\x8f\xe4\xb8\x80"
+    "\xe9\xa1\xb9\xe3\x80\x82\n"
+    "\xe9\x94\x99\xe8\xaf\xaf\xe8\xb7\xaf\xe5\xbe\x84\xe4\xb8\x8a\xe6\xb2\xa1\xe6\x9c\x89\xe9\x87\x8a"
+    "\xe6\x94\xbe buffer\xe3\x80\x82\n";
+
+static const char* s_emoji =
+    "Done \xe2\x9c\x85 all tests pass \xf0\x9f\x8e\x89\n"
+    "\xe2\x9a\xa0\xef\xb8\x8f careful with \xf0\x9f\x91\xa8\xe2\x80\x8d\xf0\x9f\x92\xbb edits\n"
+    "\xf0\x9f\x91\x8d\xf0\x9f\x8f\xbd looks good \xe2\x9d\xa4\xef\xb8\x8f\n";
+
+/* ========== Previous implementation ========== */
+
+static int legacy_char_width(uint32_t codepoint) {
+    if (codepoint == 0 ||
+        (codepoint >= 0x0300 && codepoint <= 0x036F) ||
+        (codepoint >= 0x200B && codepoint <= 0x200F) ||
+        (codepoint >= 0x2060 && codepoint <= 0x206F) ||
+        (codepoint >= 0xFE00 && codepoint <= 0xFE0F) ||
+        (codepoint >= 0xFE20 && codepoint <= 0xFE2F)) {
+        return 0;
+    }
+    if ((codepoint >= 0x1100 && codepoint <= 0x115F) ||
+        (codepoint >= 0x2E80 && codepoint <= 0x9FFF) ||
+        (codepoint >= 0xAC00 && codepoint <= 0xD7A3) ||
+        (codepoint >= 0xF900 && codepoint <= 0xFAFF) ||
+        (codepoint >= 0xFE10 && codepoint <= 0xFE1F) ||
+        (codepoint >= 0xFE30 && codepoint <= 0xFE6F) ||
+        (codepoint >= 0xFF00 && codepoint <= 0xFF60) ||
+        (codepoint >= 0xFFE0 && codepoint <= 0xFFE6) ||
+        (codepoint >= 0x20000 && codepoint <= 0x2FFFD) ||
+        (codepoint >= 0x30000 && codepoint <= 0x3FFFD)) {
+        return 2;
+    }
+    if ((codepoint >= 0x1F300 && codepoint <= 0x1F9FF) ||
+        (codepoint >= 0x1FA00 && codepoint <= 0x1FAFF)) {
+        return 2;
+    }
+    return 1;
+}
+
+static int legacy_display_width(const char* str) {
+    int width = 0;
+    int bytes;
+    while (*str) {
+        uint32_t cp = md_utf8_decode(str, &bytes);
+        if (bytes == 0) break;
+        width += legacy_char_width(cp);
+        str += bytes;
+    }
+    return width;
+}
+
+/* ========== Harness ========== */
+
+typedef struct {
+    char** lines;
+    size_t count;
+    size_t bytes;
+} corpus_t;
+
+static void build_corpus(corpus_t* c, const char** parts, size_t nparts, size_t target) {
+    size_t cap = 1024;
+    c->lines = malloc(cap * sizeof(char*));
+    c->count = 0;
+    c->bytes = 0;
+    while (c->bytes < target) {
+        for (size_t i = 0; i < nparts; i++) {
+            for (const char* p = parts[i]; *p; ) {
+                const char* nl = strchr(p, '\n');
+                size_t len = (size_t)(nl - p);
+                if (c->count == cap) {
+                    cap *= 2;
+                    c->lines = realloc(c->lines, cap * sizeof(char*));
+                }
+                c->lines[c->count] = malloc(len + 1);
+                memcpy(c->lines[c->count], p, len);
+                c->lines[c->count][len] = '\0';
+                c->count++;
+                c->bytes += len;
+                p = nl + 1;
+            }
+        }
+    }
+}
+
+static void free_corpus(corpus_t* c) {
+    for (size_t i = 0; i < c->count; i++) free(c->lines[i]);
+    free(c->lines);
+}
+
+static void run(const char* name, const char** parts, size_t nparts, size_t target) {
+    corpus_t c;
+    build_corpus(&c, parts, nparts, target);
+    double mbytes = (double)c.bytes / (1024.0 * 1024.0);
+
+    long sum_old = 0, sum_new = 0;
+    double t0 = now_sec();
+    for (size_t i = 0; i < c.count; i++) sum_old += legacy_display_width(c.lines[i]);
+    double t_old = now_sec() - t0;
+
+    t0 = now_sec();
+    for (size_t i = 0; i < c.count; i++) sum_new += md_utf8_display_width(c.lines[i]);
+    double t_new = now_sec() - t0;
+
+    printf("%-8s ranges %8.1f MB/s   table %8.1f MB/s   x%.1f   (columns %ld vs %ld)\n",
+           name, mbytes / t_old, mbytes / t_new, t_old / t_new, sum_old, sum_new);
+    free_corpus(&c);
+}
+
+int main(int argc, char** argv) {
+    size_t mb = argc > 1 ? (size_t)atoi(argv[1]) : 16;
+    size_t target = mb * 1024 * 1024;
+
+    const char* code[] = { s_code };
+    const char* cjk[] = { s_cjk };
+    const char* emoji[] = { s_emoji };
+    const char* mixed[] = { s_code, s_cjk, s_emoji };
+
+    printf("input: %zu MB per corpus\n\n", mb);
+    run("code", code, 1, target);
+    run("cjk", cjk, 1, target);
+    run("emoji", emoji, 1, target);
+    run("mixed", mixed, 3, target);
+    return 0;
+}
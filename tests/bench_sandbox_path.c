@@ -0,0 +1,110 @@
+/**
+ * @file bench_sandbox_path.c
+ * @brief Sandbox path check cost: compiled index vs. walking the lists
+ *
+ * Collects the files under a directory tree and checks each of them
+ *   - with ac_sandbox_path_is_under() against the workspace, the path
+ *     rules and the default readonly paths (the previous check), and
+ *   - with ac_sandbox_check_path(), which uses the compiled index.
+ * Both sandboxes use the tree as workspace; a few path rules are added so
+ * the list walk has the usual amount of work.
+ *
+ * Usage: bench_sandbox_path [directory] [max_files]
+ */
+
+#define _XOPEN_SOURCE 700
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sandbox_internal.h"
+
+static char **g_files;
+static size_t g_count;
+static size_t g_max;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int collect(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)ftw;
+    if (type == FTW_F) {
+        g_files[g_count++] = strdup(path);
+    }
+    return g_count >= g_max;
+}
+
+/* The check as it was: every configured path, normalized on every call */
+static int list_walk(const ac_sandbox_t *sandbox, const char *path) {
+    if (ac_sandbox_path_is_under(sandbox->workspace_path, path)) return 1;
+    for (size_t i = 0; i < sandbox->path_rules_count; i++) {
+        if (ac_sandbox_path_is_under(sandbox->path_rules[i].path, path)) return 1;
+    }
+    const char **defaults = ac_sandbox_get_default_readonly_paths();
+    for (int i = 0; defaults[i]; i++) {
+        if (ac_sandbox_path_is_under(defaults[i], path)) return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *root = argc > 1 ? argv[1] : ".";
+    g_max = argc > 2 ? (size_t)atol(argv[2]) : 20000;
+    g_files = calloc(g_max, sizeof(char *));
+    if (!g_files) return 1;
+    nftw(root, collect, 32, FTW_PHYS);
+    if (g_count == 0) {
+        fprintf(stderr, "no files under %s\n", root);
+        return 1;
+    }
+
+    ac_sandbox_path_rule_t rules[] = {
+        { .path = "/opt", .permissions = AC_SANDBOX_PERM_FS_READ },
+        { .path = "/srv", .permissions = AC_SANDBOX_PERM_FS_ALL },
+        { .path = "/var/tmp", .permissions = AC_SANDBOX_PERM_FS_ALL },
+        { .path = "/home", .permissions = AC_SANDBOX_PERM_FS_READ },
+    };
+    ac_sandbox_config_t config = AC_SANDBOX_CONFIG_DEFAULT(root);
+    config.path_rules = rules;
+    config.path_rules_count = sizeof(rules) / sizeof(rules[0]);
+    config.log_violations = 0;
+    ac_sandbox_t *sandbox = ac_sandbox_create(&config);
+    if (!sandbox) return 1;
+
+    int allowed_lists = 0, allowed_index = 0;
+    double start = now_sec();
+    for (size_t i = 0; i < g_count; i++) {
+        allowed_lists += list_walk(sandbox, g_files[i]);
+    }
+    double lists = now_sec() - start;
+
+    /* First pass fills the directory cache, second one hits it */
+    start = now_sec();
+    for (size_t i = 0; i < g_count; i++) {
+        allowed_index += ac_sandbox_check_path(sandbox, g_files[i], AC_SANDBOX_PERM_FS_READ);
+    }
+    double cold = now_sec() - start;
+    start = now_sec();
+    for (size_t i = 0; i < g_count; i++) {
+        ac_sandbox_check_path(sandbox, g_files[i], AC_SANDBOX_PERM_FS_READ);
+    }
+    double warm = now_sec() - start;
+
+    printf("%zu files under %s (allowed: lists %d, index %d)\n\n",
+           g_count, root, allowed_lists, allowed_index);
+    printf("%-22s %12s\n", "check", "us/path");
+    printf("%-22s %12.2f\n", "list walk", lists * 1e6 / (double)g_count);
+    printf("%-22s %12.2f\n", "index (cold cache)", cold * 1e6 / (double)g_count);
+    printf("%-22s %12.2f\n", "index (warm cache)", warm * 1e6 / (double)g_count);
+
+    ac_sandbox_destroy(sandbox);
+    for (size_t i = 0; i < g_count; i++) free(g_files[i]);
+    free(g_files);
+    return 0;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file bench_sandbox_spawn.c
+ * @brief Sandbox shell spawn latency: posix_spawn vs. fork at growing RSS
+ *
+ * Starts "/bin/sh -c true" repeatedly and waits for it, with the parent
+ * holding 0 MB up to the largest size given of touched heap memory.
+ * fork() copies the page tables of that memory; posix_spawn() does not.
+ *
+ * Usage: bench_sandbox_spawn [max_megabytes] [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#include "sandbox_internal.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Average microseconds per spawn + wait */
+static double bench(ac_sandbox_spawn_method_t method, int iterations, int null_fd) {
+    double start = now_sec();
+    for (int i = 0; i < iterations; i++) {
+        pid_t pid;
+        if (ac_sandbox_spawn_shell("true", -1, null_fd, null_fd, method, NULL, &pid) != 0) {
+            fprintf(stderr, "spawn failed\n");
+            exit(1);
+        }
+        int status;
+        waitpid(pid, &status, 0);
+    }
+    return (now_sec() - start) * 1e6 / iterations;
+}
+
+int main(int argc, char** argv) {
+    size_t max_mb = argc > 1 ? (size_t)atoi(argv[1]) : 1024;
+    int iterations = argc > 2 ? atoi(argv[2]) : 200;
+
+    int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (null_fd < 0) return 1;
+
+    printf("%-10s %14s %14s %8s\n", "RSS (MB)", "fork (us)", "spawn (us)", "speedup");
+
+    char* heap = NULL;
+    size_t held = 0;
+    for (size_t mb = 0; mb <= max_mb; mb = mb ? mb * 4 : 16) {
+        /* Grow the parent's resident set to mb */
+        if (mb > held) {
+            heap = realloc(heap, mb << 20);
+            if (!heap) return 1;
+            memset(heap + (held << 20), 0x5a, (mb - held) << 20);
+            held = mb;
+        }
+
+        double t_fork = bench(AC_SANDBOX_SPAWN_FORK, iterations, null_fd);
+        double t_spawn = bench(AC_SANDBOX_SPAWN_POSIX, iterations, null_fd);
+        printf("%-10zu %14.1f %14.1f %7.1fx\n", mb, t_fork, t_spawn, t_fork / t_spawn);
+    }
+
+    free(heap);
+    close(null_fd);
+    return 0;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file bench_search_grep.c
+ * @brief Content search throughput: search engine vs. regexec per line
+ *
+ * Generates a synthetic source tree (or uses a given directory) and
+ * searches every file in it with
+ *   - the previous grep tool loop: regcomp(REG_ICASE) and fgets() +
+ *     regexec() on each line, and
+ *   - ac_grep_file() with smart case (the tool's settings now),
+ * for a few typical agent patterns. Both sides get the same file list,
+ * so only the per-file search is compared.
+ *
+ * Usage: bench_search_grep [directory]
+ */
+
+#define _XOPEN_SOURCE 700
+#include <ftw.h>
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arc/grep.h>
+
+static char **g_files;
+static size_t g_count;
+static size_t g_cap;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int collect(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)ftw;
+    if (type == FTW_F) {
+        if (g_count == g_cap) {
+            g_cap = g_cap ? g_cap * 2 : 1024;
+            g_files = realloc(g_files, g_cap * sizeof(char *));
+        }
+        g_files[g_count++] = strdup(path);
+    }
+    return 0;
+}
+
+/* 2000 C-like files of ~400 lines in 40 directories */
+static void generate(const char *root) {
+    static const char *words[] = {
+        "buffer", "request", "handler", "config", "status", "result", "context",
+        "parser", "stream", "socket", "thread", "cache", "entry", "node", "queue",
+    };
+    char path[512];
+    unsigned int seed = 12345;
+    for (int d = 0; d < 40; d++) {
+        snprintf(path, sizeof(path), "%s/mod%02d", root, d);
+        mkdir(path, 0755);
+        for (int f = 0; f < 50; f++) {
+            snprintf(path, sizeof(path), "%s/mod%02d/file%02d.c", root, d, f);
+            FILE *fp = fopen(path, "w");
+            if (!fp) continue;
+            for (int l = 0; l < 400; l++) {
+                seed = seed * 1103515245 + 12345;
+                const char *a = words[(seed >> 8) % 15];
+                const char *b = words[(seed >> 16) % 15];
+                switch ((seed >> 4) % 6) {
+                case 0: fprintf(fp, "static int %s_%s(struct %s *ctx) {\n", a, b, a); break;
+                case 1: fprintf(fp, "    if (ctx->%s == NULL) return -1;\n", b); break;
+                case 2: fprintf(fp, "    /* update the %s before the %s */\n", a, b); break;
+                case 3: fprintf(fp, "    %s_t *%s = malloc(sizeof(*%s));\n", a, b, b); break;
+                case 4: fprintf(fp, "    log_debug(\"%s %%d\", ctx->%s_count);\n", a, b); break;
+                default: fprintf(fp, "}\n"); break;
+                }
+            }
+            if ((seed >> 3) % 97 == 0) fprintf(fp, "/* TODO: FIXME rare marker */\n");
+            fclose(fp);
+        }
+    }
+}
+
+/* The grep tool before the search engine */
+static int regex_lines(const char *path, regex_t *re) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;
+    char line[4096];
+    int matches = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        size_t len = strlen(line);
+        if (len > 0 && line[len - 1] == '\n') line[len - 1] = '\0';
+        if (regexec(re, line, 0, NULL, 0) == 0) matches++;
+    }
+    fclose(fp);
+    return matches;
+}
+
+static void bench(const char *label, const char *posix, const char *pcre) {
+    regex_t re;
+    if (regcomp(&re, posix, REG_EXTENDED | REG_ICASE | REG_NEWLINE) != 0) return;
+    int old_matches = 0;
+    double start = now_sec();
+    for (size_t i = 0; i < g_count; i++) old_matches += regex_lines(g_files[i], &re);
+    double old_time = now_sec() - start;
+    regfree(&re);
+
+    ac_grep_options_t opts = { .case_mode = AC_GREP_CASE_SMART };
+    ac_grep_t *g = ac_grep_compile(pcre, &opts, NULL, 0);
+    if (!g) return;
+    int new_matches = 0;
+    start = now_sec();
+    for (size_t i = 0; i < g_count; i++) {
+        int n = ac_grep_file(g, g_files[i], NULL, NULL);
+        if (n > 0) new_matches += n;
+    }
+    double new_time = now_sec() - start;
+
+    printf("%-24s %-10s %8d %8d %10.1f %10.1f %8.1fx\n", label, ac_grep_literal(g),
+           old_matches, new_matches, old_time * 1e3, new_time * 1e3, old_time / new_time);
+    ac_grep_free(g);
+}
+
+int main(int argc, char **argv) {
+    char root[64] = "";
+    if (argc > 1) {
+        nftw(argv[1], collect, 32, FTW_PHYS);
+    } else {
+        snprintf(root, sizeof(root), "/tmp/arc_grep_bench_XXXXXX");
+        if (!mkdtemp(root)) return 1;
+        generate(root);
+        nftw(root, collect, 32, FTW_PHYS);
+    }
+    if (g_count == 0) {
+        fprintf(stderr, "no files\n");
+        return 1;
+    }
+
+    /* Warm the page cache so both sides read from memory */
+    ac_grep_t *warm = ac_grep_compile("x", NULL, NULL, 0);
+    for (size_t i = 0; i < g_count; i++) ac_grep_file(warm, g_files[i], NULL, NULL);
+    ac_grep_free(warm);
+
+    printf("%zu files\n\n", g_count);
+    printf("%-24s %-10s %8s %8s %10s %10s %9s\n",
+           "pattern", "literal", "old", "new", "old (ms)", "new (ms)", "speedup");
+    bench("rare literal", "todo: fixme", "todo: fixme");
+    bench("common literal", "malloc", "malloc");
+    bench("literal + regex", "log_debug\\(\"[a-z]+ ", "log_debug\\(\"\\w+ ");
+    bench("literal after regex", "[a-z]+_[a-z]+\\(struct", "\\w+_\\w+\\(struct");
+    bench("regex, no literal", "[0-9]{3,}", "\\d{3,}");
+    bench("anchored", "^[[:space:]]+if", "^\\s+if");
+
+    if (root[0]) {
+        char cmd[128];
+        snprintf(cmd, sizeof(cmd), "rm -rf '%s'", root);
+        if (system(cmd) != 0) fprintf(stderr, "could not remove %s\n", root);
+    }
+    for (size_t i = 0; i < g_count; i++) free(g_files[i]);
+    free(g_files);
+    return 0;
+}
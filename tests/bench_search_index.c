@@ -0,0 +1,197 @@
+/**
+ * @file bench_search_index.c
+ * @brief Trigram index: build, update and query cost vs. a full scan
+ *
+ * Generates a synthetic repository (or uses a given directory) and
+ * reports
+ *   - the time to build the index from scratch and to reopen it,
+ *   - the time to rewrite it after enough files changed (inotify),
+ *   - per-literal query time, candidate count and the time to grep the
+ *     candidates, against grepping every file found by ac_walk().
+ * Times are the best of several runs (warm page cache).
+ *
+ * Usage: bench_search_index [directory]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arc/grep.h>
+#include <arc/search_index.h>
+#include <arc/walk.h>
+
+#define RUNS 5
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* 2000 C-like files of ~4 KiB; each defines a few unique identifiers */
+static void generate(const char *root) {
+    char path[512];
+    for (int d = 0; d < 40; d++) {
+        snprintf(path, sizeof(path), "%s/mod%02d", root, d);
+        mkdir(path, 0755);
+        for (int i = 0; i < 50; i++) {
+            snprintf(path, sizeof(path), "%s/mod%02d/file%02d.c", root, d, i);
+            FILE *f = fopen(path, "w");
+            if (!f) continue;
+            fprintf(f, "#include \"mod%02d.h\"\n\n", d);
+            for (int k = 0; k < 40; k++) {
+                fprintf(f, "static int helper_%02d_%02d_%02d(int value) {\n"
+                           "    return value * %d + compute_offset(value);\n}\n",
+                        d, i, k, k);
+            }
+            if (i == 7) fprintf(f, "/* TODO: remove legacy_handshake */\n");
+            fclose(f);
+        }
+    }
+}
+
+typedef struct {
+    char **paths;
+    size_t count;
+    size_t cap;
+} file_list_t;
+
+static int collect(const ac_walk_entry_t *entry, void *user_data) {
+    file_list_t *l = (file_list_t *)user_data;
+    if (entry->type != AC_WALK_FILE) return AC_WALK_CONTINUE;
+    if (l->count == l->cap) {
+        l->cap = l->cap ? l->cap * 2 : 1024;
+        l->paths = realloc(l->paths, l->cap * sizeof(char *));
+    }
+    l->paths[l->count++] = strdup(entry->rel_path);
+    return AC_WALK_CONTINUE;
+}
+
+/* Matching lines over a list of relative paths */
+static size_t grep_files(const ac_grep_t *grep, const char *root, char **paths, size_t count) {
+    size_t matches = 0;
+    for (size_t i = 0; i < count; i++) {
+        char full[4096];
+        snprintf(full, sizeof(full), "%s/%s", root, paths[i]);
+        int n = ac_grep_file(grep, full, NULL, NULL);
+        if (n > 0) matches += (size_t)n;
+    }
+    return matches;
+}
+
+static void bench_literal(ac_search_index_t *idx, const char *root, const char *literal) {
+    ac_grep_options_t gopts = { .fixed_strings = 1 };
+    ac_grep_t *grep = ac_grep_compile(literal, &gopts, NULL, 0);
+    if (!grep) return;
+
+    double best_query = 1e9, best_scan = 1e9, best_full = 1e9;
+    size_t candidates = 0, hits = 0, full_hits = 0, files = 0;
+    for (int r = 0; r < RUNS; r++) {
+        double t0 = now_sec();
+        ac_search_index_result_t res;
+        int ok = ac_search_index_query(idx, literal, strlen(literal), &res);
+        double t1 = now_sec();
+        if (ok) {
+            hits = grep_files(grep, root, res.paths, res.count);
+            candidates = res.count;
+            ac_search_index_result_free(&res);
+        }
+        double t2 = now_sec();
+
+        file_list_t all = {0};
+        ac_walk(root, NULL, collect, &all);
+        full_hits = grep_files(grep, root, all.paths, all.count);
+        files = all.count;
+        double t3 = now_sec();
+        for (size_t i = 0; i < all.count; i++) free(all.paths[i]);
+        free(all.paths);
+
+        if (t1 - t0 < best_query) best_query = t1 - t0;
+        if (t2 - t0 < best_scan) best_scan = t2 - t0;
+        if (t3 - t2 < best_full) best_full = t3 - t2;
+    }
+    ac_grep_free(grep);
+
+    printf("%-22s %6zu/%-6zu %8.2f %10.2f %10.2f %7.1fx %s\n", literal, candidates, files,
+           best_query * 1000.0, best_scan * 1000.0, best_full * 1000.0, best_full / best_scan,
+           hits == full_hits ? "" : "(MISMATCH)");
+}
+
+int main(int argc, char **argv) {
+    char tmp[256], root[300], cache[300];
+    snprintf(tmp, sizeof(tmp), "/tmp/arc_index_bench_XXXXXX");
+    if (!mkdtemp(tmp)) return 1;
+    snprintf(cache, sizeof(cache), "%s/cache", tmp);
+    if (argc < 2) {
+        snprintf(root, sizeof(root), "%s/ws", tmp);
+        mkdir(root, 0755);
+        generate(root);
+    } else {
+        snprintf(root, sizeof(root), "%s", argv[1]);
+    }
+
+    ac_search_index_options_t opts = { .cache_dir = cache };
+    ac_search_index_t *idx = NULL;
+    double t0 = now_sec();
+    if (ac_search_index_open(root, &opts, &idx) != ARC_OK) {
+        fprintf(stderr, "index open failed\n");
+        return 1;
+    }
+    double t_build = now_sec() - t0;
+    ac_search_index_stats_t st;
+    ac_search_index_stats(idx, &st);
+    ac_search_index_close(idx);
+
+    double t_reopen = 1e9;
+    for (int r = 0; r < RUNS; r++) {
+        t0 = now_sec();
+        ac_search_index_open(root, &opts, &idx);
+        double t = now_sec() - t0;
+        if (t < t_reopen) t_reopen = t;
+        ac_search_index_close(idx);
+    }
+
+    printf("%zu files, %zu trigrams, index %.1f KiB\n", st.files, st.trigrams, st.index_bytes / 1024.0);
+    printf("build %.1f ms, reopen (walk + stat) %.1f ms\n", t_build * 1000.0, t_reopen * 1000.0);
+
+    /* Queries as the grep tool issues them: watched, so no walk per query */
+    opts.watch = 1;
+    if (ac_search_index_open(root, &opts, &idx) != ARC_OK) return 1;
+
+    /* Touch enough files to force a rewrite, so postings get reused */
+    if (argc < 2) {
+        for (int d = 0; d < 4; d++) {
+            for (int i = 0; i < 40; i++) {
+                char path[512];
+                snprintf(path, sizeof(path), "%s/mod%02d/file%02d.c", root, d, i);
+                FILE *f = fopen(path, "a");
+                if (f) {
+                    fputs("/* edited */\n", f);
+                    fclose(f);
+                }
+            }
+        }
+        t0 = now_sec();
+        ac_search_index_refresh(idx);
+        double t_update = now_sec() - t0;
+        ac_search_index_stats(idx, &st);
+        printf("rewrite after 160 edits %.1f ms (%zu files reused)\n", t_update * 1000.0, st.reused);
+    }
+
+    printf("\n%-22s %13s %8s %10s %10s %8s\n", "literal", "candidates", "query", "idx+grep", "full scan", "speedup");
+    bench_literal(idx, root, "legacy_handshake");
+    bench_literal(idx, root, "helper_13_21_05");
+    bench_literal(idx, root, "compute_offset");
+    bench_literal(idx, root, "no_such_identifier");
+    printf("(ms)\n");
+
+    ac_search_index_close(idx);
+    char cmd[300];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", tmp);
+    if (system(cmd) != 0) fprintf(stderr, "could not remove %s\n", tmp);
+    return 0;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file bench_search_walk.c
+ * @brief Tree walk throughput: walker vs. opendir/readdir + stat recursion
+ *
+ * Generates a synthetic repository (or uses a given directory) with an
+ * ignored build/ and node_modules/ tree next to the sources, and lists
+ * every file with
+ *   - the previous tool loop: recursive readdir() with a stat() per
+ *     entry and only hard-coded directory names skipped, and
+ *   - ac_walk() with 1 thread and with the default thread count.
+ * Times are the best of several runs (warm page cache).
+ *
+ * Usage: bench_search_walk [directory]
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arc/walk.h>
+
+#define RUNS 5
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void touch(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (f) fclose(f);
+}
+
+/* 100 source directories of 4 x 25 files, plus ignored build trees */
+static void generate(const char *root) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/.git", root);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/.gitignore", root);
+    FILE *f = fopen(path, "w");
+    if (f) {
+        fputs("build/\nnode_modules/\n*.o\n", f);
+        fclose(f);
+    }
+
+    static const char *tops[] = { "src", "build", "node_modules" };
+    for (int t = 0; t < 3; t++) {
+        snprintf(path, sizeof(path), "%s/%s", root, tops[t]);
+        mkdir(path, 0755);
+        for (int d = 0; d < 100; d++) {
+            snprintf(path, sizeof(path), "%s/%s/mod%03d", root, tops[t], d);
+            mkdir(path, 0755);
+            for (int s = 0; s < 4; s++) {
+                snprintf(path, sizeof(path), "%s/%s/mod%03d/sub%d", root, tops[t], d, s);
+                mkdir(path, 0755);
+                for (int i = 0; i < 25; i++) {
+                    snprintf(path, sizeof(path), "%s/%s/mod%03d/sub%d/file%02d.%s",
+                             root, tops[t], d, s, i, i % 5 == 0 ? "o" : "c");
+                    touch(path);
+                }
+            }
+        }
+    }
+}
+
+/* The previous grep/glob tool traversal */
+static void old_walk(const char *dir_path, size_t *count, int depth) {
+    if (depth > 20) return;
+    DIR *dir = opendir(dir_path);
+    if (!dir) return;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        if (entry->d_name[0] == '.') continue;
+        if (strcmp(entry->d_name, "node_modules") == 0 ||
+            strcmp(entry->d_name, "__pycache__") == 0) {
+            continue;
+        }
+        char full_path[4096];
+        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
+        struct stat st;
+        if (stat(full_path, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            old_walk(full_path, count, depth + 1);
+        } else if (S_ISREG(st.st_mode)) {
+            (*count)++;
+        }
+    }
+    closedir(dir);
+}
+
+static int count_file(const ac_walk_entry_t *entry, void *user_data) {
+    if (entry->type == AC_WALK_FILE) (*(size_t *)user_data)++;
+    return AC_WALK_CONTINUE;
+}
+
+static double time_walk(const char *root, int threads, size_t *count) {
+    double best = 1e9;
+    for (int r = 0; r < RUNS; r++) {
+        *count = 0;
+        double t0 = now_sec();
+        if (threads < 0) {
+            old_walk(root, count, 0);
+        } else {
+            ac_walk_options_t opts = { .threads = threads };
+            ac_walk(root, &opts, count_file, count);
+        }
+        double t = now_sec() - t0;
+        if (t < best) best = t;
+    }
+    return best * 1000.0;
+}
+
+int main(int argc, char **argv) {
+    char root[256];
+    int generated = argc < 2;
+    if (generated) {
+        snprintf(root, sizeof(root), "/tmp/arc_walk_bench_XXXXXX");
+        if (!mkdtemp(root)) return 1;
+        generate(root);
+    } else {
+        snprintf(root, sizeof(root), "%s", argv[1]);
+    }
+
+    size_t n_old, n_one, n_all;
+    double t_old = time_walk(root, -1, &n_old);
+    double t_one = time_walk(root, 1, &n_one);
+    double t_all = time_walk(root, 0, &n_all);
+
+    printf("%-28s %8s %10s %8s\n", "walker", "files", "ms", "speedup");
+    printf("%-28s %8zu %10.1f %8s\n", "readdir + stat (old)", n_old, t_old, "-");
+    printf("%-28s %8zu %10.1f %7.1fx\n", "ac_walk, 1 thread", n_one, t_one, t_old / t_one);
+    printf("%-28s %8zu %10.1f %7.1fx\n", "ac_walk, default threads", n_all, t_all, t_old / t_all);
+
+    if (generated) {
+        char cmd[300];
+        snprintf(cmd, sizeof(cmd), "rm -rf '%s'", root);
+        if (system(cmd) != 0) fprintf(stderr, "could not remove %s\n", root);
+    }
+    return 0;
+}
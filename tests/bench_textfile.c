@@ -0,0 +1,147 @@
+/**
+ * @file bench_textfile.c
+ * @brief Paging through a large file: fgets from the start vs. line index
+ *
+ * Writes a 200k-line log (or uses a given file) and reads it front to
+ * back in pages of 2000 lines, as the read tool does with offset/limit:
+ *   - the previous loop: fgets() from the beginning on every call,
+ *   - ac_textfile through a cache: the first call maps the file and
+ *     builds the line index, later calls seek to their first line.
+ * Also reports newline counting throughput against a scalar loop.
+ * Times are the best of several runs (warm page cache).
+ *
+ * Usage: bench_textfile [file]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arc/textfile.h>
+
+#define RUNS 3
+#define PAGE 2000
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* One read-tool call the old way; returns bytes of the page */
+static size_t old_page(const char *path, int offset, int limit, int *total) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;
+    char line[4096];
+    int n = 0;
+    size_t bytes = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (n >= offset && n < offset + limit) bytes += strlen(line);
+        n++;
+    }
+    fclose(fp);
+    *total = n;
+    return bytes;
+}
+
+static size_t new_page(ac_textfile_cache_t *cache, const char *path, int offset, int limit, int *total) {
+    ac_textfile_t *f = NULL;
+    if (ac_textfile_open(cache, path, &f) != ARC_OK) return 0;
+    size_t count = ac_textfile_line_count(f);
+    size_t bytes = 0;
+    for (size_t i = (size_t)offset; i < count && i < (size_t)(offset + limit); i++) {
+        size_t len;
+        ac_textfile_line(f, i, &len);
+        bytes += len + 1;
+    }
+    *total = (int)count;
+    ac_textfile_release(f);
+    return bytes;
+}
+
+static size_t scalar_count(const char *data, size_t len) {
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) n += data[i] == '\n';
+    return n;
+}
+
+int main(int argc, char **argv) {
+    char path[256];
+    int generated = argc < 2;
+    if (generated) {
+        snprintf(path, sizeof(path), "/tmp/arc_textfile_bench_%d.log", (int)getpid());
+        FILE *f = fopen(path, "w");
+        if (!f) return 1;
+        for (int i = 0; i < 200000; i++) {
+            fprintf(f, "2024-05-01T12:%02d:%02d.%03d INFO worker-%d request %d handled in %d ms\n",
+                    (i / 60000) % 60, (i / 1000) % 60, i % 1000, i % 8, i, (i * 7) % 250);
+        }
+        fclose(f);
+    } else {
+        snprintf(path, sizeof(path), "%s", argv[1]);
+    }
+
+    int total = 0;
+    double best_old = 1e9, best_new = 1e9, best_first = 1e9;
+    size_t bytes_old = 0, bytes_new = 0;
+    int pages = 0;
+    for (int r = 0; r < RUNS; r++) {
+        double t0 = now_sec();
+        bytes_old = 0;
+        int offset = 0;
+        pages = 0;
+        do {
+            bytes_old += old_page(path, offset, PAGE, &total);
+            offset += PAGE;
+            pages++;
+        } while (offset < total);
+        double t = now_sec() - t0;
+        if (t < best_old) best_old = t;
+
+        ac_textfile_cache_t *cache = ac_textfile_cache_create(NULL);
+        t0 = now_sec();
+        bytes_new = new_page(cache, path, 0, PAGE, &total);
+        double first = now_sec() - t0;
+        for (offset = PAGE; offset < total; offset += PAGE) {
+            bytes_new += new_page(cache, path, offset, PAGE, &total);
+        }
+        t = now_sec() - t0;
+        ac_textfile_cache_destroy(cache);
+        if (t < best_new) best_new = t;
+        if (first < best_first) best_first = first;
+    }
+
+    printf("%d lines, %d pages of %d\n", total, pages, PAGE);
+    printf("%-30s %10s %10s\n", "", "ms", "speedup");
+    printf("%-30s %10.1f %10s\n", "fgets from start (old)", best_old * 1000.0, "-");
+    printf("%-30s %10.1f %9.1fx\n", "line index, all pages", best_new * 1000.0, best_old / best_new);
+    printf("%-30s %10.2f\n", "  first page (map + index)", best_first * 1000.0);
+    if (bytes_old != bytes_new) printf("(MISMATCH: %zu vs %zu bytes)\n", bytes_old, bytes_new);
+
+    /* Counting throughput on the mapped data */
+    ac_textfile_t *f = NULL;
+    if (ac_textfile_open(NULL, path, &f) == ARC_OK) {
+        const char *data = ac_textfile_data(f);
+        size_t size = ac_textfile_size(f);
+        double best_scalar = 1e9, best_vector = 1e9;
+        size_t a = 0, b = 0;
+        for (int r = 0; r < RUNS * 3; r++) {
+            double t0 = now_sec();
+            a = scalar_count(data, size);
+            double t1 = now_sec();
+            b = ac_textfile_count_newlines(data, size);
+            double t2 = now_sec();
+            if (t1 - t0 < best_scalar) best_scalar = t1 - t0;
+            if (t2 - t1 < best_vector) best_vector = t2 - t1;
+        }
+        printf("\nnewline count over %.1f MiB: scalar %.2f GB/s, vector %.2f GB/s%s\n",
+               size / 1048576.0, size / best_scalar / 1e9, size / best_vector / 1e9,
+               a == b ? "" : " (MISMATCH)");
+        ac_textfile_release(f);
+    }
+
+    if (generated) unlink(path);
+    return 0;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file index_fixture.h
+ * @brief Scratch tree shared by the persistent index tests
+ *
+ * A temporary directory holding the tree to index (g_root) and the
+ * index cache (g_cache). HOME points at it, so the user's global
+ * excludes stay out of the file set.
+ */
+
+#ifndef ARC_TESTS_INDEX_FIXTURE_H
+#define ARC_TESTS_INDEX_FIXTURE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+static char g_tmp[256];
+static char g_root[300];
+static char g_cache[300];
+
+static const char *at(const char *rel) {
+    static char path[512];
+    snprintf(path, sizeof(path), "%s/%s", g_root, rel);
+    return path;
+}
+
+/* Write a file and give it an explicit mtime so edits are always visible */
+static void write_file(const char *rel, const char *content, long mtime) {
+    FILE *f = fopen(at(rel), "w");
+    if (f) {
+        fputs(content, f);
+        fclose(f);
+    }
+    struct timeval tv[2] = { { mtime, 0 }, { mtime, 0 } };
+    utimes(at(rel), tv);
+}
+
+/* Create the scratch tree under /tmp/arc_<name>_XXXXXX; 0 on success */
+static int fixture_create(const char *name) {
+    snprintf(g_tmp, sizeof(g_tmp), "/tmp/arc_%s_XXXXXX", name);
+    if (!mkdtemp(g_tmp)) {
+        printf("Failed to create temp dir\n");
+        return -1;
+    }
+    snprintf(g_root, sizeof(g_root), "%s/ws", g_tmp);
+    snprintf(g_cache, sizeof(g_cache), "%s/cache/arc", g_tmp);
+    mkdir(g_root, 0755);
+    setenv("HOME", g_tmp, 1);
+    unsetenv("XDG_CONFIG_HOME");
+    return 0;
+}
+
+static void fixture_remove(void) {
+    char cmd[600];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", g_tmp);
+    if (system(cmd) != 0) {
+        printf("warning: could not remove %s\n", g_tmp);
+    }
+}
+
+#endif /* ARC_TESTS_INDEX_FIXTURE_H */
@@ -0,0 +1,432 @@
+/**
+ * @file mock_lsp_server.c
+ * @brief Minimal language server for test_lsp
+ *
+ * Speaks just enough LSP over stdin/stdout: keeps the open documents
+ * (applying incremental changes), publishes a warning for every "FIXME",
+ * and answers definition (first occurrence of the word at the position),
+ * references (every occurrence) and hover (the word and its whole line).
+ * Positions are UTF-16 unless started with --utf8; --full asks for whole
+ * documents on change.
+ *
+ * Special words under the cursor: "slow" answers after 300 ms (other
+ * requests are answered meanwhile), "hang" never answers, "boom" answers
+ * with an error and "crash" exits.
+ */
+
+#include <cJSON.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_DOCS     64
+#define MAX_DEFERRED 64
+
+typedef struct {
+    char *uri;
+    char *text;
+} doc_t;
+
+typedef struct {
+    cJSON *response;
+    long long due_ms;
+} deferred_t;
+
+static doc_t g_docs[MAX_DOCS];
+static deferred_t g_deferred[MAX_DEFERRED];
+static int g_utf8 = 0;
+static int g_full = 0;
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*============================================================================
+ * Transport
+ *============================================================================*/
+
+static char *g_in;
+static size_t g_in_len, g_in_cap;
+
+static void send_json(cJSON *message) {
+    char *body = cJSON_PrintUnformatted(message);
+    printf("Content-Length: %zu\r\n\r\n%s", strlen(body), body);
+    fflush(stdout);
+    free(body);
+}
+
+/* Next complete message in the input buffer, or NULL */
+static cJSON *take_message(void) {
+    char *end = NULL;
+    for (size_t i = 0; i + 3 < g_in_len; i++) {
+        if (memcmp(g_in + i, "\r\n\r\n", 4) == 0) {
+            end = g_in + i;
+            break;
+        }
+    }
+    if (!end) return NULL;
+
+    size_t header = (size_t)(end - g_in) + 4;
+    const char *cl = strstr(g_in, "Content-Length:");
+    if (!cl || cl > end) exit(2);
+    size_t length = strtoul(cl + 15, NULL, 10);
+    if (g_in_len < header + length) return NULL;
+
+    cJSON *message = cJSON_ParseWithLength(g_in + header, length);
+    g_in_len -= header + length;
+    memmove(g_in, g_in + header + length, g_in_len);
+    return message;
+}
+
+/* Read more input, waiting at most timeout_ms; exits on EOF */
+static void read_input(int timeout_ms) {
+    struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+    if (poll(&pfd, 1, timeout_ms) <= 0) return;
+
+    if (g_in_cap - g_in_len < 65536) {
+        g_in_cap = g_in_cap ? g_in_cap * 2 : 131072;
+        g_in = realloc(g_in, g_in_cap);
+    }
+    ssize_t n = read(STDIN_FILENO, g_in + g_in_len, g_in_cap - g_in_len - 1);
+    if (n == 0 || (n < 0 && errno != EINTR)) exit(0);
+    if (n > 0) {
+        g_in_len += (size_t)n;
+        g_in[g_in_len] = '\0';
+    }
+}
+
+static cJSON *response_for(const cJSON *request) {
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "jsonrpc", "2.0");
+    cJSON_AddItemToObject(response, "id", cJSON_Duplicate(cJSON_GetObjectItem(request, "id"), 1));
+    return response;
+}
+
+static void reply(const cJSON *request, cJSON *result) {
+    cJSON *response = response_for(request);
+    cJSON_AddItemToObject(response, "result", result ? result : cJSON_CreateNull());
+    send_json(response);
+    cJSON_Delete(response);
+}
+
+static void reply_error(const cJSON *request, int code, const char *message) {
+    cJSON *response = response_for(request);
+    cJSON *error = cJSON_AddObjectToObject(response, "error");
+    cJSON_AddNumberToObject(error, "code", code);
+    cJSON_AddStringToObject(error, "message", message);
+    send_json(response);
+    cJSON_Delete(response);
+}
+
+/*============================================================================
+ * Documents
+ *============================================================================*/
+
+static doc_t *find_doc(const char *uri) {
+    for (int i = 0; i < MAX_DOCS; i++) {
+        if (g_docs[i].uri && strcmp(g_docs[i].uri, uri) == 0) return &g_docs[i];
+    }
+    return NULL;
+}
+
+/* Byte offset of a protocol position */
+static size_t offset_of(const char *text, int line, int character) {
+    size_t off = 0;
+    for (int l = 0; l < line && text[off]; off++) {
+        if (text[off] == '\n') l++;
+    }
+    for (int units = 0; units < character && text[off] && text[off] != '\n'; ) {
+        unsigned char c = (unsigned char)text[off];
+        units += g_utf8 ? 1 : (c >= 0xF0 ? 2 : 1);
+        off++;
+        while (!g_utf8 && ((unsigned char)text[off] & 0xC0) == 0x80) off++;
+    }
+    return off;
+}
+
+/* Protocol position of a byte offset */
+static cJSON *position_of(const char *text, size_t off) {
+    int line = 0;
+    size_t start = 0;
+    for (size_t i = 0; i < off; i++) {
+        if (text[i] == '\n') {
+            line++;
+            start = i + 1;
+        }
+    }
+    int character = 0;
+    for (size_t i = start; i < off; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (g_utf8) character++;
+        else if ((c & 0xC0) != 0x80) character += c >= 0xF0 ? 2 : 1;
+    }
+    cJSON *pos = cJSON_CreateObject();
+    cJSON_AddNumberToObject(pos, "line", line);
+    cJSON_AddNumberToObject(pos, "character", character);
+    return pos;
+}
+
+static cJSON *range_of(const char *text, size_t start, size_t end) {
+    cJSON *range = cJSON_CreateObject();
+    cJSON_AddItemToObject(range, "start", position_of(text, start));
+    cJSON_AddItemToObject(range, "end", position_of(text, end));
+    return range;
+}
+
+static void publish(const doc_t *doc, int version) {
+    cJSON *message = cJSON_CreateObject();
+    cJSON_AddStringToObject(message, "jsonrpc", "2.0");
+    cJSON_AddStringToObject(message, "method", "textDocument/publishDiagnostics");
+    cJSON *params = cJSON_AddObjectToObject(message, "params");
+    cJSON_AddStringToObject(params, "uri", doc->uri);
+    cJSON_AddNumberToObject(params, "version", version);
+    cJSON *list = cJSON_AddArrayToObject(params, "diagnostics");
+    for (const char *p = doc->text; (p = strstr(p, "FIXME")) != NULL; p += 5) {
+        size_t off = (size_t)(p - doc->text);
+        cJSON *d = cJSON_CreateObject();
+        cJSON_AddItemToObject(d, "range", range_of(doc->text, off, off + 5));
+        cJSON_AddNumberToObject(d, "severity", 2);
+        cJSON_AddNumberToObject(d, "code", 7);
+        cJSON_AddStringToObject(d, "source", "mock");
+        cJSON_AddStringToObject(d, "message", "FIXME left in code");
+        cJSON_AddItemToArray(list, d);
+    }
+    send_json(message);
+    cJSON_Delete(message);
+}
+
+static void did_open(const cJSON *params) {
+    const cJSON *td = cJSON_GetObjectItem(params, "textDocument");
+    for (int i = 0; i < MAX_DOCS; i++) {
+        if (!g_docs[i].uri) {
+            g_docs[i].uri = strdup(cJSON_GetStringValue(cJSON_GetObjectItem(td, "uri")));
+            g_docs[i].text = strdup(cJSON_GetStringValue(cJSON_GetObjectItem(td, "text")));
+            publish(&g_docs[i], cJSON_GetObjectItem(td, "version")->valueint);
+            return;
+        }
+    }
+}
+
+static void did_change(const cJSON *params) {
+    const cJSON *td = cJSON_GetObjectItem(params, "textDocument");
+    doc_t *doc = find_doc(cJSON_GetStringValue(cJSON_GetObjectItem(td, "uri")));
+    if (!doc) exit(4);
+
+    const cJSON *change;
+    cJSON_ArrayForEach(change, cJSON_GetObjectItem(params, "contentChanges")) {
+        const char *text = cJSON_GetStringValue(cJSON_GetObjectItem(change, "text"));
+        const cJSON *range = cJSON_GetObjectItem(change, "range");
+        if (!range) {
+            free(doc->text);
+            doc->text = strdup(text);
+            continue;
+        }
+        const cJSON *s = cJSON_GetObjectItem(range, "start");
+        const cJSON *e = cJSON_GetObjectItem(range, "end");
+        size_t start = offset_of(doc->text, cJSON_GetObjectItem(s, "line")->valueint,
+                                 cJSON_GetObjectItem(s, "character")->valueint);
+        size_t end = offset_of(doc->text, cJSON_GetObjectItem(e, "line")->valueint,
+                               cJSON_GetObjectItem(e, "character")->valueint);
+        size_t old_len = strlen(doc->text), ins = strlen(text);
+        char *updated = malloc(old_len - (end - start) + ins + 1);
+        memcpy(updated, doc->text, start);
+        memcpy(updated + start, text, ins);
+        strcpy(updated + start + ins, doc->text + end);
+        free(doc->text);
+        doc->text = updated;
+    }
+    publish(doc, cJSON_GetObjectItem(td, "version")->valueint);
+}
+
+static void did_close(const cJSON *params) {
+    const cJSON *td = cJSON_GetObjectItem(params, "textDocument");
+    doc_t *doc = find_doc(cJSON_GetStringValue(cJSON_GetObjectItem(td, "uri")));
+    if (doc) {
+        free(doc->uri);
+        free(doc->text);
+        doc->uri = NULL;
+        doc->text = NULL;
+    }
+}
+
+/*============================================================================
+ * Requests
+ *============================================================================*/
+
+static int is_word(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+/* Word at the request's position: bounds in the document's text */
+static doc_t *word_at(const cJSON *params, size_t *start, size_t *end) {
+    const cJSON *td = cJSON_GetObjectItem(params, "textDocument");
+    const cJSON *pos = cJSON_GetObjectItem(params, "position");
+    doc_t *doc = find_doc(cJSON_GetStringValue(cJSON_GetObjectItem(td, "uri")));
+    if (!doc) return NULL;
+
+    size_t off = offset_of(doc->text, cJSON_GetObjectItem(pos, "line")->valueint,
+                           cJSON_GetObjectItem(pos, "character")->valueint);
+    *start = *end = off;
+    while (*start > 0 && is_word(doc->text[*start - 1])) (*start)--;
+    while (is_word(doc->text[*end])) (*end)++;
+    return doc;
+}
+
+static int word_is(const doc_t *doc, size_t start, size_t end, const char *word) {
+    return end - start == strlen(word) && strncmp(doc->text + start, word, end - start) == 0;
+}
+
+/* Every whole-word occurrence, as Locations */
+static cJSON *occurrences(const doc_t *doc, size_t start, size_t end, int first_only) {
+    cJSON *list = cJSON_CreateArray();
+    size_t n = end - start;
+    for (size_t i = 0; doc->text[i]; i++) {
+        if (strncmp(doc->text + i, doc->text + start, n) != 0) continue;
+        if ((i > 0 && is_word(doc->text[i - 1])) || is_word(doc->text[i + n])) continue;
+        cJSON *loc = cJSON_CreateObject();
+        cJSON_AddStringToObject(loc, "uri", doc->uri);
+        cJSON_AddItemToObject(loc, "range", range_of(doc->text, i, i + n));
+        cJSON_AddItemToArray(list, loc);
+        if (first_only) break;
+    }
+    return list;
+}
+
+static void defer(cJSON *response, int delay_ms) {
+    for (int i = 0; i < MAX_DEFERRED; i++) {
+        if (!g_deferred[i].response) {
+            g_deferred[i].response = response;
+            g_deferred[i].due_ms = now_ms() + delay_ms;
+            return;
+        }
+    }
+}
+
+static void position_request(const cJSON *request, const char *method, const cJSON *params) {
+    size_t start, end;
+    doc_t *doc = word_at(params, &start, &end);
+    if (!doc) {
+        reply_error(request, -32602, "document not open");
+        return;
+    }
+    if (start == end) {
+        reply(request, NULL);
+        return;
+    }
+    if (word_is(doc, start, end, "crash")) exit(3);
+    if (word_is(doc, start, end, "hang")) return;
+    if (word_is(doc, start, end, "boom")) {
+        reply_error(request, -32603, "boom failed");
+        return;
+    }
+
+    cJSON *result;
+    if (strcmp(method, "textDocument/definition") == 0) {
+        result = occurrences(doc, start, end, 1);
+    } else if (strcmp(method, "textDocument/references") == 0) {
+        result = occurrences(doc, start, end, 0);
+    } else {
+        size_t ls = start, le = end;
+        while (ls > 0 && doc->text[ls - 1] != '\n') ls--;
+        while (doc->text[le] && doc->text[le] != '\n') le++;
+        char *value = malloc((end - start) + (le - ls) + 16);
+        sprintf(value, "`%.*s` %.*s", (int)(end - start), doc->text + start, (int)(le - ls), doc->text + ls);
+        result = cJSON_CreateObject();
+        cJSON *contents = cJSON_AddObjectToObject(result, "contents");
+        cJSON_AddStringToObject(contents, "kind", "markdown");
+        cJSON_AddStringToObject(contents, "value", value);
+        free(value);
+    }
+
+    if (word_is(doc, start, end, "slow")) {
+        cJSON *response = response_for(request);
+        cJSON_AddItemToObject(response, "result", result);
+        defer(response, 300);
+        return;
+    }
+    reply(request, result);
+}
+
+static void initialize(const cJSON *request) {
+    cJSON *result = cJSON_CreateObject();
+    cJSON *caps = cJSON_AddObjectToObject(result, "capabilities");
+    cJSON *sync = cJSON_AddObjectToObject(caps, "textDocumentSync");
+    cJSON_AddBoolToObject(sync, "openClose", 1);
+    cJSON_AddNumberToObject(sync, "change", g_full ? 1 : 2);
+    cJSON_AddBoolToObject(caps, "definitionProvider", 1);
+    cJSON_AddItemToObject(caps, "referencesProvider", cJSON_CreateObject());
+    cJSON_AddBoolToObject(caps, "hoverProvider", 1);
+    cJSON_AddStringToObject(caps, "positionEncoding", g_utf8 ? "utf-8" : "utf-16");
+    reply(request, result);
+
+    /* A request of our own, as real servers make */
+    cJSON *message = cJSON_CreateObject();
+    cJSON_AddStringToObject(message, "jsonrpc", "2.0");
+    cJSON_AddStringToObject(message, "id", "config-1");
+    cJSON_AddStringToObject(message, "method", "workspace/configuration");
+    cJSON *items = cJSON_AddArrayToObject(cJSON_AddObjectToObject(message, "params"), "items");
+    cJSON_AddItemToArray(items, cJSON_CreateObject());
+    send_json(message);
+    cJSON_Delete(message);
+}
+
+static void handle(const cJSON *message) {
+    const char *method = cJSON_GetStringValue(cJSON_GetObjectItem(message, "method"));
+    const cJSON *params = cJSON_GetObjectItem(message, "params");
+    if (!method) return;                /* Our configuration request's answer */
+
+    if (strcmp(method, "initialize") == 0) {
+        initialize(message);
+    } else if (strcmp(method, "shutdown") == 0) {
+        reply(message, NULL);
+    } else if (strcmp(method, "exit") == 0) {
+        exit(0);
+    } else if (strcmp(method, "textDocument/didOpen") == 0) {
+        did_open(params);
+    } else if (strcmp(method, "textDocument/didChange") == 0) {
+        did_change(params);
+    } else if (strcmp(method, "textDocument/didClose") == 0) {
+        did_close(params);
+    } else if (strcmp(method, "textDocument/definition") == 0 ||
+               strcmp(method, "textDocument/references") == 0 ||
+               strcmp(method, "textDocument/hover") == 0) {
+        position_request(message, method, params);
+    } else if (cJSON_GetObjectItem(message, "id")) {
+        reply_error(message, -32601, "method not found");
+    }
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--utf8") == 0) g_utf8 = 1;
+        if (strcmp(argv[i], "--full") == 0) g_full = 1;
+    }
+
+    for (;;) {
+        cJSON *message;
+        while ((message = take_message()) != NULL) {
+            handle(message);
+            cJSON_Delete(message);
+        }
+
+        int timeout = -1;
+        long long now = now_ms();
+        for (int i = 0; i < MAX_DEFERRED; i++) {
+            if (!g_deferred[i].response) continue;
+            if (g_deferred[i].due_ms <= now) {
+                send_json(g_deferred[i].response);
+                cJSON_Delete(g_deferred[i].response);
+                g_deferred[i].response = NULL;
+            } else if (timeout < 0 || g_deferred[i].due_ms - now < timeout) {
+                timeout = (int)(g_deferred[i].due_ms - now);
+            }
+        }
+        read_input(timeout);
+    }
+}
@@ -0,0 +1,226 @@
+/**
+ * @file test_chat_view.c
+ * @brief Tests for the retained message layout of the chat TUI
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chat_view.h"
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+/* Words, runs of spaces, newlines, a word longer than any width, CJK and accents */
+static const char g_text[] =
+    "The quick brown fox jumps over the lazy dog.\n"
+    "\n"
+    "Streaming  text   with extra spaces and a "
+    "supercalifragilisticexpialidociousword that never fits.\n"
+    "\xE4\xBD\xA0\xE5\xA5\xBD\xE4\xB8\x96\xE7\x95\x8C mixed with caf\xC3\xA9 and "
+    "na\xC3\xAF" "ve text, \xE4\xB8\xAD\xE6\x96\x87\xE5\xAD\x97\xE7\xAC\xA6\xE4\xB8\xB2 end ";
+
+/* Same lines, widths and height; describes the first difference */
+static int same_layout(const chat_message_t *a, const chat_message_t *b, char *why, size_t size) {
+    if (a->line_count != b->line_count) {
+        snprintf(why, size, "%d lines, expected %d", a->line_count, b->line_count);
+        return 0;
+    }
+    for (int i = 0; i < a->line_count; i++) {
+        const chat_line_t *x = &a->lines[i];
+        const chat_line_t *y = &b->lines[i];
+        if (x->offset != y->offset || x->len != y->len || x->width != y->width) {
+            snprintf(why, size, "line %d is %d+%d (%d cells), expected %d+%d (%d cells)",
+                     i, x->offset, x->len, x->width, y->offset, y->len, y->width);
+            return 0;
+        }
+    }
+    if (a->max_width != b->max_width) {
+        snprintf(why, size, "max width %d, expected %d", a->max_width, b->max_width);
+        return 0;
+    }
+    return 1;
+}
+
+/*============================================================================
+ * Wrapping
+ *============================================================================*/
+
+static void test_wrap(void) {
+    chat_view_t view;
+    chat_view_init(&view, 0);
+    chat_view_set_width(&view, 10);
+
+    TEST("words wrap at spaces, long words break");
+    chat_message_t *msg = chat_view_add(&view, MSG_USER, "hello big world\nsupercalifragilistic");
+    static const char *expected[] = { "hello big ", "world", "supercalif", "ragilistic" };
+    int ok = msg->line_count == 4;
+    for (int i = 0; ok && i < 4; i++) {
+        ok = msg->lines[i].len == (int)strlen(expected[i]) &&
+             memcmp(msg->content + msg->lines[i].offset, expected[i], strlen(expected[i])) == 0;
+    }
+    ok = ok && msg->max_width == 10 && view.total_height == 4 + CHAT_VIEW_CHROME_ROWS;
+    if (ok) PASS(); else FAIL("unexpected lines");
+
+    TEST("CJK characters take two cells");
+    chat_view_set_text(&view, msg, "\xE4\xBD\xA0\xE5\xA5\xBD\xE4\xB8\x96\xE7\x95\x8C\xE4\xBD\xA0\xE5\xA5\xBD");
+    if (msg->line_count == 2 && msg->lines[0].width == 10 && msg->lines[1].width == 2) {
+        PASS();
+    } else {
+        FAIL("wrong widths");
+    }
+    chat_view_free(&view);
+}
+
+static void test_append_matches_set_text(void) {
+    TEST("char-by-char appends wrap like set_text for widths 1-29");
+    char why[160] = "";
+    int ok = 1;
+    for (int width = 1; ok && width < 30; width++) {
+        chat_view_t streamed, whole;
+        chat_view_init(&streamed, 0);
+        chat_view_init(&whole, 0);
+        chat_view_set_width(&streamed, width);
+        chat_view_set_width(&whole, width);
+        chat_message_t *a = chat_view_add(&streamed, MSG_ASSISTANT, "");
+        chat_message_t *b = chat_view_add(&whole, MSG_ASSISTANT, "");
+
+        /* One byte at a time, so multi-byte characters arrive split */
+        for (size_t i = 0; ok && i < sizeof(g_text) - 1; i++) {
+            chat_view_append(&streamed, a, &g_text[i], 1);
+            if (g_text[i] & 0x80 && (g_text[i + 1] & 0xC0) == 0x80) continue;
+
+            char prefix[sizeof(g_text)];
+            memcpy(prefix, g_text, i + 1);
+            prefix[i + 1] = '\0';
+            chat_view_set_text(&whole, b, prefix);
+            if (!same_layout(a, b, why, sizeof(why)) || streamed.total_height != whole.total_height) {
+                char at[sizeof(why)];
+                snprintf(at, sizeof(at), "width %d after %zu bytes: %s", width, i + 1,
+                         why[0] ? why : "total height differs");
+                memcpy(why, at, sizeof(why));
+                ok = 0;
+            }
+        }
+        chat_view_free(&streamed);
+        chat_view_free(&whole);
+    }
+    if (ok) PASS(); else FAIL(why);
+}
+
+static void test_set_width(void) {
+    chat_view_t view;
+    chat_view_init(&view, 0);
+    chat_view_set_width(&view, 29);
+    chat_message_t *msg = chat_view_add(&view, MSG_ASSISTANT, g_text);
+
+    TEST("a new width re-wraps every message");
+    chat_view_t fresh;
+    chat_view_init(&fresh, 0);
+    chat_view_set_width(&fresh, 7);
+    chat_message_t *expected = chat_view_add(&fresh, MSG_ASSISTANT, g_text);
+    chat_view_frame_done(&view, 0);
+    chat_view_set_width(&view, 7);
+    char why[160];
+    if (same_layout(msg, expected, why, sizeof(why)) && view.total_height == fresh.total_height &&
+        view.full_redraw && msg->dirty_line == 0) {
+        PASS();
+    } else {
+        FAIL(why);
+    }
+    chat_view_free(&fresh);
+    chat_view_free(&view);
+}
+
+/*============================================================================
+ * Damage and Frames
+ *============================================================================*/
+
+static void test_damage(void) {
+    chat_view_t view;
+    chat_view_init(&view, 0);
+    chat_view_set_width(&view, 10);
+    chat_view_add(&view, MSG_USER, "question");
+    chat_message_t *msg = chat_view_add(&view, MSG_ASSISTANT, "one two three four");
+    chat_view_frame_done(&view, 0);
+
+    TEST("appending dirties only from the last line");
+    int before = msg->line_count;
+    chat_view_append(&view, msg, " five", 5);
+    int ok = !view.full_redraw && view.pending && msg->dirty_line == before - 1 &&
+             view.messages[0].dirty_line == -1 && msg->prev_height == before + CHAT_VIEW_CHROME_ROWS;
+    if (ok) PASS(); else FAIL("wrong damage");
+
+    TEST("the oldest message is dropped when full");
+    for (int i = 0; i < CHAT_VIEW_MAX_MESSAGES; i++) {
+        chat_view_add(&view, MSG_USER, "x");
+    }
+    int height = 0;
+    for (int i = 0; i < view.message_count; i++) height += chat_message_height(&view.messages[i]);
+    if (view.message_count == CHAT_VIEW_MAX_MESSAGES && view.total_height == height &&
+        strcmp(view.messages[0].content, "x") == 0 && view.full_redraw) {
+        PASS();
+    } else {
+        FAIL("wrong messages or height");
+    }
+    chat_view_free(&view);
+}
+
+static void test_frame_limit(void) {
+    chat_view_t view;
+    chat_view_init(&view, 10);
+    chat_view_set_width(&view, 20);
+
+    TEST("frames are limited to the configured rate");
+    chat_message_t *msg = chat_view_add(&view, MSG_ASSISTANT, "a");
+    int ok = chat_view_frame_due(&view, 1000);
+    chat_view_frame_done(&view, 1000);
+    ok = ok && !chat_view_frame_due(&view, 1200);                /* Nothing changed */
+    chat_view_append(&view, msg, "b", 1);
+    ok = ok && !chat_view_frame_due(&view, 1050);                /* Too soon */
+    chat_view_append(&view, msg, "c", 1);
+    ok = ok && chat_view_frame_due(&view, 1100) && msg->dirty_line == 0;
+    if (ok) PASS(); else FAIL("wrong frame decisions");
+    chat_view_free(&view);
+}
+
+/*============================================================================
+ * Main
+ *============================================================================*/
+
+int main(void) {
+    printf("=== Chat View Tests ===\n\n");
+
+    test_wrap();
+    test_append_matches_set_text();
+    test_set_width();
+    test_damage();
+    test_frame_limit();
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
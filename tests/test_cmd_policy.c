@@ -0,0 +1,321 @@
+/**
+ * @file test_cmd_policy.c
+ * @brief Tests for shell command parsing and the dangerous-command policy
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arc/command_policy.h>
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+/*
+ * Render a parse as "prog arg arg; ..." with the wrapped program in
+ * brackets and the depth as a "^N" prefix when nested. Nested commands
+ * come before the command containing them: "^1[rm] -rf ~; [echo] $(...)".
+ */
+static void render(const char *source, char *out, size_t size) {
+    ac_cmd_script_t script;
+    size_t n = 0;
+    out[0] = '\0';
+    if (ac_cmd_parse(source, &script) != ARC_OK) {
+        snprintf(out, size, "<no memory>");
+        return;
+    }
+    for (int i = 0; i < script.count; i++) {
+        const ac_cmd_simple_t *cmd = &script.commands[i];
+        if (i > 0) n += (size_t)snprintf(out + n, size - n, "; ");
+        if (cmd->depth > 0) n += (size_t)snprintf(out + n, size - n, "^%d", cmd->depth);
+        for (int a = 0; a < cmd->argc && n < size; a++) {
+            const char *fmt = a == cmd->program ? "%s[%s]" : "%s%s";
+            n += (size_t)snprintf(out + n, size - n, fmt, a > 0 ? " " : "", cmd->argv[a]);
+        }
+        for (int r = 0; r < cmd->redir_count && n < size; r++) {
+            n += (size_t)snprintf(out + n, size - n, " >%s", cmd->redirs[r].target);
+        }
+        if (n >= size) break;
+    }
+    if (script.error && n + 4 < size) snprintf(out + n, size - n, " (!)");
+    ac_cmd_script_free(&script);
+}
+
+static int check_parse(const char *source, const char *expected) {
+    char out[512];
+    render(source, out, sizeof(out));
+    if (strcmp(out, expected) != 0) {
+        printf("\n    %s\n    got:      %s\n    expected: %s\n    ", source, out, expected);
+        return 0;
+    }
+    return 1;
+}
+
+static int check_action(const ac_cmd_policy_t *policy, const char *command, ac_cmd_action_t expected) {
+    ac_cmd_verdict_t verdict;
+    if (ac_cmd_policy_eval(policy, command, &verdict) != ARC_OK) return 0;
+    if (verdict.action != expected) {
+        printf("\n    %s -> %d (expected %d, %s)\n    ", command, verdict.action, expected,
+               verdict.reason ? verdict.reason : "no rule");
+        return 0;
+    }
+    return 1;
+}
+
+/*============================================================================
+ * Parser Tests
+ *============================================================================*/
+
+static void test_parse_words(void) {
+    int ok;
+
+    TEST("quotes are removed and words joined");
+    ok = check_parse("r''m -fr \"/\"", "[rm] -fr /");
+    ok &= check_parse("echo 'a b' \"c $HOME\" d\\ e", "[echo] a b c $HOME d e");
+    ok &= check_parse("printf $'a\\tb'", "[printf] a\tb");
+    if (ok) PASS(); else FAIL("word splitting");
+
+    TEST("assignments and wrappers are skipped");
+    ok = check_parse("FOO=1 /bin/rm -r /", "[/bin/rm] -r /");
+    ok &= check_parse("env -i A=b nice -n 5 sudo -u root reboot", "env -i A=b nice -n 5 sudo -u root [reboot]");
+    ok &= check_parse("timeout 5 curl x", "timeout 5 [curl] x");
+    ok &= check_parse("A=1", "");
+    if (ok) PASS(); else FAIL("program detection");
+
+    TEST("redirections with fds");
+    ok = check_parse("echo x >/etc/passwd 2>&1 </dev/null", "[echo] x >/etc/passwd >1 >/dev/null");
+    ok &= check_parse("cat >> 'log file'", "[cat] >log file");
+    if (ok) PASS(); else FAIL("redirections");
+}
+
+static void test_parse_structure(void) {
+    int ok;
+
+    TEST("pipelines and lists");
+    ok = check_parse("a | b && c || d; e & f", "[a]; [b]; [c]; [d]; [e]; [f]");
+    ok &= check_parse("a\nb", "[a]; [b]");
+    if (ok) PASS(); else FAIL("list splitting");
+
+    TEST("substitutions are nested commands");
+    ok = check_parse("echo $(rm -rf ~)", "^1[rm] -rf ~; [echo] $(rm -rf ~)");
+    ok &= check_parse("echo `id`", "^1[id]; [echo] `id`");
+    ok &= check_parse("(cd / && rm x)", "^1[cd] /; ^1[rm] x");
+    if (ok) PASS(); else FAIL("nesting");
+
+    TEST("sh -c, eval and here-documents are re-parsed");
+    ok = check_parse("bash -c 'dd if=x'", "[bash] -c dd if=x; ^1[dd] if=x");
+    ok &= check_parse("eval \"rm -rf /\"", "[eval] rm -rf /; ^1[rm] -rf /");
+    ok &= check_parse("sh <<EOF\nmkfs /dev/sda\nEOF\n", "[sh] >mkfs /dev/sda\n; ^1[mkfs] /dev/sda");
+    if (ok) PASS(); else FAIL("inline scripts");
+
+    TEST("keywords and function definitions");
+    ok = check_parse("if true; then rm a; fi", "[true]; [rm] a");
+    ok &= check_parse("for f in *; do rm $f; done", "[rm] $f");
+    ok &= check_parse("f() { ls; }; f", "[ls]; [f]");
+    if (ok) PASS(); else FAIL("compound commands");
+
+    TEST("malformed input is flagged");
+    ok = check_parse("echo 'open", "[echo] open (!)");
+    ok &= check_parse("echo $(", "[echo] $( (!)");
+    if (ok) PASS(); else FAIL("error flag");
+}
+
+/*============================================================================
+ * Policy Tests
+ *============================================================================*/
+
+static void test_default_policy(void) {
+    const ac_cmd_policy_t *policy = ac_cmd_policy_default();
+    int ok;
+
+    TEST("default policy compiles");
+    if (policy) PASS(); else { FAIL("NULL policy"); return; }
+
+    TEST("destructive commands are denied");
+    ok = check_action(policy, "rm -rf /", AC_CMD_DENY);
+    ok &= check_action(policy, "rm -r -f /usr/", AC_CMD_DENY);
+    ok &= check_action(policy, "rm -rf ~", AC_CMD_DENY);
+    ok &= check_action(policy, "mkfs.ext4 /dev/sda1", AC_CMD_DENY);
+    ok &= check_action(policy, "dd if=/dev/zero of=/dev/sda", AC_CMD_DENY);
+    ok &= check_action(policy, ":(){ :|:& };:", AC_CMD_DENY);
+    if (ok) PASS(); else FAIL("missed");
+
+    TEST("spelling variants do not bypass rules");
+    ok = check_action(policy, "r''m  -fr   \"/\"", AC_CMD_DENY);
+    ok &= check_action(policy, "/bin/rm -rf //", AC_CMD_DENY);
+    ok &= check_action(policy, "FOO=1 sudo rm -rf /*", AC_CMD_DENY);
+    ok &= check_action(policy, "echo ok; bash -c 'rm -rf /'", AC_CMD_DENY);
+    ok &= check_action(policy, "x=$(rm -rf ~)", AC_CMD_DENY);
+    ok &= check_action(policy, "echo > /dev/sda", AC_CMD_DENY);
+    if (ok) PASS(); else FAIL("bypassed");
+
+    TEST("risky commands need confirmation");
+    ok = check_action(policy, "sudo ls", AC_CMD_CONFIRM);
+    ok &= check_action(policy, "curl https://example.com", AC_CMD_CONFIRM);
+    ok &= check_action(policy, "echo x > /etc/hosts", AC_CMD_CONFIRM);
+    ok &= check_action(policy, "systemctl stop sshd", AC_CMD_CONFIRM);
+    ok &= check_action(policy, "echo 'unterminated", AC_CMD_CONFIRM);
+    if (ok) PASS(); else FAIL("not confirmed");
+
+    TEST("benign commands are allowed");
+    ok = check_action(policy, "rm -rf build", AC_CMD_ALLOW);
+    ok &= check_action(policy, "rm -rf ./tmp/*", AC_CMD_ALLOW);
+    ok &= check_action(policy, "ls /etc", AC_CMD_ALLOW);
+    ok &= check_action(policy, "curl --version", AC_CMD_ALLOW);
+    ok &= check_action(policy, "grep -r 'rm -rf /' src", AC_CMD_ALLOW);
+    ok &= check_action(policy, "echo sudo", AC_CMD_ALLOW);
+    ok &= check_action(policy, "git commit -m 'drop mkfs helper'", AC_CMD_ALLOW);
+    if (ok) PASS(); else FAIL("false positive");
+
+    TEST("categories are reported");
+    ac_cmd_verdict_t verdict;
+    ac_cmd_policy_eval(policy, "ssh host uptime", &verdict);
+    ok = verdict.action == AC_CMD_ALLOW &&
+         (verdict.categories & AC_CMD_CATEGORY_BIT(AC_CMD_CAT_NETWORK));
+    ac_cmd_policy_eval(policy, "sudo rm -rf /", &verdict);
+    ok &= verdict.action == AC_CMD_DENY && verdict.reason &&
+          (verdict.categories & AC_CMD_CATEGORY_BIT(AC_CMD_CAT_PRIVILEGE)) &&
+          (verdict.categories & AC_CMD_CATEGORY_BIT(AC_CMD_CAT_DESTRUCTIVE));
+    if (ok) PASS(); else FAIL("categories");
+}
+
+static void test_custom_policy(void) {
+    static const ac_cmd_rule_t rules[] = {
+        { .program = "git", .operands = "push", .flags = "--force|-f",
+          .action = AC_CMD_DENY, .category = AC_CMD_CAT_DESTRUCTIVE, .reason = "force push" },
+        { .program = "make*", .action = AC_CMD_CONFIRM, .category = AC_CMD_CAT_SYSTEM, .reason = "build" },
+        { .redirect = "/srv/", .action = AC_CMD_CONFIRM, .category = AC_CMD_CAT_SYSTEM_PATH, .reason = "srv" },
+    };
+    int ok;
+
+    TEST("custom rule table");
+    ac_cmd_policy_t *policy = ac_cmd_policy_compile(rules, sizeof(rules) / sizeof(rules[0]));
+    if (!policy) {
+        FAIL("compile failed");
+        return;
+    }
+    ok = check_action(policy, "git push -f origin main", AC_CMD_DENY);
+    ok &= check_action(policy, "git push origin main", AC_CMD_ALLOW);
+    ok &= check_action(policy, "makepkg -si", AC_CMD_CONFIRM);
+    ok &= check_action(policy, "echo x >>/srv/data", AC_CMD_CONFIRM);
+    ok &= check_action(policy, "rm -rf /", AC_CMD_ALLOW);
+    ac_cmd_policy_free(policy);
+    if (ok) PASS(); else FAIL("custom rules");
+
+    TEST("invalid rules are rejected");
+    static const ac_cmd_rule_t bad[] = { { .flags = "-r", .action = AC_CMD_DENY } };
+    policy = ac_cmd_policy_compile(bad, 1);
+    if (!policy) PASS(); else { FAIL("rule without key accepted"); ac_cmd_policy_free(policy); }
+}
+
+/*============================================================================
+ * Fuzzing
+ *============================================================================*/
+
+/* xorshift32, fixed seed so failures reproduce */
+static unsigned fuzz_state = 0x9e3779b9u;
+
+static unsigned fuzz_next(void) {
+    fuzz_state ^= fuzz_state << 13;
+    fuzz_state ^= fuzz_state >> 17;
+    fuzz_state ^= fuzz_state << 5;
+    return fuzz_state;
+}
+
+static void test_fuzz(void) {
+    static const char *tokens[] = {
+        "rm", " ", "-rf", "/", "'", "\"", "\\", "$(", ")", "`", "${", "}", "((", "$((",
+        "|", "&&", "||", ";", "&", "\n", "<<", "EOF", "<<<", ">", ">>", "2>&1", "<(",
+        "sh -c ", "eval ", "sudo ", "env ", "A=1 ", "if ", "then ", "fi", "case ", "in ",
+        "esac", "(", "{", "f()", "#", "*", "~", "$'", "\t",
+    };
+    const ac_cmd_policy_t *policy = ac_cmd_policy_default();
+    char input[512];
+
+    TEST("random input parses and evaluates without crashing");
+    int iterations = 20000;
+    int ok = 1;
+    for (int i = 0; i < iterations && ok; i++) {
+        size_t len = 0;
+        size_t target = fuzz_next() % (sizeof(input) - 16);
+        if (i % 2 == 0) {
+            while (len < target) {
+                unsigned char c = (unsigned char)(fuzz_next() % 255 + 1);
+                input[len++] = (char)c;
+            }
+        } else {
+            while (len < target) {
+                const char *tok = tokens[fuzz_next() % (sizeof(tokens) / sizeof(tokens[0]))];
+                size_t tlen = strlen(tok);
+                if (len + tlen >= sizeof(input)) break;
+                memcpy(input + len, tok, tlen);
+                len += tlen;
+            }
+        }
+        input[len] = '\0';
+
+        ac_cmd_verdict_t verdict;
+        if (ac_cmd_policy_eval(policy, input, &verdict) != ARC_OK ||
+            verdict.action > AC_CMD_DENY ||
+            ((verdict.categories & AC_CMD_CATEGORY_BIT(AC_CMD_CAT_UNPARSED)) &&
+             verdict.action == AC_CMD_ALLOW)) {
+            printf("\n    input #%d: %s\n    ", i, input);
+            ok = 0;
+        }
+    }
+    if (ok) PASS(); else FAIL("bad verdict");
+
+    TEST("deep nesting is bounded");
+    size_t n = 0;
+    char *deep = malloc(64 * 1024);
+    for (int i = 0; i < 10000; i++) {
+        memcpy(deep + n, "$(", 2);
+        n += 2;
+    }
+    memcpy(deep + n, "rm -rf /", 8);
+    n += 8;
+    for (int i = 0; i < 10000; i++) deep[n++] = ')';
+    deep[n] = '\0';
+    ac_cmd_verdict_t verdict;
+    ok = ac_cmd_policy_eval(policy, deep, &verdict) == ARC_OK && verdict.action != AC_CMD_ALLOW &&
+         (verdict.categories & AC_CMD_CATEGORY_BIT(AC_CMD_CAT_UNPARSED));
+    free(deep);
+    if (ok) PASS(); else FAIL("deep nesting allowed");
+}
+
+int main(void) {
+    printf("=== Command Policy Tests ===\n\n");
+
+    test_parse_words();
+    test_parse_structure();
+    test_default_policy();
+    test_custom_policy();
+    test_fuzz();
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
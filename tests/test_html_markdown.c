@@ -0,0 +1,286 @@
+/**
+ * @file test_html_markdown.c
+ * @brief Tests for the streaming HTML to Markdown converter
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arc/html_markdown.h>
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+/* Convert html fed in chunks of step bytes (0 = at once); caller frees */
+static char *convert_opts(const char *html, size_t step, const ac_html_md_options_t *opts, char **title) {
+    ac_html_md_t *conv = NULL;
+    if (ac_html_md_create(opts, &conv) != ARC_OK) return NULL;
+    size_t n = strlen(html);
+    if (step == 0) step = n ? n : 1;
+    for (size_t i = 0; i < n; i += step) {
+        ac_html_md_feed(conv, html + i, i + step > n ? n - i : step);
+    }
+    char *result = strdup(ac_html_md_finish(conv, NULL));
+    if (title) *title = strdup(ac_html_md_title(conv));
+    ac_html_md_free(conv);
+    return result;
+}
+
+static char *convert(const char *html) {
+    return convert_opts(html, 0, NULL, NULL);
+}
+
+static int check(const char *html, const char *expected) {
+    char *md = convert(html);
+    int ok = md && strcmp(md, expected) == 0;
+    if (!ok) printf("\n  got:      \"%s\"\n  expected: \"%s\"\n  ", md ? md : "(null)", expected);
+    free(md);
+    return ok;
+}
+
+static const char *PAGE =
+    "<!DOCTYPE html>\n"
+    "<html><head><meta charset=\"utf-8\"><title>Sample &amp; Page</title>\n"
+    "<style>body { color: red; }</style>\n"
+    "<script>var s = \"<p>not content</p>\"; if (a < b) {}</script>\n"
+    "</head><body>\n"
+    "<nav><a href=\"/\">Home</a> <a href=\"/about\">About</a></nav>\n"
+    "<main>\n"
+    "<h1>Main   heading</h1>\n"
+    "<p>Some <b>bold</b> and <em>italic</em> text with a <a href=\"other.html\">link</a>\n"
+    "and <code>code</code>. Caf&eacute; &#8212; &#x263A;</p>\n"
+    "<!-- a comment <p>hidden</p> -->\n"
+    "<ul><li>one</li><li>two<ul><li>nested</li></ul></li></ul>\n"
+    "<pre><code class=\"language-c\">int main() {\n    return 0;\n}</code></pre>\n"
+    "<table><tr><th>A</th><th>B</th></tr><tr><td>1</td><td>2</td></tr></table>\n"
+    "</main>\n"
+    "<footer>Copyright</footer>\n"
+    "</body></html>\n";
+
+static const char *PAGE_MD =
+    "# Main heading\n"
+    "\n"
+    "Some **bold** and *italic* text with a [link](https://example.com/docs/other.html) "
+    "and `code`. Caf\xC3\xA9 \xE2\x80\x94 \xE2\x98\xBA\n"
+    "\n"
+    "- one\n"
+    "- two\n"
+    "  - nested\n"
+    "\n"
+    "```c\n"
+    "int main() {\n"
+    "    return 0;\n"
+    "}\n"
+    "```\n"
+    "\n"
+    "| A | B |\n"
+    "| --- | --- |\n"
+    "| 1 | 2 |";
+
+/*============================================================================
+ * Tests
+ *============================================================================*/
+
+static void test_page(void) {
+    TEST("Whole page: furniture dropped, content converted");
+    ac_html_md_options_t opts = { .base_url = "https://example.com/docs/page.html" };
+    char *title = NULL;
+    char *md = convert_opts(PAGE, 0, &opts, &title);
+    if (!md || strcmp(md, PAGE_MD) != 0) {
+        printf("\n  got: \"%s\"\n  ", md ? md : "(null)");
+        FAIL("unexpected markdown");
+    } else if (!title || strcmp(title, "Sample & Page") != 0) {
+        FAIL("title not decoded");
+    } else {
+        PASS();
+    }
+    free(md);
+    free(title);
+}
+
+static void test_chunked_feed(void) {
+    TEST("Any chunk size converts the same");
+    ac_html_md_options_t opts = { .base_url = "https://example.com/docs/page.html" };
+    static const size_t steps[] = { 1, 2, 3, 5, 7, 16, 100 };
+    int ok = 1;
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]) && ok; i++) {
+        char *title = NULL;
+        char *md = convert_opts(PAGE, steps[i], &opts, &title);
+        ok = md && strcmp(md, PAGE_MD) == 0 && title && strcmp(title, "Sample & Page") == 0;
+        if (!ok) printf("\n  step %zu: \"%s\"\n  ", steps[i], md ? md : "(null)");
+        free(md);
+        free(title);
+    }
+    if (ok) PASS();
+    else FAIL("chunked output differs");
+}
+
+static void test_dropped(void) {
+    TEST("Scripts, styles and hidden elements dropped");
+    int ok = check("<p>a</p><script>alert('<b>x</b>')</script><style>p{}</style>"
+                   "<noscript>enable js</noscript><div hidden>h</div>"
+                   "<div style=\"display: none\">d</div><div aria-hidden=\"true\">r</div>"
+                   "<div role=\"navigation\">menu</div><aside>side</aside><p>b</p>",
+                   "a\n\nb");
+    if (ok) PASS();
+    else FAIL("dropped content leaked");
+}
+
+static void test_references(void) {
+    TEST("Character references decoded");
+    /* &#150; is windows-1252 for an en dash, as browsers read it */
+    int ok = check("<p>&lt;tag&gt; &quot;q&quot; &#65;&#x42; &copy; &bogus; AT&T &#150;</p>",
+                   "<tag> \"q\" AB \xC2\xA9 &bogus; AT&T \xE2\x80\x93");
+    if (ok) PASS();
+    else FAIL("references");
+}
+
+static void test_charsets(void) {
+    TEST("windows-1252 from the options or <meta charset>");
+    ac_html_md_options_t opts = { .charset = "windows-1252" };
+    char *fixed = convert_opts("<p>caf\xE9 \x93quoted\x94</p>", 0, &opts, NULL);
+    char *meta = convert_opts("<meta charset=\"iso-8859-1\"><p>caf\xE9</p>", 0, NULL, NULL);
+    char *equiv = convert_opts("<meta http-equiv=\"Content-Type\" content=\"text/html; charset=windows-1252\">"
+                               "<p>\x80 5</p>", 0, NULL, NULL);
+    if (!fixed || strcmp(fixed, "caf\xC3\xA9 \xE2\x80\x9Cquoted\xE2\x80\x9D") != 0) {
+        FAIL("charset from options");
+    } else if (!meta || strcmp(meta, "caf\xC3\xA9") != 0) {
+        FAIL("meta charset");
+    } else if (!equiv || strcmp(equiv, "\xE2\x82\xAC 5") != 0) {
+        FAIL("meta http-equiv");
+    } else {
+        PASS();
+    }
+    free(fixed);
+    free(meta);
+    free(equiv);
+}
+
+static void test_blocks(void) {
+    TEST("Lists, quotes, breaks and rules");
+    int ok = check("<ol><li>first</li><li>second<ul><li>x</li></ul></li></ol>"
+                   "<blockquote><p>q1</p><p>q2</p></blockquote>"
+                   "<p>line<br>break</p><hr><h3>  Sub  </h3><p>   </p><div></div>",
+                   "1. first\n2. second\n   - x\n\n> q1\n>\n> q2\n\nline\nbreak\n\n---\n\n### Sub");
+    if (ok) PASS();
+    else FAIL("block structure");
+}
+
+static void test_pre(void) {
+    TEST("<pre> keeps whitespace and markup characters");
+    int ok = check("<pre>\n  a  &lt;b&gt;\n\tc</pre><pre></pre><p>after</p>",
+                   "```\n  a  <b>\n\tc\n```\n\nafter");
+    if (ok) PASS();
+    else FAIL("pre block");
+}
+
+static void test_links(void) {
+    TEST("Links and images resolved against <base href>");
+    ac_html_md_options_t opts = { .base_url = "https://example.com/a/b.html" };
+    char *md = convert_opts("<base href=\"https://docs.example.org/v2/\">"
+                            "<p><a href=\"../guide/x.html#s\">Guide</a> <a href=\"#top\">top</a> "
+                            "<a href=\"javascript:void(0)\">js</a> <a href=\"/x\"></a> "
+                            "<img src=\"i.png\" alt=\"Pic\"> <img src=\"data:image/png;base64,AA\" alt=\"Inline\"> "
+                            "<img src=\"spacer.gif\"></p>",
+                            0, &opts, NULL);
+    const char *expected = "[Guide](https://docs.example.org/guide/x.html#s) top js "
+                           "![Pic](https://docs.example.org/v2/i.png) Inline";
+    if (md && strcmp(md, expected) == 0) {
+        PASS();
+    } else {
+        printf("\n  got: \"%s\"\n  ", md ? md : "(null)");
+        FAIL("links");
+    }
+    free(md);
+}
+
+static void test_text_format(void) {
+    TEST("Plain text format has no markup");
+    ac_html_md_options_t opts = { .format = AC_HTML_MD_TEXT };
+    char *text = convert_opts("<h2>Title</h2><p><b>bold</b> <a href=\"/x\">link</a></p><ul><li>item</li></ul>",
+                              0, &opts, NULL);
+    if (text && !strchr(text, '#') && !strchr(text, '*') && !strchr(text, '[') &&
+        strstr(text, "Title") && strstr(text, "bold link") && strstr(text, "item")) {
+        PASS();
+    } else {
+        printf("\n  got: \"%s\"\n  ", text ? text : "(null)");
+        FAIL("markup in text output");
+    }
+    free(text);
+}
+
+static void test_truncation(void) {
+    TEST("max_output bounds the output");
+    ac_html_md_options_t opts = { .max_output = 100 };
+    ac_html_md_t *conv = NULL;
+    ac_html_md_create(&opts, &conv);
+    for (int i = 0; i < 1000; i++) {
+        ac_html_md_feed(conv, "<p>paragraph of text</p>", 24);
+    }
+    size_t len = 0;
+    const char *md = ac_html_md_finish(conv, &len);
+    if (len <= 100 && len > 50 && ac_html_md_truncated(conv) && strlen(md) == len &&
+        strncmp(md, "paragraph of text\n\nparagraph", 28) == 0) {
+        PASS();
+    } else {
+        FAIL("not truncated");
+    }
+    ac_html_md_free(conv);
+}
+
+static void test_malformed(void) {
+    TEST("Malformed input does not lose text");
+    int ok = check("<p>a < b and c > d</p><p>unclosed <b>bold", "a < b and c > d\n\nunclosed **bold**");
+    char *md = convert("<p>x</p><!-- never closed <p>y</p>");
+    ok = ok && md && strcmp(md, "x") == 0;
+    free(md);
+    if (ok) PASS();
+    else FAIL("malformed input");
+}
+
+/*============================================================================
+ * Main
+ *============================================================================*/
+
+int main(void) {
+    printf("=== HTML to Markdown Tests ===\n\n");
+
+    test_page();
+    test_chunked_feed();
+    test_dropped();
+    test_references();
+    test_charsets();
+    test_blocks();
+    test_pre();
+    test_links();
+    test_text_format();
+    test_truncation();
+    test_malformed();
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
@@ -0,0 +1,483 @@
+/**
+ * @file test_http_cache.c
+ * @brief Tests for the on-disk HTTP cache, against a local HTTP server
+ */
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <arc/http_cache.h>
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+static char g_tmp[256];
+
+/*============================================================================
+ * Local HTTP Server
+ *
+ * One connection at a time, closed after each response. Routes:
+ *   /etag           ETag "v<n>" with no-cache; 304 when If-None-Match matches
+ *   /lastmod        Last-Modified with max-age=0; 304 when If-Modified-Since matches
+ *   /fresh          max-age=3600
+ *   /nostore        no-store
+ *   /redirect       302 to /fresh-target (max-age=3600)
+ *   /loop           302 to itself
+ *   /to-file        302 to a file: URL
+ *   /big            4 KiB body
+ *   /slow           answers after 1.5 s
+ *   /missing        404 with a body
+ *   /blob/<n>       1000 bytes, max-age=3600
+ *============================================================================*/
+
+#define LAST_MODIFIED "Wed, 21 Oct 2015 07:28:00 GMT"
+
+static int g_listen = -1;
+static int g_port;
+static pthread_t g_server;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_requests;                  /* All routes */
+static int g_etag_version = 1;
+static char g_if_none_match[64];        /* Of the last request */
+static char g_if_modified_since[64];
+
+static int server_requests(void) {
+    pthread_mutex_lock(&g_lock);
+    int n = g_requests;
+    pthread_mutex_unlock(&g_lock);
+    return n;
+}
+
+static void request_header(const char *req, const char *name, char *out, size_t size) {
+    out[0] = '\0';
+    size_t len = strlen(name);
+    for (const char *line = strstr(req, "\r\n"); line && line[2]; line = strstr(line + 2, "\r\n")) {
+        const char *p = line + 2;
+        if (strncasecmp(p, name, len) == 0 && p[len] == ':') {
+            p += len + 1;
+            while (*p == ' ') p++;
+            size_t n = strcspn(p, "\r\n");
+            if (n >= size) n = size - 1;
+            memcpy(out, p, n);
+            out[n] = '\0';
+            return;
+        }
+    }
+}
+
+static void respond(int fd, int status, const char *headers, const char *body, size_t body_len) {
+    char head[1024];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 %d X\r\nContent-Length: %zu\r\nConnection: close\r\n%s\r\n",
+                     status, body_len, headers);
+    send(fd, head, (size_t)n, MSG_NOSIGNAL);
+    if (body_len) send(fd, body, body_len, MSG_NOSIGNAL);
+}
+
+static void serve(int fd) {
+    char req[4096] = "";
+    size_t len = 0;
+    while (len < sizeof(req) - 1 && !strstr(req, "\r\n\r\n")) {
+        ssize_t n = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+        if (n <= 0) return;
+        len += (size_t)n;
+        req[len] = '\0';
+    }
+    char path[256] = "";
+    sscanf(req, "GET %255s", path);
+
+    char inm[64], ims[64];
+    request_header(req, "If-None-Match", inm, sizeof(inm));
+    request_header(req, "If-Modified-Since", ims, sizeof(ims));
+    pthread_mutex_lock(&g_lock);
+    g_requests++;
+    int version = g_etag_version;
+    snprintf(g_if_none_match, sizeof(g_if_none_match), "%s", inm);
+    snprintf(g_if_modified_since, sizeof(g_if_modified_since), "%s", ims);
+    pthread_mutex_unlock(&g_lock);
+
+    char headers[512], body[64];
+    if (strcmp(path, "/etag") == 0) {
+        char etag[16];
+        snprintf(etag, sizeof(etag), "\"v%d\"", version);
+        snprintf(headers, sizeof(headers), "ETag: %s\r\nCache-Control: no-cache\r\nContent-Type: text/html\r\n", etag);
+        if (strcmp(inm, etag) == 0) {
+            respond(fd, 304, headers, "", 0);
+        } else {
+            int n = snprintf(body, sizeof(body), "<p>etag body v%d</p>", version);
+            respond(fd, 200, headers, body, (size_t)n);
+        }
+    } else if (strcmp(path, "/lastmod") == 0) {
+        const char *h = "Last-Modified: " LAST_MODIFIED "\r\nCache-Control: max-age=0\r\nContent-Type: text/plain\r\n";
+        if (strcmp(ims, LAST_MODIFIED) == 0) respond(fd, 304, h, "", 0);
+        else respond(fd, 200, h, "lastmod body", 12);
+    } else if (strcmp(path, "/fresh") == 0 || strcmp(path, "/fresh-target") == 0) {
+        respond(fd, 200, "Cache-Control: max-age=3600\r\nContent-Type: text/plain\r\n", "fresh body", 10);
+    } else if (strcmp(path, "/nostore") == 0) {
+        respond(fd, 200, "Cache-Control: no-store\r\nETag: \"n\"\r\n", "private", 7);
+    } else if (strcmp(path, "/redirect") == 0) {
+        respond(fd, 302, "Location: /fresh-target\r\n", "", 0);
+    } else if (strcmp(path, "/to-file") == 0) {
+        respond(fd, 302, "Location: file:///etc/hostname\r\n", "", 0);
+    } else if (strcmp(path, "/loop") == 0) {
+        respond(fd, 302, "Location: /loop\r\n", "", 0);
+    } else if (strcmp(path, "/big") == 0) {
+        static char big[4096];
+        memset(big, 'x', sizeof(big));
+        respond(fd, 200, "Cache-Control: max-age=3600\r\n", big, sizeof(big));
+    } else if (strcmp(path, "/slow") == 0) {
+        poll(NULL, 0, 1500);
+        respond(fd, 200, "", "late", 4);
+    } else if (strncmp(path, "/blob/", 6) == 0) {
+        static char blob[1000];
+        memset(blob, 'b', sizeof(blob));
+        respond(fd, 200, "Cache-Control: max-age=3600\r\n", blob, sizeof(blob));
+    } else {
+        respond(fd, 404, "Content-Type: text/plain\r\n", "not found", 9);
+    }
+}
+
+static void *server_main(void *arg) {
+    (void)arg;
+    for (;;) {
+        int fd = accept(g_listen, NULL, NULL);
+        if (fd < 0) break;              /* Listening socket shut down */
+        serve(fd);
+        close(fd);
+    }
+    return NULL;
+}
+
+static int server_start(void) {
+    g_listen = socket(AF_INET, SOCK_STREAM, 0);
+    if (g_listen < 0) return -1;
+    int one = 1;
+    setsockopt(g_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(g_listen, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(g_listen, 16) != 0 ||
+        getsockname(g_listen, (struct sockaddr *)&addr, &addr_len) != 0) {
+        close(g_listen);
+        return -1;
+    }
+    g_port = ntohs(addr.sin_port);
+    return pthread_create(&g_server, NULL, server_main, NULL) == 0 ? 0 : -1;
+}
+
+static void server_stop(void) {
+    shutdown(g_listen, SHUT_RDWR);
+    pthread_join(g_server, NULL);
+    close(g_listen);
+}
+
+static const char *url(const char *path) {
+    static char buf[256];
+    snprintf(buf, sizeof(buf), "http://127.0.0.1:%d%s", g_port, path);
+    return buf;
+}
+
+static ac_http_cache_t *open_cache(const char *sub, size_t max_bytes, int timeout_ms) {
+    char dir[320];
+    snprintf(dir, sizeof(dir), "%s/%s", g_tmp, sub);
+    ac_http_cache_options_t opts = {
+        .dir = dir,
+        .max_bytes = max_bytes,
+        .max_body = 2048,
+        .timeout_ms = timeout_ms,
+    };
+    ac_http_cache_t *cache = NULL;
+    return ac_http_cache_open(&opts, &cache) == ARC_OK ? cache : NULL;
+}
+
+static int count_files(const char *sub, const char *suffix) {
+    char dir[320];
+    snprintf(dir, sizeof(dir), "%s/%s", g_tmp, sub);
+    DIR *d = opendir(dir);
+    if (!d) return -1;
+    int n = 0;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        size_t len = strlen(de->d_name), slen = strlen(suffix);
+        if (len > slen && strcmp(de->d_name + len - slen, suffix) == 0) n++;
+    }
+    closedir(d);
+    return n;
+}
+
+/*============================================================================
+ * Tests
+ *============================================================================*/
+
+static void test_etag_revalidation(ac_http_cache_t *cache) {
+    TEST("ETag: revalidated with If-None-Match, 304 served from disk");
+    ac_http_fetch_t a, b, c;
+    arc_err_t e1 = ac_http_cache_fetch(cache, url("/etag"), &a);
+    arc_err_t e2 = ac_http_cache_fetch(cache, url("/etag"), &b);
+    pthread_mutex_lock(&g_lock);
+    int sent_validator = strcmp(g_if_none_match, "\"v1\"") == 0;
+    g_etag_version = 2;
+    pthread_mutex_unlock(&g_lock);
+    arc_err_t e3 = ac_http_cache_fetch(cache, url("/etag"), &c);
+
+    if (e1 != ARC_OK || e2 != ARC_OK || e3 != ARC_OK) {
+        FAIL("fetch failed");
+    } else if (a.source != AC_HTTP_FROM_NETWORK || a.status != 200 || strcmp(a.body, "<p>etag body v1</p>") != 0 ||
+               strcmp(a.content_type, "text/html") != 0) {
+        FAIL("first fetch");
+    } else if (!sent_validator || b.source != AC_HTTP_REVALIDATED || b.status != 200 ||
+               strcmp(b.body, a.body) != 0 || b.size != a.size) {
+        FAIL("not revalidated");
+    } else if (c.source != AC_HTTP_FROM_NETWORK || strcmp(c.body, "<p>etag body v2</p>") != 0) {
+        FAIL("changed resource not refetched");
+    } else {
+        PASS();
+    }
+    ac_http_fetch_free(&a);
+    ac_http_fetch_free(&b);
+    ac_http_fetch_free(&c);
+}
+
+static void test_last_modified(ac_http_cache_t *cache) {
+    TEST("Last-Modified: revalidated with If-Modified-Since");
+    ac_http_fetch_t a, b;
+    ac_http_cache_fetch(cache, url("/lastmod"), &a);
+    ac_http_cache_fetch(cache, url("/lastmod"), &b);
+    pthread_mutex_lock(&g_lock);
+    int sent_validator = strcmp(g_if_modified_since, LAST_MODIFIED) == 0;
+    pthread_mutex_unlock(&g_lock);
+    if (a.source == AC_HTTP_FROM_NETWORK && b.source == AC_HTTP_REVALIDATED && sent_validator &&
+        b.body && strcmp(b.body, "lastmod body") == 0) {
+        PASS();
+    } else {
+        FAIL("not revalidated");
+    }
+    ac_http_fetch_free(&a);
+    ac_http_fetch_free(&b);
+}
+
+static void test_fresh_hit(ac_http_cache_t *cache) {
+    TEST("max-age: fresh copy served without a request");
+    ac_http_fetch_t a, b;
+    ac_http_cache_fetch(cache, url("/fresh"), &a);
+    int before = server_requests();
+    ac_http_cache_fetch(cache, url("/fresh"), &b);
+    ac_http_cache_stats_t stats;
+    ac_http_cache_stats(cache, &stats);
+    if (a.source == AC_HTTP_FROM_NETWORK && b.source == AC_HTTP_FROM_CACHE && server_requests() == before &&
+        b.body && strcmp(b.body, "fresh body") == 0 && strcmp(b.content_type, "text/plain") == 0 &&
+        stats.hits >= 1) {
+        PASS();
+    } else {
+        FAIL("fresh entry not used");
+    }
+    ac_http_fetch_free(&a);
+    ac_http_fetch_free(&b);
+}
+
+static void test_no_store(ac_http_cache_t *cache) {
+    TEST("no-store: never stored");
+    ac_http_fetch_t a, b;
+    ac_http_cache_fetch(cache, url("/nostore"), &a);
+    int before = server_requests();
+    ac_http_cache_fetch(cache, url("/nostore"), &b);
+    if (a.source == AC_HTTP_FROM_NETWORK && b.source == AC_HTTP_FROM_NETWORK && server_requests() == before + 1 &&
+        b.body && strcmp(b.body, "private") == 0) {
+        PASS();
+    } else {
+        FAIL("no-store response cached");
+    }
+    ac_http_fetch_free(&a);
+    ac_http_fetch_free(&b);
+}
+
+static void test_redirects(ac_http_cache_t *cache) {
+    TEST("Redirects followed and cached under the URL asked for");
+    ac_http_fetch_t a, b, loop;
+    ac_http_cache_fetch(cache, url("/redirect"), &a);
+    int before = server_requests();
+    ac_http_cache_fetch(cache, url("/redirect"), &b);
+    int after = server_requests();
+    arc_err_t err = ac_http_cache_fetch(cache, url("/loop"), &loop);
+    char final_url[256];
+    snprintf(final_url, sizeof(final_url), "%s", url("/fresh-target"));
+
+    if (a.status != 200 || !a.url || strcmp(a.url, final_url) != 0 || strcmp(a.body, "fresh body") != 0) {
+        FAIL("redirect not followed");
+    } else if (b.source != AC_HTTP_FROM_CACHE || after != before || strcmp(b.url, final_url) != 0) {
+        FAIL("redirected entry not cached");
+    } else if (err != ARC_ERR_PROTOCOL || !strstr(ac_http_cache_error(cache), "redirects")) {
+        FAIL("redirect loop not stopped");
+    } else {
+        PASS();
+    }
+    ac_http_fetch_free(&a);
+    ac_http_fetch_free(&b);
+    ac_http_fetch_free(&loop);
+}
+
+static void test_other_schemes(ac_http_cache_t *cache) {
+    TEST("Redirects to and URLs of other schemes refused");
+    ac_http_fetch_t redirected, direct;
+    arc_err_t e_redirect = ac_http_cache_fetch(cache, url("/to-file"), &redirected);
+    int explained = strstr(ac_http_cache_error(cache), "non-HTTP") != NULL;
+    arc_err_t e_direct = ac_http_cache_fetch(cache, "file:///etc/hostname", &direct);
+
+    if (e_redirect != ARC_ERR_PROTOCOL || redirected.body || !explained) {
+        FAIL("redirect to file: followed");
+    } else if (e_direct != ARC_ERR_INVALID_ARG || direct.body) {
+        FAIL("file: URL fetched");
+    } else {
+        PASS();
+    }
+    ac_http_fetch_free(&redirected);
+    ac_http_fetch_free(&direct);
+}
+
+static void test_errors(ac_http_cache_t *cache) {
+    TEST("Status codes returned, oversized and slow responses refused");
+    ac_http_fetch_t missing, big, slow, bad;
+    arc_err_t e_missing = ac_http_cache_fetch(cache, url("/nothing-here"), &missing);
+    arc_err_t e_big = ac_http_cache_fetch(cache, url("/big"), &big);
+    arc_err_t e_slow = ac_http_cache_fetch(cache, url("/slow"), &slow);
+    arc_err_t e_bad = ac_http_cache_fetch(cache, "", &bad);
+
+    if (e_missing != ARC_OK || missing.status != 404 || strcmp(missing.body, "not found") != 0) {
+        FAIL("404 not returned as a result");
+    } else if (e_big != ARC_ERR_RESPONSE_TOO_LARGE || big.body) {
+        FAIL("oversized body accepted");
+    } else if (e_slow != ARC_ERR_TIMEOUT) {
+        FAIL("no timeout");
+    } else if (e_bad != ARC_ERR_INVALID_ARG) {
+        FAIL("empty URL accepted");
+    } else {
+        PASS();
+    }
+    ac_http_fetch_free(&missing);
+    ac_http_fetch_free(&big);
+    ac_http_fetch_free(&slow);
+}
+
+static void test_eviction(void) {
+    TEST("Least recently used entries evicted over max_bytes");
+    ac_http_cache_t *cache = open_cache("small", 3500, 5000);
+    ac_http_fetch_t f;
+    static const char *const paths[] = { "/blob/1", "/blob/2", "/blob/3", "/blob/1", "/blob/4", "/blob/5" };
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+        ac_http_cache_fetch(cache, url(paths[i]), &f);
+        ac_http_fetch_free(&f);
+        poll(NULL, 0, 20);              /* Distinct use times */
+    }
+    ac_http_cache_stats_t stats;
+    ac_http_cache_stats(cache, &stats);
+
+    /* /blob/1 was used after 2 and 3, so those went first */
+    int before = server_requests();
+    ac_http_cache_fetch(cache, url("/blob/1"), &f);
+    int kept = f.source == AC_HTTP_FROM_CACHE && server_requests() == before;
+    ac_http_fetch_free(&f);
+
+    if (!cache) {
+        FAIL("cache not opened");
+    } else if (stats.evicted != 2 || count_files("small", ".body") != 3 || count_files("small", ".json") != 3) {
+        FAIL("wrong entries evicted");
+    } else if (!kept) {
+        FAIL("recently used entry evicted");
+    } else {
+        PASS();
+    }
+    ac_http_cache_close(cache);
+}
+
+static void test_stale_when_offline(ac_http_cache_t *cache) {
+    TEST("Stale copy served when the server is down");
+    server_stop();
+    ac_http_fetch_t f, missing;
+    arc_err_t err = ac_http_cache_fetch(cache, url("/etag"), &f);
+    arc_err_t err_missing = ac_http_cache_fetch(cache, url("/uncached"), &missing);
+    if (err == ARC_OK && f.stale && f.source == AC_HTTP_FROM_CACHE && strcmp(f.body, "<p>etag body v2</p>") == 0 &&
+        err_missing == ARC_ERR_NETWORK && ac_http_cache_error(cache)[0]) {
+        PASS();
+    } else {
+        FAIL("no stale copy");
+    }
+    ac_http_fetch_free(&f);
+    ac_http_fetch_free(&missing);
+}
+
+/*============================================================================
+ * Main
+ *============================================================================*/
+
+int main(void) {
+    printf("=== HTTP Cache Tests ===\n\n");
+
+    snprintf(g_tmp, sizeof(g_tmp), "/tmp/arc_http_cache_XXXXXX");
+    if (!mkdtemp(g_tmp)) {
+        printf("Failed to create temp dir\n");
+        return 1;
+    }
+    if (server_start() != 0) {
+        printf("Failed to start the local server\n");
+        return 1;
+    }
+
+    ac_http_cache_t *cache = open_cache("main", 0, 500);
+    if (!cache) {
+        printf("Failed to open cache\n");
+        return 1;
+    }
+    test_etag_revalidation(cache);
+    test_last_modified(cache);
+    test_fresh_hit(cache);
+    test_no_store(cache);
+    test_redirects(cache);
+    test_other_schemes(cache);
+    test_errors(cache);
+    test_eviction();
+    test_stale_when_offline(cache);
+    ac_http_cache_close(cache);
+
+    char cmd[300];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", g_tmp);
+    if (system(cmd) != 0) {
+        printf("warning: could not remove %s\n", g_tmp);
+    }
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
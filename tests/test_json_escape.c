@@ -0,0 +1,264 @@
+/**
+ * @file test_json_escape.c
+ * @brief Tests for ac_json_escape and the cJSON string printer built on it
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arc/json_escape.h"
+#include "cJSON.h"
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+/* Escape into a malloc'd NUL-terminated string using `chunk`-sized output */
+static char *escape_chunked(const char *in, size_t len, size_t chunk, size_t *replaced) {
+    char *out = malloc(AC_JSON_ESCAPE_MAX(len) + 1);
+    char *buf = malloc(chunk);
+    size_t o = 0, pos = 0;
+
+    while (pos < len) {
+        size_t used = 0;
+        size_t n = ac_json_escape(buf, chunk, in + pos, len - pos, &used, replaced);
+        if (used == 0) break;
+        memcpy(out + o, buf, n);
+        o += n;
+        pos += used;
+    }
+    out[o] = '\0';
+    free(buf);
+    return out;
+}
+
+/* Byte-at-a-time reference matching cJSON's original output for valid input */
+static char *escape_reference(const char *in, size_t len) {
+    char *out = malloc(AC_JSON_ESCAPE_MAX(len) + 1);
+    char *w = out;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)in[i];
+        switch (c) {
+            case '"':  *w++ = '\\'; *w++ = '"'; break;
+            case '\\': *w++ = '\\'; *w++ = '\\'; break;
+            case '\b': *w++ = '\\'; *w++ = 'b'; break;
+            case '\f': *w++ = '\\'; *w++ = 'f'; break;
+            case '\n': *w++ = '\\'; *w++ = 'n'; break;
+            case '\r': *w++ = '\\'; *w++ = 'r'; break;
+            case '\t': *w++ = '\\'; *w++ = 't'; break;
+            default:
+                if (c < 0x20) {
+                    w += sprintf(w, "\\u%04x", c);
+                } else {
+                    *w++ = (char)c;
+                }
+        }
+    }
+    *w = '\0';
+    return out;
+}
+
+/*============================================================================
+ * Test Cases
+ *============================================================================*/
+
+static void test_escapes(void) {
+    TEST("control characters and quotes");
+    const char in[] = "a\"b\\c\bd\fe\nf\rg\th\x01i\x1f";
+    char *out = escape_chunked(in, sizeof(in) - 1, 64, NULL);
+    if (strcmp(out, "a\\\"b\\\\c\\bd\\fe\\nf\\rg\\th\\u0001i\\u001f") != 0) {
+        FAIL(out);
+    } else {
+        PASS();
+    }
+    free(out);
+}
+
+static void test_embedded_nul(void) {
+    TEST("embedded NUL");
+    const char in[] = { 'a', '\0', 'b' };
+    char *out = escape_chunked(in, sizeof(in), 64, NULL);
+    if (strcmp(out, "a\\u0000b") != 0) {
+        FAIL(out);
+    } else {
+        PASS();
+    }
+    free(out);
+}
+
+static void test_valid_utf8(void) {
+    TEST("valid UTF-8 passes through");
+    const char *in = "caf\xc3\xa9 \xe4\xb8\xad\xe6\x96\x87 \xf0\x9f\x98\x80 \xef\xbf\xbf";
+    size_t replaced = 0;
+    char *out = escape_chunked(in, strlen(in), 64, &replaced);
+    if (strcmp(out, in) != 0 || replaced != 0) {
+        FAIL("modified");
+    } else {
+        PASS();
+    }
+    free(out);
+}
+
+static void test_invalid_utf8(void) {
+    static const struct {
+        const char *in;
+        const char *expect;
+        size_t replaced;
+    } cases[] = {
+        { "a\x80z",             "a\xef\xbf\xbdz", 1 },              /* stray continuation */
+        { "a\xc0\xafz",         "a\xef\xbf\xbd\xef\xbf\xbdz", 2 },  /* overlong */
+        { "a\xed\xa0\x80z",     "a\xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbdz", 3 }, /* surrogate */
+        { "a\xf4\x90\x80\x80z", "a\xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbdz", 4 }, /* > U+10FFFF */
+        { "a\xe4\xb8z",         "a\xef\xbf\xbdz", 1 },              /* truncated, one subpart */
+        { "a\xf0\x9f\x98",      "a\xef\xbf\xbd", 1 },               /* truncated at end */
+        { "\xff\xfe",           "\xef\xbf\xbd\xef\xbf\xbd", 2 },
+    };
+
+    TEST("invalid UTF-8 replaced with U+FFFD");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        size_t replaced = 0;
+        char *out = escape_chunked(cases[i].in, strlen(cases[i].in), 64, &replaced);
+        int ok = strcmp(out, cases[i].expect) == 0 && replaced == cases[i].replaced;
+        free(out);
+        if (!ok) {
+            char msg[32];
+            snprintf(msg, sizeof(msg), "case %zu", i);
+            FAIL(msg);
+            return;
+        }
+    }
+    PASS();
+}
+
+static void test_matches_reference(void) {
+    TEST("vector path matches byte-wise reference");
+    size_t len = 100000;
+    char *in = malloc(len);
+    unsigned int seed = 12345;
+
+    /* Mostly plain ASCII with occasional escapes, to cross vector edges */
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1103515245u + 12345u;
+        unsigned int r = (seed >> 16) % 100;
+        if (r < 3) {
+            in[i] = (char)((seed >> 8) % 0x20);
+        } else if (r < 5) {
+            in[i] = (r == 3) ? '"' : '\\';
+        } else {
+            in[i] = (char)(0x20 + (seed >> 8) % 0x5f);
+        }
+    }
+
+    char *expect = escape_reference(in, len);
+    static const size_t chunks[] = { 8, 9, 31, 33, 4096, 1 << 20 };
+    int ok = 1;
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]) && ok; c++) {
+        char *out = escape_chunked(in, len, chunks[c], NULL);
+        ok = strcmp(out, expect) == 0;
+        free(out);
+    }
+    free(expect);
+    free(in);
+
+    if (ok) {
+        PASS();
+    } else {
+        FAIL("mismatch");
+    }
+}
+
+static void test_chunk_never_splits(void) {
+    TEST("chunk boundaries never split sequences");
+    const char *in = "\xe4\xb8\xad\n\xe4\xb8\xad\x01";
+    char buf[8];
+    size_t used = 0;
+    /* 3 + 2 = 5 bytes fit, the next 3-byte char does not */
+    size_t n = ac_json_escape(buf, 7, in, strlen(in), &used, NULL);
+    if (n != 5 || used != 4) {
+        FAIL("bad split");
+        return;
+    }
+    PASS();
+}
+
+static void test_cjson_print(void) {
+    TEST("cJSON prints escaped and repaired strings");
+    cJSON *obj = cJSON_CreateObject();
+    cJSON_AddStringToObject(obj, "k\"ey", "line1\nline2 \x80 \xc3\xa9");
+    char *s = cJSON_PrintUnformatted(obj);
+    const char *expect = "{\"k\\\"ey\":\"line1\\nline2 \xef\xbf\xbd \xc3\xa9\"}";
+    int ok = s && strcmp(s, expect) == 0;
+
+    /* Preallocated (non-growing) buffers take the same path */
+    char pre[64];
+    ok = ok && cJSON_PrintPreallocated(obj, pre, sizeof(pre), 0) && strcmp(pre, expect) == 0;
+    char small[16];
+    ok = ok && !cJSON_PrintPreallocated(obj, small, sizeof(small), 0);
+
+    /* Long strings grow the buffer while escaping */
+    size_t big = 200000;
+    char *long_str = malloc(big + 1);
+    for (size_t i = 0; i < big; i++) {
+        long_str[i] = (i % 7 == 0) ? '\n' : 'x';
+    }
+    long_str[big] = '\0';
+    cJSON *arr = cJSON_CreateArray();
+    cJSON_AddItemToArray(arr, cJSON_CreateString(long_str));
+    cJSON_AddItemToArray(arr, cJSON_CreateString("tail"));
+    char *printed = cJSON_PrintUnformatted(arr);
+    cJSON *parsed = printed ? cJSON_Parse(printed) : NULL;
+    ok = ok && parsed
+         && strcmp(cJSON_GetArrayItem(parsed, 0)->valuestring, long_str) == 0
+         && strcmp(cJSON_GetArrayItem(parsed, 1)->valuestring, "tail") == 0;
+
+    cJSON_Delete(parsed);
+    cJSON_free(printed);
+    cJSON_Delete(arr);
+    free(long_str);
+    cJSON_free(s);
+    cJSON_Delete(obj);
+
+    if (ok) {
+        PASS();
+    } else {
+        FAIL("unexpected output");
+    }
+}
+
+int main(void) {
+    printf("=== JSON Escape Tests (%s) ===\n\n", ac_json_escape_impl());
+
+    test_escapes();
+    test_embedded_nul();
+    test_valid_utf8();
+    test_invalid_utf8();
+    test_matches_reference();
+    test_chunk_never_splits();
+    test_cjson_print();
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
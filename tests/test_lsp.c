@@ -0,0 +1,525 @@
+/**
+ * @file test_lsp.c
+ * @brief Tests for the LSP client pool, against mock_lsp_server
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <arc/lsp.h>
+
+#ifndef MOCK_LSP_SERVER
+#error "MOCK_LSP_SERVER must name the mock server binary"
+#endif
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+static char g_tmp[256];
+static char g_root[300];                /* Canonical, as the pool reports paths */
+
+static const char *at(const char *rel) {
+    static char path[512];
+    snprintf(path, sizeof(path), "%s/%s", g_root, rel);
+    return path;
+}
+
+static void write_file(const char *rel, const char *content) {
+    FILE *f = fopen(at(rel), "w");
+    if (f) {
+        fputs(content, f);
+        fclose(f);
+    }
+}
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* 1-based byte column of the nth (0-based) occurrence of word in a line */
+static unsigned column_of(const char *line, const char *word, int nth) {
+    const char *p = line;
+    for (p = strstr(p, word); p && nth > 0; nth--) p = strstr(p + 1, word);
+    return p ? (unsigned)(p - line) + 1 : 0;
+}
+
+/* C files: UTF-16 positions, incremental changes. Python: UTF-8, whole text */
+static const char *const C_ARGV[] = { MOCK_LSP_SERVER, NULL };
+static const char *const PY_ARGV[] = { MOCK_LSP_SERVER, "--utf8", "--full", NULL };
+static const char *const MISSING_ARGV[] = { "/nonexistent/arc-lsp-server", NULL };
+
+static const ac_lsp_server_config_t g_servers[] = {
+    { "c", ".c .h", C_ARGV },
+    { "python", ".py", PY_ARGV },
+    { "missing", ".zz", MISSING_ARGV },
+};
+
+static ac_lsp_pool_t *new_pool(int timeout_ms, size_t max_documents) {
+    ac_lsp_options_t opts = {
+        .root = g_root,
+        .servers = g_servers,
+        .servers_count = sizeof(g_servers) / sizeof(g_servers[0]),
+        .request_timeout_ms = timeout_ms,
+        .max_documents = max_documents,
+    };
+    ac_lsp_pool_t *pool = NULL;
+    if (ac_lsp_pool_create(&opts, &pool) != ARC_OK) return NULL;
+    return pool;
+}
+
+/* Non-ASCII before the names: 2-byte, and 4-byte (a UTF-16 surrogate pair) */
+static const char LINE1[] = "/* \xC3\xA9 \xF0\x9F\x98\x80 */ int target = 1; /* FIXME */";
+static const char LINE2[] = "int use(void) { return target; }";
+
+static void setup_tree(void) {
+    mkdir(at("src"), 0755);
+    char text[256];
+    snprintf(text, sizeof(text), "%s\n%s\n", LINE1, LINE2);
+    write_file("src/main.c", text);
+    write_file("src/slow.c", "int slow = 0; int fast = 1; int hang; int boom; int crash;\n");
+    write_file("app.py", "# \xC3\xA9\ndef greet(name):\n    return name\n");
+}
+
+/*============================================================================
+ * Queries
+ *============================================================================*/
+
+static void test_definition_and_references(ac_lsp_pool_t *pool) {
+    TEST("definition and references with UTF-16 columns");
+    ac_lsp_locations_t locs;
+    unsigned use_col = column_of(LINE2, "target", 0);
+    if (ac_lsp_definition(pool, "src/main.c", 2, use_col + 2, &locs) != ARC_OK) {
+        FAIL(ac_lsp_error());
+        return;
+    }
+    unsigned def_col = column_of(LINE1, "target", 0);
+    int ok = locs.count == 1 && strcmp(locs.locations[0].path, at("src/main.c")) == 0 &&
+             locs.locations[0].line == 1 && locs.locations[0].column == def_col &&
+             locs.locations[0].end_line == 1 && locs.locations[0].end_column == def_col + 6;
+    ac_lsp_locations_free(&locs);
+    if (!ok) {
+        FAIL("wrong definition");
+        return;
+    }
+
+    /* Absolute paths work as well as relative ones */
+    if (ac_lsp_references(pool, at("src/main.c"), 1, def_col, &locs) != ARC_OK) {
+        FAIL(ac_lsp_error());
+        return;
+    }
+    ok = locs.count == 2 && locs.locations[0].line == 1 && locs.locations[0].column == def_col &&
+         locs.locations[1].line == 2 && locs.locations[1].column == use_col;
+    ac_lsp_locations_free(&locs);
+    if (!ok) {
+        FAIL("wrong references");
+        return;
+    }
+    PASS();
+}
+
+static void test_hover(ac_lsp_pool_t *pool) {
+    TEST("hover");
+    char *text = NULL;
+    if (ac_lsp_hover(pool, "src/main.c", 2, column_of(LINE2, "use", 0), &text) != ARC_OK) {
+        FAIL(ac_lsp_error());
+        return;
+    }
+    char expected[128];
+    snprintf(expected, sizeof(expected), "`use` %s", LINE2);
+    int ok = strcmp(text, expected) == 0;
+    free(text);
+    if (!ok) {
+        FAIL("wrong hover text");
+        return;
+    }
+    PASS();
+}
+
+static void test_diagnostics(ac_lsp_pool_t *pool) {
+    TEST("diagnostics");
+    ac_lsp_diagnostics_t diags;
+    if (ac_lsp_diagnostics(pool, "src/main.c", 2000, &diags) != ARC_OK) {
+        FAIL(ac_lsp_error());
+        return;
+    }
+    unsigned col = column_of(LINE1, "FIXME", 0);
+    int ok = diags.count == 1 && !diags.stale && diags.items[0].line == 1 &&
+             diags.items[0].column == col && diags.items[0].end_column == col + 5 &&
+             diags.items[0].severity == AC_LSP_WARNING &&
+             strcmp(diags.items[0].message, "FIXME left in code") == 0 &&
+             strcmp(diags.items[0].source, "mock") == 0 && strcmp(diags.items[0].code, "7") == 0;
+    ac_lsp_diagnostics_free(&diags);
+    if (!ok) {
+        FAIL("wrong diagnostics");
+        return;
+    }
+    PASS();
+}
+
+/*============================================================================
+ * Document Sync
+ *============================================================================*/
+
+/* Hover at line 1 shows the server's copy of that line */
+static int server_line_is(ac_lsp_pool_t *pool, const char *rel, unsigned line, const char *word,
+                          const char *expected_line) {
+    char *text = NULL;
+    if (ac_lsp_hover(pool, rel, line, column_of(expected_line, word, 0), &text) != ARC_OK) return 0;
+    char expected[256];
+    snprintf(expected, sizeof(expected), "`%s` %s", word, expected_line);
+    int ok = strcmp(text, expected) == 0;
+    if (!ok) printf("\n  server has: %s\n  expected:   %s\n  ", text, expected);
+    free(text);
+    return ok;
+}
+
+static void test_incremental_sync(ac_lsp_pool_t *pool) {
+    TEST("incremental changes keep the server's copy in sync");
+    ac_lsp_stats_t before, after;
+    ac_lsp_stats(pool, &before);
+
+    /* Edits written and then reported, as the edit tools do */
+    static const char *const versions[] = {
+        "/* \xC3\xA9 \xF0\x9F\x98\x80 */ int target = 2; /* FIXME */\nint use(void) { return target; }\n",
+        "/* \xC3\xA9 \xF0\x9F\x98\x80 */ int target = 2;\nint extra;\nint use(void) { return target; }\n",
+        "/* \xC3\xA8 \xF0\x9F\x98\x80 */ int target = 2;\nint extra;\nint use(void) { return target; }\n",
+        "/* \xF0\x9F\x98\x81 */ int target = 2;\r\nint extra;\r\nint use(void) { return target; }\r\n",
+        "/* \xF0\x9F\x98\x81 */ int target = 2;\r\nint use(void) { return target; }\r\n",
+    };
+    for (size_t i = 0; i < sizeof(versions) / sizeof(versions[0]); i++) {
+        write_file("src/main.c", versions[i]);
+        if (ac_lsp_file_changed(pool, "src/main.c", versions[i], strlen(versions[i])) != ARC_OK) {
+            FAIL(ac_lsp_error());
+            return;
+        }
+    }
+    if (!server_line_is(pool, "src/main.c", 1, "target", "/* \xF0\x9F\x98\x81 */ int target = 2;\r") ||
+        !server_line_is(pool, "src/main.c", 2, "use", "int use(void) { return target; }\r")) {
+        FAIL("server copy differs");
+        return;
+    }
+
+    /* A change made behind the pool's back is picked up by the next query */
+    write_file("src/main.c", "int target;\nint use(void) { return target; } /* FIXME */\n");
+    ac_lsp_diagnostics_t diags;
+    if (ac_lsp_diagnostics(pool, "src/main.c", 2000, &diags) != ARC_OK) {
+        FAIL(ac_lsp_error());
+        return;
+    }
+    int ok = diags.count == 1 && diags.items[0].line == 2 && !diags.stale;
+    ac_lsp_diagnostics_free(&diags);
+
+    ac_lsp_stats(pool, &after);
+    if (!ok || !server_line_is(pool, "src/main.c", 1, "target", "int target;")) {
+        FAIL("disk change not synced");
+        return;
+    }
+    if (after.incremental_changes != before.incremental_changes + 6 || after.full_changes != before.full_changes) {
+        FAIL("expected 6 incremental changes");
+        return;
+    }
+    PASS();
+}
+
+static void test_full_sync_utf8(ac_lsp_pool_t *pool) {
+    TEST("whole-text changes and UTF-8 positions");
+    ac_lsp_locations_t locs;
+    if (ac_lsp_definition(pool, "app.py", 3, 12, &locs) != ARC_OK) {
+        FAIL(ac_lsp_error());
+        return;
+    }
+    int ok = locs.count == 1 && locs.locations[0].line == 2 && locs.locations[0].column == 11;
+    ac_lsp_locations_free(&locs);
+    if (!ok) {
+        FAIL("wrong definition");
+        return;
+    }
+
+    ac_lsp_stats_t before, after;
+    ac_lsp_stats(pool, &before);
+    const char *text = "# \xC3\xA9\xC3\xA9\ndef greet(person):\n    return person\n";
+    write_file("app.py", text);
+    ac_lsp_file_changed(pool, "app.py", text, strlen(text));
+    ac_lsp_stats(pool, &after);
+    if (after.full_changes != before.full_changes + 1 ||
+        !server_line_is(pool, "app.py", 2, "person", "def greet(person):")) {
+        FAIL("whole-text change not applied");
+        return;
+    }
+    if (after.servers != 2) {
+        FAIL("expected two running servers");
+        return;
+    }
+    PASS();
+}
+
+static void test_document_limit(void) {
+    TEST("least recently used documents are closed");
+    ac_lsp_pool_t *pool = new_pool(5000, 2);
+    if (!pool) {
+        FAIL("pool create failed");
+        return;
+    }
+    write_file("src/a.c", "int a;\n");
+    write_file("src/b.c", "int b;\n");
+    char *text = NULL;
+    const char *files[] = { "src/a.c", "src/b.c", "src/main.c" };
+    for (int i = 0; i < 3; i++) {
+        if (ac_lsp_hover(pool, files[i], 1, 5, &text) != ARC_OK) break;
+        free(text);
+        text = NULL;
+    }
+    ac_lsp_stats_t stats;
+    ac_lsp_stats(pool, &stats);
+    int ok = stats.documents == 2;
+
+    /* A deleted file is closed when reported */
+    unlink(at("src/b.c"));
+    ac_lsp_file_changed(pool, "src/b.c", NULL, 0);
+    ac_lsp_stats(pool, &stats);
+    ok = ok && stats.documents == 1;
+    ac_lsp_pool_destroy(pool);
+    if (!ok) {
+        FAIL("wrong number of open documents");
+        return;
+    }
+    PASS();
+}
+
+/*============================================================================
+ * Concurrency and Failures
+ *============================================================================*/
+
+typedef struct {
+    ac_lsp_pool_t *pool;
+    unsigned column;
+    arc_err_t err;
+    char *text;
+} hover_job_t;
+
+static void *hover_thread(void *arg) {
+    hover_job_t *job = (hover_job_t *)arg;
+    job->err = ac_lsp_hover(job->pool, "src/slow.c", 1, job->column, &job->text);
+    return NULL;
+}
+
+static void test_concurrent_requests(ac_lsp_pool_t *pool) {
+    TEST("concurrent requests share one warm server");
+    ac_lsp_stats_t before, after;
+    ac_lsp_stats(pool, &before);
+
+    /* Each slow answer takes 300 ms; in parallel, eight take about that long */
+    enum { JOBS = 8 };
+    pthread_t threads[JOBS];
+    hover_job_t jobs[JOBS];
+    long long start = now_ms();
+    for (int i = 0; i < JOBS; i++) {
+        jobs[i] = (hover_job_t){ pool, 6, ARC_OK, NULL };
+        pthread_create(&threads[i], NULL, hover_thread, &jobs[i]);
+    }
+
+    /* A quick request is answered while the slow ones wait */
+    char *fast = NULL;
+    long long fast_start = now_ms();
+    arc_err_t fast_err = ac_lsp_hover(pool, "src/slow.c", 1, 20, &fast);
+    long long fast_ms = now_ms() - fast_start;
+
+    int ok = 1;
+    for (int i = 0; i < JOBS; i++) {
+        pthread_join(threads[i], NULL);
+        ok = ok && jobs[i].err == ARC_OK && jobs[i].text && strncmp(jobs[i].text, "`slow`", 6) == 0;
+        free(jobs[i].text);
+    }
+    long long elapsed = now_ms() - start;
+    ok = ok && fast_err == ARC_OK && strncmp(fast, "`fast`", 6) == 0;
+    free(fast);
+
+    ac_lsp_stats(pool, &after);
+    if (!ok) {
+        FAIL("a request failed");
+        return;
+    }
+    if (elapsed > 1500 || fast_ms > 250) {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "requests were serialized (%lld ms total, fast one %lld ms)", elapsed, fast_ms);
+        FAIL(msg);
+        return;
+    }
+    if (after.starts != before.starts || after.requests != before.requests + JOBS + 1) {
+        FAIL("server restarted or requests miscounted");
+        return;
+    }
+    PASS();
+}
+
+static void test_timeout_and_errors(void) {
+    TEST("timeouts and error responses");
+    ac_lsp_pool_t *pool = new_pool(300, 0);
+    if (!pool) {
+        FAIL("pool create failed");
+        return;
+    }
+    const char *line = "int slow = 0; int fast = 1; int hang; int boom; int crash;";
+    char *text = NULL;
+    arc_err_t err = ac_lsp_hover(pool, "src/slow.c", 1, column_of(line, "hang", 0), &text);
+    if (err != ARC_ERR_TIMEOUT) {
+        FAIL("expected a timeout");
+        ac_lsp_pool_destroy(pool);
+        return;
+    }
+    err = ac_lsp_hover(pool, "src/slow.c", 1, column_of(line, "boom", 0), &text);
+    if (err != ARC_ERR_PROTOCOL || !strstr(ac_lsp_error(), "boom failed")) {
+        FAIL("expected the server's error");
+        ac_lsp_pool_destroy(pool);
+        return;
+    }
+    /* Still usable */
+    err = ac_lsp_hover(pool, "src/slow.c", 1, column_of(line, "fast", 0), &text);
+    int ok = err == ARC_OK && strncmp(text, "`fast`", 6) == 0;
+    free(text);
+    ac_lsp_pool_destroy(pool);
+    if (!ok) {
+        FAIL("server unusable after a timeout");
+        return;
+    }
+    PASS();
+}
+
+static void test_restart_after_crash(ac_lsp_pool_t *pool) {
+    TEST("a server that exits is restarted");
+    const char *line = "int slow = 0; int fast = 1; int hang; int boom; int crash;";
+    ac_lsp_stats_t before, after;
+    ac_lsp_stats(pool, &before);
+
+    char *text = NULL;
+    arc_err_t err = ac_lsp_hover(pool, "src/slow.c", 1, column_of(line, "crash", 0), &text);
+    if (err != ARC_ERR_IO) {
+        FAIL("expected the call to fail");
+        return;
+    }
+    err = ac_lsp_hover(pool, "src/slow.c", 1, column_of(line, "fast", 0), &text);
+    ac_lsp_stats(pool, &after);
+    int ok = err == ARC_OK && strncmp(text, "`fast`", 6) == 0;
+    free(text);
+    if (!ok || after.starts != before.starts + 1) {
+        FAIL("server not restarted");
+        return;
+    }
+    PASS();
+}
+
+static void test_errors(ac_lsp_pool_t *pool) {
+    TEST("missing servers and invalid arguments");
+    write_file("notes.txt", "hello\n");
+    write_file("data.zz", "hello\n");
+    char *text = NULL;
+    ac_lsp_locations_t locs;
+
+    if (ac_lsp_hover(pool, "notes.txt", 1, 1, &text) != ARC_ERR_NOT_FOUND ||
+        !strstr(ac_lsp_error(), "no language server")) {
+        FAIL("expected no server for .txt");
+        return;
+    }
+    if (ac_lsp_hover(pool, "data.zz", 1, 1, &text) != ARC_ERR_IO || !strstr(ac_lsp_error(), "cannot run")) {
+        FAIL("expected the missing server to fail");
+        return;
+    }
+    /* Not retried at once */
+    if (ac_lsp_hover(pool, "data.zz", 1, 1, &text) != ARC_ERR_IO) {
+        FAIL("expected the failure to be remembered");
+        return;
+    }
+    if (ac_lsp_definition(pool, "src/missing.c", 1, 1, &locs) != ARC_ERR_NOT_FOUND) {
+        FAIL("expected missing file to fail");
+        return;
+    }
+    if (ac_lsp_definition(pool, "src/main.c", 40, 1, &locs) != ARC_ERR_INVALID_ARG) {
+        FAIL("expected line past the end to fail");
+        return;
+    }
+    if (!ac_lsp_server_for_file(pool, "x/y.h") || ac_lsp_server_for_file(pool, "Makefile")) {
+        FAIL("wrong server lookup");
+        return;
+    }
+
+    ac_lsp_options_t opts = { .root = "/nonexistent/arc" };
+    ac_lsp_pool_t *bad = NULL;
+    if (ac_lsp_pool_create(&opts, &bad) != ARC_ERR_INVALID_ARG || bad) {
+        FAIL("expected invalid root to fail");
+        return;
+    }
+    PASS();
+}
+
+int main(void) {
+    printf("=== LSP Tests ===\n\n");
+
+    snprintf(g_tmp, sizeof(g_tmp), "/tmp/arc_lsp_test_XXXXXX");
+    if (!mkdtemp(g_tmp)) {
+        printf("Failed to create temp dir\n");
+        return 1;
+    }
+    char real[256];
+    if (!realpath(g_tmp, real)) {
+        printf("Failed to resolve temp dir\n");
+        return 1;
+    }
+    snprintf(g_root, sizeof(g_root), "%s", real);
+    setup_tree();
+
+    ac_lsp_pool_t *pool = new_pool(5000, 0);
+    if (!pool) {
+        printf("Failed to create pool\n");
+        return 1;
+    }
+    test_definition_and_references(pool);
+    test_hover(pool);
+    test_diagnostics(pool);
+    test_incremental_sync(pool);
+    test_full_sync_utf8(pool);
+    test_concurrent_requests(pool);
+    test_restart_after_crash(pool);
+    test_errors(pool);
+    ac_lsp_pool_destroy(pool);
+    test_document_limit();
+    test_timeout_and_errors();
+
+    char cmd[600];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", g_tmp);
+    if (system(cmd) != 0) {
+        printf("warning: could not remove %s\n", g_tmp);
+    }
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+/**
+ * @file test_md_line.c
+ * @brief Tests for the Markdown line classifier and the block parser on top of it
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "md_line.h"
+#include "md_parser.h"
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+/*============================================================================
+ * Test Cases
+ *============================================================================*/
+
+static void test_classify(void) {
+    static const struct {
+        const char* line;
+        md_line_type_t type;
+        int level;
+        const char* content;
+    } cases[] = {
+        { "",              MD_LINE_BLANK,   0, NULL },
+        { " \t ",          MD_LINE_BLANK,   0, NULL },
+        { "```python",     MD_LINE_FENCE,   0, "python" },
+        { "  ```",         MD_LINE_TEXT,    0, NULL },
+        { "# Title",       MD_LINE_HEADING, 1, "Title" },
+        { "###\t  Deep",   MD_LINE_HEADING, 3, "Deep" },
+        { "#Title",        MD_LINE_TEXT,    0, NULL },
+        { "####### x",     MD_LINE_TEXT,    0, NULL },
+        { "---",           MD_LINE_HR,      0, NULL },
+        { "- - - -",       MD_LINE_HR,      0, NULL },
+        { "___",           MD_LINE_HR,      0, NULL },
+        { "- item",        MD_LINE_BULLET,  0, "item" },
+        { "    * nested",  MD_LINE_BULLET,  0, "nested" },
+        { "+ plus",        MD_LINE_BULLET,  0, "plus" },
+        { "-- x",          MD_LINE_TEXT,    0, NULL },
+        { "> quoted",      MD_LINE_QUOTE,   0, "quoted" },
+        { "  >tight",      MD_LINE_QUOTE,   0, "tight" },
+        { "12. twelve",    MD_LINE_ORDERED, 0, "twelve" },
+        { "12.x",          MD_LINE_TEXT,    0, NULL },
+        { "| a | b |",     MD_LINE_TEXT,    0, NULL },
+    };
+
+    TEST("line types and content offsets");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        md_line_t info;
+        const char* line = cases[i].line;
+        md_classify_line(line, strlen(line), &info);
+
+        int ok = info.type == cases[i].type && info.level == cases[i].level;
+        if (ok && cases[i].content) {
+            ok = strcmp(line + info.content, cases[i].content) == 0;
+        }
+        if (!ok) {
+            FAIL(line);
+            return;
+        }
+    }
+    PASS();
+}
+
+static void test_table_sep(void) {
+    static const struct {
+        const char* line;
+        int sep;
+    } cases[] = {
+        { "|---|---|",        1 },
+        { "| :-- | --: |",    1 },
+        { "---|:-:",          1 },
+        { "---",              1 },
+        { "|",                0 },
+        { "||",               0 },
+        { "| a | b |",        0 },
+        { "|--x|",            0 },
+    };
+
+    TEST("table separator rows");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        md_line_t info;
+        md_classify_line(cases[i].line, strlen(cases[i].line), &info);
+        if (info.table_sep != cases[i].sep) {
+            FAIL(cases[i].line);
+            return;
+        }
+    }
+    PASS();
+}
+
+static void test_parse_blocks(void) {
+    const char* doc =
+        "# Heading\n"
+        "\n"
+        "- one\n"
+        "  - two\n"
+        "1. first\n"
+        "> quote\n"
+        "| a | b |\n"
+        "|---|--:|\n"
+        "| 1 | 2 |\n"
+        "\n"
+        "```c\n"
+        "# not a heading\n"
+        "```\n"
+        "----\n"
+        "text\n";
+    static const md_block_type_t expect[] = {
+        MD_BLOCK_HEADING, MD_BLOCK_LIST, MD_BLOCK_LIST, MD_BLOCK_QUOTE,
+        MD_BLOCK_TABLE, MD_BLOCK_CODE, MD_BLOCK_HR, MD_BLOCK_PARAGRAPH,
+    };
+
+    TEST("block parser");
+    md_block_token_t* tokens = md_parse(doc);
+    md_block_token_t* tok = tokens;
+    size_t n = 0;
+    int ok = 1;
+    for (; tok && n < sizeof(expect) / sizeof(expect[0]); tok = tok->next, n++) {
+        if (tok->type != expect[n]) ok = 0;
+        if (tok->type == MD_BLOCK_HEADING && tok->data.heading.level != 1) ok = 0;
+        if (tok->type == MD_BLOCK_TABLE &&
+            (tok->data.table.col_count != 2 || tok->data.table.row_count != 1 ||
+             tok->data.table.aligns[1] != MD_ALIGN_RIGHT)) ok = 0;
+        if (tok->type == MD_BLOCK_CODE &&
+            strcmp(tok->data.code.code, "# not a heading\n") != 0) ok = 0;
+        if (n == 1 && (!tok->data.list.items || !tok->data.list.items->next ||
+                       tok->data.list.items->next->indent_level != 1)) ok = 0;
+    }
+    if (tok || n != sizeof(expect) / sizeof(expect[0])) ok = 0;
+    md_free_tokens(tokens);
+
+    if (ok) {
+        PASS();
+    } else {
+        FAIL("unexpected block sequence");
+    }
+}
+
+int main(void) {
+    printf("=== Markdown Line Classifier Tests ===\n\n");
+
+    test_classify();
+    test_table_sep();
+    test_parse_blocks();
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file test_md_output.c
+ * @brief Tests for batched Markdown output and SGR elimination
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "md_output.h"
+#include "md_stream.h"
+#include "md_style.h"
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+typedef struct {
+    char buf[8192];
+    size_t len;
+    int writes;
+} capture_t;
+
+static void capture_output(const char* text, size_t len, void* userdata) {
+    capture_t* cap = (capture_t*)userdata;
+    cap->writes++;
+    if (cap->len + len < sizeof(cap->buf)) {
+        memcpy(cap->buf + cap->len, text, len);
+        cap->len += len;
+        cap->buf[cap->len] = '\0';
+    }
+}
+
+/* Run fragments through a fresh buffer and compare the flushed output */
+static int check_sgr(const char* const* fragments, const char* expect) {
+    capture_t cap;
+    md_outbuf_t out;
+    memset(&cap, 0, sizeof(cap));
+    md_outbuf_init(&out, capture_output, &cap);
+    for (size_t i = 0; fragments[i]; i++) {
+        md_outbuf_write(&out, fragments[i], strlen(fragments[i]));
+    }
+    md_outbuf_flush(&out);
+    md_outbuf_free(&out);
+
+    if (strcmp(cap.buf, expect) != 0) {
+        for (char* p = cap.buf; *p; p++) {
+            if (*p == '\033') *p = 'E';
+        }
+        FAIL(cap.buf);
+        return 0;
+    }
+    return 1;
+}
+
+/*============================================================================
+ * Test Cases
+ *============================================================================*/
+
+static void test_sgr_elimination(void) {
+    static const char* plain[] = { "no ", "style\n", NULL };
+    static const char* resets[] = {
+        MD_STYLE_RESET, "a", MD_STYLE_RESET, MD_STYLE_RESET, "b", NULL
+    };
+    static const char* merged[] = {
+        MD_STYLE_BOLD, MD_COLOR_BRIGHT_YELLOW, "x", MD_STYLE_RESET, NULL
+    };
+    static const char* repeated[] = {
+        MD_COLOR_BRIGHT_BLACK, "|", MD_STYLE_RESET, MD_COLOR_BRIGHT_BLACK, "|", MD_STYLE_RESET, NULL
+    };
+    static const char* additive[] = {
+        MD_STYLE_RESET, MD_COLOR_RED, "x", MD_STYLE_BOLD, "y", MD_STYLE_RESET, "\n", NULL
+    };
+    static const char* removal[] = {
+        MD_STYLE_RESET, MD_STYLE_BOLD MD_COLOR_RED, "x", MD_STYLE_RESET MD_COLOR_RED, "y", NULL
+    };
+    static const char* extended[] = {
+        "\033[38;5;208m", "x", "\033[0;48;2;1;2;3m", "y", MD_STYLE_RESET, NULL
+    };
+
+    TEST("redundant SGR sequences are merged or dropped");
+    int ok = check_sgr(plain, "no style\n") &&
+             check_sgr(resets, "\033[0mab") &&
+             check_sgr(merged, "\033[0;1;93mx\033[0m") &&
+             check_sgr(repeated, "\033[0;90m||\033[0m") &&
+             check_sgr(additive, "\033[0;31mx\033[1my\033[0m\n") &&
+             check_sgr(removal, "\033[0;1;31mx\033[0;31my") &&
+             check_sgr(extended, "\033[0;38;5;208mx\033[0;48;2;1;2;3my\033[0m");
+    if (ok) PASS();
+}
+
+static void test_passthrough(void) {
+    static const char* cursor[] = {
+        MD_COLOR_RED, "\033[3A\r\033[J", "x", NULL
+    };
+    static const char* link[] = {
+        MD_HYPERLINK_START "http://x" MD_HYPERLINK_SEP, "t", MD_HYPERLINK_END, NULL
+    };
+    static const char* untracked[] = {
+        "\033[53m", "x", MD_STYLE_RESET, "y", NULL
+    };
+
+    TEST("other escape sequences pass through");
+    int ok = check_sgr(cursor, "\033[0;31m\033[3A\r\033[Jx") &&
+             check_sgr(link, "\033]8;;http://x\033\\t\033]8;;\033\\") &&
+             check_sgr(untracked, "\033[53mx\033[0my");
+    if (ok) PASS();
+}
+
+static void test_stream_batching(void) {
+    capture_t cap;
+    memset(&cap, 0, sizeof(cap));
+    md_stream_t* stream = md_stream_new();
+    md_stream_set_output(stream, capture_output, &cap);
+
+    TEST("stream output is written once per feed");
+    md_stream_feed_str(stream, "# Title\n\nSome **bold** text.\n- a\n- b\n```\ncode\n```\n");
+    int ok = cap.writes == 1 && strstr(cap.buf, "code") != NULL;
+
+    /* A partial line produces nothing to write */
+    md_stream_feed_str(stream, "tail");
+    ok = ok && cap.writes == 1;
+    md_stream_finish(stream);
+    ok = ok && cap.writes == 2 && strstr(cap.buf, "tail") != NULL;
+
+    /* Size threshold of zero: every fragment is written immediately */
+    md_stream_set_flush_policy(stream, 0, 0);
+    int before = cap.writes;
+    md_stream_feed_str(stream, "**x**\n");
+    ok = ok && cap.writes > before + 1;
+    md_stream_free(stream);
+
+    if (ok) {
+        PASS();
+    } else {
+        FAIL("unexpected write count");
+    }
+}
+
+int main(void) {
+    printf("=== Markdown Output Tests ===\n\n");
+
+    test_sgr_elimination();
+    test_passthrough();
+    test_stream_batching();
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
@@ -0,0 +1,325 @@
+/**
+ * @file test_md_stream.c
+ * @brief Tests for incremental rendering in the Markdown stream renderer
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "md_parser.h"
+#include "md_stream.h"
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+typedef struct {
+    char buf[8192];
+    size_t len;
+} capture_t;
+
+static void capture_output(const char* text, size_t len, void* userdata) {
+    capture_t* cap = (capture_t*)userdata;
+    if (cap->len + len < sizeof(cap->buf)) {
+        memcpy(cap->buf + cap->len, text, len);
+        cap->len += len;
+        cap->buf[cap->len] = '\0';
+    }
+}
+
+static md_stream_t* new_captured_stream(capture_t* cap) {
+    memset(cap, 0, sizeof(*cap));
+    md_stream_t* stream = md_stream_new();
+    md_stream_set_output(stream, capture_output, cap);
+    return stream;
+}
+
+/*============================================================================
+ * Test Cases
+ *============================================================================*/
+
+static void test_code_lines_stream(void) {
+    capture_t cap;
+    md_stream_t* stream = new_captured_stream(&cap);
+    md_stream_set_code_mode(stream, MD_CODE_STREAM);
+
+    TEST("code lines are emitted before the closing fence");
+    md_stream_feed_str(stream, "```c\nint a;\nint b;\n");
+    int ok = strstr(cap.buf, "int a;") && strstr(cap.buf, "int b;");
+
+    /* Partial line is held back until its newline */
+    md_stream_feed_str(stream, "int c");
+    ok = ok && !strstr(cap.buf, "int c");
+
+    md_stream_feed_str(stream, ";\n```\n");
+    ok = ok && strstr(cap.buf, "int c;") && strstr(cap.buf, "\xe2\x94\x94");   /* bottom corner */
+
+    /* No cursor movement when writing to a callback */
+    ok = ok && !strchr(cap.buf, '\r');
+    md_stream_free(stream);
+
+    if (ok) {
+        PASS();
+    } else {
+        FAIL(cap.buf);
+    }
+}
+
+static void test_code_buffered(void) {
+    capture_t cap;
+    md_stream_t* stream = new_captured_stream(&cap);
+    md_stream_set_code_mode(stream, MD_CODE_BUFFERED);
+
+    TEST("buffered mode renders at the closing fence");
+    md_stream_feed_str(stream, "```\nx = 1\n");
+    int ok = cap.len == 0;
+    md_stream_feed_str(stream, "```\n");
+    ok = ok && strstr(cap.buf, "x = 1") && strstr(cap.buf, "\xe2\x94\x90");    /* top-right corner */
+    md_stream_free(stream);
+
+    if (ok) {
+        PASS();
+    } else {
+        FAIL("unexpected output");
+    }
+}
+
+static void test_code_default_mode(void) {
+    capture_t cap;
+    md_stream_t* stream = new_captured_stream(&cap);
+
+    TEST("code blocks are buffered by default without cursor control");
+    md_stream_feed_str(stream, "```\nx = 1\n");
+    int ok = cap.len == 0;
+    md_stream_feed_str(stream, "```\n");
+    ok = ok && strstr(cap.buf, "\xe2\x94\x90") && !strchr(cap.buf, '\r');   /* closed frame */
+    md_stream_free(stream);
+
+    stream = new_captured_stream(&cap);
+    md_stream_set_cursor_control(stream, 1);
+    md_stream_feed_str(stream, "```\nx = 1\n");
+    ok = ok && strstr(cap.buf, "x = 1");
+    md_stream_free(stream);
+
+    if (ok) {
+        PASS();
+    } else {
+        FAIL(cap.buf);
+    }
+}
+
+static void test_code_fixup(void) {
+    capture_t cap;
+    md_stream_t* stream = new_captured_stream(&cap);
+    md_stream_set_cursor_control(stream, 1);
+
+    TEST("cursor control redraws the frame at the final width");
+    md_stream_feed_str(stream, "```\nab\nabcd\n```\n");
+    /* Up over two lines plus the top border, then close each line */
+    int ok = strstr(cap.buf, "\033[3A\r") != NULL &&
+             strstr(cap.buf, "\033[5G") != NULL &&
+             strstr(cap.buf, "\033[7G") != NULL;
+    md_stream_free(stream);
+
+    if (ok) {
+        PASS();
+    } else {
+        FAIL("missing cursor sequences");
+    }
+}
+
+static const char* s_table =
+    "| Key | Value |\n"
+    "|-----|------:|\n"
+    "| a   | 1     |\n"
+    "| b   | 22    |\n"
+    "| c   | 333   |\n";
+
+/* Batch render of a document through the same capture callback */
+static void render_batch(capture_t* cap, const char* markdown) {
+    md_renderer_t renderer;
+    memset(cap, 0, sizeof(*cap));
+    md_renderer_init(&renderer);
+    md_renderer_set_output(&renderer, capture_output, cap);
+    md_block_token_t* tokens = md_parse(markdown);
+    md_render_blocks(&renderer, tokens);
+    md_free_tokens(tokens);
+}
+
+/* Drop SGR sequences: batched output merges and elides them */
+static void strip_sgr(char* text) {
+    char* out = text;
+    for (const char* p = text; *p; ) {
+        if (p[0] == '\033' && p[1] == '[') {
+            const char* q = p + 2;
+            while ((*q >= '0' && *q <= '9') || *q == ';') q++;
+            if (*q == 'm') {
+                p = q + 1;
+                continue;
+            }
+        }
+        *out++ = *p++;
+    }
+    *out = '\0';
+}
+
+static size_t count_substr(const char* haystack, const char* needle) {
+    size_t n = 0;
+    for (const char* p = strstr(haystack, needle); p; p = strstr(p + 1, needle)) n++;
+    return n;
+}
+
+static void test_table_progressive(void) {
+    capture_t cap;
+    md_stream_t* stream = new_captured_stream(&cap);
+
+    TEST("table rows are emitted before the table ends");
+    md_stream_feed_str(stream, "| Key | Value |\n|-----|------:|\n| a   | 1     |\n");
+    int ok = cap.len == 0;     /* Early rows are held to size the columns */
+    md_stream_feed_str(stream, "| b   | 22    |\n| c   | 333   |\n");
+    ok = ok && strstr(cap.buf, "333") && !strstr(cap.buf, "\xe2\x94\x94");
+    md_stream_feed_str(stream, "| d   | 4     |\n");
+    ok = ok && strstr(cap.buf, " d ");
+    md_stream_feed_str(stream, "\n");
+    ok = ok && strstr(cap.buf, "\xe2\x94\x94");     /* bottom corner */
+    md_stream_free(stream);
+
+    if (ok) {
+        PASS();
+    } else {
+        FAIL(cap.buf);
+    }
+}
+
+static void test_table_matches_batch(void) {
+    capture_t cap, batch;
+    md_stream_t* stream = new_captured_stream(&cap);
+
+    TEST("progressive table without re-layout matches the batch render");
+    md_stream_feed_str(stream, s_table);
+    md_stream_finish(stream);
+    md_stream_free(stream);
+    render_batch(&batch, s_table);
+    strip_sgr(cap.buf);
+    strip_sgr(batch.buf);
+
+    if (strcmp(cap.buf, batch.buf) == 0) {
+        PASS();
+    } else {
+        FAIL(cap.buf);
+    }
+}
+
+static void test_table_relayout(void) {
+    capture_t cap;
+    md_stream_t* stream = new_captured_stream(&cap);
+
+    TEST("a wider row re-lays out the columns with a divider");
+    md_stream_feed_str(stream, s_table);
+    md_stream_feed_str(stream, "| much longer key | 4 |\n\n");
+    /* Header separator plus one re-layout divider */
+    int ok = count_substr(cap.buf, "\xe2\x94\x9c") == 2 &&
+             strstr(cap.buf, "much longer key") != NULL &&
+             !strchr(cap.buf, '\r');
+    md_stream_free(stream);
+
+    if (ok) {
+        PASS();
+    } else {
+        FAIL(cap.buf);
+    }
+}
+
+static void test_table_finalize(void) {
+    capture_t cap, batch;
+    md_stream_t* stream = new_captured_stream(&cap);
+    md_stream_set_cursor_control(stream, 1);
+
+    TEST("cursor control redraws a re-laid out table exactly");
+    md_stream_feed_str(stream, s_table);
+    md_stream_feed_str(stream, "| much longer key | 4 |\n\n");
+    md_stream_free(stream);
+
+    /* Top, header, separator, 3 rows, divider, row: 8 lines to go back over */
+    strip_sgr(cap.buf);
+    const char* redraw = strstr(cap.buf, "\033[8A\r\033[J");
+    char doc[512];
+    snprintf(doc, sizeof(doc), "%s| much longer key | 4 |\n", s_table);
+    render_batch(&batch, doc);
+    strip_sgr(batch.buf);
+    int ok = redraw && strcmp(redraw + strlen("\033[8A\r\033[J"), batch.buf) == 0;
+
+    if (ok) {
+        PASS();
+    } else {
+        FAIL("missing or inexact redraw");
+    }
+}
+
+static void test_table_buffered(void) {
+    capture_t cap, batch;
+    md_stream_t* stream = new_captured_stream(&cap);
+    md_stream_set_table_mode(stream, MD_TABLE_BUFFERED);
+
+    TEST("buffered tables and lone pipe lines");
+    md_stream_feed_str(stream, s_table);
+    int ok = cap.len == 0;
+    md_stream_finish(stream);
+    render_batch(&batch, s_table);
+    strip_sgr(cap.buf);
+    strip_sgr(batch.buf);
+    ok = ok && strcmp(cap.buf, batch.buf) == 0;
+
+    /* A pipe line without a separator after it is a paragraph */
+    cap.len = 0;
+    cap.buf[0] = '\0';
+    md_stream_feed_str(stream, "a | b\ntext\n");
+    ok = ok && strstr(cap.buf, "a | b\n\ntext\n\n") != NULL;
+    md_stream_free(stream);
+
+    if (ok) {
+        PASS();
+    } else {
+        FAIL(cap.buf);
+    }
+}
+
+int main(void) {
+    printf("=== Markdown Stream Tests ===\n\n");
+
+    test_code_lines_stream();
+    test_code_buffered();
+    test_code_default_mode();
+    test_code_fixup();
+    test_table_progressive();
+    test_table_matches_batch();
+    test_table_relayout();
+    test_table_finalize();
+    test_table_buffered();
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
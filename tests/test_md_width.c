@@ -0,0 +1,126 @@
+/**
+ * @file test_md_width.c
+ * @brief Tests for the Markdown display-width engine
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "md_utils.h"
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+typedef struct {
+    const char* text;
+    int width;
+} width_case_t;
+
+static void run_cases(const char* name, const width_case_t* cases, size_t count) {
+    TEST(name);
+    for (size_t i = 0; i < count; i++) {
+        int w = md_utf8_display_width(cases[i].text);
+        if (w != cases[i].width) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "\"%s\": got %d, want %d", cases[i].text, w, cases[i].width);
+            FAIL(msg);
+            return;
+        }
+    }
+    PASS();
+}
+
+/*============================================================================
+ * Test Cases
+ *============================================================================*/
+
+static void test_basic(void) {
+    static const width_case_t cases[] = {
+        { "",                                   0 },
+        { "a",                                  1 },
+        { "int main(void) { return 0; }",       28 },
+        { "caf\xc3\xa9",                        4 },    /* precomposed */
+        { "cafe\xcc\x81",                       4 },    /* combining acute */
+        { "\xe4\xbd\xa0\xe5\xa5\xbd",           4 },    /* CJK */
+        { "\xea\xb0\x80",                       2 },    /* Hangul syllable */
+        { "\xef\xbc\xa1",                       2 },    /* fullwidth A */
+        { "\xe2\x94\x80\xe2\x94\x82",           2 },    /* box drawing */
+        { "a\xe2\x80\x8b" "b",                  2 },    /* zero-width space */
+        { "\xf0\xa0\x80\x80",                   2 },    /* CJK Extension B */
+        { "\xff" "a",                           2 },    /* invalid byte */
+    };
+    run_cases("ASCII, CJK and combining marks", cases, sizeof(cases) / sizeof(cases[0]));
+}
+
+static void test_emoji(void) {
+    static const width_case_t cases[] = {
+        { "\xf0\x9f\x98\x80",                                   2 },    /* grinning face */
+        { "\xe2\x9d\xa4",                                       1 },    /* heart, text style */
+        { "\xe2\x9d\xa4\xef\xb8\x8f",                           2 },    /* heart + VS16 */
+        { "\xf0\x9f\x91\x8d\xf0\x9f\x8f\xbd",                   2 },    /* thumbs up + skin tone */
+        { "\xf0\x9f\x91\xa8\xe2\x80\x8d\xf0\x9f\x91\xa9\xe2\x80\x8d\xf0\x9f\x91\xa7",
+                                                                2 },    /* family ZWJ sequence */
+        { "\xf0\x9f\x8f\xb3\xef\xb8\x8f\xe2\x80\x8d\xf0\x9f\x8c\x88",
+                                                                2 },    /* rainbow flag */
+        { "\xf0\x9f\x87\xa9\xf0\x9f\x87\xaa",                   2 },    /* flag: two regional indicators */
+        { "1\xef\xb8\x8f\xe2\x83\xa3",                          2 },    /* keycap one */
+        { "ok \xe2\x9c\x85 done",                               10 },
+    };
+    run_cases("emoji sequences", cases, sizeof(cases) / sizeof(cases[0]));
+}
+
+static void test_length_bounded(void) {
+    TEST("length-bounded width and ASCII runs");
+    char buf[256];
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = (char)('a' + i % 26);
+    }
+    int ok = md_utf8_display_width_n(buf, sizeof(buf)) == 256;
+
+    /* Multibyte character inside a long ASCII run, and one cut short */
+    memcpy(buf + 37, "\xe4\xbd\xa0", 3);
+    ok = ok && md_utf8_display_width_n(buf, sizeof(buf)) == 255;
+    ok = ok && md_utf8_display_width_n(buf, 39) == 38;
+    ok = ok && md_char_width(0x4F60) == 2 && md_char_width(0x0301) == 0 && md_char_width('x') == 1;
+
+    if (ok) {
+        PASS();
+    } else {
+        FAIL("unexpected width");
+    }
+}
+
+int main(void) {
+    printf("=== Markdown Display Width Tests ===\n\n");
+
+    test_basic();
+    test_emoji();
+    test_length_bounded();
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
@@ -0,0 +1,414 @@
+/**
+ * @file test_patch.c
+ * @brief Tests for staged replacements, unified diffs and atomic commits
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <arc/patch.h>
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+static char g_root[256];
+
+static const char *at(const char *rel) {
+    static char path[512];
+    snprintf(path, sizeof(path), "%s/%s", g_root, rel);
+    return path;
+}
+
+static void write_text(const char *rel, const char *text) {
+    FILE *f = fopen(at(rel), "wb");
+    if (f) {
+        fputs(text, f);
+        fclose(f);
+    }
+}
+
+/* File contents equal expected (NULL = file must not exist) */
+static int file_is(const char *rel, const char *expected) {
+    FILE *f = fopen(at(rel), "rb");
+    if (!f) return expected == NULL;
+    static char buf[8192];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    return expected && strcmp(buf, expected) == 0;
+}
+
+/*============================================================================
+ * Replacements
+ *============================================================================*/
+
+static void test_replace(void) {
+    TEST("replace unique, ambiguous and all");
+    write_text("r.txt", "int a = 1;\nint b = 1;\nint c = 2;\n");
+    ac_patch_t *p = ac_patch_create(g_root);
+    size_t n = 0;
+    int ok = ac_patch_replace(p, "r.txt", "= 1", "= 3", 0, &n) == ARC_ERR_INVALID_ARG &&
+             strstr(ac_patch_error(p), "2 times") != NULL &&
+             ac_patch_replace(p, "r.txt", "= 9", "= 3", 0, &n) == ARC_ERR_NOT_FOUND &&
+             ac_patch_replace(p, "r.txt", "x", "x", 0, &n) == ARC_ERR_INVALID_ARG &&
+             ac_patch_replace(p, "missing.txt", "a", "b", 0, &n) == ARC_ERR_NOT_FOUND &&
+             ac_patch_replace(p, "r.txt", "= 1", "= 3", 1, &n) == ARC_OK && n == 2 &&
+             ac_patch_replace(p, "r.txt", "int c = 2;\n", "int c = 2;\nint d = 4;\n", 0, &n) == ARC_OK &&
+             n == 1 && ac_patch_file_count(p) == 1;
+
+    /* Nothing on disk before commit */
+    ok = ok && file_is("r.txt", "int a = 1;\nint b = 1;\nint c = 2;\n") &&
+         ac_patch_commit(p) == ARC_OK &&
+         file_is("r.txt", "int a = 3;\nint b = 3;\nint c = 2;\nint d = 4;\n");
+
+    ac_patch_file_info_t info;
+    ac_patch_file_info(p, 0, &info);
+    ok = ok && info.changes == 2 && !info.created && info.lines_added == 4 && info.lines_removed == 3;
+    ac_patch_free(p);
+    if (ok) PASS(); else FAIL("unexpected result");
+}
+
+static void test_replace_create(void) {
+    TEST("replace with empty old string creates");
+    write_text("exists.txt", "x\n");
+    ac_patch_t *p = ac_patch_create(g_root);
+    int ok = ac_patch_replace(p, "exists.txt", "", "y\n", 0, NULL) == ARC_ERR_INVALID_ARG &&
+             ac_patch_replace(p, "new/dir/made.txt", "", "hello\n", 0, NULL) == ARC_OK &&
+             ac_patch_replace(p, "new/dir/made.txt", "hello", "hello world", 0, NULL) == ARC_OK &&
+             ac_patch_file_count(p) == 1 && ac_patch_commit(p) == ARC_OK &&
+             file_is("new/dir/made.txt", "hello world\n");
+    ac_patch_file_info_t info;
+    ac_patch_file_info(p, 0, &info);
+    ok = ok && info.created;
+    ac_patch_free(p);
+    if (ok) PASS(); else FAIL("unexpected result");
+}
+
+/*============================================================================
+ * Diffs
+ *============================================================================*/
+
+static void test_multi_file_diff(void) {
+    TEST("multi-file git diff");
+    write_text("one.c", "a\nb\nc\nd\ne\nf\ng\nh\ni\nj\n");
+    write_text("two.c", "alpha\nbeta\ngamma\n");
+    const char *diff =
+        "diff --git a/one.c b/one.c\n"
+        "index 111..222 100644\n"
+        "--- a/one.c\n"
+        "+++ b/one.c\n"
+        "@@ -1,3 +1,3 @@\n"
+        " a\n"
+        "-b\n"
+        "+B\n"
+        " c\n"
+        "@@ -8,3 +8,4 @@\n"
+        " h\n"
+        " i\n"
+        "+i2\n"
+        " j\n"
+        "diff --git a/two.c b/two.c\n"
+        "--- a/two.c\n"
+        "+++ b/two.c\n"
+        "@@ -1,3 +1,2 @@\n"
+        " alpha\n"
+        "-beta\n"
+        " gamma\n";
+    ac_patch_t *p = ac_patch_create(g_root);
+    int ok = ac_patch_apply_diff(p, diff) == ARC_OK && ac_patch_file_count(p) == 2 &&
+             ac_patch_commit(p) == ARC_OK &&
+             file_is("one.c", "a\nB\nc\nd\ne\nf\ng\nh\ni\ni2\nj\n") &&
+             file_is("two.c", "alpha\ngamma\n");
+    ac_patch_file_info_t info;
+    ac_patch_file_info(p, 0, &info);
+    ok = ok && info.changes == 2 && info.fuzzy == 0 && info.lines_added == 2 && info.lines_removed == 1;
+    ac_patch_free(p);
+    if (ok) PASS(); else FAIL("unexpected result");
+}
+
+static void test_fuzzy_hunks(void) {
+    TEST("offset, whitespace and context fuzz");
+    write_text("fuzz.py",
+               "# header\n"
+               "# added later\n"
+               "# and more\n"
+               "def f(x):\n"
+               "    y = x + 1\n"
+               "    return y\n"
+               "\n"
+               "def g(x):\n"
+               "    return x * 2\n"
+               "    # tail\n");
+    /* Wrong line numbers, tabs instead of spaces, and a stale last context line */
+    const char *diff =
+        "--- fuzz.py\n"
+        "+++ fuzz.py\n"
+        "@@ -1,3 +1,3 @@\n"
+        " def f(x):\n"
+        "-\ty = x + 1\n"
+        "+    y = x + 2\n"
+        " \treturn y\n"
+        "@@ -6,3 +6,3 @@\n"
+        " def g(x):\n"
+        "-    return x * 2\n"
+        "+    return x * 3\n"
+        "     # stale comment\n";
+    ac_patch_t *p = ac_patch_create(g_root);
+    arc_err_t err = ac_patch_apply_diff(p, diff);
+    ac_patch_file_info_t info;
+    ac_patch_file_info(p, 0, &info);
+    int ok = err == ARC_OK && info.fuzzy == 2 && ac_patch_commit(p) == ARC_OK &&
+             file_is("fuzz.py",
+                     "# header\n"
+                     "# added later\n"
+                     "# and more\n"
+                     "def f(x):\n"
+                     "    y = x + 2\n"
+                     "    return y\n"
+                     "\n"
+                     "def g(x):\n"
+                     "    return x * 3\n"
+                     "    # tail\n");
+    ac_patch_free(p);
+    if (ok) PASS(); else FAIL("hunks not placed");
+}
+
+static void test_all_or_nothing(void) {
+    TEST("failing hunk stages nothing");
+    write_text("keep1.txt", "one\ntwo\n");
+    write_text("keep2.txt", "three\nfour\n");
+    const char *diff =
+        "--- a/keep1.txt\n"
+        "+++ b/keep1.txt\n"
+        "@@ -1,2 +1,2 @@\n"
+        "-one\n"
+        "+ONE\n"
+        " two\n"
+        "--- a/keep2.txt\n"
+        "+++ b/keep2.txt\n"
+        "@@ -1,2 +1,2 @@\n"
+        "-nothing like this\n"
+        "+FOUR\n"
+        " four\n";
+    ac_patch_t *p = ac_patch_create(g_root);
+    int ok = ac_patch_replace(p, "keep1.txt", "two", "2", 0, NULL) == ARC_OK &&
+             ac_patch_apply_diff(p, diff) == ARC_ERR_NOT_FOUND &&
+             strstr(ac_patch_error(p), "keep2.txt") != NULL &&
+             ac_patch_file_count(p) == 1 &&
+             ac_patch_apply_diff(p, "not a diff\n") == ARC_ERR_PARSE &&
+             ac_patch_commit(p) == ARC_OK &&
+             file_is("keep1.txt", "one\n2\n") && file_is("keep2.txt", "three\nfour\n");
+    ac_patch_free(p);
+    if (ok) PASS(); else FAIL("partial diff staged");
+}
+
+static void test_create_delete(void) {
+    TEST("create and delete via /dev/null");
+    write_text("old.txt", "bye\n");
+    const char *diff =
+        "--- /dev/null\n"
+        "+++ b/sub/created.txt\n"
+        "@@ -0,0 +1,2 @@\n"
+        "+hello\n"
+        "+world\n"
+        "\\ No newline at end of file\n"
+        "--- a/old.txt\n"
+        "+++ /dev/null\n"
+        "@@ -1 +0,0 @@\n"
+        "-bye\n";
+    ac_patch_t *p = ac_patch_create(g_root);
+    int ok = ac_patch_apply_diff(p, diff) == ARC_OK && ac_patch_commit(p) == ARC_OK &&
+             file_is("sub/created.txt", "hello\nworld") && file_is("old.txt", NULL);
+    ac_patch_file_info_t a, b;
+    ac_patch_file_info(p, 0, &a);
+    ac_patch_file_info(p, 1, &b);
+    ok = ok && a.created && !a.deleted && b.deleted && !b.created;
+    ac_patch_free(p);
+    if (ok) PASS(); else FAIL("unexpected result");
+}
+
+static void test_crlf(void) {
+    TEST("CRLF files keep their line endings");
+    write_text("win.txt", "one\r\ntwo\r\nthree\r\n");
+    const char *diff =
+        "--- win.txt\n"
+        "+++ win.txt\n"
+        "@@ -1,3 +1,4 @@\n"
+        " one\n"
+        "-two\n"
+        "+2\n"
+        "+2.5\n"
+        " three\n";
+    ac_patch_t *p = ac_patch_create(g_root);
+    int ok = ac_patch_apply_diff(p, diff) == ARC_OK && ac_patch_commit(p) == ARC_OK &&
+             file_is("win.txt", "one\r\n2\r\n2.5\r\nthree\r\n");
+    ac_patch_free(p);
+    if (ok) PASS(); else FAIL("line endings changed");
+}
+
+/*============================================================================
+ * Commit
+ *============================================================================*/
+
+static void test_conflict(void) {
+    TEST("conflict leaves every file untouched");
+    write_text("c1.txt", "first\n");
+    write_text("c2.txt", "second\n");
+    chmod(at("c1.txt"), 0755);
+    ac_patch_t *p = ac_patch_create(g_root);
+    int ok = ac_patch_replace(p, "c1.txt", "first", "FIRST", 0, NULL) == ARC_OK &&
+             ac_patch_replace(p, "c2.txt", "second", "SECOND", 0, NULL) == ARC_OK;
+
+    /* Someone else edits c2 in the meantime */
+    write_text("c2.txt", "second, edited elsewhere\n");
+    struct timeval tv[2] = { { 2000, 0 }, { 2000, 0 } };
+    utimes(at("c2.txt"), tv);
+
+    ok = ok && ac_patch_commit(p) == ARC_ERR_INVALID_STATE &&
+         strstr(ac_patch_error(p), "c2.txt") != NULL &&
+         file_is("c1.txt", "first\n") && file_is("c2.txt", "second, edited elsewhere\n");
+    ac_patch_free(p);
+
+    /* Mode survives a rewrite */
+    p = ac_patch_create(g_root);
+    struct stat st;
+    ok = ok && ac_patch_replace(p, "c1.txt", "first", "FIRST", 0, NULL) == ARC_OK &&
+         ac_patch_commit(p) == ARC_OK && ac_patch_commit(p) == ARC_ERR_INVALID_STATE &&
+         stat(at("c1.txt"), &st) == 0 && (st.st_mode & 0777) == 0755 && file_is("c1.txt", "FIRST\n");
+    ac_patch_free(p);
+    if (ok) PASS(); else FAIL("unexpected result");
+}
+
+static void test_failed_write(void) {
+    TEST("failed write leaves every file untouched");
+    write_text("ok.txt", "ok\n");
+    write_text("blocker", "a file, not a directory\n");
+    ac_patch_t *p = ac_patch_create(g_root);
+    int ok = ac_patch_replace(p, "ok.txt", "ok", "changed", 0, NULL) == ARC_OK &&
+             ac_patch_replace(p, "blocker/new.txt", "", "x\n", 0, NULL) == ARC_OK &&
+             ac_patch_commit(p) == ARC_ERR_IO && strstr(ac_patch_error(p), "new.txt") != NULL &&
+             file_is("ok.txt", "ok\n") && file_is("blocker", "a file, not a directory\n");
+    ac_patch_free(p);
+    if (ok) PASS(); else FAIL("unexpected result");
+}
+
+static void test_file_cache(void) {
+    TEST("staging from a file cache");
+    write_text("cached.txt", "cached one\n");
+    ac_textfile_cache_options_t opts = { .watch = 1 };
+    ac_textfile_cache_t *cache = ac_textfile_cache_create(&opts);
+    ac_textfile_t *f = NULL;
+    ac_textfile_open(cache, at("cached.txt"), &f);
+    ac_textfile_release(f);
+
+    ac_patch_t *p = ac_patch_create(NULL);
+    ac_patch_set_file_cache(p, cache);
+    int ok = ac_patch_replace(p, at("cached.txt"), "one", "two", 0, NULL) == ARC_OK;
+    ac_textfile_cache_stats_t st;
+    ac_textfile_cache_stats(cache, &st);
+    ok = ok && st.hits == 1 && ac_patch_commit(p) == ARC_OK;
+    ac_patch_free(p);
+
+    /* The written file is not served from the cache any more */
+    ac_textfile_cache_stats(cache, &st);
+    ok = ok && st.files == 0 && ac_textfile_open(cache, at("cached.txt"), &f) == ARC_OK &&
+         ac_textfile_size(f) == strlen("cached two\n") &&
+         memcmp(ac_textfile_data(f), "cached two\n", ac_textfile_size(f)) == 0;
+    ac_textfile_release(f);
+    ac_textfile_cache_destroy(cache);
+    if (ok) PASS(); else FAIL("unexpected result");
+}
+
+/* Refuses paths containing "secret", counting what it was asked about */
+static int refuse_secrets(const char *path, void *user_data) {
+    (*(int *)user_data)++;
+    return strstr(path, "secret") == NULL;
+}
+
+static void test_path_check(void) {
+    TEST("path check runs before files are read");
+    write_text("secret.txt", "token=hunter2\n");
+    write_text("open.txt", "open\n");
+    int asked = 0;
+    ac_patch_t *p = ac_patch_create(g_root);
+    ac_patch_set_path_check(p, refuse_secrets, &asked);
+    int ok = ac_patch_replace(p, "secret.txt", "nope", "x", 0, NULL) == ARC_ERR_INVALID_ARG &&
+             strstr(ac_patch_error(p), "refused") && !strstr(ac_patch_error(p), "hunter2");
+
+    /* An allowed file before a refused one is not staged either */
+    const char *diff =
+        "--- open.txt\n"
+        "+++ open.txt\n"
+        "@@ -1 +1 @@\n"
+        "-open\n"
+        "+opened\n"
+        "--- a/secret.txt\n"
+        "+++ b/secret.txt\n"
+        "@@ -1 +1 @@\n"
+        "-token=other\n"
+        "+token=x\n";
+    ok = ok && ac_patch_apply_diff(p, diff) == ARC_ERR_INVALID_ARG &&
+         !strstr(ac_patch_error(p), "token") && ac_patch_file_count(p) == 0 && asked == 3 &&
+         ac_patch_commit(p) == ARC_OK &&
+         file_is("open.txt", "open\n") && file_is("secret.txt", "token=hunter2\n");
+    ac_patch_free(p);
+    if (ok) PASS(); else FAIL("unexpected result");
+}
+
+int main(void) {
+    printf("=== Patch Tests ===\n\n");
+
+    snprintf(g_root, sizeof(g_root), "/tmp/arc_patch_test_XXXXXX");
+    if (!mkdtemp(g_root)) {
+        printf("Failed to create temp dir\n");
+        return 1;
+    }
+
+    test_replace();
+    test_replace_create();
+    test_multi_file_diff();
+    test_fuzzy_hunks();
+    test_all_or_nothing();
+    test_create_delete();
+    test_crlf();
+    test_conflict();
+    test_failed_write();
+    test_file_cache();
+    test_path_check();
+
+    char cmd[600];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", g_root);
+    if (system(cmd) != 0) {
+        printf("warning: could not remove %s\n", g_root);
+    }
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
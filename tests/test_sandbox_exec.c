@@ -0,0 +1,241 @@
+/**
+ * @file test_sandbox_exec.c
+ * @brief Tests for sandboxed command execution (timeouts, streams, callbacks)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <arc/sandbox.h>
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+typedef struct {
+    int chunks;
+    size_t out_bytes;
+    size_t err_bytes;
+    long long first_ms;
+    size_t stop_after;              /* Stop once this many bytes arrived (0 = never) */
+} stream_log_t;
+
+static int log_output(ac_sandbox_stream_t stream, const char *data, size_t len, void *user_data) {
+    stream_log_t *log = (stream_log_t *)user_data;
+    (void)data;
+    if (log->chunks++ == 0) log->first_ms = now_ms();
+    if (stream == AC_SANDBOX_STDOUT) log->out_bytes += len;
+    else log->err_bytes += len;
+    return log->stop_after && log->out_bytes + log->err_bytes >= log->stop_after;
+}
+
+/*============================================================================
+ * Tests
+ *============================================================================*/
+
+static void test_basic(ac_sandbox_t *sb) {
+    TEST("stdout and exit code");
+    char out[256];
+    int code = -2;
+    arc_err_t err = ac_sandbox_exec(sb, "echo hello; exit 3", out, sizeof(out), &code);
+    if (err == ARC_OK && code == 3 && strcmp(out, "hello\n") == 0) {
+        PASS();
+    } else {
+        FAIL(out);
+    }
+}
+
+static void test_separate_stderr(ac_sandbox_t *sb) {
+    TEST("separate stderr buffer");
+    char out[256], errbuf[256];
+    int code = -2;
+    ac_sandbox_exec_options_t opts = {
+        .error_output = errbuf,
+        .error_output_size = sizeof(errbuf),
+    };
+    arc_err_t err = ac_sandbox_exec_ex(sb, "echo out; echo err >&2", out, sizeof(out), &code, &opts);
+    if (err == ARC_OK && code == 0 && strcmp(out, "out\n") == 0 && strcmp(errbuf, "err\n") == 0) {
+        PASS();
+    } else {
+        FAIL("streams not separated");
+    }
+
+    TEST("stderr merged by default");
+    err = ac_sandbox_exec(sb, "echo err >&2", out, sizeof(out), &code);
+    if (err == ARC_OK && strcmp(out, "err\n") == 0) {
+        PASS();
+    } else {
+        FAIL(out);
+    }
+}
+
+static void test_timeout_open_pipe(ac_sandbox_t *sb) {
+    /* The old implementation read until EOF before checking the clock */
+    TEST("timeout while output stays open");
+    char out[256];
+    int code = 0;
+    long long start = now_ms();
+    arc_err_t err = ac_sandbox_exec_timeout(sb, "echo partial; sleep 10", out, sizeof(out), &code, 300);
+    long long elapsed = now_ms() - start;
+    if (err == ARC_ERR_TIMEOUT && code == -1 && elapsed < 3000 && strcmp(out, "partial\n") == 0) {
+        PASS();
+    } else {
+        FAIL("did not time out promptly");
+    }
+}
+
+static void test_timeout_kills_group(ac_sandbox_t *sb) {
+    TEST("timeout kills background children");
+    char out[256];
+    int code = 0;
+    char marker[64];
+    snprintf(marker, sizeof(marker), "/tmp/arc_exec_test_%ld", (long)now_ms());
+    remove(marker);
+
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "(sleep 1; touch %s) & sleep 10", marker);
+    arc_err_t err = ac_sandbox_exec_timeout(sb, cmd, out, sizeof(out), &code, 200);
+
+    /* Give the background job time to run if it survived */
+    struct timespec ts = { 1, 500000000 };
+    nanosleep(&ts, NULL);
+    FILE *f = fopen(marker, "r");
+    if (f) {
+        fclose(f);
+        remove(marker);
+    }
+    if (err == ARC_ERR_TIMEOUT && !f) {
+        PASS();
+    } else {
+        FAIL("background job survived the timeout");
+    }
+}
+
+static void test_background_holder(ac_sandbox_t *sb) {
+    TEST("exit returns while a background job holds the pipe");
+    char out[256];
+    int code = -2;
+    long long start = now_ms();
+    arc_err_t err = ac_sandbox_exec_timeout(sb, "sleep 3 & echo done", out, sizeof(out), &code, 10000);
+    long long elapsed = now_ms() - start;
+    if (err == ARC_OK && code == 0 && elapsed < 2000 && strcmp(out, "done\n") == 0) {
+        PASS();
+    } else {
+        FAIL("waited for the background job");
+    }
+}
+
+static void test_streaming(ac_sandbox_t *sb) {
+    TEST("chunks arrive before exit");
+    char out[256];
+    int code = -2;
+    stream_log_t log = {0};
+    ac_sandbox_exec_options_t opts = { .on_output = log_output, .user_data = &log };
+    long long start = now_ms();
+    arc_err_t err = ac_sandbox_exec_ex(sb, "echo a; sleep 0.5; echo b >&2", out, sizeof(out), &code, &opts);
+    long long end = now_ms();
+    if (err == ARC_OK && log.chunks == 2 && log.out_bytes == 2 && log.err_bytes == 2 &&
+        log.first_ms - start < 400 && end - start >= 450) {
+        PASS();
+    } else {
+        FAIL("output was not streamed");
+    }
+
+    TEST("callback stops the command");
+    log = (stream_log_t){ .stop_after = 1 };
+    start = now_ms();
+    err = ac_sandbox_exec_ex(sb, "echo go; sleep 10", out, sizeof(out), &code, &opts);
+    if (err == ARC_OK && code == 128 + 9 && now_ms() - start < 3000) {
+        PASS();
+    } else {
+        FAIL("command kept running");
+    }
+}
+
+static void test_large_output(ac_sandbox_t *sb) {
+    /* Fills the stderr pipe while stdout is idle: both must be drained */
+    TEST("large output on both streams");
+    size_t size = 1 << 20;
+    char *out = malloc(size);
+    char *errbuf = malloc(size);
+    int code = -2;
+    ac_sandbox_exec_options_t opts = {
+        .timeout_ms = 10000,
+        .error_output = errbuf,
+        .error_output_size = size,
+    };
+    arc_err_t err = ac_sandbox_exec_ex(sb,
+        "head -c 300000 /dev/zero | tr '\\0' e >&2; head -c 300000 /dev/zero | tr '\\0' o",
+        out, size, &code, &opts);
+    if (err == ARC_OK && code == 0 && strlen(out) == 300000 && strlen(errbuf) == 300000) {
+        PASS();
+    } else {
+        FAIL("output lost");
+    }
+
+    TEST("output truncated to buffer");
+    char small[8];
+    err = ac_sandbox_exec(sb, "echo 0123456789", small, sizeof(small), &code);
+    if (err == ARC_OK && code == 0 && strcmp(small, "0123456") == 0) {
+        PASS();
+    } else {
+        FAIL(small);
+    }
+    free(out);
+    free(errbuf);
+}
+
+int main(void) {
+    printf("=== Sandbox Exec Tests ===\n\n");
+
+    ac_sandbox_config_t config = AC_SANDBOX_CONFIG_DEFAULT("/tmp");
+    config.log_violations = 0;
+    ac_sandbox_t *sb = ac_sandbox_create(&config);
+    if (!sb) {
+        printf("Failed to create sandbox\n");
+        return 1;
+    }
+
+    test_basic(sb);
+    test_separate_stderr(sb);
+    test_timeout_open_pipe(sb);
+    test_timeout_kills_group(sb);
+    test_background_holder(sb);
+    test_streaming(sb);
+    test_large_output(sb);
+
+    ac_sandbox_destroy(sb);
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
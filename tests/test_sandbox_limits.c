@@ -0,0 +1,231 @@
+/**
+ * @file test_sandbox_limits.c
+ * @brief Tests for sandbox resource limits and usage stats
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <arc/sandbox.h>
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static ac_sandbox_t *create_with(const ac_sandbox_limits_t *limits) {
+    ac_sandbox_config_t config = AC_SANDBOX_CONFIG_DEFAULT("/tmp");
+    config.log_violations = 0;
+    config.limits = *limits;
+    return ac_sandbox_create(&config);
+}
+
+/*============================================================================
+ * Tests
+ *============================================================================*/
+
+static void test_stats(void) {
+    TEST("usage stats without limits");
+    ac_sandbox_limits_t limits = {0};
+    ac_sandbox_t *sb = create_with(&limits);
+    char out[256];
+    int code = -2;
+    ac_sandbox_exec_stats_t stats;
+    memset(&stats, 0xff, sizeof(stats));
+    ac_sandbox_exec_options_t opts = { .timeout_ms = 10000, .stats = &stats };
+    arc_err_t err = ac_sandbox_exec_ex(sb,
+        "i=0; while [ $i -lt 200000 ]; do i=$((i+1)); done; echo done; sleep 0.2",
+        out, sizeof(out), &code, &opts);
+    if (err == ARC_OK && code == 0 && stats.wall_ms >= 200 &&
+        stats.user_cpu_ms + stats.system_cpu_ms > 0 && stats.max_rss_bytes > 0 &&
+        stats.output_bytes == 5 && stats.limit_hit == AC_SANDBOX_LIMIT_NONE && !stats.in_cgroup) {
+        PASS();
+    } else {
+        FAIL("stats not filled");
+    }
+    ac_sandbox_destroy(sb);
+}
+
+static void test_output_limit(void) {
+    TEST("output limit stops the command");
+    ac_sandbox_limits_t limits = { .output_bytes = 4096 };
+    ac_sandbox_t *sb = create_with(&limits);
+    size_t size = 1 << 16;
+    char *out = malloc(size);
+    int code = -2;
+    ac_sandbox_exec_stats_t stats = {0};
+    ac_sandbox_exec_options_t opts = { .timeout_ms = 10000, .stats = &stats };
+    long long start = now_ms();
+    arc_err_t err = ac_sandbox_exec_ex(sb, "yes", out, size, &code, &opts);
+    if (err == ARC_OK && code == 128 + 9 && strlen(out) == 4096 && now_ms() - start < 3000 &&
+        stats.output_bytes == 4096 && stats.limit_hit == AC_SANDBOX_LIMIT_OUTPUT) {
+        PASS();
+    } else {
+        FAIL("output kept flowing");
+    }
+
+    TEST("output under the limit is untouched");
+    err = ac_sandbox_exec_ex(sb, "echo fine", out, size, &code, &opts);
+    if (err == ARC_OK && code == 0 && strcmp(out, "fine\n") == 0 &&
+        stats.limit_hit == AC_SANDBOX_LIMIT_NONE) {
+        PASS();
+    } else {
+        FAIL(out);
+    }
+    free(out);
+    ac_sandbox_destroy(sb);
+}
+
+static void test_cpu_limit(void) {
+    TEST("cpu limit ends a busy loop");
+    ac_sandbox_limits_t limits = { .cpu_seconds = 1 };
+    ac_sandbox_t *sb = create_with(&limits);
+    char out[256];
+    int code = -2;
+    ac_sandbox_exec_stats_t stats = {0};
+    ac_sandbox_exec_options_t opts = { .timeout_ms = 15000, .stats = &stats };
+    arc_err_t err = ac_sandbox_exec_ex(sb, "while :; do :; done", out, sizeof(out), &code, &opts);
+    if (err == ARC_OK && code > 128 && stats.limit_hit == AC_SANDBOX_LIMIT_CPU &&
+        stats.user_cpu_ms + stats.system_cpu_ms >= 900) {
+        PASS();
+    } else {
+        FAIL("busy loop was not stopped by the cpu limit");
+    }
+    ac_sandbox_destroy(sb);
+}
+
+static void test_rlimits_inherited(void) {
+    TEST("rlimits visible to the command");
+    ac_sandbox_limits_t limits = { .open_files = 64, .address_space_bytes = (size_t)1 << 32 };
+    ac_sandbox_t *sb = create_with(&limits);
+    char out[256];
+    int code = -2;
+    arc_err_t err = ac_sandbox_exec(sb, "ulimit -n; ulimit -v", out, sizeof(out), &code);
+    if (err == ARC_OK && code == 0 && strcmp(out, "64\n4194304\n") == 0) {
+        PASS();
+    } else {
+        FAIL(out);
+    }
+    ac_sandbox_destroy(sb);
+}
+
+static void test_cgroup_fallback(void) {
+    TEST("unusable cgroup parent falls back to rlimits");
+    ac_sandbox_limits_t limits = {
+        .open_files = 32,
+        .cgroup_parent = "/nonexistent/arc-cgroup",
+        .memory_max_bytes = (size_t)64 << 20,
+        .pids_max = 16,
+    };
+    ac_sandbox_t *sb = create_with(&limits);
+    char out[256];
+    int code = -2;
+    ac_sandbox_exec_stats_t stats = {0};
+    ac_sandbox_exec_options_t opts = { .timeout_ms = 10000, .stats = &stats };
+    arc_err_t err = ac_sandbox_exec_ex(sb, "ulimit -n", out, sizeof(out), &code, &opts);
+    if (err == ARC_OK && code == 0 && strcmp(out, "32\n") == 0 && !stats.in_cgroup) {
+        PASS();
+    } else {
+        FAIL(out);
+    }
+    ac_sandbox_destroy(sb);
+}
+
+static void test_cgroup(void) {
+    /* Needs a delegated cgroup v2 directory, e.g. one owned by this user */
+    const char *parent = getenv("ARC_TEST_CGROUP");
+    if (!parent || !*parent) {
+        printf("Test: cgroup limits... SKIPPED (set ARC_TEST_CGROUP)\n");
+        return;
+    }
+
+    TEST("cgroup pids limit and cleanup");
+    ac_sandbox_limits_t limits = { .cgroup_parent = parent, .pids_max = 8 };
+    ac_sandbox_t *sb = create_with(&limits);
+    char out[1024];
+    int code = -2;
+    ac_sandbox_exec_stats_t stats = {0};
+    ac_sandbox_exec_options_t opts = { .timeout_ms = 10000, .stats = &stats };
+    arc_err_t err = ac_sandbox_exec_ex(sb,
+        "for i in 1 2 3 4 5 6 7 8 9 10 11 12; do sleep 5 & done 2>/dev/null; echo started",
+        out, sizeof(out), &code, &opts);
+    if (err == ARC_OK && stats.in_cgroup && stats.limit_hit == AC_SANDBOX_LIMIT_PROCESSES) {
+        PASS();
+    } else {
+        FAIL("pids.max not applied");
+    }
+    ac_sandbox_destroy(sb);
+}
+
+static void test_shell_limits(void) {
+    TEST("persistent shell output limit");
+    ac_sandbox_limits_t limits = { .output_bytes = 1000, .open_files = 48 };
+    ac_sandbox_t *sb = create_with(&limits);
+    ac_sandbox_shell_t *shell = ac_sandbox_shell_open(sb, NULL);
+    char out[4096];
+    int code = -2;
+    ac_sandbox_exec_stats_t stats = {0};
+    ac_sandbox_exec_options_t opts = { .timeout_ms = 10000, .stats = &stats };
+    arc_err_t err = shell ? ac_sandbox_shell_exec(shell, "yes", out, sizeof(out), &code, &opts)
+                          : ARC_ERR_IO;
+    if (err == ARC_OK && strlen(out) == 1000 && stats.limit_hit == AC_SANDBOX_LIMIT_OUTPUT) {
+        PASS();
+    } else {
+        FAIL("shell output not limited");
+    }
+
+    TEST("persistent shell keeps its rlimits");
+    err = shell ? ac_sandbox_shell_exec(shell, "ulimit -n", out, sizeof(out), &code, &opts)
+                : ARC_ERR_IO;
+    if (err == ARC_OK && code == 0 && strcmp(out, "48\n") == 0) {
+        PASS();
+    } else {
+        FAIL(out);
+    }
+    if (shell) ac_sandbox_shell_close(shell);
+    ac_sandbox_destroy(sb);
+}
+
+int main(void) {
+    printf("=== Sandbox Limits Tests ===\n\n");
+
+    test_stats();
+    test_output_limit();
+    test_cpu_limit();
+    test_rlimits_inherited();
+    test_cgroup_fallback();
+    test_cgroup();
+    test_shell_limits();
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
@@ -0,0 +1,257 @@
+/**
+ * @file test_sandbox_path.c
+ * @brief Tests for sandbox path checks (compiled path index)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <arc/sandbox.h>
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+#define RW (AC_SANDBOX_PERM_FS_READ | AC_SANDBOX_PERM_FS_WRITE)
+
+static char g_root[256];
+static char g_path[512];
+
+/* g_root + "/" + rel */
+static const char *at(const char *rel) {
+    snprintf(g_path, sizeof(g_path), "%s/%s", g_root, rel);
+    return g_path;
+}
+
+static void make_dir(const char *rel) {
+    mkdir(at(rel), 0755);
+}
+
+static void make_file(const char *rel) {
+    FILE *f = fopen(at(rel), "w");
+    if (f) fclose(f);
+}
+
+static void make_link(const char *target_rel, const char *rel) {
+    char target[512];
+    snprintf(target, sizeof(target), "%s/%s", g_root, target_rel);
+    symlink(target, at(rel));
+}
+
+static int check(ac_sandbox_t *sb, const char *rel, unsigned int perms) {
+    return ac_sandbox_check_path(sb, at(rel), perms);
+}
+
+/*============================================================================
+ * Tests
+ *============================================================================*/
+
+static void test_workspace(ac_sandbox_t *sb) {
+    TEST("workspace paths, existing or not");
+    int ok = check(sb, "ws", AC_SANDBOX_PERM_FS_ALL) &&
+             check(sb, "ws/sub/file", AC_SANDBOX_PERM_FS_ALL) &&
+             check(sb, "ws/sub/new.txt", AC_SANDBOX_PERM_FS_WRITE) &&
+             check(sb, "ws/missing/dir/new.txt", AC_SANDBOX_PERM_FS_CREATE) &&
+             check(sb, "ws//sub/./file", AC_SANDBOX_PERM_FS_READ) &&
+             check(sb, "ws/sub/", AC_SANDBOX_PERM_FS_READ);
+    if (ok) PASS(); else FAIL("workspace path rejected");
+
+    TEST("prefix of a sibling is not inside");
+    ok = !check(sb, "ws2/file", AC_SANDBOX_PERM_FS_WRITE) &&
+         !check(sb, "outside", AC_SANDBOX_PERM_FS_WRITE);
+    if (ok) PASS(); else FAIL("sibling accepted");
+
+    TEST("dot-dot cannot leave the workspace");
+    ok = !check(sb, "ws/sub/../../outside/x", AC_SANDBOX_PERM_FS_WRITE) &&
+         !check(sb, "ws/missing/../../outside/x", AC_SANDBOX_PERM_FS_WRITE) &&
+         check(sb, "ws/sub/../file2", AC_SANDBOX_PERM_FS_WRITE);
+    if (ok) PASS(); else FAIL("escape accepted");
+}
+
+static void test_symlinks(ac_sandbox_t *sb) {
+    TEST("symlinked file pointing outside");
+    int ok = !check(sb, "ws/leak", AC_SANDBOX_PERM_FS_WRITE) &&
+             check(sb, "ws/inner", AC_SANDBOX_PERM_FS_WRITE);
+    if (ok) PASS(); else FAIL("link target ignored");
+
+    TEST("symlinked directory pointing outside");
+    ok = !check(sb, "ws/door/file", AC_SANDBOX_PERM_FS_WRITE) &&
+         !check(sb, "ws/door/missing/new", AC_SANDBOX_PERM_FS_WRITE);
+    if (ok) PASS(); else FAIL("directory link ignored");
+}
+
+static void test_rules(ac_sandbox_t *sb) {
+    TEST("path rule permissions");
+    int ok = check(sb, "outside/rw/file", RW) &&
+             check(sb, "outside/rw/deep/er/file", AC_SANDBOX_PERM_FS_WRITE) &&
+             !check(sb, "outside/rw/file", AC_SANDBOX_PERM_FS_DELETE) &&
+             !check(sb, "outside/rw/file", RW | AC_SANDBOX_PERM_FS_DELETE);
+    if (ok) PASS(); else FAIL("rule permissions");
+
+    TEST("readonly paths grant read only");
+    ok = check(sb, "outside/ro/file", AC_SANDBOX_PERM_FS_READ) &&
+         !check(sb, "outside/ro/file", AC_SANDBOX_PERM_FS_WRITE) &&
+         !check(sb, "outside/ro/file", RW);
+    if (ok) PASS(); else FAIL("readonly permissions");
+}
+
+static void test_cache(ac_sandbox_t *sb) {
+    char cwd[512];
+    if (!getcwd(cwd, sizeof(cwd))) cwd[0] = '\0';
+
+    TEST("relative paths follow chdir after invalidation");
+    int ok = chdir(at("ws")) == 0;
+    ac_sandbox_invalidate_path_cache(sb);
+    ok = ok && ac_sandbox_check_path(sb, "sub/file", AC_SANDBOX_PERM_FS_WRITE);
+    ok = ok && chdir(at("outside")) == 0;
+    ac_sandbox_invalidate_path_cache(sb);
+    ok = ok && !ac_sandbox_check_path(sb, "sub/file", AC_SANDBOX_PERM_FS_WRITE);
+    if (ok) PASS(); else FAIL("stale working directory");
+    if (cwd[0] && chdir(cwd) != 0) cwd[0] = '\0';
+
+    TEST("directory replaced by a symlink after invalidation");
+    ok = check(sb, "ws/swap/file", AC_SANDBOX_PERM_FS_WRITE);
+    char target[512];
+    snprintf(target, sizeof(target), "%s", at("ws/swap"));
+    rmdir(target);
+    make_link("outside", "ws/swap");
+    ac_sandbox_invalidate_path_cache(sb);
+    ok = ok && !check(sb, "ws/swap/file", AC_SANDBOX_PERM_FS_WRITE);
+    if (ok) PASS(); else FAIL("stale directory");
+
+    TEST("directory swapped for a symlink without invalidation");
+    ok = check(sb, "ws/fresh/file", AC_SANDBOX_PERM_FS_WRITE);
+    rmdir(at("ws/fresh"));
+    make_link("outside", "ws/fresh");
+    ok = ok && !check(sb, "ws/fresh/file", AC_SANDBOX_PERM_FS_WRITE);
+    if (ok) PASS(); else FAIL("stale directory");
+
+    /* Old enough that cached stamps are trusted */
+    sleep(3);
+
+    TEST("new symlink in a settled directory");
+    ok = check(sb, "ws/evil", AC_SANDBOX_PERM_FS_WRITE) &&
+         check(sb, "ws/settled/file", AC_SANDBOX_PERM_FS_WRITE);
+    make_link("outside/secret", "ws/evil");
+    ok = ok && !check(sb, "ws/evil", AC_SANDBOX_PERM_FS_WRITE);
+    if (ok) PASS(); else FAIL("new link not seen");
+
+    TEST("settled directory moved out and linked back");
+    char moved[512];
+    snprintf(moved, sizeof(moved), "%s", at("outside/settled"));
+    rename(at("ws/settled"), moved);
+    make_link("outside/settled", "ws/settled");
+    ok = !check(sb, "ws/settled/file", AC_SANDBOX_PERM_FS_WRITE);
+    if (ok) PASS(); else FAIL("moved directory still trusted");
+
+    TEST("commands run by the sandbox drop the cache");
+    ok = check(sb, "ws/byshell/file", AC_SANDBOX_PERM_FS_WRITE);
+    char command[1200];
+    snprintf(command, sizeof(command), "rmdir '%s/ws/byshell' && ln -s '%s/outside' '%s/ws/byshell'",
+             g_root, g_root, g_root);
+    char out[256];
+    int code = -1;
+    ac_sandbox_exec(sb, command, out, sizeof(out), &code);
+    ok = ok && code == 0 && !check(sb, "ws/byshell/file", AC_SANDBOX_PERM_FS_WRITE);
+    if (ok) PASS(); else FAIL(out);
+
+    TEST("many directories (cache eviction)");
+    ok = 1;
+    for (int i = 0; i < 3000 && ok; i++) {
+        char rel[64];
+        snprintf(rel, sizeof(rel), "ws/gen%d/f", i);
+        ok = check(sb, rel, AC_SANDBOX_PERM_FS_WRITE);
+        snprintf(rel, sizeof(rel), "outside/gen%d/f", i);
+        ok = ok && !check(sb, rel, AC_SANDBOX_PERM_FS_WRITE);
+    }
+    if (ok) PASS(); else FAIL("wrong answer after eviction");
+}
+
+int main(void) {
+    printf("=== Sandbox Path Tests ===\n\n");
+
+    snprintf(g_root, sizeof(g_root), "/tmp/arc_path_test_XXXXXX");
+    if (!mkdtemp(g_root)) {
+        printf("Failed to create temp dir\n");
+        return 1;
+    }
+
+    make_dir("ws");
+    make_dir("ws/sub");
+    make_dir("ws/swap");
+    make_dir("ws/fresh");
+    make_dir("ws/settled");
+    make_dir("ws/byshell");
+    make_dir("ws2");
+    make_dir("outside");
+    make_dir("outside/rw");
+    make_dir("outside/ro");
+    make_dir("outside/other");
+    make_file("ws/sub/file");
+    make_file("outside/secret");
+    make_link("outside/secret", "ws/leak");
+    make_link("ws/sub/file", "ws/inner");
+    make_link("outside/other", "ws/door");
+
+    char ws[512], rw[512], ro[512];
+    snprintf(ws, sizeof(ws), "%s", at("ws"));
+    snprintf(rw, sizeof(rw), "%s", at("outside/rw"));
+    snprintf(ro, sizeof(ro), "%s", at("outside/ro"));
+
+    ac_sandbox_path_rule_t rules[] = {
+        { .path = rw, .permissions = RW },
+    };
+    const char *readonly[] = { ro, NULL };
+
+    ac_sandbox_config_t config = AC_SANDBOX_CONFIG_DEFAULT(ws);
+    config.path_rules = rules;
+    config.path_rules_count = 1;
+    config.readonly_paths = readonly;
+    config.log_violations = 0;
+    ac_sandbox_t *sb = ac_sandbox_create(&config);
+    if (!sb) {
+        printf("Failed to create sandbox\n");
+        return 1;
+    }
+
+    test_workspace(sb);
+    test_symlinks(sb);
+    test_rules(sb);
+    test_cache(sb);
+
+    ac_sandbox_destroy(sb);
+
+    char cmd[600];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", g_root);
+    if (system(cmd) != 0) {
+        printf("warning: could not remove %s\n", g_root);
+    }
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
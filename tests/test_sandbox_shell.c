@@ -0,0 +1,225 @@
+/**
+ * @file test_sandbox_shell.c
+ * @brief Tests for persistent sandboxed shell sessions
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <arc/sandbox.h>
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int collect_chunks(ac_sandbox_stream_t stream, const char *data, size_t len, void *user_data) {
+    (void)stream;
+    (void)data;
+    *(size_t *)user_data += len;
+    return 0;
+}
+
+/*============================================================================
+ * Tests
+ *============================================================================*/
+
+static void test_state_persists(ac_sandbox_shell_t *sh) {
+    char out[256];
+    int code = -2;
+
+    TEST("cd and exported variables persist");
+    ac_sandbox_shell_exec(sh, "cd /usr && export ARC_TEST_VAR=kept", out, sizeof(out), &code, NULL);
+    arc_err_t err = ac_sandbox_shell_exec(sh, "pwd; echo $ARC_TEST_VAR", out, sizeof(out), &code, NULL);
+    if (err == ARC_OK && code == 0 && strcmp(out, "/usr\nkept\n") == 0 &&
+        strcmp(ac_sandbox_shell_cwd(sh), "/usr") == 0) {
+        PASS();
+    } else {
+        FAIL(out);
+    }
+
+    TEST("functions persist");
+    ac_sandbox_shell_exec(sh, "greet() { echo \"hi $1\"; }", out, sizeof(out), &code, NULL);
+    err = ac_sandbox_shell_exec(sh, "greet 'o'\\''brien'", out, sizeof(out), &code, NULL);
+    if (err == ARC_OK && code == 0 && strcmp(out, "hi o'brien\n") == 0) {
+        PASS();
+    } else {
+        FAIL(out);
+    }
+
+    TEST("exit code of the last command");
+    err = ac_sandbox_shell_exec(sh, "false", out, sizeof(out), &code, NULL);
+    if (err == ARC_OK && code == 1 && out[0] == '\0') {
+        PASS();
+    } else {
+        FAIL("wrong exit code");
+    }
+
+    TEST("syntax error keeps the shell");
+    ac_sandbox_shell_exec(sh, "if then", out, sizeof(out), &code, NULL);
+    err = ac_sandbox_shell_exec(sh, "echo $ARC_TEST_VAR", out, sizeof(out), &code, NULL);
+    if (err == ARC_OK && code == 0 && strcmp(out, "kept\n") == 0) {
+        PASS();
+    } else {
+        FAIL(out);
+    }
+}
+
+static void test_framing(ac_sandbox_shell_t *sh) {
+    char out[256], errbuf[256];
+    int code = -2;
+
+    TEST("output without trailing newline");
+    arc_err_t err = ac_sandbox_shell_exec(sh, "printf abc", out, sizeof(out), &code, NULL);
+    if (err == ARC_OK && code == 0 && strcmp(out, "abc") == 0) {
+        PASS();
+    } else {
+        FAIL(out);
+    }
+
+    TEST("stdin readers do not consume the framing");
+    err = ac_sandbox_shell_exec(sh, "cat; echo after", out, sizeof(out), &code, NULL);
+    if (err == ARC_OK && code == 0 && strcmp(out, "after\n") == 0) {
+        PASS();
+    } else {
+        FAIL(out);
+    }
+
+    TEST("separate stderr buffer");
+    ac_sandbox_exec_options_t opts = {
+        .error_output = errbuf,
+        .error_output_size = sizeof(errbuf),
+    };
+    err = ac_sandbox_shell_exec(sh, "echo out; echo err >&2", out, sizeof(out), &code, &opts);
+    if (err == ARC_OK && code == 0 && strcmp(out, "out\n") == 0 && strcmp(errbuf, "err\n") == 0) {
+        PASS();
+    } else {
+        FAIL("streams not separated");
+    }
+
+    TEST("large output streamed in chunks");
+    size_t size = 1 << 20;
+    char *big = malloc(size);
+    size_t streamed = 0;
+    opts = (ac_sandbox_exec_options_t){ .on_output = collect_chunks, .user_data = &streamed };
+    err = ac_sandbox_shell_exec(sh, "head -c 300000 /dev/zero | tr '\\0' x", big, size, &code, &opts);
+    if (err == ARC_OK && code == 0 && strlen(big) == 300000 && streamed == 300000) {
+        PASS();
+    } else {
+        FAIL("output lost");
+    }
+    free(big);
+}
+
+static void test_redirected_shell(ac_sandbox_t *sb) {
+    char out[256];
+    int code = -2;
+
+    TEST("session survives exec >/dev/null 2>&1");
+    ac_sandbox_shell_t *sh = ac_sandbox_shell_open(sb, "/tmp");
+    ac_sandbox_exec_options_t opts = { .timeout_ms = 5000 };
+    long long start = now_ms();
+    arc_err_t err = ac_sandbox_shell_exec(sh, "exec >/dev/null 2>&1", out, sizeof(out), &code, &opts);
+    int redirected = err == ARC_OK && code == 0;
+    err = ac_sandbox_shell_exec(sh, "echo hidden; echo hidden >&2; cd /usr; false", out, sizeof(out), &code, &opts);
+    int framed = err == ARC_OK && code == 1 && out[0] == '\0' &&
+                 strcmp(ac_sandbox_shell_cwd(sh), "/usr") == 0;
+    err = ac_sandbox_shell_exec(sh, "exec >/tmp/arc_shell_redirect.log; echo logged", out, sizeof(out), &code, &opts);
+    if (redirected && framed && err == ARC_OK && code == 0 && out[0] == '\0' &&
+        now_ms() - start < 3000) {
+        PASS();
+    } else {
+        FAIL("sentinel lost after redirecting the shell");
+    }
+    ac_sandbox_shell_close(sh);
+    remove("/tmp/arc_shell_redirect.log");
+}
+
+static void test_restart(ac_sandbox_shell_t *sh) {
+    char out[256];
+    int code = 0;
+
+    TEST("timeout restarts the shell in the same directory");
+    ac_sandbox_shell_exec(sh, "cd /tmp && export ARC_TEST_VAR=gone", out, sizeof(out), &code, NULL);
+    ac_sandbox_exec_options_t opts = { .timeout_ms = 300 };
+    long long start = now_ms();
+    arc_err_t err = ac_sandbox_shell_exec(sh, "echo partial; sleep 10", out, sizeof(out), &code, &opts);
+    long long elapsed = now_ms() - start;
+    int timed_out = err == ARC_ERR_TIMEOUT && code == -1 && elapsed < 3000 &&
+                    strcmp(out, "partial\n") == 0;
+    err = ac_sandbox_shell_exec(sh, "pwd; echo \"[$ARC_TEST_VAR]\"", out, sizeof(out), &code, NULL);
+    if (timed_out && err == ARC_OK && strcmp(out, "/tmp\n[]\n") == 0) {
+        PASS();
+    } else {
+        FAIL(out);
+    }
+
+    TEST("exit ends the shell and the next command restarts it");
+    err = ac_sandbox_shell_exec(sh, "echo bye; exit 7", out, sizeof(out), &code, NULL);
+    int exited = err == ARC_OK && code == 7 && strcmp(out, "bye\n") == 0;
+    err = ac_sandbox_shell_exec(sh, "pwd", out, sizeof(out), &code, NULL);
+    if (exited && err == ARC_OK && code == 0 && strcmp(out, "/tmp\n") == 0) {
+        PASS();
+    } else {
+        FAIL(out);
+    }
+}
+
+int main(void) {
+    printf("=== Sandbox Shell Tests ===\n\n");
+
+    ac_sandbox_config_t config = AC_SANDBOX_CONFIG_DEFAULT("/tmp");
+    config.log_violations = 0;
+    ac_sandbox_t *sb = ac_sandbox_create(&config);
+    if (!sb) {
+        printf("Failed to create sandbox\n");
+        return 1;
+    }
+
+    ac_sandbox_shell_t *sh = ac_sandbox_shell_open(sb, NULL);
+    if (!sh) {
+        printf("Failed to open shell\n");
+        ac_sandbox_destroy(sb);
+        return 1;
+    }
+
+    test_state_persists(sh);
+    test_framing(sh);
+    test_redirected_shell(sb);
+    test_restart(sh);
+
+    ac_sandbox_shell_close(sh);
+    ac_sandbox_destroy(sb);
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
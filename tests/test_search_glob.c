@@ -0,0 +1,353 @@
+/**
+ * @file test_search_glob.c
+ * @brief Tests for compiled path globs and mtime-ordered file finding
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <arc/glob.h>
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+static char g_root[256];
+
+static const char *at(const char *rel) {
+    static char path[512];
+    snprintf(path, sizeof(path), "%s/%s", g_root, rel);
+    return path;
+}
+
+static void make_dir(const char *rel) {
+    mkdir(at(rel), 0755);
+}
+
+/* Create a file with a given modification time */
+static void make_file(const char *rel, long mtime) {
+    FILE *f = fopen(at(rel), "w");
+    if (f) fclose(f);
+    struct timeval tv[2] = { { mtime, 0 }, { mtime, 0 } };
+    utimes(at(rel), tv);
+}
+
+typedef struct {
+    const char *pattern;
+    const char *path;
+    int match;
+} match_case_t;
+
+static int check_matches(const match_case_t *cases, size_t n) {
+    int ok = 1;
+    for (size_t i = 0; i < n; i++) {
+        ac_glob_pattern_t *g = ac_glob_pattern_compile(cases[i].pattern, NULL, 0);
+        int m = g ? ac_glob_pattern_match(g, cases[i].path) : -1;
+        if (m != cases[i].match) {
+            printf("[%s vs %s: %d] ", cases[i].pattern, cases[i].path, m);
+            ok = 0;
+        }
+        ac_glob_pattern_free(g);
+    }
+    return ok;
+}
+
+/* Relative paths of a result, newest first, space separated */
+static void result_names(const ac_glob_result_t *r, char *out, size_t size) {
+    size_t root_len = strlen(g_root) + 1;
+    out[0] = '\0';
+    for (size_t i = 0; i < r->count; i++) {
+        size_t len = strlen(out);
+        snprintf(out + len, size - len, "%s%s", i ? " " : "", r->files[i].path + root_len);
+    }
+}
+
+/*============================================================================
+ * Pattern Tests
+ *============================================================================*/
+
+static void test_match_basic(void) {
+    TEST("segment wildcards and classes");
+    match_case_t cases[] = {
+        { "src/*.c", "src/a.c", 1 },
+        { "src/*.c", "src/sub/a.c", 0 },
+        { "src/*.c", "lib/a.c", 0 },
+        { "src/?.c", "src/a.c", 1 },
+        { "src/?.c", "src/ab.c", 0 },
+        { "src/[a-c].h", "src/b.h", 1 },
+        { "src/[!a-c].h", "src/b.h", 0 },
+        { "./src/*.c", "src/a.c", 1 },
+        { "/src/*.c", "src/a.c", 1 },
+        { "src\\*.c", "src*.c", 1 },
+    };
+    if (check_matches(cases, sizeof(cases) / sizeof(cases[0]))) PASS(); else FAIL("mismatch");
+}
+
+static void test_match_globstar(void) {
+    TEST("globstar segments");
+    match_case_t cases[] = {
+        { "**/*.c", "a.c", 1 },
+        { "**/*.c", "x/y/z/a.c", 1 },
+        { "src/**/*.c", "src/a.c", 1 },
+        { "src/**/*.c", "src/x/y/a.c", 1 },
+        { "src/**/*.c", "lib/x/a.c", 0 },
+        { "src/**", "src/x/a.c", 1 },
+        { "src/**", "src", 0 },
+        { "src/**/test/**/*.c", "src/a/test/b/c/x.c", 1 },
+        { "src/**/test/**/*.c", "src/a/b/x.c", 0 },
+        { "**/**/*.md", "docs/a.md", 1 },
+    };
+    if (check_matches(cases, sizeof(cases) / sizeof(cases[0]))) PASS(); else FAIL("mismatch");
+}
+
+static void test_match_unanchored(void) {
+    TEST("patterns without a slash match names at any depth");
+    match_case_t cases[] = {
+        { "*.c", "a.c", 1 },
+        { "*.c", "src/deep/a.c", 1 },
+        { "*.c", "src/a.h", 0 },
+        { "Makefile", "sub/Makefile", 1 },
+        { "Makefile", "sub/Makefile.am", 0 },
+    };
+    if (check_matches(cases, sizeof(cases) / sizeof(cases[0]))) PASS(); else FAIL("mismatch");
+}
+
+static void test_match_braces(void) {
+    TEST("brace alternatives");
+    match_case_t cases[] = {
+        { "*.{ts,tsx}", "app/x.ts", 1 },
+        { "*.{ts,tsx}", "app/x.tsx", 1 },
+        { "*.{ts,tsx}", "app/x.js", 0 },
+        { "{src,lib/{a,b}}/main.{c,h}", "lib/b/main.h", 1 },
+        { "{src,lib/{a,b}}/main.{c,h}", "lib/c/main.h", 0 },
+        { "{src,lib/{a,b}}/main.{c,h}", "src/main.c", 1 },
+        { "file{1}.txt", "file{1}.txt", 1 },
+        { "\\{a,b}.txt", "{a,b}.txt", 1 },
+        { "{docs/**/*.md,README.md}", "docs/x/y.md", 1 },
+        { "{docs/**/*.md,README.md}", "sub/README.md", 1 },
+    };
+    if (check_matches(cases, sizeof(cases) / sizeof(cases[0]))) PASS(); else FAIL("mismatch");
+}
+
+static void test_can_descend(void) {
+    TEST("directory pruning");
+    struct { const char *pattern, *dir; int descend; } cases[] = {
+        { "src/*.c", "", 1 },
+        { "src/*.c", "src", 1 },
+        { "src/*.c", "lib", 0 },
+        { "src/*.c", "src/sub", 0 },
+        { "src/**/*.c", "src/a/b/c", 1 },
+        { "src/**/*.c", "build", 0 },
+        { "*.c", "any/where", 1 },
+        { "{src,lib}/x/*.h", "lib/x", 1 },
+        { "{src,lib}/x/*.h", "lib/y", 0 },
+    };
+    int ok = 1;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        ac_glob_pattern_t *g = ac_glob_pattern_compile(cases[i].pattern, NULL, 0);
+        int d = g ? ac_glob_pattern_can_descend(g, cases[i].dir) : -1;
+        if (d != cases[i].descend) {
+            printf("[%s in '%s': %d] ", cases[i].pattern, cases[i].dir, d);
+            ok = 0;
+        }
+        ac_glob_pattern_free(g);
+    }
+    if (ok) PASS(); else FAIL("mismatch");
+}
+
+static void test_compile_errors(void) {
+    TEST("compile errors");
+    char err[128] = "";
+    ac_glob_pattern_t *empty = ac_glob_pattern_compile("", err, sizeof(err));
+    int ok = !empty && strstr(err, "empty") != NULL;
+
+    /* 2^10 alternatives */
+    const char *many = "{a,b}{a,b}{a,b}{a,b}{a,b}{a,b}{a,b}{a,b}{a,b}{a,b}";
+    err[0] = '\0';
+    ac_glob_pattern_t *big = ac_glob_pattern_compile(many, err, sizeof(err));
+    ok = ok && !big && strstr(err, "alternatives") != NULL;
+
+    ac_glob_pattern_t *slash = ac_glob_pattern_compile("/", err, sizeof(err));
+    ok = ok && !slash;
+    if (ok) PASS(); else FAIL(err);
+}
+
+/*============================================================================
+ * Find Tests
+ *============================================================================*/
+
+static void setup_tree(void) {
+    make_dir(".git");
+    make_dir(".github");
+    make_dir("src");
+    make_dir("src/net");
+    make_dir("build");
+    make_dir("docs");
+    FILE *f = fopen(at(".gitignore"), "w");
+    if (f) {
+        fputs("build/\n", f);
+        fclose(f);
+    }
+    make_file("src/main.c", 1000);
+    make_file("src/util.c", 3000);
+    make_file("src/util.h", 2500);
+    make_file("src/net/http.c", 2000);
+    make_file("src/net/old.c", 500);
+    make_file("build/gen.c", 9000);
+    make_file("docs/notes.md", 4000);
+    make_file(".github/ci.yml", 5000);
+}
+
+static void test_find_order(void) {
+    TEST("find sorts newest first and honors .gitignore");
+    ac_glob_pattern_t *g = ac_glob_pattern_compile("*.c", NULL, 0);
+    ac_glob_result_t r;
+    char names[1024];
+    if (!g || ac_glob_find(g_root, g, NULL, &r) != ARC_OK) {
+        FAIL("find failed");
+        ac_glob_pattern_free(g);
+        return;
+    }
+    result_names(&r, names, sizeof(names));
+    if (strcmp(names, "src/util.c src/net/http.c src/main.c src/net/old.c") == 0 && r.total == 4) {
+        PASS();
+    } else {
+        FAIL(names);
+    }
+    ac_glob_result_free(&r);
+    ac_glob_pattern_free(g);
+}
+
+static void test_find_top_k(void) {
+    TEST("find keeps the newest max_results files");
+    ac_glob_pattern_t *g = ac_glob_pattern_compile("src/**", NULL, 0);
+    ac_glob_find_options_t opts = { .max_results = 2 };
+    ac_glob_result_t r;
+    char names[1024] = "";
+    if (g && ac_glob_find(g_root, g, &opts, &r) == ARC_OK) {
+        result_names(&r, names, sizeof(names));
+        if (strcmp(names, "src/util.c src/util.h") == 0 && r.count == 2 && r.total == 5 &&
+            r.files[0].mtime_ns == 3000LL * 1000000000) {
+            PASS();
+        } else {
+            FAIL(names);
+        }
+        ac_glob_result_free(&r);
+    } else {
+        FAIL("find failed");
+    }
+    ac_glob_pattern_free(g);
+}
+
+static void test_find_hidden(void) {
+    TEST("find includes dot directories named by the pattern");
+    ac_glob_pattern_t *g = ac_glob_pattern_compile(".github/*.yml", NULL, 0);
+    ac_glob_result_t r;
+    char names[1024] = "";
+    if (g && ac_glob_find(g_root, g, NULL, &r) == ARC_OK) {
+        result_names(&r, names, sizeof(names));
+        if (strcmp(names, ".github/ci.yml") == 0) PASS(); else FAIL(names);
+        ac_glob_result_free(&r);
+    } else {
+        FAIL("find failed");
+    }
+    ac_glob_pattern_free(g);
+
+    TEST("find skips dot directories otherwise");
+    g = ac_glob_pattern_compile("*.yml", NULL, 0);
+    if (g && ac_glob_find(g_root, g, NULL, &r) == ARC_OK) {
+        if (r.count == 0) PASS(); else FAIL("hidden file found");
+        ac_glob_result_free(&r);
+    } else {
+        FAIL("find failed");
+    }
+    ac_glob_pattern_free(g);
+}
+
+static void test_find_no_ignore(void) {
+    TEST("find with no_ignore and braces");
+    ac_glob_pattern_t *g = ac_glob_pattern_compile("{build,docs}/*.{c,md}", NULL, 0);
+    ac_glob_find_options_t opts = { .no_ignore = 1 };
+    ac_glob_result_t r;
+    char names[1024] = "";
+    if (g && ac_glob_find(g_root, g, &opts, &r) == ARC_OK) {
+        result_names(&r, names, sizeof(names));
+        if (strcmp(names, "build/gen.c docs/notes.md") == 0) PASS(); else FAIL(names);
+        ac_glob_result_free(&r);
+    } else {
+        FAIL("find failed");
+    }
+    ac_glob_pattern_free(g);
+}
+
+static void test_find_errors(void) {
+    TEST("find errors");
+    ac_glob_pattern_t *g = ac_glob_pattern_compile("*.c", NULL, 0);
+    ac_glob_result_t r;
+    int ok = ac_glob_find(NULL, g, NULL, &r) == ARC_ERR_INVALID_ARG &&
+             ac_glob_find(at("missing"), g, NULL, &r) == ARC_ERR_IO;
+    ac_glob_pattern_free(g);
+    if (ok) PASS(); else FAIL("unexpected result");
+}
+
+int main(void) {
+    printf("=== Search Glob Tests ===\n\n");
+
+    snprintf(g_root, sizeof(g_root), "/tmp/arc_glob_test_XXXXXX");
+    if (!mkdtemp(g_root)) {
+        printf("Failed to create temp dir\n");
+        return 1;
+    }
+    /* Keep the user's global excludes out of the results */
+    setenv("HOME", g_root, 1);
+    unsetenv("XDG_CONFIG_HOME");
+
+    test_match_basic();
+    test_match_globstar();
+    test_match_unanchored();
+    test_match_braces();
+    test_can_descend();
+    test_compile_errors();
+
+    setup_tree();
+    test_find_order();
+    test_find_top_k();
+    test_find_hidden();
+    test_find_no_ignore();
+    test_find_errors();
+
+    char cmd[600];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", g_root);
+    if (system(cmd) != 0) {
+        printf("warning: could not remove %s\n", g_root);
+    }
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
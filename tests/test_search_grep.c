@@ -0,0 +1,282 @@
+/**
+ * @file test_search_grep.c
+ * @brief Tests for the content search engine (literals, case, lines, files)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <arc/grep.h>
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+/* Matches rendered as "line:text[start,end]" separated by '|' */
+typedef struct {
+    char text[1024];
+    int stop_after;
+    int seen;
+} collect_t;
+
+static int collect(const ac_grep_match_t *m, void *user_data) {
+    collect_t *c = (collect_t *)user_data;
+    size_t used = strlen(c->text);
+    snprintf(c->text + used, sizeof(c->text) - used, "%s%zu:%.*s[%zu,%zu]",
+             used ? "|" : "", m->line_number, (int)m->line_len, m->line,
+             m->match_start, m->match_end);
+    return c->stop_after && ++c->seen >= c->stop_after;
+}
+
+/* Search a string, return the rendered matches */
+static const char *run(const char *pattern, const ac_grep_options_t *opts, const char *text) {
+    static collect_t c;
+    memset(&c, 0, sizeof(c));
+    ac_grep_t *g = ac_grep_compile(pattern, opts, NULL, 0);
+    if (!g) return "<compile error>";
+    ac_grep_buffer(g, text, strlen(text), collect, &c);
+    ac_grep_free(g);
+    return c.text;
+}
+
+static const char *literal_of(const char *pattern, ac_grep_case_t case_mode) {
+    static char buf[300];
+    ac_grep_options_t opts = { .case_mode = case_mode };
+    ac_grep_t *g = ac_grep_compile(pattern, &opts, NULL, 0);
+    snprintf(buf, sizeof(buf), "%s", g ? ac_grep_literal(g) : "<error>");
+    ac_grep_free(g);
+    return buf;
+}
+
+static void expect(const char *got, const char *want) {
+    if (strcmp(got, want) == 0) {
+        PASS();
+    } else {
+        char msg[1200];
+        snprintf(msg, sizeof(msg), "got \"%s\", want \"%s\"", got, want);
+        FAIL(msg);
+    }
+}
+
+/*============================================================================
+ * Tests
+ *============================================================================*/
+
+static void test_literals(void) {
+    TEST("required literal extraction");
+    int ok = strcmp(literal_of("malloc\\s*\\(", AC_GREP_CASE_SENSITIVE), "malloc") == 0 &&
+             strcmp(literal_of("log.*Error", AC_GREP_CASE_SENSITIVE), "Error") == 0 &&
+             strcmp(literal_of("colou?r_name", AC_GREP_CASE_SENSITIVE), "r_name") == 0 &&
+             strcmp(literal_of("ab{0,2}cd", AC_GREP_CASE_SENSITIVE), "cd") == 0 &&
+             strcmp(literal_of("x{3}yz", AC_GREP_CASE_SENSITIVE), "yz") == 0 &&
+             strcmp(literal_of("a\\.b\\(c", AC_GREP_CASE_SENSITIVE), "a.b(c") == 0 &&
+             strcmp(literal_of("[a-z]+_init\\b", AC_GREP_CASE_SENSITIVE), "_init") == 0 &&
+             strcmp(literal_of("(foo|bar)baz", AC_GREP_CASE_SENSITIVE), "baz") == 0;
+    if (ok) PASS(); else FAIL("wrong literal");
+
+    TEST("no literal when one is not required");
+    ok = strcmp(literal_of("foo|bar", AC_GREP_CASE_SENSITIVE), "") == 0 &&
+         strcmp(literal_of("(?i)Foo", AC_GREP_CASE_SENSITIVE), "") == 0 &&
+         strcmp(literal_of("\\Qa.b\\E", AC_GREP_CASE_SENSITIVE), "") == 0 &&
+         strcmp(literal_of("\\w+", AC_GREP_CASE_SENSITIVE), "") == 0 &&
+         strcmp(literal_of("a*", AC_GREP_CASE_SENSITIVE), "") == 0;
+    if (ok) PASS(); else FAIL("unsafe literal");
+
+    TEST("caseless literal avoids folding ambiguities");
+    ok = strcmp(literal_of("TaskQueue", AC_GREP_CASE_INSENSITIVE), "queue") == 0 &&
+         strcmp(literal_of("caf\xc3\xa9_bar", AC_GREP_CASE_INSENSITIVE), "_bar") == 0;
+    if (ok) PASS(); else FAIL("caseless literal");
+
+    TEST("escape payloads are not literal");
+    ok = strcmp(literal_of("\\x41B", AC_GREP_CASE_SENSITIVE), "B") == 0 &&
+         strcmp(literal_of("foo\\x09bar", AC_GREP_CASE_SENSITIVE), "foo") == 0 &&
+         strcmp(literal_of("fo\\x{6f}bar", AC_GREP_CASE_SENSITIVE), "bar") == 0 &&
+         strcmp(literal_of("foo\\011bar", AC_GREP_CASE_SENSITIVE), "foo") == 0 &&
+         strcmp(literal_of("fo\\0157bar", AC_GREP_CASE_SENSITIVE), "bar") == 0 &&
+         strcmp(literal_of("foo\\cIbar", AC_GREP_CASE_SENSITIVE), "foo") == 0 &&
+         strcmp(literal_of("(?<q>x)\\k<q>yz", AC_GREP_CASE_SENSITIVE), "yz") == 0 &&
+         strcmp(literal_of("(?<q>x)\\k'q'yz", AC_GREP_CASE_SENSITIVE), "yz") == 0 &&
+         strcmp(literal_of("(a)\\g1yz", AC_GREP_CASE_SENSITIVE), "yz") == 0 &&
+         strcmp(literal_of("(a)\\g{-1}yz", AC_GREP_CASE_SENSITIVE), "yz") == 0 &&
+         strcmp(literal_of("\\pLyz", AC_GREP_CASE_SENSITIVE), "yz") == 0;
+    if (ok) PASS(); else FAIL("escape payload in literal");
+
+    TEST("escapes match the text they stand for");
+    ok = strcmp(run("\\x41B", NULL, "xAB\n"), "1:xAB[1,3]") == 0 &&
+         strcmp(run("foo\\x09bar", NULL, "foo\tbar\n"), "1:foo\tbar[0,7]") == 0 &&
+         strcmp(run("foo\\011bar", NULL, "foo\tbar\n"), "1:foo\tbar[0,7]") == 0 &&
+         strcmp(run("foo\\cIbar", NULL, "foo\tbar\n"), "1:foo\tbar[0,7]") == 0 &&
+         strcmp(run("(?<q>o)\\k<q>bar", NULL, "foobar\n"), "1:foobar[1,6]") == 0 &&
+         strcmp(run("(o)\\g1bar", NULL, "foobar\n"), "1:foobar[1,6]") == 0;
+    if (ok) PASS(); else FAIL("escape missed a match");
+
+    TEST("escape payloads do not turn on smart case");
+    ac_grep_options_t smart = { .case_mode = AC_GREP_CASE_SMART };
+    ok = strcmp(run("\\x41b", &smart, "AB\n"), "1:AB[0,2]") == 0 &&
+         strcmp(run("x\\cIy", &smart, "X\tY\n"), "1:X\tY[0,3]") == 0;
+    if (ok) PASS(); else FAIL("smart case");
+}
+
+static void test_lines(void) {
+    const char *text = "int main(void) {\n    char *p = malloc(16);\n    free(p);\n}\n";
+
+    TEST("plain literal");
+    expect(run("free", NULL, text), "3:    free(p);[4,8]");
+
+    TEST("regex confirmed after the prefilter");
+    expect(run("malloc\\s*\\(\\d+", NULL, text), "2:    char *p = malloc(16);[14,23]");
+
+    TEST("regex without a literal");
+    expect(run("^\\}$", NULL, text), "4:}[0,1]");
+
+    TEST("one report per line");
+    expect(run("o", NULL, "foo\nbar\nboo\n"), "1:foo[1,2]|3:boo[1,2]");
+
+    TEST("matches do not span lines");
+    expect(run("a\\s+b", NULL, "a\nb\na  b\n"), "3:a  b[0,4]");
+
+    TEST("anchors inside the buffer");
+    expect(run("^b", NULL, "ab\nbc\n"), "2:bc[0,1]");
+
+    TEST("last line without newline");
+    expect(run("end", NULL, "x\nthe end"), "2:the end[4,7]");
+
+    TEST("callback stops the search");
+    collect_t c;
+    memset(&c, 0, sizeof(c));
+    c.stop_after = 2;
+    ac_grep_t *g = ac_grep_compile("x", NULL, NULL, 0);
+    int n = ac_grep_buffer(g, "x\nx\nx\nx\n", 8, collect, &c);
+    ac_grep_free(g);
+    if (n == 2 && strcmp(c.text, "1:x[0,1]|2:x[0,1]") == 0) PASS(); else FAIL(c.text);
+}
+
+static void test_case(void) {
+    const char *text = "Error\nerror\nERROR\n";
+    ac_grep_options_t smart = { .case_mode = AC_GREP_CASE_SMART };
+    ac_grep_options_t icase = { .case_mode = AC_GREP_CASE_INSENSITIVE };
+
+    TEST("case sensitive by default");
+    expect(run("error", NULL, text), "2:error[0,5]");
+
+    TEST("smart case, lower-case pattern");
+    expect(run("error", &smart, text), "1:Error[0,5]|2:error[0,5]|3:ERROR[0,5]");
+
+    TEST("smart case, mixed-case pattern");
+    expect(run("Error", &smart, text), "1:Error[0,5]");
+
+    TEST("smart case ignores escapes");
+    expect(run("\\Serror", &smart, "xERROR\n"), "1:xERROR[0,6]");
+
+    TEST("caseless Unicode folding");
+    expect(run("\xc3\xa9t\xc3\xa9", &icase, "\xc3\x89T\xc3\x89\n"), "1:\xc3\x89T\xc3\x89[0,5]");
+
+    TEST("caseless k matches the Kelvin sign");
+    expect(run("kelvin", &icase, "\xe2\x84\xaa" "elvin\n"), "1:\xe2\x84\xaa" "elvin[0,8]");
+}
+
+static void test_modes(void) {
+    TEST("fixed strings");
+    ac_grep_options_t fixed = { .fixed_strings = 1 };
+    expect(run("a.b(", &fixed, "axb(\na.b(\n"), "2:a.b([0,4]");
+
+    TEST("fixed strings, case insensitive");
+    ac_grep_options_t fixed_i = { .fixed_strings = 1, .case_mode = AC_GREP_CASE_INSENSITIVE };
+    expect(run("A.B", &fixed_i, "axb\nxa.bx\n"), "2:xa.bx[1,4]");
+
+    TEST("multiline match reports its lines");
+    ac_grep_options_t multi = { .multiline = 1 };
+    expect(run("foo\\s+bar", &multi, "x\nfoo\n  bar y\nz\n"), "2:foo\n  bar y[0,9]");
+
+    TEST("invalid pattern reports an error");
+    char err[128] = "";
+    ac_grep_t *g = ac_grep_compile("a(b", NULL, err, sizeof(err));
+    if (!g && strstr(err, "offset")) PASS(); else FAIL(err);
+    ac_grep_free(g);
+}
+
+static void test_files(void) {
+    char dir[] = "/tmp/arc_grep_test_XXXXXX";
+    if (!mkdtemp(dir)) {
+        printf("Failed to create temp dir\n");
+        return;
+    }
+    char big[256], bin[256];
+    snprintf(big, sizeof(big), "%s/big.txt", dir);
+    snprintf(bin, sizeof(bin), "%s/bin.dat", dir);
+
+    /* Large enough to be mapped rather than read */
+    FILE *f = fopen(big, "w");
+    for (int i = 1; i <= 20000; i++) {
+        fprintf(f, i == 15000 ? "line %d needle\n" : "line %d\n", i);
+    }
+    fclose(f);
+    f = fopen(bin, "wb");
+    fwrite("needle\0\1\2", 1, 9, f);
+    fclose(f);
+
+    TEST("mapped file with line numbers");
+    collect_t c;
+    memset(&c, 0, sizeof(c));
+    ac_grep_t *g = ac_grep_compile("needle", NULL, NULL, 0);
+    int n = ac_grep_file(g, big, collect, &c);
+    if (n == 1 && strcmp(c.text, "15000:line 15000 needle[11,17]") == 0) PASS(); else FAIL(c.text);
+
+    TEST("binary file skipped");
+    memset(&c, 0, sizeof(c));
+    n = ac_grep_file(g, bin, collect, &c);
+    if (n == AC_GREP_SKIPPED && c.text[0] == '\0') PASS(); else FAIL("binary searched");
+
+    TEST("missing file");
+    n = ac_grep_file(g, "/nonexistent/file", collect, &c);
+    if (n == AC_GREP_ERROR) PASS(); else FAIL("no error");
+    ac_grep_free(g);
+
+    TEST("max_filesize skips large files");
+    ac_grep_options_t small = { .max_filesize = 1024 };
+    g = ac_grep_compile("needle", &small, NULL, 0);
+    n = ac_grep_file(g, big, collect, &c);
+    if (n == AC_GREP_SKIPPED) PASS(); else FAIL("large file searched");
+    ac_grep_free(g);
+
+    remove(big);
+    remove(bin);
+    rmdir(dir);
+}
+
+int main(void) {
+    printf("=== Search Grep Tests ===\n\n");
+
+    test_literals();
+    test_lines();
+    test_case();
+    test_modes();
+    test_files();
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
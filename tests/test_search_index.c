@@ -0,0 +1,425 @@
+/**
+ * @file test_search_index.c
+ * @brief Tests for the persistent trigram index
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <arc/search_index.h>
+
+#include "index_fixture.h"
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+static void setup_tree(void) {
+    mkdir(at(".git"), 0755);
+    mkdir(at("src"), 0755);
+    mkdir(at("docs"), 0755);
+    mkdir(at("build"), 0755);
+    write_file(".gitignore", "build/\n", 1000);
+    write_file("src/main.c", "int main(void) { return hello_world(); }\n", 1000);
+    write_file("src/hello.c", "int Hello_World(void) { return 0; }\n", 1000);
+    write_file("src/util.c", "static int helper(int x) { return x; }\n", 1000);
+    write_file("docs/notes.md", "Nothing to see here.\n", 1000);
+    write_file("build/gen.c", "int hello_world_generated;\n", 1000);
+}
+
+static ac_search_index_options_t default_options(void) {
+    ac_search_index_options_t opts = { .cache_dir = g_cache };
+    return opts;
+}
+
+/* Candidate paths, space separated; "-" for a full-scan answer */
+static void query_names(ac_search_index_t *idx, const char *literal, char *out, size_t size) {
+    ac_search_index_result_t r;
+    out[0] = '\0';
+    if (!ac_search_index_query(idx, literal, strlen(literal), &r)) {
+        snprintf(out, size, "-");
+        return;
+    }
+    for (size_t i = 0; i < r.count; i++) {
+        size_t used = strlen(out);
+        snprintf(out + used, size - used, "%s%s", i ? " " : "", r.paths[i]);
+    }
+    ac_search_index_result_free(&r);
+}
+
+/* Path of the single index file in the cache directory */
+static int index_file_path(char *out, size_t size) {
+    DIR *d = opendir(g_cache);
+    if (!d) return -1;
+    struct dirent *e;
+    int found = -1;
+    while ((e = readdir(d)) != NULL) {
+        size_t len = strlen(e->d_name);
+        if (len > 4 && strcmp(e->d_name + len - 4, ".idx") == 0) {
+            snprintf(out, size, "%s/%s", g_cache, e->d_name);
+            found = 0;
+        }
+    }
+    closedir(d);
+    return found;
+}
+
+/*============================================================================
+ * Build and Query
+ *============================================================================*/
+
+static void test_build(void) {
+    TEST("build");
+    ac_search_index_options_t opts = default_options();
+    ac_search_index_t *idx = NULL;
+    if (ac_search_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    ac_search_index_stats_t st;
+    ac_search_index_stats(idx, &st);
+    char path[600];
+    /* .gitignore is hidden and build/ is ignored */
+    if (st.files == 4 && st.writes == 1 && st.trigrams > 0 && !st.stale &&
+        index_file_path(path, sizeof(path)) == 0) {
+        PASS();
+    } else {
+        FAIL("unexpected stats");
+    }
+    ac_search_index_close(idx);
+}
+
+static void test_query_candidates(void) {
+    TEST("query candidates");
+    ac_search_index_options_t opts = default_options();
+    ac_search_index_t *idx = NULL;
+    if (ac_search_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    char names[512];
+    query_names(idx, "return x", names, sizeof(names));
+    if (strcmp(names, "src/util.c") == 0) PASS(); else FAIL(names);
+    ac_search_index_close(idx);
+}
+
+static void test_query_case_folded(void) {
+    TEST("query case folded");
+    ac_search_index_options_t opts = default_options();
+    ac_search_index_t *idx = NULL;
+    if (ac_search_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    char lower[512], upper[512];
+    query_names(idx, "hello_world", lower, sizeof(lower));
+    query_names(idx, "HELLO_WORLD", upper, sizeof(upper));
+    int ok = (strcmp(lower, "src/main.c src/hello.c") == 0 ||
+              strcmp(lower, "src/hello.c src/main.c") == 0) &&
+             strcmp(lower, upper) == 0;
+    if (ok) PASS(); else FAIL(lower);
+    ac_search_index_close(idx);
+}
+
+static void test_query_fallback(void) {
+    TEST("short literal and missing trigram");
+    ac_search_index_options_t opts = default_options();
+    ac_search_index_t *idx = NULL;
+    if (ac_search_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    char shortq[64], missing[64];
+    query_names(idx, "he", shortq, sizeof(shortq));
+    query_names(idx, "zzqqxx", missing, sizeof(missing));
+    if (strcmp(shortq, "-") == 0 && strcmp(missing, "") == 0) PASS();
+    else FAIL("unexpected answers");
+    ac_search_index_close(idx);
+}
+
+/*============================================================================
+ * Updates
+ *============================================================================*/
+
+static void test_reopen_reuses_file(void) {
+    TEST("reopen reuses index file");
+    ac_search_index_options_t opts = default_options();
+    ac_search_index_t *idx = NULL;
+    if (ac_search_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    ac_search_index_stats_t st;
+    ac_search_index_stats(idx, &st);
+    if (st.writes == 0 && st.files == 4) PASS(); else FAIL("index was rewritten");
+    ac_search_index_close(idx);
+}
+
+static void test_changes_without_watch(void) {
+    TEST("changes without watch");
+    ac_search_index_options_t opts = default_options();
+    ac_search_index_t *idx = NULL;
+    if (ac_search_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    write_file("docs/notes.md", "Now mentions hello_world too.\n", 2000);
+    write_file("src/new.c", "void hello_world_new(void);\n", 2000);
+    unlink(at("src/hello.c"));
+
+    char names[512];
+    query_names(idx, "hello_world", names, sizeof(names));
+    ac_search_index_stats_t st;
+    ac_search_index_stats(idx, &st);
+    /* Indexed hits first, then the changed files, sorted */
+    if (strcmp(names, "src/main.c docs/notes.md src/new.c") == 0 && st.dirty == 3 && st.writes == 0) {
+        PASS();
+    } else {
+        FAIL(names);
+    }
+    ac_search_index_close(idx);
+}
+
+static void test_rewrite_reuses_postings(void) {
+    TEST("rewrite reuses postings");
+    ac_search_index_options_t opts = default_options();
+    ac_search_index_t *idx = NULL;
+    if (ac_search_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    /* Enough new files to pass the dirty limit */
+    mkdir(at("gen"), 0755);
+    for (int i = 0; i < 80; i++) {
+        char rel[64], body[64];
+        snprintf(rel, sizeof(rel), "gen/file%02d.c", i);
+        snprintf(body, sizeof(body), "int generated_%02d;\n", i);
+        write_file(rel, body, 3000);
+    }
+    char names[512];
+    query_names(idx, "generated_42", names, sizeof(names));
+    ac_search_index_stats_t st;
+    ac_search_index_stats(idx, &st);
+    /* src/main.c and src/util.c were carried over without reading */
+    if (strcmp(names, "gen/file42.c") == 0 && st.writes == 1 && st.dirty == 0 &&
+        st.files == 84 && st.reused == 2) {
+        PASS();
+    } else {
+        FAIL(names);
+    }
+    ac_search_index_close(idx);
+}
+
+static void test_watch_events(void) {
+    TEST("watch events");
+    ac_search_index_options_t opts = default_options();
+    opts.watch = 1;
+    ac_search_index_t *idx = NULL;
+    if (ac_search_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    ac_search_index_stats_t st;
+    ac_search_index_stats(idx, &st);
+    if (!st.watching) {
+        printf("(inotify unavailable) ");
+        PASS();
+        ac_search_index_close(idx);
+        return;
+    }
+
+    /* Same size and mtime: only the event reveals the edit */
+    struct stat before;
+    stat(at("src/util.c"), &before);
+    FILE *f = fopen(at("src/util.c"), "r+");
+    if (f) {
+        fputs("static int watched", f);
+        fclose(f);
+    }
+    struct timeval tv[2] = { { before.st_mtime, 0 }, { before.st_mtime, 0 } };
+    utimes(at("src/util.c"), tv);
+    write_file("gen/created.c", "int watched_created;\n", 4000);
+
+    char names[512];
+    query_names(idx, "watched", names, sizeof(names));
+    ac_search_index_stats(idx, &st);
+    if (strcmp(names, "gen/created.c src/util.c") == 0 && st.writes == 0) PASS(); else FAIL(names);
+    ac_search_index_close(idx);
+}
+
+static void test_watch_ignore_files(void) {
+    TEST("watch picks up ignore file edits");
+    mkdir(at(".git/info"), 0755);
+    write_file(".git/info/exclude", "docs/\n", 1000);
+    write_file("src/.ignore", "util.c\n", 1000);
+    char path[512];
+    if (index_file_path(path, sizeof(path)) == 0) unlink(path);   /* Built fresh: nothing dirty */
+    ac_search_index_options_t opts = default_options();
+    opts.watch = 1;
+    ac_search_index_t *idx = NULL;
+    if (ac_search_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    ac_search_index_stats_t st;
+    ac_search_index_stats(idx, &st);
+    if (!st.watching) {
+        printf("(inotify unavailable) ");
+        PASS();
+        ac_search_index_close(idx);
+        unlink(at(".git/info/exclude"));
+        unlink(at("src/.ignore"));
+        return;
+    }
+
+    /* Each ignored file shows up once its rule is gone */
+    char before[512], gitignore[512], exclude[512], dot_ignore[512];
+    query_names(idx, "hello_world_generated", before, sizeof(before));
+    size_t used = strlen(before);
+    query_names(idx, "Nothing", before + used, sizeof(before) - used);
+    used = strlen(before);
+    query_names(idx, "helper", before + used, sizeof(before) - used);
+
+    write_file(".gitignore", "# nothing ignored\n", 5000);
+    query_names(idx, "hello_world_generated", gitignore, sizeof(gitignore));
+    write_file(".git/info/exclude", "", 5000);
+    query_names(idx, "Nothing", exclude, sizeof(exclude));
+    unlink(at("src/.ignore"));
+    query_names(idx, "helper", dot_ignore, sizeof(dot_ignore));
+
+    if (before[0] == '\0' && strstr(gitignore, "build/gen.c") && strstr(exclude, "docs/notes.md") &&
+        strstr(dot_ignore, "src/util.c")) {
+        PASS();
+    } else {
+        char msg[2100];
+        snprintf(msg, sizeof(msg), "[%s] [%s] [%s] [%s]", before, gitignore, exclude, dot_ignore);
+        FAIL(msg);
+    }
+    ac_search_index_close(idx);
+
+    /* Back to the tree the other tests expect */
+    unlink(at(".git/info/exclude"));
+    write_file(".gitignore", "build/\n", 1000);
+}
+
+static void test_unindexed_and_binary(void) {
+    TEST("large and binary files");
+    FILE *f = fopen(at("src/blob.bin"), "wb");
+    if (f) {
+        fwrite("abc\0needle_bin", 1, 14, f);
+        fclose(f);
+    }
+    write_file("src/large.txt", "a file with more than forty-four bytes in it, really\n", 5000);
+
+    ac_search_index_options_t opts = default_options();
+    opts.max_file_size = 44;
+    char cache[400];
+    snprintf(cache, sizeof(cache), "%s/small", g_cache);
+    opts.cache_dir = cache;
+    ac_search_index_t *idx = NULL;
+    if (ac_search_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    char names[512];
+    query_names(idx, "needle_bin", names, sizeof(names));
+    /* Unindexed files are candidates for any literal; binaries never */
+    if (strcmp(names, "src/large.txt") == 0) PASS(); else FAIL(names);
+    ac_search_index_close(idx);
+}
+
+static void test_corrupt_index(void) {
+    TEST("corrupt index is rebuilt");
+    char path[600];
+    if (index_file_path(path, sizeof(path)) != 0) {
+        FAIL("no index file");
+        return;
+    }
+    FILE *f = fopen(path, "r+b");
+    if (f) {
+        fseek(f, 100, SEEK_SET);
+        fputs("garbage", f);
+        fseek(f, 0, SEEK_SET);
+        fputs("BADMAGIC", f);
+        fclose(f);
+    }
+    ac_search_index_options_t opts = default_options();
+    ac_search_index_t *idx = NULL;
+    if (ac_search_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    ac_search_index_stats_t st;
+    ac_search_index_stats(idx, &st);
+    char names[512];
+    query_names(idx, "return x", names, sizeof(names));
+    if (st.writes == 1 && st.reused == 0 && strcmp(names, "src/util.c") == 0) PASS(); else FAIL(names);
+    ac_search_index_close(idx);
+}
+
+static void test_errors(void) {
+    TEST("errors");
+    ac_search_index_options_t opts = default_options();
+    ac_search_index_t *idx = NULL;
+    ac_search_index_result_t r;
+    int ok = ac_search_index_open(NULL, &opts, &idx) == ARC_ERR_INVALID_ARG &&
+             ac_search_index_open(at("missing"), &opts, &idx) == ARC_ERR_IO &&
+             ac_search_index_open(at("src/main.c"), &opts, &idx) == ARC_ERR_IO &&
+             idx == NULL &&
+             ac_search_index_query(NULL, "abc", 3, &r) == 0 && r.count == 0 &&
+             ac_search_index_refresh(NULL) == ARC_ERR_INVALID_ARG;
+    ac_search_index_close(NULL);
+    if (ok) PASS(); else FAIL("unexpected result");
+}
+
+int main(void) {
+    printf("=== Search Index Tests ===\n\n");
+
+    if (fixture_create("index_test") != 0) return 1;
+
+    setup_tree();
+    test_build();
+    test_query_candidates();
+    test_query_case_folded();
+    test_query_fallback();
+    test_reopen_reuses_file();
+    test_changes_without_watch();
+    test_rewrite_reuses_postings();
+    test_watch_events();
+    test_watch_ignore_files();
+    test_unindexed_and_binary();
+    test_corrupt_index();
+    test_errors();
+
+    fixture_remove();
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
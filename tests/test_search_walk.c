@@ -0,0 +1,269 @@
+/**
+ * @file test_search_walk.c
+ * @brief Tests for the directory walker (ignore rules, ordering, threads)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <arc/walk.h>
+#include "search_internal.h"
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+static char g_root[256];
+
+static const char *at(const char *rel) {
+    static char path[512];
+    snprintf(path, sizeof(path), "%s/%s", g_root, rel);
+    return path;
+}
+
+static void make_dir(const char *rel) {
+    mkdir(at(rel), 0755);
+}
+
+static void write_file(const char *rel, const char *content) {
+    FILE *f = fopen(at(rel), "w");
+    if (f) {
+        fputs(content, f);
+        fclose(f);
+    }
+}
+
+/* Entries as "rel" or "rel/" for directories, space separated */
+typedef struct {
+    char *text;
+    size_t len;
+    size_t cap;
+    const char *skip;                   /* Directory to skip */
+    int stop_after;
+    int seen;
+} listing_t;
+
+static int list_entry(const ac_walk_entry_t *e, void *user_data) {
+    listing_t *l = (listing_t *)user_data;
+    size_t need = strlen(e->rel_path) + 3;
+    if (l->len + need >= l->cap) {
+        l->cap = (l->cap + need) * 2;
+        l->text = realloc(l->text, l->cap);
+    }
+    l->len += (size_t)sprintf(l->text + l->len, "%s%s%s", l->len ? " " : "",
+                              e->rel_path, e->type == AC_WALK_DIR ? "/" : "");
+    if (l->stop_after && ++l->seen >= l->stop_after) return AC_WALK_STOP;
+    if (l->skip && strcmp(e->rel_path, l->skip) == 0) return AC_WALK_SKIP;
+    return AC_WALK_CONTINUE;
+}
+
+/* Walk and return the listing (caller frees) */
+static char *walk_list(const char *root, const ac_walk_options_t *opts, const char *skip, int stop_after) {
+    listing_t l = { .skip = skip, .stop_after = stop_after };
+    l.cap = 256;
+    l.text = calloc(1, l.cap);
+    ac_walk(root, opts, list_entry, &l);
+    return l.text;
+}
+
+static void expect_listing(const char *root, const ac_walk_options_t *opts, const char *want) {
+    char *got = walk_list(root, opts, NULL, 0);
+    if (strcmp(got, want) == 0) {
+        PASS();
+    } else {
+        printf("FAIL:\n  got:  %s\n  want: %s\n", got, want);
+    }
+    free(got);
+}
+
+/*============================================================================
+ * Tests
+ *============================================================================*/
+
+static void test_globs(void) {
+    TEST("glob matching");
+    struct { const char *pattern, *path; int match; } cases[] = {
+        { "*.o", "a.o", 1 }, { "*.o", "dir/a.o", 0 }, { "a?c", "abc", 1 },
+        { "a?c", "a/c", 0 }, { "[a-c]x", "bx", 1 }, { "[!a-c]x", "bx", 0 },
+        { "**/foo", "foo", 1 }, { "**/foo", "a/b/foo", 1 }, { "a/**", "a/b/c", 1 },
+        { "a/**/b", "a/b", 1 }, { "a/**/b", "a/x/y/b", 1 }, { "a/**/b", "a/x/c", 0 },
+        { "build*", "build.log", 1 }, { "build*", "build/x", 0 }, { "\\*x", "*x", 1 },
+        { "[abc", "[abc", 1 }, { "*foo*bar", "xfooybar", 1 },
+    };
+    int ok = 1;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        ac_glob_t g;
+        ac_glob_compile(&g, cases[i].pattern, strlen(cases[i].pattern));
+        int m = ac_glob_match(&g, cases[i].path, strlen(cases[i].path));
+        ac_glob_free(&g);
+        if (m != cases[i].match) {
+            printf("[%s vs %s] ", cases[i].pattern, cases[i].path);
+            ok = 0;
+        }
+    }
+    if (ok) PASS(); else FAIL("glob mismatch");
+}
+
+static void test_ignore_rules(void) {
+    ac_walk_options_t opts = { .threads = 1 };
+
+    TEST("gitignore, .ignore and nested rules");
+    expect_listing(g_root, &opts,
+        "a.c docs/ docs/guide.md docs/x/ keep.o sub/ sub/b.o sub/c.c sub/top_only.txt");
+
+    TEST("hidden entries, never .git");
+    ac_walk_options_t hidden = { .threads = 1, .hidden = 1 };
+    expect_listing(g_root, &hidden,
+        ".gitignore .hidden .ignore a.c docs/ docs/guide.md docs/x/ keep.o sub/ sub/.gitignore "
+        "sub/b.o sub/c.c sub/top_only.txt");
+
+    TEST("no_ignore");
+    ac_walk_options_t all = { .threads = 1, .no_ignore = 1 };
+    expect_listing(g_root, &all,
+        "a.c a.o build/ build/x.c docs/ docs/guide.md docs/x/ docs/x/y.tmp docs/z.tmp keep.o "
+        "secret.txt sub/ sub/b.o sub/build/ sub/c.c sub/top_only.txt top_only.txt");
+
+    TEST("extra ignore globs");
+    const char *globs[] = { "*.c", "docs/" };
+    ac_walk_options_t extra = { .threads = 1, .ignore_globs = globs, .ignore_globs_count = 2 };
+    expect_listing(g_root, &extra, "keep.o sub/ sub/b.o sub/top_only.txt");
+
+    TEST("rules from above the root");
+    char docs[512];
+    snprintf(docs, sizeof(docs), "%s", at("docs"));
+    expect_listing(docs, &opts, "guide.md x/");
+}
+
+static void test_control(void) {
+    TEST("max depth");
+    ac_walk_options_t shallow = { .threads = 1, .max_depth = 1 };
+    expect_listing(g_root, &shallow, "a.c docs/ keep.o sub/");
+
+    TEST("skip a directory");
+    ac_walk_options_t opts = { .threads = 2 };
+    char *got = walk_list(g_root, &opts, "docs", 0);
+    if (strcmp(got, "a.c docs/ keep.o sub/ sub/b.o sub/c.c sub/top_only.txt") == 0) PASS(); else FAIL(got);
+    free(got);
+
+    TEST("stop the walk");
+    got = walk_list(g_root, &opts, NULL, 3);
+    if (strcmp(got, "a.c docs/ docs/guide.md") == 0) PASS(); else FAIL(got);
+    free(got);
+
+    TEST("file as root");
+    got = walk_list(at("a.c"), &opts, NULL, 0);
+    if (strcmp(got, "a.c") == 0) PASS(); else FAIL(got);
+    free(got);
+
+    TEST("missing root");
+    listing_t l = {0};
+    if (ac_walk(at("missing"), &opts, list_entry, &l) == ARC_ERR_IO) PASS(); else FAIL("no error");
+}
+
+static void test_threads(void) {
+    char rel[128];
+    make_dir("wide");
+    for (int d = 0; d < 60; d++) {
+        snprintf(rel, sizeof(rel), "wide/d%02d", d);
+        make_dir(rel);
+        for (int s = 0; s < 3; s++) {
+            snprintf(rel, sizeof(rel), "wide/d%02d/s%d", d, s);
+            make_dir(rel);
+            for (int f = 0; f < 10; f++) {
+                snprintf(rel, sizeof(rel), "wide/d%02d/s%d/f%d.%s", d, s, f, f == 3 ? "o" : "c");
+                write_file(rel, "x");
+            }
+        }
+    }
+
+    TEST("same order with any number of threads");
+    ac_walk_options_t one = { .threads = 1 };
+    ac_walk_options_t many = { .threads = 8 };
+    char *serial = walk_list(at("wide"), &one, NULL, 0);
+    int ok = 1;
+    for (int round = 0; round < 20 && ok; round++) {
+        char *parallel = walk_list(at("wide"), &many, NULL, 0);
+        ok = strcmp(serial, parallel) == 0;
+        free(parallel);
+    }
+    /* 60 + 180 directories, 1800 files minus the ignored *.o */
+    int entries = 1;
+    for (const char *p = serial; *p; p++) entries += *p == ' ';
+    if (ok && entries == 60 + 180 + 1620) PASS(); else FAIL("order or count differs");
+    free(serial);
+}
+
+int main(void) {
+    printf("=== Search Walk Tests ===\n\n");
+
+    snprintf(g_root, sizeof(g_root), "/tmp/arc_walk_test_XXXXXX");
+    if (!mkdtemp(g_root)) {
+        printf("Failed to create temp dir\n");
+        return 1;
+    }
+    /* Keep the user's global excludes out of the results */
+    setenv("HOME", g_root, 1);
+    unsetenv("XDG_CONFIG_HOME");
+
+    make_dir(".git");
+    make_dir("build");
+    make_dir("docs");
+    make_dir("docs/x");
+    make_dir("sub");
+    make_dir("sub/build");
+    write_file(".gitignore", "# objects\n*.o\n!keep.o\nbuild/\n/top_only.txt\ndocs/**/*.tmp\n");
+    write_file(".ignore", "secret*\n");
+    write_file("sub/.gitignore", "!*.o\n");
+    write_file(".hidden", "");
+    write_file("a.c", "");
+    write_file("a.o", "");
+    write_file("keep.o", "");
+    write_file("secret.txt", "");
+    write_file("top_only.txt", "");
+    write_file("build/x.c", "");
+    write_file("docs/guide.md", "");
+    write_file("docs/z.tmp", "");
+    write_file("docs/x/y.tmp", "");
+    write_file("sub/b.o", "");
+    write_file("sub/c.c", "");
+    write_file("sub/top_only.txt", "");
+
+    test_globs();
+    test_ignore_rules();
+    test_control();
+    test_threads();
+
+    char cmd[600];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", g_root);
+    if (system(cmd) != 0) {
+        printf("warning: could not remove %s\n", g_root);
+    }
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
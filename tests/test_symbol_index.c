@@ -0,0 +1,505 @@
+/**
+ * @file test_symbol_index.c
+ * @brief Tests for the persistent symbol index
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <arc/symbol_index.h>
+
+#include "index_fixture.h"
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+static ac_symbol_index_options_t default_options(void) {
+    ac_symbol_index_options_t opts = { .cache_dir = g_cache };
+    return opts;
+}
+
+/* "path:line:kind:role[:scope]" of every match, space separated */
+static void describe(const ac_symbol_result_t *r, char *out, size_t size) {
+    static const char roles[] = "?DC?R";
+    out[0] = '\0';
+    size_t len = 0;
+    for (size_t i = 0; i < r->count && len < size; i++) {
+        const ac_symbol_t *s = &r->symbols[i];
+        len += (size_t)snprintf(out + len, size - len, "%s%s:%u:%s:%c%s%s", i ? " " : "", s->path,
+                                s->line, ac_symbol_kind_name(s->kind), roles[s->role],
+                                s->scope[0] ? ":" : "", s->scope);
+    }
+}
+
+static int find_is(ac_symbol_index_t *idx, const char *name, int flags, const char *expected,
+                   char *got, size_t size) {
+    ac_symbol_result_t r;
+    if (ac_symbol_index_find(idx, name, flags, 0, &r) != ARC_OK) {
+        snprintf(got, size, "find failed");
+        return 0;
+    }
+    describe(&r, got, size);
+    ac_symbol_result_free(&r);
+    return strcmp(got, expected) == 0;
+}
+
+static const char g_header[] =
+    "#define MAX_ITEMS 16\n"
+    "typedef struct item {\n"
+    "    int id;\n"
+    "    struct item *next;\n"
+    "} item_t;\n"
+    "enum color { RED, GREEN };\n"
+    "extern int item_count;\n"
+    "item_t *item_new(int id);\n";
+
+static const char g_source[] =
+    "#include \"item.h\"\n"
+    "int item_count = 0;\n"
+    "static int (*hook)(int);\n"
+    "item_t *item_new(int id) {\n"
+    "    item_t *it = alloc(sizeof(item_t));\n"
+    "    it->id = id;\n"
+    "    item_count++;\n"
+    "    return it;\n"
+    "}\n";
+
+static void setup_tree(void) {
+    mkdir(at(".git"), 0755);
+    mkdir(at("src"), 0755);
+    mkdir(at("build"), 0755);
+    mkdir(at("py"), 0755);
+    write_file(".gitignore", "build/\n", 1000);
+    write_file("src/item.h", g_header, 1000);
+    write_file("src/item.c", g_source, 1000);
+    write_file("build/gen.c", "int item_new_generated;\n", 1000);
+    write_file("py/shop.py",
+               "class Cart:\n"
+               "    def add(self, item):\n"
+               "        total = item.price  # item_new in a comment\n"
+               "        return 'item_new in a string'\n"
+               "\n"
+               "def checkout(cart):\n"
+               "    return cart.add(None)\n", 1000);
+    write_file("README.md", "item_new is documented here\n", 1000);
+}
+
+/*============================================================================
+ * Extraction
+ *============================================================================*/
+
+static void test_c_definitions(void) {
+    TEST("C definitions and declarations");
+    ac_symbol_index_options_t opts = default_options();
+    ac_symbol_index_t *idx = NULL;
+    if (ac_symbol_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    char got[1024];
+    int defs = AC_SYMBOL_DEFINITION | AC_SYMBOL_DECLARATION;
+    int ok = find_is(idx, "item_new", defs,
+                     "src/item.c:4:function:D src/item.h:8:function:C", got, sizeof(got)) &&
+             find_is(idx, "item_count", defs,
+                     "src/item.c:2:variable:D src/item.h:7:variable:C", got, sizeof(got)) &&
+             find_is(idx, "item", defs, "src/item.h:2:struct:D", got, sizeof(got)) &&
+             find_is(idx, "item_t", defs, "src/item.h:5:typedef:D", got, sizeof(got)) &&
+             find_is(idx, "next", defs, "src/item.h:4:field:D:item", got, sizeof(got)) &&
+             find_is(idx, "GREEN", defs, "src/item.h:6:enumerator:D:color", got, sizeof(got)) &&
+             find_is(idx, "MAX_ITEMS", defs, "src/item.h:1:macro:D", got, sizeof(got)) &&
+             find_is(idx, "hook", defs, "src/item.c:3:variable:D", got, sizeof(got)) &&
+             find_is(idx, "it", defs, "src/item.c:5:variable:D:item_new", got, sizeof(got)) &&
+             /* Parameters of prototypes are left out */
+             find_is(idx, "id", AC_SYMBOL_DEFINITION,
+                     "src/item.c:4:parameter:D:item_new src/item.h:3:field:D:item", got, sizeof(got));
+    ac_symbol_index_close(idx);
+    if (ok) PASS(); else FAIL(got);
+}
+
+static void test_c_references(void) {
+    TEST("C references");
+    ac_symbol_index_options_t opts = default_options();
+    ac_symbol_index_t *idx = NULL;
+    if (ac_symbol_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    char got[1024];
+    int ok = find_is(idx, "item_count", AC_SYMBOL_REFERENCE,
+                     "src/item.c:7:name:R:item_new", got, sizeof(got)) &&
+             find_is(idx, "item_t", AC_SYMBOL_REFERENCE,
+                     "src/item.c:4:name:R src/item.c:5:name:R:item_new src/item.c:5:name:R:item_new "
+                     "src/item.h:8:name:R", got, sizeof(got)) &&
+             /* Ignored directories, strings and other languages do not count */
+             find_is(idx, "item_new", AC_SYMBOL_ALL,
+                     "src/item.c:4:function:D src/item.h:8:function:C", got, sizeof(got)) &&
+             find_is(idx, "alloc", AC_SYMBOL_ALL, "src/item.c:5:name:R:item_new", got, sizeof(got));
+    ac_symbol_index_close(idx);
+    if (ok) PASS(); else FAIL(got);
+}
+
+static void test_python(void) {
+    TEST("Python definitions and scopes");
+    ac_symbol_index_options_t opts = default_options();
+    ac_symbol_index_t *idx = NULL;
+    if (ac_symbol_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    char got[1024];
+    int ok = find_is(idx, "Cart", AC_SYMBOL_ALL, "py/shop.py:1:class:D", got, sizeof(got)) &&
+             find_is(idx, "add", AC_SYMBOL_ALL,
+                     "py/shop.py:2:function:D:Cart py/shop.py:7:name:R:checkout", got, sizeof(got)) &&
+             find_is(idx, "checkout", AC_SYMBOL_ALL, "py/shop.py:6:function:D", got, sizeof(got)) &&
+             find_is(idx, "item", AC_SYMBOL_REFERENCE,
+                     "py/shop.py:2:name:R:add py/shop.py:3:name:R:add src/item.h:4:name:R:item",
+                     got, sizeof(got));
+    ac_symbol_index_close(idx);
+    if (ok) PASS(); else FAIL(got);
+}
+
+static void test_other_languages(void) {
+    TEST("JavaScript, Go and Rust");
+    mkdir(at("more"), 0755);
+    write_file("more/app.ts",
+               "export class Store {\n"
+               "  load() { return fetchAll(`fetchAll ${x}`); }\n"
+               "}\n"
+               "const limit = 10;\n"
+               "function* fetchAll() {}\n", 1000);
+    write_file("more/main.go",
+               "package main\n"
+               "type Server struct { port int }\n"
+               "func (s *Server) Listen() error { return listen(s.port) }\n"
+               "func listen(port int) error { return nil }\n", 1000);
+    write_file("more/lib.rs",
+               "struct Parser<'a> { input: &'a str }\n"
+               "fn parse<'a>(text: &'a str) -> Parser<'a> {\n"
+               "    let mut parser = Parser { input: text };\n"
+               "    parser\n"
+               "}\n", 1000);
+
+    ac_symbol_index_options_t opts = default_options();
+    ac_symbol_index_t *idx = NULL;
+    if (ac_symbol_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    char got[1024];
+    int ok = find_is(idx, "fetchAll", AC_SYMBOL_ALL,
+                     "more/app.ts:5:function:D more/app.ts:2:name:R:Store", got, sizeof(got)) &&
+             find_is(idx, "limit", AC_SYMBOL_ALL, "more/app.ts:4:variable:D", got, sizeof(got)) &&
+             find_is(idx, "Listen", AC_SYMBOL_ALL, "more/main.go:3:function:D", got, sizeof(got)) &&
+             find_is(idx, "listen", AC_SYMBOL_ALL,
+                     "more/main.go:4:function:D more/main.go:3:name:R:Listen", got, sizeof(got)) &&
+             find_is(idx, "Server", AC_SYMBOL_DEFINITION, "more/main.go:2:typedef:D", got, sizeof(got)) &&
+             find_is(idx, "parser", AC_SYMBOL_ALL,
+                     "more/lib.rs:3:variable:D:parse more/lib.rs:4:name:R:parse", got, sizeof(got)) &&
+             find_is(idx, "a", AC_SYMBOL_ALL, "", got, sizeof(got));
+    ac_symbol_index_close(idx);
+    if (ok) PASS(); else FAIL(got);
+}
+
+/*============================================================================
+ * Queries
+ *============================================================================*/
+
+static void test_file_symbols(void) {
+    TEST("file outline");
+    ac_symbol_index_options_t opts = default_options();
+    ac_symbol_index_t *idx = NULL;
+    if (ac_symbol_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    ac_symbol_result_t r;
+    char got[1024] = "";
+    int ok = ac_symbol_index_file_symbols(idx, "src/item.h", &r) == ARC_OK;
+    if (ok) {
+        for (size_t i = 0, len = 0; i < r.count; i++) {
+            len += (size_t)snprintf(got + len, sizeof(got) - len, "%s%s", i ? " " : "", r.symbols[i].name);
+        }
+        ac_symbol_result_free(&r);
+    }
+    ok = ok && strcmp(got, "MAX_ITEMS item id next item_t color RED GREEN item_count item_new") == 0 &&
+         ac_symbol_index_file_symbols(idx, "build/gen.c", &r) == ARC_ERR_NOT_FOUND &&
+         ac_symbol_index_file_symbols(idx, "README.md", &r) == ARC_ERR_NOT_FOUND;
+    ac_symbol_index_close(idx);
+    if (ok) PASS(); else FAIL(got);
+}
+
+static void test_ignore_case_and_limit(void) {
+    TEST("ignore case and limit");
+    ac_symbol_index_options_t opts = default_options();
+    ac_symbol_index_t *idx = NULL;
+    if (ac_symbol_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    char got[1024];
+    ac_symbol_result_t r;
+    /* Python parameters are plain names: the lexical scan has no parameter kind */
+    int ok = find_is(idx, "cart", AC_SYMBOL_ALL,
+                     "py/shop.py:6:name:R:checkout py/shop.py:7:name:R:checkout", got, sizeof(got)) &&
+             find_is(idx, "cart", AC_SYMBOL_DEFINITION | AC_SYMBOL_IGNORE_CASE,
+                     "py/shop.py:1:class:D", got, sizeof(got)) &&
+             find_is(idx, "CART", AC_SYMBOL_ALL, "", got, sizeof(got));
+    ok = ok && ac_symbol_index_find(idx, "item_t", AC_SYMBOL_ALL, 2, &r) == ARC_OK &&
+         r.count == 2 && r.total == 5 && r.symbols[0].role == AC_SYMBOL_DEFINITION;
+    if (r.symbols) ac_symbol_result_free(&r);
+    ac_symbol_index_close(idx);
+    if (ok) PASS(); else FAIL(got);
+}
+
+/*============================================================================
+ * Updates
+ *============================================================================*/
+
+static void test_reopen_reuses_file(void) {
+    TEST("reopen parses nothing");
+    ac_symbol_index_options_t opts = default_options();
+    ac_symbol_index_t *idx = NULL;
+    if (ac_symbol_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    ac_symbol_index_stats_t st;
+    ac_symbol_index_stats(idx, &st);
+    char got[256];
+    int ok = st.parsed == 0 && st.writes == 0 && st.files == 6 && st.symbols > 50 &&
+             st.index_bytes > 0 &&
+             find_is(idx, "item_new", AC_SYMBOL_DEFINITION, "src/item.c:4:function:D", got, sizeof(got));
+    ac_symbol_index_close(idx);
+    if (ok) PASS(); else FAIL(got);
+}
+
+static void test_changes_without_watch(void) {
+    TEST("changed, added and removed files");
+    ac_symbol_index_options_t opts = default_options();
+    ac_symbol_index_t *idx = NULL;
+    if (ac_symbol_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    write_file("src/item.c", "int item_count = 0;\nvoid item_free(item_t *it) {}\n", 2000);
+    write_file("src/extra.c", "int extra(void) { return item_count; }\n", 2000);
+    remove(at("more/lib.rs"));
+
+    char got[1024];
+    ac_symbol_index_stats_t st;
+    int ok = find_is(idx, "item_new", AC_SYMBOL_ALL, "src/item.h:8:function:C", got, sizeof(got)) &&
+             find_is(idx, "item_count", AC_SYMBOL_ALL,
+                     "src/item.c:1:variable:D src/item.h:7:variable:C src/extra.c:1:name:R:extra",
+                     got, sizeof(got)) &&
+             find_is(idx, "parser", AC_SYMBOL_ALL, "", got, sizeof(got));
+    ac_symbol_index_stats(idx, &st);
+    ok = ok && st.parsed == 2 && st.writes == 0;
+    ac_symbol_index_close(idx);
+
+    /* Close saved the changes */
+    ok = ok && ac_symbol_index_open(g_root, &opts, &idx) == ARC_OK;
+    if (ok) {
+        ac_symbol_index_stats(idx, &st);
+        ok = st.parsed == 0 &&
+             find_is(idx, "item_free", AC_SYMBOL_ALL, "src/item.c:2:function:D", got, sizeof(got));
+        ac_symbol_index_close(idx);
+    }
+    if (ok) PASS(); else FAIL(got);
+}
+
+static void test_watch_events(void) {
+    TEST("watch events");
+    ac_symbol_index_options_t opts = default_options();
+    opts.watch = 1;
+    ac_symbol_index_t *idx = NULL;
+    if (ac_symbol_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    ac_symbol_index_stats_t st;
+    ac_symbol_index_stats(idx, &st);
+    if (!st.watching) {
+        printf("(inotify unavailable) ");
+        PASS();
+        ac_symbol_index_close(idx);
+        return;
+    }
+
+    /* Same size and mtime: only the event reveals the edit */
+    struct stat before;
+    stat(at("src/extra.c"), &before);
+    FILE *f = fopen(at("src/extra.c"), "r+");
+    if (f) {
+        fputs("int watch", f);
+        fclose(f);
+    }
+    struct timeval tv[2] = { { before.st_mtime, 0 }, { before.st_mtime, 0 } };
+    utimes(at("src/extra.c"), tv);
+    mkdir(at("gen"), 0755);
+    write_file("gen/created.c", "int watched(void) { return watch(); }\n", 4000);
+
+    char got[1024];
+    int ok = find_is(idx, "watch", AC_SYMBOL_ALL,
+                     "src/extra.c:1:function:D gen/created.c:1:name:R:watched", got, sizeof(got)) &&
+             find_is(idx, "extra", AC_SYMBOL_ALL, "", got, sizeof(got));
+    ac_symbol_index_stats(idx, &st);
+    ok = ok && st.parsed == 2;
+    ac_symbol_index_close(idx);
+    if (ok) PASS(); else FAIL(got);
+}
+
+static void test_watch_ignore_files(void) {
+    TEST("watch picks up ignore file edits");
+    ac_symbol_index_options_t opts = default_options();
+    opts.watch = 1;
+    ac_symbol_index_t *idx = NULL;
+    if (ac_symbol_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    ac_symbol_index_stats_t st;
+    ac_symbol_index_stats(idx, &st);
+    if (!st.watching) {
+        printf("(inotify unavailable) ");
+        PASS();
+        ac_symbol_index_close(idx);
+        return;
+    }
+
+    char got[1024];
+    int ok = find_is(idx, "item_new_generated", AC_SYMBOL_ALL, "", got, sizeof(got));
+    write_file(".gitignore", "# nothing ignored\n", 5000);
+    ok = ok && find_is(idx, "item_new_generated", AC_SYMBOL_ALL, "build/gen.c:1:variable:D",
+                       got, sizeof(got));
+    write_file(".gitignore", "build/\n", 6000);
+    ok = ok && find_is(idx, "item_new_generated", AC_SYMBOL_ALL, "", got, sizeof(got));
+    ac_symbol_index_close(idx);
+    if (ok) PASS(); else FAIL(got);
+}
+
+static void test_many_files(void) {
+    TEST("many files, parsed in parallel");
+    mkdir(at("many"), 0755);
+    char rel[64], text[128];
+    for (int i = 0; i < 200; i++) {
+        snprintf(rel, sizeof(rel), "many/f%03d.c", i);
+        snprintf(text, sizeof(text), "int shared_counter;\nint fn_%03d(void) { return shared_counter + %d; }\n", i, i);
+        write_file(rel, text, 1000);
+    }
+    ac_symbol_index_options_t opts = default_options();
+    ac_symbol_index_t *idx = NULL;
+    if (ac_symbol_index_open(g_root, &opts, &idx) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    ac_symbol_result_t r;
+    ac_symbol_index_stats_t st;
+    char got[256];
+    int ok = ac_symbol_index_find(idx, "shared_counter", AC_SYMBOL_ALL, 10, &r) == ARC_OK &&
+             r.total == 400 && r.count == 10 && strcmp(r.symbols[0].path, "many/f000.c") == 0;
+    ac_symbol_result_free(&r);
+    ac_symbol_index_stats(idx, &st);
+    ok = ok && st.parsed == 200 && st.writes == 1 &&
+         find_is(idx, "fn_123", AC_SYMBOL_ALL, "many/f123.c:2:function:D", got, sizeof(got));
+    ac_symbol_index_close(idx);
+    if (ok) PASS(); else FAIL("unexpected result");
+}
+
+static void test_corrupt_index(void) {
+    TEST("corrupt index file is rebuilt");
+    DIR *d = opendir(g_cache);
+    struct dirent *e;
+    int truncated = 0;
+    char path[700];
+    while (d && (e = readdir(d)) != NULL) {
+        size_t len = strlen(e->d_name);
+        if (len < 4 || strcmp(e->d_name + len - 4, ".sym") != 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", g_cache, e->d_name);
+        truncated = truncate(path, 100) == 0;
+    }
+    if (d) closedir(d);
+
+    ac_symbol_index_options_t opts = default_options();
+    ac_symbol_index_t *idx = NULL;
+    char got[256] = "open failed";
+    int ok = truncated && ac_symbol_index_open(g_root, &opts, &idx) == ARC_OK;
+    if (ok) {
+        ac_symbol_index_stats_t st;
+        ac_symbol_index_stats(idx, &st);
+        ok = st.parsed == st.files && st.writes == 1 &&
+             find_is(idx, "item_free", AC_SYMBOL_ALL, "src/item.c:2:function:D", got, sizeof(got));
+        ac_symbol_index_close(idx);
+    }
+    if (ok) PASS(); else FAIL(got);
+}
+
+static void test_errors(void) {
+    TEST("invalid arguments");
+    ac_symbol_index_options_t opts = default_options();
+    ac_symbol_index_t *idx = NULL;
+    ac_symbol_result_t r;
+    int ok = ac_symbol_index_open(NULL, &opts, &idx) == ARC_ERR_INVALID_ARG &&
+             ac_symbol_index_open(at("missing"), &opts, &idx) == ARC_ERR_IO &&
+             ac_symbol_index_open(at("src/item.c"), &opts, &idx) == ARC_ERR_IO &&
+             idx == NULL &&
+             ac_symbol_index_find(NULL, "x", AC_SYMBOL_ALL, 0, &r) == ARC_ERR_INVALID_ARG &&
+             r.count == 0 &&
+             ac_symbol_index_refresh(NULL) == ARC_ERR_INVALID_ARG &&
+             strcmp(ac_symbol_kind_name(AC_SYMBOL_TYPEDEF), "typedef") == 0;
+    ac_symbol_index_close(NULL);
+    if (ok) PASS(); else FAIL("unexpected result");
+}
+
+int main(void) {
+    printf("=== Symbol Index Tests ===\n\n");
+
+    if (fixture_create("symbols_test") != 0) return 1;
+
+    setup_tree();
+    test_c_definitions();
+    test_c_references();
+    test_python();
+    test_other_languages();
+    test_file_symbols();
+    test_ignore_case_and_limit();
+    test_reopen_reuses_file();
+    test_changes_without_watch();
+    test_watch_events();
+    test_watch_ignore_files();
+    test_many_files();
+    test_corrupt_index();
+    test_errors();
+
+    fixture_remove();
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
@@ -0,0 +1,402 @@
+/**
+ * @file test_textfile.c
+ * @brief Tests for mapped text files, the line index and the file cache
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <arc/textfile.h>
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+static char g_root[256];
+
+static const char *at(const char *rel) {
+    static char path[512];
+    snprintf(path, sizeof(path), "%s/%s", g_root, rel);
+    return path;
+}
+
+static void write_bytes(const char *rel, const char *data, size_t len, long mtime) {
+    FILE *f = fopen(at(rel), "wb");
+    if (f) {
+        fwrite(data, 1, len, f);
+        fclose(f);
+    }
+    struct timeval tv[2] = { { mtime, 0 }, { mtime, 0 } };
+    utimes(at(rel), tv);
+}
+
+static void write_text(const char *rel, const char *text, long mtime) {
+    write_bytes(rel, text, strlen(text), mtime);
+}
+
+/* Compare line i with an expected string */
+static int line_is(ac_textfile_t *f, size_t i, const char *expected) {
+    size_t len;
+    const char *line = ac_textfile_line(f, i, &len);
+    return line && len == strlen(expected) && memcmp(line, expected, len) == 0;
+}
+
+/*============================================================================
+ * Newline Counting
+ *============================================================================*/
+
+static void test_count_newlines(void) {
+    TEST("count newlines at every length and alignment");
+    char buf[1200];
+    srand(7);
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = (rand() % 5 == 0) ? '\n' : (char)('a' + rand() % 26);
+    }
+    int ok = 1;
+    for (size_t off = 0; off < 16 && ok; off++) {
+        for (size_t len = 0; off + len <= sizeof(buf) && ok; len += 7) {
+            size_t expected = 0;
+            for (size_t i = 0; i < len; i++) expected += buf[off + i] == '\n';
+            ok = ac_textfile_count_newlines(buf + off, len) == expected;
+        }
+    }
+    /* More than 255 vector blocks of newlines */
+    char *nl = malloc(16 * 1000 + 3);
+    memset(nl, '\n', 16 * 1000 + 3);
+    ok = ok && ac_textfile_count_newlines(nl, 16 * 1000 + 3) == 16 * 1000 + 3;
+    free(nl);
+    if (ok) PASS(); else FAIL("count mismatch");
+}
+
+/*============================================================================
+ * Lines
+ *============================================================================*/
+
+static void test_line_endings(void) {
+    TEST("line endings");
+    write_text("plain.txt", "a\nb", 1000);
+    write_text("final.txt", "a\nb\n", 1000);
+    write_text("crlf.txt", "one\r\ntwo\r\n\r\nlone\rcr\n", 1000);
+    write_text("empty.txt", "", 1000);
+    write_text("blank.txt", "\n", 1000);
+
+    ac_textfile_t *p = NULL, *f = NULL, *c = NULL, *e = NULL, *b = NULL;
+    int ok = ac_textfile_open(NULL, at("plain.txt"), &p) == ARC_OK &&
+             ac_textfile_open(NULL, at("final.txt"), &f) == ARC_OK &&
+             ac_textfile_open(NULL, at("crlf.txt"), &c) == ARC_OK &&
+             ac_textfile_open(NULL, at("empty.txt"), &e) == ARC_OK &&
+             ac_textfile_open(NULL, at("blank.txt"), &b) == ARC_OK;
+    ok = ok &&
+         ac_textfile_line_count(p) == 2 && line_is(p, 0, "a") && line_is(p, 1, "b") &&
+         ac_textfile_line_count(f) == 2 && line_is(f, 1, "b") &&
+         ac_textfile_line_count(c) == 4 && line_is(c, 0, "one") && line_is(c, 1, "two") &&
+         line_is(c, 2, "") && line_is(c, 3, "lone\rcr") &&
+         ac_textfile_line_count(e) == 0 && ac_textfile_line(e, 0, NULL) == NULL &&
+         ac_textfile_line_count(b) == 1 && line_is(b, 0, "") &&
+         ac_textfile_line(p, 2, NULL) == NULL;
+    ac_textfile_release(p);
+    ac_textfile_release(f);
+    ac_textfile_release(c);
+    ac_textfile_release(e);
+    ac_textfile_release(b);
+    if (ok) PASS(); else FAIL("unexpected lines");
+}
+
+static void test_large_file_random_access(void) {
+    TEST("large file random access");
+    FILE *out = fopen(at("large.log"), "w");
+    for (int i = 0; i < 200000; i++) fprintf(out, "line %d of the log\n", i);
+    fclose(out);
+
+    ac_textfile_t *f = NULL;
+    if (ac_textfile_open(NULL, at("large.log"), &f) != ARC_OK) {
+        FAIL("open failed");
+        return;
+    }
+    int ok = ac_textfile_line_count(f) == 200000 && !ac_textfile_is_binary(f) &&
+             line_is(f, 0, "line 0 of the log") &&
+             line_is(f, 123456, "line 123456 of the log") &&
+             line_is(f, 199999, "line 199999 of the log") &&
+             ac_textfile_line(f, 200000, NULL) == NULL;
+    ac_textfile_release(f);
+    if (ok) PASS(); else FAIL("unexpected lines");
+}
+
+static void test_binary(void) {
+    TEST("binary detection");
+    write_bytes("blob.bin", "ELF\0\1\2\3", 7, 1000);
+    ac_textfile_t *bin = NULL, *txt = NULL;
+    int ok = ac_textfile_open(NULL, at("blob.bin"), &bin) == ARC_OK &&
+             ac_textfile_open(NULL, at("plain.txt"), &txt) == ARC_OK &&
+             ac_textfile_is_binary(bin) && !ac_textfile_is_binary(txt) &&
+             ac_textfile_size(bin) == 7;
+    ac_textfile_release(bin);
+    ac_textfile_release(txt);
+    if (ok) PASS(); else FAIL("unexpected result");
+}
+
+/*============================================================================
+ * Cache
+ *============================================================================*/
+
+static void test_cache_hit(void) {
+    TEST("cache hit");
+    ac_textfile_cache_t *cache = ac_textfile_cache_create(NULL);
+    ac_textfile_t *a = NULL, *b = NULL;
+    ac_textfile_open(cache, at("large.log"), &a);
+    ac_textfile_line_count(a);
+    ac_textfile_release(a);
+    ac_textfile_open(cache, at("large.log"), &b);
+    ac_textfile_cache_stats_t st;
+    ac_textfile_cache_stats(cache, &st);
+    int ok = a == b && st.hits == 1 && st.misses == 1 && st.files == 1 &&
+             line_is(b, 42, "line 42 of the log");
+    ac_textfile_release(b);
+    ac_textfile_cache_destroy(cache);
+    if (ok) PASS(); else FAIL("not served from the cache");
+}
+
+static void test_cache_invalidation(void) {
+    TEST("cache invalidation");
+    ac_textfile_cache_t *cache = ac_textfile_cache_create(NULL);
+    write_text("edit.txt", "first\n", 1000);
+
+    ac_textfile_t *old = NULL, *resized = NULL, *touched = NULL;
+    ac_textfile_open(cache, at("edit.txt"), &old);
+
+    /* Size change */
+    write_text("edit.txt", "second version\n", 1000);
+    ac_textfile_open(cache, at("edit.txt"), &resized);
+    /* Same size, new mtime */
+    write_text("edit.txt", "third  version\n", 2000);
+    ac_textfile_open(cache, at("edit.txt"), &touched);
+
+    ac_textfile_cache_stats_t st;
+    ac_textfile_cache_stats(cache, &st);
+    /* The first handle still sees what it opened */
+    int ok = old && resized && touched && old != resized && resized != touched &&
+             line_is(old, 0, "first") && line_is(resized, 0, "second version") &&
+             line_is(touched, 0, "third  version") && st.misses == 3 && st.files == 1;
+    ac_textfile_release(old);
+    ac_textfile_release(resized);
+    ac_textfile_release(touched);
+    ac_textfile_cache_destroy(cache);
+    if (ok) PASS(); else FAIL("stale contents");
+}
+
+static void test_cache_eviction(void) {
+    TEST("cache eviction");
+    ac_textfile_cache_options_t opts = { .max_files = 2 };
+    ac_textfile_cache_t *cache = ac_textfile_cache_create(&opts);
+    write_text("e1.txt", "1\n", 1000);
+    write_text("e2.txt", "2\n", 1000);
+    write_text("e3.txt", "3\n", 1000);
+
+    ac_textfile_t *held = NULL, *f = NULL;
+    ac_textfile_open(cache, at("e1.txt"), &held);
+    ac_textfile_open(cache, at("e2.txt"), &f);
+    ac_textfile_release(f);
+    ac_textfile_open(cache, at("e3.txt"), &f);
+    ac_textfile_release(f);
+
+    /* e2 was the least recently used file nobody held */
+    ac_textfile_cache_stats_t st;
+    ac_textfile_cache_stats(cache, &st);
+    int ok = st.files == 2;
+    ac_textfile_open(cache, at("e1.txt"), &f);
+    ok = ok && f == held;
+    ac_textfile_release(f);
+    ac_textfile_open(cache, at("e2.txt"), &f);
+    ac_textfile_cache_stats(cache, &st);
+    ok = ok && st.misses == 4 && line_is(f, 0, "2");
+    ac_textfile_release(f);
+    ac_textfile_release(held);
+
+    /* Byte limit */
+    ac_textfile_cache_options_t small = { .max_bytes = 1024 };
+    ac_textfile_cache_t *tight = ac_textfile_cache_create(&small);
+    ac_textfile_open(tight, at("large.log"), &f);
+    ac_textfile_release(f);
+    ac_textfile_cache_stats(tight, &st);
+    ok = ok && st.files == 0 && st.bytes == 0;
+    ac_textfile_cache_destroy(tight);
+
+    /* Handles outlive the cache */
+    ac_textfile_open(cache, at("e3.txt"), &f);
+    ac_textfile_cache_destroy(cache);
+    ok = ok && line_is(f, 0, "3");
+    ac_textfile_release(f);
+    if (ok) PASS(); else FAIL("unexpected cache contents");
+}
+
+static void test_invalidate_and_peek(void) {
+    TEST("invalidate and peek");
+    ac_textfile_cache_t *cache = ac_textfile_cache_create(NULL);
+    write_text("p1.txt", "one\n", 1000);
+    write_text("p2.txt", "two\n", 1000);
+
+    ac_textfile_t *f = NULL, *held = NULL;
+    int ok = ac_textfile_peek(cache, at("p1.txt"), &f) == ARC_ERR_NOT_FOUND && f == NULL;
+    ac_textfile_open(cache, at("p1.txt"), &held);
+    ac_textfile_open(cache, at("p2.txt"), &f);
+    ac_textfile_release(f);
+    ok = ok && ac_textfile_peek(cache, at("p2.txt"), &f) == ARC_OK && line_is(f, 0, "two");
+    ac_textfile_release(f);
+
+    /* Changed on disk: peek does not load the new contents */
+    write_text("p2.txt", "changed\n", 1000);
+    ok = ok && ac_textfile_peek(cache, at("p2.txt"), &f) == ARC_ERR_NOT_FOUND;
+
+    ac_textfile_cache_invalidate(cache, at("p1.txt"));
+    ac_textfile_cache_stats_t st;
+    ac_textfile_cache_stats(cache, &st);
+    ok = ok && st.files == 1 && st.invalidations == 1 && line_is(held, 0, "one") &&
+         ac_textfile_peek(cache, at("p1.txt"), &f) == ARC_ERR_NOT_FOUND;
+    ac_textfile_cache_invalidate(cache, NULL);
+    ac_textfile_cache_stats(cache, &st);
+    ok = ok && st.files == 0;
+    ac_textfile_release(held);
+    ac_textfile_cache_destroy(cache);
+    if (ok) PASS(); else FAIL("unexpected cache contents");
+}
+
+static void test_watch(void) {
+    TEST("watching cache");
+    ac_textfile_cache_options_t opts = { .watch = 1 };
+    ac_textfile_cache_t *cache = ac_textfile_cache_create(&opts);
+    write_text("w.txt", "aaaa\n", 1000);
+    write_text("w2.txt", "keep\n", 1000);
+
+    ac_textfile_t *a = NULL, *b = NULL, *c = NULL;
+    ac_textfile_open(cache, at("w.txt"), &a);
+    ac_textfile_open(cache, at("w2.txt"), &c);
+    ac_textfile_release(c);
+
+    /* Same size and mtime: only the watch can tell */
+    write_text("w.txt", "bbbb\n", 1000);
+    ac_textfile_open(cache, at("w.txt"), &b);
+    ac_textfile_cache_stats_t st;
+    ac_textfile_cache_stats(cache, &st);
+#if defined(__linux__)
+    int ok = a != b && line_is(b, 0, "bbbb") && st.invalidations == 1;
+#else
+    int ok = b != NULL;
+#endif
+    ok = ok && line_is(a, 0, "aaaa");
+    ac_textfile_release(a);
+    ac_textfile_release(b);
+
+    /* Other files stay cached; a deleted one goes */
+    ok = ok && ac_textfile_peek(cache, at("w2.txt"), &c) == ARC_OK;
+    ac_textfile_release(c);
+    unlink(at("w2.txt"));
+    ok = ok && ac_textfile_peek(cache, at("w2.txt"), &c) == ARC_ERR_NOT_FOUND &&
+         ac_textfile_open(cache, at("w2.txt"), &c) == ARC_ERR_IO;
+    ac_textfile_cache_destroy(cache);
+    if (ok) PASS(); else FAIL("change not seen");
+}
+
+static void test_watch_symlink(void) {
+    TEST("watching cache through a symlink");
+    ac_textfile_cache_options_t opts = { .watch = 1 };
+    ac_textfile_cache_t *cache = ac_textfile_cache_create(&opts);
+    mkdir(at("sub"), 0755);
+    write_text("sub/real.txt", "old contents\n", 1000);
+    write_text("sub/other.txt", "other file\n", 1000);
+    char target[512];
+    snprintf(target, sizeof(target), "%s", at("sub/real.txt"));
+    symlink(target, at("link.txt"));
+
+    ac_textfile_t *a = NULL, *b = NULL, *c = NULL;
+    ac_textfile_open(cache, at("link.txt"), &a);
+    int ok = a && line_is(a, 0, "old contents");
+    ac_textfile_release(a);
+
+    /* Rewritten in the link's target directory */
+    write_text("sub/real.txt", "newer contents\n", 2000);
+    ac_textfile_open(cache, at("link.txt"), &b);
+    ok = ok && b && line_is(b, 0, "newer contents");
+    ac_textfile_release(b);
+
+    /* The link itself now points elsewhere */
+    unlink(at("link.txt"));
+    snprintf(target, sizeof(target), "%s", at("sub/other.txt"));
+    symlink(target, at("link.txt"));
+    ac_textfile_open(cache, at("link.txt"), &c);
+    ok = ok && c && line_is(c, 0, "other file");
+    ac_textfile_release(c);
+    ac_textfile_cache_destroy(cache);
+    if (ok) PASS(); else FAIL("stale contents through the link");
+}
+
+static void test_errors(void) {
+    TEST("errors");
+    ac_textfile_cache_t *cache = ac_textfile_cache_create(NULL);
+    ac_textfile_t *f = NULL;
+    int ok = ac_textfile_open(cache, NULL, &f) == ARC_ERR_INVALID_ARG &&
+             ac_textfile_open(cache, at("missing.txt"), &f) == ARC_ERR_IO &&
+             ac_textfile_open(NULL, at("missing.txt"), &f) == ARC_ERR_IO &&
+             ac_textfile_open(cache, g_root, &f) == ARC_ERR_INVALID_ARG &&
+             ac_textfile_open(NULL, g_root, &f) == ARC_ERR_INVALID_ARG &&
+             f == NULL && ac_textfile_line_count(NULL) == 0;
+    ac_textfile_release(NULL);
+    ac_textfile_cache_destroy(cache);
+    if (ok) PASS(); else FAIL("unexpected result");
+}
+
+int main(void) {
+    printf("=== Text File Tests ===\n\n");
+
+    snprintf(g_root, sizeof(g_root), "/tmp/arc_textfile_test_XXXXXX");
+    if (!mkdtemp(g_root)) {
+        printf("Failed to create temp dir\n");
+        return 1;
+    }
+
+    test_count_newlines();
+    test_line_endings();
+    test_large_file_random_access();
+    test_binary();
+    test_cache_hit();
+    test_cache_invalidation();
+    test_cache_eviction();
+    test_invalidate_and_peek();
+    test_watch();
+    test_watch_symlink();
+    test_errors();
+
+    char cmd[600];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", g_root);
+    if (system(cmd) != 0) {
+        printf("warning: could not remove %s\n", g_root);
+    }
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
@@ -0,0 +1,417 @@
+/**
+ * @file test_trace_binary.c
+ * @brief Tests for the binary trace exporter, reader and converter
+ *
+ * Runs are driven through the agent hooks the trace module registers, so
+ * no agent or LLM is needed. Written files are then cut short or damaged
+ * to check what the reader, the exporter reopening them and the
+ * arc_trace_convert tool recover.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <arc/agent_hooks.h>
+#include <arc/message.h>
+#include <arc/trace_exporters.h>
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+#define RUNS            3
+#define ITERATIONS      2
+#define RUN_EVENTS      (2 + ITERATIONS * 6)
+
+static char g_root[256];
+
+static const char *at(const char *rel) {
+    static char path[4][512];
+    static int slot = 0;
+    slot = (slot + 1) % 4;
+    snprintf(path[slot], sizeof(path[slot]), "%s/%s", g_root, rel);
+    return path[slot];
+}
+
+static long file_size(const char *rel) {
+    struct stat st;
+    return stat(at(rel), &st) == 0 ? (long)st.st_size : -1;
+}
+
+static int copy_file(const char *from, const char *to) {
+    FILE *in = fopen(at(from), "rb");
+    FILE *out = fopen(at(to), "wb");
+    int ok = in && out;
+    char buf[8192];
+    size_t n;
+    while (ok && (n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        ok = fwrite(buf, 1, n, out) == n;
+    }
+    if (in) fclose(in);
+    if (out) fclose(out);
+    return ok;
+}
+
+/* Copy a trace and its index */
+static int copy_trace(const char *from, const char *to) {
+    char from_idx[128], to_idx[128];
+    snprintf(from_idx, sizeof(from_idx), "%s.idx", from);
+    snprintf(to_idx, sizeof(to_idx), "%s.idx", to);
+    return copy_file(from, to) && copy_file(from_idx, to_idx);
+}
+
+static void flip_byte(const char *rel, long offset) {
+    FILE *f = fopen(at(rel), "r+b");
+    if (!f) return;
+    fseek(f, offset, SEEK_SET);
+    int c = fgetc(f);
+    fseek(f, offset, SEEK_SET);
+    fputc(c ^ 0x5A, f);
+    fclose(f);
+}
+
+/*============================================================================
+ * Writing Runs
+ *============================================================================*/
+
+/* One run through the hooks: ITERATIONS rounds of request, response and tool */
+static void write_run(int n) {
+    const ac_agent_hooks_t *h = ac_agent_get_hooks();
+    char message[64], content[64], args[64], result[64];
+    snprintf(message, sizeof(message), "question %d", n);
+
+    /* The history grows by one message per request, as in a real run */
+    ac_message_t history[ITERATIONS + 1];
+    memset(history, 0, sizeof(history));
+    history[0].role = AC_ROLE_USER;
+    history[0].content = message;
+
+    h->on_run_start(h->ctx, &(ac_hook_run_start_t){
+        .agent_name = "Tester", .message = message, .instructions = "Be brief.",
+        .max_iterations = 5, .tool_count = 1,
+    });
+    for (int i = 1; i <= ITERATIONS; i++) {
+        h->on_iter_start(h->ctx, &(ac_hook_iter_t){ "Tester", i, 5 });
+        h->on_llm_request(h->ctx, &(ac_hook_llm_request_t){
+            .agent_name = "Tester", .model = "mock-model", .messages = history,
+            .tools_schema = "[{\"type\":\"function\",\"function\":{\"name\":\"lookup\"}}]",
+            .message_count = (size_t)i,
+        });
+        snprintf(content, sizeof(content), "thinking %d.%d", n, i);
+        h->on_llm_response(h->ctx, &(ac_hook_llm_response_t){
+            .agent_name = "Tester", .content = content, .tool_call_count = 1,
+            .prompt_tokens = 10 * i, .completion_tokens = i, .total_tokens = 11 * i,
+            .finish_reason = "tool_calls", .duration_ms = 7,
+        });
+        snprintf(args, sizeof(args), "{\"key\":\"k%d.%d\"}", n, i);
+        snprintf(result, sizeof(result), "{\"value\":%d}", n * 100 + i);
+        h->on_tool_start(h->ctx, &(ac_hook_tool_start_t){ "Tester", "call_1", "lookup", args });
+        h->on_tool_end(h->ctx, &(ac_hook_tool_end_t){ "Tester", "call_1", "lookup", result, 3, 1 });
+        h->on_iter_end(h->ctx, &(ac_hook_iter_t){ "Tester", i, 5 });
+
+        history[i - 1].next = &history[i];
+        history[i].role = AC_ROLE_ASSISTANT;
+        history[i].content = content;
+    }
+    h->on_run_end(h->ctx, &(ac_hook_run_end_t){
+        .agent_name = "Tester", .content = "done", .iterations = ITERATIONS,
+        .total_prompt_tokens = 30, .total_completion_tokens = 3, .duration_ms = 42,
+    });
+}
+
+/* Append runs first..first+count-1 to output_dir/name; small blocks give several per run */
+static int write_trace(const char *name, int first, int count) {
+    ac_trace_binary_config_t config = {
+        .output_dir = g_root,
+        .file_name = name,
+        .block_size = 256,
+    };
+    if (ac_trace_binary_exporter_init(&config) != 0) return 0;
+    for (int i = 0; i < count; i++) write_run(first + i);
+    ac_trace_binary_exporter_cleanup();
+    return 1;
+}
+
+/*============================================================================
+ * Reading Runs
+ *============================================================================*/
+
+typedef struct {
+    int events;
+    int sequence_ok;
+    int last_sequence;
+    char message[64];
+    char last_result[64];
+    char last_messages[512];
+} replay_t;
+
+static void replay_handler(const ac_trace_event_t *event, void *user_data) {
+    replay_t *r = (replay_t *)user_data;
+    r->events++;
+    r->sequence_ok = r->sequence_ok && event->sequence > r->last_sequence;
+    r->last_sequence = event->sequence;
+    if (event->type == AC_TRACE_AGENT_START) {
+        snprintf(r->message, sizeof(r->message), "%s", event->data.agent_start.message);
+    } else if (event->type == AC_TRACE_TOOL_END) {
+        snprintf(r->last_result, sizeof(r->last_result), "%s", event->data.tool_end.result);
+    } else if (event->type == AC_TRACE_LLM_REQUEST) {
+        snprintf(r->last_messages, sizeof(r->last_messages), "%s",
+                 event->data.llm_request.messages_json);
+    }
+}
+
+static int replay(ac_trace_reader_t *reader, size_t index, replay_t *r) {
+    memset(r, 0, sizeof(*r));
+    r->sequence_ok = 1;
+    return ac_trace_reader_replay(reader, index, replay_handler, r);
+}
+
+/* Runs in a trace: -1 if it cannot be opened; complete receives a bitmask */
+static int run_count(const char *rel, unsigned *complete) {
+    ac_trace_reader_t *reader = ac_trace_reader_open(at(rel));
+    if (!reader) return -1;
+    int n = (int)ac_trace_reader_run_count(reader);
+    *complete = 0;
+    for (int i = 0; i < n; i++) {
+        if (ac_trace_reader_run(reader, (size_t)i)->complete) *complete |= 1u << i;
+    }
+    ac_trace_reader_close(reader);
+    return n;
+}
+
+/* File offset of run index in a trace */
+static long run_offset(const char *rel, size_t index) {
+    ac_trace_reader_t *reader = ac_trace_reader_open(at(rel));
+    const ac_trace_run_info_t *info = ac_trace_reader_run(reader, index);
+    long offset = info ? (long)info->offset : -1;
+    ac_trace_reader_close(reader);
+    return offset;
+}
+
+/*============================================================================
+ * Tests
+ *============================================================================*/
+
+static void test_round_trip(void) {
+    TEST("runs read back as they were written");
+    if (!write_trace("clean.actrace", 1, RUNS)) {
+        FAIL("exporter did not start");
+        return;
+    }
+    ac_trace_reader_t *reader = ac_trace_reader_open(at("clean.actrace"));
+    int ok = reader && ac_trace_reader_run_count(reader) == RUNS;
+    for (size_t i = 0; ok && i < RUNS; i++) {
+        const ac_trace_run_info_t *info = ac_trace_reader_run(reader, i);
+        ok = info->complete && info->event_count == RUN_EVENTS &&
+             strcmp(info->agent_name, "Tester") == 0 && info->end_ms >= info->start_ms &&
+             ac_trace_reader_find_run(reader, info->trace_id) == (int)i;
+    }
+
+    /* Interned strings and the delta-encoded history decode in full */
+    replay_t r;
+    ok = ok && replay(reader, 1, &r) == RUN_EVENTS && r.events == RUN_EVENTS && r.sequence_ok &&
+         strcmp(r.message, "question 2") == 0 && strcmp(r.last_result, "{\"value\":202}") == 0 &&
+         strstr(r.last_messages, "question 2") && strstr(r.last_messages, "thinking 2.1");
+    ac_trace_reader_close(reader);
+    if (ok) PASS(); else FAIL("runs differ from what was written");
+}
+
+static void test_index_sidecar(void) {
+    TEST("sidecar index: one entry per run, rebuilt when missing or wrong");
+    long entries = (file_size("clean.actrace.idx") - 16) / 128;
+    int ok = entries == RUNS && file_size("clean.actrace.idx") == 16 + RUNS * 128;
+
+    /* Without the index, runs are found by scanning */
+    unsigned complete;
+    copy_trace("clean.actrace", "noidx.actrace");
+    remove(at("noidx.actrace.idx"));
+    ok = ok && run_count("noidx.actrace", &complete) == RUNS && complete == 7 &&
+         run_offset("noidx.actrace", 2) == run_offset("clean.actrace", 2);
+
+    /* An entry that points nowhere is not trusted */
+    copy_trace("clean.actrace", "badidx.actrace");
+    flip_byte("badidx.actrace.idx", 16 + 128 + 96);
+    ok = ok && run_count("badidx.actrace", &complete) == RUNS && complete == 7;
+
+    ok = ok && ac_trace_binary_rebuild_index(at("noidx.actrace")) == RUNS &&
+         file_size("noidx.actrace.idx") == file_size("clean.actrace.idx");
+    if (ok) PASS(); else FAIL("index not used or not validated");
+}
+
+static void test_crc_mismatch(void) {
+    TEST("a corrupt block costs only its run");
+    copy_trace("clean.actrace", "crc.actrace");
+    flip_byte("crc.actrace", run_offset("crc.actrace", 1) + 20 + 2);
+
+    ac_trace_reader_t *reader = ac_trace_reader_open(at("crc.actrace"));
+    replay_t r;
+    int ok = reader && ac_trace_reader_run_count(reader) == RUNS &&
+             replay(reader, 0, &r) == RUN_EVENTS && replay(reader, 1, &r) < 0 &&
+             replay(reader, 2, &r) == RUN_EVENTS && strcmp(r.message, "question 3") == 0;
+    ac_trace_reader_close(reader);
+
+    /* A scan stops at the first bad block */
+    unsigned complete;
+    remove(at("crc.actrace.idx"));
+    ok = ok && run_count("crc.actrace", &complete) == 1 && complete == 1;
+    if (ok) PASS(); else FAIL("corrupt block not contained");
+}
+
+static void test_torn_tail(void) {
+    TEST("a torn last block leaves the run incomplete");
+    copy_trace("clean.actrace", "torn.actrace");
+    if (truncate(at("torn.actrace"), file_size("torn.actrace") - 5) != 0) {
+        FAIL("truncate");
+        return;
+    }
+    ac_trace_reader_t *reader = ac_trace_reader_open(at("torn.actrace"));
+    const ac_trace_run_info_t *last = ac_trace_reader_run(reader, RUNS - 1);
+    replay_t r;
+    int ok = reader && ac_trace_reader_run_count(reader) == RUNS && last &&
+             !last->complete && last->event_count > 0 && last->event_count < RUN_EVENTS &&
+             replay(reader, RUNS - 1, &r) == (int)last->event_count &&
+             replay(reader, 0, &r) == RUN_EVENTS;
+    ac_trace_reader_close(reader);
+    if (ok) PASS(); else FAIL("torn run misreported");
+
+    TEST("a stale index entry past the data is dropped");
+    copy_trace("clean.actrace", "cut.actrace");
+    ok = truncate(at("cut.actrace"), run_offset("cut.actrace", RUNS - 1) + 20 + 5) == 0;
+    unsigned complete;
+    ok = ok && run_count("cut.actrace", &complete) == RUNS - 1 && complete == 3;
+    if (ok) PASS(); else FAIL("run without data listed");
+}
+
+static void test_reopen(void) {
+    TEST("reopening drops the torn tail and appends after it");
+    copy_trace("clean.actrace", "reopen.actrace");
+    long torn_at = file_size("reopen.actrace") - 5;
+    int ok = truncate(at("reopen.actrace"), torn_at) == 0;
+    FILE *f = fopen(at("reopen.actrace"), "ab");
+    if (f) {
+        fputs("garbage after a crash", f);
+        fclose(f);
+    }
+    ok = ok && write_trace("reopen.actrace", 4, 1);
+
+    ac_trace_reader_t *reader = ac_trace_reader_open(at("reopen.actrace"));
+    replay_t r;
+    ok = ok && reader && ac_trace_reader_run_count(reader) == RUNS + 1 &&
+         !ac_trace_reader_run(reader, RUNS - 1)->complete &&
+         ac_trace_reader_run(reader, RUNS)->complete &&
+         replay(reader, RUNS, &r) == RUN_EVENTS && strcmp(r.message, "question 4") == 0;
+    ac_trace_reader_close(reader);
+    ok = ok && file_size("reopen.actrace.idx") == 16 + (RUNS + 1) * 128;
+    if (ok) PASS(); else FAIL("append after recovery");
+}
+
+#ifdef TRACE_CONVERT
+
+/* Run the converter; returns its exit status, output in out */
+static int convert(const char *args, char *out, size_t size) {
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "'%s' %s 2>&1", TRACE_CONVERT, args);
+    FILE *p = popen(cmd, "r");
+    if (!p) return -1;
+    size_t n = fread(out, 1, size - 1, p);
+    out[n] = '\0';
+    int status = pclose(p);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static int count_of(const char *text, const char *needle) {
+    int n = 0;
+    for (const char *p = strstr(text, needle); p; p = strstr(p + 1, needle)) n++;
+    return n;
+}
+
+static void test_converter(void) {
+    static char out[256 * 1024];
+    char args[512];
+
+    TEST("converter lists and converts every run");
+    snprintf(args, sizeof(args), "-l '%s'", at("clean.actrace"));
+    int ok = convert(args, out, sizeof(out)) == 0 && count_of(out, " complete") == RUNS;
+    snprintf(args, sizeof(args), "-f jsonl '%s'", at("clean.actrace"));
+    ok = ok && convert(args, out, sizeof(out)) == 0 &&
+         count_of(out, "\n") == RUNS * RUN_EVENTS && count_of(out, "\"type\":\"agent_end\"") == RUNS;
+    snprintf(args, sizeof(args), "-f json -r '#1' '%s'", at("clean.actrace"));
+    ok = ok && convert(args, out, sizeof(out)) == 0 &&
+         count_of(out, "\"sequence\"") == RUN_EVENTS && strstr(out, "\"question 2\"");
+    if (ok) PASS(); else FAIL(out);
+
+    TEST("converter skips a corrupt run and rebuilds indexes");
+    snprintf(args, sizeof(args), "-f jsonl '%s'", at("torn.actrace"));
+    ok = convert(args, out, sizeof(out)) == 0 &&
+         count_of(out, "\"type\":\"agent_end\"") == RUNS - 1 && !strstr(out, "unreadable");
+    copy_trace("clean.actrace", "crc2.actrace");
+    flip_byte("crc2.actrace", run_offset("crc2.actrace", 1) + 20 + 2);
+    snprintf(args, sizeof(args), "-f jsonl '%s'", at("crc2.actrace"));
+    ok = ok && convert(args, out, sizeof(out)) == 0 &&
+         count_of(out, "\"type\":\"agent_start\"") == RUNS - 1 && strstr(out, "Run #1 is unreadable");
+    remove(at("noidx.actrace.idx"));
+    snprintf(args, sizeof(args), "-i '%s'", at("noidx.actrace"));
+    ok = ok && convert(args, out, sizeof(out)) == 0 && strstr(out, "Indexed 3 run(s)") &&
+         file_size("noidx.actrace.idx") == 16 + RUNS * 128;
+    if (ok) PASS(); else FAIL(out);
+}
+
+#endif
+
+/*============================================================================
+ * Main
+ *============================================================================*/
+
+int main(void) {
+    printf("=== Binary Trace Tests ===\n\n");
+
+    snprintf(g_root, sizeof(g_root), "/tmp/arc_trace_test_XXXXXX");
+    if (!mkdtemp(g_root)) {
+        printf("Failed to create temp dir\n");
+        return 1;
+    }
+
+    test_round_trip();
+    test_index_sidecar();
+    test_crc_mismatch();
+    test_torn_tail();
+    test_reopen();
+#ifdef TRACE_CONVERT
+    test_converter();
+#endif
+
+    char cmd[600];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", g_root);
+    if (system(cmd) != 0) {
+        printf("warning: could not remove %s\n", g_root);
+    }
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
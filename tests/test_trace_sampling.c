@@ -0,0 +1,253 @@
+/**
+ * @file test_trace_sampling.c
+ * @brief Tests for trace head sampling, tail sampling and payload budgets
+ *
+ * Runs are driven through the agent hooks the trace module registers, so
+ * no agent or LLM is needed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arc/agent_hooks.h>
+#include <arc/trace.h>
+
+/*============================================================================
+ * Test Helpers
+ *============================================================================*/
+
+static int test_count = 0;
+static int pass_count = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Test: %s... ", name); \
+        test_count++; \
+    } while(0)
+
+#define PASS() \
+    do { \
+        printf("PASS\n"); \
+        pass_count++; \
+    } while(0)
+
+#define FAIL(msg) \
+    do { \
+        printf("FAIL: %s\n", msg); \
+    } while(0)
+
+#define MAX_RUNS 4000
+
+typedef struct {
+    int events;
+    int starts;
+    int ends;
+    int tool_ends;
+    ac_trace_event_type_t last_type;
+    char sampled[MAX_RUNS];             /* Per run: agent_start seen */
+    int run;                            /* Index of the run being driven */
+    char message[128];
+    char result[256];
+} collector_t;
+
+static collector_t g_seen;
+
+static void collect(const ac_trace_event_t *event, void *user_data) {
+    collector_t *c = (collector_t *)user_data;
+    c->events++;
+    c->last_type = event->type;
+    if (event->type == AC_TRACE_AGENT_START) {
+        c->starts++;
+        if (c->run < MAX_RUNS) c->sampled[c->run] = 1;
+        snprintf(c->message, sizeof(c->message), "%s",
+                 event->data.agent_start.message ? event->data.agent_start.message : "(null)");
+    } else if (event->type == AC_TRACE_AGENT_END) {
+        c->ends++;
+    } else if (event->type == AC_TRACE_TOOL_END) {
+        c->tool_ends++;
+        snprintf(c->result, sizeof(c->result), "%s",
+                 event->data.tool_end.result ? event->data.tool_end.result : "(null)");
+    }
+}
+
+/* Reset the collector and tracing with a policy */
+static void start(const ac_trace_config_t *config) {
+    memset(&g_seen, 0, sizeof(g_seen));
+    ac_trace_set_config(config);
+    ac_trace_enable(collect, &g_seen);
+}
+
+/* One run with `tools` tool calls; the last fails if `fail` */
+static void drive_run(const char *message, int tools, const char *result, int fail, uint64_t duration_ms) {
+    const ac_agent_hooks_t *h = ac_agent_get_hooks();
+    h->on_run_start(h->ctx, &(ac_hook_run_start_t){ .agent_name = "Tester", .message = message });
+    for (int i = 0; i < tools; i++) {
+        h->on_tool_start(h->ctx, &(ac_hook_tool_start_t){ "Tester", "call", "lookup", "{}" });
+        h->on_tool_end(h->ctx, &(ac_hook_tool_end_t){
+            "Tester", "call", "lookup", result, 1, !(fail && i == tools - 1),
+        });
+    }
+    h->on_run_end(h->ctx, &(ac_hook_run_end_t){
+        .agent_name = "Tester", .content = "done", .duration_ms = duration_ms,
+    });
+    g_seen.run++;
+}
+
+static void drive_runs(int count) {
+    for (int i = 0; i < count; i++) drive_run("hello", 0, NULL, 0, 1);
+}
+
+/*============================================================================
+ * Head Sampling
+ *============================================================================*/
+
+static void test_sample_rate(void) {
+    TEST("sample_rate traces that fraction of runs");
+    start(&(ac_trace_config_t){ .sample_rate = 0.25, .sample_seed = 42 });
+    drive_runs(MAX_RUNS);
+    int quarter = g_seen.starts;
+    int complete = g_seen.starts == g_seen.ends;
+
+    start(&(ac_trace_config_t){ .sample_rate = 0.9, .sample_seed = 42 });
+    drive_runs(MAX_RUNS);
+    int most = g_seen.starts;
+
+    /* Expected 1000 and 3600; four standard deviations either way */
+    if (complete && quarter > 890 && quarter < 1110 && most > 3520 && most < 3680) {
+        PASS();
+    } else {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "traced %d and %d of %d runs", quarter, most, MAX_RUNS);
+        FAIL(msg);
+    }
+
+    TEST("rates outside (0, 1) trace every run");
+    start(&(ac_trace_config_t){ .sample_rate = 0.0 });
+    drive_runs(100);
+    int none_set = g_seen.starts;
+    start(&(ac_trace_config_t){ .sample_rate = 1.0 });
+    drive_runs(100);
+    if (none_set == 100 && g_seen.starts == 100) PASS(); else FAIL("runs skipped");
+}
+
+static void test_sample_seed(void) {
+    static char first[MAX_RUNS];
+
+    TEST("a seed reproduces the decisions, independent of rand()");
+    start(&(ac_trace_config_t){ .sample_rate = 0.5, .sample_seed = 7 });
+    drive_runs(500);
+    memcpy(first, g_seen.sampled, sizeof(first));
+
+    start(&(ac_trace_config_t){ .sample_rate = 0.5, .sample_seed = 7 });
+    for (int i = 0; i < 500; i++) {
+        srand((unsigned)i);
+        (void)rand();
+        drive_runs(1);
+    }
+    int same = memcmp(first, g_seen.sampled, sizeof(first)) == 0;
+
+    start(&(ac_trace_config_t){ .sample_rate = 0.5, .sample_seed = 8 });
+    drive_runs(500);
+    int other = memcmp(first, g_seen.sampled, sizeof(first)) != 0;
+    if (same && other) PASS(); else FAIL(same ? "other seed gave the same runs" : "not reproducible");
+
+    TEST("trace IDs do not repeat after srand()");
+    char a[32], b[32];
+    ac_trace_set_config(NULL);
+    srand(1);
+    ac_trace_generate_id(a, sizeof(a));
+    srand(1);
+    ac_trace_generate_id(b, sizeof(b));
+    if (strcmp(a, b) != 0) PASS(); else FAIL(a);
+}
+
+/*============================================================================
+ * Payload Budgets
+ *============================================================================*/
+
+static void test_budgets(void) {
+    char result[128];
+    memset(result, 0, sizeof(result));
+    memcpy(result, "{\"data\":\"", 9);
+    memset(result + 9, 'x', 100);
+    memcpy(result + 109, "\"}", 2);
+
+    TEST("payloads over budget are cut, JSON stays JSON");
+    start(&(ac_trace_config_t){ .max_text_bytes = 5, .max_tool_bytes = 16 });
+    drive_run("abcd\xC3\xA9" "fgh", 1, result, 0, 1);
+    int text_ok = strcmp(g_seen.message, "abcd...[truncated 5 bytes]") == 0;
+    int json_ok = strcmp(g_seen.result, "\"{\\\"data\\\":\\\"xxxxxxx...[truncated 95 bytes]\"") == 0;
+    if (text_ok && json_ok) {
+        PASS();
+    } else {
+        FAIL(text_ok ? g_seen.result : g_seen.message);
+    }
+
+    TEST("payloads within budget are untouched");
+    start(&(ac_trace_config_t){ .max_text_bytes = 9, .max_tool_bytes = 111 });
+    drive_run("abcd\xC3\xA9" "fgh", 1, result, 0, 1);
+    if (strcmp(g_seen.message, "abcd\xC3\xA9" "fgh") == 0 && strcmp(g_seen.result, result) == 0) {
+        PASS();
+    } else {
+        FAIL("payload changed");
+    }
+}
+
+/*============================================================================
+ * Tail Sampling
+ *============================================================================*/
+
+static void test_tail(void) {
+    TEST("tail sampling keeps only slow or failed runs");
+    start(&(ac_trace_config_t){ .tail_sampling = 1, .tail_min_duration_ms = 1000, .tail_keep_errors = 1 });
+    drive_run("fast", 2, "{}", 0, 10);
+    int fast = g_seen.events;
+    drive_run("slow", 2, "{}", 0, 5000);
+    int slow = g_seen.events - fast;
+    drive_run("failed", 2, "{}", 1, 10);
+    int failed = g_seen.events - fast - slow;
+    if (fast == 0 && slow == 6 && failed == 6 && g_seen.ends == 2) {
+        PASS();
+    } else {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "fast %d, slow %d, failed %d events", fast, slow, failed);
+        FAIL(msg);
+    }
+
+    TEST("tail buffer cap drops later events but keeps agent_end");
+    start(&(ac_trace_config_t){ .tail_sampling = 1, .tail_keep_errors = 1, .tail_max_buffer_bytes = 4096 });
+    drive_run("capped", 200, "{\"ok\":true}", 1, 10);
+    int capped = g_seen.events;
+    start(&(ac_trace_config_t){ .tail_sampling = 1, .tail_keep_errors = 1 });
+    drive_run("uncapped", 200, "{\"ok\":true}", 1, 10);
+    if (g_seen.events == 402 && capped > 2 && capped < 100 && g_seen.ends == 1 &&
+        g_seen.last_type == AC_TRACE_AGENT_END) {
+        PASS();
+    } else {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "%d events capped, %d uncapped", capped, g_seen.events);
+        FAIL(msg);
+    }
+}
+
+/*============================================================================
+ * Main
+ *============================================================================*/
+
+int main(void) {
+    printf("=== Trace Sampling Tests ===\n\n");
+
+    test_sample_rate();
+    test_sample_seed();
+    test_budgets();
+    test_tail();
+
+    ac_trace_disable();
+    ac_trace_set_config(NULL);
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d/%d\n", pass_count, test_count);
+
+    return (pass_count == test_count) ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""
+Generate libs/ac_hosted/src/markdown/md_width_table.h
+
+Two-stage lookup table of terminal display-width classes for every code
+point, derived from the Unicode database shipped with Python:
+
+    0  zero width    Mn, Me, Cf, Hangul medial/final jamo
+    1  narrow
+    2  wide          East Asian Width W or F, and the CJK planes
+    3  narrow, wide when followed by VS16 (emoji with text presentation)
+
+Class 3 approximates Emoji=Yes/Emoji_Presentation=No (emoji-data.txt is not
+part of unicodedata): narrow symbols (So) in the ranges where emoji live,
+plus the keycap bases, which md_utils.c handles on its ASCII path.
+
+Usage: tools/gen_md_width_table.py > libs/ac_hosted/src/markdown/md_width_table.h
+"""
+
+import sys
+import unicodedata
+
+MAX_CP = 0x110000
+BLOCK = 256
+
+EMOJI_TEXT_RANGES = [(0x2000, 0x2BFF), (0x1F000, 0x1FAFF)]
+EMOJI_TEXT_EXTRA = {0x00A9, 0x00AE, 0x3030, 0x303D, 0x3297, 0x3299}
+
+
+def width_class(cp):
+    if 0xD800 <= cp <= 0xDFFF:
+        return 1
+    ch = chr(cp)
+    cat = unicodedata.category(ch)
+
+    if cp == 0x00AD:                            # Soft hyphen is visible
+        return 1
+    if cat in ("Mn", "Me", "Cf") or 0x1160 <= cp <= 0x11FF:
+        return 0
+    if unicodedata.east_asian_width(ch) in ("W", "F"):
+        return 2
+    if 0x20000 <= cp <= 0x2FFFD or 0x30000 <= cp <= 0x3FFFD:
+        return 2
+    if cp in EMOJI_TEXT_EXTRA:
+        return 3
+    if cat == "So" and any(lo <= cp <= hi for lo, hi in EMOJI_TEXT_RANGES):
+        return 3
+    return 1
+
+
+def main():
+    blocks = []
+    index = {}
+    stage1 = []
+    for base in range(0, MAX_CP, BLOCK):
+        packed = bytearray(BLOCK // 4)
+        for i in range(BLOCK):
+            packed[i >> 2] |= width_class(base + i) << ((i & 3) * 2)
+        key = bytes(packed)
+        if key not in index:
+            index[key] = len(blocks)
+            blocks.append(key)
+        stage1.append(index[key])
+
+    if len(blocks) > 256:
+        sys.exit("too many distinct blocks for a uint8_t stage 1")
+
+    out = sys.stdout
+    out.write("/**\n")
+    out.write(" * @file md_width_table.h\n")
+    out.write(" * @brief Display-width classes per code point (generated, do not edit)\n")
+    out.write(" *\n")
+    out.write(" * Generated by tools/gen_md_width_table.py from Unicode %s.\n"
+              % unicodedata.unidata_version)
+    out.write(" * Lookup: s_width_blocks[s_width_stage1[cp >> 8]][(cp & 0xFF) >> 2],\n")
+    out.write(" * 2 bits per code point, low bits first.\n")
+    out.write(" */\n\n")
+    out.write("#ifndef MD_WIDTH_TABLE_H\n#define MD_WIDTH_TABLE_H\n\n")
+    out.write("#include <stdint.h>\n\n")
+
+    out.write("static const uint8_t s_width_stage1[%d] = {\n" % len(stage1))
+    for i in range(0, len(stage1), 16):
+        out.write("    " + ", ".join("%3d" % v for v in stage1[i:i + 16]) + ",\n")
+    out.write("};\n\n")
+
+    out.write("static const uint8_t s_width_blocks[%d][%d] = {\n" % (len(blocks), BLOCK // 4))
+    for b in blocks:
+        out.write("    {\n")
+        for i in range(0, len(b), 16):
+            out.write("        " + ", ".join("0x%02x" % v for v in b[i:i + 16]) + ",\n")
+        out.write("    },\n")
+    out.write("};\n\n")
+    out.write("#endif /* MD_WIDTH_TABLE_H */\n")
+
+
+if __name__ == "__main__":
+    main()
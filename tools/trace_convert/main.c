@@ -0,0 +1,328 @@
+/**
+ * @file main.c
+ * @brief Binary trace converter
+ *
+ * Converts .actrace files written by the binary trace exporter into JSON
+ * (same layout as the JSON file exporter) or JSONL (one event per line).
+ *
+ * Usage:
+ *   arc_trace_convert [options] <trace.actrace>
+ *
+ * Options:
+ *   -f <json|jsonl>   Output format (default: jsonl)
+ *   -r <run>          Only convert one run (trace ID or #index)
+ *   -o <file>         Output file (default: stdout)
+ *   -l                List runs and exit
+ *   -i                Rebuild the sidecar index and exit
+ *   -h                Show help
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "cJSON.h"
+#include "arc/trace_exporters.h"
+
+/*============================================================================
+ * Usage
+ *============================================================================*/
+
+static void print_usage(const char *prog_name) {
+    printf("Usage: %s [options] <trace.actrace>\n", prog_name);
+    printf("\n");
+    printf("Convert ArC binary traces to JSON or JSONL.\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("  -f <json|jsonl>   Output format (default: jsonl)\n");
+    printf("  -r <run>          Only convert one run (trace ID or #index)\n");
+    printf("  -o <file>         Output file (default: stdout)\n");
+    printf("  -l                List runs and exit\n");
+    printf("  -i                Rebuild the sidecar index and exit\n");
+    printf("  -h                Show this help message\n");
+    printf("\n");
+    printf("Example:\n");
+    printf("  %s -l logs/trace_20260129_143052.actrace\n", prog_name);
+    printf("  %s -f json -r #0 -o run0.json logs/trace_20260129_143052.actrace\n", prog_name);
+}
+
+/*============================================================================
+ * Event to JSON
+ *============================================================================*/
+
+static void format_iso_timestamp(uint64_t ts_ms, char *buf, size_t size) {
+    time_t secs = (time_t)(ts_ms / 1000);
+    int ms = (int)(ts_ms % 1000);
+    struct tm *tm_info = gmtime(&secs);
+
+    snprintf(buf, size, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+             tm_info->tm_year + 1900,
+             tm_info->tm_mon + 1,
+             tm_info->tm_mday,
+             tm_info->tm_hour,
+             tm_info->tm_min,
+             tm_info->tm_sec,
+             ms);
+}
+
+static void add_string(cJSON *obj, const char *key, const char *value) {
+    if (value) {
+        cJSON_AddStringToObject(obj, key, value);
+    } else {
+        cJSON_AddNullToObject(obj, key);
+    }
+}
+
+/* Fields that hold JSON documents are embedded as JSON, not as strings */
+static void add_raw_json(cJSON *obj, const char *key, const char *value) {
+    if (!value) {
+        cJSON_AddNullToObject(obj, key);
+        return;
+    }
+    cJSON *parsed = cJSON_Parse(value);
+    if (parsed) {
+        cJSON_AddItemToObject(obj, key, parsed);
+    } else {
+        cJSON_AddStringToObject(obj, key, value);
+    }
+}
+
+static cJSON *event_data_to_json(const ac_trace_event_t *event) {
+    cJSON *data = cJSON_CreateObject();
+
+    switch (event->type) {
+        case AC_TRACE_AGENT_START:
+            add_string(data, "message", event->data.agent_start.message);
+            add_string(data, "instructions", event->data.agent_start.instructions);
+            cJSON_AddNumberToObject(data, "max_iterations", event->data.agent_start.max_iterations);
+            cJSON_AddNumberToObject(data, "tool_count", (double)event->data.agent_start.tool_count);
+            break;
+        case AC_TRACE_AGENT_END:
+            add_string(data, "content", event->data.agent_end.content);
+            cJSON_AddNumberToObject(data, "iterations", event->data.agent_end.iterations);
+            cJSON_AddNumberToObject(data, "total_prompt_tokens", event->data.agent_end.total_prompt_tokens);
+            cJSON_AddNumberToObject(data, "total_completion_tokens", event->data.agent_end.total_completion_tokens);
+            cJSON_AddNumberToObject(data, "duration_ms", (double)event->data.agent_end.duration_ms);
+            break;
+        case AC_TRACE_ITER_START:
+        case AC_TRACE_ITER_END:
+            cJSON_AddNumberToObject(data, "iteration", event->data.iter.iteration);
+            cJSON_AddNumberToObject(data, "max_iterations", event->data.iter.max_iterations);
+            break;
+        case AC_TRACE_LLM_REQUEST:
+            add_string(data, "model", event->data.llm_request.model);
+            cJSON_AddNumberToObject(data, "message_count", (double)event->data.llm_request.message_count);
+            add_raw_json(data, "messages", event->data.llm_request.messages_json);
+            add_raw_json(data, "tools", event->data.llm_request.tools_json);
+            break;
+        case AC_TRACE_LLM_RESPONSE:
+            add_string(data, "content", event->data.llm_response.content);
+            cJSON_AddNumberToObject(data, "tool_call_count", event->data.llm_response.tool_call_count);
+            add_raw_json(data, "tool_calls", event->data.llm_response.tool_calls_json);
+            cJSON_AddNumberToObject(data, "prompt_tokens", event->data.llm_response.prompt_tokens);
+            cJSON_AddNumberToObject(data, "completion_tokens", event->data.llm_response.completion_tokens);
+            cJSON_AddNumberToObject(data, "total_tokens", event->data.llm_response.total_tokens);
+            add_string(data, "finish_reason", event->data.llm_response.finish_reason);
+            cJSON_AddNumberToObject(data, "duration_ms", (double)event->data.llm_response.duration_ms);
+            break;
+        case AC_TRACE_TOOL_START:
+            add_string(data, "id", event->data.tool_start.id);
+            add_string(data, "name", event->data.tool_start.name);
+            add_raw_json(data, "arguments", event->data.tool_start.arguments);
+            break;
+        case AC_TRACE_TOOL_END:
+            add_string(data, "id", event->data.tool_end.id);
+            add_string(data, "name", event->data.tool_end.name);
+            add_raw_json(data, "result", event->data.tool_end.result);
+            cJSON_AddNumberToObject(data, "duration_ms", (double)event->data.tool_end.duration_ms);
+            cJSON_AddBoolToObject(data, "success", event->data.tool_end.success);
+            break;
+    }
+
+    return data;
+}
+
+static cJSON *event_to_json(const ac_trace_event_t *event, int with_run_fields) {
+    cJSON *obj = cJSON_CreateObject();
+    char iso_ts[64];
+
+    if (with_run_fields) {
+        add_string(obj, "trace_id", event->trace_id);
+        add_string(obj, "agent_name", event->agent_name);
+    }
+    cJSON_AddStringToObject(obj, "type", ac_trace_event_name(event->type));
+    format_iso_timestamp(event->timestamp_ms, iso_ts, sizeof(iso_ts));
+    cJSON_AddStringToObject(obj, "timestamp", iso_ts);
+    cJSON_AddNumberToObject(obj, "timestamp_ms", (double)event->timestamp_ms);
+    cJSON_AddNumberToObject(obj, "sequence", event->sequence);
+    cJSON_AddItemToObject(obj, "data", event_data_to_json(event));
+
+    return obj;
+}
+
+/*============================================================================
+ * Output Handlers
+ *============================================================================*/
+
+static void jsonl_handler(const ac_trace_event_t *event, void *user_data) {
+    FILE *out = (FILE *)user_data;
+    cJSON *obj = event_to_json(event, 1);
+    char *line = cJSON_PrintUnformatted(obj);
+    if (line) {
+        fputs(line, out);
+        fputc('\n', out);
+        cJSON_free(line);
+    }
+    cJSON_Delete(obj);
+}
+
+static void json_handler(const ac_trace_event_t *event, void *user_data) {
+    cJSON *events = (cJSON *)user_data;
+    cJSON_AddItemToArray(events, event_to_json(event, 0));
+}
+
+static int convert_run_json(ac_trace_reader_t *reader, size_t index, cJSON *runs) {
+    const ac_trace_run_info_t *info = ac_trace_reader_run(reader, index);
+    char iso_ts[64];
+
+    cJSON *run = cJSON_CreateObject();
+    cJSON_AddStringToObject(run, "trace_id", info->trace_id);
+    cJSON_AddStringToObject(run, "agent_name", info->agent_name);
+    format_iso_timestamp(info->start_ms, iso_ts, sizeof(iso_ts));
+    cJSON_AddStringToObject(run, "start_time", iso_ts);
+
+    cJSON *events = cJSON_AddArrayToObject(run, "events");
+    int rc = ac_trace_reader_replay(reader, index, json_handler, events);
+    cJSON_AddItemToArray(runs, run);
+    return rc;
+}
+
+static void list_runs(ac_trace_reader_t *reader, FILE *out) {
+    size_t count = ac_trace_reader_run_count(reader);
+    for (size_t i = 0; i < count; i++) {
+        const ac_trace_run_info_t *info = ac_trace_reader_run(reader, i);
+        char iso_ts[64];
+        format_iso_timestamp(info->start_ms, iso_ts, sizeof(iso_ts));
+        fprintf(out, "#%-4zu %-32s %-20s %s  %5u events  %s\n",
+                i, info->trace_id, info->agent_name, iso_ts,
+                info->event_count,
+                info->complete ? "complete" : "incomplete");
+    }
+}
+
+/*============================================================================
+ * Main Entry Point
+ *============================================================================*/
+
+int main(int argc, char *argv[]) {
+    const char *format = "jsonl";
+    const char *run_sel = NULL;
+    const char *output = NULL;
+    int list = 0;
+    int reindex = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:r:o:lih")) != -1) {
+        switch (opt) {
+            case 'f': format = optarg; break;
+            case 'r': run_sel = optarg; break;
+            case 'o': output = optarg; break;
+            case 'l': list = 1; break;
+            case 'i': reindex = 1; break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind >= argc) {
+        fprintf(stderr, "Error: No input file specified\n\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (strcmp(format, "json") != 0 && strcmp(format, "jsonl") != 0) {
+        fprintf(stderr, "Error: Unknown format '%s'\n", format);
+        return 1;
+    }
+
+    const char *input = argv[optind];
+
+    if (reindex) {
+        int n = ac_trace_binary_rebuild_index(input);
+        if (n < 0) {
+            fprintf(stderr, "Error: Failed to rebuild index for %s\n", input);
+            return 1;
+        }
+        printf("Indexed %d run(s)\n", n);
+        return 0;
+    }
+
+    ac_trace_reader_t *reader = ac_trace_reader_open(input);
+    if (!reader) {
+        fprintf(stderr, "Error: %s is not a readable binary trace\n", input);
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (output) {
+        out = fopen(output, "w");
+        if (!out) {
+            fprintf(stderr, "Error: Cannot open %s\n", output);
+            ac_trace_reader_close(reader);
+            return 1;
+        }
+    }
+
+    int rc = 0;
+    size_t first = 0;
+    size_t last = ac_trace_reader_run_count(reader);
+
+    if (run_sel) {
+        int idx = run_sel[0] == '#' ? atoi(run_sel + 1)
+                                    : ac_trace_reader_find_run(reader, run_sel);
+        if (idx < 0 || (size_t)idx >= last) {
+            fprintf(stderr, "Error: Run '%s' not found\n", run_sel);
+            rc = 1;
+            goto done;
+        }
+        first = (size_t)idx;
+        last = first + 1;
+    }
+
+    if (list) {
+        list_runs(reader, out);
+    } else if (strcmp(format, "jsonl") == 0) {
+        for (size_t i = first; i < last; i++) {
+            if (ac_trace_reader_replay(reader, i, jsonl_handler, out) < 0) {
+                fprintf(stderr, "Warning: Run #%zu is unreadable\n", i);
+            }
+        }
+    } else {
+        cJSON *runs = cJSON_CreateArray();
+        for (size_t i = first; i < last; i++) {
+            if (convert_run_json(reader, i, runs) < 0) {
+                fprintf(stderr, "Warning: Run #%zu is unreadable\n", i);
+            }
+        }
+        /* A single run uses the JSON exporter's document layout */
+        cJSON *doc = run_sel ? cJSON_DetachItemFromArray(runs, 0) : runs;
+        char *text = cJSON_Print(doc);
+        if (text) {
+            fputs(text, out);
+            fputc('\n', out);
+            cJSON_free(text);
+        }
+        if (doc != runs) cJSON_Delete(doc);
+        cJSON_Delete(runs);
+    }
+
+done:
+    if (out != stdout) fclose(out);
+    ac_trace_reader_close(reader);
+    return rc;
+}